@@ -47,6 +47,8 @@
 #ifndef _AXI_DWIDTH_CONVERTER_H_
 #define _AXI_DWIDTH_CONVERTER_H_
 
+#include <unordered_map>
+#include <vector>
 #include "xtlm.h"
 #include "report_handler.h"
 
@@ -93,6 +95,20 @@ public:
     void m_upsize_interface_response_sender();
 
 private:
+    /**
+     * @brief Data and strobe storage for an upsized transaction padded to
+     * whole MI beats, reused once its response has gone back to the SI
+     */
+    struct pad_buffer {
+        std::vector<unsigned char> data;
+        std::vector<unsigned char> strb;
+    };
+
+    bool debug_log();
+    xtlm::aximm_payload* split_header(xtlm::aximm_payload* si_trans);
+    pad_buffer* get_pad_buffer(xtlm::aximm_payload* mi_trans, unsigned int bytes);
+    void put_pad_buffer(xtlm::aximm_payload* mi_trans);
+
     xtlm::aximm_payload* m_rd_trans;
     xtlm::aximm_payload* m_wr_trans;
     std::queue<xtlm::aximm_payload*> m_upsize_rd_payld_queue;
@@ -103,9 +119,12 @@ private:
     sc_core::sc_event event_upsize_trig_txn_sender; //!< Event to trigger Txn Sender Method
     sc_core::sc_event event_trig_rd_handler;
     sc_core::sc_event event_trig_wr_handler;
-    std::list<xtlm::aximm_payload* > *m_response_list;
-    std::map<xtlm::aximm_payload*,std::list<xtlm::aximm_payload*>*> m_response_mapper_downsize;
-    std::map<xtlm::aximm_payload*,xtlm::aximm_payload*> m_response_mapper_upsize;
+    std::unordered_map<xtlm::aximm_payload*,xtlm::aximm_payload*> m_split_parent;     //!< Downsized MI split -> SI transaction
+    std::unordered_map<xtlm::aximm_payload*,unsigned int> m_split_pending;           //!< SI transaction -> splits still outstanding
+    xtlm::aximm_payload* m_split_hdr;                                                //!< SI attributes without the data, cloned per split
+    std::unordered_map<xtlm::aximm_payload*,xtlm::aximm_payload*> m_response_mapper_upsize;
+    std::vector<pad_buffer*> m_pad_free;
+    std::unordered_map<xtlm::aximm_payload*,pad_buffer*> m_pad_in_use;
     xsc::common_cpp::report_handler m_logger;
     std::string m_log_msg;
 };
@@ -49,8 +49,8 @@
 
 axi_dwidth_converter::axi_dwidth_converter(sc_core::sc_module_name p_name,
 		xsc::common_cpp::properties& m_properties) :
-		sc_core::sc_module(p_name), m_wr_trans(nullptr), m_rd_trans(nullptr), m_response_list(
-				nullptr),m_logger((std::string) (p_name)) {
+		sc_core::sc_module(p_name), m_wr_trans(nullptr), m_rd_trans(nullptr),
+		m_split_hdr(nullptr), m_logger((std::string) (p_name)) {
 
 	initiator_rd_socket = new xtlm::xtlm_aximm_initiator_socket(
 			"rd_trace_socket", 32);
@@ -74,6 +74,8 @@ axi_dwidth_converter::axi_dwidth_converter(sc_core::sc_module_name p_name,
 	wr_initiator_util->wr_socket.bind(*initiator_wr_socket);
 
 	mem_manager = new xtlm::xtlm_aximm_mem_manager();
+	m_split_hdr = mem_manager->get_payload();
+	m_split_hdr->acquire();
 	SI_DATA_WIDTH = m_properties.getLongLong("C_S_AXI_DATA_WIDTH")/8;
 	MI_DATA_WIDTH = m_properties.getLongLong("C_M_AXI_DATA_WIDTH")/8;
   FIFO_MODE = m_properties.getLongLong("C_FIFO_MODE");
@@ -122,13 +124,63 @@ axi_dwidth_converter::axi_dwidth_converter(sc_core::sc_module_name p_name,
 
 }
 
+/**
+ * @brief Payload logs print every data byte; only build them when the
+ * logger would show them
+ */
+bool axi_dwidth_converter::debug_log() {
+	return m_logger.get_verbosity_level() == xsc::common_cpp::VERBOSITY::DEBUG;
+}
+
+/**
+ * @brief deep_copy_from brings the data and strobes along with the
+ * attributes and extensions. The splits only point into the SI buffers, so
+ * copy the SI transaction once into a header with the data detached and
+ * clone every split from that.
+ */
+xtlm::aximm_payload* axi_dwidth_converter::split_header(xtlm::aximm_payload* si_trans) {
+	m_split_hdr->deep_copy_from(*si_trans);
+	m_split_hdr->set_data_ptr(si_trans->get_data_ptr(), 0);
+	if (si_trans->get_byte_enable_ptr() != nullptr)
+		m_split_hdr->set_byte_enable_ptr(si_trans->get_byte_enable_ptr(), 0);
+	return m_split_hdr;
+}
+
+axi_dwidth_converter::pad_buffer* axi_dwidth_converter::get_pad_buffer(
+		xtlm::aximm_payload* mi_trans, unsigned int bytes) {
+	pad_buffer* buf;
+	if (m_pad_free.empty()) {
+		buf = new pad_buffer;
+	} else {
+		buf = m_pad_free.back();
+		m_pad_free.pop_back();
+	}
+	// Grows to the longest burst seen, then stays
+	if (buf->data.size() < bytes) {
+		buf->data.resize(bytes);
+		buf->strb.resize(bytes);
+	}
+	m_pad_in_use[mi_trans] = buf;
+	return buf;
+}
+
+void axi_dwidth_converter::put_pad_buffer(xtlm::aximm_payload* mi_trans) {
+	auto itr = m_pad_in_use.find(mi_trans);
+	if (itr != m_pad_in_use.end()) {
+		m_pad_free.push_back(itr->second);
+		m_pad_in_use.erase(itr);
+	}
+}
+
 void axi_dwidth_converter::wr_handler() {
     if(wr_initiator_util->is_slave_ready() && 
             wr_target_util->is_trans_available() )
     {
         m_wr_trans = wr_target_util->get_transaction();
-        m_log_msg = "Sampled Write transaction on slave interface : " + std::to_string(m_wr_trans->get_address());
-        XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::001",m_log_msg.c_str(), DEBUG); 
+        if (debug_log()) {
+            m_log_msg = "Sampled Write transaction on slave interface : " + std::to_string(m_wr_trans->get_address());
+            XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::001",m_log_msg.c_str(), DEBUG);
+        }
         ratio = m_wr_trans->get_burst_size() / MI_DATA_WIDTH;
         if (ratio <= 1)
             wr_upsizing();
@@ -143,8 +195,10 @@ void axi_dwidth_converter::rd_handler() {
     {
 	    m_rd_trans = rd_target_util->get_transaction();
         
-        m_log_msg = "Sampled Read transaction on slave interface : " + std::to_string( m_rd_trans->get_address());
-        XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::001",m_log_msg.c_str(), DEBUG); 
+        if (debug_log()) {
+            m_log_msg = "Sampled Read transaction on slave interface : " + std::to_string( m_rd_trans->get_address());
+            XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::001",m_log_msg.c_str(), DEBUG);
+        }
 	    
         ratio = m_rd_trans->get_burst_size()  / MI_DATA_WIDTH;
 	    if (ratio <= 1)
@@ -155,9 +209,7 @@ void axi_dwidth_converter::rd_handler() {
 }
 
 void axi_dwidth_converter::rd_downsizing() {
-	//auto beat_l = m_rd_trans->get_burst_length();
 	auto data = m_rd_trans->get_data_ptr();
-	//auto new_beat_l = beat_l * (ratio);
 	auto strb = m_rd_trans->get_byte_enable_ptr();
 	auto s_addr = m_rd_trans->get_address();
   unsigned int length = m_rd_trans->get_data_length();
@@ -169,21 +221,27 @@ void axi_dwidth_converter::rd_downsizing() {
 	auto cur_beat_l = 0;
 	auto t_total_txns = 0;
 
-    std::string payload_log; 
-    m_rd_trans->get_log(payload_log, PAYLOAD_LOG_LEVEL);
-    m_log_msg = "Down Sizing input transaction : " + payload_log;
-    XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::002",m_log_msg.c_str(), DEBUG); 
+    if (debug_log()) {
+        std::string payload_log;
+        m_rd_trans->get_log(payload_log, PAYLOAD_LOG_LEVEL);
+        m_log_msg = "Down Sizing input transaction : " + payload_log;
+        XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::002",m_log_msg.c_str(), DEBUG);
+    }
 	
-    m_response_list = new std::list<xtlm::aximm_payload*>;
+	// One split needs a single copy anyway; more share the header
+	xtlm::aximm_payload* src = m_rd_trans;
+	if (new_beat_l > 256)
+		src = split_header(m_rd_trans);
 	do {
 		if (new_beat_l > 256)
 			cur_beat_l = 256;
 		else
 			cur_beat_l = new_beat_l;
+		new_beat_l -= cur_beat_l;
 
 		xtlm::aximm_payload* t_trans = mem_manager->get_payload();
 		t_trans->acquire();
-		t_trans->deep_copy_from(*m_rd_trans);
+		t_trans->deep_copy_from(*src);
 		t_trans->set_address(s_addr + num_byte_counter);
 		t_trans->set_data_ptr(data + num_byte_counter,
 				cur_beat_l * MI_DATA_WIDTH);
@@ -194,24 +252,24 @@ void axi_dwidth_converter::rd_downsizing() {
 		t_trans->set_burst_length(cur_beat_l);
 		num_byte_counter += cur_beat_l * MI_DATA_WIDTH ;
 		m_interface_rd_payload_queue.push(t_trans);
-		m_response_list->push_back(t_trans);
+		m_split_parent[t_trans] = m_rd_trans;
 		t_total_txns++;
         
-        std::string payload_log; 
-        t_trans->get_log(payload_log, PAYLOAD_LOG_LEVEL);
-        m_log_msg = "Down sized output transaction  : " + payload_log;
-        XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::002",m_log_msg.c_str(), DEBUG); 
+        if (debug_log()) {
+            std::string payload_log;
+            t_trans->get_log(payload_log, PAYLOAD_LOG_LEVEL);
+            m_log_msg = "Down sized output transaction  : " + payload_log;
+            XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::002",m_log_msg.c_str(), DEBUG);
+        }
 
 	} while (num_byte_counter < total_num_bytes);
-	m_response_mapper_downsize[m_rd_trans] = m_response_list;
+	m_split_pending[m_rd_trans] = t_total_txns;
 	event_downsize_trig_txn_sender.notify();
 }
 
 void axi_dwidth_converter::wr_downsizing() {
-	//auto beat_l = m_wr_trans->get_burst_length();
 	auto data = m_wr_trans->get_data_ptr();
 	auto strb = m_wr_trans->get_byte_enable_ptr();
-	//auto new_beat_l = beat_l * (ratio);
    unsigned int length = m_wr_trans->get_data_length();
   auto size = m_wr_trans->get_burst_size();
   auto beat_l = length/size;
@@ -221,22 +279,27 @@ void axi_dwidth_converter::wr_downsizing() {
 	auto total_num_bytes = beat_l * m_wr_trans->get_burst_size();
 	auto cur_beat_l = 0;
 	auto t_total_txns = 0;
-	m_response_list = new std::list<xtlm::aximm_payload*>;
     
-    std::string payload_log; 
-    m_wr_trans->get_log(payload_log, PAYLOAD_LOG_LEVEL);
-    m_log_msg = "Down Sizing input transaction : " + payload_log;
-    XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::002",m_log_msg.c_str(), DEBUG); 
+    if (debug_log()) {
+        std::string payload_log;
+        m_wr_trans->get_log(payload_log, PAYLOAD_LOG_LEVEL);
+        m_log_msg = "Down Sizing input transaction : " + payload_log;
+        XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::002",m_log_msg.c_str(), DEBUG);
+    }
 	
+	xtlm::aximm_payload* src = m_wr_trans;
+	if (new_beat_l > 256)
+		src = split_header(m_wr_trans);
     do {
 		if (new_beat_l > 256)
 			cur_beat_l = 256;
 		else
 			cur_beat_l = new_beat_l;
+		new_beat_l -= cur_beat_l;
 
 		xtlm::aximm_payload* t_trans = mem_manager->get_payload();
 		t_trans->acquire();
-		t_trans->deep_copy_from(*m_wr_trans);
+		t_trans->deep_copy_from(*src);
 		t_trans->set_address(s_addr + num_byte_counter);
 		t_trans->set_data_ptr(data + num_byte_counter,
 				cur_beat_l * MI_DATA_WIDTH);
@@ -247,17 +310,19 @@ void axi_dwidth_converter::wr_downsizing() {
 		t_trans->set_burst_length(cur_beat_l);
 		num_byte_counter += cur_beat_l * MI_DATA_WIDTH;
 		m_interface_wr_payload_queue.push(t_trans);
-		m_response_list->push_back(t_trans);
+		m_split_parent[t_trans] = m_wr_trans;
 		t_total_txns++;
 
-        std::string payload_log; 
-        t_trans->get_log(payload_log, PAYLOAD_LOG_LEVEL);
-        m_log_msg = "Down sized output transaction  : " + payload_log;
-        XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::002",m_log_msg.c_str(), DEBUG); 
+        if (debug_log()) {
+            std::string payload_log;
+            t_trans->get_log(payload_log, PAYLOAD_LOG_LEVEL);
+            m_log_msg = "Down sized output transaction  : " + payload_log;
+            XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::002",m_log_msg.c_str(), DEBUG);
+        }
 
 	} while (num_byte_counter < total_num_bytes);
 
-	m_response_mapper_downsize[m_wr_trans] = m_response_list;
+	m_split_pending[m_wr_trans] = t_total_txns;
 	event_downsize_trig_txn_sender.notify();
 }
 
@@ -265,9 +330,11 @@ void axi_dwidth_converter::m_downsize_interface_txn_sender() {
 	sc_core::sc_time zero_delay = SC_ZERO_TIME;
 	if (wr_initiator_util->is_slave_ready()
 			&& (m_interface_wr_payload_queue.size() != 0)) {
-        m_log_msg = "Sending Write transaction " + 
-            std::to_string(m_interface_wr_payload_queue.front()->get_address());
-        XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::003",m_log_msg.c_str(), DEBUG); 
+        if (debug_log()) {
+            m_log_msg = "Sending Write transaction " +
+                std::to_string(m_interface_wr_payload_queue.front()->get_address());
+            XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::003",m_log_msg.c_str(), DEBUG);
+        }
 		
         wr_initiator_util->send_transaction(
 				*m_interface_wr_payload_queue.front(), zero_delay);
@@ -278,9 +345,11 @@ void axi_dwidth_converter::m_downsize_interface_txn_sender() {
 	zero_delay = SC_ZERO_TIME;
 	if (rd_initiator_util->is_slave_ready()
 			&& (m_interface_rd_payload_queue.size() != 0)) {
-        m_log_msg = "Sending Read transaction " + 
-            std::to_string(m_interface_rd_payload_queue.front()->get_address());
-        XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::003",m_log_msg.c_str(), DEBUG); 
+        if (debug_log()) {
+            m_log_msg = "Sending Read transaction " +
+                std::to_string(m_interface_rd_payload_queue.front()->get_address());
+            XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::003",m_log_msg.c_str(), DEBUG);
+        }
 		
         rd_initiator_util->send_transaction(
 				*m_interface_rd_payload_queue.front(), zero_delay);
@@ -292,73 +361,70 @@ void axi_dwidth_converter::m_downsize_interface_response_sender() {
 	if (ratio <= 1)
 		return;
 	if (wr_initiator_util->is_resp_available()
-			&& (m_response_mapper_downsize.size() != 0)
+			&& (m_split_parent.size() != 0)
 			&& (wr_target_util->is_master_ready())) {
 		xtlm::aximm_payload* response_payld = wr_initiator_util->get_resp();
 				response_payld->acquire();
-        m_log_msg = "Sampled Response for Write : " + std::to_string(response_payld->get_address());
-        XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::003",m_log_msg.c_str(), DEBUG); 
-
-		std::list<xtlm::aximm_payload*>::iterator itrlist;
-		std::map<xtlm::aximm_payload*, std::list<xtlm::aximm_payload*>*>::iterator itr;
-		for (itr = m_response_mapper_downsize.begin();
-				itr != m_response_mapper_downsize.end(); itr++) {
-			itrlist = (std::find(itr->second->begin(), itr->second->end(),
-					response_payld));
-			if (itrlist != itr->second->end()) {
-				itr->second->remove(response_payld);
-				if (itr->second->size() == 0) {
-					sc_core::sc_time zero_delay = SC_ZERO_TIME;
-                    itr->first->set_axi_response_status(
-                            response_payld->get_axi_response_status());
+        if (debug_log()) {
+            m_log_msg = "Sampled Response for Write : " + std::to_string(response_payld->get_address());
+            XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::003",m_log_msg.c_str(), DEBUG);
+        }
+
+		auto itr = m_split_parent.find(response_payld);
+		if (itr != m_split_parent.end()) {
+			xtlm::aximm_payload* si_trans = itr->second;
+			m_split_parent.erase(itr);
+			auto pending = m_split_pending.find(si_trans);
+			if (--pending->second == 0) {
+				sc_core::sc_time zero_delay = SC_ZERO_TIME;
+                si_trans->set_axi_response_status(
+                        response_payld->get_axi_response_status());
+                if (debug_log()) {
                     m_log_msg = "Sending Response for Write : " + 
-                        std::to_string(itr->first->get_address());
+                        std::to_string(si_trans->get_address());
                     XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::003",m_log_msg.c_str(), DEBUG); 
+                }
 					
-                    wr_target_util->send_resp(*(itr->first), zero_delay);
-					delete (itr->second);
-					m_response_mapper_downsize.erase(itr);
-                    event_trig_wr_handler.notify(sc_core::SC_ZERO_TIME);
-					break;
-				}
-				response_payld->release();
+                wr_target_util->send_resp(*si_trans, zero_delay);
+				m_split_pending.erase(pending);
+                event_trig_wr_handler.notify(sc_core::SC_ZERO_TIME);
 			}
+			//Release the transaction to memory manager
+			response_payld->release();
 		}
 	}
 
 	if (rd_initiator_util->is_data_available()
-			&& (m_response_mapper_downsize.size() != 0)
+			&& (m_split_parent.size() != 0)
 			&& (rd_target_util->is_master_ready())) {
 		xtlm::aximm_payload* response_payld = rd_initiator_util->get_data();
 				response_payld->acquire();
-        m_log_msg = "Sampled Response for Read : " + std::to_string(response_payld->get_address());
-        XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::003",m_log_msg.c_str(), DEBUG); 
-
-		std::list<xtlm::aximm_payload*>::iterator itrlist;
-		std::map<xtlm::aximm_payload*, std::list<xtlm::aximm_payload*>*>::iterator itr;
-		for (itr = m_response_mapper_downsize.begin();
-				itr != m_response_mapper_downsize.end(); itr++) {
-			itrlist = (std::find(itr->second->begin(), itr->second->end(),
-					response_payld));
-			if (itrlist != itr->second->end()) {
-				itr->second->remove(response_payld);
-				if (itr->second->size() == 0) {
-					sc_core::sc_time zero_delay = SC_ZERO_TIME;
-                    itr->first->set_axi_response_status(
-                            response_payld->get_axi_response_status());
+        if (debug_log()) {
+            m_log_msg = "Sampled Response for Read : " + std::to_string(response_payld->get_address());
+            XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::003",m_log_msg.c_str(), DEBUG);
+        }
+
+		auto itr = m_split_parent.find(response_payld);
+		if (itr != m_split_parent.end()) {
+			xtlm::aximm_payload* si_trans = itr->second;
+			m_split_parent.erase(itr);
+			auto pending = m_split_pending.find(si_trans);
+			if (--pending->second == 0) {
+				sc_core::sc_time zero_delay = SC_ZERO_TIME;
+                si_trans->set_axi_response_status(
+                        response_payld->get_axi_response_status());
+                if (debug_log()) {
                     m_log_msg = "Sending Response for Read : " + 
-                        std::to_string(itr->first->get_address());
+                        std::to_string(si_trans->get_address());
                     XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::003",m_log_msg.c_str(), DEBUG); 
+                }
 					
-                    rd_target_util->send_data(*(itr->first), zero_delay);
-					delete (itr->second);
-                    event_trig_rd_handler.notify(sc_core::SC_ZERO_TIME);
-					m_response_mapper_downsize.erase(itr);
-					break;
-				}
-				//Release the transaction to memory manager
-				response_payld->release();
+                rd_target_util->send_data(*si_trans, zero_delay);
+				m_split_pending.erase(pending);
+                event_trig_rd_handler.notify(sc_core::SC_ZERO_TIME);
 			}
+			//Release the transaction to memory manager
+			response_payld->release();
 		}
 	}
 }
@@ -373,40 +439,52 @@ void axi_dwidth_converter::wr_upsizing() {
 			+ (si_burst_len - 1) * si_burst_size) / MI_DATA_WIDTH)
 			* MI_DATA_WIDTH;
 	auto mi_len = (aligned_end - aligned_start) / MI_DATA_WIDTH + 1;
+	unsigned int mi_bytes = mi_len * MI_DATA_WIDTH;
+	unsigned int si_bytes = m_wr_trans->get_data_length();
 
 	xtlm::aximm_payload* t_trans = mem_manager->get_payload();
 	t_trans->acquire();
 	t_trans->deep_copy_from(*m_wr_trans);
 	t_trans->set_address(si_addr);
-    auto data_new = t_trans->create_and_get_data_ptr(mi_len * MI_DATA_WIDTH);
-    memcpy(data_new,data,m_wr_trans->get_data_length());
-    memset(data_new+m_wr_trans->get_data_length(),0,((mi_len * MI_DATA_WIDTH)-m_wr_trans->get_data_length()));
-    auto str_new = t_trans->create_and_get_byte_enable_ptr(mi_len * MI_DATA_WIDTH);
-    if(strb ) 
-    {
-        memcpy(str_new,strb, m_wr_trans->get_byte_enable_length());
-        memset(str_new+m_wr_trans->get_byte_enable_length(),0,((mi_len * MI_DATA_WIDTH)-m_wr_trans->get_byte_enable_length()));
-    }
-    else 
-    {
-           memset(str_new, 0xFF, m_wr_trans->get_data_length());
-           memset(str_new, 0x00, mi_len * MI_DATA_WIDTH - m_wr_trans->get_data_length());
-    }
+	// A burst that fills whole MI beats goes out on the deep copy as it is;
+	// only a short or unaligned one is padded, in a reused buffer
+	if (si_bytes < mi_bytes) {
+		pad_buffer* buf = get_pad_buffer(t_trans, mi_bytes);
+		auto data_new = buf->data.data();
+		auto str_new = buf->strb.data();
+		memcpy(data_new,data,si_bytes);
+		memset(data_new+si_bytes,0,mi_bytes-si_bytes);
+		if(strb )
+		{
+			auto be_bytes = m_wr_trans->get_byte_enable_length();
+			memcpy(str_new,strb,be_bytes);
+			memset(str_new+be_bytes,0,mi_bytes-be_bytes);
+		}
+		else
+		{
+			memset(str_new, 0xFF, si_bytes);
+			memset(str_new+si_bytes, 0x00, mi_bytes-si_bytes);
+		}
+		t_trans->set_data_ptr(data_new, mi_bytes);
+		t_trans->set_byte_enable_ptr(str_new, mi_bytes);
+	}
 	t_trans->set_burst_size(MI_DATA_WIDTH );
 	t_trans->set_burst_length(mi_len);
 	m_upsize_wr_payld_queue.push(t_trans);
 	m_response_mapper_upsize[t_trans] = m_wr_trans;
     
-    m_log_msg = "Upsizing input Txn ";
-    std::string payload_log; 
-    m_wr_trans->get_log(payload_log, PAYLOAD_LOG_LEVEL);
-    m_log_msg += payload_log;                
-    XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::004",m_log_msg.c_str(), DEBUG); 
-
-    m_log_msg = "Upsized output Txn ";
-    t_trans->get_log(payload_log, PAYLOAD_LOG_LEVEL);
-    m_log_msg += payload_log;                
-    XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::004",m_log_msg.c_str(), DEBUG); 
+    if (debug_log()) {
+        m_log_msg = "Upsizing input Txn ";
+        std::string payload_log;
+        m_wr_trans->get_log(payload_log, PAYLOAD_LOG_LEVEL);
+        m_log_msg += payload_log;
+        XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::004",m_log_msg.c_str(), DEBUG);
+
+        m_log_msg = "Upsized output Txn ";
+        t_trans->get_log(payload_log, PAYLOAD_LOG_LEVEL);
+        m_log_msg += payload_log;
+        XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::004",m_log_msg.c_str(), DEBUG);
+    }
 	
     event_upsize_trig_txn_sender.notify();
 
@@ -422,42 +500,44 @@ void axi_dwidth_converter::rd_upsizing() {
 			+ (si_burst_len - 1) * si_burst_size) / MI_DATA_WIDTH)
 			* MI_DATA_WIDTH;
 	auto mi_len = (aligned_end - aligned_start) / MI_DATA_WIDTH + 1;
+	unsigned int mi_bytes = mi_len * MI_DATA_WIDTH;
+	unsigned int si_bytes = m_rd_trans->get_data_length();
 
 	xtlm::aximm_payload* t_trans = mem_manager->get_payload();
 	t_trans->acquire();
 	t_trans->deep_copy_from(*m_rd_trans);
 	t_trans->set_address(si_addr);
-  auto data_new = t_trans->create_and_get_data_ptr(mi_len * MI_DATA_WIDTH);
-  memcpy(data_new,data,m_rd_trans->get_data_length());
-  memset(data_new+m_rd_trans->get_data_length(),0,((mi_len * MI_DATA_WIDTH)-m_rd_trans->get_data_length()));
-  if (strb != nullptr) {
-  auto str_new = t_trans->create_and_get_byte_enable_ptr(mi_len * MI_DATA_WIDTH);
-  if(strb) 
-  {
-      memcpy(str_new,strb, m_rd_trans->get_byte_enable_length());
-      memset(str_new+m_rd_trans->get_byte_enable_length(),0,((mi_len * MI_DATA_WIDTH)-m_rd_trans->get_byte_enable_length()));
-  }
-  else 
-  {
-         memset(str_new, 0xFF, m_rd_trans->get_data_length());
-         memset(str_new, 0x00, mi_len * MI_DATA_WIDTH - m_rd_trans->get_data_length());
-  }
-  }
+	if (si_bytes < mi_bytes) {
+		pad_buffer* buf = get_pad_buffer(t_trans, mi_bytes);
+		auto data_new = buf->data.data();
+		memcpy(data_new,data,si_bytes);
+		memset(data_new+si_bytes,0,mi_bytes-si_bytes);
+		t_trans->set_data_ptr(data_new, mi_bytes);
+		if (strb != nullptr) {
+			auto str_new = buf->strb.data();
+			auto be_bytes = m_rd_trans->get_byte_enable_length();
+			memcpy(str_new,strb,be_bytes);
+			memset(str_new+be_bytes,0,mi_bytes-be_bytes);
+			t_trans->set_byte_enable_ptr(str_new, mi_bytes);
+		}
+	}
 	t_trans->set_burst_size(MI_DATA_WIDTH);
 	t_trans->set_burst_length(mi_len);
 	m_upsize_rd_payld_queue.push(t_trans);
 	m_response_mapper_upsize[t_trans] = m_rd_trans;
     
-    m_log_msg = "Upsizing input Txn ";
-    std::string payload_log; 
-    m_rd_trans->get_log(payload_log, PAYLOAD_LOG_LEVEL);
-    m_log_msg += payload_log;                
-    XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::004",m_log_msg.c_str(), DEBUG); 
-
-    m_log_msg = "Upsized output Txn ";
-    t_trans->get_log(payload_log, PAYLOAD_LOG_LEVEL);
-    m_log_msg += payload_log;                
-    XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::004",m_log_msg.c_str(), DEBUG); 
+    if (debug_log()) {
+        m_log_msg = "Upsizing input Txn ";
+        std::string payload_log;
+        m_rd_trans->get_log(payload_log, PAYLOAD_LOG_LEVEL);
+        m_log_msg += payload_log;
+        XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::004",m_log_msg.c_str(), DEBUG);
+
+        m_log_msg = "Upsized output Txn ";
+        t_trans->get_log(payload_log, PAYLOAD_LOG_LEVEL);
+        m_log_msg += payload_log;
+        XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::004",m_log_msg.c_str(), DEBUG);
+    }
 	
     event_upsize_trig_txn_sender.notify();
 }
@@ -467,9 +547,11 @@ void axi_dwidth_converter::m_upsize_interface_txn_sender() {
 	if (wr_initiator_util->is_slave_ready()
 			&& (m_upsize_wr_payld_queue.size() != 0)) {
         
-        m_log_msg = "Sending Write transaction " + 
-            std::to_string(m_upsize_wr_payld_queue.front()->get_address());
-        XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::005",m_log_msg.c_str(), DEBUG); 
+        if (debug_log()) {
+            m_log_msg = "Sending Write transaction " +
+                std::to_string(m_upsize_wr_payld_queue.front()->get_address());
+            XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::005",m_log_msg.c_str(), DEBUG);
+        }
 		
         wr_initiator_util->send_transaction(*m_upsize_wr_payld_queue.front(),
 				zero_delay);
@@ -481,9 +563,11 @@ void axi_dwidth_converter::m_upsize_interface_txn_sender() {
 	if (rd_initiator_util->is_slave_ready()
 			&& (m_upsize_rd_payld_queue.size() != 0)) {
 
-        m_log_msg = "Sending Read transaction " + 
-            std::to_string(m_upsize_rd_payld_queue.front()->get_address());
-        XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::005",m_log_msg.c_str(), DEBUG); 
+        if (debug_log()) {
+            m_log_msg = "Sending Read transaction " +
+                std::to_string(m_upsize_rd_payld_queue.front()->get_address());
+            XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::005",m_log_msg.c_str(), DEBUG);
+        }
 		
         rd_initiator_util->send_transaction(*m_upsize_rd_payld_queue.front(),
 				zero_delay);
@@ -499,23 +583,28 @@ void axi_dwidth_converter::m_upsize_interface_response_sender() {
 			&& (wr_target_util->is_master_ready())) {
 		xtlm::aximm_payload* response_payld = wr_initiator_util->get_resp();
 				response_payld->acquire();
-        m_log_msg = "Sampled Response for Write : " + std::to_string(response_payld->get_address());
-        XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::006",m_log_msg.c_str(), DEBUG); 
+        if (debug_log()) {
+            m_log_msg = "Sampled Response for Write : " + std::to_string(response_payld->get_address());
+            XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::006",m_log_msg.c_str(), DEBUG);
+        }
 
-		std::map<xtlm::aximm_payload*, xtlm::aximm_payload*>::iterator itr;
-		itr = (m_response_mapper_upsize.find(response_payld));
+		auto itr = m_response_mapper_upsize.find(response_payld);
 		if (itr != m_response_mapper_upsize.end()) {
 			sc_core::sc_time zero_delay = SC_ZERO_TIME;
-            m_response_mapper_upsize[response_payld]->set_axi_response_status(
+			xtlm::aximm_payload *org_payload = itr->second;
+            org_payload->set_axi_response_status(
                     response_payld->get_axi_response_status());
-            m_log_msg = "Sending Response for Write : " + 
-                std::to_string(m_response_mapper_upsize[response_payld]->get_address());
-            XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::006",m_log_msg.c_str(), DEBUG);
+            if (debug_log()) {
+                m_log_msg = "Sending Response for Write : " +
+                    std::to_string(org_payload->get_address());
+                XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::006",m_log_msg.c_str(), DEBUG);
+            }
 
-			wr_target_util->send_resp(*m_response_mapper_upsize[response_payld],
+			wr_target_util->send_resp(*org_payload,
 					zero_delay);
+			put_pad_buffer(response_payld);
 			response_payld->release();
-			m_response_mapper_upsize.erase(response_payld);
+			m_response_mapper_upsize.erase(itr);
             event_trig_wr_handler.notify(sc_core::SC_ZERO_TIME);
 		}
 	}
@@ -525,33 +614,42 @@ void axi_dwidth_converter::m_upsize_interface_response_sender() {
 			&& (rd_target_util->is_master_ready())) {
 		xtlm::aximm_payload* response_payld = rd_initiator_util->get_data();
 				response_payld->acquire();
-        m_log_msg = "Sampled Response for Read : " + std::to_string(response_payld->get_address());
-        XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::006",m_log_msg.c_str(), DEBUG); 
+        if (debug_log()) {
+            m_log_msg = "Sampled Response for Read : " + std::to_string(response_payld->get_address());
+            XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::006",m_log_msg.c_str(), DEBUG);
+        }
 
-		std::map<xtlm::aximm_payload*, xtlm::aximm_payload*>::iterator itr;
-		itr = m_response_mapper_upsize.find(response_payld);
+		auto itr = m_response_mapper_upsize.find(response_payld);
 		if (itr != m_response_mapper_upsize.end()) {
 			sc_core::sc_time zero_delay = SC_ZERO_TIME;
-            m_response_mapper_upsize[response_payld]->set_axi_response_status(
+			xtlm::aximm_payload *org_payload = itr->second;
+            org_payload->set_axi_response_status(
                     response_payld->get_axi_response_status());
-            m_log_msg = "Sending Response for Read : " + 
-                std::to_string(m_response_mapper_upsize[response_payld]->get_address());
-            XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::006",m_log_msg.c_str(), DEBUG);
+            if (debug_log()) {
+                m_log_msg = "Sending Response for Read : " +
+                    std::to_string(org_payload->get_address());
+                XSC_REPORT_INFO_VERB(m_logger, "DWIDTH::006",m_log_msg.c_str(), DEBUG);
+            }
         
-            xtlm::aximm_payload *org_payload = m_response_mapper_upsize[response_payld];
             memcpy(org_payload->get_data_ptr(),response_payld->get_data_ptr(),org_payload->get_data_length());
 
 			rd_target_util->send_data(*org_payload,
 					zero_delay);
             
+			put_pad_buffer(response_payld);
 			response_payld->release();
-			m_response_mapper_upsize.erase(response_payld);
+			m_response_mapper_upsize.erase(itr);
             event_trig_rd_handler.notify(sc_core::SC_ZERO_TIME);
 		}
 	}
 }
 
 axi_dwidth_converter::~axi_dwidth_converter() {
+	m_split_hdr->release();
+	for (auto buf : m_pad_free)
+		delete buf;
+	for (auto& used : m_pad_in_use)
+		delete used.second;
 	delete mem_manager;
 	delete target_rd_socket;
 	delete target_wr_socket;
@@ -206,6 +206,8 @@ smartconnect_xtlm::smartconnect_xtlm(sc_core::sc_module_name name,
         }
 
 
+    build_decode_table();
+
     trans_done = false;
     create_wr_resp = false;
     s_trans = NULL;
@@ -444,253 +446,287 @@ void smartconnect_xtlm::print_log(std::string port, int port_id, std::string rw,
 	  			DEBUG);
 	}
 }
-int smartconnect_xtlm::is_address_hit_lite(xtlm::aximm_payload* trans_ptr, int num_si) {
+void smartconnect_xtlm::build_decode_table() {
+   num_mi_log2 = ceil(log2(smc_num_mi));
+
+   for (int i = 0; i < smc_num_mi; i++) {
+      mi_is_cascaded.push_back(MI_m_properties[i].getInt("IS_CASCADED") == 1);
+   }
+
+   for (int num_si = 0; num_si < smc_num_si; num_si++) {
+      int SI_num_seg = SI_m_properties[num_si].getInt("NUM_SEG");
+      vector<decode_entry> table;
+
+      si_is_cascaded.push_back(SI_m_properties[num_si].getInt("IS_CASCADED") == 1);
+      si_has_burst.push_back(SI_m_properties[num_si].getInt("HAS_BURST") != 0);
+
+      for (int i = 0; i < SI_num_seg; i++) {
+         std::string seg_index;
+         if (i < 10) {
+            seg_index = "SEG00" + std::to_string(i) + ".";
+         } else if (i >= 10 && i < 100 ) {
+            seg_index = "SEG0" + std::to_string(i) + ".";
+         } else {
+            seg_index = "SEG" + std::to_string(i) + ".";
+         }
+
+         int size = SI_m_properties[num_si].getInt( seg_index + "SIZE");
+         decode_entry entry;
+         entry.base_addr    = stoull(SI_m_properties[num_si].getString( seg_index + "BASE_ADDR"), nullptr, 16);
+         entry.high_addr    = (size < 64) ? entry.base_addr + (1ULL << size) : ~0ULL;
+         entry.sep_route    = SI_m_properties[num_si].getLongLong( seg_index + "SEP_ROUTE");
+         entry.seg          = i;
+         entry.burst_length = get_max_burst_length(SI_m_properties[num_si].getString( seg_index + "PROTOCOL"));
+         entry.burst_size   = SI_m_properties[num_si].getInt( seg_index + "DATA_WIDTH") / 8;
+         table.push_back(entry);
+
+	     if (m_report_handler->get_verbosity_level()
+	     		== xsc::common_cpp::VERBOSITY::DEBUG) {
+	     	m_ss.str("");
+	     	m_ss << this->name() << "build_decode_table(): SI " << num_si << " SEG " << std::dec << i
+            << " Address " << std::hex << entry.base_addr << " : " << entry.high_addr
+            << " sep_route: 0x" << entry.sep_route << std::endl;
+	     	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
+	     			DEBUG);
+	     }
+      }
+
+      // Segments of one SI do not overlap, so the entry below the first
+      // base above the address is the only candidate
+      std::sort(table.begin(), table.end(),
+            [](const decode_entry& a, const decode_entry& b) { return a.base_addr < b.base_addr; });
+      int seg0 = 0;
+      for (unsigned int e = 0; e < table.size(); e++) {
+         if (table[e].seg == 0) {
+            seg0 = e;
+         }
+      }
+      si_decode_table.push_back(table);
+      si_decode_last.push_back(seg0);
+      si_decode_seg0.push_back(seg0);
+   }
+}
+
+const smartconnect_xtlm::decode_entry* smartconnect_xtlm::decode_address(xtlm::aximm_payload* trans_ptr, int num_si) {
+   const vector<decode_entry>& table = si_decode_table[num_si];
+   if (table.empty()) {
+      return nullptr;
+   }
+
+   //A cascaded SI routes on the SEP_ROUTE extension whatever the address,
+   //with the attributes of its first segment
+   if (si_is_cascaded[num_si]) {
+      return &table[si_decode_seg0[num_si]];
+   }
+
+   //DMA bursts mostly hit the segment the last one did
    unsigned long long addr = trans_ptr->get_address();
+   const decode_entry* last = &table[si_decode_last[num_si]];
+   if (last->base_addr <= addr && addr < last->high_addr) {
+      return last;
+   }
+
+   auto itr = std::upper_bound(table.begin(), table.end(), addr,
+         [](unsigned long long a, const decode_entry& e) { return a < e.base_addr; });
+   if (itr == table.begin()) {
+      return nullptr;
+   }
+   --itr;
+   if (addr >= itr->high_addr) {
+      return nullptr;
+   }
+   si_decode_last[num_si] = itr - table.begin();
+   return &(*itr);
+}
+
+int smartconnect_xtlm::is_address_hit_lite(xtlm::aximm_payload* trans_ptr, int num_si) {
    xtlm::xtlm_command command = trans_ptr->get_command();
    int slave;
    int si_sep_route;
    unsigned long long sep_route;
-   bool si_cascaded = (SI_m_properties[num_si].getInt("IS_CASCADED") == 1);
-   int SI_num_seg = SI_m_properties[num_si].getInt("NUM_SEG");
+   bool si_cascaded = si_is_cascaded[num_si];
 
 	if (m_report_handler->get_verbosity_level()
 			== xsc::common_cpp::VERBOSITY::DEBUG) {
 		m_ss.str("");
-		m_ss << this->name() << "is_address_hit: SI_num_seg: " << std::dec << SI_num_seg << std::endl;
+		m_ss << this->name() << "is_address_hit: SI_num_seg: " << std::dec << si_decode_table[num_si].size() << std::endl;
 		XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
 				DEBUG);
 	}
 
-   for (int i = 0; i < SI_num_seg; i++) {
-      std::string seg_index;
-      if (i < 10) {
-         seg_index = "SEG00" + std::to_string(i) + ".";
-      } else if (i >= 10 && i < 100 ) {
-         seg_index = "SEG0" + std::to_string(i) + ".";
-      } else {
-         seg_index = "SEG" + std::to_string(i) + ".";
-      }
+   const decode_entry* seg = decode_address(trans_ptr, num_si);
+   if (seg == nullptr) {
+      return -1;
+   }
 
+   if (si_cascaded) {
+      smartconnect_extension* exten = trans_ptr->get_extension<smartconnect_extension>();
+      sep_route                     = exten->get_sep_route();
+      slave                         = ((1 << num_mi_log2) - 1) & sep_route;
+	  if (m_report_handler->get_verbosity_level()
+	  		== xsc::common_cpp::VERBOSITY::DEBUG) {
+	  	m_ss.str("");
+	  	m_ss << this->name() <<  "is_address_hit(): SI " << num_si << " IS CASCADED: sep_route: " << std::hex << sep_route << "\n"
+         << "is_address_hit(): SI " << num_si << " IS CASCADED: exten is: " << exten << "\n";
+	  	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
+	  			DEBUG);
+	  }
+   } else {
+      sep_route = seg->sep_route;
+      slave     = ((1 << num_mi_log2) - 1) & sep_route;
+	  if (m_report_handler->get_verbosity_level()
+	  		== xsc::common_cpp::VERBOSITY::DEBUG) {
+	  	m_ss.str("");
+	  	m_ss << this->name() << "is_address_hit(): SI " << num_si << " NOT CASCADED: sep_route: 0x" << std::hex << sep_route << std::endl;
+	  	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
+	  			DEBUG);
+	  }
+   }
 
-      int size                     = SI_m_properties[num_si].getInt( seg_index + "SIZE");
-      unsigned long long baseaddr  = stoll(SI_m_properties[num_si].getString( seg_index + "BASE_ADDR"), nullptr, 16);
-      unsigned long long high_addr = baseaddr + (unsigned long long) exp2(size);
-      int num_mi_log2              = ceil(log2(smc_num_mi));
+   if (command == xtlm::xtlm_command::XTLM_READ_COMMAND) {
+	  if (m_report_handler->get_verbosity_level()
+	  		== xsc::common_cpp::VERBOSITY::DEBUG) {
+	  	m_ss.str("");
+	  	m_ss << this->name() << "SMARTCONNECT_XTLM: is_address_hit(): Address hit slave_rd_req: " << slave_rd_req << "\n"
+      << "                   Base address: " << std::hex << seg->base_addr << "\n"
+      << "                   High address: " << std::hex << seg->high_addr - 1 << "\n"
+      << "                   Slave       : " << slave << "\n"
+      << "                   MI_burst_length[" << seg->seg << "]: " << MI_burst_length[slave] << "\n"
+      << "                   MI_burst_size[" << seg->seg << "]: " << MI_burst_size[slave] << "\n\n";
+	  	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
+	  			DEBUG);
+	  }
+   } else if (command == xtlm::xtlm_command::XTLM_WRITE_COMMAND) {
+	  if (m_report_handler->get_verbosity_level()
+	  		== xsc::common_cpp::VERBOSITY::DEBUG) {
+	  	m_ss.str("");
+	  	m_ss << this->name() << "SMARTCONNECT_XTLM: is_address_hit(): Address hit slave_wr_req: " << slave_wr_req << "\n"
+         << "                   Base address: " << std::hex << seg->base_addr << "\n"
+         << "                   High address: " << std::hex << seg->high_addr - 1 << "\n"
+         << "                   Slave       : " << slave << "\n"
+         << "                   MI_burst_length[" << seg->seg << "]: " << MI_burst_length[slave] << "\n"
+         << "                   MI_burst_size[" << seg->seg << "]: " << MI_burst_size[slave] << "\n\n";
+	  	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
+	  			DEBUG);
+	  }
+   }
 
+   //create extension payload if MI is cascaded
 
-      if (si_cascaded) {
-         smartconnect_extension* exten = trans_ptr->get_extension<smartconnect_extension>();
-         sep_route                     = exten->get_sep_route();
-//         sep_route                     = 0;
-         slave                         = ((1 << num_mi_log2) - 1) & sep_route;
-	     if (m_report_handler->get_verbosity_level()
-	     		== xsc::common_cpp::VERBOSITY::DEBUG) {
-	     	m_ss.str("");
-	     	m_ss << this->name() <<  "is_address_hit(): SI " << num_si << " IS CASCADED: sep_route: " << std::hex << sep_route << "\n"
-            << "is_address_hit(): SI " << num_si << " IS CASCADED: exten is: " << exten << "\n";
-	     	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
-	     			DEBUG);
-	     }
+   if (mi_is_cascaded[slave]) {
+      si_sep_route = (sep_route >> num_mi_log2);
+      smartconnect_extension* exten =nullptr;
+      trans_ptr->get_extension(exten);
+      if (exten!=nullptr) {
+        exten->set_sep_route(si_sep_route);
       } else {
-         sep_route = SI_m_properties[num_si].getLongLong( seg_index + "SEP_ROUTE");
-         slave     = ((1 << num_mi_log2) - 1) & sep_route;
-	     if (m_report_handler->get_verbosity_level()
-	     		== xsc::common_cpp::VERBOSITY::DEBUG) {
-	     	m_ss.str("");
-	     	m_ss << this->name() << "is_address_hit(): SI " << num_si << " NOT CASCADED: sep_route: 0x" << std::hex << sep_route << std::endl;
-	     	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
-	     			DEBUG);
-	     }
+        exten = new smartconnect_extension();
+        exten->set_sep_route(si_sep_route);
+        trans_ptr->set_auto_extension(exten);
       }
-
 	  if (m_report_handler->get_verbosity_level()
 	  		== xsc::common_cpp::VERBOSITY::DEBUG) {
 	  	m_ss.str("");
-	  	m_ss << this->name() << std::hex << "Address " << baseaddr << " : " << high_addr << std::endl;
+	  	m_ss << this->name() << "is_address_hit(): MI " << slave << " IS CASCADED: sep_route is: " << std::bitset<64>(sep_route) << "\n"
+         << "is_address_hit(): MI " << slave << " IS CASCADED: setting si_sep_route: " << std::bitset<64>(si_sep_route) << "\n\n";
 	  	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
 	  			DEBUG);
 	  }
-
-      if ( (baseaddr <= addr && addr < high_addr) || si_cascaded ) {
-
-         if (command == xtlm::xtlm_command::XTLM_READ_COMMAND) {
-	     if (m_report_handler->get_verbosity_level()
-	     		== xsc::common_cpp::VERBOSITY::DEBUG) {
-	     	m_ss.str("");
-	     	m_ss << this->name() << "SMARTCONNECT_XTLM: is_address_hit(): Address hit slave_rd_req: " << slave_rd_req << "\n"
-            << "                   Base address: " << std::hex << baseaddr << "\n"
-            << "                   High address: " << std::hex << high_addr - 1 << "\n"
-            << "                   Slave       : " << slave << "\n"
-            << "                   MI_burst_length[" << i << "]: " << MI_burst_length[slave] << "\n"
-            << "                   MI_burst_size[" << i << "]: " << MI_burst_size[slave] << "\n\n";
-	     	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
-	     			DEBUG);
-	     }
-         } else if (command == xtlm::xtlm_command::XTLM_WRITE_COMMAND) {
-	        if (m_report_handler->get_verbosity_level()
-	        		== xsc::common_cpp::VERBOSITY::DEBUG) {
-	        	m_ss.str("");
-	        	m_ss << this->name() << "SMARTCONNECT_XTLM: is_address_hit(): Address hit slave_wr_req: " << slave_wr_req << "\n"
-               << "                   Base address: " << std::hex << baseaddr << "\n"
-               << "                   High address: " << std::hex << high_addr - 1 << "\n"
-               << "                   Slave       : " << slave << "\n"
-               << "                   MI_burst_length[" << i << "]: " << MI_burst_length[slave] << "\n"
-               << "                   MI_burst_size[" << i << "]: " << MI_burst_size[slave] << "\n\n";
-	        	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
-	        			DEBUG);
-	        }
-         }
-
-         //create extension payload if MI is cascaded
-         
-         if (MI_m_properties[slave].getInt("IS_CASCADED") == 1) {
-            si_sep_route = (sep_route >> num_mi_log2);
-            smartconnect_extension* exten =nullptr;
-            trans_ptr->get_extension(exten);
-            if (exten!=nullptr) {
-              exten->set_sep_route(si_sep_route);
-            } else {
-              exten = new smartconnect_extension();
-              exten->set_sep_route(si_sep_route);
-              trans_ptr->set_auto_extension(exten);
-            }
-	        if (m_report_handler->get_verbosity_level()
-	        		== xsc::common_cpp::VERBOSITY::DEBUG) {
-	        	m_ss.str("");
-	        	m_ss << this->name() << "is_address_hit(): MI " << slave << " IS CASCADED: sep_route is: " << std::bitset<64>(sep_route) << "\n"
-               << "is_address_hit(): MI " << slave << " IS CASCADED: setting si_sep_route: " << std::bitset<64>(si_sep_route) << "\n\n";
-	        	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
-	        			DEBUG);
-	        }
-         }
-
-         return slave;
-      }
    }
-   return -1;
+
+   return slave;
 }
 
 bool smartconnect_xtlm::is_address_hit(xtlm::aximm_payload* &trans_ptr, int num_si, unsigned long long &si_sep_route, int &m_burst_length, unsigned int &m_burst_size) {
-   unsigned long long addr = trans_ptr->get_address();
    xtlm::xtlm_command command = trans_ptr->get_command();
    int slave;
    unsigned long long sep_route;
-   bool si_cascaded = (SI_m_properties[num_si].getInt("IS_CASCADED") == 1);
-   int SI_num_seg = SI_m_properties[num_si].getInt("NUM_SEG");
+   bool si_cascaded = si_is_cascaded[num_si];
 
 	if (m_report_handler->get_verbosity_level()
 			== xsc::common_cpp::VERBOSITY::DEBUG) {
 		m_ss.str("");
-		m_ss << this->name() << "is_address_hit: SI_num_seg: " << std::dec << SI_num_seg << std::endl;
+		m_ss << this->name() << "is_address_hit: SI_num_seg: " << std::dec << si_decode_table[num_si].size() << std::endl;
 		XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
 				DEBUG);
 	}
 
-   for (int i = 0; i < SI_num_seg; i++) {
-      std::string seg_index;
-      if (i < 10) {
-         seg_index = "SEG00" + std::to_string(i) + ".";
-      } else if (i >= 10 && i < 100 ) {
-         seg_index = "SEG0" + std::to_string(i) + ".";
-      } else {
-         seg_index = "SEG" + std::to_string(i) + ".";
-      }
-
-//      int      size      = stoi(smc_properties[si_index + seg_index + "SIZE"]);
-//      uint64_t baseaddr  = stoll(smc_properties[si_index + seg_index + "BASE_ADDR"], nullptr, 16);
-//      uint64_t high_addr = baseaddr + (int) (std::pow(2, size));
-//      int      slave     = stoi(smc_properties[si_index + seg_index + "SEP_ROUTE"].substr(2), nullptr, 2);
-
-      int size                     = SI_m_properties[num_si].getInt( seg_index + "SIZE");
-      unsigned long long baseaddr  = stoll(SI_m_properties[num_si].getString( seg_index + "BASE_ADDR"), nullptr, 16);
-      unsigned long long high_addr = baseaddr + (unsigned long long) exp2(size);
-      int num_mi_log2              = ceil(log2(smc_num_mi));
-
-      if (si_cascaded) {
-         smartconnect_extension* exten = trans_ptr->get_extension<smartconnect_extension>();
-         sep_route                     = exten->get_sep_route();
-//         sep_route                     = 0;
-         slave                         = ((1 << num_mi_log2) - 1) & sep_route;
-	     if (m_report_handler->get_verbosity_level()
-	     		== xsc::common_cpp::VERBOSITY::DEBUG) {
-	     	m_ss.str("");
-	     	m_ss << this->name() << "is_address_hit(): SI " << num_si << " IS CASCADED: sep_route: " << std::hex << sep_route << "\n"
-            << "is_address_hit(): SI " << num_si << " IS CASCADED: exten is: " << exten << "\n";
-	     	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
-	     			DEBUG);
-	     }
-      } else {
-         sep_route = SI_m_properties[num_si].getLongLong( seg_index + "SEP_ROUTE");
-         slave     = ((1 << num_mi_log2) - 1) & sep_route;
-	     if (m_report_handler->get_verbosity_level()
-	     		== xsc::common_cpp::VERBOSITY::DEBUG) {
-	     	m_ss.str("");
-	     	m_ss << this->name() << "is_address_hit(): SI " << num_si << " NOT CASCADED: sep_route: 0x" << std::hex << sep_route << std::endl;
-	     	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
-	     			DEBUG);
-	     }
-      }
+   const decode_entry* seg = decode_address(trans_ptr, num_si);
+   if (seg == nullptr) {
+      return false;
+   }
 
+   if (si_cascaded) {
+      smartconnect_extension* exten = trans_ptr->get_extension<smartconnect_extension>();
+      sep_route                     = exten->get_sep_route();
+      slave                         = ((1 << num_mi_log2) - 1) & sep_route;
 	  if (m_report_handler->get_verbosity_level()
 	  		== xsc::common_cpp::VERBOSITY::DEBUG) {
 	  	m_ss.str("");
-	  	m_ss << this->name() << std::hex << "Address " << baseaddr << " : " << high_addr << std::endl;
+	  	m_ss << this->name() << "is_address_hit(): SI " << num_si << " IS CASCADED: sep_route: " << std::hex << sep_route << "\n"
+         << "is_address_hit(): SI " << num_si << " IS CASCADED: exten is: " << exten << "\n";
 	  	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
 	  			DEBUG);
 	  }
+   } else {
+      sep_route = seg->sep_route;
+      slave     = ((1 << num_mi_log2) - 1) & sep_route;
+	  if (m_report_handler->get_verbosity_level()
+	  		== xsc::common_cpp::VERBOSITY::DEBUG) {
+	  	m_ss.str("");
+	  	m_ss << this->name() << "is_address_hit(): SI " << num_si << " NOT CASCADED: sep_route: 0x" << std::hex << sep_route << std::endl;
+	  	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
+	  			DEBUG);
+	  }
+   }
 
-      if ( (baseaddr <= addr && addr < high_addr) || si_cascaded ) {
-
-         m_burst_length = get_max_burst_length(SI_m_properties[num_si].getString( seg_index + "PROTOCOL"));
-         m_burst_size = SI_m_properties[num_si].getInt( seg_index + "DATA_WIDTH") / 8; 
-
-         if (command == xtlm::xtlm_command::XTLM_READ_COMMAND) {
-            slave_rd_req = slave;
-	     if (m_report_handler->get_verbosity_level()
-	     		== xsc::common_cpp::VERBOSITY::DEBUG) {
-	     	m_ss.str("");
-	     	m_ss << this->name() << "SMARTCONNECT_XTLM: is_address_hit(): Address hit slave_rd_req: " << slave_rd_req << "\n"
-            << "                   Base address: " << std::hex << baseaddr << "\n"
-            << "                   High address: " << std::hex << high_addr - 1 << "\n"
-            << "                   Slave       : " << slave << "\n"
-            << "                   MI_burst_length[" << i << "]: " << MI_burst_length[slave] << "\n"
-            << "                   MI_burst_size[" << i << "]: " << MI_burst_size[slave] << "\n\n";
-	     	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
-	     			DEBUG);
-	     }
-         } else if (command == xtlm::xtlm_command::XTLM_WRITE_COMMAND) {
-            slave_wr_req = slave;
-	     if (m_report_handler->get_verbosity_level()
-	     		== xsc::common_cpp::VERBOSITY::DEBUG) {
-	     	m_ss.str("");
-	     	m_ss << this->name() << "SMARTCONNECT_XTLM: is_address_hit(): Address hit slave_wr_req: " << slave_wr_req << "\n"
-            << "                   Base address: " << std::hex << baseaddr << "\n"
-            << "                   High address: " << std::hex << high_addr - 1 << "\n"
-            << "                   Slave       : " << slave << "\n"
-            << "                   MI_burst_length[" << i << "]: " << MI_burst_length[slave] << "\n"
-            << "                   MI_burst_size[" << i << "]: " << MI_burst_size[slave] << "\n\n";
-	     	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
-	     			DEBUG);
-	     }
-         }
+   m_burst_length = seg->burst_length;
+   m_burst_size = seg->burst_size;
 
-         //create extension payload if MI is cascaded
-         if (MI_m_properties[slave].getInt("IS_CASCADED") == 1) {
-            si_sep_route = (sep_route >> num_mi_log2);
-	        if (m_report_handler->get_verbosity_level()
-	        		== xsc::common_cpp::VERBOSITY::DEBUG) {
-	        	m_ss.str("");
-	        	m_ss << this->name() << "is_address_hit(): MI " << slave << " IS CASCADED: sep_route is: " << std::bitset<64>(sep_route) << "\n"
-                << "is_address_hit(): MI " << slave << " IS CASCADED: setting si_sep_route: " << std::bitset<64>(si_sep_route) << "\n";
-	        	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
-	        			DEBUG);
-	        }
-         }
+   if (command == xtlm::xtlm_command::XTLM_READ_COMMAND) {
+      slave_rd_req = slave;
+	  if (m_report_handler->get_verbosity_level()
+	  		== xsc::common_cpp::VERBOSITY::DEBUG) {
+	  	m_ss.str("");
+	  	m_ss << this->name() << "SMARTCONNECT_XTLM: is_address_hit(): Address hit slave_rd_req: " << slave_rd_req << "\n"
+      << "                   Base address: " << std::hex << seg->base_addr << "\n"
+      << "                   High address: " << std::hex << seg->high_addr - 1 << "\n"
+      << "                   Slave       : " << slave << "\n"
+      << "                   MI_burst_length[" << seg->seg << "]: " << MI_burst_length[slave] << "\n"
+      << "                   MI_burst_size[" << seg->seg << "]: " << MI_burst_size[slave] << "\n\n";
+	  	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
+	  			DEBUG);
+	  }
+   } else if (command == xtlm::xtlm_command::XTLM_WRITE_COMMAND) {
+      slave_wr_req = slave;
+	  if (m_report_handler->get_verbosity_level()
+	  		== xsc::common_cpp::VERBOSITY::DEBUG) {
+	  	m_ss.str("");
+	  	m_ss << this->name() << "SMARTCONNECT_XTLM: is_address_hit(): Address hit slave_wr_req: " << slave_wr_req << "\n"
+      << "                   Base address: " << std::hex << seg->base_addr << "\n"
+      << "                   High address: " << std::hex << seg->high_addr - 1 << "\n"
+      << "                   Slave       : " << slave << "\n"
+      << "                   MI_burst_length[" << seg->seg << "]: " << MI_burst_length[slave] << "\n"
+      << "                   MI_burst_size[" << seg->seg << "]: " << MI_burst_size[slave] << "\n\n";
+	  	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
+	  			DEBUG);
+	  }
+   }
 
-         return true;
-      }
+   //create extension payload if MI is cascaded
+   if (mi_is_cascaded[slave]) {
+      si_sep_route = (sep_route >> num_mi_log2);
+	  if (m_report_handler->get_verbosity_level()
+	  		== xsc::common_cpp::VERBOSITY::DEBUG) {
+	  	m_ss.str("");
+	  	m_ss << this->name() << "is_address_hit(): MI " << slave << " IS CASCADED: sep_route is: " << std::bitset<64>(sep_route) << "\n"
+          << "is_address_hit(): MI " << slave << " IS CASCADED: setting si_sep_route: " << std::bitset<64>(si_sep_route) << "\n";
+	  	XSC_REPORT_INFO_VERB((*m_report_handler), "1", m_ss.str().c_str(),
+	  			DEBUG);
+	  }
    }
-   return false;
+
+   return true;
 }
 
 int smartconnect_xtlm::get_max_burst_length(std::string protocol) {
@@ -742,7 +778,7 @@ int smartconnect_xtlm::encode_burst_size(int num_burst) {
 smartconnect_xtlm::transaction_status smartconnect_xtlm::get_transaction_status(xtlm::aximm_payload* &trans_ptr, int num_si, 
                                           unsigned long long &si_sep_route, int &m_burst_length, unsigned int &m_burst_size) {
 
-   if (trans_ptr->get_burst_type() == XAXI_BURST_FIXED || (SI_m_properties[num_si].getInt("HAS_BURST") == 0 && trans_ptr->get_burst_type() == XAXI_BURST_WRAP)) {
+   if (trans_ptr->get_burst_type() == XAXI_BURST_FIXED || (!si_has_burst[num_si] && trans_ptr->get_burst_type() == XAXI_BURST_WRAP)) {
       trans_ptr->set_response_status(xtlm::XTLM_BURST_ERROR_RESPONSE);
       return TRANSACTION_BURST_ERROR;
    }
@@ -809,7 +845,7 @@ void smartconnect_xtlm::create_burst_transaction(std::list<xtlm::aximm_payload*>
    int m_burst_cnt = m_burst_length;
    int m_num_burst = m_burst_size;
    int m_data_size = m_burst_cnt * m_num_burst;
-   bool mi_cascaded = (MI_m_properties[nummi].getInt("IS_CASCADED") == 1);
+   bool mi_cascaded = mi_is_cascaded[nummi];
 
    unsigned long long address = trans_ptr->get_address();
 
@@ -1124,8 +1160,8 @@ void smartconnect_xtlm::process_saxi_wr_req() {
 
          if (get_transaction_status(trans_ptr, num_si, si_sep_route, m_wr_burst_length, m_wr_burst_size) == smartconnect_xtlm::TRANSACTION_OK) {
 
-            bool si_cascaded = (SI_m_properties[num_si].getInt("IS_CASCADED") == 1);
-            bool mi_cascaded = (MI_m_properties[slave_wr_req].getInt("IS_CASCADED") == 1);
+            bool si_cascaded = si_is_cascaded[num_si];
+            bool mi_cascaded = mi_is_cascaded[slave_wr_req];
 
             if (si_cascaded) {
                if (mi_cascaded) {
@@ -1341,8 +1377,8 @@ void smartconnect_xtlm::process_saxi_wr_resp() {
    
       unsigned int num_mi = slave_wr_resp_nummi.front();
    
-      bool si_cascaded = (SI_m_properties[num_si].getInt("IS_CASCADED") == 1);
-      bool mi_cascaded = (MI_m_properties[num_mi].getInt("IS_CASCADED") == 1);
+      bool si_cascaded = si_is_cascaded[num_si];
+      bool mi_cascaded = mi_is_cascaded[num_mi];
       
 	  if (m_report_handler->get_verbosity_level()
 	  		== xsc::common_cpp::VERBOSITY::DEBUG) {
@@ -1588,8 +1624,8 @@ void smartconnect_xtlm::process_saxi_rd_req() {
 
          if (get_transaction_status(trans_ptr, num_si, si_sep_route, m_rd_burst_length, m_rd_burst_size) == smartconnect_xtlm::TRANSACTION_OK) {
 
-            bool si_cascaded = (SI_m_properties[num_si].getInt("IS_CASCADED") == 1);
-            bool mi_cascaded = (MI_m_properties[slave_rd_req].getInt("IS_CASCADED") == 1);
+            bool si_cascaded = si_is_cascaded[num_si];
+            bool mi_cascaded = mi_is_cascaded[slave_rd_req];
 
             if (si_cascaded) {
                if (mi_cascaded) {
@@ -1805,8 +1841,8 @@ void smartconnect_xtlm::process_saxi_rd_resp() {
    
       unsigned int num_mi = slave_rd_resp_nummi.front();
    
-      bool si_cascaded = (SI_m_properties[num_si].getInt("IS_CASCADED") == 1);
-      bool mi_cascaded = (MI_m_properties[num_mi].getInt("IS_CASCADED") == 1);
+      bool si_cascaded = si_is_cascaded[num_si];
+      bool mi_cascaded = mi_is_cascaded[num_mi];
    
       trans_ptr->set_response_status(xtlm::XTLM_OK_RESPONSE);
    
@@ -2100,7 +2136,7 @@ void smartconnect_xtlm::process_saxi_rd_resp() {
 
 }
 unsigned int smartconnect_xtlm::transport_dbg_cb(xtlm::aximm_payload& trans,int si_num) {
-    bool si_cascaded = (SI_m_properties[si_num].getInt("IS_CASCADED") == 1);
+    bool si_cascaded = si_is_cascaded[si_num];
     int master_id = is_address_hit_lite(&trans, si_num);
     if(master_id==-1) {
       trans.get_log(payload_msg, 3);
@@ -2112,7 +2148,7 @@ unsigned int smartconnect_xtlm::transport_dbg_cb(xtlm::aximm_payload& trans,int
         return 0;
     }
     /*
-    bool mi_cascaded = (MI_m_properties[master_id].getInt("IS_CASCADED") == 1);
+    bool mi_cascaded = mi_is_cascaded[master_id];
 
     if (!si_cascaded && mi_cascaded) {
         //Clear existing extension
@@ -53,6 +53,7 @@
 #include <vector>
 #include <sstream>
 #include <bitset>
+#include <algorithm>
 #ifndef SMARTCONNECT_XTLM_H
 #define SMARTCONNECT_XTLM_H
 #include "smartconnect_xtlm_impl.h"
@@ -144,6 +145,27 @@ private:
    list<std::pair <uint64_t, uint64_t>> decode_table;
    list<std::pair <uint64_t, uint64_t>>::iterator decode_table_itr;
 
+   //Decode table built once from the SEGnnn properties: one per SI, sorted
+   //by base address, with the segment hit last tried first
+   struct decode_entry {
+      unsigned long long base_addr;
+      unsigned long long high_addr;       //One past the last address
+      unsigned long long sep_route;
+      int                seg;             //SEGnnn index
+      int                burst_length;    //Longest burst of the segment protocol
+      unsigned int       burst_size;      //Segment data width in bytes
+   };
+   vector<vector<decode_entry> > si_decode_table;
+   vector<int>  si_decode_last;           //Entry hit last, per SI
+   vector<int>  si_decode_seg0;           //Entry of SEG000, per SI
+   vector<bool> si_is_cascaded;
+   vector<bool> si_has_burst;
+   vector<bool> mi_is_cascaded;
+   int num_mi_log2;
+
+   void build_decode_table();
+   const decode_entry* decode_address(xtlm::aximm_payload* trans_ptr, int num_si);
+
    void process_saxi_wr_req();
    void process_saxi_wr_resp();
 
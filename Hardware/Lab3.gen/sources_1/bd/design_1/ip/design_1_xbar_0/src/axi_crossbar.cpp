@@ -183,7 +183,7 @@ axi_crossbar::axi_crossbar(sc_module_name name, xsc::common_cpp::properties& pro
       ss<<num_range;
       ss<<"_ADDR_RANGE";
       toValue=((toValue<=64)?toValue:64);
-      unsigned long long rangeVal= pow(2,toValue);
+      unsigned long long rangeVal= (toValue < 64) ? (1ULL << toValue) : ~0ULL;
       properties.addLong(ss.str().c_str(),std::to_string(rangeVal));
       if(m_report_handler->get_verbosity_level()==xsc::common_cpp::VERBOSITY::DEBUG) {
       std::stringstream m_ss;
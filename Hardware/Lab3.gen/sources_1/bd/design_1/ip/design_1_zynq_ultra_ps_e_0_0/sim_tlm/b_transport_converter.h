@@ -75,6 +75,10 @@ class b_transport_converter: public sc_core::sc_module
                 this, &b_transport_converter<IN_WIDTH, OUT_WIDTH>::b_transport);
         initiator_socket.register_nb_transport_bw(
                 this, &b_transport_converter<IN_WIDTH, OUT_WIDTH>::nb_transport_bw);
+        target_socket.register_get_direct_mem_ptr(
+                this, &b_transport_converter<IN_WIDTH, OUT_WIDTH>::get_direct_mem_ptr);
+        initiator_socket.register_invalidate_direct_mem_ptr(
+                this, &b_transport_converter<IN_WIDTH, OUT_WIDTH>::invalidate_direct_mem_ptr);
 
     }
 
@@ -122,6 +126,18 @@ class b_transport_converter: public sc_core::sc_module
                 return tlm::TLM_ACCEPTED;
             }
 
+        //DMI requests and invalidations pass straight through, so a slave
+        //that grants DMI is reachable by pointer from the PS side
+        bool get_direct_mem_ptr(tlm::tlm_generic_payload& payload, tlm::tlm_dmi& dmi_data)
+        {
+            return initiator_socket->get_direct_mem_ptr(payload, dmi_data);
+        }
+
+        void invalidate_direct_mem_ptr(sc_dt::uint64 start_range, sc_dt::uint64 end_range)
+        {
+            target_socket->invalidate_direct_mem_ptr(start_range, end_range);
+        }
+
     private:
         TLM_IF_TYPE get_tlm_if_type(unsigned long long address)
         {
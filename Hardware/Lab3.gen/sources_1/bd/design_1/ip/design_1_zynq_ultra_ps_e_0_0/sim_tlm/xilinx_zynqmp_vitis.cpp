@@ -73,6 +73,7 @@
 #define SC_INCLUDE_DYNAMIC_PROCESSES
 
 #include <inttypes.h>
+#include <string.h>
 
 #include "tlm_utils/simple_initiator_socket.h"
 #include "tlm_utils/simple_target_socket.h"
@@ -199,11 +200,19 @@ xilinx_zynqmp::xilinx_zynqmp(sc_module_name name, const char *sk_descr)
 		proxy_in[i].register_transport_dbg(this,
 						  &xilinx_zynqmp::transport_dbg,
 						  i);
+		proxy_in[i].register_get_direct_mem_ptr(this,
+						  &xilinx_zynqmp::get_direct_mem_ptr,
+						  i);
 		named[i][0] = &proxy_in[i];
 		proxy_out[i].bind(*out[i]);
 		proxy_out[i].register_nb_transport_bw(this,
 						  &xilinx_zynqmp::nb_transport_bw,
 						  i);
+		proxy_out[i].register_invalidate_direct_mem_ptr(this,
+						  &xilinx_zynqmp::invalidate_direct_mem_ptr,
+						  i);
+		dmi_rd[i].valid = dmi_rd[i].refused = false;
+		dmi_wr[i].valid = dmi_wr[i].refused = false;
 	}
 
 	for (i = 0; i < pl2ps_irq.size(); i++) {
@@ -298,10 +307,8 @@ xilinx_zynqmp::~xilinx_zynqmp(void)
 	}
 }
 
-// Modify the Master ID and pass through transactions.
-void xilinx_zynqmp::b_transport(int id,
-				tlm::tlm_generic_payload& trans,
-				sc_time &delay)
+// Modify the Master ID.
+void xilinx_zynqmp::set_master_id(int id, tlm::tlm_generic_payload& trans)
 {
 	// The lower 6 bits of the Master ID are controlled by PL logic.
 	// Upper 7 bits are dictated by the PS.
@@ -334,45 +341,89 @@ void xilinx_zynqmp::b_transport(int id,
 	mid &= (1ULL << 6) - 1;
 	mid |= master_id[id];
 	genattr->set_master_id(mid);
+}
 
-	proxy_out[id]->b_transport(trans, delay);
+// Serve a plain read or write from the port's DMI region, if it has one
+// covering the whole access.
+bool xilinx_zynqmp::dmi_transport(int id,
+				  tlm::tlm_generic_payload& trans,
+				  sc_time &delay)
+{
+	dmi_cache &c = trans.is_read() ? dmi_rd[id] : dmi_wr[id];
+	tlm::tlm_dmi &d = c.region;
+	sc_dt::uint64 addr = trans.get_address();
+	unsigned int len = trans.get_data_length();
+
+	if (!c.valid || trans.get_byte_enable_ptr()
+	    || trans.get_streaming_width() < len
+	    || addr < d.get_start_address()
+	    || addr + len - 1 > d.get_end_address())
+		return false;
+
+	unsigned char *ptr = d.get_dmi_ptr() + (addr - d.get_start_address());
+	if (trans.is_read()) {
+		memcpy(trans.get_data_ptr(), ptr, len);
+		delay += d.get_read_latency();
+	} else if (trans.is_write()) {
+		memcpy(ptr, trans.get_data_ptr(), len);
+		delay += d.get_write_latency();
+	} else {
+		return false;
+	}
+	trans.set_dmi_allowed(true);
+	trans.set_response_status(tlm::TLM_OK_RESPONSE);
+	return true;
 }
-tlm::tlm_sync_enum xilinx_zynqmp::nb_transport_fw(int id,
-				tlm::tlm_generic_payload& trans,tlm::tlm_phase& phase,
-				sc_time &delay)
+
+// Ask for a DMI region for this access's direction, once per grant or
+// refusal. A region allowing both directions fills both caches.
+void xilinx_zynqmp::dmi_request(int id, tlm::tlm_generic_payload& trans)
 {
-	// The lower 6 bits of the Master ID are controlled by PL logic.
-	// Upper 7 bits are dictated by the PS.
-	//
-	// Bits [9:6] are the port index + 8.
-	// Bits [12:10] are the TBU index.
-#define MASTER_ID(tbu, id_9_6) ((tbu) << 10 | (id_9_6) << 6)
-	static const uint32_t master_id[9] = {
-		MASTER_ID(0, 8),
-		MASTER_ID(0, 9),
-		MASTER_ID(3, 10),
-		MASTER_ID(4, 11),
-		MASTER_ID(4, 12),
-		MASTER_ID(5, 13),
-		MASTER_ID(2, 14),
-		MASTER_ID(0, 2), /* ACP. No TBU. AXI IDs? */
-		MASTER_ID(0, 15), /* ACE. No TBU.  */
-	};
-	uint64_t mid;
-	genattr_extension *genattr;
+	dmi_cache &c = trans.is_read() ? dmi_rd[id] : dmi_wr[id];
+	tlm::tlm_dmi region;
 
-	trans.get_extension(genattr);
-	if (!genattr) {
-		genattr = new genattr_extension();
-		trans.set_extension(genattr);
+	if (c.valid || c.refused || !(trans.is_read() || trans.is_write()))
+		return;
+
+	region.init();
+	if (!proxy_out[id]->get_direct_mem_ptr(trans, region)) {
+		c.refused = true;
+		return;
 	}
+	if (region.is_read_allowed()) {
+		dmi_rd[id].region = region;
+		dmi_rd[id].valid = true;
+	}
+	if (region.is_write_allowed()) {
+		dmi_wr[id].region = region;
+		dmi_wr[id].valid = true;
+	}
+	// Granted, but not for this direction
+	if (!c.valid)
+		c.refused = true;
+}
 
-	mid = genattr->get_master_id();
-	/* PL Logic cannot control upper bits.  */
-	mid &= (1ULL << 6) - 1;
-	mid |= master_id[id];
-	genattr->set_master_id(mid);
+// Modify the Master ID and pass through transactions.
+void xilinx_zynqmp::b_transport(int id,
+				tlm::tlm_generic_payload& trans,
+				sc_time &delay)
+{
+	if (dmi_transport(id, trans, delay))
+		return;
+
+	set_master_id(id, trans);
+	proxy_out[id]->b_transport(trans, delay);
 
+	// Ask for a DMI region once the target has offered one.
+	if (trans.is_dmi_allowed()
+	    && trans.get_response_status() == tlm::TLM_OK_RESPONSE)
+		dmi_request(id, trans);
+}
+tlm::tlm_sync_enum xilinx_zynqmp::nb_transport_fw(int id,
+				tlm::tlm_generic_payload& trans,tlm::tlm_phase& phase,
+				sc_time &delay)
+{
+	set_master_id(id, trans);
 	return proxy_out[id]->nb_transport_fw(trans, phase, delay);
 }
 
@@ -380,6 +431,35 @@ tlm::tlm_sync_enum xilinx_zynqmp::nb_transport_fw(int id,
 unsigned int xilinx_zynqmp::transport_dbg(int id, tlm::tlm_generic_payload& trans) {
 	return proxy_out[id]->transport_dbg(trans);
 }
+
+// DMI requests from PL masters get the port's Master ID, as their
+// transactions would.
+bool xilinx_zynqmp::get_direct_mem_ptr(int id,
+				       tlm::tlm_generic_payload& trans,
+				       tlm::tlm_dmi& dmi_data)
+{
+	set_master_id(id, trans);
+	return proxy_out[id]->get_direct_mem_ptr(trans, dmi_data);
+}
+
+// A remap in the PS drops our own regions and refusals, and is passed on
+// to the PL masters holding pointers.
+void xilinx_zynqmp::invalidate_direct_mem_ptr(int id,
+					      sc_dt::uint64 start_range,
+					      sc_dt::uint64 end_range)
+{
+	dmi_cache *caches[] = { &dmi_rd[id], &dmi_wr[id] };
+
+	for (dmi_cache *c : caches) {
+		if (c->valid && start_range <= c->region.get_end_address()
+		    && end_range >= c->region.get_start_address())
+			c->valid = false;
+		// The memory map changed: a refused target may grant now
+		c->refused = false;
+	}
+
+	proxy_in[id]->invalidate_direct_mem_ptr(start_range, end_range);
+}
 tlm::tlm_sync_enum xilinx_zynqmp::nb_transport_bw(int id,
 				tlm::tlm_generic_payload& trans,tlm::tlm_phase& phase,
 				sc_time &delay)
@@ -155,6 +155,32 @@ private:
 			tlm::tlm_phase& phase, sc_core::sc_time& delay);
 	virtual unsigned int transport_dbg(int id,
 					   tlm::tlm_generic_payload& trans);
+	virtual bool get_direct_mem_ptr(int id,
+					tlm::tlm_generic_payload& trans,
+					tlm::tlm_dmi& dmi_data);
+	virtual void invalidate_direct_mem_ptr(int id,
+					       sc_dt::uint64 start_range,
+					       sc_dt::uint64 end_range);
+	void set_master_id(int id, tlm::tlm_generic_payload& trans);
+	bool dmi_transport(int id, tlm::tlm_generic_payload& trans,
+			   sc_time& delay);
+
+	/*
+	 * DMI regions granted on each PL to PS port, one for reads and
+	 * one for writes, so bulk traffic (DMA buffers in DDR) can be
+	 * copied directly instead of going through the proxies and
+	 * Remote-Port. A refusal is remembered so the target is not asked
+	 * again on every access. Both are dropped when the target
+	 * invalidates a range.
+	 */
+	struct dmi_cache {
+		tlm::tlm_dmi region;
+		bool valid;
+		bool refused;
+	};
+	dmi_cache dmi_rd[9];
+	dmi_cache dmi_wr[9];
+	void dmi_request(int id, tlm::tlm_generic_payload& trans);
 public:
 	/*
 	 * HPM0 - 1 _FPD.
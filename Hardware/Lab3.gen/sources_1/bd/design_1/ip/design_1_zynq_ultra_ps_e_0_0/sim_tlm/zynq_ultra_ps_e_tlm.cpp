@@ -126,9 +126,16 @@ void add_extensions_to_tlm(const xtlm::aximm_payload* xtlm_pay, tlm::tlm_generic
         return;
     //portion of master ID bits(master_id[5:0]) are derived from the AXI ID(AWID/ARID). (refere Zynq UltraScale+ TRM page.no:414,415)
     //val = (*(uint8_t*)(xtlm_pay->get_axi_id())) && 0x3F;
-    genattr_extension* ext = new genattr_extension;
+    //A pooled payload keeps its extension from the last transaction, so
+    //update it rather than allocating (and leaking) one every time
+    genattr_extension* ext = NULL;
+    gp->get_extension(ext);
+    if(ext == NULL)
+    {
+        ext = new genattr_extension;
+        gp->set_extension(ext);
+    }
     ext->set_master_id(val);
-    gp->set_extension(ext);    
     gp->set_streaming_width(gp->get_data_length());
     if(gp->get_command() != tlm::TLM_WRITE_COMMAND)
     {
@@ -84,6 +84,8 @@ begin
         port map (
             clk        => clk,
             rst        => rst,
+            mono       => '0',      -- original L/R word stream
+            pack16     => '0',
             i2s_lrcl   => i2s_lrcl,
             i2s_din    => i2s_din,
             i2s_bclk   => i2s_bclk,
@@ -12,6 +12,7 @@ entity audio_pipeline is
         DATA_WIDTH : integer := 32;
         FIFO_DEPTH : integer := 12;
         TRANSFER_LEN : integer := 5;
+        DEC_FIFO_DEPTH : integer := 10;
 		C_S00_AXI_DATA_WIDTH    : integer	:= 32;
 		C_S00_AXI_ADDR_WIDTH	: integer	:= 5
     );
@@ -33,6 +34,15 @@ entity audio_pipeline is
         axis_tvalid     : out std_logic;
         axis_tready     : in  std_logic;
         axis_tlast      : out std_logic;
+
+        --------------------------------------------------
+        -- AXI4-Stream, 4:1 decimated analysis samples
+        -- (second S2MM channel; leave tready open if unused)
+        --------------------------------------------------
+        axis_dec_tdata  : out std_logic_vector(DATA_WIDTH-1 downto 0);
+        axis_dec_tvalid : out std_logic;
+        axis_dec_tready : in  std_logic := '0';
+        axis_dec_tlast  : out std_logic;
         
         --------------------------------------------------
         -- Control interface (AXI4-Lite)
@@ -72,6 +82,8 @@ architecture Behavioural of audio_pipeline is
     signal sig_fifo_empty           : std_logic;
     signal sig_fifo_data_w          : std_logic_vector(DATA_WIDTH-1 downto 0);
     signal sig_fifo_data_r          : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal sig_fifo_level           : std_logic_vector(FIFO_DEPTH-1 downto 0);
+    signal sig_fifo_drop            : std_logic;
 
     --------------------------------------------------
     -- AXI4-Stream
@@ -87,10 +99,96 @@ architecture Behavioural of audio_pipeline is
     signal sig_control_reg          : std_logic_vector(DATA_WIDTH-1 downto 0);
     signal sig_status_reg           : std_logic_vector(DATA_WIDTH-1 downto 0);
     signal sig_gain_reg             : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal sig_telemetry_reg        : std_logic_vector(DATA_WIDTH-1 downto 0);
+
+    --------------------------------------------------
+    -- Telemetry (cb_param3_reg, 0x1C)
+    --   bits 2:0  counter read back through cb_status_reg (stream_telemetry)
+    --   bit 31    CLEAR: holds every counter at zero
+    -- Counts the capture FIFO: words written, words discarded while full,
+    -- the highest fill level and the cycles the DMA held off tready. The
+    -- underrun counter stays 0 on this path. All 0 reads the status
+    -- constant as before.
+    --------------------------------------------------
+    signal sig_telemetry_clear      : std_logic;
+    signal sig_axis_stall           : std_logic;
+
+    --------------------------------------------------
+    -- Capture formatting (cb_control_reg)
+    --   bit 0     PACK16: mirror the mic bits, narrow to 16-bit PCM and pack
+    --             two samples per word (first sample in bits 15:0)
+    --   bit 1     ROUND: narrow by rounding the 18-bit sample (with
+    --             saturation); 0 keeps the same 16 bits as the software
+    --             conversion (pcm_from_capture)
+    --   bit 2     FLUSH: holds the FIFO, packer and TLAST counter in reset
+    --   bit 3     DECIMATE: also send the samples low-passed and decimated
+    --             4:1 (capture_decimator) on axis_dec, as packed 16-bit PCM
+    --   bits 7:4  TLAST_LOG2: packet length is 2**n beats, 0 = 256
+    --   bits 11:8 DEC_TLAST_LOG2: the same for axis_dec, 0 = 64
+    -- All 0 is the original stream: one raw mic word per beat.
+    --------------------------------------------------
+    signal sig_mic_data             : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal sig_mic_wr               : std_logic;
+    signal sig_pack16               : std_logic;
+    signal sig_round                : std_logic;
+    signal sig_flush                : std_logic;
+    signal sig_pack_half            : std_logic;
+    signal sig_pack_lo              : std_logic_vector(15 downto 0);
+    signal sig_tlast_len            : unsigned(15 downto 0);
+    signal sig_beat_cnt             : unsigned(15 downto 0);
+
+    --------------------------------------------------
+    -- Decimated analysis stream (DECIMATE)
+    --------------------------------------------------
+    signal sig_decimate             : std_logic;
+    signal sig_dec_rst              : std_logic;
+    signal sig_dec_x                : signed(17 downto 0);
+    signal sig_dec_x_valid          : std_logic;
+    signal sig_dec_y                : std_logic_vector(15 downto 0);
+    signal sig_dec_y_valid          : std_logic;
+    signal sig_dec_half             : std_logic;
+    signal sig_dec_lo               : std_logic_vector(15 downto 0);
+    signal sig_dec_fifo_wr          : std_logic;
+    signal sig_dec_fifo_rd          : std_logic;
+    signal sig_dec_fifo_full        : std_logic;
+    signal sig_dec_fifo_empty       : std_logic;
+    signal sig_dec_fifo_data_w      : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal sig_dec_fifo_data_r      : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal sig_dec_tvalid           : std_logic;
+    signal sig_dec_tlast_len        : unsigned(15 downto 0);
+    signal sig_dec_beat_cnt         : unsigned(15 downto 0);
+
+    -- Mic word -> 16-bit PCM. The word holds the 18 sample bits LSB first
+    -- (bit k is sample bit 17-k).
+    function to_pcm16(w : std_logic_vector; rnd : std_logic) return std_logic_vector is
+        variable s : signed(17 downto 0);
+        variable t : signed(18 downto 0);
+    begin
+        for k in 0 to 17 loop
+            s(k) := w(17 - k);
+        end loop;
+        if rnd = '0' then
+            return std_logic_vector(s(15 downto 0));
+        end if;
+        t := resize(s, 19) + 2;
+        if t(18 downto 17) = "01" then
+            return x"7FFF";
+        end if;
+        return std_logic_vector(t(17 downto 2));
+    end function;
+
+    -- Mic word -> signed 18-bit sample
+    function to_s18(w : std_logic_vector) return signed is
+        variable s : signed(17 downto 0);
+    begin
+        for k in 0 to 17 loop
+            s(k) := w(17 - k);
+        end loop;
+        return s;
+    end function;
 
 begin
 
-    sig_status_reg <= x"0ca7cafe";
     --------------------------------------------------
     -- Control bus
     --------------------------------------------------
@@ -103,6 +201,7 @@ begin
         cb_control_reg  => sig_control_reg,
         cb_status_reg   => sig_status_reg,
         cb_gain_reg     => sig_gain_reg,
+        cb_param3_reg   => sig_telemetry_reg,
 
 		S_AXI_ACLK	    => s00_axi_aclk,
 		S_AXI_ARESETN	=> s00_axi_aresetn,
@@ -128,7 +227,16 @@ begin
 	);
 
     -- sig_fifo_rst <= not rst; -- AXIS reset is active low
-    sig_fifo_rst <= '0';
+    sig_pack16 <= sig_control_reg(0);
+    sig_round  <= sig_control_reg(1);
+    sig_flush  <= sig_control_reg(2);
+    sig_tlast_len <= to_unsigned(256, 16) when unsigned(sig_control_reg(7 downto 4)) = 0 else
+                     shift_left(to_unsigned(1, 16), to_integer(unsigned(sig_control_reg(7 downto 4))));
+    sig_fifo_rst <= sig_flush;
+    sig_decimate <= sig_control_reg(3);
+    sig_dec_tlast_len <= to_unsigned(64, 16) when unsigned(sig_control_reg(11 downto 8)) = 0 else
+                         shift_left(to_unsigned(1, 16), to_integer(unsigned(sig_control_reg(11 downto 8))));
+    sig_dec_rst <= sig_flush or not sig_decimate;
 
     --------------------------------------------------
     -- I2S Master
@@ -145,11 +253,122 @@ begin
         i2s_dout        => i2s_dout,
         i2s_bclk        => i2s_bclk,
 
-        fifo_din        => sig_fifo_data_w,
-        fifo_w_stb      => sig_fifo_wr,
+        fifo_din        => sig_mic_data,
+        fifo_w_stb      => sig_mic_wr,
         fifo_full       => sig_fifo_full
     );
 
+    --------------------------------------------------
+    -- Formatter / packer
+    --------------------------------------------------
+    -- Raw words pass straight through; in PACK16 every second sample writes
+    -- one word, halving the FIFO, AXIS and DDR traffic per sample
+    process (clk)
+        variable v_pcm : std_logic_vector(15 downto 0);
+    begin
+        if rising_edge(clk) then
+            sig_fifo_wr <= '0';
+            if (sig_flush = '1' or sig_pack16 = '0') then
+                sig_pack_half <= '0';
+            end if;
+
+            if (sig_mic_wr = '1' and sig_flush = '0') then
+                if (sig_pack16 = '0') then
+                    sig_fifo_data_w <= sig_mic_data;
+                    sig_fifo_wr <= '1';
+                else
+                    v_pcm := to_pcm16(sig_mic_data, sig_round);
+                    if (sig_pack_half = '0') then
+                        sig_pack_lo <= v_pcm;
+                        sig_pack_half <= '1';
+                    else
+                        sig_fifo_data_w <= v_pcm & sig_pack_lo;
+                        sig_fifo_wr <= '1';
+                        sig_pack_half <= '0';
+                    end if;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    --------------------------------------------------
+    -- Decimated analysis stream: 48 kHz -> 12 kHz, two samples per
+    -- word (first in bits 15:0) into its own FIFO. It has no
+    -- backpressure on the mic: a full FIFO drops output samples.
+    --------------------------------------------------
+    sig_dec_x       <= to_s18(sig_mic_data);
+    sig_dec_x_valid <= sig_mic_wr and sig_decimate and not sig_flush;
+
+    inst_decimator : entity work.capture_decimator
+    port map (
+        clk             => clk,
+        rst             => sig_dec_rst,
+        x_in            => sig_dec_x,
+        x_valid         => sig_dec_x_valid,
+        y_out           => sig_dec_y,
+        y_valid         => sig_dec_y_valid
+    );
+
+    process (clk)
+    begin
+        if rising_edge(clk) then
+            sig_dec_fifo_wr <= '0';
+            if (sig_dec_rst = '1') then
+                sig_dec_half <= '0';
+            elsif (sig_dec_y_valid = '1') then
+                if (sig_dec_half = '0') then
+                    sig_dec_lo <= sig_dec_y;
+                    sig_dec_half <= '1';
+                else
+                    sig_dec_fifo_data_w <= sig_dec_y & sig_dec_lo;
+                    sig_dec_fifo_wr <= not sig_dec_fifo_full;
+                    sig_dec_half <= '0';
+                end if;
+            end if;
+        end if;
+    end process;
+
+    inst_dec_fifo : fifo
+    generic map (
+        data_width => DATA_WIDTH,
+        fifo_depth => DEC_FIFO_DEPTH
+    ) port map (
+        clkw            => clk,
+        clkr            => clk,
+        rst             => sig_dec_rst,
+
+        wr              => sig_dec_fifo_wr,
+        din             => sig_dec_fifo_data_w,
+        full            => sig_dec_fifo_full,
+
+        rd              => sig_dec_fifo_rd,
+        dout            => sig_dec_fifo_data_r,
+        empty           => sig_dec_fifo_empty
+    );
+
+    sig_dec_tvalid  <= not sig_dec_fifo_empty;
+    sig_dec_fifo_rd <= sig_dec_tvalid and axis_dec_tready;
+    axis_dec_tvalid <= sig_dec_tvalid;
+    axis_dec_tdata  <= sig_dec_fifo_data_r;
+
+    process (clk)
+    begin
+        if (rst = '0') then
+            sig_dec_beat_cnt <= (others => '0');
+        elsif rising_edge(clk) then
+            if (sig_dec_rst = '1') then
+                sig_dec_beat_cnt <= (others => '0');
+            elsif ((sig_dec_tvalid and axis_dec_tready) = '1') then
+                if (sig_dec_beat_cnt + 1 >= sig_dec_tlast_len) then
+                    sig_dec_beat_cnt <= (others => '0');
+                else
+                    sig_dec_beat_cnt <= sig_dec_beat_cnt + 1;
+                end if;
+            end if;
+        end if;
+    end process;
+    axis_dec_tlast <= '1' when (sig_dec_beat_cnt + 1 >= sig_dec_tlast_len) else '0';
+
     --------------------------------------------------
     -- FIFO
     --------------------------------------------------
@@ -168,7 +387,34 @@ begin
 
         rd              => sig_fifo_rd,
         dout            => sig_fifo_data_r,
-        empty           => sig_fifo_empty
+        empty           => sig_fifo_empty,
+
+        level           => sig_fifo_level,
+        drop            => sig_fifo_drop
+    );
+
+    --------------------------------------------------
+    -- Telemetry
+    --------------------------------------------------
+    sig_telemetry_clear <= sig_telemetry_reg(31) or not rst;
+    sig_axis_stall <= sig_axis_tvalid and not axis_tready;
+
+    inst_telemetry : entity work.stream_telemetry
+    generic map (
+        LEVEL_WIDTH     => FIFO_DEPTH
+    )
+    port map (
+        clk             => clk,
+        clear           => sig_telemetry_clear,
+
+        word_stb        => sig_fifo_wr,
+        drop_stb        => sig_fifo_drop,
+        underrun_stb    => '0',
+        stall           => sig_axis_stall,
+        level           => unsigned(sig_fifo_level),
+
+        sel             => sig_telemetry_reg(2 downto 0),
+        dout            => sig_status_reg
     );
 
     --------------------------------------------------
@@ -179,26 +425,25 @@ begin
     sig_axis_tvalid <= '1' when sig_fifo_empty = '0' else '0';
     axis_tvalid <= sig_axis_tvalid;
     
-    -- TLAST
+    -- TLAST on the last beat of every sig_tlast_len-beat packet, so a
+    -- simple-mode S2MM transfer of that many words ends exactly on it
     process (clk)
-        -- variable v_cnt : unsigned(3 downto 0) := (others => '0');
-        variable v_cnt : integer := 0;
     begin
         if (rst = '0') then
-            v_cnt := 0;
+            sig_beat_cnt <= (others => '0');
         elsif rising_edge(clk) then
-            if ((sig_axis_tvalid and axis_tready) = '1') then
-                v_cnt := v_cnt + 1;
-                
-                if (v_cnt = 256) then
-                    axis_tlast <= '1';
-                    v_cnt := 0;
+            if (sig_flush = '1') then
+                sig_beat_cnt <= (others => '0');
+            elsif ((sig_axis_tvalid and axis_tready) = '1') then
+                if (sig_beat_cnt + 1 >= sig_tlast_len) then
+                    sig_beat_cnt <= (others => '0');
                 else
-                    axis_tlast <= '0';
+                    sig_beat_cnt <= sig_beat_cnt + 1;
                 end if;
             end if;
         end if;
     end process;
+    axis_tlast <= '1' when (sig_beat_cnt + 1 >= sig_tlast_len) else '0';
     -- axis_tlast <= '1';
 
     -- TDATA
@@ -7,6 +7,10 @@ entity ctrl_bus is
         ------------------------------------------------
         -- Control bus parameters
         ------------------------------------------------
+		-- Reset values of the parameter registers 4 .. 6
+		C_PARAM0_RESET	: std_logic_vector(31 downto 0)	:= x"00000000";
+		C_PARAM1_RESET	: std_logic_vector(31 downto 0)	:= x"00000000";
+		C_PARAM2_RESET	: std_logic_vector(31 downto 0)	:= x"00000000";
 
         ------------------------------------------------
         -- AXI Lite parameters
@@ -23,6 +27,10 @@ entity ctrl_bus is
         cb_control_reg      : out std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
         cb_status_reg       : in  std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
         cb_gain_reg         : out std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
+        cb_param0_reg       : out std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
+        cb_param1_reg       : out std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
+        cb_param2_reg       : out std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
+        cb_param3_reg       : out std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
 
         ------------------------------------------------
         -- AXI Lite signals
@@ -123,10 +131,10 @@ architecture arch_imp of ctrl_bus is
 	signal slv_reg1	:std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0); -- Status register
 	signal slv_reg2	:std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0); -- Key
 	signal slv_reg3	:std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0); -- Gain
-	signal slv_reg4	:std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0); -- Preserved 0
-	signal slv_reg5	:std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0); -- Preserved 1
-	signal slv_reg6	:std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0); -- Preserved 2
-	signal slv_reg7	:std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0); -- Preserved 3
+	signal slv_reg4	:std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0); -- Parameter 0
+	signal slv_reg5	:std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0); -- Parameter 1
+	signal slv_reg6	:std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0); -- Parameter 2
+	signal slv_reg7	:std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0); -- Parameter 3
     --
 	signal slv_reg_rden	: std_logic;
 	signal slv_reg_wren	: std_logic;
@@ -150,6 +158,10 @@ begin
     cb_control_reg  <= slv_reg0;
     slv_reg1        <= cb_status_reg;
     cb_gain_reg     <= slv_reg3;
+    cb_param0_reg   <= slv_reg4;
+    cb_param1_reg   <= slv_reg5;
+    cb_param2_reg   <= slv_reg6;
+    cb_param3_reg   <= slv_reg7;
 
 	-- Implement axi_awready generation
 	-- axi_awready is asserted for one S_AXI_ACLK clock cycle when both
@@ -240,10 +252,10 @@ begin
                 -- slv_reg1 <= x"00000000";     -- Status Register
                 -- slv_reg2 <= x"0CA7CAFE";        -- Key
                 slv_reg3 <= (others => '0');    -- Gain
-                slv_reg4 <= (others => '0');    -- Preserved 0
-                slv_reg5 <= (others => '0');    -- Preserved 1
-                slv_reg6 <= (others => '0');    -- Preserved 2
-                slv_reg7 <= (others => '0');    -- Preserved 3
+                slv_reg4 <= C_PARAM0_RESET;     -- Parameter 0
+                slv_reg5 <= C_PARAM1_RESET;     -- Parameter 1
+                slv_reg6 <= C_PARAM2_RESET;     -- Parameter 2
+                slv_reg7 <= (others => '0');    -- Parameter 3
             else
                 loc_addr := axi_awaddr(ADDR_LSB + OPT_MEM_ADDR_BITS downto ADDR_LSB);
                 if (slv_reg_wren = '1') then
@@ -285,7 +297,7 @@ begin
                             end if;
                         end loop;
                     when b"100" =>
-                        ---- Preserved 0 register
+                        ---- Parameter 0 register
                         for byte_index in 0 to (C_S_AXI_DATA_WIDTH/8-1) loop
                             if ( S_AXI_WSTRB(byte_index) = '1' ) then
                                 -- Respective byte enables are asserted as per write strobes                   
@@ -294,7 +306,7 @@ begin
                             end if;
                         end loop;
                     when b"101" =>
-                        ---- Preserved 1 register
+                        ---- Parameter 1 register
                         for byte_index in 0 to (C_S_AXI_DATA_WIDTH/8-1) loop
                             if ( S_AXI_WSTRB(byte_index) = '1' ) then
                                 -- Respective byte enables are asserted as per write strobes                   
@@ -303,7 +315,7 @@ begin
                             end if;
                         end loop;
                     when b"110" =>
-                        ---- Preserved 2 register
+                        ---- Parameter 2 register
                         for byte_index in 0 to (C_S_AXI_DATA_WIDTH/8-1) loop
                             if ( S_AXI_WSTRB(byte_index) = '1' ) then
                                 -- Respective byte enables are asserted as per write strobes                   
@@ -312,7 +324,7 @@ begin
                             end if;
                         end loop;
                     when b"111" =>
-                        ---- Preserved 3 register
+                        ---- Parameter 3 register
                         for byte_index in 0 to (C_S_AXI_DATA_WIDTH/8-1) loop
                             if ( S_AXI_WSTRB(byte_index) = '1' ) then
                                 -- Respective byte enables are asserted as per write strobes                   
@@ -429,13 +441,13 @@ begin
             when b"011" =>
                 reg_data_out <= slv_reg3;   -- Gain Register
             when b"100" =>
-                reg_data_out <= slv_reg4;   -- Preserved Register 0
+                reg_data_out <= slv_reg4;   -- Parameter Register 0
             when b"101" =>
-                reg_data_out <= slv_reg5;   -- Preserved Register 1
+                reg_data_out <= slv_reg5;   -- Parameter Register 1
             when b"110" =>
-                reg_data_out <= slv_reg6;   -- Preserved Register 2
+                reg_data_out <= slv_reg6;   -- Parameter Register 2
             when b"111" =>
-                reg_data_out <= slv_reg7;   -- Preserved Register 3
+                reg_data_out <= slv_reg7;   -- Parameter Register 3
             when others =>
                 reg_data_out  <= (others => '0');
 	    end case;
@@ -16,7 +16,9 @@ entity fifo is
         din     : in  std_logic_vector(DATA_WIDTH-1 downto 0);
         empty   : out std_logic;
         full    : out std_logic;
-        dout    : out std_logic_vector(DATA_WIDTH-1 downto 0)
+        dout    : out std_logic_vector(DATA_WIDTH-1 downto 0);
+        level   : out std_logic_vector(FIFO_DEPTH-1 downto 0);  -- words held
+        drop    : out std_logic     -- full: the oldest word is discarded this cycle
     );
 end fifo;
 
@@ -25,7 +27,11 @@ architecture arch of fifo is
     type fifo_t is array (0 to 2**FIFO_DEPTH-1) of std_logic_vector(DATA_WIDTH-1 downto 0);
     signal mem : fifo_t;
 
-    signal rdp, wrp : unsigned(FIFO_DEPTH downto 0) := (others => '0');
+    -- rdp points one before the next word to read, so an empty FIFO has
+    -- rdp = wrp - 1: reset leaves it empty rather than holding a full
+    -- memory of stale words
+    signal wrp : unsigned(FIFO_DEPTH downto 0) := (others => '0');
+    signal rdp : unsigned(FIFO_DEPTH downto 0) := (others => '1');
     signal int_rdp : unsigned(FIFO_DEPTH-1 downto 0);
     signal int_wrp : unsigned(FIFO_DEPTH-1 downto 0);
 
@@ -61,10 +67,14 @@ begin
     int_wrp <= wrp(FIFO_DEPTH-1 downto 0);
     dout <= mem(to_integer(int_rdp));
 
+    -- Fill level and words discarded by the full FIFO, for stream_telemetry
+    level <= std_logic_vector(wrp(FIFO_DEPTH-1 downto 0) - rdp(FIFO_DEPTH-1 downto 0) - 1);
+    drop <= sig_full and not (rd and not sig_empty);
+
     process(clkr) begin 
         if rising_edge(clkr) then
             if rst = '1' then
-                rdp <= (others => '0');
+                rdp <= (others => '1');
             else
                 if (rd = '1' and sig_empty = '0') or sig_full = '1' then
                     rdp <= rdp + 1;
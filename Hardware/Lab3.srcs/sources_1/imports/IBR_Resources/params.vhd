@@ -39,7 +39,9 @@ package aud_param is
             din     : in  std_logic_vector(DATA_WIDTH-1 downto 0);
             empty   : out std_logic;
             full    : out std_logic;
-            dout    : out std_logic_vector(DATA_WIDTH-1 downto 0)
+            dout    : out std_logic_vector(DATA_WIDTH-1 downto 0);
+            level   : out std_logic_vector(FIFO_DEPTH-1 downto 0);
+            drop    : out std_logic
         );
     end component;
    
@@ -68,7 +70,15 @@ package aud_param is
             axis_tdata      : out std_logic_vector(DATA_WIDTH-1 downto 0);
             axis_tvalid     : out std_logic;
             axis_tready     : in  std_logic;
-            axis_tlast      : out std_logic
+            axis_tlast      : out std_logic;
+
+            --------------------------------------------------
+            -- AXI4-Stream, 4:1 decimated analysis samples
+            --------------------------------------------------
+            axis_dec_tdata  : out std_logic_vector(DATA_WIDTH-1 downto 0);
+            axis_dec_tvalid : out std_logic;
+            axis_dec_tready : in  std_logic := '0';
+            axis_dec_tlast  : out std_logic
         );
     end component;
     
@@ -77,6 +87,10 @@ package aud_param is
             ------------------------------------------------
             -- Control bus parameters
             ------------------------------------------------
+            -- Reset values of the parameter registers 4 .. 6
+            C_PARAM0_RESET	: std_logic_vector(31 downto 0)	:= x"00000000";
+            C_PARAM1_RESET	: std_logic_vector(31 downto 0)	:= x"00000000";
+            C_PARAM2_RESET	: std_logic_vector(31 downto 0)	:= x"00000000";
     
             ------------------------------------------------
             -- AXI Lite parameters
@@ -93,6 +107,10 @@ package aud_param is
             cb_control_reg      : out std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
             cb_status_reg       : in  std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
             cb_gain_reg         : out std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
+            cb_param0_reg       : out std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
+            cb_param1_reg       : out std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
+            cb_param2_reg       : out std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
+            cb_param3_reg       : out std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
     
             ------------------------------------------------
             -- AXI Lite signals
@@ -19,6 +19,19 @@
 ----------------------------------------------------------------------------------
 ----------------------------------------------------------------------------------
 -- amplifier_pipeline : DMA MM2S AXI-Stream -> FIFO -> I2S transmitter (speaker)
+--
+-- With control bit 3 (FIR) or 4 (dynamics) set, speaker_dsp sits between the
+-- FIFO and the transmitter. Parameter registers:
+--   reg4 (0x10)  FIR taps, see fir4_lowpass
+--   reg5 (0x14)  15:0 gate level, 31:16 boost level
+--   reg6 (0x18)  15:0 compression level, 19:16 boost shift, 23:20 compression
+--                shift, 27:24 envelope attack shift, 31:28 release shift
+--   reg7 (0x1C)  telemetry: 2:0 counter read back through the status
+--                register (stream_telemetry), 31 clear. Counts the words the
+--                DMA wrote into the FIFO, the FIFO's highest fill level, the
+--                transmitter's reads of an empty FIFO (underruns) and the
+--                cycles the full FIFO held off the DMA.
+-- Levels are bits 23:8 of the 24-bit envelope magnitude.
 ----------------------------------------------------------------------------------
 library ieee;
 use ieee.std_logic_1164.all;
@@ -92,7 +105,16 @@ architecture Behavioral of amplifier_pipeline is
     signal sig_control_reg    : std_logic_vector(DATA_WIDTH-1 downto 0);
     signal sig_status_reg     : std_logic_vector(DATA_WIDTH-1 downto 0);
     signal sig_gain_reg       : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal sig_fir_reg        : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal sig_level_reg      : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal sig_dyn_reg        : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal sig_telemetry_reg  : std_logic_vector(DATA_WIDTH-1 downto 0);
     signal sig_speaker_enable : std_logic := '0';   -- bit 0 (unused for now)
+    signal sig_mono           : std_logic;          -- bit 1: one sample per LR frame
+    signal sig_pack16         : std_logic;          -- bit 2: two 16-bit samples per word
+    signal sig_fir_en         : std_logic;          -- bit 3: FIR on the speaker stream
+    signal sig_dyn_en         : std_logic;          -- bit 4: gate/boost/compression
+    signal sig_dsp_en         : std_logic;
 
     --------------------------------------------------
     -- FIFO (AXIS -> FIFO -> I2S)
@@ -104,23 +126,40 @@ architecture Behavioral of amplifier_pipeline is
     signal fifo_empty_s   : std_logic;
     signal fifo_din_s     : std_logic_vector(DATA_WIDTH-1 downto 0);
     signal fifo_dout_s    : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal fifo_level_s   : std_logic_vector(FIFO_DEPTH downto 0);
+    signal fifo_drop_s    : std_logic;
 
     signal axis_tready_s_int : std_logic;
 
+    --------------------------------------------------
+    -- Transmitter feed: the FIFO itself, or speaker_dsp
+    --------------------------------------------------
+    signal tx_data_s      : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal tx_rd_s        : std_logic;
+    signal tx_empty_s     : std_logic;
+    signal dsp_rd_s       : std_logic;
+    signal dsp_data_s     : std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal dsp_empty_s    : std_logic;
+
+    --------------------------------------------------
+    -- Telemetry
+    --------------------------------------------------
+    signal tx_underrun_s  : std_logic;
+    signal axis_stall_s   : std_logic;
+    signal stats_clr_s    : std_logic;
+
     -- internal copy of BCLK so we can use it as FIFO read clock and drive the pin
     signal i2s_bclk_int  : std_logic;
 
 begin
-    ----------------------------------------------------------------
-    -- Status constant
-    ----------------------------------------------------------------
-    sig_status_reg <= x"0CA7CAFE";
-
     ----------------------------------------------------------------
     -- AXI-Lite control interface
     ----------------------------------------------------------------
     inst_ctrl_bus : ctrl_bus
     generic map(
+        C_PARAM0_RESET     => x"01030301",   -- [1,3,3,1]/8 low-pass
+        C_PARAM1_RESET     => x"04000080",   -- boost below 2^18, gate below 2^15
+        C_PARAM2_RESET     => x"63111000",   -- compress above 2^20, x2 / 2, attack 2^-3, release 2^-6
         C_S_AXI_DATA_WIDTH => C_S00_AXI_DATA_WIDTH,
         C_S_AXI_ADDR_WIDTH => C_S00_AXI_ADDR_WIDTH
     )
@@ -128,6 +167,10 @@ begin
         cb_control_reg => sig_control_reg,
         cb_status_reg  => sig_status_reg,
         cb_gain_reg    => sig_gain_reg,
+        cb_param0_reg  => sig_fir_reg,
+        cb_param1_reg  => sig_level_reg,
+        cb_param2_reg  => sig_dyn_reg,
+        cb_param3_reg  => sig_telemetry_reg,
 
         S_AXI_ACLK     => s00_axi_aclk,
         S_AXI_ARESETN  => s00_axi_aresetn,
@@ -157,6 +200,16 @@ begin
     ----------------------------------------------------------------
     fifo_rst_s <= not rst;  -- rst is active-low at top level
 
+    ----------------------------------------------------------------
+    -- Stream format. MONO + PACK16 carries four channel slots per
+    -- stream word: a quarter of the DMA traffic of the L/R word stream.
+    ----------------------------------------------------------------
+    sig_mono   <= sig_control_reg(1);
+    sig_pack16 <= sig_control_reg(2);
+    sig_fir_en <= sig_control_reg(3);
+    sig_dyn_en <= sig_control_reg(4);
+    sig_dsp_en <= sig_fir_en or sig_dyn_en;
+
     ----------------------------------------------------------------
     -- AXI-Stream slave side (from DMA)
     ----------------------------------------------------------------
@@ -186,9 +239,50 @@ begin
         din   => fifo_din_s,
         dout  => fifo_dout_s,
         empty => fifo_empty_s,
-        full  => fifo_full_s
+        full  => fifo_full_s,
+
+        level => fifo_level_s,
+        drop  => fifo_drop_s
     );
 
+    ----------------------------------------------------------------
+    -- Speaker DSP. With both blocks off the transmitter drains the
+    -- FIFO directly, exactly as before.
+    ----------------------------------------------------------------
+    inst_speaker_dsp : entity work.speaker_dsp
+    generic map(
+        DATA_WIDTH => DATA_WIDTH
+    )
+    port map(
+        clk           => clk,
+        rst           => fifo_rst_s,
+        mono          => sig_mono,
+        pack16        => sig_pack16,
+        fir_en        => sig_fir_en,
+        dyn_en        => sig_dyn_en,
+
+        fir_coeffs    => sig_fir_reg,
+        gate_level    => sig_level_reg(15 downto 0),
+        boost_level   => sig_level_reg(31 downto 16),
+        comp_level    => sig_dyn_reg(15 downto 0),
+        boost_shift   => sig_dyn_reg(19 downto 16),
+        comp_shift    => sig_dyn_reg(23 downto 20),
+        attack_shift  => sig_dyn_reg(27 downto 24),
+        release_shift => sig_dyn_reg(31 downto 28),
+
+        fifo_data     => fifo_dout_s,
+        fifo_rd       => dsp_rd_s,
+        fifo_empty    => fifo_empty_s,
+
+        tx_data       => dsp_data_s,
+        tx_r_stb      => tx_rd_s,
+        tx_empty      => dsp_empty_s
+    );
+
+    fifo_rd_s  <= dsp_rd_s    when sig_dsp_en = '1' else tx_rd_s;
+    tx_data_s  <= dsp_data_s  when sig_dsp_en = '1' else fifo_dout_s;
+    tx_empty_s <= dsp_empty_s when sig_dsp_en = '1' else fifo_empty_s;
+
     ----------------------------------------------------------------
     -- I2S transmitter (drains FIFO)
     ----------------------------------------------------------------
@@ -201,17 +295,46 @@ begin
     port map(
         clk        => clk,
         rst        => fifo_rst_s,         -- active-high reset (same as FIFO)
+        mono       => sig_mono,
+        pack16     => sig_pack16,
 
         i2s_lrcl   => i2s_lrcl_speaker,
         i2s_din    => i2s_din_speaker,
         i2s_bclk   => i2s_bclk_int,
 
-        fifo_data  => fifo_dout_s,
-        fifo_r_stb => fifo_rd_s,
-        fifo_empty => fifo_empty_s
+        fifo_data  => tx_data_s,
+        fifo_r_stb => tx_rd_s,
+        fifo_empty => tx_empty_s,
+
+        underrun   => tx_underrun_s
     );
 
     -- Drive external BCLK pin from internal BCLK
     i2s_bclk_speaker <= i2s_bclk_int;
 
+    ----------------------------------------------------------------
+    -- Telemetry, read back through the status register (all 0 reads
+    -- the status constant as before)
+    ----------------------------------------------------------------
+    stats_clr_s     <= sig_telemetry_reg(31) or fifo_rst_s;
+    axis_stall_s    <= s_axis_tvalid and not axis_tready_s_int;
+
+    inst_telemetry : entity work.stream_telemetry
+    generic map(
+        LEVEL_WIDTH  => FIFO_DEPTH + 1
+    )
+    port map(
+        clk          => clk,
+        clear        => stats_clr_s,
+
+        word_stb     => fifo_wr_s,
+        drop_stb     => fifo_drop_s,
+        underrun_stb => tx_underrun_s,
+        stall        => axis_stall_s,
+        level        => unsigned(fifo_level_s),
+
+        sel          => sig_telemetry_reg(2 downto 0),
+        dout         => sig_status_reg
+    );
+
 end Behavioral;
@@ -0,0 +1,145 @@
+----------------------------------------------------------------------------------
+-- Company:
+-- Engineer:
+--
+-- Create Date:
+-- Design Name:
+-- Module Name: capture_decimator - rtl
+-- Project Name:
+-- Target Devices:
+-- Tool Versions:
+-- Description:
+--
+-- Dependencies:
+--
+-- Revision:
+-- Revision 0.01 - File Created
+-- Additional Comments:
+--
+----------------------------------------------------------------------------------
+-- capture_decimator : 4:1 anti-aliased decimation of the mic samples
+--
+-- A 32-tap windowed-sinc low-pass (Hamming, 5 kHz cut-off at 48 kHz: flat to
+-- 2 kHz, -6 dB at 5 kHz, below -57 dB from 8 kHz) evaluated on every fourth
+-- input sample only, so the output is the 12 kHz stream the pitch tracker
+-- needs. Like fir4_lowpass it is a tap delay line and a multiply-accumulate
+-- over fixed coefficients, but the taps are summed one per clock with a
+-- single multiplier: 32 clocks per output against ~8000 clocks between
+-- outputs at 100 MHz.
+--
+-- The output is 16-bit PCM, rounded and saturated from the 18-bit input
+-- scale, one y_valid pulse per output sample.
+----------------------------------------------------------------------------------
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity capture_decimator is
+    port (
+        clk     : in  std_logic;
+        rst     : in  std_logic;    -- active high synchronous reset
+
+        x_in    : in  signed(17 downto 0);
+        x_valid : in  std_logic;
+
+        y_out   : out std_logic_vector(15 downto 0);
+        y_valid : out std_logic
+    );
+end entity capture_decimator;
+
+architecture rtl of capture_decimator is
+
+    constant TAPS   : integer := 32;
+    constant FACTOR : integer := 4;
+
+    -- Q15 taps, sum 32768 (unity gain at DC)
+    type coeff_t is array (0 to TAPS-1) of integer;
+    constant COEFFS : coeff_t := (
+           -35,    -4,    50,   128,   192,   164,   -27,  -380,
+          -768,  -943,  -623,   371,  1991,  3922,  5658,  6688,
+          6688,  5658,  3922,  1991,   371,  -623,  -943,  -768,
+          -380,   -27,   164,   192,   128,    50,    -4,   -35
+    );
+
+    type ring_t is array (0 to TAPS-1) of signed(17 downto 0);
+    signal ring     : ring_t := (others => (others => '0'));
+    signal wr_ptr   : unsigned(4 downto 0) := (others => '0');   -- next slot to write
+    signal phase    : integer range 0 to FACTOR-1 := 0;
+
+    -- 18-bit sample x 16-bit tap, summed over 32 taps
+    constant ACC_WIDTH : integer := 18 + 16 + 5;
+    signal acc      : signed(ACC_WIDTH-1 downto 0) := (others => '0');
+    signal busy     : std_logic := '0';
+    signal tap      : integer range 0 to TAPS-1 := 0;
+    signal rd_ptr   : unsigned(4 downto 0) := (others => '0');   -- sample for this tap
+
+    signal y_s      : std_logic_vector(15 downto 0) := (others => '0');
+    signal valid_s  : std_logic := '0';
+
+    constant Y_MAX  : signed(ACC_WIDTH-1 downto 0) := to_signed(32767, ACC_WIDTH);
+    constant Y_MIN  : signed(ACC_WIDTH-1 downto 0) := to_signed(-32768, ACC_WIDTH);
+
+begin
+
+    process(clk)
+        variable sum    : signed(ACC_WIDTH-1 downto 0);
+        variable scaled : signed(ACC_WIDTH-1 downto 0);
+    begin
+        if rising_edge(clk) then
+            if rst = '1' then
+                ring    <= (others => (others => '0'));
+                wr_ptr  <= (others => '0');
+                phase   <= 0;
+                acc     <= (others => '0');
+                busy    <= '0';
+                tap     <= 0;
+                rd_ptr  <= (others => '0');
+                y_s     <= (others => '0');
+                valid_s <= '0';
+            else
+                valid_s <= '0';
+
+                -- tap delay line; every FACTOR-th sample starts an output
+                if x_valid = '1' then
+                    ring(to_integer(wr_ptr)) <= x_in;
+                    wr_ptr <= wr_ptr + 1;
+                    if phase = FACTOR-1 then
+                        phase  <= 0;
+                        busy   <= '1';
+                        tap    <= 0;
+                        rd_ptr <= wr_ptr;       -- newest sample first
+                        acc    <= (others => '0');
+                    else
+                        phase <= phase + 1;
+                    end if;
+                end if;
+
+                -- one tap per clock; the next input is thousands of clocks away
+                if busy = '1' and x_valid = '0' then
+                    sum := acc + resize(ring(to_integer(rd_ptr)) * to_signed(COEFFS(tap), 16), ACC_WIDTH);
+                    rd_ptr <= rd_ptr - 1;
+                    if tap = TAPS-1 then
+                        busy <= '0';
+                        -- 18-bit scale x Q15 -> 16-bit: drop 17 bits, rounding
+                        scaled := shift_right(sum + to_signed(2**16, ACC_WIDTH), 17);
+                        if scaled > Y_MAX then
+                            y_s <= std_logic_vector(resize(Y_MAX, 16));
+                        elsif scaled < Y_MIN then
+                            y_s <= std_logic_vector(resize(Y_MIN, 16));
+                        else
+                            y_s <= std_logic_vector(resize(scaled, 16));
+                        end if;
+                        valid_s <= '1';
+                    else
+                        tap <= tap + 1;
+                    end if;
+                    acc <= sum;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    y_out   <= y_s;
+    y_valid <= valid_s;
+
+end architecture rtl;
@@ -0,0 +1,161 @@
+----------------------------------------------------------------------------------
+-- fft_pipeline : DMA MM2S AXI-Stream -> Xilinx FFT IP -> DMA S2MM AXI-Stream
+--
+-- Each MM2S packet is one header beat followed by one frame of complex data.
+-- The header's low byte is handed to the FFT config channel (bit 0: 1 = forward,
+-- 0 = inverse); the data beats and the transformed frame pass straight through.
+--
+-- Expected xfft_0 configuration (see pv_pl_fft.h):
+--   Transform length 1024, fixed; Pipelined Streaming I/O
+--   Single-precision floating point, natural output order
+--   Config channel 8 bits (FWD_INV only), no XK_INDEX / status channel
+-- Data beats are 64 bits: real in bits 31:0, imag in bits 63:32.
+----------------------------------------------------------------------------------
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity fft_pipeline is
+    generic(
+        DATA_WIDTH : integer := 64
+    );
+    port(
+        -- Fabric clock & reset (same clock as the FFT DMA)
+        clk   : in  std_logic;
+        rst   : in  std_logic;       -- active low
+
+        --------------------------------------------------
+        -- AXI4-Stream slave from DMA MM2S (header + frame)
+        --------------------------------------------------
+        s_axis_tdata  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+        s_axis_tvalid : in  std_logic;
+        s_axis_tready : out std_logic;
+        s_axis_tlast  : in  std_logic;
+
+        --------------------------------------------------
+        -- AXI4-Stream master to DMA S2MM (spectrum / signal)
+        --------------------------------------------------
+        m_axis_tdata  : out std_logic_vector(DATA_WIDTH-1 downto 0);
+        m_axis_tvalid : out std_logic;
+        m_axis_tready : in  std_logic;
+        m_axis_tlast  : out std_logic;
+
+        --------------------------------------------------
+        -- Framing errors reported by the IP (sticky until reset)
+        --------------------------------------------------
+        frame_error   : out std_logic
+    );
+end fft_pipeline;
+
+architecture Behavioral of fft_pipeline is
+
+    component xfft_0
+        port(
+            aclk                        : in  std_logic;
+            aresetn                     : in  std_logic;
+            s_axis_config_tdata         : in  std_logic_vector(7 downto 0);
+            s_axis_config_tvalid        : in  std_logic;
+            s_axis_config_tready        : out std_logic;
+            s_axis_data_tdata           : in  std_logic_vector(63 downto 0);
+            s_axis_data_tvalid          : in  std_logic;
+            s_axis_data_tready          : out std_logic;
+            s_axis_data_tlast           : in  std_logic;
+            m_axis_data_tdata           : out std_logic_vector(63 downto 0);
+            m_axis_data_tvalid          : out std_logic;
+            m_axis_data_tready          : in  std_logic;
+            m_axis_data_tlast           : out std_logic;
+            event_frame_started         : out std_logic;
+            event_tlast_unexpected      : out std_logic;
+            event_tlast_missing         : out std_logic;
+            event_status_channel_halt   : out std_logic;
+            event_data_in_channel_halt  : out std_logic;
+            event_data_out_channel_halt : out std_logic
+        );
+    end component;
+
+    --------------------------------------------------
+    -- Header / data sequencing
+    --------------------------------------------------
+    type state_t is (ST_HEADER, ST_DATA);
+    signal state : state_t := ST_HEADER;
+
+    signal cfg_tvalid_s   : std_logic;
+    signal cfg_tready_s   : std_logic;
+    signal data_tvalid_s  : std_logic;
+    signal data_tready_s  : std_logic;
+
+    signal tlast_unexpected_s : std_logic;
+    signal tlast_missing_s    : std_logic;
+    signal frame_error_s      : std_logic := '0';
+
+begin
+    ----------------------------------------------------------------
+    -- Steer the input stream: first beat to config, the rest to data
+    ----------------------------------------------------------------
+    cfg_tvalid_s  <= s_axis_tvalid when state = ST_HEADER else '0';
+    data_tvalid_s <= s_axis_tvalid when state = ST_DATA   else '0';
+    s_axis_tready <= cfg_tready_s  when state = ST_HEADER else data_tready_s;
+
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if rst = '0' then
+                state <= ST_HEADER;
+            else
+                case state is
+                    when ST_HEADER =>
+                        if s_axis_tvalid = '1' and cfg_tready_s = '1' then
+                            state <= ST_DATA;
+                        end if;
+                    when ST_DATA =>
+                        if s_axis_tvalid = '1' and data_tready_s = '1' and s_axis_tlast = '1' then
+                            state <= ST_HEADER;
+                        end if;
+                end case;
+            end if;
+        end if;
+    end process;
+
+    ----------------------------------------------------------------
+    -- FFT core
+    ----------------------------------------------------------------
+    fft_inst : xfft_0
+    port map(
+        aclk                        => clk,
+        aresetn                     => rst,
+        s_axis_config_tdata         => s_axis_tdata(7 downto 0),
+        s_axis_config_tvalid        => cfg_tvalid_s,
+        s_axis_config_tready        => cfg_tready_s,
+        s_axis_data_tdata           => s_axis_tdata,
+        s_axis_data_tvalid          => data_tvalid_s,
+        s_axis_data_tready          => data_tready_s,
+        s_axis_data_tlast           => s_axis_tlast,
+        m_axis_data_tdata           => m_axis_tdata,
+        m_axis_data_tvalid          => m_axis_tvalid,
+        m_axis_data_tready          => m_axis_tready,
+        m_axis_data_tlast           => m_axis_tlast,
+        event_frame_started         => open,
+        event_tlast_unexpected      => tlast_unexpected_s,
+        event_tlast_missing         => tlast_missing_s,
+        event_status_channel_halt   => open,
+        event_data_in_channel_halt  => open,
+        event_data_out_channel_halt => open
+    );
+
+    ----------------------------------------------------------------
+    -- Sticky framing error (packet length does not match the IP)
+    ----------------------------------------------------------------
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if rst = '0' then
+                frame_error_s <= '0';
+            elsif tlast_unexpected_s = '1' or tlast_missing_s = '1' then
+                frame_error_s <= '1';
+            end if;
+        end if;
+    end process;
+
+    frame_error <= frame_error_s;
+
+end Behavioral;
@@ -38,7 +38,10 @@ entity fifo_speaker is
         dout  : out std_logic_vector(DATA_WIDTH-1 downto 0);
 
         empty : out std_logic;
-        full  : out std_logic
+        full  : out std_logic;
+
+        level : out std_logic_vector(FIFO_DEPTH downto 0);  -- words held (0 .. depth)
+        drop  : out std_logic   -- write refused because the FIFO is full
     );
 end fifo_speaker;
 
@@ -76,6 +79,9 @@ begin
 
     dout  <= dout_reg;
 
+    level <= std_logic_vector(wrp - rdp);
+    drop  <= wr and full_reg;
+
     --------------------------------------------------------------------
     -- Single-clock FIFO implementation
     -- Use clkw as the only real clock; clkr is ignored for now.
@@ -33,6 +33,10 @@ entity i2s_transmitter is
         clk        : in  std_logic;      -- fabric clock (same as FIFO / AXI)
         rst        : in  std_logic;      -- active-high synchronous reset
 
+        -- Stream format (static while playing)
+        mono       : in  std_logic;      -- 1 = one sample feeds both the L and R slot
+        pack16     : in  std_logic;      -- 1 = two 16-bit samples per FIFO word (bits 15:0 first)
+
         -- I²S outputs
         i2s_lrcl   : out std_logic;      -- 0 = Left, 1 = Right (word select)
         i2s_din    : out std_logic;      -- serial data (MSB first)
@@ -41,7 +45,9 @@ entity i2s_transmitter is
         -- FIFO interface (from speaker FIFO)
         fifo_data  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
         fifo_r_stb : out std_logic;      -- 1-cycle pulse to pop one word
-        fifo_empty : in  std_logic
+        fifo_empty : in  std_logic;
+
+        underrun   : out std_logic       -- 1-cycle pulse: a word was due and the FIFO was empty
     );
 end i2s_transmitter;
 
@@ -70,6 +76,14 @@ architecture rtl of i2s_transmitter is
     signal sample_buf  : std_logic_vector(DATA_WIDTH-1 downto 0) := (others => '0');
     signal i2s_din_reg : std_logic := '0';
 
+    ------------------------------------------------------------------------
+    -- Slot feeder: one FIFO word covers 1 (stereo), 2 (mono or pack16) or
+    -- 4 (mono + pack16) channel slots. Words are fetched on left slots only
+    -- in the shared modes, so a sample never straddles an LR frame.
+    ------------------------------------------------------------------------
+    signal hold_word   : std_logic_vector(DATA_WIDTH-1 downto 0) := (others => '0');
+    signal hold_half   : std_logic := '0';      -- mono + pack16: playing bits 31:16
+
 begin
 
     ------------------------------------------------------------------------
@@ -85,6 +99,10 @@ begin
     process (clk)
         variable new_channel : std_logic;
         variable idx_int     : integer;
+        variable left_slot   : boolean;
+        variable fetch       : boolean;
+        variable word        : std_logic_vector(DATA_WIDTH-1 downto 0);
+        variable use_hi      : boolean;
     begin
         if rising_edge(clk) then
             if rst = '1' then
@@ -101,8 +119,11 @@ begin
                 bit_idx     <= (others => '0');
                 msb_hold    <= '0';
                 sample_buf  <= (others => '0');
+                hold_word   <= (others => '0');
+                hold_half   <= '0';
 
                 fifo_r_stb  <= '0';
+                underrun    <= '0';
                 i2s_din_reg <= '0';
 
             else
@@ -110,6 +131,7 @@ begin
                 -- Default strobes
                 ----------------------------------------------------------------
                 fifo_r_stb <= '0';
+                underrun   <= '0';
                 bclk_rise  <= '0';
                 new_channel := '0';
 
@@ -153,11 +175,49 @@ begin
                         bit_idx  <= to_unsigned(DATA_WIDTH-1, bit_idx'length);
                         msb_hold <= '1';
 
-                        if fifo_empty = '0' then
-                            sample_buf <= fifo_data;
-                            fifo_r_stb <= '1';  -- one pop per channel frame
+                        -- lrclk still holds the old channel: '1' means a left slot starts
+                        left_slot := (lrclk = '1');
+                        if mono = '0' and pack16 = '0' then
+                            fetch := true;                  -- one pop per channel frame
+                        elsif mono = '1' and pack16 = '1' then
+                            fetch := left_slot and hold_half = '0';
+                        else
+                            fetch := left_slot;
+                        end if;
+
+                        if not fetch then
+                            word := hold_word;
+                        elsif fifo_empty = '0' then
+                            word := fifo_data;
+                            fifo_r_stb <= '1';
+                        else
+                            word := (others => '0');        -- underrun: silence
+                            underrun <= '1';
+                        end if;
+                        hold_word <= word;
+
+                        if pack16 = '0' then
+                            sample_buf <= word;
+                        else
+                            if mono = '1' then
+                                use_hi := (hold_half = '1');
+                            else
+                                use_hi := not left_slot;
+                            end if;
+                            -- 16-bit sample in the top half of the slot, as software used to send it
+                            if use_hi then
+                                sample_buf <= word(31 downto 16) & x"0000";
+                            else
+                                sample_buf <= word(15 downto 0) & x"0000";
+                            end if;
+                        end if;
+
+                        if mono = '1' and pack16 = '1' then
+                            if not left_slot then
+                                hold_half <= not hold_half;  -- both slots of a frame done
+                            end if;
                         else
-                            sample_buf <= (others => '0');
+                            hold_half <= '0';
                         end if;
 
                         -- Do NOT update i2s_din_reg here: enforce MSB delay
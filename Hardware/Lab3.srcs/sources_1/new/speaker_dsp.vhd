@@ -0,0 +1,276 @@
+----------------------------------------------------------------------------------
+-- Company: 
+-- Engineer: 
+-- 
+-- Create Date: 
+-- Design Name: 
+-- Module Name: speaker_dsp - rtl
+-- Project Name: 
+-- Target Devices: 
+-- Tool Versions: 
+-- Description: 
+-- 
+-- Dependencies: fir4_lowpass, envelope_follower, dynamics_core
+-- 
+-- Revision:
+-- Revision 0.01 - File Created
+-- Additional Comments:
+-- 
+----------------------------------------------------------------------------------
+-- speaker_dsp : speaker FIFO -> FIR -> envelope/dynamics -> I2S transmitter
+--
+-- Sits between fifo_speaker and i2s_transmitter and runs every sample of the
+-- speaker stream through the DSP_Hardware blocks in
+-- supporting_resources/DSP_Hardware: fir4_lowpass, then dynamics_core driven
+-- by envelope_follower. Stereo streams get one chain per channel, mono
+-- streams use channel 0 only.
+--
+-- A FIFO word is popped only when the previous result has been taken, its
+-- one or two samples (see i2s_transmitter for the word formats) are filtered,
+-- and the word is repacked in the same format and held for the transmitter
+-- first-word-fall-through style: tx_empty drops as soon as a word is ready
+-- and the transmitter's read strobe consumes it. A word takes about a dozen
+-- clocks, far inside a 48 kHz slot.
+--
+-- Samples are processed as 24-bit: bits 31:8 of an unpacked word, or a
+-- 16-bit half with eight zero bits below it. The level and shift inputs are
+-- in those units; they come straight from the AXI-Lite parameter registers
+-- and, like the stream format, should only change while the stream is idle.
+----------------------------------------------------------------------------------
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity speaker_dsp is
+    generic (
+        DATA_WIDTH : integer := 32
+    );
+    port (
+        clk        : in  std_logic;
+        rst        : in  std_logic;      -- active-high synchronous reset
+
+        -- Stream format (static while playing)
+        mono       : in  std_logic;
+        pack16     : in  std_logic;
+
+        -- Block enables: a disabled block passes samples through unchanged
+        fir_en     : in  std_logic;
+        dyn_en     : in  std_logic;
+
+        -- Parameters
+        fir_coeffs    : in  std_logic_vector(31 downto 0);  -- see fir4_lowpass
+        gate_level    : in  std_logic_vector(15 downto 0);  -- bits 23:8 of the 24-bit magnitude
+        boost_level   : in  std_logic_vector(15 downto 0);
+        comp_level    : in  std_logic_vector(15 downto 0);
+        boost_shift   : in  std_logic_vector(3 downto 0);
+        comp_shift    : in  std_logic_vector(3 downto 0);
+        attack_shift  : in  std_logic_vector(3 downto 0);
+        release_shift : in  std_logic_vector(3 downto 0);
+
+        -- From fifo_speaker (dout valid the cycle after a read)
+        fifo_data  : in  std_logic_vector(DATA_WIDTH-1 downto 0);
+        fifo_rd    : out std_logic;
+        fifo_empty : in  std_logic;
+
+        -- To i2s_transmitter
+        tx_data    : out std_logic_vector(DATA_WIDTH-1 downto 0);
+        tx_r_stb   : in  std_logic;
+        tx_empty   : out std_logic
+    );
+end speaker_dsp;
+
+architecture rtl of speaker_dsp is
+
+    constant SAMPLE_WIDTH : integer := 24;
+    constant FIR_PASS     : std_logic_vector(31 downto 0) := x"00000008";
+
+    type sample_array is array (0 to 1) of std_logic_vector(SAMPLE_WIDTH-1 downto 0);
+
+    type state_t is (S_IDLE, S_LOAD, S_RUN_LO, S_RUN_HI);
+    signal state      : state_t := S_IDLE;
+
+    signal coeffs_s   : std_logic_vector(31 downto 0);
+    signal gate_s     : unsigned(SAMPLE_WIDTH-1 downto 0);
+    signal boost_s    : unsigned(SAMPLE_WIDTH-1 downto 0);
+    signal comp_s     : unsigned(SAMPLE_WIDTH-1 downto 0);
+
+    -- Per-channel chains
+    signal x_in       : sample_array := (others => (others => '0'));
+    signal x_valid    : std_logic_vector(1 downto 0) := (others => '0');
+    signal fir_y      : sample_array;
+    signal fir_valid  : std_logic_vector(1 downto 0);
+    signal env        : sample_array;
+    signal dyn_y      : sample_array;
+    signal dyn_valid  : std_logic_vector(1 downto 0);
+    signal y          : sample_array;
+    signal y_valid    : std_logic_vector(1 downto 0);
+
+    signal rd_s       : std_logic;
+    signal ch_sel     : integer range 0 to 1 := 0;   -- unpacked stereo: channel of the next word
+    signal cur_ch     : integer range 0 to 1 := 0;
+    signal hold_hi    : std_logic_vector(15 downto 0) := (others => '0');
+    signal out_word   : std_logic_vector(DATA_WIDTH-1 downto 0) := (others => '0');
+    signal out_valid  : std_logic := '0';
+
+begin
+
+    coeffs_s <= fir_coeffs when fir_en = '1' else FIR_PASS;
+    gate_s   <= unsigned(gate_level) & x"00";
+    boost_s  <= unsigned(boost_level) & x"00";
+    comp_s   <= unsigned(comp_level) & x"00";
+
+    ----------------------------------------------------------------
+    -- One FIR -> envelope/dynamics chain per channel. The dynamics
+    -- stage sees the envelope up to the previous sample.
+    ----------------------------------------------------------------
+    gen_chain : for ch in 0 to 1 generate
+        inst_fir : entity work.fir4_lowpass
+        generic map(
+            SAMPLE_WIDTH => SAMPLE_WIDTH
+        )
+        port map(
+            clk     => clk,
+            rst     => rst,
+            coeffs  => coeffs_s,
+            x_in    => x_in(ch),
+            x_valid => x_valid(ch),
+            y_out   => fir_y(ch),
+            y_valid => fir_valid(ch)
+        );
+
+        inst_env : entity work.envelope_follower
+        generic map(
+            SAMPLE_WIDTH => SAMPLE_WIDTH
+        )
+        port map(
+            clk           => clk,
+            rst           => rst,
+            attack_shift  => unsigned(attack_shift),
+            release_shift => unsigned(release_shift),
+            x_in          => fir_y(ch),
+            x_valid       => fir_valid(ch),
+            env_out       => env(ch),
+            env_valid     => open
+        );
+
+        inst_dyn : entity work.dynamics_core
+        generic map(
+            SAMPLE_WIDTH => SAMPLE_WIDTH
+        )
+        port map(
+            clk         => clk,
+            rst         => rst,
+            gate_level  => gate_s,
+            boost_level => boost_s,
+            comp_level  => comp_s,
+            boost_shift => unsigned(boost_shift),
+            comp_shift  => unsigned(comp_shift),
+            x_in        => fir_y(ch),
+            env_in      => env(ch),
+            x_valid     => fir_valid(ch),
+            y_out       => dyn_y(ch),
+            y_valid     => dyn_valid(ch)
+        );
+
+        y(ch)       <= dyn_y(ch)     when dyn_en = '1' else fir_y(ch);
+        y_valid(ch) <= dyn_valid(ch) when dyn_en = '1' else fir_valid(ch);
+    end generate;
+
+    ----------------------------------------------------------------
+    -- FIFO side: pop when idle, nothing is waiting for the
+    -- transmitter and there is a word to pop
+    ----------------------------------------------------------------
+    rd_s    <= '1' when state = S_IDLE and out_valid = '0' and fifo_empty = '0' else '0';
+    fifo_rd <= rd_s;
+
+    tx_data  <= out_word;
+    tx_empty <= not out_valid;
+
+    process (clk)
+        variable word : std_logic_vector(DATA_WIDTH-1 downto 0);
+    begin
+        if rising_edge(clk) then
+            if rst = '1' then
+                state     <= S_IDLE;
+                x_in      <= (others => (others => '0'));
+                x_valid   <= (others => '0');
+                ch_sel    <= 0;
+                cur_ch    <= 0;
+                hold_hi   <= (others => '0');
+                out_word  <= (others => '0');
+                out_valid <= '0';
+            else
+                x_valid <= (others => '0');
+
+                if tx_r_stb = '1' then
+                    out_valid <= '0';
+                end if;
+
+                case state is
+                    when S_IDLE =>
+                        if rd_s = '1' then
+                            state <= S_LOAD;
+                        end if;
+
+                    when S_LOAD =>
+                        -- fifo_data holds the popped word from this cycle on
+                        word := fifo_data;
+                        if pack16 = '0' then
+                            if mono = '0' then
+                                cur_ch <= ch_sel;
+                                ch_sel <= 1 - ch_sel;
+                            else
+                                cur_ch <= 0;
+                            end if;
+                            x_in(0) <= word(31 downto 8);
+                            x_in(1) <= word(31 downto 8);
+                            if mono = '0' and ch_sel = 1 then
+                                x_valid <= "10";
+                            else
+                                x_valid <= "01";
+                            end if;
+                        elsif mono = '0' then
+                            -- left in bits 15:0, right in 31:16, filtered together
+                            cur_ch  <= 0;
+                            x_in(0) <= word(15 downto 0) & x"00";
+                            x_in(1) <= word(31 downto 16) & x"00";
+                            x_valid <= "11";
+                        else
+                            -- two mono samples, one after the other
+                            cur_ch  <= 0;
+                            x_in(0) <= word(15 downto 0) & x"00";
+                            hold_hi <= word(31 downto 16);
+                            x_valid <= "01";
+                        end if;
+                        state <= S_RUN_LO;
+
+                    when S_RUN_LO =>
+                        if y_valid(cur_ch) = '1' then
+                            if pack16 = '0' then
+                                out_word  <= y(cur_ch) & x"00";
+                                out_valid <= '1';
+                                state     <= S_IDLE;
+                            elsif mono = '0' then
+                                out_word  <= y(1)(23 downto 8) & y(0)(23 downto 8);
+                                out_valid <= '1';
+                                state     <= S_IDLE;
+                            else
+                                out_word(15 downto 0) <= y(0)(23 downto 8);
+                                x_in(0) <= hold_hi & x"00";
+                                x_valid <= "01";
+                                state   <= S_RUN_HI;
+                            end if;
+                        end if;
+
+                    when S_RUN_HI =>
+                        if y_valid(0) = '1' then
+                            out_word(31 downto 16) <= y(0)(23 downto 8);
+                            out_valid <= '1';
+                            state     <= S_IDLE;
+                        end if;
+                end case;
+            end if;
+        end if;
+    end process;
+
+end rtl;
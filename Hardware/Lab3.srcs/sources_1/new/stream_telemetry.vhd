@@ -0,0 +1,112 @@
+----------------------------------------------------------------------------------
+-- Company:
+-- Engineer:
+--
+-- Create Date:
+-- Design Name:
+-- Module Name: stream_telemetry - rtl
+-- Project Name:
+-- Target Devices:
+-- Tool Versions:
+-- Description:
+--
+-- Dependencies:
+--
+-- Revision:
+-- Revision 0.01 - File Created
+-- Additional Comments:
+--
+----------------------------------------------------------------------------------
+-- stream_telemetry : free-running counters on one FIFO / AXIS path
+--
+-- Counts the words written into the path's FIFO, the words the FIFO lost
+-- (drop_stb), the reads the consumer found empty (underrun_stb) and the
+-- cycles the AXIS side was stalled (stall), and keeps the highest FIFO fill
+-- level seen. The counters are 32 bits and wrap; clear holds them all at
+-- zero.
+--
+-- dout is the word picked by sel, read back through cb_status_reg:
+--   0  IDENT      (the status constant the register always returned)
+--   1  words      written into the FIFO
+--   2  drops      words the FIFO lost
+--   3  underruns  reads that found the FIFO empty
+--   4  high water highest fill level, in words
+--   5  stalls     cycles with tvalid high and tready low
+--   6  reserved   reads 0
+--   7  TELEMETRY_ID, so software can tell the counters are there
+----------------------------------------------------------------------------------
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity stream_telemetry is
+    generic (
+        LEVEL_WIDTH  : positive := 13;
+        IDENT        : std_logic_vector(31 downto 0) := x"0CA7CAFE";
+        TELEMETRY_ID : std_logic_vector(31 downto 0) := x"7E1E0001"
+    );
+    port (
+        clk          : in  std_logic;
+        clear        : in  std_logic;    -- active high synchronous
+
+        word_stb     : in  std_logic;    -- one word into the FIFO
+        drop_stb     : in  std_logic;    -- one word lost
+        underrun_stb : in  std_logic;    -- one read of an empty FIFO
+        stall        : in  std_logic;    -- AXIS tvalid and not tready
+        level        : in  unsigned(LEVEL_WIDTH-1 downto 0);
+
+        sel          : in  std_logic_vector(2 downto 0);
+        dout         : out std_logic_vector(31 downto 0)
+    );
+end entity stream_telemetry;
+
+architecture rtl of stream_telemetry is
+
+    signal cnt_words    : unsigned(31 downto 0) := (others => '0');
+    signal cnt_drops    : unsigned(31 downto 0) := (others => '0');
+    signal cnt_underrun : unsigned(31 downto 0) := (others => '0');
+    signal cnt_stall    : unsigned(31 downto 0) := (others => '0');
+    signal high_water   : unsigned(LEVEL_WIDTH-1 downto 0) := (others => '0');
+
+begin
+
+    process (clk)
+    begin
+        if rising_edge(clk) then
+            if clear = '1' then
+                cnt_words    <= (others => '0');
+                cnt_drops    <= (others => '0');
+                cnt_underrun <= (others => '0');
+                cnt_stall    <= (others => '0');
+                high_water   <= (others => '0');
+            else
+                if word_stb = '1' then
+                    cnt_words <= cnt_words + 1;
+                end if;
+                if drop_stb = '1' then
+                    cnt_drops <= cnt_drops + 1;
+                end if;
+                if underrun_stb = '1' then
+                    cnt_underrun <= cnt_underrun + 1;
+                end if;
+                if stall = '1' then
+                    cnt_stall <= cnt_stall + 1;
+                end if;
+                if level > high_water then
+                    high_water <= level;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    with sel select dout <=
+        IDENT                                       when "000",
+        std_logic_vector(cnt_words)                 when "001",
+        std_logic_vector(cnt_drops)                 when "010",
+        std_logic_vector(cnt_underrun)              when "011",
+        std_logic_vector(resize(high_water, 32))    when "100",
+        std_logic_vector(cnt_stall)                 when "101",
+        TELEMETRY_ID                                when "111",
+        (others => '0')                             when others;
+
+end architecture rtl;
@@ -0,0 +1,457 @@
+----------------------------------------------------------------------------------
+-- yin_diff : YIN difference function d(tau) computed on the capture stream
+--
+-- Taps the audio_pipeline AXI-Stream (it only watches tvalid/tready, it never
+-- stalls the stream) and keeps, for the newest 2*HALF samples,
+--   d(tau) = sum over i < HALF of (x[s+i] - x[s+i+tau])^2,  tau < TAU_MAX
+-- up to date with the same exact sliding update as YinTracker.c: for every new
+-- sample each lag gains the term that enters the window and loses the one that
+-- leaves it, one lag per clock (two DSP multipliers), so a pass takes about
+-- TAU_MAX + 8 cycles against ~2000 cycles per sample at 100 MHz / 48 kHz.
+--
+-- Every HOP samples the pass also writes d into a snapshot bank that the CPU
+-- reads through the AXI4-Lite window below; SNAP_COUNT increments after the
+-- bank is complete, so a reader that sees the same count before and after its
+-- reads has a consistent frame. The sample conversion matches the capture loop
+-- in helloworld.c (bits 17:2 of the 32-bit word, bit-reversed).
+--
+-- AXI4-Lite map (same clock as the stream):
+--   0x0000 CONTROL     rw  bit 0 enable, bit 1 clear (write 1; self-clearing)
+--   0x0004 STATUS      ro  bit 0 clearing, bit 1 overrun (sample lost, sticky)
+--   0x0008 HALF        rw  terms per lag (window = 2 * HALF), 2 .. 2**HALF_LOG2
+--   0x000C TAU_MAX     rw  lags computed, 1 .. HALF
+--   0x0010 HOP         rw  samples between snapshots, >= 1
+--   0x0014 SNAP_COUNT  ro  snapshots completed
+--   0x0018 SAMPLES     ro  samples accepted since the last clear
+--   0x001C ID          ro  0x59494E31 ("YIN1")
+--   0x2000 + 8*tau     ro  snapshot d(tau) bits 31:0; +4: bits 47:32 sign-extended
+-- HALF and TAU_MAX only take effect cleanly after a clear.
+-- Driver: audio_tuner_software/src/YinPL.c
+----------------------------------------------------------------------------------
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity yin_diff is
+    generic(
+        HALF_LOG2          : integer := 10;    -- Largest HALF is 2**HALF_LOG2
+        BIT_REVERSE        : boolean := true;  -- Mirror swap_bits_u16 in the capture loop
+        C_S_AXI_DATA_WIDTH : integer := 32;
+        C_S_AXI_ADDR_WIDTH : integer := 14
+    );
+    port(
+        clk   : in  std_logic;
+        rst   : in  std_logic;       -- active low
+
+        --------------------------------------------------
+        -- Tap on the capture AXI-Stream (inputs only)
+        --------------------------------------------------
+        tap_tdata     : in  std_logic_vector(31 downto 0);
+        tap_tvalid    : in  std_logic;
+        tap_tready    : in  std_logic;
+
+        --------------------------------------------------
+        -- Control / result interface (AXI4-Lite)
+        --------------------------------------------------
+        s_axi_awaddr  : in  std_logic_vector(C_S_AXI_ADDR_WIDTH-1 downto 0);
+        s_axi_awprot  : in  std_logic_vector(2 downto 0);
+        s_axi_awvalid : in  std_logic;
+        s_axi_awready : out std_logic;
+        s_axi_wdata   : in  std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
+        s_axi_wstrb   : in  std_logic_vector((C_S_AXI_DATA_WIDTH/8)-1 downto 0);
+        s_axi_wvalid  : in  std_logic;
+        s_axi_wready  : out std_logic;
+        s_axi_bresp   : out std_logic_vector(1 downto 0);
+        s_axi_bvalid  : out std_logic;
+        s_axi_bready  : in  std_logic;
+        s_axi_araddr  : in  std_logic_vector(C_S_AXI_ADDR_WIDTH-1 downto 0);
+        s_axi_arprot  : in  std_logic_vector(2 downto 0);
+        s_axi_arvalid : in  std_logic;
+        s_axi_arready : out std_logic;
+        s_axi_rdata   : out std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0);
+        s_axi_rresp   : out std_logic_vector(1 downto 0);
+        s_axi_rvalid  : out std_logic;
+        s_axi_rready  : in  std_logic
+    );
+end yin_diff;
+
+architecture Behavioral of yin_diff is
+
+    constant RING_LOG2 : integer := HALF_LOG2 + 2;    -- Ring holds > 2 * HALF_MAX samples
+    constant D_WIDTH   : integer := 48;               -- |d| < 2**HALF_LOG2 * 2**32
+
+    subtype sample_t is signed(15 downto 0);
+    subtype d_t is signed(D_WIDTH-1 downto 0);
+    type ring_t is array (0 to 2**RING_LOG2 - 1) of sample_t;
+    type d_ram_t is array (0 to 2**HALF_LOG2 - 1) of d_t;
+
+    --------------------------------------------------
+    -- Memories (all simple dual port; the ring is kept twice so the leaving
+    -- and entering samples of a lag can be read in the same cycle)
+    --------------------------------------------------
+    signal ring_lo   : ring_t := (others => (others => '0'));
+    signal ring_hi   : ring_t := (others => (others => '0'));
+    signal d_live    : d_ram_t := (others => (others => '0'));
+    signal d_snap    : d_ram_t := (others => (others => '0'));
+
+    signal ring_we   : std_logic := '0';
+    signal ring_wa   : unsigned(RING_LOG2-1 downto 0) := (others => '0');
+    signal ring_wd   : sample_t := (others => '0');
+    signal ring_ra_lo, ring_ra_hi : unsigned(RING_LOG2-1 downto 0) := (others => '0');
+    signal ring_q_lo, ring_q_hi   : sample_t := (others => '0');
+
+    signal live_we   : std_logic := '0';
+    signal live_wa   : unsigned(HALF_LOG2-1 downto 0) := (others => '0');
+    signal live_wd   : d_t := (others => '0');
+    signal live_ra   : unsigned(HALF_LOG2-1 downto 0) := (others => '0');
+    signal live_q    : d_t := (others => '0');
+
+    signal snap_we   : std_logic := '0';
+    signal snap_ra   : unsigned(HALF_LOG2-1 downto 0) := (others => '0');
+    signal snap_q    : d_t := (others => '0');
+
+    --------------------------------------------------
+    -- Registers
+    --------------------------------------------------
+    signal reg_enable   : std_logic := '0';
+    signal reg_clear    : std_logic := '0';
+    signal reg_half     : unsigned(HALF_LOG2 downto 0) := to_unsigned(512, HALF_LOG2 + 1);
+    signal reg_tau_max  : unsigned(HALF_LOG2 downto 0) := to_unsigned(512, HALF_LOG2 + 1);
+    signal reg_hop      : unsigned(15 downto 0) := to_unsigned(256, 16);
+    signal snap_count   : unsigned(31 downto 0) := (others => '0');
+    signal sample_count : unsigned(31 downto 0) := (others => '0');
+    signal overrun      : std_logic := '0';
+
+    --------------------------------------------------
+    -- Engine
+    --------------------------------------------------
+    type state_t is (ST_CLEAR, ST_IDLE, ST_WRITE, ST_EDGE, ST_EDGE_WAIT, ST_LOOP, ST_DRAIN);
+    signal state     : state_t := ST_CLEAR;
+    signal clear_idx : unsigned(RING_LOG2-1 downto 0) := (others => '0');
+    signal pcm       : sample_t := (others => '0');
+    signal start     : unsigned(RING_LOG2-1 downto 0) := (others => '0');
+    signal tau       : unsigned(HALF_LOG2 downto 0) := (others => '0');
+    signal hop_cnt   : unsigned(15 downto 0) := (others => '0');
+    signal snap_pass : std_logic := '0';
+    signal edge_a    : sample_t := (others => '0');    -- x[s]: leaves every lag
+    signal edge_b    : sample_t := (others => '0');    -- x[s + HALF]: enters every lag
+
+    -- Lag pipeline: addresses, RAM read, differences, squares, accumulate + write
+    signal v0, v1, v2, v3 : std_logic := '0';
+    signal t0, t1, t2, t3 : unsigned(HALF_LOG2-1 downto 0) := (others => '0');
+    signal out1, in1  : signed(16 downto 0) := (others => '0');
+    signal out2, in2  : signed(33 downto 0) := (others => '0');
+    signal d1, d2     : d_t := (others => '0');
+
+    --------------------------------------------------
+    -- AXI4-Lite
+    --------------------------------------------------
+    signal axi_awready, axi_wready, axi_bvalid : std_logic := '0';
+    signal axi_arready, axi_rvalid             : std_logic := '0';
+    signal axi_rdata : std_logic_vector(C_S_AXI_DATA_WIDTH-1 downto 0) := (others => '0');
+    signal rd_addr   : std_logic_vector(C_S_AXI_ADDR_WIDTH-1 downto 0) := (others => '0');
+    signal rd_wait   : std_logic := '0';
+
+    signal sample_stb : std_logic;
+
+    function to_pcm(w : std_logic_vector(31 downto 0)) return sample_t is
+        variable s : std_logic_vector(15 downto 0);
+    begin
+        s := w(17 downto 2);
+        if BIT_REVERSE then
+            for k in 0 to 15 loop
+                s(15 - k) := w(2 + k);
+            end loop;
+        end if;
+        return signed(s);
+    end function;
+
+begin
+
+    sample_stb <= tap_tvalid and tap_tready;
+
+    --------------------------------------------------
+    -- Memories
+    --------------------------------------------------
+    process (clk)
+    begin
+        if rising_edge(clk) then
+            if ring_we = '1' then
+                ring_lo(to_integer(ring_wa)) <= ring_wd;
+                ring_hi(to_integer(ring_wa)) <= ring_wd;
+            end if;
+            ring_q_lo <= ring_lo(to_integer(ring_ra_lo));
+            ring_q_hi <= ring_hi(to_integer(ring_ra_hi));
+
+            if live_we = '1' then
+                d_live(to_integer(live_wa)) <= live_wd;
+            end if;
+            live_q <= d_live(to_integer(live_ra));
+
+            if snap_we = '1' then
+                d_snap(to_integer(live_wa)) <= live_wd;
+            end if;
+            snap_q <= d_snap(to_integer(snap_ra));
+        end if;
+    end process;
+
+    --------------------------------------------------
+    -- Engine: one pass over the lags per accepted sample
+    --------------------------------------------------
+    process (clk)
+        variable nxt : unsigned(31 downto 0);
+    begin
+        if rising_edge(clk) then
+            ring_we <= '0';
+            live_we <= '0';
+            snap_we <= '0';
+
+            if rst = '0' then
+                state        <= ST_CLEAR;
+                clear_idx    <= (others => '0');
+                sample_count <= (others => '0');
+                snap_count   <= (others => '0');
+                hop_cnt      <= (others => '0');
+                overrun      <= '0';
+                v0 <= '0'; v1 <= '0'; v2 <= '0'; v3 <= '0';
+            else
+                -- A sample that arrives mid-pass is lost (cannot happen at audio rates)
+                if sample_stb = '1' and reg_enable = '1' and state /= ST_IDLE then
+                    overrun <= '1';
+                end if;
+
+                case state is
+                    when ST_CLEAR =>
+                        -- Zero history and d, so the recursion starts exact
+                        ring_we <= '1';
+                        ring_wa <= clear_idx;
+                        ring_wd <= (others => '0');
+                        live_we <= '1';
+                        live_wa <= clear_idx(HALF_LOG2-1 downto 0);
+                        live_wd <= (others => '0');
+                        clear_idx <= clear_idx + 1;
+                        if clear_idx = 2**RING_LOG2 - 1 then
+                            sample_count <= (others => '0');
+                            hop_cnt      <= (others => '0');
+                            overrun      <= '0';
+                            state        <= ST_IDLE;
+                        end if;
+
+                    when ST_IDLE =>
+                        if reg_clear = '1' then
+                            clear_idx <= (others => '0');
+                            state     <= ST_CLEAR;
+                        elsif sample_stb = '1' and reg_enable = '1' then
+                            pcm   <= to_pcm(tap_tdata);
+                            state <= ST_WRITE;
+                        end if;
+
+                    when ST_WRITE =>
+                        ring_we <= '1';
+                        ring_wa <= sample_count(RING_LOG2-1 downto 0);
+                        ring_wd <= pcm;
+                        nxt := sample_count + 1;
+                        sample_count <= nxt;
+                        -- Old window start: newest sample is at s + 2*HALF and is not used yet
+                        start <= resize(nxt - 1 - shift_left(resize(reg_half, 32), 1), RING_LOG2);
+                        if hop_cnt = reg_hop - 1 then
+                            hop_cnt   <= (others => '0');
+                            snap_pass <= '1';
+                        else
+                            hop_cnt   <= hop_cnt + 1;
+                            snap_pass <= '0';
+                        end if;
+                        state <= ST_EDGE;
+
+                    when ST_EDGE =>
+                        ring_ra_lo <= start;
+                        ring_ra_hi <= start + resize(reg_half, RING_LOG2);
+                        state <= ST_EDGE_WAIT;
+
+                    when ST_EDGE_WAIT =>
+                        state <= ST_LOOP;
+                        tau   <= (others => '0');
+
+                    when ST_LOOP =>
+                        if tau = 0 then
+                            edge_a <= ring_q_lo;
+                            edge_b <= ring_q_hi;
+                        end if;
+                        if tau < reg_tau_max then
+                            ring_ra_lo <= start + resize(tau, RING_LOG2);
+                            ring_ra_hi <= start + resize(reg_half, RING_LOG2) + resize(tau, RING_LOG2);
+                            live_ra    <= tau(HALF_LOG2-1 downto 0);
+                            tau        <= tau + 1;
+                        else
+                            state <= ST_DRAIN;
+                        end if;
+
+                    when ST_DRAIN =>
+                        if v0 = '0' and v1 = '0' and v2 = '0' and v3 = '0' then
+                            if snap_pass = '1' then
+                                snap_count <= snap_count + 1;
+                            end if;
+                            state <= ST_IDLE;
+                        end if;
+                end case;
+
+                -- Stage 0: addresses are registered; stage 1: the RAMs return the data
+                if state = ST_LOOP and tau < reg_tau_max then
+                    v0 <= '1';
+                    t0 <= tau(HALF_LOG2-1 downto 0);
+                else
+                    v0 <= '0';
+                end if;
+                v1 <= v0;
+                t1 <= t0;
+
+                -- Stage 2: differences (17 bits) against the two edge samples
+                v2 <= v1;
+                t2 <= t1;
+                if v1 = '1' then
+                    out1 <= resize(edge_a, 17) - resize(ring_q_lo, 17);
+                    in1  <= resize(edge_b, 17) - resize(ring_q_hi, 17);
+                    d1   <= live_q;
+                end if;
+
+                -- Stage 3: squares
+                v3 <= v2;
+                t3 <= t2;
+                if v2 = '1' then
+                    out2 <= out1 * out1;
+                    in2  <= in1 * in1;
+                    d2   <= d1;
+                end if;
+
+                -- Stage 4: d(tau) += entering^2 - leaving^2, into the live bank
+                -- (and the snapshot bank on the last sample of a hop)
+                if v3 = '1' then
+                    live_we <= '1';
+                    snap_we <= snap_pass;
+                    live_wa <= t3;
+                    live_wd <= d2 + resize(in2, D_WIDTH) - resize(out2, D_WIDTH);
+                end if;
+            end if;
+        end if;
+    end process;
+
+    --------------------------------------------------
+    -- AXI4-Lite write channel
+    --------------------------------------------------
+    s_axi_awready <= axi_awready;
+    s_axi_wready  <= axi_wready;
+    s_axi_bvalid  <= axi_bvalid;
+    s_axi_bresp   <= "00";
+
+    process (clk)
+        variable a : integer;
+    begin
+        if rising_edge(clk) then
+            if rst = '0' then
+                axi_awready <= '0';
+                axi_wready  <= '0';
+                axi_bvalid  <= '0';
+                reg_enable  <= '0';
+                reg_clear   <= '0';
+                reg_half    <= to_unsigned(512, HALF_LOG2 + 1);
+                reg_tau_max <= to_unsigned(512, HALF_LOG2 + 1);
+                reg_hop     <= to_unsigned(256, 16);
+            else
+                -- Clear is a request; it is taken when the engine goes back to idle
+                if state = ST_CLEAR then
+                    reg_clear <= '0';
+                end if;
+
+                axi_awready <= '0';
+                axi_wready  <= '0';
+                if axi_bvalid = '1' and s_axi_bready = '1' then
+                    axi_bvalid <= '0';
+                end if;
+
+                -- Address and data accepted together, one write at a time
+                if s_axi_awvalid = '1' and s_axi_wvalid = '1' and axi_awready = '0' and axi_bvalid = '0' then
+                    axi_awready <= '1';
+                    axi_wready  <= '1';
+                    axi_bvalid  <= '1';
+                    a := to_integer(unsigned(s_axi_awaddr(4 downto 2)));
+                    if s_axi_awaddr(C_S_AXI_ADDR_WIDTH-1) = '0' then
+                        case a is
+                            when 0 =>
+                                reg_enable <= s_axi_wdata(0);
+                                if s_axi_wdata(1) = '1' then
+                                    reg_clear <= '1';
+                                end if;
+                            when 2 => reg_half    <= unsigned(s_axi_wdata(HALF_LOG2 downto 0));
+                            when 3 => reg_tau_max <= unsigned(s_axi_wdata(HALF_LOG2 downto 0));
+                            when 4 => reg_hop     <= unsigned(s_axi_wdata(15 downto 0));
+                            when others => null;
+                        end case;
+                    end if;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    --------------------------------------------------
+    -- AXI4-Lite read channel (one wait cycle for the snapshot RAM)
+    --------------------------------------------------
+    s_axi_arready <= axi_arready;
+    s_axi_rvalid  <= axi_rvalid;
+    s_axi_rdata   <= axi_rdata;
+    s_axi_rresp   <= "00";
+
+    snap_ra <= unsigned(rd_addr(HALF_LOG2 + 2 downto 3));
+
+    process (clk)
+        variable status : std_logic_vector(31 downto 0);
+    begin
+        if rising_edge(clk) then
+            if rst = '0' then
+                axi_arready <= '0';
+                axi_rvalid  <= '0';
+                rd_wait     <= '0';
+            else
+                axi_arready <= '0';
+                if axi_rvalid = '1' and s_axi_rready = '1' then
+                    axi_rvalid <= '0';
+                end if;
+
+                if s_axi_arvalid = '1' and axi_arready = '0' and axi_rvalid = '0' and rd_wait = '0' then
+                    axi_arready <= '1';
+                    rd_addr     <= s_axi_araddr;
+                    rd_wait     <= '1';
+                elsif rd_wait = '1' and axi_arready = '0' then
+                    -- snap_q holds the addressed entry from this cycle on
+                    rd_wait    <= '0';
+                    axi_rvalid <= '1';
+                    if rd_addr(C_S_AXI_ADDR_WIDTH-1) = '1' then
+                        if rd_addr(2) = '0' then
+                            axi_rdata <= std_logic_vector(snap_q(31 downto 0));
+                        else
+                            axi_rdata <= std_logic_vector(resize(snap_q(D_WIDTH-1 downto 32), 32));
+                        end if;
+                    else
+                        status := (others => '0');
+                        case to_integer(unsigned(rd_addr(4 downto 2))) is
+                            when 0 =>
+                                axi_rdata <= (others => '0');
+                                axi_rdata(0) <= reg_enable;
+                                axi_rdata(1) <= reg_clear;
+                            when 1 =>
+                                if state = ST_CLEAR then status(0) := '1'; end if;
+                                status(1) := overrun;
+                                axi_rdata <= status;
+                            when 2 => axi_rdata <= std_logic_vector(resize(reg_half, 32));
+                            when 3 => axi_rdata <= std_logic_vector(resize(reg_tau_max, 32));
+                            when 4 => axi_rdata <= std_logic_vector(resize(reg_hop, 32));
+                            when 5 => axi_rdata <= std_logic_vector(snap_count);
+                            when 6 => axi_rdata <= std_logic_vector(sample_count);
+                            when others => axi_rdata <= x"59494E31";
+                        end case;
+                    end if;
+                end if;
+            end if;
+        end if;
+    end process;
+
+end Behavioral;
@@ -0,0 +1,164 @@
+// Bit-exactness check for the vector step-1 kernel of Yin.
+//
+// Runs Yin_squaredDifference (NEON when built for the A53 / any AArch64
+// host) against Yin_squaredDifferenceScalar for every lag of every window of
+// the test recordings and fails on the first mismatch. Full-scale runs
+// (+32767 against -32768, squares up to 65535^2) are checked first against
+// the exact sum, so an overflowing square fails even where both paths agree.
+//
+// Build and run from this directory, e.g. on the KV260 Linux image or with
+// an AArch64 cross compiler under qemu-aarch64:
+//   S=../../audio_tuner_software/src
+//   gcc -O2 -I$S yin_difference_check.c $S/Yin.c $S/fft.c $S/arena.c -lm -o yin_difference_check
+//   ./yin_difference_check "../audio test 001/REC_001.WAV" "../audio test 002/REC_002.WAV"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "Yin.h"
+
+#define WINDOW_SIZE 2048
+#define HOP_SIZE    512
+#define EXTREME_RUN 67      // Odd, so the NEON tail is exercised too
+
+// Compare both kernels with the exact sum on full-scale runs; returns failures
+static int check_extremes(void) {
+    static const int16_t levels[3] = { 32767, -32768, 0 };
+    int16_t a[EXTREME_RUN];
+    int16_t b[EXTREME_RUN];
+    int failures = 0;
+
+    for (int pattern = 0; pattern < 4; pattern++) {
+        for (int i = 0; i < EXTREME_RUN; i++) {
+            // Constant extremes, alternating signs, and a mix with zeros
+            int ia = pattern == 0 ? 0 : pattern == 1 ? 1 : pattern == 2 ? (i & 1) : i % 3;
+            int ib = pattern == 0 ? 1 : pattern == 1 ? 0 : pattern == 2 ? !(i & 1) : (i + 1) % 3;
+            a[i] = levels[ia];
+            b[i] = levels[ib];
+        }
+
+        for (int n = 0; n <= EXTREME_RUN; n++) {
+            uint64_t want = 0;
+            for (int i = 0; i < n; i++) {
+                int64_t delta = (int64_t)a[i] - b[i];
+                want += (uint64_t)(delta * delta);
+            }
+            uint64_t vec = Yin_squaredDifference(a, b, n);
+            uint64_t ref = Yin_squaredDifferenceScalar(a, b, n);
+
+            if (vec != want || ref != want) {
+                printf("MISMATCH full scale: pattern %d n %d: vector %llu scalar %llu exact %llu\n", pattern, n,
+                       (unsigned long long)vec, (unsigned long long)ref, (unsigned long long)want);
+                failures++;
+                break;
+            }
+        }
+    }
+
+    printf("Full-scale runs: %s\n", failures ? "FAIL" : "exact");
+    return failures;
+}
+
+// Load the first channel of a 16-bit PCM WAV file
+static int16_t* load_wav(const char* path, int* length) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return NULL;
+    }
+
+    unsigned char riff[12];
+    if (fread(riff, 1, 12, f) != 12 || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        fprintf(stderr, "%s is not a WAV file\n", path);
+        fclose(f);
+        return NULL;
+    }
+
+    int channels = 1;
+    int bits = 0;
+    unsigned char chunk[8];
+    while (fread(chunk, 1, 8, f) == 8) {
+        uint32_t size = chunk[4] | (chunk[5] << 8) | (chunk[6] << 16) | ((uint32_t)chunk[7] << 24);
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            unsigned char fmt[16];
+            if (size < 16 || fread(fmt, 1, 16, f) != 16) break;
+            channels = fmt[2] | (fmt[3] << 8);
+            bits = fmt[14] | (fmt[15] << 8);
+            fseek(f, size - 16 + (size & 1), SEEK_CUR);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (bits != 16 || channels < 1) break;
+
+            int frames = size / (2 * channels);
+            int16_t* interleaved = (int16_t*)malloc(size);
+            int16_t* mono = (int16_t*)malloc(frames * sizeof(int16_t));
+            if (!interleaved || !mono || fread(interleaved, 2 * channels, frames, f) != (size_t)frames) {
+                free(interleaved);
+                free(mono);
+                break;
+            }
+            for (int i = 0; i < frames; i++) {
+                mono[i] = interleaved[i * channels];
+            }
+            free(interleaved);
+            fclose(f);
+            *length = frames;
+            return mono;
+        } else {
+            fseek(f, size + (size & 1), SEEK_CUR);
+        }
+    }
+
+    fprintf(stderr, "%s: no 16-bit PCM data found\n", path);
+    fclose(f);
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <recording.wav> [more.wav ...]\n", argv[0]);
+        return 1;
+    }
+
+#if defined(__ARM_NEON)
+    printf("Vector kernel: NEON\n");
+#else
+    printf("Vector kernel: scalar fallback (build on AArch64 to test NEON)\n");
+#endif
+
+    const int half = WINDOW_SIZE / 2;
+    int failures = check_extremes();
+
+    for (int f = 1; f < argc; f++) {
+        int length = 0;
+        int16_t* samples = load_wav(argv[f], &length);
+        if (!samples) return 1;
+
+        long lags = 0;
+        for (int start = 0; start + WINDOW_SIZE <= length && !failures; start += HOP_SIZE) {
+            const int16_t* window = samples + start;
+
+            // Every lag, and every length up to the window so each tail size is hit
+            for (int tau = 0; tau < half; tau++) {
+                int n = half - (tau & 7);
+                uint64_t vec = Yin_squaredDifference(window, window + tau, n);
+                uint64_t ref = Yin_squaredDifferenceScalar(window, window + tau, n);
+                lags++;
+
+                if (vec != ref) {
+                    printf("MISMATCH %s: window %d lag %d n %d: %llu != %llu\n", argv[f], start, tau, n,
+                           (unsigned long long)vec, (unsigned long long)ref);
+                    failures++;
+                    break;
+                }
+            }
+        }
+
+        printf("%s: %d samples, %ld lags compared\n", argv[f], length, lags);
+        free(samples);
+    }
+
+    printf(failures ? "FAIL\n" : "PASS: vector and scalar step 1 are bit-exact\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,230 @@
+// Stress test and throughput benchmark for the SPSC block ring.
+//
+// Stress: a producer thread writes blocks stamped with a sequence number and
+// a pattern derived from it, a consumer thread checks every block arrives
+// once, in order and intact. Both sides use random bursts and random stalls
+// so the ring runs through full, empty and everything in between; half the
+// traffic goes through the zero-copy calls and half through push/pop.
+//
+// Benchmark: the producer pushes as fast as it can for each block size and
+// the rate the consumer drains is printed in blocks/s and MB/s, next to the
+// rate the stream needs (one 256-sample burst per 5.3 ms).
+//
+// Build and run from this directory on the KV260 Linux image to measure two
+// A53 cores (the threads are pinned to cores 0 and 1 where the OS allows):
+//   S=../../audio_tuner_software/src
+//   gcc -O2 -pthread -I$S audio_ring_stress.c $S/audio_ring.c -o audio_ring_stress
+//   ./audio_ring_stress [stress blocks]
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "audio_ring.h"
+
+#define STRESS_BLOCKS   8
+#define STRESS_BYTES    (256 * 2)           // One capture burst of 16-bit samples
+#define BENCH_BLOCKS    16
+#define BENCH_SECONDS   1.0
+#define MAX_BYTES       16384
+
+static uint8_t ring_store[AUDIO_RING_STORAGE_BYTES(MAX_BYTES, BENCH_BLOCKS)] AUDIO_RING_ALIGN;
+static AudioRing ring AUDIO_RING_ALIGN;
+
+static uint32_t total_blocks;
+static uint32_t block_bytes;
+static volatile int bench_stop;
+static uint64_t bench_popped;
+static uint32_t errors;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void pin(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+// xorshift per thread, so the two sides stall independently
+static uint32_t next_rand(uint32_t* s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 17;
+    *s ^= *s << 5;
+    return *s;
+}
+
+static void stall(uint32_t* s) {
+    uint32_t r = next_rand(s);
+    if ((r & 0xFF) == 0) {
+        sched_yield();
+    } else {
+        for (volatile uint32_t i = 0; i < (r >> 24); i++) { }
+    }
+}
+
+static void fill(uint8_t* b, uint32_t seq) {
+    memcpy(b, &seq, sizeof(seq));
+    for (uint32_t i = sizeof(seq); i < block_bytes; i++) {
+        b[i] = (uint8_t)(seq * 31 + i);
+    }
+}
+
+static int check(const uint8_t* b, uint32_t seq) {
+    uint32_t got;
+    memcpy(&got, b, sizeof(got));
+    if (got != seq) {
+        return -1;
+    }
+    for (uint32_t i = sizeof(seq); i < block_bytes; i++) {
+        if (b[i] != (uint8_t)(seq * 31 + i)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void* stress_producer(void* arg) {
+    (void)arg;
+    pin(0);
+    uint32_t s = 0x1234567u;
+    uint8_t tmp[MAX_BYTES];
+    for (uint32_t seq = 0; seq < total_blocks; ) {
+        if (seq & 1) {
+            fill(tmp, seq);
+            if (audio_ring_push(&ring, tmp) == 0) seq++;
+        } else {
+            uint8_t* b = audio_ring_write_block(&ring);
+            if (b) {
+                fill(b, seq);
+                audio_ring_commit(&ring);
+                seq++;
+            }
+        }
+        stall(&s);
+    }
+    return NULL;
+}
+
+static void* stress_consumer(void* arg) {
+    (void)arg;
+    pin(1);
+    uint32_t s = 0x89abcdefu;
+    uint8_t tmp[MAX_BYTES];
+    for (uint32_t seq = 0; seq < total_blocks; ) {
+        if (seq & 2) {
+            if (audio_ring_pop(&ring, tmp) == 0) {
+                if (check(tmp, seq) != 0 && errors++ < 5) {
+                    printf("  block %u corrupt or out of order\n", seq);
+                }
+                seq++;
+            }
+        } else {
+            const uint8_t* b = audio_ring_read_block(&ring);
+            if (b) {
+                if (check(b, seq) != 0 && errors++ < 5) {
+                    printf("  block %u corrupt or out of order\n", seq);
+                }
+                audio_ring_release(&ring);
+                seq++;
+            }
+        }
+        stall(&s);
+    }
+    return NULL;
+}
+
+static void* bench_producer(void* arg) {
+    (void)arg;
+    pin(0);
+    static uint8_t tmp[MAX_BYTES];
+    while (!bench_stop) {
+        audio_ring_push(&ring, tmp);
+    }
+    return NULL;
+}
+
+static void* bench_consumer(void* arg) {
+    (void)arg;
+    pin(1);
+    static uint8_t tmp[MAX_BYTES];
+    uint64_t n = 0;
+    while (!bench_stop) {
+        if (audio_ring_pop(&ring, tmp) == 0) {
+            n++;
+        }
+    }
+    bench_popped = n;
+    return NULL;
+}
+
+static int run(void* (*prod)(void*), void* (*cons)(void*), double seconds) {
+    pthread_t p, c;
+    bench_stop = 0;
+    if (pthread_create(&c, NULL, cons, NULL) != 0 || pthread_create(&p, NULL, prod, NULL) != 0) {
+        printf("pthread_create failed\n");
+        return -1;
+    }
+    if (seconds > 0.0) {
+        struct timespec ts = { (time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9) };
+        nanosleep(&ts, NULL);
+        bench_stop = 1;
+    }
+    pthread_join(p, NULL);
+    pthread_join(c, NULL);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    total_blocks = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 1000000;
+
+    // Bad configurations are refused
+    int bad = audio_ring_init(&ring, ring_store, sizeof(ring_store), STRESS_BYTES, 6) == 0 ||
+              audio_ring_init(&ring, ring_store + 4, sizeof(ring_store) - 4, STRESS_BYTES, 8) == 0 ||
+              audio_ring_init(&ring, ring_store, 100, STRESS_BYTES, 8) == 0;
+    if (bad) {
+        printf("FAIL: audio_ring_init accepted a bad configuration\n");
+        return 1;
+    }
+
+    block_bytes = STRESS_BYTES;
+    audio_ring_init(&ring, ring_store, sizeof(ring_store), block_bytes, STRESS_BLOCKS);
+    printf("Stress: %u blocks of %u bytes through %u slots\n", total_blocks, block_bytes, STRESS_BLOCKS);
+    double t0 = now_s();
+    if (run(stress_producer, stress_consumer, 0.0) != 0) {
+        return 1;
+    }
+    printf("  %.2f s, %u pushes found it full, %u errors, %u left\n", now_s() - t0, ring.overruns, errors,
+           audio_ring_count(&ring));
+    if (errors || audio_ring_count(&ring)) {
+        printf("FAIL\n");
+        return 1;
+    }
+
+    printf("\nThroughput (%u slots, %.1f s each):\n", BENCH_BLOCKS, BENCH_SECONDS);
+    printf("  %8s %14s %10s %12s\n", "bytes", "blocks/s", "MB/s", "x realtime");
+    for (block_bytes = 64; block_bytes <= MAX_BYTES; block_bytes *= 4) {
+        audio_ring_init(&ring, ring_store, sizeof(ring_store), block_bytes, BENCH_BLOCKS);
+        if (run(bench_producer, bench_consumer, BENCH_SECONDS) != 0) {
+            return 1;
+        }
+        double rate = bench_popped / BENCH_SECONDS;
+        double stream = 48000.0 * 2 / block_bytes;     // Blocks/s of a 48 kHz 16-bit mono stream
+        printf("  %8u %14.0f %10.1f %12.0f\n", block_bytes, rate, rate * block_bytes / 1e6,
+               rate / stream);
+    }
+    printf("\nPASS\n");
+    return 0;
+}
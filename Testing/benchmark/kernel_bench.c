@@ -0,0 +1,515 @@
+// Host benchmark for the Yin, phase vocoder, PSOLA, limiter and WAV analysis kernels in audio_tuner_software/src.
+//
+// Every kernel runs over the same inputs: the two recorded takes in
+// Testing/audio test 001 and 002, and a synthetic 3 s logarithmic tone sweep
+// (80 Hz to 1 kHz) so the Yin lag range is covered end to end. For each
+// kernel and input the best of BENCH_REPEATS passes is reported as samples/s,
+// ns per frame (a Yin window, a tracker burst, a vocoder hop or a PSOLA hop;
+// pv_curve is the vocoder with a new ratio every frame; pv_locked is the
+// vocoder with identity phase locking; pv_spectral shifts by moving peak regions
+// instead of stretch and resample; pv_harmony is pv_spectral with a third
+// and a fifth above the lead at half level; pv_pitch is pv_q15 estimating
+// every frame's pitch from its bins (check: mean pitch of the frames it is
+// sure of, to hold against the Yin rows); pv_512 and pv_4096 are pv_q15 with the
+// live and the offline frame, hop a quarter of it; limiter_q15 is the
+// output limiter with make-up gain, per capture burst; wav_analysis is the
+// one-pass file analysis the firmware runs on target.wav, per read block,
+// and runs on the takes only, straight from their files) and the heap
+// the kernel holds (glibc only; the kernels allocate everything at create
+// time). A check value (mean voiced pitch, or output RMS) shows when an
+// optimisation changed the result rather than just the speed. The vocoder
+// rows measure their RMS about the mean, so a DC offset in the takes does not
+// count as level; input_level is the input measured that way, per vocoder
+// hop, for the vocoder rows to be held against.
+//
+// Results also go to a JSON-lines file, one object per kernel and input; pass
+// an earlier file with -b to print the speed-up of each row against it:
+//   S=../../audio_tuner_software/src
+//   K="Yin.c YinTracker.c YinAnalysis.c scale.c fft.c arena.c phase_voc.c pv_kernels.c resampler.c fixed_point.c dlog.c psola.c limiter.c wav_pitch_detection.c pv_pitch.c"
+//   gcc -O2 -I$S kernel_bench.c $(for f in $K; do echo $S/$f; done) -lm -o kernel_bench
+//   ./kernel_bench [-o results.jsonl] [-b baseline.jsonl]
+// A UART log from the firmware's on-target benchmark (self_bench.c) works as
+// the baseline too: its rows have the same kernel, input and speed fields.
+// Run it on the KV260 Linux image (or any AArch64 host) to measure the NEON paths.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#include "Yin.h"
+#include "YinTracker.h"
+#include "phase_voc.h"
+#include "psola.h"
+#include "limiter.h"
+#include "wav_pitch_detection.h"
+#include "fixed_point.h"
+#include "dlog.h"
+
+#define FS              48000
+#define YIN_WINDOW      2048        // Whole-window analysis (FFT difference path)
+#define YIN_HOP         512
+#define TRACK_WINDOW    1024        // PITCH_WINDOW in helloworld.c
+#define TRACK_BURST     256         // CAPTURE_BURST_SAMPLES
+#define PV_CHUNK        1024        // SHIFT_CHUNK_SIZE in helloworld.c
+#define PV_RATIO        1.5f
+#define PV_MAX_FFT      4096        // Largest vocoder frame benchmarked (pv_4096)
+#define BENCH_REPEATS   5
+#define MAX_ROWS        64
+
+typedef struct {
+    const char* name;
+    const char* path;           // WAV file it was loaded from, NULL if synthetic
+    int16_t* pcm;
+    int n;
+} Input;
+
+typedef struct {
+    char kernel[32];
+    char input[32];
+    double samples_per_s;
+    double ns_per_frame;
+    long heap_bytes;
+    double check;
+} Row;
+
+typedef struct {
+    int frames;
+    double check;
+    long heap;                  // Heap held once the kernel is set up
+} Pass;
+
+static Row rows[MAX_ROWS];
+static int row_count;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static long heap_in_use(void) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    return (long)mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+/*** Inputs ***/
+
+static int load_take(Input* in, const char* name, const char* path) {
+    AudioBuffer* a = read_wav_file(path);
+    if (!a) {
+        return -1;
+    }
+    in->name = name;
+    in->path = path;
+    in->n = a->length;
+    in->pcm = malloc(a->length * sizeof(int16_t));
+    float_to_q15_array(a->data, in->pcm, a->length);
+    free_audio_buffer(a);
+    return 0;
+}
+
+static void make_sweep(Input* in) {
+    const double f0 = 80.0, f1 = 1000.0, seconds = 3.0;
+    const double k = log(f1 / f0) / seconds;
+    in->name = "sweep";
+    in->path = NULL;
+    in->n = (int)(FS * seconds);
+    in->pcm = malloc(in->n * sizeof(int16_t));
+    for (int i = 0; i < in->n; i++) {
+        double t = (double)i / FS;
+        double phase = 2.0 * M_PI * f0 * (exp(k * t) - 1.0) / k;
+        in->pcm[i] = (int16_t)(0.5 * 32767.0 * sin(phase));
+    }
+}
+
+/*** Kernels ***/
+
+typedef enum { YIN_DIRECT, YIN_FFT, YIN_COARSE } YinMode;
+
+static Pass run_yin(const Input* in, YinMode mode) {
+    static int16_t window[YIN_WINDOW];
+    Yin yin;
+    void* workspace = NULL;
+    Pass p = { 0, 0.0, 0 };
+    int voiced = 0;
+    long heap = heap_in_use();
+
+    if (mode == YIN_DIRECT) {
+        size_t bytes = Yin_workspaceSize(YIN_WINDOW, 0);
+        workspace = malloc(bytes);
+        Yin_initWorkspace(&yin, YIN_WINDOW, 0.15f, workspace, bytes);
+    } else {
+        Yin_init(&yin, YIN_WINDOW, 0.15f);
+        Yin_setCoarseToFine(&yin, mode == YIN_COARSE);
+    }
+    Yin_setRange(&yin, 20.0f, 4200.0f);
+    p.heap = heap_in_use() - heap;
+
+    for (int start = 0; start + YIN_WINDOW <= in->n; start += YIN_HOP) {
+        // Yin_getPitch takes a mutable buffer; analyse a copy as the firmware does
+        memcpy(window, in->pcm + start, sizeof(window));
+        float pitch = Yin_getPitch(&yin, window);
+        if (pitch > 0) {
+            p.check += pitch;
+            voiced++;
+        }
+        p.frames++;
+    }
+    p.check = voiced ? p.check / voiced : 0.0;
+
+    if (workspace) {
+        free(workspace);
+    } else {
+        Yin_free(&yin);
+    }
+    return p;
+}
+
+static Pass run_yin_direct(const Input* in) { return run_yin(in, YIN_DIRECT); }
+static Pass run_yin_fft(const Input* in)    { return run_yin(in, YIN_FFT); }
+static Pass run_yin_coarse(const Input* in) { return run_yin(in, YIN_COARSE); }
+
+static Pass run_tracker(const Input* in) {
+    YinTracker t;
+    Pass p = { 0, 0.0, 0 };
+    int voiced = 0;
+    long heap = heap_in_use();
+
+    YinTracker_init(&t, TRACK_WINDOW, 0.15f);
+    Yin_setRange(&t.yin, 20.0f, 4200.0f);
+    p.heap = heap_in_use() - heap;
+    for (int i = 0; i + TRACK_BURST <= in->n; i += TRACK_BURST) {
+        float pitch = YinTracker_push(&t, in->pcm + i, TRACK_BURST);
+        if (i >= TRACK_WINDOW && pitch > 0) {
+            p.check += pitch;
+            voiced++;
+        }
+        p.frames++;
+    }
+    p.check = voiced ? p.check / voiced : 0.0;
+    YinTracker_free(&t);
+    return p;
+}
+
+// RMS about the mean of `count` Q15 samples, full scale 1
+static double ac_rms(double energy, double sum, long count) {
+    if (count == 0) {
+        return 0.0;
+    }
+    double mean = sum / count;
+    double var = energy / count - mean * mean;
+    return var > 0.0 ? sqrt(var) / 32768.0 : 0.0;
+}
+
+// The level the vocoder rows should keep: the input's RMS about its mean
+static Pass run_input_level(const Input* in) {
+    Pass p = { 0, 0.0, 0 };
+    double energy = 0.0;
+    double sum = 0.0;
+
+    for (int i = 0; i < in->n; i++) {
+        energy += (double)in->pcm[i] * in->pcm[i];
+        sum += in->pcm[i];
+    }
+    p.frames = in->n / PV_DEFAULT_HOP;
+    p.check = ac_rms(energy, sum, in->n);
+    return p;
+}
+
+static Pass run_pv(const Input* in, int fft_size, int hop, int use_curve, int phase_lock, int spectral) {
+    static int16_t out[2 * PV_CHUNK + PV_FLUSH_ROOM(PV_MAX_FFT, PV_MAX_FFT / 4)];
+    Pass p = { 0, 0.0, 0 };
+    double energy = 0.0;
+    double sum = 0.0;
+    long produced = 0;
+    long heap = heap_in_use();
+
+    PhaseVocoder* pv = pv_create(fft_size, hop, PV_RATIO);
+    if (!pv || pv_set_phase_lock(pv, phase_lock) != 0 || pv_set_spectral_shift(pv, spectral) != 0) {
+        pv_destroy(pv);
+        return p;
+    }
+    // spectral == 2: a major triad, the lead plus a third and a fifth above it
+    const float intervals[2] = { exp2f(4.0f / 12.0f), exp2f(7.0f / 12.0f) };
+    const float gains[2] = { 0.5f, 0.5f };
+    if (spectral == 2 && pv_set_harmony(pv, intervals, gains, 2) != 0) {
+        pv_destroy(pv);
+        return p;
+    }
+    // A new ratio every frame (a 2 Hz wobble of a semitone around PV_RATIO)
+    int frames = in->n / hop + fft_size / hop + 2;
+    float* curve = NULL;
+    if (use_curve) {
+        curve = malloc(frames * sizeof(float));
+        for (int k = 0; k < frames; k++) {
+            curve[k] = PV_RATIO * exp2f(sinf(2.0f * (float)M_PI * 2.0f * k * hop / FS) / 12.0f);
+        }
+        pv_set_ratio_curve(pv, curve, frames);
+    }
+    p.heap = heap_in_use() - heap;
+    for (int i = 0; i < in->n; i += PV_CHUNK) {
+        int n = in->n - i < PV_CHUNK ? in->n - i : PV_CHUNK;
+        int got = pv_process_q15(pv, in->pcm + i, n, out);
+        for (int k = 0; k < got; k++) {
+            energy += (double)out[k] * out[k];
+            sum += out[k];
+        }
+        produced += got;
+    }
+    int got = pv_flush_q15(pv, out);
+    for (int k = 0; k < got; k++) {
+        energy += (double)out[k] * out[k];
+        sum += out[k];
+    }
+    produced += got;
+
+    p.frames = in->n / hop;
+    p.check = ac_rms(energy, sum, produced);
+    pv_destroy(pv);
+    free(curve);
+    return p;
+}
+
+#define PV_D   PV_DEFAULT_FFT_SIZE, PV_DEFAULT_HOP
+static Pass run_pv_q15(const Input* in)      { return run_pv(in, PV_D, 0, 0, 0); }
+static Pass run_pv_curve(const Input* in)    { return run_pv(in, PV_D, 1, 0, 0); }
+static Pass run_pv_locked(const Input* in)   { return run_pv(in, PV_D, 0, 1, 0); }
+static Pass run_pv_spectral(const Input* in) { return run_pv(in, PV_D, 0, 0, 1); }
+static Pass run_pv_harmony(const Input* in)  { return run_pv(in, PV_D, 0, 0, 2); }
+// The vocoder estimating the pitch, fed a hop at a time so every frame's estimate is seen
+static Pass run_pv_pitch(const Input* in) {
+    static int16_t out[2 * PV_DEFAULT_HOP + PV_FLUSH_ROOM(PV_DEFAULT_FFT_SIZE, PV_DEFAULT_HOP)];
+    Pass p = { 0, 0.0, 0 };
+    int voiced = 0;
+    long heap = heap_in_use();
+
+    PhaseVocoder* pv = pv_create(PV_D, PV_RATIO);
+    PvPitchConfig cfg;
+    pv_pitch_default_config(&cfg);
+    if (!pv || pv_set_pitch_estimate(pv, &cfg) != 0) {
+        pv_destroy(pv);
+        return p;
+    }
+    p.heap = heap_in_use() - heap;
+    for (int i = 0; i + PV_DEFAULT_HOP <= in->n; i += PV_DEFAULT_HOP) {
+        pv_process_q15(pv, in->pcm + i, PV_DEFAULT_HOP, out);
+        PvPitch est;
+        pv_get_pitch(pv, &est);
+        if (est.pitch > 0 && est.confidence >= 0.8f) {
+            p.check += est.pitch;
+            voiced++;
+        }
+        p.frames++;
+    }
+    pv_flush_q15(pv, out);
+    p.check = voiced ? p.check / voiced : 0.0;
+    pv_destroy(pv);
+    return p;
+}
+
+static Pass run_pv_512(const Input* in)      { return run_pv(in, 512, 128, 0, 0, 0); }
+static Pass run_pv_4096(const Input* in)     { return run_pv(in, 4096, 1024, 0, 0, 0); }
+
+static Pass run_psola_q15(const Input* in) {
+    static int16_t out[PV_CHUNK + PSOLA_FLUSH_ROOM(PSOLA_DEFAULT_MAX_PERIOD)];
+    Pass p = { 0, 0.0, 0 };
+    double energy = 0.0;
+    long produced = 0;
+    long heap = heap_in_use();
+
+    Psola* ps = psola_create(PSOLA_DEFAULT_MAX_PERIOD, PV_RATIO, 1);
+    if (!ps) {
+        return p;
+    }
+    p.heap = heap_in_use() - heap;
+    for (int i = 0; i < in->n; i += PV_CHUNK) {
+        int n = in->n - i < PV_CHUNK ? in->n - i : PV_CHUNK;
+        int got = psola_process_q15(ps, in->pcm + i, n, out);
+        for (int k = 0; k < got; k++) energy += (double)out[k] * out[k];
+        produced += got;
+    }
+    int got = psola_flush_q15(ps, out);
+    for (int k = 0; k < got; k++) energy += (double)out[k] * out[k];
+    produced += got;
+
+    p.frames = in->n / PSOLA_TRACK_HOP;
+    p.check = produced ? sqrt(energy / produced) / 32768.0 : 0.0;
+    psola_destroy(ps);
+    return p;
+}
+
+static Pass run_limiter_q15(const Input* in) {
+    static int16_t out[TRACK_BURST + LIMITER_DEFAULT_LOOKAHEAD];
+    Pass p = { 0, 0.0, 0 };
+    double energy = 0.0;
+    long produced = 0;
+    long heap = heap_in_use();
+
+    LimiterConfig cfg;
+    limiter_default_config(&cfg);
+    cfg.max_gain = 4.0f;        // Make-up gain too, so the gain moves both ways
+    Limiter* lim = limiter_create(&cfg);
+    if (!lim) {
+        return p;
+    }
+    p.heap = heap_in_use() - heap;
+    for (int i = 0; i < in->n; i += TRACK_BURST) {
+        int n = in->n - i < TRACK_BURST ? in->n - i : TRACK_BURST;
+        limiter_process_q15(lim, in->pcm + i, n, out);
+        for (int k = 0; k < n; k++) energy += (double)out[k] * out[k];
+        produced += n;
+        p.frames++;
+    }
+    int got = limiter_flush_q15(lim, out);
+    for (int k = 0; k < got; k++) energy += (double)out[k] * out[k];
+    produced += got;
+
+    p.check = produced ? sqrt(energy / produced) / 32768.0 : 0.0;
+    limiter_destroy(lim);
+    return p;
+}
+
+static Pass run_wav_analysis(const Input* in) {
+    Pass p = { 0, 0.0, 0 };
+    WavStats stats;
+    if (analyseWav(in->path, NULL, &stats) == 0) {
+        p.frames = (int)((stats.samples + WAV_ANALYSIS_BLOCK - 1) / WAV_ANALYSIS_BLOCK);
+        p.check = stats.pitch.histogramPitch;
+    }
+    return p;
+}
+
+typedef struct {
+    const char* name;
+    Pass (*run)(const Input*);
+    int needs_file;             // Reads in->path itself; skipped for synthetic inputs
+} Kernel;
+
+static const Kernel kernels[] = {
+    { "yin_direct",  run_yin_direct },
+    { "yin_fft",     run_yin_fft },
+    { "yin_coarse",  run_yin_coarse },
+    { "yin_tracker", run_tracker },
+    { "input_level", run_input_level },
+    { "pv_q15",      run_pv_q15 },
+    { "pv_curve",    run_pv_curve },
+    { "pv_locked",   run_pv_locked },
+    { "pv_spectral", run_pv_spectral },
+    { "pv_harmony",  run_pv_harmony },
+    { "pv_pitch",    run_pv_pitch },
+    { "pv_512",      run_pv_512 },
+    { "pv_4096",     run_pv_4096 },
+    { "psola_q15",   run_psola_q15 },
+    { "limiter_q15", run_limiter_q15 },
+    { "wav_analysis", run_wav_analysis, 1 },
+};
+
+static void bench(const Kernel* k, const Input* in) {
+    if (k->needs_file && !in->path) {
+        return;
+    }
+    double best = 0.0;
+    Pass p = { 0, 0.0, 0 };
+    for (int r = 0; r < BENCH_REPEATS; r++) {
+        double t0 = now_s();
+        p = k->run(in);
+        double t = now_s() - t0;
+        if (r == 0 || t < best) best = t;
+    }
+
+    if (row_count == MAX_ROWS) {
+        return;
+    }
+    Row* row = &rows[row_count++];
+    snprintf(row->kernel, sizeof(row->kernel), "%s", k->name);
+    snprintf(row->input, sizeof(row->input), "%s", in->name);
+    row->samples_per_s = best > 0.0 ? in->n / best : 0.0;
+    row->ns_per_frame = p.frames ? best * 1e9 / p.frames : 0.0;
+    row->heap_bytes = p.heap;
+    row->check = p.check;
+}
+
+/*** Baseline ***/
+
+static int read_baseline(const char* path, Row* base, int max) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        return -1;
+    }
+    char line[512];
+    int n = 0;
+    while (n < max && fgets(line, sizeof(line), f)) {
+        Row* r = &base[n];
+        if (sscanf(line, "{\"kernel\":\"%31[^\"]\",\"input\":\"%31[^\"]\",\"samples_per_s\":%lf,\"ns_per_frame\":%lf",
+                   r->kernel, r->input, &r->samples_per_s, &r->ns_per_frame) == 4) {
+            n++;
+        }
+    }
+    fclose(f);
+    return n;
+}
+
+int main(int argc, char** argv) {
+    const char* out_path = "kernel_bench.jsonl";
+    const char* base_path = NULL;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-o") == 0) out_path = argv[i + 1];
+        else if (strcmp(argv[i], "-b") == 0) base_path = argv[i + 1];
+    }
+
+    Input inputs[3];
+    int n_inputs = 0;
+    if (load_take(&inputs[n_inputs], "rec_001", "../audio test 001/REC_001.WAV") == 0) n_inputs++;
+    if (load_take(&inputs[n_inputs], "rec_002", "../audio test 002/REC_002.WAV") == 0) n_inputs++;
+    make_sweep(&inputs[n_inputs++]);
+
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        for (int i = 0; i < n_inputs; i++) {
+            bench(&kernels[k], &inputs[i]);
+        }
+    }
+    dlog_drain(0);
+
+    static Row base[MAX_ROWS];
+    int n_base = base_path ? read_baseline(base_path, base, MAX_ROWS) : 0;
+    if (base_path && n_base < 0) {
+        printf("Cannot read baseline %s\n", base_path);
+        n_base = 0;
+    }
+
+    printf("%-12s %-8s %12s %12s %10s %10s%s\n", "kernel", "input", "Msamples/s", "ns/frame",
+           "heap KB", "check", n_base ? "   speed-up" : "");
+    FILE* out = fopen(out_path, "w");
+    for (int i = 0; i < row_count; i++) {
+        const Row* r = &rows[i];
+        printf("%-12s %-8s %12.2f %12.0f %10.1f %10.3f", r->kernel, r->input, r->samples_per_s / 1e6,
+               r->ns_per_frame, r->heap_bytes / 1024.0, r->check);
+        for (int b = 0; b < n_base; b++) {
+            if (strcmp(base[b].kernel, r->kernel) == 0 && strcmp(base[b].input, r->input) == 0 &&
+                r->ns_per_frame > 0.0) {
+                printf("   %8.2fx", base[b].ns_per_frame / r->ns_per_frame);
+            }
+        }
+        printf("\n");
+        if (out) {
+            fprintf(out, "{\"kernel\":\"%s\",\"input\":\"%s\",\"samples_per_s\":%.1f,\"ns_per_frame\":%.1f,"
+                         "\"heap_bytes\":%ld,\"check\":%.6f}\n",
+                    r->kernel, r->input, r->samples_per_s, r->ns_per_frame, r->heap_bytes, r->check);
+        }
+    }
+    if (out) {
+        fclose(out);
+        printf("\nResults in %s\n", out_path);
+    }
+
+    for (int i = 0; i < n_inputs; i++) free(inputs[i].pcm);
+    return 0;
+}
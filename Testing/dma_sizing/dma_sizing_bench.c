@@ -0,0 +1,351 @@
+// Loosely-timed model of the capture stream, for sizing the capture ring
+// and the audio_pipeline FIFO before building a bitstream.
+//
+// Three parts are modelled after the hardware and capture.c:
+//   - the I2S receiver pushing one word per sample period (48 kHz) into the
+//     audio_pipeline FIFO (2**FIFO_DEPTH words), which drops words while full;
+//   - the S2MM channel of the capture DMA, which empties the FIFO into one
+//     segment (SEG_BURSTS * BURST_SAMPLES words, one TLAST packet) per
+//     simple-mode transfer, as 16-beat 32-bit AXI bursts at the 100 MHz PL
+//     clock, each with a fixed write latency;
+//   - the A53 consumer running the capture_next/capture_release loop: it
+//     takes a burst, works on it for a share of its real-time length, and
+//     now and then blocks for an SD card write. A finished transfer is
+//     retired and the next segment armed from the poll (or the ISR with
+//     -i), unless every segment of the ring still waits to be read.
+//
+// The stream side and the CPU side run as two processes under temporal
+// decoupling, as in a TLM-2.0 loosely-timed model with a quantum keeper:
+// each runs ahead on its own local time until it is a quantum past the
+// last sync point, then yields. A completion is seen by the CPU as soon as
+// its local time passes it; an arm made by the CPU reaches the DMA at the
+// next sync point, up to a quantum late. Larger quanta run faster and
+// overstate the FIFO peaks; the quantum rows at the end show how far.
+//
+// For every ring size (descriptors), burst size and FIFO depth the model
+// prints the DMA utilisation (bus busy and time armed), the highest FIFO
+// fill, the headroom left at that peak, how often the ring ran out of free
+// segments, and the samples dropped. A configuration with a few ms of
+// headroom over the worst SD stall is safe; "tight" means under
+// RISK_MARGIN_MS, "DROPS" that the FIFO overflowed.
+//
+// Build and run from this directory:
+//   gcc -O2 dma_sizing_bench.c -o dma_sizing_bench
+//   ./dma_sizing_bench [-s seconds] [-q quantum_us] [-l load] [-w stall_ms] [-i]
+// -l sets the consumer's work per burst as a share of the burst length,
+// -w the longest SD write stall, -i arms from the interrupt instead of the
+// poll.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FS              48000       // CAPTURE_FS
+#define PL_MHZ          100.0       // pl_clk0, S2MM stream and memory map clock
+#define AXI_BEATS       16          // c_s2mm_burst_size, 32-bit beats
+#define AXI_LAT_NS      250.0       // Write address to response, HPC0 into DDR
+#define ARM_US          4.0         // capture_arm: cache maintenance and register writes
+#define RETIRE_US       2.0         // capture_service retiring a transfer
+#define POLL_US         2.0         // One empty capture_next
+#define IRQ_US          3.0         // S2MM interrupt to capture_isr
+#define STALL_EVERY_MS  250.0       // Mean time between SD write stalls
+#define RISK_MARGIN_MS  5.0
+
+#define SEG_BURSTS      4           // CAPTURE_SEG_BURSTS
+#define MAX_SEGMENTS    16
+
+typedef struct {
+    int burst;                      // BURST_SAMPLES
+    int fifo_log2;                  // FIFO_DEPTH
+    int segments;                   // CAPTURE_SEGMENTS
+} Config;
+
+typedef struct {
+    double seconds;
+    double quantum_s;
+    double load;                    // Work per burst over the burst length
+    double stall_s;                 // Longest SD write stall
+    int irq;                        // CAPTURE_IRQ
+} Options;
+
+typedef struct {
+    double bus_busy_s;
+    double armed_s;
+    uint32_t max_fifo;
+    uint32_t max_filled;
+    uint32_t overruns;
+    uint64_t drops;
+    double wall_s;
+} Result;
+
+// Shared between the two processes; written by one, read by the other
+typedef struct {
+    // Stream side
+    double t;                       // Local time
+    uint64_t next_word;             // Index of the next word due
+    uint32_t fifo;                  // Words in the FIFO
+    int armed;                      // Segment the DMA is filling (-1 none)
+    uint32_t remaining;             // Words left in it
+    double arm_at;                  // When the pending arm was made
+    int arm_pending;                // CPU armed a segment the DMA has not seen
+    int done_seg;                   // Completed transfer not yet retired (-1 none)
+    double done_at;
+    double armed_since;
+    // CPU side
+    double tc;
+    int filled[MAX_SEGMENTS];
+    int head, tail, burst_in_seg, cpu_armed, stalled;
+    double next_stall;
+    uint32_t seed;
+} Model;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double frand(uint32_t* s) {
+    *s = *s * 1664525u + 1013904223u;
+    return (*s >> 8) * (1.0 / 16777216.0);
+}
+
+// Time the S2MM channel holds the bus to write n words
+static double bus_time(uint32_t n) {
+    uint32_t bursts = (n + AXI_BEATS - 1) / AXI_BEATS;
+    return n / (PL_MHZ * 1e6) + bursts * AXI_LAT_NS * 1e-9;
+}
+
+// TLAST: the transfer completes once its last burst is written
+static void stream_done(Model* m, Result* r, double t) {
+    m->done_seg = m->armed;
+    m->done_at = t + AXI_LAT_NS * 1e-9;
+    r->armed_s += m->done_at - m->armed_since;
+    m->armed = -1;
+}
+
+// The DMA takes an arm at its time stamp, or at the first sync point after
+// it if the CPU made it while the stream was running ahead
+static void stream_arm(Model* m, Result* r, uint32_t seg_words) {
+    m->arm_pending = 0;
+    m->armed = m->cpu_armed;
+    m->remaining = seg_words;
+    m->armed_since = m->t > m->arm_at ? m->t : m->arm_at;
+    // The backlog goes out at bus speed
+    uint32_t n = m->fifo < m->remaining ? m->fifo : m->remaining;
+    r->bus_busy_s += bus_time(n);
+    m->fifo -= n;
+    m->remaining -= n;
+    if (m->remaining == 0) {
+        stream_done(m, r, m->armed_since + bus_time(n));
+    }
+}
+
+// Stream side: run words up to local time 'until'
+static void stream_run(Model* m, const Config* c, Result* r, double until) {
+    uint32_t depth = 1u << c->fifo_log2;
+    uint32_t seg_words = (uint32_t)(SEG_BURSTS * c->burst);
+
+    if (m->arm_pending && m->arm_at <= m->t) {
+        stream_arm(m, r, seg_words);
+    }
+
+    for (;;) {
+        double t = (double)m->next_word / FS;
+        if (t >= until) {
+            break;
+        }
+        m->t = t;
+        m->next_word++;
+        if (m->arm_pending && m->arm_at <= t) {
+            stream_arm(m, r, seg_words);
+        }
+        if (m->armed >= 0 && m->fifo == 0) {
+            // Streamed straight through; a beat, its burst's latency shared
+            r->bus_busy_s += 1.0 / (PL_MHZ * 1e6) + AXI_LAT_NS * 1e-9 / AXI_BEATS;
+            m->remaining--;
+        } else if (m->fifo < depth) {
+            m->fifo++;
+        } else {
+            r->drops++;
+        }
+        if (m->fifo > r->max_fifo) {
+            r->max_fifo = m->fifo;
+        }
+        if (m->armed >= 0 && m->remaining == 0) {
+            stream_done(m, r, t);
+        }
+    }
+    m->t = until;
+}
+
+// capture_service and capture_arm, run at time t; returns the time they
+// finish. The consumer loop calls it at its local time; with the interrupt
+// the ISR also runs it as each transfer finishes, whatever the loop is doing.
+static double cpu_service(Model* m, const Config* c, Result* r, double t) {
+    if (m->cpu_armed >= 0) {
+        if (m->done_seg != m->cpu_armed || m->done_at > t) {
+            return t;
+        }
+        m->done_seg = -1;
+        m->filled[m->cpu_armed] = 1;
+        m->cpu_armed = -1;
+        t += RETIRE_US * 1e-6;
+    }
+    int used = 0;
+    for (int i = 0; i < c->segments; i++) {
+        used += m->filled[i];
+    }
+    if ((uint32_t)used > r->max_filled) {
+        r->max_filled = used;
+    }
+    if (m->filled[m->head]) {
+        // A whole ring behind; the FIFO absorbs the wait
+        if (!m->stalled) {
+            m->stalled = 1;
+            r->overruns++;
+        }
+        return t;
+    }
+    m->stalled = 0;
+    m->arm_at = t;
+    m->arm_pending = 1;
+    m->cpu_armed = m->head;
+    m->head = (m->head + 1) % c->segments;
+    return t + ARM_US * 1e-6;
+}
+
+// CPU side: run the ISR and the consumer loop up to local time 'until'
+static void cpu_run(Model* m, const Config* c, Result* r, const Options* o, double until) {
+    double burst_s = (double)c->burst / FS;
+
+    if (o->irq && m->cpu_armed >= 0 && m->done_seg == m->cpu_armed
+        && m->done_at + IRQ_US * 1e-6 < until) {
+        // Preempts the loop; its few us are lost in the work jitter
+        cpu_service(m, c, r, m->done_at + IRQ_US * 1e-6);
+    }
+
+    while (m->tc < until) {
+        if (!o->irq) {
+            m->tc = cpu_service(m, c, r, m->tc);
+        }
+        if (!m->filled[m->tail]) {
+            m->tc += POLL_US * 1e-6;
+            continue;
+        }
+        // Work on the burst, then now and then an SD write blocks the loop
+        m->tc += burst_s * o->load * (0.8 + 0.4 * frand(&m->seed));
+        if (m->tc >= m->next_stall) {
+            m->tc += o->stall_s * (0.5 + 0.5 * frand(&m->seed));
+            m->next_stall = m->tc + STALL_EVERY_MS * 1e-3 * (0.5 + frand(&m->seed));
+        }
+        // capture_release
+        if (++m->burst_in_seg == SEG_BURSTS) {
+            m->burst_in_seg = 0;
+            m->filled[m->tail] = 0;
+            m->tail = (m->tail + 1) % c->segments;
+            m->tc = cpu_service(m, c, r, m->tc);
+        }
+    }
+}
+
+static Result simulate(const Config* c, const Options* o) {
+    static Model m;
+    Result r;
+    memset(&m, 0, sizeof(m));
+    memset(&r, 0, sizeof(r));
+    m.armed = -1;
+    m.done_seg = -1;
+    m.cpu_armed = -1;
+    m.seed = 12345u;
+    m.next_stall = STALL_EVERY_MS * 1e-3;
+
+    double t0 = now_s();
+    // capture_start arms the first segment
+    cpu_service(&m, c, &r, 0.0);
+    for (double sync = 0.0; sync < o->seconds; ) {
+        sync += o->quantum_s;
+        stream_run(&m, c, &r, sync);
+        cpu_run(&m, c, &r, o, sync);
+    }
+    if (m.armed >= 0) {
+        r.armed_s += o->seconds - m.armed_since;
+    }
+    r.wall_s = now_s() - t0;
+    return r;
+}
+
+static void header(void) {
+    printf("  segs burst fifo   bus%%  armed%%  fifo peak  headroom  ring peak  overruns    drops  risk\n");
+}
+
+static void row(const Config* c, const Options* o, const Result* r) {
+    uint32_t depth = 1u << c->fifo_log2;
+    double headroom_ms = (double)(depth - r->max_fifo) * 1e3 / FS;
+    const char* risk = r->drops ? "DROPS" : headroom_ms < RISK_MARGIN_MS ? "tight" : "ok";
+    printf("  %4d %5d %4u %6.3f %7.2f %5u/%-5u %6.1f ms %5u/%-3d %9u %8llu  %s\n",
+           c->segments, c->burst, depth,
+           100.0 * r->bus_busy_s / o->seconds, 100.0 * r->armed_s / o->seconds,
+           r->max_fifo, depth, headroom_ms, r->max_filled, c->segments,
+           r->overruns, (unsigned long long)r->drops, risk);
+}
+
+int main(int argc, char** argv) {
+    Options o = { 10.0, 100e-6, 0.6, 40e-3, 0 };
+    int opt;
+    while ((opt = getopt(argc, argv, "s:q:l:w:i")) != -1) {
+        switch (opt) {
+        case 's': o.seconds = atof(optarg); break;
+        case 'q': o.quantum_s = atof(optarg) * 1e-6; break;
+        case 'l': o.load = atof(optarg); break;
+        case 'w': o.stall_s = atof(optarg) * 1e-3; break;
+        case 'i': o.irq = 1; break;
+        default:
+            fprintf(stderr, "usage: %s [-s seconds] [-q quantum_us] [-l load] [-w stall_ms] [-i]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (o.seconds <= 0.0 || o.quantum_s <= 0.0 || o.load <= 0.0 || o.load >= 1.0 || o.stall_s < 0.0) {
+        fprintf(stderr, "seconds and quantum must be positive, load between 0 and 1\n");
+        return 1;
+    }
+
+    static const int segments[] = { 2, 4, 8, 16 };
+    static const int bursts[] = { 64, 128, 256, 512 };
+    static const int fifos[] = { 9, 10, 11, 12 };
+    double wall = 0.0;
+
+    printf("Capture DMA sizing: %.0f s simulated, quantum %.0f us, load %.0f%%, SD stalls up to %.0f ms, %s\n",
+           o.seconds, o.quantum_s * 1e6, o.load * 100.0, o.stall_s * 1e3, o.irq ? "IRQ" : "polled");
+    printf("(segment = %d bursts; bus%% is S2MM write time, armed%% the time a transfer was armed)\n", SEG_BURSTS);
+    header();
+    for (size_t s = 0; s < sizeof(segments) / sizeof(segments[0]); s++) {
+        for (size_t b = 0; b < sizeof(bursts) / sizeof(bursts[0]); b++) {
+            for (size_t f = 0; f < sizeof(fifos) / sizeof(fifos[0]); f++) {
+                Config c = { bursts[b], fifos[f], segments[s] };
+                Result r = simulate(&c, &o);
+                wall += r.wall_s;
+                row(&c, &o, &r);
+            }
+        }
+    }
+    printf("  (%.2f s wall for the sweep)\n", wall);
+
+    // The shipped configuration under different quanta: speed against the
+    // arm delay the decoupling adds
+    static const double quanta_us[] = { 1, 10, 100, 1000, 5000 };
+    Config c = { 256, 12, 8 };
+    printf("\nQuantum (shipped sizes: 8 segments, 256-sample bursts, 4096-word FIFO)\n");
+    printf("  quantum   wall ms  fifo peak  drops\n");
+    for (size_t q = 0; q < sizeof(quanta_us) / sizeof(quanta_us[0]); q++) {
+        Options oq = o;
+        oq.quantum_s = quanta_us[q] * 1e-6;
+        Result r = simulate(&c, &oq);
+        printf("  %5.0f us %8.1f %10u %6llu\n", quanta_us[q], r.wall_s * 1e3,
+               r.max_fifo, (unsigned long long)r.drops);
+    }
+    return 0;
+}
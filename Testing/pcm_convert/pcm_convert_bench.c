@@ -0,0 +1,186 @@
+// Micro-benchmark for the DMA burst format conversions.
+//
+// Times the per-sample loops helloworld used to run on every capture and
+// playback burst (a 16-step bit-reverse loop after the 18 -> 16 bit shift,
+// and the mono -> stereo I2S expansion) against pcm_from_capture and
+// pcm_to_playback, checks that both give the same bits, and prints
+// nanoseconds and cycles per sample for each. It also times the IMA ADPCM
+// encoder a REC_ADPCM take runs on every capture burst against
+// ADPCM_ENCODE_BUDGET, and the decoder the readers run, after checking the
+// round trip on a tone.
+//
+// Build and run from this directory on the KV260 Linux image (or any AArch64
+// host) to get the NEON kernels; elsewhere the scalar fallback is measured:
+//   S=../../audio_tuner_software/src
+//   gcc -O2 -I$S pcm_convert_bench.c $S/fixed_point.c $S/adpcm.c -lm -o pcm_convert_bench
+//   ./pcm_convert_bench
+// CPU_MHZ only scales the cycle column; set it to the core clock under test.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include "fixed_point.h"
+#include "adpcm.h"
+
+#ifndef CPU_MHZ
+#define CPU_MHZ 1333.0        // KV260 A53 cluster
+#endif
+
+#define BURST   256           // CAPTURE_BURST_SAMPLES
+#define PLAY    1024          // PLAYBACK_SAMPLES
+#define REPS    20000
+
+// The loops as they were in helloworld before the batch kernels
+static uint16_t swap_bits_u16(uint16_t word) {
+    uint16_t ret = 0;
+    for (int i = 0; i < (int)sizeof(uint16_t) * 8; i++) {
+        if ((0b1 << i) & word) {
+            ret |= 1 << (sizeof(uint16_t) * 8 - 1 - i);
+        }
+    }
+    return ret;
+}
+
+static inline int16_t to_pcm16(uint32_t w) {
+    return (int16_t)((int32_t)w >> 2);
+}
+
+static void capture_ref(const uint32_t* rx, int16_t* pcm, int n) {
+    for (int i = 0; i < n; ++i) {
+        pcm[i] = swap_bits_u16(to_pcm16(rx[i]));
+    }
+}
+
+static void playback_ref(const int16_t* pcm, uint32_t* tx, int n) {
+    for (int i = 0; i < n; i++) {
+        uint32_t w = (uint32_t)((int32_t)pcm[i] << 16);
+        tx[2*i]   = w;
+        tx[2*i+1] = w;
+    }
+}
+
+static double now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// Keeps the compiler from dropping the timed calls
+static volatile uint32_t sink;
+
+static void report(const char* name, double ns, int samples) {
+    double per = ns / ((double)REPS * samples);
+    printf("  %-28s %7.3f ns/sample  %6.2f cycles/sample\n", name, per, per * CPU_MHZ / 1000.0);
+}
+
+int main(void) {
+    static uint32_t rx[BURST];
+    static int16_t pcm_a[BURST], pcm_b[BURST];
+    static int16_t play[PLAY];
+    static uint32_t tx_a[2 * PLAY], tx_b[2 * PLAY];
+
+    srand(1);
+    for (int i = 0; i < BURST; i++) rx[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+    for (int i = 0; i < PLAY; i++) play[i] = (int16_t)(rand() - RAND_MAX / 2);
+
+    // Bit-exactness first: every 18-bit pattern, then odd lengths and offsets
+    // so the vector body and the scalar tail are both exercised
+    for (uint32_t w = 0; w < (1u << 18); w++) {
+        uint32_t word = (w << 14) | (w & 0x3FFF);
+        if (pcm_from_capture_word(word) != (int16_t)swap_bits_u16(to_pcm16(word))) {
+            printf("capture mismatch at 0x%08x\n", (unsigned)word);
+            return 1;
+        }
+    }
+    for (int off = 0; off < 4; off++) {
+        for (int n = 0; n + off <= BURST; n += 7) {
+            capture_ref(rx + off, pcm_a, n);
+            pcm_from_capture(rx + off, pcm_b, n);
+            if (memcmp(pcm_a, pcm_b, n * sizeof(int16_t)) != 0) {
+                printf("capture burst mismatch, offset %d length %d\n", off, n);
+                return 1;
+            }
+            playback_ref(play + off, tx_a, n);
+            pcm_to_playback(play + off, tx_b, n);
+            if (memcmp(tx_a, tx_b, 2 * n * sizeof(uint32_t)) != 0) {
+                printf("playback mismatch, offset %d length %d\n", off, n);
+                return 1;
+            }
+        }
+    }
+    printf("bit-exact: capture and playback conversions match the old loops\n");
+
+#if defined(__ARM_NEON)
+    printf("kernels: NEON\n");
+#else
+    printf("kernels: scalar fallback\n");
+#endif
+    printf("capture burst (%d samples):\n", BURST);
+    double t0 = now_ns();
+    for (int r = 0; r < REPS; r++) { rx[r % BURST] ^= 1u << 20; capture_ref(rx, pcm_a, BURST); sink += (uint16_t)pcm_a[r % BURST]; }
+    double t1 = now_ns();
+    for (int r = 0; r < REPS; r++) { rx[r % BURST] ^= 1u << 20; pcm_from_capture(rx, pcm_b, BURST); sink += (uint16_t)pcm_b[r % BURST]; }
+    double t2 = now_ns();
+    report("before (swap_bits_u16 loop)", t1 - t0, BURST);
+    report("after  (pcm_from_capture)", t2 - t1, BURST);
+
+    printf("playback buffer (%d samples):\n", PLAY);
+    t0 = now_ns();
+    for (int r = 0; r < REPS; r++) { play[r % PLAY] ^= 1; playback_ref(play, tx_a, PLAY); sink += tx_a[r % (2 * PLAY)]; }
+    t1 = now_ns();
+    for (int r = 0; r < REPS; r++) { play[r % PLAY] ^= 1; pcm_to_playback(play, tx_b, PLAY); sink += tx_b[r % (2 * PLAY)]; }
+    t2 = now_ns();
+    report("before (per-sample loop)", t1 - t0, PLAY);
+    report("after  (pcm_to_playback)", t2 - t1, PLAY);
+
+    // ADPCM: a block of a 440 Hz tone must come back within a few LSBs' noise
+    static int16_t tone[ADPCM_BLOCK_SAMPLES], back[ADPCM_BLOCK_SAMPLES];
+    static uint8_t block[ADPCM_BLOCK_BYTES];
+    AdpcmState enc, dec;
+    double sig = 0, err = 0;
+    for (int i = 0; i < ADPCM_BLOCK_SAMPLES; i++) {
+        tone[i] = (int16_t)(12000.0 * sin(2 * 3.14159265358979 * 440.0 * i / 48000.0));
+    }
+    adpcm_init(&enc);
+    adpcm_block_begin(&enc, tone[0], block);
+    adpcm_encode(&enc, tone + 1, block, 1, ADPCM_BLOCK_SAMPLES - 1);
+    back[0] = adpcm_block_header(&dec, block);
+    adpcm_decode(&dec, block, 1, back + 1, ADPCM_BLOCK_SAMPLES - 1);
+    for (int i = 0; i < ADPCM_BLOCK_SAMPLES; i++) {
+        sig += (double)tone[i] * tone[i];
+        err += (double)(tone[i] - back[i]) * (tone[i] - back[i]);
+    }
+    double snr = 10 * log10(sig / (err > 0 ? err : 1));
+    if (snr < 30) {
+        printf("ADPCM round trip SNR %.1f dB\n", snr);
+        return 1;
+    }
+
+    // One burst at a time through a block, as wav_writer_write does
+    printf("ADPCM, %d samples per burst (round trip SNR %.1f dB):\n", BURST, snr);
+    const int bursts = (ADPCM_BLOCK_SAMPLES - 1) / BURST;
+    t0 = now_ns();
+    for (int r = 0; r < REPS; r++) {
+        int b = r % bursts;
+        if (b == 0) adpcm_block_begin(&enc, tone[0], block);
+        adpcm_encode(&enc, play + (r % (PLAY - BURST)), block, 1 + b * BURST, BURST);
+        sink += block[4 + b * BURST / 2];
+    }
+    t1 = now_ns();
+    for (int r = 0; r < REPS; r++) {
+        int b = r % bursts;
+        if (b == 0) adpcm_block_header(&dec, block);
+        adpcm_decode(&dec, block, 1 + b * BURST, pcm_b, BURST);
+        sink += (uint16_t)pcm_b[r % BURST];
+    }
+    t2 = now_ns();
+    report("adpcm_encode", t1 - t0, BURST);
+    report("adpcm_decode", t2 - t1, BURST);
+    double enc_cycles = (t1 - t0) / ((double)REPS * BURST) * CPU_MHZ / 1000.0;
+    printf("  encoder %s ADPCM_ENCODE_BUDGET (%d cycles/sample at CPU_MHZ)\n",
+           enc_cycles <= ADPCM_ENCODE_BUDGET ? "within" : "OVER", ADPCM_ENCODE_BUDGET);
+    return 0;
+}
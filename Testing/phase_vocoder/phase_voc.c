@@ -7,10 +7,9 @@
 #define M_PI 3.14159265358979323846
 #endif
 
-// Configuration
+// Defaults; both can be given on the command line
 #define FFT_SIZE 2048
 #define HOP_SIZE 512
-#define OVERLAP_FACTOR (FFT_SIZE / HOP_SIZE)
 
 // Structure to hold audio data
 typedef struct {
@@ -100,7 +99,7 @@ static inline float wrap_phase(float phase) {
 }
 
 // Phase vocoder pitch shifting
-AudioBuffer* phase_vocoder_pitch_shift(AudioBuffer* input, float pitch_ratio) {
+AudioBuffer* phase_vocoder_pitch_shift(AudioBuffer* input, float pitch_ratio, int fft_size, int hop) {
     printf("Starting Phase Vocoder pitch shift with ratio: %.3f\n", pitch_ratio);
     
     // Clamp pitch ratio
@@ -119,28 +118,28 @@ AudioBuffer* phase_vocoder_pitch_shift(AudioBuffer* input, float pitch_ratio) {
     float* temp_output = (float*)calloc(stretched_length, sizeof(float));
     
     // Allocate working buffers
-    float* window = (float*)malloc(FFT_SIZE * sizeof(float));
-    Complex* fft_in = (Complex*)malloc(FFT_SIZE * sizeof(Complex));
-    Complex* fft_out = (Complex*)malloc(FFT_SIZE * sizeof(Complex));
-    float* magnitude_buf = (float*)malloc(FFT_SIZE * sizeof(float));
-    float* phase_buf = (float*)malloc(FFT_SIZE * sizeof(float));
-    float* last_phase = (float*)calloc(FFT_SIZE, sizeof(float));
-    float* sum_phase = (float*)calloc(FFT_SIZE, sizeof(float));
+    float* window = (float*)malloc(fft_size * sizeof(float));
+    Complex* fft_in = (Complex*)malloc(fft_size * sizeof(Complex));
+    Complex* fft_out = (Complex*)malloc(fft_size * sizeof(Complex));
+    float* magnitude_buf = (float*)malloc(fft_size * sizeof(float));
+    float* phase_buf = (float*)malloc(fft_size * sizeof(float));
+    float* last_phase = (float*)calloc(fft_size, sizeof(float));
+    float* sum_phase = (float*)calloc(fft_size, sizeof(float));
     
     // Generate Hanning window
-    for (int i = 0; i < FFT_SIZE; i++) {
-        window[i] = hanning(i, FFT_SIZE);
+    for (int i = 0; i < fft_size; i++) {
+        window[i] = hanning(i, fft_size);
     }
     
     // Calculate analysis and synthesis hop sizes for TIME STRETCHING
-    int analysis_hop = HOP_SIZE;
-    int synthesis_hop = (int)(HOP_SIZE * time_stretch_ratio);
+    int analysis_hop = hop;
+    int synthesis_hop = (int)(hop * time_stretch_ratio);
     if (synthesis_hop < 1) synthesis_hop = 1;
     
     printf("FFT size: %d, Analysis hop: %d, Synthesis hop: %d (time stretch: %.3f)\n", 
-           FFT_SIZE, analysis_hop, synthesis_hop, time_stretch_ratio);
+           fft_size, analysis_hop, synthesis_hop, time_stretch_ratio);
     
-    int num_frames = (input->length - FFT_SIZE) / analysis_hop;
+    int num_frames = (input->length - fft_size) / analysis_hop;
     int output_pos = 0;
     
     // Process each frame
@@ -148,26 +147,26 @@ AudioBuffer* phase_vocoder_pitch_shift(AudioBuffer* input, float pitch_ratio) {
         int input_pos = frame * analysis_hop;
         
         // Skip if we're too close to the end
-        if (input_pos + FFT_SIZE > input->length) break;
-        if (output_pos + FFT_SIZE > stretched_length) break;
+        if (input_pos + fft_size > input->length) break;
+        if (output_pos + fft_size > stretched_length) break;
         
         // 1. Extract and window the frame
-        for (int i = 0; i < FFT_SIZE; i++) {
+        for (int i = 0; i < fft_size; i++) {
             fft_in[i].real = input->data[input_pos + i] * window[i];
             fft_in[i].imag = 0.0f;
         }
         
         // 2. Forward FFT
-        fft(fft_in, FFT_SIZE);
+        fft(fft_in, fft_size);
         
         // 3. Extract magnitude and phase
-        for (int i = 0; i < FFT_SIZE; i++) {
+        for (int i = 0; i < fft_size; i++) {
             magnitude_buf[i] = magnitude(fft_in[i]);
             phase_buf[i] = phase(fft_in[i]);
         }
         
         // 4. Phase vocoder processing
-        for (int i = 0; i < FFT_SIZE / 2; i++) {
+        for (int i = 0; i < fft_size / 2; i++) {
             // Calculate phase difference
             float phase_diff = phase_buf[i] - last_phase[i];
             last_phase[i] = phase_buf[i];
@@ -176,14 +175,14 @@ AudioBuffer* phase_vocoder_pitch_shift(AudioBuffer* input, float pitch_ratio) {
             phase_diff = wrap_phase(phase_diff);
             
             // Calculate instantaneous frequency
-            float expected_phase_diff = 2.0f * M_PI * i * analysis_hop / FFT_SIZE;
+            float expected_phase_diff = 2.0f * M_PI * i * analysis_hop / fft_size;
             float freq_deviation = (phase_diff - expected_phase_diff);
             
             // Unwrap frequency deviation
             freq_deviation = wrap_phase(freq_deviation);
             
             // Calculate true frequency
-            float true_freq = 2.0f * M_PI * i / FFT_SIZE + freq_deviation / analysis_hop;
+            float true_freq = 2.0f * M_PI * i / fft_size + freq_deviation / analysis_hop;
             
             // Accumulate phase for synthesis
             sum_phase[i] += true_freq * synthesis_hop;
@@ -194,16 +193,16 @@ AudioBuffer* phase_vocoder_pitch_shift(AudioBuffer* input, float pitch_ratio) {
         }
         
         // Mirror for negative frequencies
-        for (int i = FFT_SIZE / 2; i < FFT_SIZE; i++) {
-            fft_out[i].real = fft_out[FFT_SIZE - i].real;
-            fft_out[i].imag = -fft_out[FFT_SIZE - i].imag;
+        for (int i = fft_size / 2; i < fft_size; i++) {
+            fft_out[i].real = fft_out[fft_size - i].real;
+            fft_out[i].imag = -fft_out[fft_size - i].imag;
         }
         
         // 5. Inverse FFT
-        ifft(fft_out, FFT_SIZE);
+        ifft(fft_out, fft_size);
         
         // 6. Overlap-add to temp output with window
-        for (int i = 0; i < FFT_SIZE; i++) {
+        for (int i = 0; i < fft_size; i++) {
             if (output_pos + i < stretched_length) {
                 temp_output[output_pos + i] += fft_out[i].real * window[i];
             }
@@ -216,7 +215,7 @@ AudioBuffer* phase_vocoder_pitch_shift(AudioBuffer* input, float pitch_ratio) {
     printf("Processed %d frames, stretched output length: %d samples\n", num_frames, output_pos);
     
     // Normalize time-stretched audio to account for overlap-add
-    float overlap_norm = 2.0f / OVERLAP_FACTOR;
+    float overlap_norm = 2.0f / (fft_size / hop);
     for (int i = 0; i < output_pos && i < stretched_length; i++) {
         temp_output[i] *= overlap_norm;
     }
@@ -447,11 +446,12 @@ int write_wav_file(const char* filename, AudioBuffer* audio) {
 // Example usage
 int main(int argc, char* argv[]) {
     if (argc < 3) {
-        printf("Usage: %s <input.wav> <pitch_ratio> [output.wav]\n", argv[0]);
+        printf("Usage: %s <input.wav> <pitch_ratio> [output.wav] [fft_size] [hop]\n", argv[0]);
         printf("Examples:\n");
         printf("  %s input.wav 1.5 output.wav      # Shift up 1.5x (perfect fifth)\n", argv[0]);
         printf("  %s input.wav 0.5 output.wav      # Shift down to half pitch (octave down)\n", argv[0]);
         printf("  %s input.wav 1.25992 output.wav  # Shift up 4 semitones\n", argv[0]);
+        printf("  %s input.wav 0.5 output.wav 4096 1024  # Bass: longer frames\n", argv[0]);
         printf("\nCommon pitch ratios:\n");
         printf("  +1 semitone = 1.05946\n");
         printf("  +4 semitones = 1.25992\n");
@@ -463,11 +463,17 @@ int main(int argc, char* argv[]) {
     const char* input_file = argv[1];
     float pitch_ratio = atof(argv[2]);
     const char* output_file = (argc > 3) ? argv[3] : "output.wav";
+    int fft_size = (argc > 4) ? atoi(argv[4]) : FFT_SIZE;
+    int hop = (argc > 5) ? atoi(argv[5]) : fft_size / (FFT_SIZE / HOP_SIZE);
     
     if (pitch_ratio <= 0.0f) {
         printf("Error: Pitch ratio must be positive\n");
         return 1;
     }
+    if (fft_size < 8 || (fft_size & (fft_size - 1)) != 0 || hop < 1 || hop > fft_size / 4) {
+        printf("Error: FFT size must be a power of two >= 8 and hop 1 .. fft_size/4\n");
+        return 1;
+    }
     
     // Load input WAV file
     AudioBuffer* input = read_wav_file(input_file);
@@ -479,7 +485,7 @@ int main(int argc, char* argv[]) {
     printf("Pitch ratio: %.5f (%.2f semitones)\n", pitch_ratio, 12.0f * log2f(pitch_ratio));
     
     // Perform pitch shift
-    AudioBuffer* output = phase_vocoder_pitch_shift(input, pitch_ratio);
+    AudioBuffer* output = phase_vocoder_pitch_shift(input, pitch_ratio, fft_size, hop);
     
     if (output) {
         // Write output
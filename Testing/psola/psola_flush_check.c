@@ -0,0 +1,122 @@
+// Check that psola_flush_q15 keeps the pitch period fixed while it drains.
+//
+// The flush pushes silence through the rings to bring out the last grains.
+// A tracking context must not estimate on that silence: the newest frame
+// still holds the tail of the take, so an estimate would change the period
+// of the final grains. Yin is stubbed here so the check can count the
+// estimates made during the flush and choose what they would return.
+// Each take is flushed twice: once with the stub reporting a pitch an
+// octave up during the flush, once with it reporting unvoiced. Both flushes
+// must make no estimates and give identical output.
+//
+// Build and run from this directory on any host:
+//   S=../../audio_tuner_software/src
+//   gcc -O2 -I$S psola_flush_check.c $S/psola.c $S/arena.c $S/dlog.c -lm -o psola_flush_check
+//   ./psola_flush_check
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "psola.h"
+#include "Yin.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define TAKE_SAMPLES    24000
+#define BLOCK           256
+#define TONE_HZ         200.0f
+
+// What the stubbed Yin reports, and how often it was asked
+static float stub_pitch;
+static float stub_probability;
+static int stub_calls;
+static char stub_workspace[1];
+static float stub_buffer[1];
+
+void Yin_init(Yin *yin, int bufferSize, float threshold) {
+    memset(yin, 0, sizeof(*yin));
+    yin->bufferSize = bufferSize;
+    yin->threshold = threshold;
+    yin->yinBuffer = stub_buffer;
+    yin->workspace = stub_workspace;
+}
+
+void Yin_free(Yin *yin) {
+    yin->yinBuffer = NULL;
+    yin->workspace = NULL;
+}
+
+void Yin_setRange(Yin *yin, float minFrequency, float maxFrequency) {
+    (void)yin;
+    (void)minFrequency;
+    (void)maxFrequency;
+}
+
+float Yin_getPitch(Yin *yin, int16_t* buffer) {
+    (void)yin;
+    (void)buffer;
+    stub_calls++;
+    return stub_pitch;
+}
+
+float Yin_getProbability(Yin *yin) {
+    (void)yin;
+    return stub_probability;
+}
+
+// Run one take through a tracking context, then flush it with the stub
+// reporting flush_pitch / flush_probability; returns the flush output length
+static int run_take(float flush_pitch, float flush_probability, int16_t* flushed, int* flush_calls) {
+    static int16_t in[BLOCK];
+    static int16_t out[BLOCK];
+    Psola* ps = psola_create(PSOLA_DEFAULT_MAX_PERIOD, 1.5f, 1);
+    if (!ps) return -1;
+
+    stub_pitch = TONE_HZ;
+    stub_probability = 0.9f;
+    for (int done = 0; done < TAKE_SAMPLES; done += BLOCK) {
+        for (int i = 0; i < BLOCK; i++) {
+            in[i] = (int16_t)(12000.0f * sinf(2.0f * (float)M_PI * TONE_HZ * (done + i) / YIN_SAMPLING_RATE));
+        }
+        psola_process_q15(ps, in, BLOCK, out);
+    }
+
+    stub_pitch = flush_pitch;
+    stub_probability = flush_probability;
+    stub_calls = 0;
+    int n = psola_flush_q15(ps, flushed);
+    *flush_calls = stub_calls;
+    psola_destroy(ps);
+    return n;
+}
+
+int main(void) {
+    static int16_t voiced[PSOLA_FLUSH_ROOM(PSOLA_DEFAULT_MAX_PERIOD)];
+    static int16_t unvoiced[PSOLA_FLUSH_ROOM(PSOLA_DEFAULT_MAX_PERIOD)];
+    int voiced_calls = 0;
+    int unvoiced_calls = 0;
+    int failures = 0;
+
+    int nv = run_take(2.0f * TONE_HZ, 1.0f, voiced, &voiced_calls);
+    int nu = run_take(-1.0f, 0.0f, unvoiced, &unvoiced_calls);
+    printf("flush: %d samples, %d estimates (octave up stub), %d samples, %d estimates (unvoiced stub)\n",
+           nv, voiced_calls, nu, unvoiced_calls);
+
+    if (nv <= 0 || nv != nu) {
+        printf("flush lengths differ or are empty\n");
+        failures++;
+    }
+    if (voiced_calls != 0 || unvoiced_calls != 0) {
+        printf("pitch estimated on the flush silence\n");
+        failures++;
+    }
+    if (nv == nu && nv > 0 && memcmp(voiced, unvoiced, nv * sizeof(int16_t)) != 0) {
+        printf("flush output depends on the estimate: the period changed during the flush\n");
+        failures++;
+    }
+
+    printf(failures ? "FAIL\n" : "PASS: the period is unchanged across the flush\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,130 @@
+// Check and micro-benchmark for the table-driven note quantiser (scale.c).
+//
+// Compares scale_log2, scale_note_frequency and scale_quantize_note against
+// libm and a brute-force search over every MIDI note, for the chromatic,
+// major, minor and pentatonic scales in every key, then times the
+// quantiser against the powf/logf round trip helloworld used to do.
+//
+// Build and run from this directory on any host:
+//   S=../../audio_tuner_software/src
+//   gcc -O2 -I$S scale_check.c $S/scale.c -lm -o scale_check
+//   ./scale_check
+// CPU_MHZ only scales the cycle column; set it to the core clock under test.
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include "scale.h"
+
+#ifndef CPU_MHZ
+#define CPU_MHZ 1333.0        // KV260 A53 cluster
+#endif
+
+#define REPS    2000000
+
+static const uint16_t masks[] = {
+    SCALE_CHROMATIC, SCALE_MAJOR, SCALE_MINOR, SCALE_MAJOR_PENTATONIC, SCALE_MINOR_PENTATONIC
+};
+
+// Nearest allowed note by search; ties go down like scale_quantize_note
+static int nearest_ref(int key, uint16_t mask, double midi) {
+    int best = -1;
+    double best_d = 1e9;
+    for (int n = 0; n < 128; n++) {
+        int rel = ((n - key) % 12 + 12) % 12;
+        double d = fabs(n - midi);
+        if ((mask & (1 << rel)) && d < best_d - 1e-9) {
+            best = n;
+            best_d = d;
+        }
+    }
+    return best;
+}
+
+// The helper as it was in helloworld before scale.c
+static float ratio_ref(float pitch) {
+    float note = (float)(int)(12.0f * logf(pitch / 440.0f) / logf(2.0f) + 69.0f + 0.5f);
+    return 440.0f * powf(2.0f, (note - 69.0f) / 12.0f) / pitch;
+}
+
+static double now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// Keeps the compiler from dropping the timed calls
+static volatile float sink;
+
+int main(void) {
+    int failures = 0;
+
+    double log_err = 0.0;
+    for (float x = 20.0f; x < 20000.0f; x *= 1.0001f) {
+        double e = fabs(scale_log2(x) - log2(x)) * 1200.0;
+        if (e > log_err) log_err = e;
+    }
+    printf("scale_log2 worst error:            %.4f cents\n", log_err);
+    failures += log_err > 0.1;
+
+    double freq_err = 0.0;
+    for (int n = 0; n < 128; n++) {
+        double ref = 440.0 * pow(2.0, (n - 69) / 12.0);
+        double e = fabs(scale_note_frequency(&scale_chromatic, n) / ref - 1.0);
+        if (e > freq_err) freq_err = e;
+    }
+    printf("scale_note_frequency worst error:  %.2e\n", freq_err);
+    failures += freq_err > 1e-6;
+
+    int wrong = 0, checked = 0;
+    double ratio_err = 0.0;
+    for (int m = 0; m < (int)(sizeof(masks) / sizeof(masks[0])); m++) {
+        for (int key = 0; key < 12; key++) {
+            Scale s;
+            scale_init(&s, key, masks[m], SCALE_A4);
+            for (float p = 30.0f; p < 4000.0f; p *= 1.0007f) {
+                double midi = 69.0 + 12.0 * log2(p / 440.0);
+                float ratio;
+                int note = scale_quantize_note(&s, p, &ratio);
+                int ref = nearest_ref(key, masks[m], midi);
+                double e = fabs(1200.0 * log2(ratio * p / (440.0 * pow(2.0, (note - 69) / 12.0))));
+                if (e > ratio_err) ratio_err = e;
+                // Pitches within the log2 error (0.1 cent) of half way may go either way
+                if (note != ref && fabs(fabs(note - midi) - fabs(ref - midi)) > 1e-3) {
+                    wrong++;
+                }
+                checked++;
+            }
+        }
+    }
+    printf("scale_quantize_note mismatches:    %d of %d\n", wrong, checked);
+    printf("scale_quantize_note ratio error:   %.4f cents\n", ratio_err);
+    failures += wrong != 0 || ratio_err > 0.1;
+
+    Scale empty;
+    failures += scale_init(&empty, 0, 0, SCALE_A4) != -1;
+
+    float p = 80.0f, acc = 0.0f;
+    double t0 = now_ns();
+    for (int i = 0; i < REPS; i++) {
+        float r;
+        scale_quantize_note(&scale_chromatic, p, &r);
+        acc += r;
+        p = p < 1000.0f ? p * 1.0001f : 80.0f;
+    }
+    double t1 = now_ns();
+    p = 80.0f;
+    for (int i = 0; i < REPS; i++) {
+        acc += ratio_ref(p);
+        p = p < 1000.0f ? p * 1.0001f : 80.0f;
+    }
+    double t2 = now_ns();
+    sink = acc;
+
+    double q = (t1 - t0) / REPS, ref = (t2 - t1) / REPS;
+    printf("  %-28s %7.2f ns/call  %6.1f cycles/call\n", "scale_quantize_note", q, q * CPU_MHZ / 1000.0);
+    printf("  %-28s %7.2f ns/call  %6.1f cycles/call\n", "logf/powf", ref, ref * CPU_MHZ / 1000.0);
+
+    printf(failures ? "FAIL\n" : "PASS\n");
+    return failures ? 1 : 0;
+}
@@ -1,11 +1,77 @@
 #include <stdint.h> /* For standard interger types (int16_t) */
-#include <stdlib.h> /* For call to malloc */
+#include <stdlib.h>
 #include "Yin.h"
+#include "fft.h"
+#include "arena.h"
+#include "prof.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/* Every piece carved out of the workspace starts on an 8-byte boundary */
+#define YIN_ALIGN(bytes) (((bytes) + 7) & ~(size_t)7)
+
+/* Workspace for the FFT difference function */
+struct _YinFFT {
+	RealFFTPlan plan;		/**< Real transform of fftSize points */
+	int fftSize;			/**< Power of two >= bufferSize, so the correlation does not wrap */
+	float* frame;			/**< Zero-padded input / correlation output */
+	Complex* window;		/**< Spectrum of the first halfBufferSize samples */
+	Complex* signal;		/**< Spectrum of the whole buffer */
+};
 
 /* ------------------------------------------------------------------------------------------
 --------------------------------------------------------------------------- PRIVATE FUNCTIONS
 -------------------------------------------------------------------------------------------*/
 
+/**
+ * Exact squared difference of two runs of samples (scalar reference)
+ * @param a First run
+ * @param b Second run
+ * @param n Samples in each run
+ * @return  sum (a[i] - b[i])^2 for i < n
+ */
+uint64_t Yin_squaredDifferenceScalar(const int16_t* a, const int16_t* b, int n){
+	uint64_t sum = 0;
+	int i;
+
+	/* |a - b| < 2^16, so each square fits 32 unsigned bits */
+	for(i = 0; i < n; i++){
+		int32_t delta = a[i] - b[i];
+		sum += (uint32_t)delta * (uint32_t)delta;
+	}
+	return sum;
+}
+
+/**
+ * Exact squared difference of two runs of samples (NEON on the A53)
+ * @param a First run
+ * @param b Second run
+ * @param n Samples in each run
+ * @return  sum (a[i] - b[i])^2 for i < n, identical to Yin_squaredDifferenceScalar
+ */
+uint64_t Yin_squaredDifference(const int16_t* a, const int16_t* b, int n){
+#if defined(__ARM_NEON)
+	uint64x2_t acc0 = vdupq_n_u64(0);
+	uint64x2_t acc1 = vdupq_n_u64(0);
+	int i;
+
+	/* 8 samples per pass: |a - b| wraps into 16 bits but is exact read as unsigned,
+	 * the widening multiply squares it into 32 bits and the pairwise add-accumulate
+	 * widens again into 64, so nothing can overflow */
+	for(i = 0; i + 8 <= n; i += 8){
+		uint16x8_t d = vreinterpretq_u16_s16(vabdq_s16(vld1q_s16(a + i), vld1q_s16(b + i)));
+		acc0 = vpadalq_u32(acc0, vmull_u16(vget_low_u16(d), vget_low_u16(d)));
+		acc1 = vpadalq_u32(acc1, vmull_high_u16(d, d));
+	}
+
+	return vaddvq_u64(acc0) + vaddvq_u64(acc1) + Yin_squaredDifferenceScalar(a + i, b + i, n - i);
+#else
+	return Yin_squaredDifferenceScalar(a, b, n);
+#endif
+}
+
 /**
  * Step 1: Calculates the squared difference of the signal with a shifted version of itself.
  * @param buffer Buffer of samples to process.
@@ -14,55 +80,119 @@
  * for more details on what is in here and why it's done this way.
  */
 void Yin_difference(Yin *yin, int16_t* buffer){
-	int16_t i;
-	int16_t tau;
-	float delta;
+	int tau;
 
-	/* Calculate the difference for difference shift values (tau) for the half of the samples */
-	for(tau = 0 ; tau < yin->halfBufferSize; tau++){
+	/* Calculate the difference for difference shift values (tau) for the half of the samples,
+	 * stopping at the longest period still inside the frequency range */
+	PROF_START(PROF_YIN_DIFF);
+	for(tau = 0 ; tau < yin->tauMax; tau++){
 
 		/* Take the difference of the signal with a shifted version of itself, then square it.
-		 * (This is the Yin algorithm's tweak on autocorellation) */
-		for(i = 0; i < yin->halfBufferSize; i++){
-			delta = buffer[i] - buffer[i + tau];
-			yin->yinBuffer[tau] += delta * delta;
-		}
+		 * (This is the Yin algorithm's tweak on autocorellation)
+		 * The sum is exact in integers and written fresh for every lag */
+		yin->yinBuffer[tau] = (float)Yin_squaredDifference(buffer, buffer + tau, yin->halfBufferSize);
+	}
+	PROF_STOP(PROF_YIN_DIFF);
+}
+
+
+/**
+ * Step 1 (large buffers): the same difference function from the autocorrelation.
+ * @param buffer Buffer of samples to process.
+ *
+ * With W = halfBufferSize, d(tau) = sum x[i]^2 + sum x[i+tau]^2 - 2 r(tau) over i < W,
+ * where r(tau) = sum x[i] x[i+tau] is the cross-correlation of the first W samples with
+ * the whole buffer, taken from an FFT. The energy terms are exact integer sliding sums.
+ */
+void Yin_differenceFFT(Yin *yin, int16_t* buffer){
+	struct _YinFFT* fft = yin->fft;
+	const int W = yin->halfBufferSize;
+	const int L = fft->fftSize;
+	int i;
+	int tau;
+
+	PROF_START(PROF_YIN_DIFF);
+
+	/* Spectrum of the first W samples (zero-padded) */
+	for(i = 0; i < W; i++){
+		fft->frame[i] = buffer[i];
+	}
+	for(; i < L; i++){
+		fft->frame[i] = 0;
+	}
+	rfft_forward(&fft->plan, fft->frame, fft->window);
+
+	/* Spectrum of the whole buffer (zero-padded) */
+	for(i = 0; i < 2 * W; i++){
+		fft->frame[i] = buffer[i];
+	}
+	rfft_forward(&fft->plan, fft->frame, fft->signal);
+
+	/* r(tau) = IFFT(conj(A) * B); no wrap-around because L >= 2W */
+	for(i = 0; i <= L / 2; i++){
+		Complex a = fft->window[i];
+		Complex b = fft->signal[i];
+		fft->signal[i].real = a.real * b.real + a.imag * b.imag;
+		fft->signal[i].imag = a.real * b.imag - a.imag * b.real;
+	}
+	rfft_inverse(&fft->plan, fft->signal, fft->frame);
+
+	/* Energy of the window at 0 and at tau (sliding, exact in 64 bits) */
+	int64_t energy0 = 0;
+	for(i = 0; i < W; i++){
+		energy0 += (int32_t)buffer[i] * buffer[i];
+	}
+	int64_t energyTau = energy0;
+
+	for(tau = 0; tau < yin->tauMax; tau++){
+		float d = (float)(energy0 + energyTau) - 2.0f * fft->frame[tau];
+		yin->yinBuffer[tau] = d > 0 ? d : 0;
+
+		energyTau += (int32_t)buffer[tau + W] * buffer[tau + W] - (int32_t)buffer[tau] * buffer[tau];
 	}
+	PROF_STOP(PROF_YIN_DIFF);
 }
 
 
 /**
  * Step 2: Calculate the cumulative mean on the normalised difference calculated in step 1
- * @param yin #Yin structure with information about the signal
+ * @param yin   #Yin structure with information about the signal
+ * @param limit Number of lags computed in step 1
  *
  * This goes through the Yin autocorellation values and finds out roughly where shift is which
  * produced the smallest difference
  */
-void Yin_cumulativeMeanNormalizedDifference(Yin *yin){
-	int16_t tau;
+void Yin_cumulativeMeanNormalizedDifference(Yin *yin, int limit){
+	int tau;
 	float runningSum = 0;
+	PROF_START(PROF_YIN_CMND);
 	yin->yinBuffer[0] = 1;
 
 	/* Sum all the values in the autocorellation buffer and nomalise the result, replacing
 	 * the value in the autocorellation buffer with a cumulative mean of the normalised difference */
-	for (tau = 1; tau < yin->halfBufferSize; tau++) {
+	for (tau = 1; tau < limit; tau++) {
 		runningSum += yin->yinBuffer[tau];
 		yin->yinBuffer[tau] *= tau / runningSum;
 	}
+	PROF_STOP(PROF_YIN_CMND);
 }
 
 /**
  * Step 3: Search through the normalised cumulative mean array and find values that are over the threshold
+ * @param  first Shortest lag to consider (at least 2)
+ * @param  limit Number of lags in yinBuffer
  * @return Shift (tau) which caused the best approximate autocorellation. -1 if no suitable value is found over the threshold.
  */
-int16_t Yin_absoluteThreshold(Yin *yin){
-	int16_t tau;
+int Yin_absoluteThreshold(Yin *yin, int first, int limit){
+	int tau;
+
+	PROF_START(PROF_YIN_THRESH);
 
 	/* Search through the array of cumulative mean values, and look for ones that are over the threshold
-	 * The first two positions in yinBuffer are always so start at the third (index 2) */
-	for (tau = 2; tau < yin->halfBufferSize ; tau++) {
+	 * The first two positions in yinBuffer are always so start at the third (index 2) at the earliest */
+	for (tau = first; tau < limit ; tau++) {
 		if (yin->yinBuffer[tau] < yin->threshold) {
-			while (tau + 1 < yin->halfBufferSize && yin->yinBuffer[tau + 1] < yin->yinBuffer[tau]) {
+			while (tau + 1 < limit && yin->yinBuffer[tau + 1] < yin->yinBuffer[tau]) {
 				tau++;
 			}
 			/* found tau, exit loop and return
@@ -80,11 +210,12 @@ int16_t Yin_absoluteThreshold(Yin *yin){
 	}
 
 	/* if no pitch found, tau => -1 */
-	if (tau == yin->halfBufferSize || yin->yinBuffer[tau] >= yin->threshold) {
+	if (tau >= limit || yin->yinBuffer[tau] >= yin->threshold) {
 		tau = -1;
 		yin->probability = 0;
 	}
 
+	PROF_STOP(PROF_YIN_THRESH);
 	return tau;
 }
 
@@ -92,16 +223,17 @@ int16_t Yin_absoluteThreshold(Yin *yin){
  * Step 5: Interpolate the shift value (tau) to improve the pitch estimate.
  * @param  yin         [description]
  * @param  tauEstimate [description]
+ * @param  limit       Number of lags in yinBuffer
  * @return             [description]
  *
  * The 'best' shift value for autocorellation is most likely not an interger shift of the signal.
  * As we only autocorellated using integer shifts we should check that there isn't a better fractional
  * shift value.
  */
-float Yin_parabolicInterpolation(Yin *yin, int16_t tauEstimate) {
+float Yin_parabolicInterpolation(Yin *yin, int tauEstimate, int limit) {
 	float betterTau;
-	int16_t x0;
-	int16_t x2;
+	int x0;
+	int x2;
 
 	/* Calculate the first polynomial coeffcient based on the current estimate of tau */
 	if (tauEstimate < 1) {
@@ -112,7 +244,7 @@ float Yin_parabolicInterpolation(Yin *yin, int16_t tauEstimate) {
 	}
 
 	/* Calculate the second polynomial coeffcient based on the current estimate of tau */
-	if (tauEstimate + 1 < yin->halfBufferSize) {
+	if (tauEstimate + 1 < limit) {
 		x2 = tauEstimate + 1;
 	}
 	else {
@@ -154,6 +286,168 @@ float Yin_parabolicInterpolation(Yin *yin, int16_t tauEstimate) {
 
 
 
+/**
+ * Fine stage of the coarse-to-fine search: the full-rate difference function around a
+ * lag found on the decimated signal, with parabolic interpolation of its minimum
+ * @param  coarseTau Lag picked on the decimated signal
+ * @return           Better estimate of the full-rate lag
+ */
+static float Yin_refine(Yin *yin, int coarseTau){
+	const int16_t* buffer = yin->source;
+	const int center = coarseTau * YIN_DECIMATION;
+	int lo = center - YIN_DECIMATION;
+	int hi = center + YIN_DECIMATION;
+	float d[2 * YIN_DECIMATION + 3];
+	int first;
+	int last;
+	int best;
+	int tau;
+
+	if(lo < yin->tauMin){
+		lo = yin->tauMin;
+	}
+	if(hi > yin->tauMax - 1){
+		hi = yin->tauMax - 1;
+	}
+	if(lo > hi){
+		return (float)center;
+	}
+
+	/* One extra lag each side (where it exists) for the interpolation */
+	first = lo > 1 ? lo - 1 : lo;
+	last = hi + 1 < yin->halfBufferSize ? hi + 1 : hi;
+	for(tau = first; tau <= last; tau++){
+		d[tau - first] = (float)Yin_squaredDifference(buffer, buffer + tau, yin->halfBufferSize);
+	}
+
+	best = lo;
+	for(tau = lo + 1; tau <= hi; tau++){
+		if(d[tau - first] < d[best - first]){
+			best = tau;
+		}
+	}
+
+	/* Same parabola as step 5; over a few lags the step 2 normalisation is close to constant */
+	if(best > first && best < last){
+		float s0 = d[best - 1 - first];
+		float s1 = d[best - first];
+		float s2 = d[best + 1 - first];
+		float den = 2 * (2 * s1 - s2 - s0);
+		if(den != 0){
+			return best + (s2 - s0) / den;
+		}
+	}
+	return (float)best;
+}
+
+/**
+ * Steps 3-5 on the cumulative mean already in yinBuffer
+ * @return Fundamental frequency in Hz, -1 if no shift is under the threshold
+ */
+static float Yin_pickPitch(Yin *yin){
+	int tauEstimate;
+	float pitchInHertz = -1;
+
+	/* Step 3: Search through the normalised cumulative mean array and find values that are over the threshold */
+	tauEstimate = Yin_absoluteThreshold(yin, yin->searchMin, yin->searchMax);
+
+	/* Step 5: Interpolate the shift value (tau) to improve the pitch estimate.
+	 * After a decimated search this is done on the full-rate signal instead. */
+	if(tauEstimate != -1){
+		if(yin->source){
+			pitchInHertz = yin->sampleRate / Yin_refine(yin, tauEstimate);
+		}
+		else{
+			pitchInHertz = yin->sampleRate / Yin_parabolicInterpolation(yin, tauEstimate, yin->searchMax);
+		}
+	}
+
+	return pitchInHertz;
+}
+
+/**
+ * Coarse stage: steps 1-2 on the buffer decimated by YIN_DECIMATION
+ * @param  buffer Buffer of samples to analyse (kept for the fine stage)
+ * @return        0 when done, -1 if the window or range is too small to decimate
+ */
+static int Yin_analyseCoarse(Yin *yin, int16_t* buffer){
+	const int coarseHalf = yin->halfBufferSize / YIN_DECIMATION;
+	int first = yin->tauMin / YIN_DECIMATION;
+	int limit = (yin->tauMax + YIN_DECIMATION - 1) / YIN_DECIMATION + 1;
+	int i;
+	int k;
+	int tau;
+
+	if(first < 2){
+		first = 2;
+	}
+	if(limit > coarseHalf){
+		limit = coarseHalf;
+	}
+	if(limit - first < 2){
+		return -1;
+	}
+
+	/* Box-filter and decimate; the 4-sample average has its first null at fs / 4 */
+	for(k = 0; k < 2 * coarseHalf; k++){
+		int32_t sum = 0;
+		for(i = 0; i < YIN_DECIMATION; i++){
+			sum += buffer[k * YIN_DECIMATION + i];
+		}
+		yin->decimated[k] = (int16_t)((sum + YIN_DECIMATION / 2) / YIN_DECIMATION);
+	}
+
+	/* Steps 1-2 at the low rate, in the front of yinBuffer */
+	PROF_START(PROF_YIN_DIFF);
+	for(tau = 0; tau < limit; tau++){
+		yin->yinBuffer[tau] = (float)Yin_squaredDifference(yin->decimated, yin->decimated + tau, coarseHalf);
+	}
+	PROF_STOP(PROF_YIN_DIFF);
+	Yin_cumulativeMeanNormalizedDifference(yin, limit);
+
+	yin->searchMin = first;
+	yin->searchMax = limit;
+	yin->source = buffer;
+	return 0;
+}
+
+/**
+ * FFT length for a buffer: smallest power of two that holds the whole buffer
+ */
+static int Yin_fftSize(int bufferSize){
+	int size = 8;
+	while(size < bufferSize){
+		size <<= 1;
+	}
+	return size;
+}
+
+/**
+ * Lay the FFT workspace out in a block of Yin_workspaceSize(bufferSize, 1) - yinBuffer bytes
+ * @return Workspace, or NULL if the plan cannot be built
+ */
+static struct _YinFFT* Yin_placeFFT(int bufferSize, char* mem){
+	struct _YinFFT* fft = (struct _YinFFT *) mem;
+	int size = Yin_fftSize(bufferSize);
+	size_t bins = YIN_ALIGN(sizeof(Complex) * (size / 2 + 1));
+
+	mem += YIN_ALIGN(sizeof(struct _YinFFT));
+	fft->fftSize = size;
+	fft->frame = (float *) mem;
+	mem += YIN_ALIGN(sizeof(float) * size);
+	fft->window = (Complex *) mem;
+	mem += bins;
+	fft->signal = (Complex *) mem;
+	mem += bins;
+
+	if(rfft_plan_init_in(&fft->plan, size, mem) != 0){
+		return NULL;
+	}
+	return fft;
+}
+
+
+
 /* ------------------------------------------------------------------------------------------
 ---------------------------------------------------------------------------- PUBLIC FUNCTIONS
 -------------------------------------------------------------------------------------------*/
@@ -161,25 +455,167 @@ float Yin_parabolicInterpolation(Yin *yin, int16_t tauEstimate) {
 
 
 /**
- * Initialise the Yin pitch detection object
- * @param yin        Yin pitch detection object to initialise
+ * Bytes of workspace Yin_initWorkspace needs for a buffer length
  * @param bufferSize Length of the audio buffer to analyse
+ * @param useFFT     Non-zero to include the FFT difference workspace
+ * @return           Size in bytes (0 for a bad length)
+ */
+size_t Yin_workspaceSize(int bufferSize, int useFFT){
+	size_t bytes;
+	int size;
+
+	if(bufferSize < 2){
+		return 0;
+	}
+	bytes = YIN_ALIGN(sizeof(float) * (bufferSize / 2));
+	bytes += YIN_ALIGN(sizeof(int16_t) * (bufferSize / YIN_DECIMATION));
+
+	size = Yin_fftSize(bufferSize);
+	if(useFFT && size <= FFT_MAX_SIZE){
+		bytes += YIN_ALIGN(sizeof(struct _YinFFT));
+		bytes += YIN_ALIGN(sizeof(float) * size);
+		bytes += 2 * YIN_ALIGN(sizeof(Complex) * (size / 2 + 1));
+		bytes += YIN_ALIGN(rfft_plan_bytes(size));
+	}
+	return bytes;
+}
+
+/**
+ * Initialise the Yin object in caller memory; nothing is allocated, and Yin_free is not needed
+ * @param yin        Yin pitch detection object to initialise
+ * @param bufferSize Length of the audio buffer to analyse (at least 2)
  * @param threshold  Allowed uncertainty (e.g 0.05 will return a pitch with ~95% probability)
+ * @param workspace  Memory aligned for float, valid for as long as the object is used
+ * @param bytes      Size of workspace; Yin_workspaceSize(bufferSize, 1) enables the FFT path
+ * @return           0 on success, -1 if the length is bad or the workspace is too small
  */
-void Yin_init(Yin *yin, int16_t bufferSize, float threshold){
+int Yin_initWorkspace(Yin *yin, int bufferSize, float threshold, void* workspace, size_t bytes){
+	size_t direct = Yin_workspaceSize(bufferSize, 0);
+	size_t full = Yin_workspaceSize(bufferSize, 1);
+
 	/* Initialise the fields of the Yin structure passed in */
 	yin->bufferSize = bufferSize;
 	yin->halfBufferSize = bufferSize / 2;
 	yin->probability = 0.0;
 	yin->threshold = threshold;
+	yin->yinBuffer = NULL;
+	yin->decimated = NULL;
+	yin->fft = NULL;
+	yin->workspace = NULL;
+	yin->analysed = 0;
+	yin->tauMin = 2;
+	yin->tauMax = yin->halfBufferSize;
+	yin->coarseToFine = 0;
+	yin->searchMin = 2;
+	yin->searchMax = yin->halfBufferSize;
+	yin->source = NULL;
+	yin->sampleRate = YIN_SAMPLING_RATE;
+
+	if(direct == 0 || workspace == NULL || bytes < direct){
+		return -1;
+	}
+
+	/* The autocorellation buffer needs no clearing: step 1 writes every lag */
+	yin->yinBuffer = (float *) workspace;
+	yin->decimated = (int16_t *) ((char *) workspace + YIN_ALIGN(sizeof(float) * yin->halfBufferSize));
+
+	/* Large buffers: FFT workspace after them (falls back to the direct loop if there is no room) */
+	if(bufferSize >= YIN_FFT_CROSSOVER && full > direct && bytes >= full){
+		yin->fft = Yin_placeFFT(bufferSize, (char *) workspace + direct);
+	}
+	return 0;
+}
+
+/**
+ * Initialise the Yin pitch detection object, allocating its workspace
+ * @param yin        Yin pitch detection object to initialise
+ * @param bufferSize Length of the audio buffer to analyse
+ * @param threshold  Allowed uncertainty (e.g 0.05 will return a pitch with ~95% probability)
+ */
+void Yin_init(Yin *yin, int bufferSize, float threshold){
+	size_t bytes = Yin_workspaceSize(bufferSize, bufferSize >= YIN_FFT_CROSSOVER);
+	void* workspace = arena_malloc(bytes);
+
+	/* Without room for the FFT workspace, the direct loop still works */
+	if(workspace == NULL){
+		bytes = Yin_workspaceSize(bufferSize, 0);
+		workspace = arena_malloc(bytes);
+	}
+
+	Yin_initWorkspace(yin, bufferSize, threshold, workspace, bytes);
+	yin->workspace = workspace;
+}
+
+/**
+ * Free the buffers allocated by Yin_init
+ * @param yin        Yin object to release (can be passed to Yin_init again)
+ */
+void Yin_free(Yin *yin){
+	arena_free(yin->workspace);
+	yin->workspace = NULL;
+	yin->yinBuffer = NULL;
+	yin->decimated = NULL;
+	yin->fft = NULL;
+	yin->analysed = 0;
+}
 
-	/* Allocate the autocorellation buffer and initialise it to zero */
-	yin->yinBuffer = (float *) malloc(sizeof(float)* yin->halfBufferSize);
+/**
+ * Forget the last analysis so the object can be reused for an unrelated buffer
+ * (Yin_getPitch does this itself; it is only needed before Yin_rethreshold)
+ * @param yin        Initialised Yin object
+ */
+void Yin_reset(Yin *yin){
+	yin->probability = 0;
+	yin->analysed = 0;
+	yin->source = NULL;
+}
+
+/**
+ * Limit the search to a frequency range; lags outside it are not computed at all
+ * @param yin          Initialised Yin object
+ * @param minFrequency Lowest pitch to report in Hz (0 or less for no limit)
+ * @param maxFrequency Highest pitch to report in Hz (0 or less for no limit)
+ */
+void Yin_setRange(Yin *yin, float minFrequency, float maxFrequency){
+	int tauMin = 2;
+	int tauMax = yin->halfBufferSize;
 
-	int16_t i;
-	for(i = 0; i < yin->halfBufferSize; i++){
-		yin->yinBuffer[i] = 0;
+	/* One lag of margin past the longest period for the dip walk and the interpolation */
+	if(minFrequency > 0 && yin->sampleRate / minFrequency + 2 < tauMax){
+		tauMax = (int)(yin->sampleRate / minFrequency) + 2;
+	}
+	if(maxFrequency > 0 && yin->sampleRate / maxFrequency > tauMin){
+		tauMin = (int)(yin->sampleRate / maxFrequency);
+	}
+	if(tauMin > tauMax - 1){
+		tauMin = tauMax - 1;
 	}
+
+	yin->tauMin = tauMin;
+	yin->tauMax = tauMax;
+	Yin_reset(yin);
+}
+
+/**
+ * Analyse samples at another rate than YIN_SAMPLING_RATE (e.g. a decimated stream);
+ * call before Yin_setRange, which converts the frequency range to lags at this rate
+ * @param yin          Initialised Yin object
+ * @param sampleRate   Rate of the buffers in Hz
+ */
+void Yin_setSampleRate(Yin *yin, int sampleRate){
+	yin->sampleRate = sampleRate > 0 ? sampleRate : YIN_SAMPLING_RATE;
+	Yin_reset(yin);
+}
+
+/**
+ * Select the two-stage search: YIN on the signal decimated by YIN_DECIMATION finds the
+ * candidate lag, then only the lags around it are evaluated at the full rate
+ * @param yin          Initialised Yin object
+ * @param enable       Non-zero for coarse-to-fine, 0 for the full-rate search
+ */
+void Yin_setCoarseToFine(Yin *yin, int enable){
+	yin->coarseToFine = enable ? 1 : 0;
+	Yin_reset(yin);
 }
 
 /**
@@ -189,24 +625,61 @@ void Yin_init(Yin *yin, int16_t bufferSize, float threshold){
  * @return        Fundamental frequency of the signal in Hz. Returns -1 if pitch can't be found
  */
 float Yin_getPitch(Yin *yin, int16_t* buffer){
-	int16_t tauEstimate = -1;
-	float pitchInHertz = -1;
+	if(yin->yinBuffer == NULL){
+		return -1;
+	}
+
+	/* Two-stage search: steps 1-2 decimated, the rest finished on the full-rate buffer */
+	if(yin->coarseToFine && Yin_analyseCoarse(yin, buffer) == 0){
+		yin->analysed = 1;
+		return Yin_pickPitch(yin);
+	}
 
 	/* Step 1: Calculates the squared difference of the signal with a shifted version of itself. */
-	Yin_difference(yin, buffer);
+	if(yin->fft){
+		Yin_differenceFFT(yin, buffer);
+	}
+	else{
+		Yin_difference(yin, buffer);
+	}
 
-	/* Step 2: Calculate the cumulative mean on the normalised difference calculated in step 1 */
-	Yin_cumulativeMeanNormalizedDifference(yin);
+	return Yin_getPitchFromDifference(yin);
+}
 
-	/* Step 3: Search through the normalised cumulative mean array and find values that are over the threshold */
-	tauEstimate = Yin_absoluteThreshold(yin);
+/**
+ * Runs steps 2-5 of the algorithm on a difference function already in yinBuffer
+ * @param  yin    Initialised Yin object whose yinBuffer holds d(tau) for tau < tauMax
+ * @return        Fundamental frequency of the signal in Hz. Returns -1 if pitch can't be found
+ */
+float Yin_getPitchFromDifference(Yin *yin){
+	/* Step 2: Calculate the cumulative mean on the normalised difference calculated in step 1 */
+	Yin_cumulativeMeanNormalizedDifference(yin, yin->tauMax);
+	yin->searchMin = yin->tauMin;
+	yin->searchMax = yin->tauMax;
+	yin->source = NULL;
+	yin->analysed = 1;
+
+	/* Steps 3-5 */
+	return Yin_pickPitch(yin);
+}
 
-	/* Step 5: Interpolate the shift value (tau) to improve the pitch estimate. */
-	if(tauEstimate != -1){
-		pitchInHertz = YIN_SAMPLING_RATE / Yin_parabolicInterpolation(yin, tauEstimate);
+/**
+ * Re-runs steps 3-5 on the last buffer with a new threshold, without recomputing steps 1-2
+ * @param  yin       Yin object that has been run over a buffer
+ * @param  threshold New allowed uncertainty (kept for later calls)
+ * @return           Fundamental frequency of the signal in Hz. Returns -1 if pitch can't be found
+ *                   (or if nothing has been analysed since the last reset)
+ */
+float Yin_rethreshold(Yin *yin, float threshold){
+	yin->threshold = threshold;
+	if(!yin->analysed){
+		yin->probability = 0;
+		return -1;
 	}
 
-	return pitchInHertz;
+	/* Steps 3 and 5 only read yinBuffer, so the cumulative mean is still intact
+	 * (after a decimated search the fine stage re-reads the buffer, which must be unchanged) */
+	return Yin_pickPitch(yin);
 }
 
 /**
@@ -3,28 +3,109 @@
 
 #include <stdint.h>
 
-#define YIN_SAMPLING_RATE 48000  // MUST match the actual hardware sample rate
+#define YIN_SAMPLING_RATE 48000  // MUST match the actual hardware sample rate (the default; see Yin_setSampleRate)
 #define YIN_DEFAULT_THRESHOLD 0.15
 
+/* Buffers of at least this many samples get the difference function from an FFT
+ * autocorrelation (O(N log N)) instead of the direct double loop (O(N^2)) */
+#ifndef YIN_FFT_CROSSOVER
+#define YIN_FFT_CROSSOVER 256
+#endif
+
+#include <stddef.h>
+
+/* Decimation factor of the coarse stage of the coarse-to-fine search */
+#define YIN_DECIMATION 4
+
+struct _YinFFT;
+
 /**
  * @struct  Yin
  * @breif	Object to encapsulate the parameters for the Yin pitch detection algorithm
  */
 typedef struct _Yin {
-	int16_t bufferSize;			/**< Size of the audio buffer to be analysed */
-	int16_t halfBufferSize;		/**< Half the buffer length */
+	int bufferSize;			/**< Size of the audio buffer to be analysed */
+	int halfBufferSize;		/**< Half the buffer length */
 	float* yinBuffer;		/**< Buffer that stores the results of the intermediate processing steps of the algorithm */
 	float probability;		/**< Probability that the pitch found is correct as a decimal (i.e 0.85 is 85%) */
 	float threshold;		/**< Allowed uncertainty in the result as a decimal (i.e 0.15 is 15%) */
+	struct _YinFFT* fft;	/**< FFT workspace, NULL when the buffer is below YIN_FFT_CROSSOVER */
+	void* workspace;		/**< Block allocated by Yin_init, NULL when the caller supplied it */
+	int analysed;			/**< yinBuffer holds the cumulative mean of the last buffer (steps 1-2 done) */
+	int tauMin;				/**< Shortest lag searched (from the highest frequency) */
+	int tauMax;				/**< Number of lags computed (from the lowest frequency) */
+	int coarseToFine;		/**< Run steps 1-2 on the decimated signal and refine at full rate */
+	int16_t* decimated;		/**< Decimated copy of the buffer for the coarse stage */
+	int searchMin;			/**< Lag range held in yinBuffer by the last analysis */
+	int searchMax;
+	const int16_t* source;	/**< Buffer of the last coarse analysis (for the fine stage), else NULL */
+	int sampleRate;			/**< Rate of the analysed samples in Hz (YIN_SAMPLING_RATE unless set) */
 } Yin;
 
 /**
- * Initialise the Yin pitch detection object
+ * Bytes of workspace Yin_initWorkspace needs for a buffer length
+ * @param bufferSize Length of the audio buffer to analyse
+ * @param useFFT     Non-zero to include the FFT difference workspace
+ * @return           Size in bytes (0 for a bad length)
+ */
+size_t Yin_workspaceSize(int bufferSize, int useFFT);
+
+/**
+ * Initialise the Yin object in caller memory; nothing is allocated, and Yin_free is not needed
+ * @param yin        Yin pitch detection object to initialise
+ * @param bufferSize Length of the audio buffer to analyse (at least 2)
+ * @param threshold  Allowed uncertainty (e.g 0.05 will return a pitch with ~95% probability)
+ * @param workspace  Memory aligned for float, valid for as long as the object is used
+ * @param bytes      Size of workspace; Yin_workspaceSize(bufferSize, 1) enables the FFT path
+ * @return           0 on success, -1 if the length is bad or the workspace is too small
+ */
+int Yin_initWorkspace(Yin *yin, int bufferSize, float threshold, void* workspace, size_t bytes);
+
+/**
+ * Initialise the Yin pitch detection object, allocating its workspace
  * @param yin        Yin pitch detection object to initialise
  * @param bufferSize Length of the audio buffer to analyse
  * @param threshold  Allowed uncertainty (e.g 0.05 will return a pitch with ~95% probability)
  */
-void Yin_init(Yin *yin, int16_t bufferSize, float threshold);
+void Yin_init(Yin *yin, int bufferSize, float threshold);
+
+/**
+ * Free the buffers allocated by Yin_init
+ * @param yin        Yin object to release (can be passed to Yin_init again)
+ */
+void Yin_free(Yin *yin);
+
+/**
+ * Forget the last analysis so the object can be reused for an unrelated buffer
+ * (Yin_getPitch does this itself; it is only needed before Yin_rethreshold)
+ * @param yin        Initialised Yin object
+ */
+void Yin_reset(Yin *yin);
+
+/**
+ * Limit the search to a frequency range; lags outside it are not computed at all
+ * @param yin          Initialised Yin object
+ * @param minFrequency Lowest pitch to report in Hz (0 or less for no limit)
+ * @param maxFrequency Highest pitch to report in Hz (0 or less for no limit)
+ */
+void Yin_setRange(Yin *yin, float minFrequency, float maxFrequency);
+
+/**
+ * Analyse samples at another rate than YIN_SAMPLING_RATE (e.g. a decimated stream);
+ * call before Yin_setRange, which converts the frequency range to lags at this rate
+ * @param yin          Initialised Yin object
+ * @param sampleRate   Rate of the buffers in Hz
+ */
+void Yin_setSampleRate(Yin *yin, int sampleRate);
+
+/**
+ * Select the two-stage search: YIN on the signal decimated by YIN_DECIMATION finds the
+ * candidate lag, then only the lags around it are evaluated at the full rate.
+ * The probability reported is the one from the coarse stage.
+ * @param yin          Initialised Yin object
+ * @param enable       Non-zero for coarse-to-fine, 0 for the full-rate search
+ */
+void Yin_setCoarseToFine(Yin *yin, int enable);
 
 /**
  * Runs the Yin pitch detection algortihm
@@ -34,6 +115,38 @@ void Yin_init(Yin *yin, int16_t bufferSize, float threshold);
  */
 float Yin_getPitch(Yin *yin, int16_t* buffer);
 
+/**
+ * Runs steps 2-5 of the algorithm on a difference function already in yinBuffer
+ * (used by callers that compute step 1 themselves, e.g. YinTracker)
+ * @param  yin    Initialised Yin object whose yinBuffer holds d(tau) for tau < tauMax
+ * @return        Fundamental frequency of the signal in Hz. Returns -1 if pitch can't be found
+ */
+float Yin_getPitchFromDifference(Yin *yin);
+
+/**
+ * Re-runs steps 3-5 on the last buffer with a new threshold, without recomputing steps 1-2
+ * @param  yin       Yin object that has been run over a buffer
+ * @param  threshold New allowed uncertainty (kept for later calls)
+ * @return           Fundamental frequency of the signal in Hz. Returns -1 if pitch can't be found
+ *                   (or if nothing has been analysed since the last reset)
+ */
+float Yin_rethreshold(Yin *yin, float threshold);
+
+/**
+ * Exact squared difference of two runs of samples, the inner loop of step 1
+ * (NEON on the A53, otherwise the same as Yin_squaredDifferenceScalar)
+ * @param  a      First run
+ * @param  b      Second run
+ * @param  n      Samples in each run
+ * @return        sum (a[i] - b[i])^2 for i < n
+ */
+uint64_t Yin_squaredDifference(const int16_t* a, const int16_t* b, int n);
+
+/**
+ * Portable reference for Yin_squaredDifference, for checking the vector build
+ */
+uint64_t Yin_squaredDifferenceScalar(const int16_t* a, const int16_t* b, int n);
+
 /**
  * Certainty of the pitch found
  * @param  yin Yin object that has been run over a buffer
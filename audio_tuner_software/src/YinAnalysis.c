@@ -0,0 +1,202 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "YinAnalysis.h"
+#include "scale.h"
+#include "arena.h"
+
+/* ------------------------------------------------------------------------------------------
+--------------------------------------------------------------------------- PRIVATE FUNCTIONS
+-------------------------------------------------------------------------------------------*/
+
+/**
+ * qsort comparison for floats
+ */
+static int YinAnalysis_compare(const void* a, const void* b){
+	float x = *(const float*)a;
+	float y = *(const float*)b;
+	return (x > y) - (x < y);
+}
+
+
+/* ------------------------------------------------------------------------------------------
+---------------------------------------------------------------------------- PUBLIC FUNCTIONS
+-------------------------------------------------------------------------------------------*/
+
+/**
+ * Add one window's result to the statistics
+ * @param analysis     Initialised analysis
+ * @param pitch        Pitch in Hz, -1 (or any value <= 0) if unvoiced
+ * @param confidence   Its probability as a decimal
+ */
+void YinAnalysis_record(YinAnalysis *analysis, float pitch, float confidence){
+	analysis->windows++;
+	analysis->windowsLeft--;
+	if(pitch <= 0){
+		return;
+	}
+
+	if(analysis->voiced < analysis->capacity){
+		analysis->pitches[analysis->voiced] = pitch;
+	}
+	analysis->voiced++;
+
+	/* Nearest semitone: MIDI note = 12 * log2(f / 440) + 69 */
+	int bin = scale_quantize_note(&scale_chromatic, pitch, NULL) - YIN_HISTOGRAM_FIRST_NOTE;
+	if(bin >= 0 && bin < YIN_HISTOGRAM_BINS){
+		analysis->weight[bin] += confidence;
+		analysis->weightedPitch[bin] += confidence * pitch;
+		analysis->binCount[bin]++;
+	}
+}
+
+/**
+ * Initialise the statistics only, for windows analysed elsewhere (e.g. by a YinTracker)
+ * and added with YinAnalysis_record; YinAnalysis_push does nothing on such an analysis
+ * @param analysis     Analysis to initialise
+ * @param maxWindows   Windows kept for the median
+ * @return             0 on success, -1 on bad arguments or allocation failure
+ */
+int YinAnalysis_initStatistics(YinAnalysis *analysis, int maxWindows){
+	memset(analysis, 0, sizeof(*analysis));
+	if(maxWindows < 1){
+		return -1;
+	}
+
+	analysis->windowsLeft = maxWindows;
+	analysis->capacity = maxWindows;
+	analysis->pitches = (float *) arena_malloc(sizeof(float) * maxWindows);
+	return analysis->pitches ? 0 : -1;
+}
+
+/**
+ * Initialise a multi-window analysis
+ * @param analysis     Analysis to initialise
+ * @param windowSize   Samples per Yin window
+ * @param hop          Samples between window starts (may exceed windowSize to sample sparsely)
+ * @param firstSample  Samples to skip before the first window
+ * @param maxWindows   Stop after this many windows
+ * @param threshold    Yin threshold for every window
+ * @return             0 on success, -1 on bad arguments or allocation failure
+ */
+int YinAnalysis_init(YinAnalysis *analysis, int windowSize, int hop, int firstSample, int maxWindows, float threshold){
+	memset(analysis, 0, sizeof(*analysis));
+	if(windowSize < 2 || hop < 1 || firstSample < 0 || maxWindows < 1){
+		return -1;
+	}
+
+	analysis->windowSize = windowSize;
+	analysis->hop = hop;
+	analysis->skip = firstSample;
+	analysis->windowsLeft = maxWindows;
+	analysis->capacity = maxWindows;
+
+	/* Every window goes through the same detector, so it is allocated once */
+	Yin_init(&analysis->yin, windowSize, threshold);
+	analysis->window = (int16_t *) arena_malloc(sizeof(int16_t) * windowSize);
+	analysis->pitches = (float *) arena_malloc(sizeof(float) * maxWindows);
+
+	if(!analysis->yin.yinBuffer || !analysis->window || !analysis->pitches){
+		YinAnalysis_free(analysis);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Free the buffers allocated by YinAnalysis_init
+ * @param analysis     Analysis to release
+ */
+void YinAnalysis_free(YinAnalysis *analysis){
+	Yin_free(&analysis->yin);
+	arena_free(analysis->window);
+	arena_free(analysis->pitches);
+	analysis->window = NULL;
+	analysis->pitches = NULL;
+}
+
+/**
+ * Feed the next block of the stream; every window completed by it is analysed
+ * @param analysis     Initialised analysis
+ * @param samples      Next samples in stream order
+ * @param n            Number of samples
+ * @return             Non-zero once maxWindows have been analysed (the rest can be skipped)
+ */
+int YinAnalysis_push(YinAnalysis *analysis, const int16_t* samples, int n){
+	if(analysis->window == NULL){
+		return 1;
+	}
+
+	while(n > 0 && analysis->windowsLeft > 0){
+		/* Gap between windows (hop > windowSize, or the start offset) */
+		if(analysis->skip > 0){
+			int drop = analysis->skip < n ? analysis->skip : n;
+			analysis->skip -= drop;
+			samples += drop;
+			n -= drop;
+			continue;
+		}
+
+		int take = analysis->windowSize - analysis->fill;
+		if(take > n){
+			take = n;
+		}
+		memcpy(analysis->window + analysis->fill, samples, sizeof(int16_t) * take);
+		analysis->fill += take;
+		samples += take;
+		n -= take;
+
+		if(analysis->fill == analysis->windowSize){
+			float pitch = Yin_getPitch(&analysis->yin, analysis->window);
+			YinAnalysis_record(analysis, pitch, Yin_getProbability(&analysis->yin));
+
+			/* Overlapping windows keep their shared tail, sparse ones skip the gap */
+			if(analysis->hop < analysis->windowSize){
+				analysis->fill = analysis->windowSize - analysis->hop;
+				memmove(analysis->window, analysis->window + analysis->hop, sizeof(int16_t) * analysis->fill);
+			}
+			else{
+				analysis->fill = 0;
+				analysis->skip = analysis->hop - analysis->windowSize;
+			}
+		}
+	}
+
+	return analysis->windowsLeft <= 0;
+}
+
+/**
+ * Aggregate the windows analysed so far
+ * @param analysis     Initialised analysis
+ * @param summary      Receives the statistics
+ */
+void YinAnalysis_summarise(YinAnalysis *analysis, YinSummary *summary){
+	int kept = analysis->voiced < analysis->capacity ? analysis->voiced : analysis->capacity;
+	int best = -1;
+	int bin;
+
+	summary->windows = analysis->windows;
+	summary->voiced = analysis->voiced;
+	summary->voicedRatio = analysis->windows ? (float)analysis->voiced / analysis->windows : 0;
+	summary->medianPitch = -1;
+	summary->histogramPitch = -1;
+	summary->confidence = 0;
+
+	if(kept > 0){
+		qsort(analysis->pitches, kept, sizeof(float), YinAnalysis_compare);
+		summary->medianPitch = (kept & 1) ? analysis->pitches[kept / 2]
+			: 0.5f * (analysis->pitches[kept / 2 - 1] + analysis->pitches[kept / 2]);
+	}
+
+	/* The semitone carrying the most confidence; octave errors and stray windows land elsewhere */
+	for(bin = 0; bin < YIN_HISTOGRAM_BINS; bin++){
+		if(analysis->weight[bin] > 0 && (best < 0 || analysis->weight[bin] > analysis->weight[best])){
+			best = bin;
+		}
+	}
+	if(best >= 0){
+		summary->histogramPitch = analysis->weightedPitch[best] / analysis->weight[best];
+		summary->confidence = analysis->weight[best] / analysis->binCount[best];
+	}
+}
@@ -0,0 +1,96 @@
+#ifndef YinAnalysis_h
+#define YinAnalysis_h
+
+#include <stdint.h>
+#include "Yin.h"
+
+/* Histogram bins are semitones (MIDI notes) from YIN_HISTOGRAM_FIRST_NOTE upwards */
+#define YIN_HISTOGRAM_FIRST_NOTE 16		/* E0, ~20.6 Hz */
+#define YIN_HISTOGRAM_BINS 93			/* up to C8, ~4186 Hz */
+
+/**
+ * @struct  YinSummary
+ * @brief	Aggregate result of a multi-window analysis
+ */
+typedef struct _YinSummary {
+	int windows;			/**< Windows analysed */
+	int voiced;				/**< Windows where a pitch was found */
+	float voicedRatio;		/**< voiced / windows */
+	float medianPitch;		/**< Median of the voiced pitches in Hz, -1 if none */
+	float histogramPitch;	/**< Confidence-weighted mean pitch of the strongest semitone bin, -1 if none */
+	float confidence;		/**< Mean confidence of the windows in that bin */
+} YinSummary;
+
+/**
+ * @struct  YinAnalysis
+ * @brief	Runs Yin over a grid of windows of a stream read once, front to back
+ */
+typedef struct _YinAnalysis {
+	Yin yin;				/**< Detector shared by every window */
+	int windowSize;			/**< Samples per window */
+	int hop;				/**< Samples between window starts */
+	int16_t* window;		/**< Window being filled */
+	int fill;				/**< Samples in window */
+	int skip;				/**< Samples still to drop before the next window starts */
+	int windowsLeft;		/**< Windows still allowed (maxWindows countdown) */
+	float* pitches;			/**< Voiced pitches kept for the median */
+	int capacity;			/**< Size of pitches */
+	int windows;			/**< Windows analysed */
+	int voiced;				/**< Windows with a pitch */
+	float weight[YIN_HISTOGRAM_BINS];		/**< Sum of confidence per semitone */
+	float weightedPitch[YIN_HISTOGRAM_BINS];	/**< Sum of confidence * pitch per semitone */
+	int binCount[YIN_HISTOGRAM_BINS];		/**< Windows per semitone */
+} YinAnalysis;
+
+/**
+ * Initialise a multi-window analysis
+ * @param analysis     Analysis to initialise
+ * @param windowSize   Samples per Yin window
+ * @param hop          Samples between window starts (may exceed windowSize to sample sparsely)
+ * @param firstSample  Samples to skip before the first window
+ * @param maxWindows   Stop after this many windows
+ * @param threshold    Yin threshold for every window
+ * @return             0 on success, -1 on bad arguments or allocation failure
+ */
+int YinAnalysis_init(YinAnalysis *analysis, int windowSize, int hop, int firstSample, int maxWindows, float threshold);
+
+/**
+ * Initialise the statistics only, for windows analysed elsewhere (e.g. by a YinTracker)
+ * and added with YinAnalysis_record; YinAnalysis_push does nothing on such an analysis
+ * @param analysis     Analysis to initialise
+ * @param maxWindows   Windows kept for the median
+ * @return             0 on success, -1 on bad arguments or allocation failure
+ */
+int YinAnalysis_initStatistics(YinAnalysis *analysis, int maxWindows);
+
+/**
+ * Free the buffers allocated by YinAnalysis_init
+ * @param analysis     Analysis to release
+ */
+void YinAnalysis_free(YinAnalysis *analysis);
+
+/**
+ * Feed the next block of the stream; every window completed by it is analysed
+ * @param analysis     Initialised analysis
+ * @param samples      Next samples in stream order
+ * @param n            Number of samples
+ * @return             Non-zero once maxWindows have been analysed (the rest can be skipped)
+ */
+int YinAnalysis_push(YinAnalysis *analysis, const int16_t* samples, int n);
+
+/**
+ * Add one window's result to the statistics
+ * @param analysis     Initialised analysis
+ * @param pitch        Pitch in Hz, -1 (or any value <= 0) if unvoiced
+ * @param confidence   Its probability as a decimal
+ */
+void YinAnalysis_record(YinAnalysis *analysis, float pitch, float confidence);
+
+/**
+ * Aggregate the windows analysed so far
+ * @param analysis     Initialised analysis
+ * @param summary      Receives the statistics
+ */
+void YinAnalysis_summarise(YinAnalysis *analysis, YinSummary *summary);
+
+#endif
@@ -0,0 +1,183 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "YinPL.h"
+#include "arena.h"
+
+#if YIN_PL
+
+#include "xil_io.h"
+#include "xparameters.h"
+
+/* Register map of yin_diff.vhd */
+#define YIN_PL_CONTROL		0x0000
+#define YIN_PL_STATUS		0x0004
+#define YIN_PL_HALF			0x0008
+#define YIN_PL_TAU_MAX		0x000C
+#define YIN_PL_HOP			0x0010
+#define YIN_PL_SNAP_COUNT	0x0014
+#define YIN_PL_SAMPLES		0x0018
+#define YIN_PL_ID			0x001C
+#define YIN_PL_SNAPSHOT		0x2000		/* d(tau) at + 8 * tau (bits 31:0), + 4 (bits 47:32) */
+
+#define YIN_PL_ENABLE		0x1u
+#define YIN_PL_CLEAR		0x2u
+#define YIN_PL_CLEARING		0x1u
+#define YIN_PL_OVERRUN		0x2u
+#define YIN_PL_ID_VALUE		0x59494E31u	/* "YIN1" */
+
+/* ------------------------------------------------------------------------------------------
+--------------------------------------------------------------------------- PRIVATE FUNCTIONS
+-------------------------------------------------------------------------------------------*/
+
+static inline uint32_t YinPL_read(uint32_t offset){
+	return Xil_In32((UINTPTR)YIN_PL_BASEADDR + offset);
+}
+
+static inline void YinPL_write(uint32_t offset, uint32_t value){
+	Xil_Out32((UINTPTR)YIN_PL_BASEADDR + offset, value);
+}
+
+/**
+ * Copy the snapshot bank into yinBuffer
+ * @param pl     Initialised tracker
+ * @return       Snapshot count of the frame copied, which is consistent (the count did
+ *               not move while it was read)
+ */
+static uint32_t YinPL_copySnapshot(YinPL *pl){
+	uint32_t before;
+	uint32_t after;
+	int tau;
+
+	do {
+		before = YinPL_read(YIN_PL_SNAP_COUNT);
+		for(tau = 0; tau < pl->yin.tauMax; tau++){
+			uint32_t lo = YinPL_read(YIN_PL_SNAPSHOT + 8 * tau);
+			uint32_t hi = YinPL_read(YIN_PL_SNAPSHOT + 8 * tau + 4);
+			pl->yin.yinBuffer[tau] = (float)(int64_t)(((uint64_t)hi << 32) | lo);
+		}
+		after = YinPL_read(YIN_PL_SNAP_COUNT);
+	} while(before != after);
+
+	return after;
+}
+
+
+/* ------------------------------------------------------------------------------------------
+---------------------------------------------------------------------------- PUBLIC FUNCTIONS
+-------------------------------------------------------------------------------------------*/
+
+/**
+ * Configure the fabric engine and clear it
+ * @param pl         Tracker to initialise
+ * @param windowSize Analysis window in samples (even, 4 .. 2 * YIN_PL_MAX_HALF)
+ * @param hop        Samples between snapshots (1 .. 65535)
+ * @param threshold  Allowed uncertainty (as for Yin_init)
+ * @return           0 on success, -1 on bad size, allocation failure or missing engine
+ */
+int YinPL_init(YinPL *pl, int windowSize, int hop, float threshold){
+	const int half = windowSize / 2;
+
+	memset(pl, 0, sizeof(*pl));
+	if(windowSize < 4 || half > YIN_PL_MAX_HALF || (windowSize & 1) || hop < 1 || hop > 65535){
+		return -1;
+	}
+	if(YinPL_read(YIN_PL_ID) != YIN_PL_ID_VALUE){
+		return -1;
+	}
+
+	pl->windowSize = windowSize;
+
+	/* Steps 2-5 only need yinBuffer */
+	pl->yin.bufferSize = windowSize;
+	pl->yin.halfBufferSize = half;
+	pl->yin.threshold = threshold;
+	pl->yin.probability = 0;
+	pl->yin.fft = NULL;
+	pl->yin.workspace = NULL;
+	pl->yin.analysed = 0;
+	pl->yin.tauMin = 2;
+	pl->yin.tauMax = half;
+	pl->yin.coarseToFine = 0;
+	pl->yin.decimated = NULL;
+	pl->yin.source = NULL;
+	pl->yin.sampleRate = YIN_SAMPLING_RATE;
+	pl->yin.yinBuffer = (float *) arena_malloc(sizeof(float) * half);
+	if(!pl->yin.yinBuffer){
+		return -1;
+	}
+
+	/* The fabric keeps every lag; the range only limits what is read back */
+	YinPL_write(YIN_PL_CONTROL, 0);
+	YinPL_write(YIN_PL_HALF, (uint32_t)half);
+	YinPL_write(YIN_PL_TAU_MAX, (uint32_t)half);
+	YinPL_write(YIN_PL_HOP, (uint32_t)hop);
+	YinPL_reset(pl);
+	return 0;
+}
+
+/**
+ * Stop the engine and free the buffers allocated by YinPL_init
+ * @param pl         Tracker to release
+ */
+void YinPL_free(YinPL *pl){
+	if(pl->yin.yinBuffer){
+		YinPL_write(YIN_PL_CONTROL, 0);
+	}
+	arena_free(pl->yin.yinBuffer);
+	pl->yin.yinBuffer = NULL;
+}
+
+/**
+ * Forget all samples and start tracking from the next one on the stream
+ * @param pl         Initialised tracker
+ */
+void YinPL_reset(YinPL *pl){
+	/* Clear zeroes the history and d(tau) (a few thousand cycles), then samples are taken */
+	YinPL_write(YIN_PL_CONTROL, YIN_PL_ENABLE | YIN_PL_CLEAR);
+	while(YinPL_read(YIN_PL_CONTROL) & YIN_PL_CLEAR){
+	}
+	while(YinPL_read(YIN_PL_STATUS) & YIN_PL_CLEARING){
+	}
+	pl->snapshot = YinPL_read(YIN_PL_SNAP_COUNT);
+	pl->pitch = -1;
+	Yin_reset(&pl->yin);
+}
+
+/**
+ * Analyse the newest snapshot if the fabric has published one since the last call
+ * @param  pl        Initialised tracker
+ * @param  pitch     Receives the pitch in Hz (-1 if none) when a new snapshot was analysed
+ * @return           1 if a new snapshot was analysed, 0 if there is none yet
+ */
+int YinPL_poll(YinPL *pl, float *pitch){
+	if(YinPL_read(YIN_PL_SNAP_COUNT) == pl->snapshot){
+		return 0;
+	}
+
+	pl->snapshot = YinPL_copySnapshot(pl);
+	pl->pitch = Yin_getPitchFromDifference(&pl->yin);
+	*pitch = pl->pitch;
+	return 1;
+}
+
+/**
+ * Certainty of the latest pitch
+ * @param  pl        Tracker that has analysed at least one snapshot
+ * @return           Probability as a decimal (i.e 0.85 is 85%)
+ */
+float YinPL_getProbability(YinPL *pl){
+	return Yin_getProbability(&pl->yin);
+}
+
+/**
+ * Samples lost because one arrived while the engine was still busy (should never happen)
+ * @param  pl        Initialised tracker
+ * @return           Non-zero if any sample was lost since the last reset
+ */
+int YinPL_overrun(YinPL *pl){
+	(void)pl;
+	return (YinPL_read(YIN_PL_STATUS) & YIN_PL_OVERRUN) != 0;
+}
+
+#endif
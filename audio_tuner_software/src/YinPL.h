@@ -0,0 +1,79 @@
+#ifndef YinPL_h
+#define YinPL_h
+
+#include <stdint.h>
+#include "Yin.h"
+
+/* Build with -DYIN_PL=1 when the bitstream has the yin_diff block on the capture stream */
+#ifndef YIN_PL
+#define YIN_PL 0
+#endif
+
+#ifndef YIN_PL_BASEADDR
+#define YIN_PL_BASEADDR		XPAR_YIN_DIFF_0_S_AXI_BASEADDR
+#endif
+
+#define YIN_PL_MAX_HALF		1024		/**< Largest half window the fabric holds (2**HALF_LOG2) */
+
+/**
+ * @struct  YinPL
+ * @brief	Yin pitch tracker whose difference function is computed in the fabric
+ *
+ * yin_diff.vhd watches the capture AXI-Stream and keeps d(tau) of the newest windowSize
+ * samples with the same exact sliding update as YinTracker built with YIN_TRACKER_SLIDING=1,
+ * publishing a snapshot every hop samples. The CPU only copies a snapshot and runs steps
+ * 2-5, so for the same samples the pitch matches that tracker bit for bit. Only the lags below yin.tauMax are read back,
+ * so Yin_setRange on yin also shortens the copy.
+ */
+typedef struct _YinPL {
+	Yin yin;				/**< Steps 2-5 (threshold, probability, yinBuffer scratch) */
+	int windowSize;			/**< Samples in the analysis window */
+	uint32_t snapshot;		/**< Snapshot count of the last analysed frame */
+	float pitch;			/**< Latest pitch in Hz, -1 if none */
+} YinPL;
+
+/**
+ * Configure the fabric engine and clear it
+ * @param pl         Tracker to initialise
+ * @param windowSize Analysis window in samples (even, 4 .. 2 * YIN_PL_MAX_HALF)
+ * @param hop        Samples between snapshots (1 .. 65535)
+ * @param threshold  Allowed uncertainty (as for Yin_init)
+ * @return           0 on success, -1 on bad size, allocation failure or missing engine
+ */
+int YinPL_init(YinPL *pl, int windowSize, int hop, float threshold);
+
+/**
+ * Stop the engine and free the buffers allocated by YinPL_init
+ * @param pl         Tracker to release
+ */
+void YinPL_free(YinPL *pl);
+
+/**
+ * Forget all samples and start tracking from the next one on the stream
+ * @param pl         Initialised tracker
+ */
+void YinPL_reset(YinPL *pl);
+
+/**
+ * Analyse the newest snapshot if the fabric has published one since the last call
+ * @param  pl        Initialised tracker
+ * @param  pitch     Receives the pitch in Hz (-1 if none) when a new snapshot was analysed
+ * @return           1 if a new snapshot was analysed, 0 if there is none yet
+ */
+int YinPL_poll(YinPL *pl, float *pitch);
+
+/**
+ * Certainty of the latest pitch
+ * @param  pl        Tracker that has analysed at least one snapshot
+ * @return           Probability as a decimal (i.e 0.85 is 85%)
+ */
+float YinPL_getProbability(YinPL *pl);
+
+/**
+ * Samples lost because one arrived while the engine was still busy (should never happen)
+ * @param  pl        Initialised tracker
+ * @return           Non-zero if any sample was lost since the last reset
+ */
+int YinPL_overrun(YinPL *pl);
+
+#endif
@@ -0,0 +1,268 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "YinTracker.h"
+#include "arena.h"
+#include "prof.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/* ------------------------------------------------------------------------------------------
+--------------------------------------------------------------------------- PRIVATE FUNCTIONS
+-------------------------------------------------------------------------------------------*/
+
+#if YIN_TRACKER_SLIDING
+/**
+ * Slide the window forward by one sample.
+ * @param tracker Tracker whose newest sample has just been stored
+ *
+ * With the window starting at s, d(tau) = sum over i < W of (x[s+i] - x[s+i+tau])^2.
+ * Moving from s to s+1 drops the i = 0 term of the old window and adds the
+ * i = W-1 term of the new one:
+ *   d(tau) += (x[s+W] - x[s+W+tau])^2 - (x[s] - x[s+tau])^2
+ */
+static void YinTracker_slide(YinTracker *tracker){
+	const int W = tracker->halfWindow;
+	const int mask = tracker->ringSize - 1;
+
+	/* Old window start; the newest sample sits at old start + 2W and is not used yet */
+	const int start = (int)((tracker->count - 1 - 2 * W) & mask);
+	const int16_t* leaving = tracker->history + start;
+	const int16_t* entering = leaving + W;
+	const int32_t a = leaving[0];
+	const int32_t b = entering[0];
+	int tau = 0;
+
+#if defined(__ARM_NEON)
+	/* 8 lags per pass, exact: absolute differences fit 16 unsigned bits, squares 32,
+	 * and the new-minus-old difference is widened to 64 before it is added */
+	const int16x8_t va = vdupq_n_s16(leaving[0]);
+	const int16x8_t vb = vdupq_n_s16(entering[0]);
+	for(; tau + 8 <= W; tau += 8){
+		uint16x8_t out = vreinterpretq_u16_s16(vabdq_s16(va, vld1q_s16(leaving + tau)));
+		uint16x8_t in = vreinterpretq_u16_s16(vabdq_s16(vb, vld1q_s16(entering + tau)));
+		uint32x4_t inLo = vmull_u16(vget_low_u16(in), vget_low_u16(in));
+		uint32x4_t inHi = vmull_high_u16(in, in);
+		uint32x4_t outLo = vmull_u16(vget_low_u16(out), vget_low_u16(out));
+		uint32x4_t outHi = vmull_high_u16(out, out);
+		int64_t* d = tracker->diff + tau;
+
+		vst1q_s64(d, vaddq_s64(vld1q_s64(d), vreinterpretq_s64_u64(vsubl_u32(vget_low_u32(inLo), vget_low_u32(outLo)))));
+		vst1q_s64(d + 2, vaddq_s64(vld1q_s64(d + 2), vreinterpretq_s64_u64(vsubl_high_u32(inLo, outLo))));
+		vst1q_s64(d + 4, vaddq_s64(vld1q_s64(d + 4), vreinterpretq_s64_u64(vsubl_u32(vget_low_u32(inHi), vget_low_u32(outHi)))));
+		vst1q_s64(d + 6, vaddq_s64(vld1q_s64(d + 6), vreinterpretq_s64_u64(vsubl_high_u32(inHi, outHi))));
+	}
+#endif
+
+	for(; tau < W; tau++){
+		int32_t out = a - leaving[tau];
+		int32_t in = b - entering[tau];
+		tracker->diff[tau] += (int64_t)in * in - (int64_t)out * out;
+	}
+}
+#endif
+
+
+/**
+ * Store one sample in the history ring
+ * @param tracker Tracker
+ * @param sample  Newest sample
+ */
+static inline void YinTracker_store(YinTracker *tracker, int16_t sample){
+	int pos = (int)(tracker->count & (tracker->ringSize - 1));
+	tracker->history[pos] = sample;
+	tracker->history[pos + tracker->ringSize] = sample;
+	tracker->count++;
+}
+
+#if YIN_TRACKER_SLIDING
+/**
+ * Compute d(tau) of the current window from scratch (after YinTracker_skip).
+ * @param tracker Tracker whose history is up to date
+ *
+ * Samples before the last reset are zero in the ring, as the sliding update
+ * assumes, so the result is the same d(tau) sliding would have reached.
+ */
+static void YinTracker_rebuild(YinTracker *tracker){
+	const int W = tracker->halfWindow;
+	const int16_t* x = tracker->history + (int)((tracker->count - 2 * W) & (tracker->ringSize - 1));
+	int tau;
+	int i;
+
+	for(tau = 0; tau < W; tau++){
+		int64_t d = 0;
+		for(i = 0; i < W; i++){
+			int32_t e = x[i] - x[i + tau];
+			d += (int64_t)e * e;
+		}
+		tracker->diff[tau] = d;
+	}
+	tracker->stale = 0;
+}
+#endif
+
+
+/* ------------------------------------------------------------------------------------------
+---------------------------------------------------------------------------- PUBLIC FUNCTIONS
+-------------------------------------------------------------------------------------------*/
+
+/**
+ * Initialise a tracker
+ * @param tracker    Tracker to initialise
+ * @param windowSize Analysis window in samples (even, 4 .. 16384)
+ * @param threshold  Allowed uncertainty (as for Yin_init)
+ * @return           0 on success, -1 on bad size or allocation failure
+ */
+int YinTracker_init(YinTracker *tracker, int windowSize, float threshold){
+	memset(tracker, 0, sizeof(*tracker));
+	if(windowSize < 4 || windowSize > 16384 || (windowSize & 1)){
+		return -1;
+	}
+
+	tracker->windowSize = windowSize;
+	tracker->halfWindow = windowSize / 2;
+
+	/* The ring must reach back windowSize samples before the newest one */
+	tracker->ringSize = 2;
+	while(tracker->ringSize <= windowSize){
+		tracker->ringSize <<= 1;
+	}
+
+#if YIN_TRACKER_SLIDING
+	/* Steps 2-5 only need yinBuffer */
+	tracker->yin.bufferSize = windowSize;
+	tracker->yin.halfBufferSize = tracker->halfWindow;
+	tracker->yin.threshold = threshold;
+	tracker->yin.probability = 0;
+	tracker->yin.fft = NULL;
+	tracker->yin.workspace = NULL;
+	tracker->yin.analysed = 0;
+	tracker->yin.tauMin = 2;
+	tracker->yin.tauMax = tracker->halfWindow;
+	tracker->yin.coarseToFine = 0;
+	tracker->yin.decimated = NULL;
+	tracker->yin.source = NULL;
+	tracker->yin.sampleRate = YIN_SAMPLING_RATE;
+	tracker->yin.yinBuffer = (float *) arena_malloc(sizeof(float) * tracker->halfWindow);
+	tracker->diff = (int64_t *) arena_malloc(sizeof(int64_t) * tracker->halfWindow);
+#else
+	/* Full Yin object, FFT workspace included, run on the window every hop */
+	Yin_init(&tracker->yin, windowSize, threshold);
+#endif
+	tracker->history = (int16_t *) arena_malloc(sizeof(int16_t) * 2 * tracker->ringSize);
+
+#if YIN_TRACKER_SLIDING
+	if(!tracker->yin.yinBuffer || !tracker->diff || !tracker->history){
+#else
+	if(!tracker->yin.yinBuffer || !tracker->history){
+#endif
+		YinTracker_free(tracker);
+		return -1;
+	}
+
+	YinTracker_reset(tracker);
+	return 0;
+}
+
+/**
+ * Free the buffers allocated by YinTracker_init
+ * @param tracker    Tracker to release
+ */
+void YinTracker_free(YinTracker *tracker){
+#if YIN_TRACKER_SLIDING
+	arena_free(tracker->yin.yinBuffer);
+	tracker->yin.yinBuffer = NULL;
+	arena_free(tracker->diff);
+	tracker->diff = NULL;
+#else
+	Yin_free(&tracker->yin);
+#endif
+	arena_free(tracker->history);
+	tracker->history = NULL;
+}
+
+/**
+ * Forget all samples; the window starts as silence
+ * @param tracker    Initialised tracker
+ */
+void YinTracker_reset(YinTracker *tracker){
+#if YIN_TRACKER_SLIDING
+	/* All-zero history has d(tau) = 0, so the recursion starts exact */
+	memset(tracker->diff, 0, sizeof(int64_t) * tracker->halfWindow);
+#endif
+	memset(tracker->history, 0, sizeof(int16_t) * 2 * tracker->ringSize);
+	tracker->count = 0;
+	tracker->stale = 0;
+	tracker->pitch = -1;
+	Yin_reset(&tracker->yin);
+}
+
+/**
+ * Slide the window over a hop of new samples and re-estimate the pitch
+ * @param  tracker   Initialised tracker
+ * @param  samples   New samples (e.g. one DMA burst)
+ * @param  n         Number of new samples
+ * @return           Pitch in Hz of the window ending at the last sample, -1 if none
+ */
+float YinTracker_push(YinTracker *tracker, const int16_t* samples, int n){
+	int i;
+#if YIN_TRACKER_SLIDING
+	int tau;
+
+	/* Step 1 is the sliding update of d(tau), or a rebuild after skipped samples */
+	PROF_START(PROF_YIN_DIFF);
+	if(tracker->stale){
+		for(i = 0; i < n; i++){
+			YinTracker_store(tracker, samples[i]);
+		}
+		YinTracker_rebuild(tracker);
+	}
+	else {
+		for(i = 0; i < n; i++){
+			YinTracker_store(tracker, samples[i]);
+			YinTracker_slide(tracker);
+		}
+	}
+	PROF_STOP(PROF_YIN_DIFF);
+
+	/* Steps 2-5 work in place, so hand them a float copy */
+	for(tau = 0; tau < tracker->halfWindow; tau++){
+		tracker->yin.yinBuffer[tau] = (float)tracker->diff[tau];
+	}
+	tracker->pitch = Yin_getPitchFromDifference(&tracker->yin);
+#else
+	for(i = 0; i < n; i++){
+		YinTracker_store(tracker, samples[i]);
+	}
+
+	/* The doubled ring holds the whole window contiguously */
+	tracker->pitch = Yin_getPitch(&tracker->yin, tracker->history + (int)((tracker->count - tracker->windowSize) & (tracker->ringSize - 1)));
+#endif
+	return tracker->pitch;
+}
+
+/**
+ * Take in new samples without re-estimating
+ * @param  tracker   Initialised tracker
+ * @param  samples   New samples
+ * @param  n         Number of new samples
+ */
+void YinTracker_skip(YinTracker *tracker, const int16_t* samples, int n){
+	int i;
+
+	for(i = 0; i < n; i++){
+		YinTracker_store(tracker, samples[i]);
+	}
+	tracker->stale = 1;
+}
+
+/**
+ * Certainty of the latest pitch
+ * @param  tracker   Tracker that has been pushed at least once
+ * @return           Probability as a decimal (i.e 0.85 is 85%)
+ */
+float YinTracker_getProbability(YinTracker *tracker){
+	return Yin_getProbability(&tracker->yin);
+}
@@ -0,0 +1,85 @@
+#include "adpcm.h"
+
+static const int16_t adpcm_step[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
+    34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143,
+    157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658,
+    724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
+    3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t adpcm_index_step[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+static inline int32_t adpcm_clamp(int32_t x, int32_t lo, int32_t hi) {
+    return x < lo ? lo : (x > hi ? hi : x);
+}
+
+// Reconstruct a code the way the decoder does and step the state on
+static inline void adpcm_update(AdpcmState* s, uint32_t code) {
+    int32_t step = adpcm_step[s->index];
+    int32_t delta = step >> 3;
+    if (code & 4) delta += step;
+    if (code & 2) delta += step >> 1;
+    if (code & 1) delta += step >> 2;
+    s->predictor = adpcm_clamp(s->predictor + ((code & 8) ? -delta : delta), -32768, 32767);
+    s->index = adpcm_clamp(s->index + adpcm_index_step[code & 7], 0, 88);
+}
+
+static inline uint32_t adpcm_encode_sample(AdpcmState* s, int16_t x) {
+    int32_t step = adpcm_step[s->index];
+    int32_t diff = x - s->predictor;
+    uint32_t code = 0;
+    if (diff < 0) {
+        code = 8;
+        diff = -diff;
+    }
+    // Three compare-and-subtract steps: the magnitude in units of step / 4
+    if (diff >= step) { code |= 4; diff -= step; }
+    if (diff >= step >> 1) { code |= 2; diff -= step >> 1; }
+    if (diff >= step >> 2) { code |= 1; }
+    adpcm_update(s, code);
+    return code;
+}
+
+void adpcm_init(AdpcmState* s) {
+    s->predictor = 0;
+    s->index = 0;
+}
+
+void adpcm_block_begin(AdpcmState* s, int16_t first, uint8_t* block) {
+    s->predictor = first;
+    block[0] = (uint8_t)((uint16_t)first & 0xFF);
+    block[1] = (uint8_t)((uint16_t)first >> 8);
+    block[2] = (uint8_t)s->index;
+    block[3] = 0;
+}
+
+void adpcm_encode(AdpcmState* s, const int16_t* pcm, uint8_t* block, uint32_t from, uint32_t n) {
+    uint8_t* data = block + 4;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t k = from + i - 1;          // Nibble index
+        uint32_t code = adpcm_encode_sample(s, pcm[i]);
+        if (k & 1) {
+            data[k >> 1] |= (uint8_t)(code << 4);
+        } else {
+            data[k >> 1] = (uint8_t)code;
+        }
+    }
+}
+
+int16_t adpcm_block_header(AdpcmState* s, const uint8_t* block) {
+    int16_t first = (int16_t)(block[0] | (block[1] << 8));
+    s->predictor = first;
+    s->index = adpcm_clamp(block[2], 0, 88);
+    return first;
+}
+
+void adpcm_decode(AdpcmState* s, const uint8_t* block, uint32_t from, int16_t* pcm, uint32_t n) {
+    const uint8_t* data = block + 4;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t k = from + i - 1;
+        adpcm_update(s, (data[k >> 1] >> ((k & 1) << 2)) & 0xF);
+        pcm[i] = (int16_t)s->predictor;
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef ADPCM_H
+#define ADPCM_H
+
+#include <stdint.h>
+
+// IMA (DVI) ADPCM, the 4-bit codec of WAVE_FORMAT_IMA_ADPCM, for takes on
+// the SD card at a quarter of the 16-bit PCM rate.
+//
+// Mono data is a run of ADPCM_BLOCK_BYTES blocks. Each block opens with a
+// 4-byte header (sample 0 verbatim, the step index, a zero byte) and then
+// holds the other ADPCM_BLOCK_SAMPLES - 1 samples as nibbles, low nibble
+// first. The header makes every block decodable on its own, which is what
+// lets a reader seek.
+//
+// Encoding is a fixed three-step successive approximation per sample, the
+// same work for every sample whatever the signal, so a capture burst costs
+// the same every time (pcm_convert_bench holds it to ADPCM_ENCODE_BUDGET).
+// The encoder tracks the decoder's reconstruction exactly, so the error
+// never accumulates across a block.
+
+#define ADPCM_BLOCK_BYTES       512     // One sector; also the WAV block align
+#define ADPCM_BLOCK_SAMPLES     ((ADPCM_BLOCK_BYTES - 4) * 2 + 1)
+#define ADPCM_ENCODE_BUDGET     40      // A53 cycles per sample the encoder may take
+
+typedef struct {
+    int32_t predictor;          // Last reconstructed sample
+    int32_t index;              // Step table index (0 .. 88)
+} AdpcmState;
+
+/**
+ * Start a stream: predictor and step index at zero
+ * @param s          State to initialise
+ */
+void adpcm_init(AdpcmState* s);
+
+/**
+ * Encoder: open a block with its header; the sample is carried verbatim
+ * @param s          Encoder state (the step index carries over from the last block)
+ * @param first      Sample 0 of the block
+ * @param block      ADPCM_BLOCK_BYTES bytes
+ */
+void adpcm_block_begin(AdpcmState* s, int16_t first, uint8_t* block);
+
+/**
+ * Encoder: append samples to a block opened with adpcm_block_begin
+ * @param s          Encoder state, at sample from - 1 of the block
+ * @param pcm        n samples
+ * @param block      Block being filled
+ * @param from       Index in the block of pcm[0] (1 .. ADPCM_BLOCK_SAMPLES - 1)
+ * @param n          Number of samples (from + n <= ADPCM_BLOCK_SAMPLES)
+ */
+void adpcm_encode(AdpcmState* s, const int16_t* pcm, uint8_t* block, uint32_t from, uint32_t n);
+
+/**
+ * Decoder: load a block's header
+ * @param s          Decoder state
+ * @param block      Block as read
+ * @return           Sample 0 of the block
+ */
+int16_t adpcm_block_header(AdpcmState* s, const uint8_t* block);
+
+/**
+ * Decoder: reconstruct samples of a block whose header has been loaded
+ * @param s          Decoder state, at sample from - 1 of the block
+ * @param block      Block as read
+ * @param from       Index in the block of the first sample wanted (1 .. ADPCM_BLOCK_SAMPLES - 1)
+ * @param pcm        Receives n samples
+ * @param n          Number of samples (from + n <= ADPCM_BLOCK_SAMPLES)
+ */
+void adpcm_decode(AdpcmState* s, const uint8_t* block, uint32_t from, int16_t* pcm, uint32_t n);
+
+#endif // ADPCM_H
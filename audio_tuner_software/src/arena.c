@@ -0,0 +1,230 @@
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+// From lscript.ld; weak so builds without the section link and use the heap
+extern uint8_t __arena_start[] __attribute__((weak));
+extern uint8_t __arena_end[] __attribute__((weak));
+extern uint8_t __ocm_hot_start[] __attribute__((weak));
+extern uint8_t __ocm_hot_end[] __attribute__((weak));
+
+#define ARENA_ROUND(n)  (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+static int arena_open;
+static size_t arena_top;            // Bytes handed out in the session
+static size_t arena_high;           // Peak of arena_top since the last reset
+static uint32_t arena_refused;
+
+// Hot blocks, a stack in address order: a freed block stays in place until
+// every block above it is free too
+typedef struct {
+    size_t bytes;                   // Rounded size
+    uint8_t live;
+    uint8_t session;                // Allocated inside an arena session
+} ArenaHotBlock;
+
+static ArenaHotBlock hot_blocks[ARENA_HOT_BLOCKS];
+static int hot_count;
+static size_t hot_top;              // Bytes below the first free byte
+static size_t hot_high;
+static uint32_t hot_spilled;
+
+size_t arena_size(void) {
+    uintptr_t start = (uintptr_t)__arena_start, end = (uintptr_t)__arena_end;
+    return start && end > start ? (size_t)(end - start) : 0;
+}
+
+static int arena_owns(const void* p) {
+    return arena_size() && (const uint8_t*)p >= __arena_start && (const uint8_t*)p < __arena_end;
+}
+
+int arena_begin(void) {
+    if (arena_open) {
+        return 0;
+    }
+    if (arena_size() == 0) {
+        return -1;
+    }
+    arena_open = 1;
+    arena_top = 0;
+    arena_high = 0;
+    return 0;
+}
+
+// Drop freed blocks off the top of the hot stack
+static void arena_hot_trim(void) {
+    while (hot_count > 0 && !hot_blocks[hot_count - 1].live) {
+        hot_top -= hot_blocks[--hot_count].bytes;
+    }
+}
+
+void arena_reset(void) {
+    arena_open = 0;
+    arena_top = 0;
+    for (int i = 0; i < hot_count; i++) {
+        if (hot_blocks[i].session) hot_blocks[i].live = 0;
+    }
+    arena_hot_trim();
+}
+
+// Bump allocation; the start of the section is ARENA_ALIGN aligned by lscript.ld
+static void* arena_bump(size_t bytes) {
+    size_t need = ARENA_ROUND(bytes ? bytes : 1);
+    if (need < bytes || need > arena_size() - arena_top) {
+        arena_refused++;
+        return NULL;
+    }
+    void* p = __arena_start + arena_top;
+    arena_top += need;
+    if (arena_top > arena_high) arena_high = arena_top;
+    return p;
+}
+
+void* arena_malloc(size_t bytes) {
+    return arena_open ? arena_bump(bytes) : malloc(bytes);
+}
+
+void* arena_calloc(size_t n, size_t size) {
+    if (!arena_open) {
+        return calloc(n, size);
+    }
+    if (size && n > (size_t)-1 / size) {
+        arena_refused++;
+        return NULL;
+    }
+    void* p = arena_bump(n * size);
+    if (p) memset(p, 0, n * size);
+    return p;
+}
+
+size_t arena_hot_size(void) {
+    uintptr_t start = (uintptr_t)__ocm_hot_start, end = (uintptr_t)__ocm_hot_end;
+    return start && end > start ? (size_t)(end - start) : 0;
+}
+
+static int arena_hot_owns(const void* p) {
+    return arena_hot_size() && (const uint8_t*)p >= __ocm_hot_start && (const uint8_t*)p < __ocm_hot_end;
+}
+
+void* arena_hot_malloc(size_t bytes) {
+    size_t need = ARENA_ROUND(bytes ? bytes : 1);
+    if (need < bytes || hot_count == ARENA_HOT_BLOCKS || need > arena_hot_size() - hot_top) {
+        // Only count a spill where there was OCM to miss
+        if (arena_hot_size()) hot_spilled++;
+        return arena_malloc(bytes);
+    }
+    void* p = __ocm_hot_start + hot_top;
+    ArenaHotBlock* b = &hot_blocks[hot_count++];
+    b->bytes = need;
+    b->live = 1;
+    b->session = (uint8_t)arena_open;
+    hot_top += need;
+    if (hot_top > hot_high) hot_high = hot_top;
+    return p;
+}
+
+void* arena_hot_calloc(size_t n, size_t size) {
+    if (size && n > (size_t)-1 / size) {
+        return NULL;
+    }
+    void* p = arena_hot_malloc(n * size);
+    if (p) memset(p, 0, n * size);
+    return p;
+}
+
+// Mark a hot block free; its space is reused once the blocks above it go
+static void arena_hot_free(const void* p) {
+    size_t offset = 0;
+    for (int i = 0; i < hot_count; i++) {
+        if (__ocm_hot_start + offset == (const uint8_t*)p) {
+            hot_blocks[i].live = 0;
+            break;
+        }
+        offset += hot_blocks[i].bytes;
+    }
+    arena_hot_trim();
+}
+
+void arena_free(void* p) {
+    // Arena blocks go back all at once on arena_reset
+    if (!p) {
+        return;
+    }
+    if (arena_hot_owns(p)) {
+        arena_hot_free(p);
+    } else if (!arena_owns(p)) {
+        free(p);
+    }
+}
+
+int arena_active(void) {
+    return arena_open;
+}
+
+size_t arena_used(void) {
+    return arena_open ? arena_top : 0;
+}
+
+size_t arena_peak(void) {
+    return arena_high;
+}
+
+uint32_t arena_failures(void) {
+    return arena_refused;
+}
+
+size_t arena_hot_used(void) {
+    return hot_top;
+}
+
+size_t arena_hot_peak(void) {
+    return hot_high;
+}
+
+uint32_t arena_hot_spills(void) {
+    return hot_spilled;
+}
+
+int arena_pool_init(ArenaPool* pool, size_t block_bytes, uint32_t blocks) {
+    memset(pool, 0, sizeof(*pool));
+    if (!arena_open || blocks == 0) {
+        return -1;
+    }
+    size_t stride = ARENA_ROUND(block_bytes < sizeof(void*) ? sizeof(void*) : block_bytes);
+    if (blocks > (size_t)-1 / stride) {
+        return -1;
+    }
+    uint8_t* base = arena_bump(stride * blocks);
+    if (!base) {
+        return -1;
+    }
+
+    // Thread the free list through the blocks, lowest address first
+    for (uint32_t i = 0; i < blocks; i++) {
+        void* next = i + 1 < blocks ? base + (i + 1) * stride : NULL;
+        memcpy(base + i * stride, &next, sizeof(next));
+    }
+    pool->free_list = base;
+    pool->block_bytes = stride;
+    pool->blocks = blocks;
+    return 0;
+}
+
+void* arena_pool_get(ArenaPool* pool) {
+    void* p = pool->free_list;
+    if (!p) {
+        return NULL;
+    }
+    memcpy(&pool->free_list, p, sizeof(void*));
+    if (++pool->in_use > pool->peak) pool->peak = pool->in_use;
+    return p;
+}
+
+void arena_pool_put(ArenaPool* pool, void* p) {
+    if (!p) {
+        return;
+    }
+    memcpy(p, &pool->free_list, sizeof(void*));
+    pool->free_list = p;
+    pool->in_use--;
+}
@@ -0,0 +1,163 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-take bump allocator over the .arena section of lscript.ld (64 MB of
+// DDR by default, _ARENA_SIZE), next to fixed-size block pools carved from it.
+//
+// The processing modules allocate through arena_malloc/arena_calloc and
+// release through arena_free. Between arena_begin() and arena_reset() those
+// come from the arena: an allocation is a pointer bump, arena_free is a
+// no-op and the whole take's memory goes back at once on arena_reset (state
+// 7), so there is no fragmentation and arena_peak() is the take's exact
+// footprint. Outside a session (boot-time setup, live mode, the RTOS build)
+// and in builds whose linker script has no .arena section (the R5 app, host
+// tools) they fall through to malloc/free, so the same code runs everywhere.
+//
+// Anything that must outlive the take has to be allocated outside the
+// session; nothing allocated inside may be used after arena_reset.
+//
+// Hot memory: the tables and scratch a DSP kernel touches every frame (FFT
+// twiddles, window, phase state, frame buffers) come from arena_hot_malloc,
+// which carves them out of on-chip memory (the .ocm_hot section, _OCM_HOT_SIZE
+// of OCM) so they do not compete in L2 with the take buffers streaming through
+// DDR, and a refill is an OCM access rather than a DDR one. Hot blocks are
+// released by arena_free in any order; the space is reused once the blocks
+// above it are free, and arena_reset releases the ones a session allocated.
+// When OCM is full, or the build has no .ocm_hot (host tools, the R5 app),
+// arena_hot_malloc is arena_malloc. ARENA_HOT places a static buffer there
+// (NOLOAD: not zeroed at boot). The A53 has no cache lockdown, so OCM is the
+// way to keep a working set out of DDR.
+
+#define ARENA_ALIGN         64      // Every block starts on a cache line
+#define ARENA_HOT_BLOCKS    48      // Hot blocks live at once
+
+#define ARENA_HOT           __attribute__((section(".ocm_hot"), aligned(ARENA_ALIGN)))
+
+typedef struct {
+    void* free_list;                // Next free block (the first word of each holds the link)
+    size_t block_bytes;
+    uint32_t blocks;
+    uint32_t in_use;
+    uint32_t peak;
+} ArenaPool;
+
+/**
+ * Route arena_malloc/arena_calloc to the arena until arena_reset (no-op while a session is open)
+ * @return           0 on success, -1 if the build has no .arena section (allocations stay on the heap)
+ */
+int arena_begin(void);
+
+/**
+ * End the session: everything allocated since arena_begin is gone and the heap is used again
+ */
+void arena_reset(void);
+
+/**
+ * Allocate from the arena in a session, from the heap otherwise
+ * @param bytes      Size
+ * @return           ARENA_ALIGN aligned block (heap: malloc alignment), NULL when out of memory
+ */
+void* arena_malloc(size_t bytes);
+
+/**
+ * As arena_malloc, zeroed
+ * @param n          Elements
+ * @param size       Bytes per element
+ * @return           Zeroed block, NULL when out of memory
+ */
+void* arena_calloc(size_t n, size_t size);
+
+/**
+ * Allocate per-frame tables or scratch from on-chip memory, falling back to arena_malloc
+ * @param bytes      Size
+ * @return           ARENA_ALIGN aligned block, NULL when out of memory
+ */
+void* arena_hot_malloc(size_t bytes);
+
+/**
+ * As arena_hot_malloc, zeroed
+ * @param n          Elements
+ * @param size       Bytes per element
+ * @return           Zeroed block, NULL when out of memory
+ */
+void* arena_hot_calloc(size_t n, size_t size);
+
+/**
+ * Release a block from arena_malloc/arena_calloc/arena_hot_malloc/arena_hot_calloc
+ * (arena blocks wait for arena_reset; hot blocks are free for reuse at once)
+ * @param p          Block or NULL
+ */
+void arena_free(void* p);
+
+/**
+ * @return           Whether a session is open
+ */
+int arena_active(void);
+
+/**
+ * @return           Bytes handed out in the current session
+ */
+size_t arena_used(void);
+
+/**
+ * @return           Most bytes handed out at once since the last arena_reset
+ */
+size_t arena_peak(void);
+
+/**
+ * @return           Size of the .arena section (0 if the build has none)
+ */
+size_t arena_size(void);
+
+/**
+ * @return           Allocations refused since boot because the arena was full
+ */
+uint32_t arena_failures(void);
+
+/**
+ * @return           Size of the hot region in OCM (0 if the build has none)
+ */
+size_t arena_hot_size(void);
+
+/**
+ * @return           Hot bytes in use
+ */
+size_t arena_hot_used(void);
+
+/**
+ * @return           Most hot bytes in use at once since boot
+ */
+size_t arena_hot_peak(void);
+
+/**
+ * @return           arena_hot_malloc calls since boot that OCM could not hold (served from DDR)
+ */
+uint32_t arena_hot_spills(void);
+
+/**
+ * Carve a pool of equal blocks out of the arena (needs an open session; gone on arena_reset)
+ * @param pool       Pool to set up
+ * @param block_bytes Bytes per block (rounded up to ARENA_ALIGN)
+ * @param blocks     Number of blocks
+ * @return           0 on success, -1 outside a session or when the arena is full
+ */
+int arena_pool_init(ArenaPool* pool, size_t block_bytes, uint32_t blocks);
+
+/**
+ * Take a block from a pool, O(1)
+ * @param pool       Pool
+ * @return           Block, or NULL if all are in use
+ */
+void* arena_pool_get(ArenaPool* pool);
+
+/**
+ * Give a block back to its pool, O(1)
+ * @param pool       Pool the block came from
+ * @param p          Block or NULL
+ */
+void arena_pool_put(ArenaPool* pool, void* p);
+
+#endif // ARENA_H
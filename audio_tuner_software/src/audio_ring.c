@@ -0,0 +1,49 @@
+#include <string.h>
+#include "audio_ring.h"
+
+int audio_ring_init(AudioRing* r, void* storage, size_t storage_bytes,
+                    uint32_t block_bytes, uint32_t blocks) {
+    if (!storage || block_bytes == 0 || blocks < 2 || (blocks & (blocks - 1)) ||
+        ((uintptr_t)storage % AUDIO_RING_LINE) || ((uintptr_t)r % AUDIO_RING_LINE) ||
+        storage_bytes < (size_t)AUDIO_RING_STORAGE_BYTES(block_bytes, blocks)) {
+        return -1;
+    }
+    r->head = 0;
+    r->tail_seen = 0;
+    r->overruns = 0;
+    r->tail = 0;
+    r->head_seen = 0;
+    r->data = storage;
+    r->stride = AUDIO_RING_STRIDE(block_bytes);
+    r->block_bytes = block_bytes;
+    r->blocks = blocks;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return 0;
+}
+
+int audio_ring_push(AudioRing* r, const void* block) {
+    void* dst = audio_ring_write_block(r);
+    if (!dst) {
+        r->overruns++;
+        return -1;
+    }
+    memcpy(dst, block, r->block_bytes);
+    audio_ring_commit(r);
+    return 0;
+}
+
+int audio_ring_pop(AudioRing* r, void* block) {
+    const void* src = audio_ring_read_block(r);
+    if (!src) {
+        return -1;
+    }
+    memcpy(block, src, r->block_bytes);
+    audio_ring_release(r);
+    return 0;
+}
+
+uint32_t audio_ring_count(const AudioRing* r) {
+    uint32_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+    uint32_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    return head - tail;
+}
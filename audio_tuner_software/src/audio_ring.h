@@ -0,0 +1,139 @@
+#ifndef AUDIO_RING_H
+#define AUDIO_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Lock-free single-producer / single-consumer ring of fixed-size audio blocks.
+//
+// One side (an ISR, a task, a core) only writes blocks, the other only reads
+// them. The producer owns head and the consumer owns tail; each index has its
+// own cache line next to the owner's cached copy of the other index, so a
+// side only touches the other's line when its cached view says the ring is
+// full (or empty). Blocks are padded to whole cache lines, so the block being
+// written never shares a line with the block being read.
+//
+// Publishing is a release store of the index after the block is written and
+// observing it an acquire load before the block is read, so the two sides
+// need to be coherent observers of the ring: the same core (ISR and main
+// loop), or A53 cores sharing the default inner-shareable mapping. For a
+// non-coherent peer put the ring and its storage in the .dma_buf section
+// (dma_mem.h) instead.
+//
+// No locks and no malloc: the caller supplies the storage, e.g.
+//   static uint8_t store[AUDIO_RING_STORAGE_BYTES(512, 8)] AUDIO_RING_OCM;
+//   static AudioRing ring AUDIO_RING_OCM;
+//   audio_ring_init(&ring, store, sizeof(store), 512, 8);
+// AUDIO_RING_OCM places both in on-chip memory (the .ocm_ring section of
+// lscript.ld), which the two cores reach without going out to DDR.
+
+#define AUDIO_RING_LINE             64
+#define AUDIO_RING_ALIGN            __attribute__((aligned(AUDIO_RING_LINE)))
+#define AUDIO_RING_OCM              __attribute__((section(".ocm_ring"), aligned(AUDIO_RING_LINE)))
+
+#define AUDIO_RING_STRIDE(block_bytes) \
+    (((block_bytes) + AUDIO_RING_LINE - 1) / AUDIO_RING_LINE * AUDIO_RING_LINE)
+#define AUDIO_RING_STORAGE_BYTES(block_bytes, blocks) \
+    (AUDIO_RING_STRIDE(block_bytes) * (blocks))
+
+typedef struct {
+    // Producer line
+    uint32_t head AUDIO_RING_ALIGN;     // Blocks committed (free-running)
+    uint32_t tail_seen;                 // Producer's last view of tail
+    uint32_t overruns;                  // Pushes refused because the ring was full
+
+    // Consumer line
+    uint32_t tail AUDIO_RING_ALIGN;     // Blocks released (free-running)
+    uint32_t head_seen;                 // Consumer's last view of head
+
+    // Read-only after audio_ring_init
+    uint8_t* data AUDIO_RING_ALIGN;
+    uint32_t stride;                    // Bytes between blocks
+    uint32_t block_bytes;
+    uint32_t blocks;                    // Power of two
+} AudioRing;
+
+/**
+ * Set up an empty ring over caller-supplied storage (not touched by the ring otherwise)
+ * @param r            Ring (AUDIO_RING_LINE aligned; the attribute macros do this)
+ * @param storage      AUDIO_RING_LINE aligned buffer of at least AUDIO_RING_STORAGE_BYTES bytes
+ * @param storage_bytes Size of storage
+ * @param block_bytes  Bytes per block
+ * @param blocks       Number of blocks (power of two, >= 2)
+ * @return             0 on success, -1 on a bad size or alignment
+ */
+int audio_ring_init(AudioRing* r, void* storage, size_t storage_bytes,
+                    uint32_t block_bytes, uint32_t blocks);
+
+/**
+ * Producer: block to fill next
+ * @param r            Ring
+ * @return             Block of block_bytes, or NULL if the ring is full
+ */
+static inline void* audio_ring_write_block(AudioRing* r) {
+    uint32_t head = r->head;
+    if (head - r->tail_seen == r->blocks) {
+        r->tail_seen = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+        if (head - r->tail_seen == r->blocks) {
+            return NULL;
+        }
+    }
+    return r->data + (head & (r->blocks - 1)) * r->stride;
+}
+
+/**
+ * Producer: publish the block returned by audio_ring_write_block
+ * @param r            Ring
+ */
+static inline void audio_ring_commit(AudioRing* r) {
+    __atomic_store_n(&r->head, r->head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Consumer: oldest published block
+ * @param r            Ring
+ * @return             Block of block_bytes, or NULL if the ring is empty
+ */
+static inline const void* audio_ring_read_block(AudioRing* r) {
+    uint32_t tail = r->tail;
+    if (tail == r->head_seen) {
+        r->head_seen = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        if (tail == r->head_seen) {
+            return NULL;
+        }
+    }
+    return r->data + (tail & (r->blocks - 1)) * r->stride;
+}
+
+/**
+ * Consumer: hand the block returned by audio_ring_read_block back to the producer
+ * @param r            Ring
+ */
+static inline void audio_ring_release(AudioRing* r) {
+    __atomic_store_n(&r->tail, r->tail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Producer: copy a block in
+ * @param r            Ring
+ * @param block        block_bytes to copy
+ * @return             0 on success, -1 if the ring is full (counted in overruns)
+ */
+int audio_ring_push(AudioRing* r, const void* block);
+
+/**
+ * Consumer: copy the oldest block out
+ * @param r            Ring
+ * @param block        Receives block_bytes
+ * @return             0 on success, -1 if the ring is empty
+ */
+int audio_ring_pop(AudioRing* r, void* block);
+
+/**
+ * Blocks waiting; a snapshot that the other side may already have changed
+ * @param r            Ring
+ * @return             Published blocks not yet released
+ */
+uint32_t audio_ring_count(const AudioRing* r);
+
+#endif // AUDIO_RING_H
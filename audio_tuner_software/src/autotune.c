@@ -0,0 +1,102 @@
+#include <math.h>
+#include <string.h>
+#include "autotune.h"
+#include "arena.h"
+
+void autotune_default_config(AutotuneConfig* cfg) {
+    cfg->target = 0.0f;
+    cfg->anchor = 0.0f;
+    cfg->glide = AUTOTUNE_GLIDE;
+    cfg->min_probability = AUTOTUNE_MIN_PROB;
+    cfg->scale = NULL;
+}
+
+int autotune_contour_init(AutotuneContour* c, int capacity, int step, int first) {
+    memset(c, 0, sizeof(*c));
+    if (capacity < 1 || step < 1) {
+        return -1;
+    }
+    c->pitch = (float*)arena_malloc(capacity * sizeof(float));
+    c->probability = (float*)arena_malloc(capacity * sizeof(float));
+    if (!c->pitch || !c->probability) {
+        autotune_contour_free(c);
+        return -1;
+    }
+    c->capacity = capacity;
+    c->step = step;
+    c->first = first;
+    return 0;
+}
+
+void autotune_contour_free(AutotuneContour* c) {
+    arena_free(c->pitch);
+    arena_free(c->probability);
+    memset(c, 0, sizeof(*c));
+}
+
+void autotune_contour_add(AutotuneContour* c, float pitch, float probability) {
+    if (c->count < c->capacity) {
+        c->pitch[c->count] = pitch;
+        c->probability[c->count] = probability;
+        c->count++;
+    }
+}
+
+// Pitch at point i, or -1 if unvoiced
+static float at_point(const AutotuneContour* c, const AutotuneConfig* cfg, int i) {
+    if (i < 0 || i >= c->count || c->probability[i] < cfg->min_probability) {
+        return -1.0f;
+    }
+    return c->pitch[i];
+}
+
+// Median of the three points around i, so a single octave error or dropout does not move the ratio
+static float contour_pitch(const AutotuneContour* c, const AutotuneConfig* cfg, int i) {
+    float a = at_point(c, cfg, i - 1), b = at_point(c, cfg, i), d = at_point(c, cfg, i + 1);
+    if (b <= 0.0f) {
+        return a > 0.0f && d > 0.0f ? 0.5f * (a + d) : -1.0f;
+    }
+    if (a <= 0.0f || d <= 0.0f) {
+        return b;
+    }
+    if ((a <= b) == (b <= d)) return b;
+    if ((b <= a) == (a <= d)) return a;
+    return d;
+}
+
+// Ratio that moves pitch to the target note, or to the nearest note of the scale. The
+// target's octave follows the pitch's octave from the anchor, so a phrase
+// that jumps an octave is not folded back onto the take's note
+static float target_ratio(const AutotuneConfig* cfg, float pitch) {
+    if (cfg->target > 0.0f) {
+        float anchor = cfg->anchor > 0.0f ? cfg->anchor : cfg->target;
+        int octave = (int)floorf(scale_log2(pitch) - scale_log2(anchor) + 0.5f);
+        return cfg->target * scale_pow2(octave) / pitch;
+    }
+    float ratio;
+    scale_quantize_note(cfg->scale ? cfg->scale : &scale_chromatic, pitch, &ratio);
+    return ratio;
+}
+
+int autotune_curve(const AutotuneContour* c, const AutotuneConfig* cfg, int hop, int fft_size,
+                   float* curve, int frames) {
+    const float glide = cfg->glide > 0.0f && cfg->glide <= 1.0f ? cfg->glide : 1.0f;
+    float ratio = 1.0f;
+    int voiced = 0;
+
+    for (int k = 0; k < frames; k++) {
+        // Contour point nearest the frame centre
+        int centre = (k + 1) * hop - fft_size / 2;
+        int i = (int)floorf((float)(centre - c->first) / c->step + 0.5f);
+        float pitch = contour_pitch(c, cfg, i);
+
+        float target = 1.0f;
+        if (pitch > 0.0f) {
+            target = target_ratio(cfg, pitch);
+            voiced++;
+        }
+        ratio += (target - ratio) * glide;
+        curve[k] = ratio;
+    }
+    return voiced;
+}
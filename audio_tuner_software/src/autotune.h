@@ -0,0 +1,81 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <stdint.h>
+#include "scale.h"
+
+// Time-varying pitch correction for a take.
+//
+// The capture tracker's pitch contour (one point per recorded burst) is
+// turned into a ratio curve with one entry per vocoder frame
+// (pv_set_ratio_curve): each voiced frame is moved to the target note, or
+// to the nearest note of a scale, and the ratio glides there so a drifting held
+// note is pulled back in tune without steps. Unvoiced frames glide back to 1.
+//
+// The contour is allocated once per take (arena_malloc) and filled as the
+// bursts arrive; building the curve is a single pass over the frames.
+
+#define AUTOTUNE_GLIDE          0.3f    // Fraction of the way to the target per frame
+#define AUTOTUNE_MIN_PROB       0.6f    // Contour points below this count as unvoiced
+
+typedef struct {
+    float* pitch;               // Hz, <= 0 if unvoiced
+    float* probability;
+    int capacity;
+    int count;
+    int step;                   // Input samples between points
+    int first;                  // Input sample point 0 describes (centre of its window)
+} AutotuneContour;
+
+typedef struct {
+    float target;               // Hz every voiced frame is moved to; <= 0 snaps to the nearest note of scale
+    float anchor;               // Pitch that maps to target itself (an octave up maps an octave up); <= 0: target
+    float glide;                // Fraction of the way to the target ratio per frame (0 .. 1]
+    float min_probability;      // Below this a point counts as unvoiced
+    const Scale* scale;         // Notes allowed when there is no target; NULL: chromatic
+} AutotuneConfig;
+
+/**
+ * Fill a config with the defaults (nearest chromatic note, AUTOTUNE_GLIDE, AUTOTUNE_MIN_PROB)
+ * @param cfg        Config to fill
+ */
+void autotune_default_config(AutotuneConfig* cfg);
+
+/**
+ * Allocate a contour
+ * @param c          Contour to initialise
+ * @param capacity   Points kept (later points are dropped)
+ * @param step       Input samples between points
+ * @param first      Input sample point 0 describes
+ * @return           0 on success, -1 on bad arguments or allocation failure
+ */
+int autotune_contour_init(AutotuneContour* c, int capacity, int step, int first);
+
+/**
+ * Free a contour (one that failed to initialise is ignored)
+ * @param c          Contour from autotune_contour_init
+ */
+void autotune_contour_free(AutotuneContour* c);
+
+/**
+ * Append the next point
+ * @param c          Contour from autotune_contour_init
+ * @param pitch      Pitch in Hz, <= 0 if unvoiced
+ * @param probability Its probability as a decimal
+ */
+void autotune_contour_add(AutotuneContour* c, float pitch, float probability);
+
+/**
+ * Build the ratio curve for a vocoder stream over the contour's input
+ * @param c          Filled contour
+ * @param cfg        Target and smoothing
+ * @param hop        Vocoder analysis hop
+ * @param fft_size   Vocoder frame (frame k is centred on input (k + 1) * hop - fft_size / 2)
+ * @param curve      Receives one ratio per frame
+ * @param frames     Entries to fill
+ * @return           Voiced frames in the curve (0: nothing to correct, curve is all 1)
+ */
+int autotune_curve(const AutotuneContour* c, const AutotuneConfig* cfg, int hop, int fft_size,
+                   float* curve, int frames);
+
+#endif // AUTOTUNE_H
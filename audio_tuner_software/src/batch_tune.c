@@ -0,0 +1,395 @@
+#include <stdio.h>
+#include <string.h>
+#include "batch_tune.h"
+#include "ff.h"
+#include "wav_reader.h"
+#include "YinAnalysis.h"
+#include "shift_engine.h"
+#include "scale.h"
+#include "sd_sink.h"
+#include "dlog.h"
+#include "xtime_l.h"
+
+#define BATCH_BUFS          2           // Takes per stage pair (one being filled, one being emptied)
+#define BATCH_PATH          80
+#define BATCH_NAME          48
+
+#define BATCH_MEM           __attribute__((section(".take_buf"), aligned(64)))
+
+#if BATCH_BUFS > SD_SINK_FILES
+#error "every output buffer must fit in the SD sink queue"
+#endif
+
+typedef enum {
+    BATCH_FREE,                 // Buffer pair holds nothing
+    BATCH_READING,              // The reader is filling the input buffer
+    BATCH_READY,                // Read and analysed, waiting for the shifter
+} BatchState;
+
+typedef struct {
+    BatchState state;
+    char name[BATCH_NAME];
+    uint32_t samples;
+    uint32_t fs;
+    float pitch;                // Histogram pitch of the grid
+    float voicing;              // Voiced fraction of the grid
+} BatchTake;
+
+// Input buffer k is filled by the reader and emptied by the shifter; output
+// buffer k is filled by the shifter and emptied by the SD sink
+static int16_t bt_in[BATCH_BUFS][BATCH_TUNE_MAX_SAMPLES] BATCH_MEM;
+static int16_t bt_out[BATCH_BUFS][BATCH_TUNE_MAX_SAMPLES] BATCH_MEM;
+static int16_t bt_stage[BATCH_TUNE_CHUNK + SHIFT_ENGINE_FLUSH_ROOM];
+static BatchTake bt_take[BATCH_BUFS];
+
+static const BatchTuneConfig* bt_cfg;
+static BatchTuneStats* bt_stats;
+
+// Directory scan
+static DIR bt_dir;
+static FILINFO bt_fno;
+static int bt_scan_left;        // bt_fno holds an entry not handed out yet
+
+// Read stage
+static int bt_reading;          // bt_wav is open on bt_take[bt_read]
+static int bt_read;
+static WavReader bt_wav;
+static YinAnalysis bt_yin;
+
+// Shift stage
+static int bt_shifting;         // bt_eng is open on bt_take[bt_shift]
+static int bt_shift;
+static int bt_out_next;         // Output buffer for the next take shifted
+static ShiftEngine bt_eng;
+static int bt_skip;             // Latency samples still to drop
+static uint32_t bt_in_pos;
+static uint32_t bt_out_pos;
+
+void batch_tune_default_config(BatchTuneConfig* cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->dir = "0:";
+    cfg->engine = SHIFT_ENGINE_AUTO;
+    cfg->window = 1024;
+    cfg->hop = 48000 / 8;
+    cfg->max_windows = 256;
+    cfg->threshold = 0.15f;
+}
+
+/*** Directory scan ***/
+
+#if !FF_USE_FIND
+// f_findfirst is compiled out (FF_USE_FIND = 0 in ffconf.h): match the
+// pattern's one '*' by hand over f_readdir
+static int batch_match(const char* name) {
+    const char* star = strchr(BATCH_TUNE_PATTERN, '*');
+    size_t head = (size_t)(star - BATCH_TUNE_PATTERN);
+    size_t tail = strlen(star + 1);
+    size_t len = strlen(name);
+    return len >= head + tail && strncmp(name, BATCH_TUNE_PATTERN, head) == 0 &&
+           strcmp(name + len - tail, star + 1) == 0;
+}
+
+static FRESULT batch_scan_step(void) {
+    FRESULT fr;
+    while ((fr = f_readdir(&bt_dir, &bt_fno)) == FR_OK && bt_fno.fname[0]) {
+        if (batch_match(bt_fno.fname)) break;
+    }
+    return fr;
+}
+#endif
+
+static int batch_scan_open(const char* dir) {
+#if FF_USE_FIND
+    FRESULT fr = f_findfirst(&bt_dir, &bt_fno, dir, BATCH_TUNE_PATTERN);
+#else
+    FRESULT fr = f_opendir(&bt_dir, dir);
+    if (fr == FR_OK) fr = batch_scan_step();
+#endif
+    bt_scan_left = fr == FR_OK && bt_fno.fname[0];
+    return fr == FR_OK ? 0 : -1;
+}
+
+// Next matching file name, 0 when there is one
+static int batch_scan_next(char* name) {
+    while (bt_scan_left) {
+        int take = !(bt_fno.fattrib & AM_DIR) && strlen(bt_fno.fname) < BATCH_NAME;
+        if (take) strcpy(name, bt_fno.fname);
+#if FF_USE_FIND
+        FRESULT fr = f_findnext(&bt_dir, &bt_fno);
+#else
+        FRESULT fr = batch_scan_step();
+#endif
+        bt_scan_left = fr == FR_OK && bt_fno.fname[0];
+        if (take) return 0;
+    }
+    return -1;
+}
+
+/*** Read stage: one block per step, analysed as it arrives ***/
+
+static void batch_read_end(BatchTake* t) {
+    wav_reader_close(&bt_wav);
+    YinAnalysis_free(&bt_yin);
+    bt_reading = 0;
+    if (t->state == BATCH_READY) {
+        bt_read = (bt_read + 1) % BATCH_BUFS;
+    } else {
+        t->state = BATCH_FREE;
+    }
+}
+
+static int batch_read_start(void) {
+    BatchTake* t = &bt_take[bt_read];
+    char path[BATCH_PATH];
+
+    if (t->state != BATCH_FREE || !bt_scan_left) {
+        return 0;       // Both inputs wait for the shifter, or nothing left to read
+    }
+    // Log records keep %s as a pointer: lines naming this slot's last take go out first
+    dlog_drain(0);
+    if (batch_scan_next(t->name) != 0) {
+        return 0;
+    }
+    snprintf(path, sizeof(path), "%s/%s", bt_cfg->dir, t->name);
+    FRESULT fr = wav_reader_open(&bt_wav, path);
+    if (fr != FR_OK) {
+        DLOG_WARN("Batch: %s: %s\r\n", t->name, fr == FR_INVALID_OBJECT ? "not 16-bit PCM" : "cannot open");
+        if (fr == FR_INVALID_OBJECT) bt_stats->skipped++; else bt_stats->failed++;
+        return 1;
+    }
+    if (bt_wav.channels != 1 || bt_wav.frames == 0 || bt_wav.frames > BATCH_TUNE_MAX_SAMPLES) {
+        DLOG_WARN("Batch: %s: skipped (%u channels, %lu samples)\r\n", t->name,
+                  (unsigned)bt_wav.channels, (unsigned long)bt_wav.frames);
+        bt_stats->skipped++;
+        wav_reader_close(&bt_wav);
+        return 1;
+    }
+    if (YinAnalysis_init(&bt_yin, bt_cfg->window, bt_cfg->hop, 0, bt_cfg->max_windows, bt_cfg->threshold) != 0) {
+        DLOG_ERROR("Batch: out of memory for the pitch grid\r\n");
+        bt_stats->failed++;
+        wav_reader_close(&bt_wav);
+        return 1;
+    }
+    Yin_setSampleRate(&bt_yin.yin, (int)bt_wav.fs);
+    t->samples = 0;
+    t->fs = bt_wav.fs;
+    t->state = BATCH_READING;
+    bt_reading = 1;
+    return 1;
+}
+
+static int batch_read_step(void) {
+    if (!bt_reading) {
+        return batch_read_start();
+    }
+
+    BatchTake* t = &bt_take[bt_read];
+    int16_t* dst = bt_in[bt_read] + t->samples;
+    uint32_t n = bt_wav.frames - t->samples;
+    uint32_t got = 0;
+    if (n > BATCH_TUNE_READ_BLOCK) n = BATCH_TUNE_READ_BLOCK;
+    if (n > 0 && wav_reader_read(&bt_wav, dst, n, &got) != FR_OK) {
+        DLOG_ERROR("Batch: %s: read failed\r\n", t->name);
+        bt_stats->failed++;
+        batch_read_end(t);
+        return 1;
+    }
+    if (got > 0) {
+        YinAnalysis_push(&bt_yin, dst, (int)got);
+        t->samples += got;
+    }
+    if (got < n || t->samples == bt_wav.frames) {
+        YinSummary sum;
+        YinAnalysis_summarise(&bt_yin, &sum);
+        if (sum.voiced > 0) {
+            t->pitch = sum.histogramPitch;
+            t->voicing = sum.voicedRatio;
+            t->state = BATCH_READY;
+        } else {
+            DLOG_INFO("Batch: %s: no pitch found, skipped\r\n", t->name);
+            bt_stats->skipped++;
+        }
+        batch_read_end(t);
+    }
+    return 1;
+}
+
+/*** Shift stage: one chunk per step ***/
+
+static int batch_shift_start(void) {
+    BatchTake* t = &bt_take[bt_shift];
+    if (t->state != BATCH_READY || sd_sink_queued() == BATCH_BUFS) {
+        return 0;       // Nothing read yet, or both outputs are still being written
+    }
+
+    // Same rule as a recorded take against target.wav
+    float target = scale_reference_target(t->pitch, bt_cfg->ref_pitch, bt_cfg->ref_note_class);
+    if (target <= 0.0f) {
+        DLOG_INFO("Batch: %s: no target note, skipped\r\n", t->name);
+        bt_stats->skipped++;
+        t->state = BATCH_FREE;
+        bt_shift = (bt_shift + 1) % BATCH_BUFS;
+        return 1;
+    }
+    float ratio = target / t->pitch;
+    if (ratio > 2.0f) ratio = 2.0f;
+    if (ratio < 0.5f) ratio = 0.5f;
+
+    ShiftRequest req = { ratio, t->voicing, 0, 0 };
+    ShiftEngineConfig scfg;
+    shift_engine_default_config(&scfg);
+    ShiftEngineId id = bt_cfg->engine == SHIFT_ENGINE_AUTO ? shift_engine_select(&req, &scfg)
+                                                           : (ShiftEngineId)bt_cfg->engine;
+    if (shift_engine_open(&bt_eng, id, &scfg, ratio) != 0) {
+        DLOG_ERROR("Batch: %s: failed to create pitch shifter\r\n", t->name);
+        bt_stats->failed++;
+        t->state = BATCH_FREE;
+        bt_shift = (bt_shift + 1) % BATCH_BUFS;
+        return 1;
+    }
+    DLOG_INFO("Batch: %s: %.2f Hz -> %.2f Hz (%s, %d%% voiced)\r\n", t->name, t->pitch, target,
+              shift_engine_name(id), (int)(t->voicing * 100.0f));
+    bt_skip = shift_engine_latency(&bt_eng);
+    bt_in_pos = 0;
+    bt_out_pos = 0;
+    bt_shifting = 1;
+    return 1;
+}
+
+// The take is shifted: queue its output and free its input
+static void batch_shift_end(BatchTake* t) {
+    int16_t* out = bt_out[bt_out_next];
+    char path[BATCH_PATH];
+
+    memset(out + bt_out_pos, 0, (t->samples - bt_out_pos) * sizeof(int16_t));
+    shift_engine_close(&bt_eng);
+    bt_shifting = 0;
+
+    // rec_xxx.wav -> out_xxx.wav
+    const char* stem = strncmp(t->name, "rec", 3) == 0 ? t->name + 3 : t->name;
+    snprintf(path, sizeof(path), "%s/out%s%s", bt_cfg->dir, stem == t->name ? "_" : "", stem);
+    if (sd_sink_add(path, out, t->samples, t->fs, 16) != 0) {
+        DLOG_ERROR("Batch: cannot queue %s\r\n", path);
+        bt_stats->failed++;
+    } else {
+        bt_stats->files++;
+        bt_stats->audio_us += (uint64_t)t->samples * 1000000 / t->fs;
+        bt_out_next = (bt_out_next + 1) % BATCH_BUFS;
+    }
+    t->state = BATCH_FREE;
+    bt_shift = (bt_shift + 1) % BATCH_BUFS;
+}
+
+static int batch_shift_step(void) {
+    if (!bt_shifting) {
+        return batch_shift_start();
+    }
+
+    BatchTake* t = &bt_take[bt_shift];
+    const int16_t* in = bt_in[bt_shift];
+    int16_t* out = bt_out[bt_out_next];
+    int16_t* dst = bt_stage;
+    int produced;
+
+    if (bt_in_pos < t->samples) {
+        uint32_t n = t->samples - bt_in_pos;
+        if (n > BATCH_TUNE_CHUNK) n = BATCH_TUNE_CHUNK;
+        // Past the latency the shifter writes straight into the output take
+        if (bt_skip == 0 && t->samples - bt_out_pos >= n + shift_engine_overrun(&bt_eng)) {
+            dst = out + bt_out_pos;
+        }
+        produced = shift_engine_process(&bt_eng, in + bt_in_pos, (int)n, dst);
+        bt_in_pos += n;
+    } else {
+        produced = shift_engine_flush(&bt_eng, bt_stage);
+        if (produced == 0) {
+            batch_shift_end(t);
+            return 1;
+        }
+    }
+
+    // Drop the latency and anything past the input length
+    int first = 0;
+    if (bt_skip > 0) {
+        first = bt_skip < produced ? bt_skip : produced;
+        bt_skip -= first;
+    }
+    int count = produced - first;
+    if (count > (int)(t->samples - bt_out_pos)) {
+        count = (int)(t->samples - bt_out_pos);
+    }
+    if (count > 0) {
+        if (dst != out + bt_out_pos) {
+            memcpy(out + bt_out_pos, dst + first, count * sizeof(int16_t));
+        }
+        bt_out_pos += count;
+    }
+    if (bt_out_pos == t->samples) {
+        batch_shift_end(t);
+    }
+    return 1;
+}
+
+/*** Pipeline ***/
+
+static uint64_t batch_us(XTime ticks) {
+    return (uint64_t)ticks * 1000000 / COUNTS_PER_SECOND;
+}
+
+int batch_tune_run(const BatchTuneConfig* cfg, BatchTuneStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (cfg->ref_pitch <= 0.0f || cfg->window < 2 || cfg->hop < 1 || cfg->max_windows < 1) {
+        return -1;
+    }
+    if (sd_sink_flush() != 0) {
+        DLOG_WARN("Batch: files queued before the batch were not all saved\r\n");
+    }
+
+    bt_cfg = cfg;
+    bt_stats = stats;
+    memset(bt_take, 0, sizeof(bt_take));
+    bt_reading = bt_shifting = 0;
+    bt_read = bt_shift = bt_out_next = 0;
+    if (batch_scan_open(cfg->dir) != 0) {
+        DLOG_ERROR("Batch: cannot scan %s\r\n", cfg->dir);
+        return -1;
+    }
+
+    // One step of every stage per pass; all three idle means the scan is
+    // done, nothing is waiting to be shifted and the sink has written it all
+    XTime t_read = 0, t_shift = 0, t_write = 0;
+    XTime t0, t1, t2, t3;
+    int busy = 1;
+    XTime_GetTime(&t0);
+    const XTime start = t0;
+    while (busy) {
+        busy = batch_read_step();
+        XTime_GetTime(&t1);
+        busy |= batch_shift_step();
+        XTime_GetTime(&t2);
+        busy |= sd_sink_step();
+        XTime_GetTime(&t3);
+        t_read += t1 - t0;
+        t_shift += t2 - t1;
+        t_write += t3 - t2;
+        t0 = t3;
+    }
+
+    int lost = sd_sink_flush();
+    stats->files -= (uint32_t)lost;
+    stats->failed += (uint32_t)lost;
+    f_closedir(&bt_dir);
+    stats->total_us = batch_us(t0 - start);
+    stats->read_us = batch_us(t_read);
+    stats->shift_us = batch_us(t_shift);
+    stats->write_us = batch_us(t_write);
+    return 0;
+}
+
+float batch_tune_files_per_minute(const BatchTuneStats* stats) {
+    return stats->total_us ? stats->files * 60e6f / (float)stats->total_us : 0.0f;
+}
+
+float batch_tune_realtime_factor(const BatchTuneStats* stats) {
+    return stats->total_us ? (float)stats->audio_us / (float)stats->total_us : 0.0f;
+}
@@ -0,0 +1,91 @@
+#ifndef BATCH_TUNE_H
+#define BATCH_TUNE_H
+
+#include <stdint.h>
+
+// Offline retune of every take on the card.
+//
+// Every file matching the pattern (rec_*.wav) is read, moved to the note
+// the reference asks for and written back as out_*.wav, through three
+// stages that each own one file at a time:
+//
+//   read next (and its Yin grid) -> shift current -> write previous
+//
+// The main loop gives each stage one bounded step per pass: one block read
+// from the card, one chunk through the shifter, one block written by the
+// SD sink (sd_sink.h). A file therefore moves on as soon as its stage is
+// done with it, and the card is never left idle while a take is shifted.
+// FatFs calls block the core, so the stages take turns rather than run at
+// the same time; what does run alongside the card is whatever the shifter
+// has handed off (frames in flight on worker cores with PV_MULTICORE, a
+// forward transform on the fabric with PV_PL_FFT).
+//
+// The takes are held whole in DDR: two input and two output buffers of
+// BATCH_TUNE_MAX_SAMPLES each. A longer file, or one that is not 16-bit
+// mono PCM, is skipped.
+//
+// The pitch of a take comes from a Yin grid pushed a block at a time while
+// it is read, so the shift starts without a second pass over the file. The
+// target is chosen as for a recorded take: the nearest occurrence of the
+// reference's note class below a take that is sharp of the reference,
+// above one that is flat.
+
+#ifndef BATCH_TUNE_MAX_SAMPLES
+#define BATCH_TUNE_MAX_SAMPLES  (30 * 48000)    // Longest file (30 s at 48 kHz; 11 MB of buffers)
+#endif
+#define BATCH_TUNE_READ_BLOCK   8192    // Samples per card read
+#define BATCH_TUNE_CHUNK        1024    // Samples per shifter call
+#define BATCH_TUNE_PATTERN      "rec_*.wav"
+
+typedef struct {
+    const char* dir;            // Directory to scan (e.g. "0:")
+    float ref_pitch;            // Reference pitch in Hz (target.wav)
+    int ref_note_class;         // Its pitch class, 0 = C
+    int engine;                 // ShiftEngineId; SHIFT_ENGINE_AUTO picks one per take
+    int window;                 // Yin window (samples)
+    int hop;                    // Samples between windows
+    int max_windows;            // Windows per take
+    float threshold;            // Yin threshold
+} BatchTuneConfig;
+
+typedef struct {
+    uint32_t files;             // Files written
+    uint32_t skipped;           // Not 16-bit mono, too long, or no pitch found
+    uint32_t failed;            // Read, shift or write errors
+    uint64_t audio_us;          // Audio shifted
+    uint64_t total_us;          // Wall time of the batch
+    uint64_t read_us;           // Time in each stage (they add up to about total_us)
+    uint64_t shift_us;
+    uint64_t write_us;
+} BatchTuneStats;
+
+/**
+ * Fill a config with the defaults: "0:", the shifter picked per take,
+ * 1024-sample windows every 1/8 s (48 kHz), up to 256 windows, threshold 0.15.
+ * ref_pitch and ref_note_class are left to the caller.
+ * @param cfg        Config to fill
+ */
+void batch_tune_default_config(BatchTuneConfig* cfg);
+
+/**
+ * Retune every matching file in cfg->dir; the card must be mounted
+ * @param cfg        Config (ref_pitch > 0)
+ * @param stats      Receives the counters and stage times
+ * @return           0 once the directory has been processed (see stats for per-file
+ *                   results), -1 if it cannot be scanned or the config is invalid
+ */
+int batch_tune_run(const BatchTuneConfig* cfg, BatchTuneStats* stats);
+
+/**
+ * @param stats      Finished batch
+ * @return           Files written per minute of wall time
+ */
+float batch_tune_files_per_minute(const BatchTuneStats* stats);
+
+/**
+ * @param stats      Finished batch
+ * @return           Seconds of audio processed per second of wall time
+ */
+float batch_tune_realtime_factor(const BatchTuneStats* stats);
+
+#endif // BATCH_TUNE_H
@@ -0,0 +1,361 @@
+#include <string.h>
+#include "capture.h"
+#include "dma_mem.h"
+#include "xil_io.h"
+#include "xparameters.h"
+#include "xtime_l.h"
+
+#if CAPTURE_IRQ
+#include "irq.h"
+#include "xil_exception.h"
+#endif
+
+#define CAPTURE_SEG_BYTES    (CAPTURE_SEG_WORDS * sizeof(uint32_t))
+#define CAPTURE_SR_IDLE      0x2u            // S2MM_DMASR.Idle
+#define CAPTURE_CLOCK_SLACK  64              // Samples of sample-clock / timer disagreement tolerated
+
+#if (CAPTURE_SEG_WORDS & (CAPTURE_SEG_WORDS - 1)) != 0 || CAPTURE_SEG_WORDS > (1 << 15)
+#error "TLAST_LOG2 needs a power-of-two segment of at most 2^15 words"
+#endif
+
+#if CAPTURE_PL_DECIMATE
+#define CAPTURE_AN_SEG_BYTES (CAPTURE_AN_SEG_WORDS * sizeof(uint32_t))
+#if (CAPTURE_AN_SEG_WORDS & (CAPTURE_AN_SEG_WORDS - 1)) != 0 || CAPTURE_AN_SEG_WORDS > (1 << 15)
+#error "DEC_TLAST_LOG2 needs a power-of-two analysis segment of at most 2^15 words"
+#endif
+#endif
+
+static uint32_t cap_buf[CAPTURE_SEGMENTS][CAPTURE_SEG_WORDS] DMA_MEM;
+
+static XAxiDma* cap_dma;
+static volatile uint8_t cap_filled[CAPTURE_SEGMENTS];  // Received, not yet fully released
+static volatile int cap_armed = -1;         // Segment in flight (-1 = none)
+static volatile int cap_head;               // Next segment to arm
+static volatile int cap_running;            // Arming new segments
+static volatile int cap_error;              // Stopped on a DMA error
+static volatile int cap_stalled;            // A completion found no free segment
+static int cap_tail;                        // Segment being read
+static int cap_burst;                       // Next burst within cap_tail
+static XTime cap_t0;                        // capture_start time
+static uint64_t cap_received;               // Samples delivered by the DMA
+static CaptureStats cap_stats;
+
+#if CAPTURE_PL_DECIMATE
+// Analysis ring: the same scheme, polled, without the FIFO model
+static uint32_t an_buf[CAPTURE_SEGMENTS][CAPTURE_AN_SEG_WORDS] DMA_MEM;
+static XAxiDma an_dma;
+static uint8_t an_filled[CAPTURE_SEGMENTS];
+static int an_armed = -1;
+static int an_head;
+static int an_tail;
+static int an_burst;
+static int an_running;
+static int an_error;
+static int an_stalled;
+#endif
+
+#if CAPTURE_IRQ
+// The ISR and the consumer share the ring; the consumer side masks IRQs
+#define CAP_LOCK()      Xil_ExceptionDisable()
+#define CAP_UNLOCK()    Xil_ExceptionEnable()
+#else
+#define CAP_LOCK()
+#define CAP_UNLOCK()
+#endif
+
+// Arm cap_head, first accounting for the time no transfer was armed
+static void capture_arm(void) {
+    XTime now;
+    XTime_GetTime(&now);
+
+    // capture_start left the FIFO empty
+    uint64_t due = (uint64_t)(now - cap_t0) * CAPTURE_FS / COUNTS_PER_SECOND;
+    uint64_t have = cap_received + cap_stats.lost_samples;
+    uint64_t backlog = due > have ? due - have : 0;
+    if (backlog > CAPTURE_PL_FIFO + CAPTURE_CLOCK_SLACK) {
+        cap_stats.lost_samples += (uint32_t)(backlog - CAPTURE_PL_FIFO);
+        backlog = CAPTURE_PL_FIFO;
+    }
+    if (backlog > cap_stats.max_backlog) {
+        cap_stats.max_backlog = (uint32_t)backlog;
+    }
+
+    int seg = cap_head;
+    dma_mem_from_device(cap_buf[seg], CAPTURE_SEG_BYTES);
+    if (XAxiDma_SimpleTransfer(cap_dma, (UINTPTR)cap_buf[seg], CAPTURE_SEG_BYTES,
+                               XAXIDMA_DEVICE_TO_DMA) != XST_SUCCESS) {
+        cap_stats.dma_errors++;
+        cap_error = 1;
+        cap_running = 0;
+        return;
+    }
+    cap_armed = seg;
+    cap_head = (seg + 1) % CAPTURE_SEGMENTS;
+}
+
+// Retire a finished transfer and arm the next free segment (ISR or polled)
+static void capture_service(void) {
+    if (cap_armed >= 0) {
+        uint32_t sr = XAxiDma_ReadReg(cap_dma->RegBase, XAXIDMA_RX_OFFSET + XAXIDMA_SR_OFFSET);
+        if (sr & XAXIDMA_ERR_ALL_MASK) {
+            // The channel halts on an error until the DMA is reset (dma_recover)
+            cap_stats.dma_errors++;
+            cap_error = 1;
+            cap_running = 0;
+            cap_armed = -1;
+            return;
+        }
+        if (!(sr & CAPTURE_SR_IDLE)) {
+            return;
+        }
+
+        dma_mem_from_device(cap_buf[cap_armed], CAPTURE_SEG_BYTES);
+        cap_filled[cap_armed] = 1;
+        cap_received += CAPTURE_SEG_SAMPLES;
+        cap_stats.segments++;
+        cap_armed = -1;
+    }
+
+    if (!cap_running) {
+        return;
+    }
+    if (cap_filled[cap_head]) {
+        // Consumer is a whole ring behind; the PL FIFO absorbs the wait until it fills
+        if (!cap_stalled) {
+            cap_stalled = 1;
+            cap_stats.overruns++;
+        }
+        return;
+    }
+    cap_stalled = 0;
+    capture_arm();
+}
+
+#if CAPTURE_PL_DECIMATE
+static void capture_an_arm(void) {
+    int seg = an_head;
+    dma_mem_from_device(an_buf[seg], CAPTURE_AN_SEG_BYTES);
+    if (XAxiDma_SimpleTransfer(&an_dma, (UINTPTR)an_buf[seg], CAPTURE_AN_SEG_BYTES,
+                               XAXIDMA_DEVICE_TO_DMA) != XST_SUCCESS) {
+        cap_stats.dma_errors++;
+        an_error = 1;
+        an_running = 0;
+        return;
+    }
+    an_armed = seg;
+    an_head = (seg + 1) % CAPTURE_SEGMENTS;
+}
+
+// Consumer context only (the ISR never touches the analysis ring)
+static void capture_an_service(void) {
+    if (an_armed >= 0) {
+        uint32_t sr = XAxiDma_ReadReg(an_dma.RegBase, XAXIDMA_RX_OFFSET + XAXIDMA_SR_OFFSET);
+        if (sr & XAXIDMA_ERR_ALL_MASK) {
+            cap_stats.dma_errors++;
+            an_error = 1;
+            an_running = 0;
+            an_armed = -1;
+            return;
+        }
+        if (!(sr & CAPTURE_SR_IDLE)) {
+            return;
+        }
+        dma_mem_from_device(an_buf[an_armed], CAPTURE_AN_SEG_BYTES);
+        an_filled[an_armed] = 1;
+        cap_stats.an_segments++;
+        an_armed = -1;
+    }
+
+    if (!an_running) {
+        return;
+    }
+    if (an_filled[an_head]) {
+        // Its FIFO keeps filling meanwhile, and drops samples once full
+        if (!an_stalled) {
+            an_stalled = 1;
+            cap_stats.an_overruns++;
+        }
+        return;
+    }
+    an_stalled = 0;
+    capture_an_arm();
+}
+#endif
+
+#if CAPTURE_IRQ
+static void capture_isr(void* ref) {
+    (void)ref;
+    u32 irq = XAxiDma_IntrGetIrq(cap_dma, XAXIDMA_DEVICE_TO_DMA);
+    XAxiDma_IntrAckIrq(cap_dma, irq, XAXIDMA_DEVICE_TO_DMA);
+    capture_service();
+}
+#endif
+
+// Stream format and packet length for the audio_pipeline control register
+static uint32_t capture_ctrl(void) {
+    uint32_t log2 = 0;
+    while ((1u << log2) < CAPTURE_SEG_WORDS) {
+        log2++;
+    }
+    uint32_t ctrl = log2 << CAPTURE_CTRL_TLAST_SHIFT;
+#if CAPTURE_PL_PACK
+    ctrl |= CAPTURE_CTRL_PACK16;
+#if CAPTURE_PL_ROUND
+    ctrl |= CAPTURE_CTRL_ROUND;
+#endif
+#endif
+#if CAPTURE_PL_DECIMATE
+    uint32_t an_log2 = 0;
+    while ((1u << an_log2) < CAPTURE_AN_SEG_WORDS) {
+        an_log2++;
+    }
+    ctrl |= CAPTURE_CTRL_DECIMATE | (an_log2 << CAPTURE_CTRL_DEC_TLAST_SHIFT);
+#endif
+    return ctrl;
+}
+
+int capture_init(XAxiDma* dma) {
+    cap_dma = dma;
+#if CAPTURE_PL_DECIMATE
+    XAxiDma_Config* cfg = XAxiDma_LookupConfig(CAPTURE_AN_DMA_DEV_ID);
+    if (!cfg || XAxiDma_CfgInitialize(&an_dma, cfg) != XST_SUCCESS || XAxiDma_HasSg(&an_dma)) {
+        return -1;
+    }
+    XAxiDma_IntrDisable(&an_dma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DEVICE_TO_DMA);
+#endif
+#if CAPTURE_IRQ
+    if (irq_connect(CAPTURE_IRQ_ID, (Xil_InterruptHandler)capture_isr, NULL) != 0) {
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+int capture_start(void) {
+    capture_stop();
+
+    CAP_LOCK();
+    memset(&cap_stats, 0, sizeof(cap_stats));
+    memset((void*)cap_filled, 0, sizeof(cap_filled));
+    cap_head = 0;
+    cap_tail = 0;
+    cap_burst = 0;
+    cap_received = 0;
+    cap_error = 0;
+    cap_stalled = 0;
+    cap_running = 1;
+
+    // Re-enabled every take: a DMA reset after an error clears them
+#if CAPTURE_IRQ
+    XAxiDma_IntrEnable(cap_dma, XAXIDMA_IRQ_IOC_MASK | XAXIDMA_IRQ_ERROR_MASK, XAXIDMA_DEVICE_TO_DMA);
+#else
+    XAxiDma_IntrDisable(cap_dma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DEVICE_TO_DMA);
+#endif
+    // Drop what the FIFO kept from before the take and restart the packet
+    // count, so the first transfer starts on a segment boundary
+    uint32_t ctrl = capture_ctrl();
+    Xil_Out32((UINTPTR)CAPTURE_PL_BASEADDR + CAPTURE_CTRL_OFFSET, ctrl | CAPTURE_CTRL_FLUSH);
+    Xil_Out32((UINTPTR)CAPTURE_PL_BASEADDR + CAPTURE_CTRL_OFFSET, ctrl);
+    XTime_GetTime(&cap_t0);
+    capture_arm();
+    int err = cap_error;
+    CAP_UNLOCK();
+
+#if CAPTURE_PL_DECIMATE
+    if (an_error) {
+        // A halted channel needs a reset; this DMA carries nothing else
+        XAxiDma_Reset(&an_dma);
+        while (!XAxiDma_ResetIsDone(&an_dma));
+        XAxiDma_IntrDisable(&an_dma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DEVICE_TO_DMA);
+    }
+    memset(an_filled, 0, sizeof(an_filled));
+    an_head = 0;
+    an_tail = 0;
+    an_burst = 0;
+    an_error = 0;
+    an_stalled = 0;
+    an_running = 1;
+    capture_an_arm();
+    err |= an_error;
+#endif
+    return err ? -1 : 0;
+}
+
+int capture_next(const uint32_t** burst) {
+#if CAPTURE_PL_DECIMATE
+    capture_an_service();
+#endif
+    CAP_LOCK();
+#if !CAPTURE_IRQ
+    capture_service();
+#endif
+    int ready = cap_filled[cap_tail];
+    int err = cap_error;
+    CAP_UNLOCK();
+
+    if (!ready) {
+        return err ? -1 : 0;
+    }
+    *burst = cap_buf[cap_tail] + cap_burst * CAPTURE_BURST_WORDS;
+    return 1;
+}
+
+void capture_release(void) {
+    if (++cap_burst < CAPTURE_SEG_BURSTS) {
+        return;
+    }
+    cap_burst = 0;
+
+    CAP_LOCK();
+    cap_filled[cap_tail] = 0;
+    cap_tail = (cap_tail + 1) % CAPTURE_SEGMENTS;
+    // Re-arm straight away if the ring had stalled on this segment
+    capture_service();
+    CAP_UNLOCK();
+}
+
+#if CAPTURE_PL_DECIMATE
+int capture_next_analysis(const int16_t** pcm) {
+    capture_an_service();
+    if (!an_filled[an_tail]) {
+        return an_error ? -1 : 0;
+    }
+    *pcm = (const int16_t*)(an_buf[an_tail] + an_burst * CAPTURE_AN_BURST_WORDS);
+    return 1;
+}
+
+void capture_release_analysis(void) {
+    if (++an_burst < CAPTURE_SEG_BURSTS) {
+        return;
+    }
+    an_burst = 0;
+    an_filled[an_tail] = 0;
+    an_tail = (an_tail + 1) % CAPTURE_SEGMENTS;
+    capture_an_service();
+}
+#endif
+
+void capture_stop(void) {
+    CAP_LOCK();
+    cap_running = 0;
+    CAP_UNLOCK();
+#if CAPTURE_PL_DECIMATE
+    an_running = 0;
+    while (an_armed >= 0) {
+        capture_an_service();
+    }
+#endif
+
+    // Simple mode cannot cancel a transfer; let it finish
+    while (cap_armed >= 0) {
+        CAP_LOCK();
+        capture_service();
+        CAP_UNLOCK();
+    }
+}
+
+void capture_get_stats(CaptureStats* stats) {
+    CAP_LOCK();
+    *stats = cap_stats;
+    CAP_UNLOCK();
+}
@@ -0,0 +1,165 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include "xaxidma.h"
+
+// Gap-free S2MM capture. A ring of CAPTURE_SEGMENTS DMA buffers, each
+// CAPTURE_SEG_BURSTS bursts long, keeps one simple-mode transfer armed while
+// the consumer works through the segments already filled. The next segment
+// is armed as soon as the previous one completes, either from the S2MM
+// interrupt (CAPTURE_IRQ=1, needs s2mm_introut routed to the PS in the block
+// design) or from capture_next() polling.
+//
+// capture_start flushes the audio_pipeline FIFO, which then keeps filling
+// while no transfer is armed; samples are only lost once it is full. The
+// engine models its fill level from the sample clock (samples due since
+// capture_start versus samples received) and reports the estimated loss.
+// The FIFO's own count of the words it discarded is in the PL stream
+// counters (pl_stats).
+//
+// The stream format is set through the audio_pipeline control register.
+// With CAPTURE_PL_PACK=0 every beat is a raw 32-bit mic word for
+// pcm_from_capture. With CAPTURE_PL_PACK=1 the PL mirrors and narrows the
+// samples itself and packs two 16-bit PCM samples per word (first sample in
+// the low half), so a burst is already int16_t PCM in half the bytes.
+// The PL ends a packet (TLAST) on every segment boundary so each
+// simple-mode transfer is exactly one segment.
+//
+// CAPTURE_PL_DECIMATE=1 also takes audio_pipeline's analysis stream: the
+// samples low-passed and decimated 4:1 in the PL (capture_decimator, packed
+// 16-bit PCM at CAPTURE_AN_FS) on their own DMA (CAPTURE_AN_DMA_DEV_ID),
+// which capture_init sets up. Its ring runs alongside the main one and is
+// serviced from the capture calls (polled); each of its bursts covers the
+// same stretch of input as one capture burst, for the pitch tracker.
+
+#ifndef CAPTURE_PL_PACK
+#define CAPTURE_PL_PACK         0
+#endif
+
+// PACK mode only: 1 rounds the 18-bit sample to 16 bits (full range, with
+// saturation), 0 keeps the same 16 bits as pcm_from_capture
+#ifndef CAPTURE_PL_ROUND
+#define CAPTURE_PL_ROUND        0
+#endif
+
+#ifndef CAPTURE_PL_DECIMATE
+#define CAPTURE_PL_DECIMATE     0
+#endif
+
+#ifndef CAPTURE_AN_DMA_DEV_ID
+#define CAPTURE_AN_DMA_DEV_ID   XPAR_AXIDMA_2_DEVICE_ID
+#endif
+
+#ifndef CAPTURE_PL_BASEADDR
+#define CAPTURE_PL_BASEADDR     XPAR_AUDIO_PIPELINE_0_S00_AXI_BASEADDR
+#endif
+
+#define CAPTURE_BURST_SAMPLES   256     // Samples handed to the consumer at a time
+// Bursts per DMA transfer (21.3 ms at 48 kHz). The CPU sees a segment only
+// once it is complete, so this is also the capture share of the live
+// latency; LIVE_RETUNE builds may lower it to 1.
+#ifndef CAPTURE_SEG_BURSTS
+#define CAPTURE_SEG_BURSTS      4
+#endif
+#define CAPTURE_SEGMENTS        8       // Transfers in the ring (holds a full PL FIFO and more)
+#define CAPTURE_SEG_SAMPLES     (CAPTURE_SEG_BURSTS * CAPTURE_BURST_SAMPLES)
+#define CAPTURE_WORD_SAMPLES    (CAPTURE_PL_PACK ? 2 : 1)
+#define CAPTURE_BURST_WORDS     (CAPTURE_BURST_SAMPLES / CAPTURE_WORD_SAMPLES)
+#define CAPTURE_SEG_WORDS       (CAPTURE_SEG_SAMPLES / CAPTURE_WORD_SAMPLES)
+#define CAPTURE_PL_FIFO_WORDS   4096    // audio_pipeline FIFO (2**FIFO_DEPTH words)
+#define CAPTURE_PL_FIFO         (CAPTURE_PL_FIFO_WORDS * CAPTURE_WORD_SAMPLES)  // ... in samples
+
+// Analysis stream (CAPTURE_PL_DECIMATE): always two samples per word
+#define CAPTURE_DECIMATION      4
+#define CAPTURE_AN_FS           (CAPTURE_FS / CAPTURE_DECIMATION)
+#define CAPTURE_AN_BURST_SAMPLES (CAPTURE_BURST_SAMPLES / CAPTURE_DECIMATION)
+#define CAPTURE_AN_BURST_WORDS  (CAPTURE_AN_BURST_SAMPLES / 2)
+#define CAPTURE_AN_SEG_WORDS    (CAPTURE_SEG_BURSTS * CAPTURE_AN_BURST_WORDS)
+
+// audio_pipeline cb_control_reg
+#define CAPTURE_CTRL_OFFSET     0x0
+#define CAPTURE_CTRL_PACK16     0x1u
+#define CAPTURE_CTRL_ROUND      0x2u
+#define CAPTURE_CTRL_FLUSH      0x4u
+#define CAPTURE_CTRL_DECIMATE   0x8u
+#define CAPTURE_CTRL_TLAST_SHIFT 4      // 4-bit log2 of the packet length in beats
+#define CAPTURE_CTRL_DEC_TLAST_SHIFT 8  // ... of the analysis stream
+
+#ifndef CAPTURE_FS
+#define CAPTURE_FS              48000
+#endif
+
+#ifndef CAPTURE_IRQ
+#define CAPTURE_IRQ             0
+#endif
+
+#ifndef CAPTURE_IRQ_ID
+#define CAPTURE_IRQ_ID          XPAR_FABRIC_AXIDMA_0_S2MM_INTROUT_INTR
+#endif
+
+typedef struct {
+    uint32_t segments;          // Transfers completed
+    uint32_t overruns;          // Times a transfer completed with no free segment to arm
+    uint32_t lost_samples;      // Estimated samples dropped by the full PL FIFO
+    uint32_t max_backlog;       // Largest estimated FIFO fill when a transfer was armed
+    uint32_t dma_errors;        // Transfers that ended with an S2MM error (either stream)
+    uint32_t an_segments;       // Analysis transfers completed
+    uint32_t an_overruns;       // Times the analysis ring had no free segment to arm
+} CaptureStats;
+
+/**
+ * Attach the engine to an initialised simple-mode DMA (and, with
+ * CAPTURE_PL_DECIMATE, initialise the analysis stream's DMA)
+ * @param dma        DMA whose S2MM channel carries the capture stream
+ * @return           0 on success, -1 if the interrupt or the analysis DMA could not be set up
+ */
+int capture_init(XAxiDma* dma);
+
+/**
+ * Clear the ring and statistics and arm the first segment
+ * @return           0 on success, -1 if the transfer could not be started
+ */
+int capture_start(void);
+
+/**
+ * Next burst of CAPTURE_BURST_SAMPLES samples in stream order: that many raw
+ * 32-bit words, or CAPTURE_BURST_WORDS words of packed int16_t PCM in PACK mode.
+ * Also re-arms the DMA when polling. Call capture_release() when done with it.
+ * @param burst      Receives the burst (valid until capture_release)
+ * @return           1 with a burst, 0 if none has arrived yet, -1 if capture stopped on an error
+ */
+int capture_next(const uint32_t** burst);
+
+/**
+ * Hand the burst from capture_next() back; its segment is re-used once all its bursts are back
+ */
+void capture_release(void);
+
+#if CAPTURE_PL_DECIMATE
+/**
+ * Next burst of the analysis stream: CAPTURE_AN_BURST_SAMPLES int16_t samples
+ * at CAPTURE_AN_FS, covering the same input as the capture burst of the same
+ * index. Call capture_release_analysis() when done with it.
+ * @param pcm        Receives the burst (valid until capture_release_analysis)
+ * @return           1 with a burst, 0 if none has arrived yet, -1 if the stream stopped on an error
+ */
+int capture_next_analysis(const int16_t** pcm);
+
+/**
+ * Hand the burst from capture_next_analysis() back
+ */
+void capture_release_analysis(void);
+#endif
+
+/**
+ * Stop arming and wait for the transfer in flight (its samples are discarded)
+ */
+void capture_stop(void);
+
+/**
+ * @param stats      Receives the counters since the last capture_start
+ */
+void capture_get_stats(CaptureStats* stats);
+
+#endif // CAPTURE_H
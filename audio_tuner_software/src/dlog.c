@@ -0,0 +1,161 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "dlog.h"
+
+#if defined(__linux__)
+#define dlog_write(line)    fputs(line, stdout)     // Host builds (Testing/)
+#else
+#include "xil_printf.h"
+#define dlog_write(line)    xil_printf("%s", line)
+#endif
+
+#if (DLOG_RECORDS & (DLOG_RECORDS - 1)) != 0
+#error "DLOG_RECORDS must be a power of two"
+#endif
+
+// How an argument was passed, so the drain hands snprintf the same type
+enum {
+    DLOG_INT, DLOG_LONG, DLOG_LLONG, DLOG_SIZE, DLOG_DOUBLE, DLOG_PTR
+};
+
+typedef union {
+    long long i;
+    double f;
+    const void* p;
+} DlogArg;
+
+typedef struct {
+    const char* fmt;
+    uint8_t kind[DLOG_MAX_ARGS];
+    uint8_t args;
+    DlogArg arg[DLOG_MAX_ARGS];
+} __attribute__((aligned(64))) DlogRecord;
+
+static DlogRecord dlog_ring[DLOG_RECORDS];
+static uint32_t dlog_head;          // Records put
+static uint32_t dlog_tail;          // Records printed
+static uint32_t dlog_dropped;       // Dropped since the last drain
+
+// Step over one conversion spec after its '%': flags, width, precision, length.
+// Returns the conversion character and its argument kind (-1: none, as in %%)
+static const char* dlog_spec(const char* s, char* conv, int* kind) {
+    int longs = 0, size = 0;
+    while (*s && (*s == '-' || *s == '+' || *s == ' ' || *s == '#' || *s == '.' || (*s >= '0' && *s <= '9'))) s++;
+    for (;; s++) {
+        if (*s == 'l') longs++;
+        else if (*s == 'z') size = 1;
+        else if (*s != 'h') break;
+    }
+    *conv = *s;
+    switch (*s) {
+    case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+        *kind = size ? DLOG_SIZE : longs >= 2 ? DLOG_LLONG : longs ? DLOG_LONG : DLOG_INT;
+        break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+        *kind = DLOG_DOUBLE;
+        break;
+    case 's': case 'p':
+        *kind = DLOG_PTR;
+        break;
+    default:
+        *kind = -1;
+        break;
+    }
+    return *s ? s + 1 : s;
+}
+
+void dlog_put(const char* fmt, ...) {
+    if (dlog_head - dlog_tail >= DLOG_RECORDS) {
+        dlog_dropped++;
+        return;
+    }
+    DlogRecord* r = &dlog_ring[dlog_head & (DLOG_RECORDS - 1)];
+    r->fmt = fmt;
+    r->args = 0;
+
+    va_list ap;
+    va_start(ap, fmt);
+    for (const char* s = fmt; *s; ) {
+        if (*s++ != '%') continue;
+        char conv;
+        int kind;
+        s = dlog_spec(s, &conv, &kind);
+        if (kind < 0 || r->args == DLOG_MAX_ARGS) continue;
+        DlogArg* a = &r->arg[r->args];
+        switch (kind) {
+        case DLOG_INT:    a->i = va_arg(ap, int); break;
+        case DLOG_LONG:   a->i = va_arg(ap, long); break;
+        case DLOG_LLONG:  a->i = va_arg(ap, long long); break;
+        case DLOG_SIZE:   a->i = (long long)va_arg(ap, size_t); break;
+        case DLOG_DOUBLE: a->f = va_arg(ap, double); break;
+        default:          a->p = va_arg(ap, const void*); break;
+        }
+        r->kind[r->args++] = (uint8_t)kind;
+    }
+    va_end(ap);
+    dlog_head++;
+}
+
+// One record into line: each spec is copied out and formatted on its own
+static void dlog_format(const DlogRecord* r, char* line, size_t size) {
+    size_t len = 0;
+    int arg = 0;
+    for (const char* s = r->fmt; *s && len + 1 < size; ) {
+        if (*s != '%') {
+            line[len++] = *s++;
+            continue;
+        }
+        const char* start = s;
+        char conv;
+        int kind;
+        s = dlog_spec(s + 1, &conv, &kind);
+
+        char spec[16];
+        size_t n = (size_t)(s - start) < sizeof(spec) - 1 ? (size_t)(s - start) : sizeof(spec) - 1;
+        for (size_t i = 0; i < n; i++) spec[i] = start[i];
+        spec[n] = '\0';
+
+        int w;
+        if (kind < 0) {
+            w = snprintf(line + len, size - len, "%s", conv == '%' ? "%" : "");
+        } else if (arg >= r->args) {
+            w = snprintf(line + len, size - len, "?");
+        } else {
+            const DlogArg* a = &r->arg[arg];
+            switch (r->kind[arg++]) {
+            case DLOG_INT:    w = snprintf(line + len, size - len, spec, (int)a->i); break;
+            case DLOG_LONG:   w = snprintf(line + len, size - len, spec, (long)a->i); break;
+            case DLOG_LLONG:  w = snprintf(line + len, size - len, spec, a->i); break;
+            case DLOG_SIZE:   w = snprintf(line + len, size - len, spec, (size_t)a->i); break;
+            case DLOG_DOUBLE: w = snprintf(line + len, size - len, spec, a->f); break;
+            default:          w = snprintf(line + len, size - len, spec, a->p); break;
+            }
+        }
+        if (w < 0) break;
+        len += (size_t)w < size - len ? (size_t)w : size - len - 1;
+    }
+    line[len] = '\0';
+}
+
+int dlog_drain(int max) {
+    char line[160];
+    int printed = 0;
+
+    if (dlog_dropped) {
+        snprintf(line, sizeof(line), "[log: %lu records dropped]\r\n", (unsigned long)dlog_dropped);
+        dlog_write(line);
+        dlog_dropped = 0;
+    }
+    while (dlog_tail != dlog_head && (max == 0 || printed < max)) {
+        dlog_format(&dlog_ring[dlog_tail & (DLOG_RECORDS - 1)], line, sizeof(line));
+        dlog_write(line);
+        dlog_tail++;
+        printed++;
+    }
+    return printed;
+}
+
+uint32_t dlog_pending(void) {
+    return dlog_head - dlog_tail;
+}
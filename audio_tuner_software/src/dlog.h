@@ -0,0 +1,81 @@
+#ifndef DLOG_H
+#define DLOG_H
+
+#include <stdint.h>
+
+// Deferred logging: a record is the format pointer and the raw arguments,
+// stored in a RAM ring and only formatted and sent to the UART by
+// dlog_drain() when the loop is idle (states 0, 1 and 5, between takes).
+// At 115200 baud a line costs about 1 ms of blocking xil_printf; a record
+// costs a walk of its format string and a 64-byte copy, so diagnostics no
+// longer change the timing of a take.
+//
+// Formats are printf formats (%f works; xil_printf cannot print floats) with
+// at most DLOG_MAX_ARGS conversions and no '*' widths. A %s argument is kept
+// as a pointer, so it must still be valid when the ring drains: string
+// literals, static tables and buffers that outlive the take.
+//
+// Levels above DLOG_LEVEL compile to nothing (the arguments are still type
+// checked, never evaluated). When the ring is full new records are dropped
+// and counted; the next drain says how many. Main loop only: not for ISRs or
+// the RTOS tasks (rt_log).
+
+#define DLOG_LEVEL_NONE     0
+#define DLOG_LEVEL_ERROR    1
+#define DLOG_LEVEL_WARN     2
+#define DLOG_LEVEL_INFO     3
+#define DLOG_LEVEL_DEBUG    4
+
+#ifndef DLOG_LEVEL
+#define DLOG_LEVEL          DLOG_LEVEL_INFO
+#endif
+
+#ifndef DLOG_RECORDS
+#define DLOG_RECORDS        256         // Power of two
+#endif
+
+#define DLOG_MAX_ARGS       6
+
+/**
+ * Record a line (use the DLOG_* macros, which drop levels above DLOG_LEVEL)
+ * @param fmt        printf format; the pointer is stored, so it must be a literal
+ */
+void dlog_put(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/**
+ * Format and print records, oldest first
+ * @param max        Most records to print, 0 for all
+ * @return           Records printed
+ */
+int dlog_drain(int max);
+
+/**
+ * @return           Records waiting to be printed
+ */
+uint32_t dlog_pending(void);
+
+#if DLOG_LEVEL >= DLOG_LEVEL_ERROR
+#define DLOG_ERROR(...)     dlog_put(__VA_ARGS__)
+#else
+#define DLOG_ERROR(...)     do { if (0) dlog_put(__VA_ARGS__); } while (0)
+#endif
+
+#if DLOG_LEVEL >= DLOG_LEVEL_WARN
+#define DLOG_WARN(...)      dlog_put(__VA_ARGS__)
+#else
+#define DLOG_WARN(...)      do { if (0) dlog_put(__VA_ARGS__); } while (0)
+#endif
+
+#if DLOG_LEVEL >= DLOG_LEVEL_INFO
+#define DLOG_INFO(...)      dlog_put(__VA_ARGS__)
+#else
+#define DLOG_INFO(...)      do { if (0) dlog_put(__VA_ARGS__); } while (0)
+#endif
+
+#if DLOG_LEVEL >= DLOG_LEVEL_DEBUG
+#define DLOG_DEBUG(...)     dlog_put(__VA_ARGS__)
+#else
+#define DLOG_DEBUG(...)     do { if (0) dlog_put(__VA_ARGS__); } while (0)
+#endif
+
+#endif // DLOG_H
@@ -0,0 +1,40 @@
+#include <string.h>
+#include "dma_mem.h"
+#include "xil_cache.h"
+#include "xil_mmu.h"
+#include "xpseudo_asm.h"
+
+int dma_mem_init(void) {
+#if DMA_MEM_UNCACHED
+    UINTPTR start = (UINTPTR)__dma_buf_start;
+    UINTPTR end = (UINTPTR)__dma_buf_end;
+    if ((start | end) & (DMA_MEM_BLOCK - 1)) {
+        return -1;
+    }
+    // Xil_SetTlbAttributes cleans the cache before remapping, so no line of
+    // the section can be written back over the DMA later
+    for (UINTPTR a = start; a < end; a += DMA_MEM_BLOCK) {
+        Xil_SetTlbAttributes(a, NORM_NONCACHE);
+    }
+    memset(__dma_buf_start, 0, end - start);
+    dsb();
+#endif
+    return 0;
+}
+
+void dma_mem_to_device(const volatile void* p, size_t len) {
+    if (dma_mem_owns(p)) {
+        // Non-cacheable writes may still sit in the write buffer
+        dsb();
+        return;
+    }
+    Xil_DCacheFlushRange((UINTPTR)p, len);
+}
+
+void dma_mem_from_device(const volatile void* p, size_t len) {
+    if (dma_mem_owns(p)) {
+        dsb();
+        return;
+    }
+    Xil_DCacheInvalidateRange((UINTPTR)p, len);
+}
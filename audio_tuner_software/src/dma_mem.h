@@ -0,0 +1,72 @@
+#ifndef DMA_MEM_H
+#define DMA_MEM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "xil_types.h"
+
+// Buffers shared with the AXI DMA. With DMA_MEM_UNCACHED=1 they are placed
+// in the .dma_buf section of lscript.ld, which dma_mem_init maps Normal
+// non-cacheable, so the DMA and the CPU see the same bytes without cache
+// maintenance and a buffer can never share a dirty line with a CPU
+// variable. The CPU touches each stream word once (convert on capture,
+// fill on playback), so losing the cache there costs less than the
+// flush/invalidate by line it replaces.
+//
+// Buffers outside the section (e.g. a take in DDR queued by reference)
+// still get flushed or invalidated; dma_mem_to_device/from_device pick the
+// right thing from the address.
+
+#ifndef DMA_MEM_UNCACHED
+#define DMA_MEM_UNCACHED    1
+#endif
+
+#define DMA_MEM_BLOCK       0x200000u   // Xil_SetTlbAttributes granularity on the A53 (2 MB block)
+
+#if DMA_MEM_UNCACHED
+#define DMA_MEM             __attribute__((section(".dma_buf"), aligned(64)))
+#else
+#define DMA_MEM             __attribute__((aligned(64)))
+#endif
+
+#if DMA_MEM_UNCACHED
+extern uint8_t __dma_buf_start[];
+extern uint8_t __dma_buf_end[];
+#endif
+
+/**
+ * Map the .dma_buf section non-cacheable and zero it (the section is NOLOAD
+ * and outside .bss). Call once after init_platform, before any DMA.
+ * @return           0 on success, -1 if the section is not block aligned
+ */
+int dma_mem_init(void);
+
+/**
+ * Whether a buffer lies in the non-cacheable section
+ * @param p          Start of the buffer
+ * @return           1 if no cache maintenance is needed for it
+ */
+static inline int dma_mem_owns(const volatile void* p) {
+#if DMA_MEM_UNCACHED
+    return (UINTPTR)p >= (UINTPTR)__dma_buf_start && (UINTPTR)p < (UINTPTR)__dma_buf_end;
+#else
+    (void)p;
+    return 0;
+#endif
+}
+
+/**
+ * Make len bytes the CPU wrote visible to a DMA read (MM2S)
+ * @param p          Start of the buffer
+ * @param len        Bytes
+ */
+void dma_mem_to_device(const volatile void* p, size_t len);
+
+/**
+ * Prepare len bytes for a DMA write (S2MM) and for reading its result
+ * @param p          Start of the buffer
+ * @param len        Bytes
+ */
+void dma_mem_from_device(const volatile void* p, size_t len);
+
+#endif // DMA_MEM_H
@@ -0,0 +1,758 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "fft.h"
+#include "arena.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static void fft_plan_dispatch(FFTPlan* plan);
+
+// Fill the tables of a plan whose bitrev/twiddle already point at storage
+static void fft_plan_fill(FFTPlan* plan, int size) {
+    int log2_size = 0;
+    while ((1 << log2_size) < size) log2_size++;
+
+    for (int i = 0; i < size; i++) {
+        int r = 0;
+        for (int b = 0; b < log2_size; b++) {
+            r |= ((i >> b) & 1) << (log2_size - 1 - b);
+        }
+        plan->bitrev[i] = (uint16_t)r;
+    }
+
+    // Computed in double once so the table carries no accumulated error
+    for (int k = 0; k < size / 2; k++) {
+        double angle = -2.0 * M_PI * k / size;
+        plan->twiddle[k].real = (float)cos(angle);
+        plan->twiddle[k].imag = (float)sin(angle);
+    }
+
+    // The split stages read their twiddles contiguously: stage of half h uses
+    // exp(-2*pi*i*k/(2h)), k = 0 .. h-1 (twiddle[k * size / (2h)])
+    for (int h = 4; h < size; h <<= 1) {
+        float* c = plan->stage_twiddle + 2 * (h - 4);
+        for (int k = 0; k < h; k++) {
+            c[k] = plan->twiddle[k * (size / (2 * h))].real;
+            c[h + k] = plan->twiddle[k * (size / (2 * h))].imag;
+        }
+    }
+
+    plan->size = size;
+    plan->log2_size = log2_size;
+    fft_plan_dispatch(plan);
+}
+
+// Build bit-reversal and twiddle tables for an N-point transform
+int fft_plan_init(FFTPlan* plan, int size) {
+    plan->size = 0;
+    plan->log2_size = 0;
+    plan->bitrev = NULL;
+    plan->twiddle = NULL;
+    plan->stage_twiddle = NULL;
+
+    if (size < 4 || size > FFT_MAX_SIZE || (size & (size - 1)) != 0) {
+        return -1;
+    }
+
+    plan->bitrev = (uint16_t*)arena_malloc(size * sizeof(uint16_t));
+    plan->twiddle = (Complex*)arena_malloc(size / 2 * sizeof(Complex));
+    plan->stage_twiddle = (float*)arena_malloc(2 * size * sizeof(float));
+    if (!plan->bitrev || !plan->twiddle || !plan->stage_twiddle) {
+        fft_plan_free(plan);
+        return -1;
+    }
+
+    fft_plan_fill(plan, size);
+    return 0;
+}
+
+void fft_plan_free(FFTPlan* plan) {
+    arena_free(plan->bitrev);
+    arena_free(plan->twiddle);
+    arena_free(plan->stage_twiddle);
+    plan->bitrev = NULL;
+    plan->twiddle = NULL;
+    plan->stage_twiddle = NULL;
+    plan->size = 0;
+    plan->log2_size = 0;
+    plan->forward = NULL;
+    plan->inverse = NULL;
+    plan->split_forward = NULL;
+    plan->split_inverse = NULL;
+}
+
+// Iterative decimation-in-time transform shared by forward and inverse.
+// sign = +1 uses the forward twiddles, sign = -1 their conjugates. The stages
+// are split out so the sized kernels below can unroll the stage loop.
+static inline __attribute__((always_inline))
+void fft_reorder(const uint16_t* bitrev, Complex* x, const int N) {
+    // Bit-reversal permutation (each pair swapped once)
+    for (int i = 0; i < N; i++) {
+        int j = bitrev[i];
+        if (i < j) {
+            Complex tmp = x[i];
+            x[i] = x[j];
+            x[j] = tmp;
+        }
+    }
+}
+
+static inline __attribute__((always_inline))
+void fft_radix4(Complex* x, const int N, const float sign) {
+    // First two stages fused into radix-4 butterflies (twiddles are 1 and -/+j)
+    for (int i = 0; i < N; i += 4) {
+        float s0r = x[i].real + x[i + 1].real, s0i = x[i].imag + x[i + 1].imag;
+        float s1r = x[i].real - x[i + 1].real, s1i = x[i].imag - x[i + 1].imag;
+        float s2r = x[i + 2].real + x[i + 3].real, s2i = x[i + 2].imag + x[i + 3].imag;
+        float s3r = x[i + 2].real - x[i + 3].real, s3i = x[i + 2].imag - x[i + 3].imag;
+
+        // s3 rotated by -j (forward) or +j (inverse)
+        float tr = sign * s3i;
+        float ti = -sign * s3r;
+
+        x[i].real     = s0r + s2r;  x[i].imag     = s0i + s2i;
+        x[i + 2].real = s0r - s2r;  x[i + 2].imag = s0i - s2i;
+        x[i + 1].real = s1r + tr;   x[i + 1].imag = s1i + ti;
+        x[i + 3].real = s1r - tr;   x[i + 3].imag = s1i - ti;
+    }
+}
+
+// One radix-2 stage of length len with table twiddles
+static inline __attribute__((always_inline))
+void fft_stage(const Complex* twiddle, Complex* x, const int N, const int len, const float sign) {
+    const int half = len >> 1;
+    const int stride = N / len;
+
+    for (int start = 0; start < N; start += len) {
+        Complex* lo = x + start;
+        Complex* hi = x + start + half;
+
+        for (int k = 0; k < half; k++) {
+            float wr = twiddle[k * stride].real;
+            float wi = sign * twiddle[k * stride].imag;
+
+            float tr = hi[k].real * wr - hi[k].imag * wi;
+            float ti = hi[k].real * wi + hi[k].imag * wr;
+
+            hi[k].real = lo[k].real - tr;
+            hi[k].imag = lo[k].imag - ti;
+            lo[k].real += tr;
+            lo[k].imag += ti;
+        }
+    }
+}
+
+static inline __attribute__((always_inline))
+void fft_scale(Complex* x, const int N) {
+    const float scale = 1.0f / N;
+    for (int i = 0; i < N; i++) {
+        x[i].real *= scale;
+        x[i].imag *= scale;
+    }
+}
+
+// Any size: N, the stage lengths and the sign are only known at run time
+static void fft_core(const FFTPlan* plan, Complex* x, float sign) {
+    const int N = plan->size;
+    fft_reorder(plan->bitrev, x, N);
+    fft_radix4(x, N, sign);
+    for (int len = 8; len <= N; len <<= 1) {
+        fft_stage(plan->twiddle, x, N, len, sign);
+    }
+}
+
+static void fft_forward_any(const FFTPlan* plan, Complex* x) {
+    fft_core(plan, x, 1.0f);
+}
+
+static void fft_inverse_any(const FFTPlan* plan, Complex* x) {
+    fft_core(plan, x, -1.0f);
+    fft_scale(x, plan->size);
+}
+
+// Split (structure of arrays) form of the same transform: re[] and im[]
+// planes, already in bit-reversed order. Forward and inverse are separate
+// so the sign is a constant in every loop.
+static inline __attribute__((always_inline))
+void fft_split_radix4(float* re, float* im, const int N, const float sign) {
+    int i = 0;
+#if defined(__ARM_NEON)
+    // Four groups at a time: val[j] holds element j of each group
+    for (; i + 16 <= N; i += 16) {
+        float32x4x4_t r = vld4q_f32(re + i);
+        float32x4x4_t m = vld4q_f32(im + i);
+        float32x4_t s0r = vaddq_f32(r.val[0], r.val[1]), s0i = vaddq_f32(m.val[0], m.val[1]);
+        float32x4_t s1r = vsubq_f32(r.val[0], r.val[1]), s1i = vsubq_f32(m.val[0], m.val[1]);
+        float32x4_t s2r = vaddq_f32(r.val[2], r.val[3]), s2i = vaddq_f32(m.val[2], m.val[3]);
+        float32x4_t s3r = vsubq_f32(r.val[2], r.val[3]), s3i = vsubq_f32(m.val[2], m.val[3]);
+        // s3 rotated by -j (forward) or +j (inverse)
+        float32x4_t tr = sign > 0.0f ? s3i : vnegq_f32(s3i);
+        float32x4_t ti = sign > 0.0f ? vnegq_f32(s3r) : s3r;
+        r.val[0] = vaddq_f32(s0r, s2r);  m.val[0] = vaddq_f32(s0i, s2i);
+        r.val[2] = vsubq_f32(s0r, s2r);  m.val[2] = vsubq_f32(s0i, s2i);
+        r.val[1] = vaddq_f32(s1r, tr);   m.val[1] = vaddq_f32(s1i, ti);
+        r.val[3] = vsubq_f32(s1r, tr);   m.val[3] = vsubq_f32(s1i, ti);
+        vst4q_f32(re + i, r);
+        vst4q_f32(im + i, m);
+    }
+#endif
+    for (; i < N; i += 4) {
+        float s0r = re[i] + re[i + 1], s0i = im[i] + im[i + 1];
+        float s1r = re[i] - re[i + 1], s1i = im[i] - im[i + 1];
+        float s2r = re[i + 2] + re[i + 3], s2i = im[i + 2] + im[i + 3];
+        float s3r = re[i + 2] - re[i + 3], s3i = im[i + 2] - im[i + 3];
+        float tr = sign * s3i;
+        float ti = -sign * s3r;
+        re[i] = s0r + s2r;      im[i] = s0i + s2i;
+        re[i + 2] = s0r - s2r;  im[i + 2] = s0i - s2i;
+        re[i + 1] = s1r + tr;   im[i + 1] = s1i + ti;
+        re[i + 3] = s1r - tr;   im[i + 3] = s1i - ti;
+    }
+}
+
+// One radix-2 stage of length len (half >= 4) with the stage's own twiddles
+static inline __attribute__((always_inline))
+void fft_split_stage(const float* stage_twiddle, float* re, float* im, const int N, const int len,
+                     const float sign) {
+    const int half = len >> 1;
+    const float* wc = stage_twiddle + 2 * (half - 4);
+    const float* ws = wc + half;
+
+    for (int start = 0; start < N; start += len) {
+        // Four disjoint runs (lower/upper half of the block in each plane)
+        float* restrict lr = re + start;
+        float* restrict li = im + start;
+        float* restrict hr = lr + half;
+        float* restrict hi = li + half;
+        int k = 0;
+#if defined(__ARM_NEON)
+        for (; k + 4 <= half; k += 4) {
+            float32x4_t c = vld1q_f32(wc + k);
+            float32x4_t s = vld1q_f32(ws + k);
+            float32x4_t xr = vld1q_f32(hr + k), xi = vld1q_f32(hi + k);
+            // t = x * w (forward) or x * conj(w) (inverse)
+            float32x4_t tr, ti;
+            if (sign > 0.0f) {
+                tr = vfmsq_f32(vmulq_f32(xr, c), xi, s);
+                ti = vfmaq_f32(vmulq_f32(xr, s), xi, c);
+            } else {
+                tr = vfmaq_f32(vmulq_f32(xr, c), xi, s);
+                ti = vfmsq_f32(vmulq_f32(xi, c), xr, s);
+            }
+            float32x4_t ar = vld1q_f32(lr + k), ai = vld1q_f32(li + k);
+            vst1q_f32(hr + k, vsubq_f32(ar, tr));
+            vst1q_f32(hi + k, vsubq_f32(ai, ti));
+            vst1q_f32(lr + k, vaddq_f32(ar, tr));
+            vst1q_f32(li + k, vaddq_f32(ai, ti));
+        }
+#endif
+        for (; k < half; k++) {
+            float c = wc[k], s = sign * ws[k];
+            float tr = hr[k] * c - hi[k] * s;
+            float ti = hr[k] * s + hi[k] * c;
+            hr[k] = lr[k] - tr;
+            hi[k] = li[k] - ti;
+            lr[k] += tr;
+            li[k] += ti;
+        }
+    }
+}
+
+static void fft_split_forward_any(const FFTPlan* plan, float* re, float* im) {
+    const int N = plan->size;
+    fft_split_radix4(re, im, N, 1.0f);
+    for (int len = 8; len <= N; len <<= 1) {
+        fft_split_stage(plan->stage_twiddle, re, im, N, len, 1.0f);
+    }
+}
+
+static void fft_split_inverse_any(const FFTPlan* plan, float* re, float* im) {
+    const int N = plan->size;
+    fft_split_radix4(re, im, N, -1.0f);
+    for (int len = 8; len <= N; len <<= 1) {
+        fft_split_stage(plan->stage_twiddle, re, im, N, len, -1.0f);
+    }
+}
+
+#if FFT_SIZED_KERNELS
+// Sized kernels: the same transform with N and the sign as constants and the
+// stage loop unrolled, so every stage has a fixed length, stride and trip
+// count and the compiler unrolls and vectorises it as it would a hard-coded
+// size. The plan picks one at init from fft_kernels[]; sizes not listed use
+// the run-time kernel.
+#define FFT_SIZED_KERNEL(n)                                                     \
+    static void fft_forward_##n(const FFTPlan* plan, Complex* x) {              \
+        fft_reorder(plan->bitrev, x, n);                                        \
+        fft_radix4(x, n, 1.0f);                                                 \
+        _Pragma("GCC unroll 16")                                                \
+        for (int len = 8; len <= n; len <<= 1) {                                \
+            fft_stage(plan->twiddle, x, n, len, 1.0f);                          \
+        }                                                                       \
+    }                                                                           \
+    static void fft_inverse_##n(const FFTPlan* plan, Complex* x) {              \
+        fft_reorder(plan->bitrev, x, n);                                        \
+        fft_radix4(x, n, -1.0f);                                                \
+        _Pragma("GCC unroll 16")                                                \
+        for (int len = 8; len <= n; len <<= 1) {                                \
+            fft_stage(plan->twiddle, x, n, len, -1.0f);                         \
+        }                                                                       \
+        fft_scale(x, n);                                                        \
+    }                                                                           \
+    static void fft_split_forward_##n(const FFTPlan* plan, float* re, float* im) { \
+        fft_split_radix4(re, im, n, 1.0f);                                      \
+        _Pragma("GCC unroll 16")                                                \
+        for (int len = 8; len <= n; len <<= 1) {                                \
+            fft_split_stage(plan->stage_twiddle, re, im, n, len, 1.0f);         \
+        }                                                                       \
+    }                                                                           \
+    static void fft_split_inverse_##n(const FFTPlan* plan, float* re, float* im) { \
+        fft_split_radix4(re, im, n, -1.0f);                                     \
+        _Pragma("GCC unroll 16")                                                \
+        for (int len = 8; len <= n; len <<= 1) {                                \
+            fft_split_stage(plan->stage_twiddle, re, im, n, len, -1.0f);        \
+        }                                                                       \
+    }
+
+// Complex lengths behind the real frames in use: the vocoder's 512 (live),
+// 2048 (default) and 4096 (offline) and Yin's 256 .. 4096
+FFT_SIZED_KERNEL(128)
+FFT_SIZED_KERNEL(256)
+FFT_SIZED_KERNEL(512)
+FFT_SIZED_KERNEL(1024)
+FFT_SIZED_KERNEL(2048)
+
+typedef struct {
+    int size;
+    void (*forward)(const FFTPlan* plan, Complex* x);
+    void (*inverse)(const FFTPlan* plan, Complex* x);
+    void (*split_forward)(const FFTPlan* plan, float* re, float* im);
+    void (*split_inverse)(const FFTPlan* plan, float* re, float* im);
+} FFTKernel;
+
+#define FFT_KERNEL_ROW(n) \
+    { n, fft_forward_##n, fft_inverse_##n, fft_split_forward_##n, fft_split_inverse_##n }
+
+static const FFTKernel fft_kernels[] = {
+    FFT_KERNEL_ROW(128),
+    FFT_KERNEL_ROW(256),
+    FFT_KERNEL_ROW(512),
+    FFT_KERNEL_ROW(1024),
+    FFT_KERNEL_ROW(2048),
+};
+#endif
+
+// Point a plan at the kernel for its size
+static void fft_plan_dispatch(FFTPlan* plan) {
+    plan->forward = fft_forward_any;
+    plan->inverse = fft_inverse_any;
+    plan->split_forward = fft_split_forward_any;
+    plan->split_inverse = fft_split_inverse_any;
+#if FFT_SIZED_KERNELS
+    for (size_t i = 0; i < sizeof(fft_kernels) / sizeof(fft_kernels[0]); i++) {
+        if (fft_kernels[i].size == plan->size) {
+            plan->forward = fft_kernels[i].forward;
+            plan->inverse = fft_kernels[i].inverse;
+            plan->split_forward = fft_kernels[i].split_forward;
+            plan->split_inverse = fft_kernels[i].split_inverse;
+            break;
+        }
+    }
+#endif
+}
+
+void fft_forward(const FFTPlan* plan, Complex* x) {
+    plan->forward(plan, x);
+}
+
+void fft_inverse(const FFTPlan* plan, Complex* x) {
+    plan->inverse(plan, x);
+}
+
+// Real-transform twiddles exp(-2*pi*i*k/N) for k = 0 .. N/4, packed and split
+static void rfft_plan_fill(RealFFTPlan* plan, int size) {
+    for (int k = 0; k <= size / 4; k++) {
+        double angle = -2.0 * M_PI * k / size;
+        plan->twiddle[k].real = (float)cos(angle);
+        plan->twiddle[k].imag = (float)sin(angle);
+        plan->twiddle_re[k] = plan->twiddle[k].real;
+        plan->twiddle_im[k] = plan->twiddle[k].imag;
+    }
+    plan->size = size;
+}
+
+int rfft_plan_init(RealFFTPlan* plan, int size) {
+    plan->size = 0;
+    plan->twiddle = NULL;
+    plan->twiddle_re = NULL;
+    plan->twiddle_im = NULL;
+
+    if (size < 8 || size > FFT_MAX_SIZE || (size & (size - 1)) != 0) {
+        plan->half.size = 0;
+        plan->half.bitrev = NULL;
+        plan->half.twiddle = NULL;
+        plan->half.stage_twiddle = NULL;
+        return -1;
+    }
+
+    if (fft_plan_init(&plan->half, size / 2) != 0) {
+        return -1;
+    }
+
+    plan->twiddle = (Complex*)arena_malloc((size / 4 + 1) * sizeof(Complex));
+    plan->twiddle_re = (float*)arena_malloc(2 * (size / 4 + 1) * sizeof(float));
+    if (plan->twiddle_re) plan->twiddle_im = plan->twiddle_re + size / 4 + 1;
+    if (!plan->twiddle || !plan->twiddle_re) {
+        rfft_plan_free(plan);
+        return -1;
+    }
+
+    rfft_plan_fill(plan, size);
+    return 0;
+}
+
+// Tables in caller memory: half-plan twiddles, real twiddles, the split stage
+// and real twiddles, then the bit-reversal table
+size_t rfft_plan_bytes(int size) {
+    return (size / 4 + size / 4 + 1) * sizeof(Complex) +
+           (size + 2 * (size / 4 + 1)) * sizeof(float) + (size / 2) * sizeof(uint16_t);
+}
+
+int rfft_plan_init_in(RealFFTPlan* plan, int size, void* mem) {
+    plan->size = 0;
+    plan->twiddle = NULL;
+    plan->half.size = 0;
+    plan->half.bitrev = NULL;
+    plan->half.twiddle = NULL;
+    plan->half.stage_twiddle = NULL;
+    plan->twiddle_re = NULL;
+    plan->twiddle_im = NULL;
+
+    if (size < 8 || size > FFT_MAX_SIZE || (size & (size - 1)) != 0 || !mem) {
+        return -1;
+    }
+
+    Complex* tables = (Complex*)mem;
+    plan->half.twiddle = tables;
+    plan->twiddle = tables + size / 4;
+    float* split = (float*)(tables + size / 4 + size / 4 + 1);
+    plan->half.stage_twiddle = split;
+    plan->twiddle_re = split + size;
+    plan->twiddle_im = plan->twiddle_re + size / 4 + 1;
+    plan->half.bitrev = (uint16_t*)(plan->twiddle_im + size / 4 + 1);
+
+    fft_plan_fill(&plan->half, size / 2);
+    rfft_plan_fill(plan, size);
+    return 0;
+}
+
+void rfft_plan_free(RealFFTPlan* plan) {
+    fft_plan_free(&plan->half);
+    arena_free(plan->twiddle);
+    arena_free(plan->twiddle_re);
+    plan->twiddle = NULL;
+    plan->twiddle_re = NULL;
+    plan->twiddle_im = NULL;
+    plan->size = 0;
+}
+
+// Even samples go in the real part, odd samples in the imag part:
+// z[n] = x[2n] + i*x[2n+1]. After Z = FFT(z) the two half-length spectra are
+//   E[k] = (Z[k] + conj(Z[M-k])) / 2
+//   O[k] = (Z[k] - conj(Z[M-k])) / 2i
+// and X[k] = E[k] + W^k * O[k], X[M-k] = conj(E[k] - W^k * O[k]).
+void rfft_forward(const RealFFTPlan* plan, const float* in, Complex* out) {
+    // Complex is two packed floats, so the real signal can be reinterpreted directly
+    memcpy(out, in, plan->size * sizeof(float));
+    fft_forward(&plan->half, out);
+    rfft_forward_post(plan, out);
+}
+
+void rfft_forward_post(const RealFFTPlan* plan, Complex* out) {
+    const int M = plan->size / 2;
+    const Complex* w = plan->twiddle;
+
+    float z0r = out[0].real;
+    float z0i = out[0].imag;
+    out[0].real = z0r + z0i;
+    out[0].imag = 0.0f;
+    out[M].real = z0r - z0i;
+    out[M].imag = 0.0f;
+
+    for (int k = 1; k <= M / 2; k++) {
+        Complex a = out[k];
+        Complex b = out[M - k];
+
+        float er = 0.5f * (a.real + b.real);
+        float ei = 0.5f * (a.imag - b.imag);
+        float or_ = 0.5f * (a.imag + b.imag);
+        float oi = -0.5f * (a.real - b.real);
+
+        float tr = w[k].real * or_ - w[k].imag * oi;
+        float ti = w[k].real * oi + w[k].imag * or_;
+
+        out[k].real = er + tr;
+        out[k].imag = ei + ti;
+        out[M - k].real = er - tr;
+        out[M - k].imag = -(ei - ti);
+    }
+}
+
+// Inverse of the split above: rebuild Z[k] = E[k] + i*O[k] from the half
+// spectrum, run the M-point inverse and unpack real/imag into even/odd samples.
+void rfft_inverse(const RealFFTPlan* plan, Complex* spec, float* out) {
+    rfft_inverse_pre(plan, spec);
+    fft_inverse(&plan->half, spec);
+    memcpy(out, spec, plan->size * sizeof(float));
+}
+
+void rfft_inverse_pre(const RealFFTPlan* plan, Complex* spec) {
+    const int M = plan->size / 2;
+    const Complex* w = plan->twiddle;
+
+    float x0 = spec[0].real;
+    float xm = spec[M].real;
+    spec[0].real = 0.5f * (x0 + xm);
+    spec[0].imag = 0.5f * (x0 - xm);
+
+    for (int k = 1; k <= M / 2; k++) {
+        Complex a = spec[k];
+        Complex b = spec[M - k];
+
+        float er = 0.5f * (a.real + b.real);
+        float ei = 0.5f * (a.imag - b.imag);
+
+        // O[k] = (X[k] - conj(X[M-k])) * conj(W^k) / 2
+        float dr = 0.5f * (a.real - b.real);
+        float di = 0.5f * (a.imag + b.imag);
+        float or_ = dr * w[k].real + di * w[k].imag;
+        float oi = di * w[k].real - dr * w[k].imag;
+
+        // Z[k] = E[k] + i*O[k], Z[M-k] = conj(E[k]) + i*conj(O[k])
+        spec[k].real = er - oi;
+        spec[k].imag = ei + or_;
+        spec[M - k].real = er + oi;
+        spec[M - k].imag = -ei + or_;
+    }
+}
+
+/*** Split spectra ***/
+
+size_t spectral_frame_bytes(int bins) {
+    return 4 * (size_t)SPECTRAL_PLANE(bins) * sizeof(float) + SPECTRAL_ALIGN - 1;
+}
+
+int spectral_frame_init(SpectralFrame* f, int bins, void* mem) {
+    if (!mem) {
+        return -1;
+    }
+    // The heap fallback of arena_malloc only aligns to 16
+    uintptr_t base = ((uintptr_t)mem + SPECTRAL_ALIGN - 1) & ~(uintptr_t)(SPECTRAL_ALIGN - 1);
+    f->bins = bins;
+    f->stride = SPECTRAL_PLANE(bins);
+    f->re = (float*)base;
+    f->im = f->re + f->stride;
+    f->mag = f->im + f->stride;
+    f->ph = f->mag + f->stride;
+    return 0;
+}
+
+#if defined(__ARM_NEON)
+// Lanes in reverse order, for the k / M-k pairs of the real split
+static inline float32x4_t fft_reverse(float32x4_t v) {
+    v = vrev64q_f32(v);
+    return vextq_f32(v, v, 2);
+}
+#endif
+
+// rfft_forward_post on split planes (re/im hold Z[0 .. M-1], room for M + 1)
+static void rfft_split_post(const RealFFTPlan* plan, float* re, float* im) {
+    const int M = plan->size / 2;
+    const float* wr = plan->twiddle_re;
+    const float* wi = plan->twiddle_im;
+
+    float z0r = re[0], z0i = im[0];
+    re[0] = z0r + z0i;
+    im[0] = 0.0f;
+    re[M] = z0r - z0i;
+    im[M] = 0.0f;
+
+    int k = 1;
+#if defined(__ARM_NEON)
+    // Bins k .. k+3 against M-k-3 .. M-k, while the two blocks do not meet
+    for (; 2 * k + 6 < M; k += 4) {
+        const int b = M - k - 3;
+        float32x4_t ar = vld1q_f32(re + k), ai = vld1q_f32(im + k);
+        float32x4_t br = fft_reverse(vld1q_f32(re + b)), bi = fft_reverse(vld1q_f32(im + b));
+        float32x4_t c = vld1q_f32(wr + k), s = vld1q_f32(wi + k);
+
+        float32x4_t er = vmulq_n_f32(vaddq_f32(ar, br), 0.5f);
+        float32x4_t ei = vmulq_n_f32(vsubq_f32(ai, bi), 0.5f);
+        float32x4_t or_ = vmulq_n_f32(vaddq_f32(ai, bi), 0.5f);
+        float32x4_t oi = vmulq_n_f32(vsubq_f32(br, ar), 0.5f);
+        float32x4_t tr = vfmsq_f32(vmulq_f32(c, or_), s, oi);
+        float32x4_t ti = vfmaq_f32(vmulq_f32(c, oi), s, or_);
+
+        vst1q_f32(re + k, vaddq_f32(er, tr));
+        vst1q_f32(im + k, vaddq_f32(ei, ti));
+        vst1q_f32(re + b, fft_reverse(vsubq_f32(er, tr)));
+        vst1q_f32(im + b, fft_reverse(vsubq_f32(ti, ei)));
+    }
+#endif
+    for (; k <= M / 2; k++) {
+        float ar = re[k], ai = im[k];
+        float br = re[M - k], bi = im[M - k];
+
+        float er = 0.5f * (ar + br);
+        float ei = 0.5f * (ai - bi);
+        float or_ = 0.5f * (ai + bi);
+        float oi = -0.5f * (ar - br);
+
+        float tr = wr[k] * or_ - wi[k] * oi;
+        float ti = wr[k] * oi + wi[k] * or_;
+
+        re[k] = er + tr;
+        im[k] = ei + ti;
+        re[M - k] = er - tr;
+        im[M - k] = -(ei - ti);
+    }
+}
+
+// rfft_inverse_pre on split planes (bins DC .. Nyquist in, Z[0 .. M-1] out)
+static void rfft_split_pre(const RealFFTPlan* plan, float* re, float* im) {
+    const int M = plan->size / 2;
+    const float* wr = plan->twiddle_re;
+    const float* wi = plan->twiddle_im;
+
+    float x0 = re[0], xm = re[M];
+    re[0] = 0.5f * (x0 + xm);
+    im[0] = 0.5f * (x0 - xm);
+
+    int k = 1;
+#if defined(__ARM_NEON)
+    for (; 2 * k + 6 < M; k += 4) {
+        const int b = M - k - 3;
+        float32x4_t ar = vld1q_f32(re + k), ai = vld1q_f32(im + k);
+        float32x4_t br = fft_reverse(vld1q_f32(re + b)), bi = fft_reverse(vld1q_f32(im + b));
+        float32x4_t c = vld1q_f32(wr + k), s = vld1q_f32(wi + k);
+
+        float32x4_t er = vmulq_n_f32(vaddq_f32(ar, br), 0.5f);
+        float32x4_t ei = vmulq_n_f32(vsubq_f32(ai, bi), 0.5f);
+        float32x4_t dr = vmulq_n_f32(vsubq_f32(ar, br), 0.5f);
+        float32x4_t di = vmulq_n_f32(vaddq_f32(ai, bi), 0.5f);
+        float32x4_t or_ = vfmaq_f32(vmulq_f32(dr, c), di, s);
+        float32x4_t oi = vfmsq_f32(vmulq_f32(di, c), dr, s);
+
+        vst1q_f32(re + k, vsubq_f32(er, oi));
+        vst1q_f32(im + k, vaddq_f32(ei, or_));
+        vst1q_f32(re + b, fft_reverse(vaddq_f32(er, oi)));
+        vst1q_f32(im + b, fft_reverse(vsubq_f32(or_, ei)));
+    }
+#endif
+    for (; k <= M / 2; k++) {
+        float ar = re[k], ai = im[k];
+        float br = re[M - k], bi = im[M - k];
+
+        float er = 0.5f * (ar + br);
+        float ei = 0.5f * (ai - bi);
+        float dr = 0.5f * (ar - br);
+        float di = 0.5f * (ai + bi);
+        float or_ = dr * wr[k] + di * wi[k];
+        float oi = di * wr[k] - dr * wi[k];
+
+        re[k] = er - oi;
+        im[k] = ei + or_;
+        re[M - k] = er + oi;
+        im[M - k] = -ei + or_;
+    }
+}
+
+void rfft_forward_split(const RealFFTPlan* plan, const float* in, SpectralFrame* f) {
+    const int M = plan->size / 2;
+    const uint16_t* bitrev = plan->half.bitrev;
+    float* re = f->re;
+    float* im = f->im;
+
+    // z[n] = x[2n] + i*x[2n+1], placed at bitrev[n]: the permutation is the copy
+    for (int i = 0; i < M; i++) {
+        int j = bitrev[i];
+        re[i] = in[2 * j];
+        im[i] = in[2 * j + 1];
+    }
+    plan->half.split_forward(&plan->half, re, im);
+    rfft_split_post(plan, re, im);
+}
+
+void rfft_inverse_split(const RealFFTPlan* plan, SpectralFrame* f, float* out) {
+    const int M = plan->size / 2;
+    const uint16_t* bitrev = plan->half.bitrev;
+    float* re = f->re;
+    float* im = f->im;
+
+    rfft_split_pre(plan, re, im);
+    for (int i = 0; i < M; i++) {
+        int j = bitrev[i];
+        if (i < j) {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+    plan->half.split_inverse(&plan->half, re, im);
+
+    // Unpack real/imag into even/odd samples, scaled by 1/M
+    const float scale = 1.0f / M;
+    int i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 4 <= M; i += 4) {
+        float32x4x2_t v;
+        v.val[0] = vmulq_n_f32(vld1q_f32(re + i), scale);
+        v.val[1] = vmulq_n_f32(vld1q_f32(im + i), scale);
+        vst2q_f32(out + 2 * i, v);
+    }
+#endif
+    for (; i < M; i++) {
+        out[2 * i] = re[i] * scale;
+        out[2 * i + 1] = im[i] * scale;
+    }
+}
+
+void rfft_forward_post_split(const RealFFTPlan* plan, const Complex* z, SpectralFrame* f) {
+    const int M = plan->size / 2;
+    int i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 4 <= M; i += 4) {
+        float32x4x2_t v = vld2q_f32((const float*)(z + i));
+        vst1q_f32(f->re + i, v.val[0]);
+        vst1q_f32(f->im + i, v.val[1]);
+    }
+#endif
+    for (; i < M; i++) {
+        f->re[i] = z[i].real;
+        f->im[i] = z[i].imag;
+    }
+    rfft_split_post(plan, f->re, f->im);
+}
+
+void rfft_inverse_pre_split(const RealFFTPlan* plan, SpectralFrame* f, Complex* z) {
+    const int M = plan->size / 2;
+    rfft_split_pre(plan, f->re, f->im);
+    int i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 4 <= M; i += 4) {
+        float32x4x2_t v;
+        v.val[0] = vld1q_f32(f->re + i);
+        v.val[1] = vld1q_f32(f->im + i);
+        vst2q_f32((float*)(z + i), v);
+    }
+#endif
+    for (; i < M; i++) {
+        z[i].real = f->re[i];
+        z[i].imag = f->im[i];
+    }
+}
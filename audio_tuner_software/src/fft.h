@@ -0,0 +1,206 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Largest transform supported by the 16-bit bit-reversal table
+#define FFT_MAX_SIZE 65536
+
+// 1 = plans of the common sizes (128 .. 2048 complex points, i.e. real frames
+// of 256 .. 4096) run a kernel compiled for that size; 0 = one run-time kernel
+#ifndef FFT_SIZED_KERNELS
+#define FFT_SIZED_KERNELS 1
+#endif
+
+// Complex number structure
+typedef struct {
+    float real;
+    float imag;
+} Complex;
+
+// Precomputed tables for one transform size (built once, reused for every frame)
+typedef struct FFTPlan {
+    int size;               // Transform length N (power of two)
+    int log2_size;          // log2(N)
+    uint16_t* bitrev;       // Bit-reversal permutation, N entries
+    Complex* twiddle;       // exp(-2*pi*i*k/N) for k = 0 .. N/2-1
+    float* stage_twiddle;   // Split twiddles per radix-2 stage: for half h, cos at 2(h-4), sin at 2(h-4)+h
+    void (*forward)(const struct FFTPlan* plan, Complex* x);   // Kernels for this size, set at init
+    void (*inverse)(const struct FFTPlan* plan, Complex* x);
+    void (*split_forward)(const struct FFTPlan* plan, float* re, float* im);  // Stages only, on bit-reversed input
+    void (*split_inverse)(const struct FFTPlan* plan, float* re, float* im);
+} FFTPlan;
+
+// Real-input transform of length N computed as an N/2-point complex FFT
+typedef struct {
+    int size;               // Real transform length N (power of two)
+    FFTPlan half;           // Complex plan for N/2 points
+    Complex* twiddle;       // exp(-2*pi*i*k/N) for k = 0 .. N/4
+    float* twiddle_re;      // The same, split (N/4 + 1 each)
+    float* twiddle_im;
+} RealFFTPlan;
+
+// Spectral frame in split (structure of arrays) layout for the vocoder:
+// real, imaginary, magnitude and phase planes, each starting on a 64-byte
+// line and holding a whole number of lines, so every stage from the FFT to
+// polar-to-rectangular streams them with plain 4-float loads (no
+// de-interleaving, no line shared between planes).
+#define SPECTRAL_ALIGN          64
+#define SPECTRAL_PLANE(bins)    (((bins) + 15) & ~15)   // Floats per plane
+
+typedef struct {
+    int bins;               // Bins in use (DC .. Nyquist, N/2 + 1)
+    int stride;             // Floats per plane, SPECTRAL_PLANE(bins)
+    float* re;
+    float* im;
+    float* mag;
+    float* ph;
+} SpectralFrame;
+
+/**
+ * Build the bit-reversal and twiddle tables for an N-point transform
+ * @param plan       Plan to initialise
+ * @param size       Transform length (power of two, 4 .. FFT_MAX_SIZE)
+ * @return           0 on success, -1 on bad size or allocation failure
+ */
+int fft_plan_init(FFTPlan* plan, int size);
+
+/**
+ * Release the tables owned by a plan
+ * @param plan       Plan previously set up with fft_plan_init
+ */
+void fft_plan_free(FFTPlan* plan);
+
+/**
+ * In-place forward FFT (no allocation, no trig calls)
+ * @param plan       Initialised plan
+ * @param x          plan->size complex samples, replaced by their spectrum
+ */
+void fft_forward(const FFTPlan* plan, Complex* x);
+
+/**
+ * In-place inverse FFT, scaled by 1/N so that fft_inverse(fft_forward(x)) == x
+ * @param plan       Initialised plan
+ * @param x          plan->size complex bins, replaced by the time signal
+ */
+void fft_inverse(const FFTPlan* plan, Complex* x);
+
+/**
+ * Build the tables for an N-point real-input transform
+ * @param plan       Plan to initialise
+ * @param size       Real transform length (power of two, 8 .. FFT_MAX_SIZE)
+ * @return           0 on success, -1 on bad size or allocation failure
+ */
+int rfft_plan_init(RealFFTPlan* plan, int size);
+
+/**
+ * Bytes of table storage rfft_plan_init_in needs for an N-point real plan
+ * @param size       Real transform length (power of two)
+ * @return           Size in bytes
+ */
+size_t rfft_plan_bytes(int size);
+
+/**
+ * Build an N-point real plan whose tables live in caller memory (no allocation).
+ * The plan must not be passed to rfft_plan_free; it lives as long as mem does.
+ * @param plan       Plan to initialise
+ * @param size       Real transform length (power of two, 8 .. FFT_MAX_SIZE)
+ * @param mem        rfft_plan_bytes(size) bytes, aligned for float
+ * @return           0 on success, -1 on bad size or NULL mem
+ */
+int rfft_plan_init_in(RealFFTPlan* plan, int size, void* mem);
+
+/**
+ * Release the tables owned by a real-input plan
+ * @param plan       Plan previously set up with rfft_plan_init
+ */
+void rfft_plan_free(RealFFTPlan* plan);
+
+/**
+ * Forward FFT of a real signal, producing only the non-redundant bins
+ * @param plan       Initialised real plan
+ * @param in         plan->size real samples
+ * @param out        plan->size/2 + 1 bins (DC .. Nyquist); DC and Nyquist have zero imag
+ */
+void rfft_forward(const RealFFTPlan* plan, const float* in, Complex* out);
+
+/**
+ * Inverse of rfft_forward, scaled by 1/N. The upper half of the spectrum is
+ * implied by conjugate symmetry; the imag parts of DC and Nyquist are ignored.
+ * @param plan       Initialised real plan
+ * @param spec       plan->size/2 + 1 bins, used as scratch and overwritten
+ * @param out        plan->size real output samples
+ */
+void rfft_inverse(const RealFFTPlan* plan, Complex* spec, float* out);
+
+// The two halves of the real transforms around the plan->size/2-point complex
+// FFT, for running that FFT somewhere else (e.g. in the PL):
+//   rfft_forward = pack real samples as complex, FFT, rfft_forward_post
+//   rfft_inverse = rfft_inverse_pre, inverse FFT (1/M scaled), unpack
+
+/**
+ * Turn the M-point FFT of the packed real signal into bins DC .. Nyquist
+ * @param plan       Initialised real plan (M = plan->size/2)
+ * @param out        M complex FFT outputs in, M + 1 bins out (room for M + 1)
+ */
+void rfft_forward_post(const RealFFTPlan* plan, Complex* out);
+
+/**
+ * Fold bins DC .. Nyquist into the M-point spectrum whose inverse FFT is the
+ * real signal packed as complex (even samples in real, odd in imag)
+ * @param plan       Initialised real plan (M = plan->size/2)
+ * @param spec       M + 1 bins in, M complex spectrum values out
+ */
+void rfft_inverse_pre(const RealFFTPlan* plan, Complex* spec);
+
+/**
+ * Bytes spectral_frame_init needs for a frame of bins (alignment slack included)
+ * @param bins       Bins per plane
+ * @return           Size in bytes
+ */
+size_t spectral_frame_bytes(int bins);
+
+/**
+ * Carve the four planes of a frame out of caller memory
+ * @param f          Frame to set up
+ * @param bins       Bins per plane
+ * @param mem        spectral_frame_bytes(bins) bytes, any alignment (NULL fails)
+ * @return           0 on success, -1 on NULL mem
+ */
+int spectral_frame_init(SpectralFrame* f, int bins, void* mem);
+
+/**
+ * Forward real FFT into the re/im planes of a frame (no interleaved copy:
+ * even/odd samples are gathered straight into bit-reversed order)
+ * @param plan       Initialised real plan
+ * @param in         plan->size real samples
+ * @param f          Frame with at least plan->size/2 + 1 bins; re/im receive DC .. Nyquist
+ */
+void rfft_forward_split(const RealFFTPlan* plan, const float* in, SpectralFrame* f);
+
+/**
+ * Inverse of rfft_forward_split, scaled by 1/N; the re/im planes are used as scratch
+ * @param plan       Initialised real plan
+ * @param f          Frame holding DC .. Nyquist in re/im (imag of DC and Nyquist ignored)
+ * @param out        plan->size real output samples
+ */
+void rfft_inverse_split(const RealFFTPlan* plan, SpectralFrame* f, float* out);
+
+/**
+ * rfft_forward_post into a split frame, for an M-point FFT run elsewhere
+ * @param plan       Initialised real plan (M = plan->size/2)
+ * @param z          M complex FFT outputs of the packed real signal
+ * @param f          Frame whose re/im receive bins DC .. Nyquist
+ */
+void rfft_forward_post_split(const RealFFTPlan* plan, const Complex* z, SpectralFrame* f);
+
+/**
+ * rfft_inverse_pre from a split frame, for an M-point inverse FFT run elsewhere
+ * @param plan       Initialised real plan (M = plan->size/2)
+ * @param f          Frame holding bins DC .. Nyquist in re/im (used as scratch)
+ * @param z          Receives the M-point spectrum to inverse transform
+ */
+void rfft_inverse_pre_split(const RealFFTPlan* plan, SpectralFrame* f, Complex* z);
+
+#endif // FFT_H
@@ -0,0 +1,129 @@
+#include <stdlib.h>
+#include <math.h>
+#include "fft_q15.h"
+#include "arena.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// A radix-2 butterfly output is bounded by (1 + sqrt(2)) * max|input component|,
+// so inputs below this stay inside Q15 without scaling
+#define FFT_Q15_HEADROOM 13572
+
+int fft_q15_plan_init(FFTPlanQ15* plan, int size) {
+    plan->size = 0;
+    plan->log2_size = 0;
+    plan->bitrev = NULL;
+    plan->twiddle = NULL;
+
+    if (size < 4 || size > 32768 || (size & (size - 1)) != 0) {
+        return -1;
+    }
+
+    int log2_size = 0;
+    while ((1 << log2_size) < size) log2_size++;
+
+    plan->bitrev = (uint16_t*)arena_malloc(size * sizeof(uint16_t));
+    plan->twiddle = (ComplexQ15*)arena_malloc(size / 2 * sizeof(ComplexQ15));
+    if (!plan->bitrev || !plan->twiddle) {
+        fft_q15_plan_free(plan);
+        return -1;
+    }
+
+    for (int i = 0; i < size; i++) {
+        int r = 0;
+        for (int b = 0; b < log2_size; b++) {
+            r |= ((i >> b) & 1) << (log2_size - 1 - b);
+        }
+        plan->bitrev[i] = (uint16_t)r;
+    }
+
+    for (int k = 0; k < size / 2; k++) {
+        double angle = -2.0 * M_PI * k / size;
+        plan->twiddle[k].real = q15_sat((int32_t)lrint(cos(angle) * 32767.0));
+        plan->twiddle[k].imag = q15_sat((int32_t)lrint(sin(angle) * 32767.0));
+    }
+
+    plan->size = size;
+    plan->log2_size = log2_size;
+    return 0;
+}
+
+void fft_q15_plan_free(FFTPlanQ15* plan) {
+    arena_free(plan->bitrev);
+    arena_free(plan->twiddle);
+    plan->bitrev = NULL;
+    plan->twiddle = NULL;
+    plan->size = 0;
+    plan->log2_size = 0;
+}
+
+// Largest absolute component in the block
+static int32_t fft_q15_peak(const ComplexQ15* x, int n) {
+    int32_t peak = 0;
+    for (int i = 0; i < n; i++) {
+        int32_t r = x[i].real < 0 ? -(int32_t)x[i].real : x[i].real;
+        int32_t m = x[i].imag < 0 ? -(int32_t)x[i].imag : x[i].imag;
+        if (r > peak) peak = r;
+        if (m > peak) peak = m;
+    }
+    return peak;
+}
+
+// Iterative decimation-in-time transform; conj = 1 selects conjugate twiddles
+static int fft_q15_core(const FFTPlanQ15* plan, ComplexQ15* x, int conj) {
+    const int N = plan->size;
+    int exponent = 0;
+
+    // 1. Bit-reversal permutation (each pair swapped once)
+    for (int i = 0; i < N; i++) {
+        int j = plan->bitrev[i];
+        if (i < j) {
+            ComplexQ15 tmp = x[i];
+            x[i] = x[j];
+            x[j] = tmp;
+        }
+    }
+
+    // 2. Radix-2 stages, each optionally halved to keep headroom
+    for (int len = 2; len <= N; len <<= 1) {
+        int half = len >> 1;
+        int stride = N / len;
+        int shift = fft_q15_peak(x, N) >= FFT_Q15_HEADROOM ? 1 : 0;
+        exponent += shift;
+
+        for (int start = 0; start < N; start += len) {
+            ComplexQ15* lo = x + start;
+            ComplexQ15* hi = x + start + half;
+
+            for (int k = 0; k < half; k++) {
+                int32_t wr = plan->twiddle[k * stride].real;
+                int32_t wi = plan->twiddle[k * stride].imag;
+                if (conj) wi = -wi;
+
+                // Q15 x Q15 products rounded back to Q15
+                int32_t tr = (hi[k].real * wr - hi[k].imag * wi + (1 << 14)) >> 15;
+                int32_t ti = (hi[k].real * wi + hi[k].imag * wr + (1 << 14)) >> 15;
+                int32_t ar = lo[k].real;
+                int32_t ai = lo[k].imag;
+
+                int32_t round = shift;  // 1 when halving, so >> 1 rounds to nearest
+                lo[k].real = q15_sat((ar + tr + round) >> shift);
+                lo[k].imag = q15_sat((ai + ti + round) >> shift);
+                hi[k].real = q15_sat((ar - tr + round) >> shift);
+                hi[k].imag = q15_sat((ai - ti + round) >> shift);
+            }
+        }
+    }
+
+    return exponent;
+}
+
+int fft_q15_forward(const FFTPlanQ15* plan, ComplexQ15* x) {
+    return fft_q15_core(plan, x, 0);
+}
+
+int fft_q15_inverse(const FFTPlanQ15* plan, ComplexQ15* x) {
+    return fft_q15_core(plan, x, 1);
+}
@@ -0,0 +1,51 @@
+#ifndef FFT_Q15_H
+#define FFT_Q15_H
+
+#include "fixed_point.h"
+
+// Fixed-point FFT with block floating-point scaling.
+// Data stays in Q15; before each radix-2 stage the block is checked and, if a
+// butterfly could overflow, the whole stage is scaled by 1/2. The number of
+// halvings is returned as a block exponent: true value = result * 2^exponent.
+// Butterflies use 32-bit intermediates only, so the same code maps onto the
+// R5 cores or an HLS kernel in the PL.
+
+// Precomputed tables for one transform size
+typedef struct {
+    int size;               // Transform length N (power of two)
+    int log2_size;          // log2(N)
+    uint16_t* bitrev;       // Bit-reversal permutation, N entries
+    ComplexQ15* twiddle;    // exp(-2*pi*i*k/N) in Q15 for k = 0 .. N/2-1
+} FFTPlanQ15;
+
+/**
+ * Build the bit-reversal and Q15 twiddle tables for an N-point transform
+ * @param plan       Plan to initialise
+ * @param size       Transform length (power of two, 4 .. 32768)
+ * @return           0 on success, -1 on bad size or allocation failure
+ */
+int fft_q15_plan_init(FFTPlanQ15* plan, int size);
+
+/**
+ * Release the tables owned by a plan
+ * @param plan       Plan previously set up with fft_q15_plan_init
+ */
+void fft_q15_plan_free(FFTPlanQ15* plan);
+
+/**
+ * In-place forward FFT of Q15 data
+ * @param plan       Initialised plan
+ * @param x          plan->size complex Q15 samples, replaced by their spectrum
+ * @return           Block exponent (spectrum = x * 2^exponent)
+ */
+int fft_q15_forward(const FFTPlanQ15* plan, ComplexQ15* x);
+
+/**
+ * In-place inverse FFT of Q15 data (unscaled: no 1/N)
+ * @param plan       Initialised plan
+ * @param x          plan->size complex Q15 bins, replaced by the time signal
+ * @return           Block exponent (N * signal = x * 2^exponent)
+ */
+int fft_q15_inverse(const FFTPlanQ15* plan, ComplexQ15* x);
+
+#endif // FFT_Q15_H
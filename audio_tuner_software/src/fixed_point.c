@@ -0,0 +1,130 @@
+#include "fixed_point.h"
+#include "prof.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+void q15_to_float_array(const q15_t* in, float* out, int n) {
+    int i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t v = vld1q_s16(in + i);
+        // Fixed-point convert with 15 fractional bits does the / 32768 for free
+        vst1q_f32(out + i, vcvtq_n_f32_s32(vmovl_s16(vget_low_s16(v)), 15));
+        vst1q_f32(out + i + 4, vcvtq_n_f32_s32(vmovl_s16(vget_high_s16(v)), 15));
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = q15_to_float(in[i]);
+    }
+}
+
+void float_to_q15_array(const float* in, q15_t* out, int n) {
+    int i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 8 <= n; i += 8) {
+        // Round to nearest, then narrow with saturation
+        int32x4_t lo = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(in + i), Q15_SCALE));
+        int32x4_t hi = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(in + i + 4), Q15_SCALE));
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = float_to_q15(in[i]);
+    }
+}
+
+void q15_deinterleave_to_float(const q15_t* in, float* const* out, int channels, int n) {
+    if (channels == 1) {
+        q15_to_float_array(in, out[0], n);
+        return;
+    }
+    int i = 0;
+#if defined(__ARM_NEON)
+    if (channels == 2) {
+        for (; i + 8 <= n; i += 8) {
+            int16x8x2_t v = vld2q_s16(in + 2 * i);
+            for (int c = 0; c < 2; c++) {
+                vst1q_f32(out[c] + i, vcvtq_n_f32_s32(vmovl_s16(vget_low_s16(v.val[c])), 15));
+                vst1q_f32(out[c] + i + 4, vcvtq_n_f32_s32(vmovl_s16(vget_high_s16(v.val[c])), 15));
+            }
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        for (int c = 0; c < channels; c++) {
+            out[c][i] = q15_to_float(in[i * channels + c]);
+        }
+    }
+}
+
+#if defined(__ARM_NEON)
+// Eight captured words -> PCM. Shift-narrow keeps bits 2..17 of each word,
+// then RBIT mirrors every byte and REV16 swaps the bytes of each halfword:
+// a 16-bit mirror
+static inline int16x8_t pcm_from_capture_x8(uint32x4_t lo, uint32x4_t hi) {
+    uint16x8_t v = vcombine_u16(vshrn_n_u32(lo, PCM_CAPTURE_SHIFT), vshrn_n_u32(hi, PCM_CAPTURE_SHIFT));
+    return vreinterpretq_s16_u8(vrev16q_u8(vrbitq_u8(vreinterpretq_u8_u16(v))));
+}
+#endif
+
+void pcm_from_capture(const uint32_t* in, int16_t* out, int n) {
+    int i = 0;
+    PROF_START(PROF_CONVERT);
+#if defined(__ARM_NEON)
+    for (; i + 8 <= n; i += 8) {
+        vst1q_s16(out + i, pcm_from_capture_x8(vld1q_u32(in + i), vld1q_u32(in + i + 4)));
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = pcm_from_capture_word(in[i]);
+    }
+    PROF_STOP(PROF_CONVERT);
+}
+
+void pcm_from_capture_planar(const uint32_t* in, int16_t* const* out, int channels, int n) {
+    if (channels == 1) {
+        pcm_from_capture(in, out[0], n);
+        return;
+    }
+    int i = 0;
+    PROF_START(PROF_CONVERT);
+#if defined(__ARM_NEON)
+    if (channels == 2) {
+        for (; i + 8 <= n; i += 8) {
+            // LD2 de-interleaves L and R while loading
+            uint32x4x2_t lo = vld2q_u32(in + 2 * i);
+            uint32x4x2_t hi = vld2q_u32(in + 2 * i + 8);
+            vst1q_s16(out[0] + i, pcm_from_capture_x8(lo.val[0], hi.val[0]));
+            vst1q_s16(out[1] + i, pcm_from_capture_x8(lo.val[1], hi.val[1]));
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        for (int c = 0; c < channels; c++) {
+            out[c][i] = pcm_from_capture_word(in[i * channels + c]);
+        }
+    }
+    PROF_STOP(PROF_CONVERT);
+}
+
+#if defined(__ARM_NEON)
+void pcm_to_playback(const int16_t* in, uint32_t* out, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t v = vld1q_s16(in + i);
+        // Widen by a full 16 bits, then interleave each vector with itself for L/R
+        uint32x4x2_t lo, hi;
+        lo.val[0] = lo.val[1] = vreinterpretq_u32_s32(vshll_n_s16(vget_low_s16(v), 16));
+        hi.val[0] = hi.val[1] = vreinterpretq_u32_s32(vshll_n_s16(vget_high_s16(v), 16));
+        vst2q_u32(out + 2 * i, lo);
+        vst2q_u32(out + 2 * i + 8, hi);
+    }
+    for (; i < n; i++) {
+        uint32_t w = (uint32_t)in[i] << 16;
+        out[2 * i]     = w;
+        out[2 * i + 1] = w;
+    }
+}
+#endif
@@ -0,0 +1,140 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+
+// Q15: int16_t holding value / 32768 in [-1, 1)
+// Q31: int32_t holding value / 2^31, used for accumulators
+typedef int16_t q15_t;
+typedef int32_t q31_t;
+
+#define Q15_ONE     32767
+#define Q15_SCALE   32768.0f
+
+// Complex Q15 sample (same layout as Complex, half the size)
+typedef struct {
+    q15_t real;
+    q15_t imag;
+} ComplexQ15;
+
+// Saturate a 32-bit value to Q15
+static inline q15_t q15_sat(int32_t x) {
+    if (x > 32767) return 32767;
+    if (x < -32768) return -32768;
+    return (q15_t)x;
+}
+
+// Q15 x Q15 -> Q15 with rounding
+static inline q15_t q15_mul(q15_t a, q15_t b) {
+    return q15_sat(((int32_t)a * b + (1 << 14)) >> 15);
+}
+
+// Q15 x Q15 -> Q31 (exact, saturates only for -1 * -1)
+static inline q31_t q15_mul_q31(q15_t a, q15_t b) {
+    int32_t p = (int32_t)a * b;
+    return (p == 0x40000000) ? INT32_MAX : p << 1;
+}
+
+// Q31 -> Q15 with rounding and saturation
+static inline q15_t q31_to_q15(q31_t x) {
+    return q15_sat((int32_t)(((int64_t)x + (1 << 15)) >> 16));
+}
+
+static inline float q15_to_float(q15_t x) {
+    return (float)x / Q15_SCALE;
+}
+
+// Float -> Q15 with rounding and saturation at [-1, 1)
+static inline q15_t float_to_q15(float x) {
+    float s = x * Q15_SCALE;
+    if (s >= 32767.0f) return 32767;
+    if (s <= -32768.0f) return -32768;
+    return (q15_t)(s < 0.0f ? s - 0.5f : s + 0.5f);
+}
+
+/**
+ * Convert a block of Q15 samples to float
+ * @param in         n Q15 samples
+ * @param out        n floats in [-1, 1)
+ * @param n          Number of samples
+ */
+void q15_to_float_array(const q15_t* in, float* out, int n);
+
+/**
+ * Convert a block of floats to Q15 with rounding and saturation
+ * @param in         n floats
+ * @param out        n Q15 samples
+ * @param n          Number of samples
+ */
+void float_to_q15_array(const float* in, q15_t* out, int n);
+
+/**
+ * Split interleaved Q15 frames into planar float channels in one pass,
+ * eight stereo frames per step on NEON
+ * @param in         n * channels Q15 samples (frame 0 ch 0, frame 0 ch 1, ...)
+ * @param out        channels planes of n floats
+ * @param channels   Samples per frame (>= 1)
+ * @param n          Number of frames
+ */
+void q15_deinterleave_to_float(const q15_t* in, float* const* out, int channels, int n);
+
+// The I2S mic delivers 18 useful MSBs in each 32-bit word; dropping the two
+// LSBs leaves 16-bit PCM. The bit order on the wire is reversed, so capture
+// also mirrors the 16 bits.
+#define PCM_CAPTURE_SHIFT 2
+
+// Mirror the bits of a 16-bit value (bit 0 <-> bit 15) without a loop
+static inline uint16_t pcm_bitrev16(uint16_t x) {
+    x = (uint16_t)(((x >> 1) & 0x5555u) | ((x & 0x5555u) << 1));
+    x = (uint16_t)(((x >> 2) & 0x3333u) | ((x & 0x3333u) << 2));
+    x = (uint16_t)(((x >> 4) & 0x0F0Fu) | ((x & 0x0F0Fu) << 4));
+    return (uint16_t)((x >> 8) | (x << 8));
+}
+
+// One captured I2S word -> 16-bit PCM (shift, truncate, mirror)
+static inline int16_t pcm_from_capture_word(uint32_t w) {
+    return (int16_t)pcm_bitrev16((uint16_t)(w >> PCM_CAPTURE_SHIFT));
+}
+
+/**
+ * Convert one capture DMA burst to 16-bit PCM, eight samples per step on
+ * NEON. Bit-exact with pcm_from_capture_word on every sample.
+ * @param in         n raw 32-bit I2S words as written by the S2MM channel
+ * @param out        n PCM samples
+ * @param n          Number of samples (any count, any alignment)
+ */
+void pcm_from_capture(const uint32_t* in, int16_t* out, int n);
+
+/**
+ * pcm_from_capture for a channel-interleaved burst (one I2S word per channel
+ * per frame): unpacks and splits the channels in the same pass, eight stereo
+ * frames per step on NEON
+ * @param in         n * channels raw 32-bit I2S words
+ * @param out        channels planes of n PCM samples
+ * @param channels   Words per frame (>= 1)
+ * @param n          Number of frames
+ */
+void pcm_from_capture_planar(const uint32_t* in, int16_t* const* out, int channels, int n);
+
+/**
+ * Expand mono 16-bit PCM to the stereo I2S frames the MM2S channel sends:
+ * each sample goes to the top half of both the L and R word.
+ * @param in         n PCM samples
+ * @param out        2 * n 32-bit words (L, R, L, R, ...)
+ * @param n          Number of samples (any count, any alignment)
+ */
+#if defined(__ARM_NEON)
+void pcm_to_playback(const int16_t* in, uint32_t* out, int n);
+#else
+// Without NEON the plain loop stays inline at the call site, where the
+// compiler can vectorise it (about 3x faster than an out-of-line call)
+static inline void pcm_to_playback(const int16_t* in, uint32_t* out, int n) {
+    for (int i = 0; i < n; i++) {
+        uint32_t w = (uint32_t)((int32_t)in[i] << 16);
+        out[2 * i]     = w;
+        out[2 * i + 1] = w;
+    }
+}
+#endif
+
+#endif // FIXED_POINT_H
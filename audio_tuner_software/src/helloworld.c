@@ -40,124 +40,287 @@
  * - Drives the speaker with the shifted audio
  */
 
+#include "tuner_rtos.h"
+
+#if !TUNER_RTOS
+
 #include "xaxidma.h"
 #include "xparameters.h"
 #include "xil_cache.h"
 #include "xstatus.h"
-#include "sleep.h"
 #include "ff.h"
 #include "Yin.h"
+#include "YinAnalysis.h"
+#include "YinTracker.h"
+#include "YinPL.h"
 #include "phase_voc.h"
+#include "shift_engine.h"
+#include "autotune.h"
+#include "scale.h"
+#include "capture.h"
+#include "vad.h"
+#include "dma_mem.h"
+#include "playback.h"
+#include "live_tune.h"
+#include "batch_tune.h"
+#include "take_pipe.h"
+#include "self_bench.h"
+#include "status.h"
+#include "wav_writer.h"
+#include "wav_reader.h"
+#include "wav_pitch_detection.h"
+#include "sd_sink.h"
+#include "arena.h"
+#include "prof.h"
+#include "dlog.h"
+#include "fixed_point.h"
 #include <stdint.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 /*** DMA device ***/
 #define DMA_DEV_ID              XPAR_AXIDMA_0_DEVICE_ID
       
-/*** AXI GPIO for LED and Switch ***/
-#define AXI_GPIO_LED_OFFSET     0x00  // LED channel offset
-#define AXI_GPIO_SW_OFFSET      0x04  // Switch channel offset
-
 /*** Audio / file format ***/
 #define FS                      48000      // sample rate (Hz) - MUST match your I2S hardware config
 #define CHANNELS                1          // mono
 #define MIC_BITS                18         // useful MSBs from the I2S mic
 #define OUT_BITS                16         // write 16-bit PCM in the WAV
 
+// With REC_ADPCM set, rec_xxx.wav is stored as 4-bit IMA ADPCM (adpcm.h):
+// a quarter of the 96 KB/s a 16-bit take sends to the card, so the card's
+// write stalls have four times the slack. The streaming path encodes each
+// burst as it is written; the SD sink encodes as it writes. Every reader
+// goes through wav_reader, which decodes it on the fly.
+#ifndef REC_ADPCM
+#define REC_ADPCM               0
+#endif
+#define REC_BITS                (REC_ADPCM ? WAV_BITS_ADPCM : OUT_BITS)
+
 /*** Capture sizing ***/
-#define BURST_SAMPLES           256        // per DMA transfer
+#define BURST_SAMPLES           CAPTURE_BURST_SAMPLES  // per capture burst / playback transfer
 #define BYTES_PER_SAMPLE        4          // PL streams 32-bit words
 #define BURST_BYTES             (BURST_SAMPLES * BYTES_PER_SAMPLE)
 
-#define SECONDS_TO_RECORD       3  // can be changed as desired
+// With LONG_TAKE set, a take runs for minutes and SW1 ends it early. The
+// DDR take buffers move to the NOLOAD .take_buf section in psu_ddr_1_MEM_0
+// (2 GB, hours of 16-bit mono), and the per-take working memory stays the
+// same however long the take is: shifting streams SHIFT_CHUNK_SIZE chunks
+// from and to DDR or SD through one vocoder context (so the phase runs on
+// across chunk boundaries) and the capture pitch statistics keep at most
+// PITCH_MAX_WINDOWS bursts, spread over the take.
+#ifndef LONG_TAKE
+#define LONG_TAKE               0
+#endif
+
+#ifndef SECONDS_TO_RECORD
+#if LONG_TAKE
+#define SECONDS_TO_RECORD       600
+#else
+#define SECONDS_TO_RECORD       3  // can be changed as desired (shifting streams, so heap does not limit it)
+#endif
+#endif
 #define TOTAL_SAMPLES           (FS * SECONDS_TO_RECORD)
 
+/*** Pitch detection ***/
+#define PITCH_WINDOW            1024       // Yin window (samples)
+#define PITCH_START_SAMPLE      22050      // Skip the button press at the start of a take
+#define PITCH_THRESHOLD         0.15f
+#define PITCH_MAX_WINDOWS       8192       // Burst pitches kept per take (one burst in N on long takes)
+
+// With CAPTURE_PITCH set, state 2 slides a Yin tracker over every burst as it
+// arrives, so the recorded pitch is ready when capture stops and state 3 does
+// not re-read the take. The tracker update is exact integer work of about
+// BURST_SAMPLES * PITCH_WINDOW / 2 multiply-adds per burst (NEON, 8 lags at a
+// time), well inside the time the next burst takes to arrive. With YIN_PL as
+// well, the same difference function comes from the yin_diff block in the
+// fabric and the CPU only runs Yin steps 2-5 once per burst. With
+// CAPTURE_PL_DECIMATE instead, the tracker runs on the PL's 12 kHz analysis
+// stream over the same 21 ms window: a quarter of the lags over a quarter of
+// the samples, about 1/16 of the difference-function work.
+#ifndef CAPTURE_PITCH
+#define CAPTURE_PITCH           1
+#endif
+
+// With TAKE_VAD set, every capture burst also goes through the onset / voice
+// activity detector (vad.c), and state 3 analyses the window in the middle of
+// the longest voiced region instead of a fixed PITCH_START_SAMPLE. A take with
+// no voiced region is reported as such without reading it again.
+#ifndef TAKE_VAD
+#define TAKE_VAD                1
+#endif
+
+// With TAKE_AUTOTUNE set as well, state 4 follows the capture pitch contour
+// instead of shifting the whole take by one ratio: every vocoder frame is
+// moved to the target note (autotune.c), so a held note that drifts is
+// corrected along the take. Without a contour, the single ratio is used.
+#ifndef TAKE_AUTOTUNE
+#define TAKE_AUTOTUNE           1
+#endif
+#define TAKE_CONTOUR            (CAPTURE_PITCH && TAKE_AUTOTUNE)
+
+// With TAKE_IN_DDR set, a take stays in DDR from capture through analysis,
+// shifting and playback; rec_xxx.wav and out_xxx.wav are written afterwards
+// by the background SD sink (TAKE_SAVE_SD) while the board waits for the
+// button or plays back, so nothing in the take's path waits on the card.
+#ifndef TAKE_IN_DDR
+#define TAKE_IN_DDR             1
+#endif
+#ifndef TAKE_SAVE_SD
+#define TAKE_SAVE_SD            1
+#endif
+
+// The SD volume is mounted once at boot and stays mounted. With TAKE_SLOTS
+// set, rec_001..rec_999 and out_001..out_999 are take slots
+// (wav_writer_open_slot): each is preallocated, contiguous, once, while the
+// board is idle before its take (take_slot_prepare), and every later take
+// overwrites it in place, so starting a recording neither mounts nor
+// allocates. Slots keep their full TOTAL_SAMPLES size on the card, so
+// LONG_TAKE builds leave them off and trim each file to its take.
+#ifndef TAKE_SLOTS
+#define TAKE_SLOTS              (!LONG_TAKE)
+#endif
+
+// With TAKE_PREVIEW set, state 4 renders a quick preview with PSOLA (a tenth
+// of the vocoder's cost, fed the capture pitch contour) and plays it at once,
+// without waiting for SW1. The full-quality render goes on into its own
+// buffer a chunk at a time, from the idle loop and whenever the playback
+// queue is full; once done, it is what SW1 plays and what out_xxx.wav
+// holds. The preview needs TAKE_IN_DDR and a second take-length buffer, so
+// LONG_TAKE builds leave it off.
+#ifndef TAKE_PREVIEW
+#define TAKE_PREVIEW            (TAKE_IN_DDR && !LONG_TAKE)
+#endif
+#if TAKE_PREVIEW && !TAKE_IN_DDR
+#error "TAKE_PREVIEW renders in DDR; build it with TAKE_IN_DDR"
+#endif
+
+// Both DMA channels are configured once at start-up and stay up; capture
+// (S2MM) and playback (MM2S) are serviced independently, so the speaker can
+// run while a take is being recorded. With LIVE_MONITOR set, state 2 sends
+// each captured burst straight back out (MONITOR_PREROLL samples of silence
+// absorb the polling jitter). Off by default: mic and speaker share a desk.
+#ifndef LIVE_MONITOR
+#define LIVE_MONITOR            0
+#endif
+#define MONITOR_PREROLL         BURST_SAMPLES
+
+// With LIVE_RETUNE set, holding SW1 through start-up selects the live mode
+// (live_tune.c) instead of the take state machine: mic -> tracker ->
+// vocoder -> speaker, continuously, retuned to the nearest note. Each
+// press starts or stops it; a short latency line is printed every
+// LIVE_REPORT_SECONDS and the full report when it stops. Build with
+// -DCAPTURE_SEG_BURSTS=1 to take 16 ms off the capture side.
+#ifndef LIVE_RETUNE
+#define LIVE_RETUNE             1
+#endif
+#define LIVE_REPORT_SECONDS     2
+
+// With BATCH_RETUNE set, start-up retunes every rec_*.wav on the card to
+// target.wav (batch_tune.c: read, shift and write overlap across files)
+// and prints files per minute and the realtime factor before the
+// interactive mode starts. Needs the SD card in at power-up.
+#ifndef BATCH_RETUNE
+#define BATCH_RETUNE            0
+#endif
+
+// With REHEARSAL set, start-up runs back-to-back takes (take_pipe.c) instead
+// of the take state machine: each press starts or stops a run, and while one
+// take is recorded the one before is shifted to target.wav and played and
+// saved behind it. When the shifter or the card falls behind, recording
+// waits for a free take slot (LED slow blink). A line per take and a
+// takes-per-minute report come out on the UART.
+#ifndef REHEARSAL
+#define REHEARSAL               0
+#endif
+#define REHEARSAL_REPORT_SECONDS 10
+
+// With SELF_BENCH set, start-up runs the on-target benchmark (self_bench.c)
+// and stops: the DSP kernels on a synthetic sweep, the SD card and both DMA
+// channels, one JSON line per result on the UART. 1 runs it when SW1 is
+// held through start-up (ahead of the LIVE_RETUNE hold), 2 on every boot.
+#ifndef SELF_BENCH
+#define SELF_BENCH              0
+#endif
+
 /*** Globals ***/
 static XAxiDma AxiDma;
-static uint32_t rx32[BURST_SAMPLES] __attribute__((aligned(64)));
+#if !TAKE_IN_DDR
 static int16_t  pcm16[BURST_SAMPLES];
-static uint32_t tx32[BURST_SAMPLES * 2] __attribute__((aligned(64)));
+#endif
+#if !TAKE_IN_DDR
+static int16_t  play_pcm16[PLAYBACK_SAMPLES];
+#endif
+#if TAKE_IN_DDR
+#if LONG_TAKE
+#define TAKE_MEM                __attribute__((section(".take_buf"), aligned(64)))
+#else
+#define TAKE_MEM                __attribute__((aligned(64)))
+#endif
+// MM2S reads take_out in place only if the DMA can address psu_ddr_1
+#if LONG_TAKE && !(defined(XPAR_AXIDMA_0_ADDR_WIDTH) && XPAR_AXIDMA_0_ADDR_WIDTH > 32)
+#define TAKE_ZERO_COPY          0
+#else
+#define TAKE_ZERO_COPY          PLAYBACK_ZERO_COPY
+#endif
+static int16_t  take_rec[TOTAL_SAMPLES] TAKE_MEM;   // Recorded take
+static int16_t  take_out[TOTAL_SAMPLES] TAKE_MEM;   // Shifted take
+static uint32_t take_samples;           // Valid samples in take_rec / take_out
+static int16_t *take_play = take_out;   // What state 6 plays
+#if TAKE_PREVIEW
+static int16_t  take_full[TOTAL_SAMPLES] TAKE_MEM;  // Full-quality render; take_out holds the preview
+#endif
+#else
+static WavWriter wav_out;                // The take or shifted file being written
+#endif
 static float target_pitch_ratio = 1.0f;  // Global pitch shift ratio
+static float take_voicing;               // Voiced fraction of the take (state 3), picks the shifter
+static float take_target;                // Note the take is moved to (state 3), 0 if none
+static float take_pitch;                 // The take's pitch that maps to take_target
 
 /*** FatFs globals (must persist while mounted) ***/
 static FATFS g_fs;
 static const char *DRIVE = "0:";   // <-- SD1
 
-// Pitch detection result structure
-typedef struct {
-    float pitch;               // Detected pitch in Hz (-1 if not detected)
-    float confidence;          // Confidence level (0.0 to 1.0)
-    int sampleRate;            // Sample rate of the audio
-    int numSamples;            // Number of samples analyzed
-    int bufferSize;            // Buffer size used for analysis
-    int actualStartSample;     // Actual start sample used
-} PitchResult;
-
 // Helper function to get frequency of a specific musical note
 float get_note_frequency(int midi_note) {
     // A4 = MIDI note 69 = 440 Hz
-    // Frequency = 440 * 2^((midi_note - 69) / 12)
-    float semitones_from_a4 = (float)(midi_note - 69);
-    return 440.0f * powf(2.0f, semitones_from_a4 / 12.0f);
+    return scale_note_frequency(&scale_chromatic, midi_note);
 }
 
 // Helper function to find closest MIDI note to a frequency
 int frequency_to_midi_note(float frequency) {
     if (frequency <= 0) return -1;
-    // MIDI note = 12 * log2(f/440) + 69
-    float log2_val = logf(frequency / 440.0f) / logf(2.0f);
-    return (int)(12.0f * log2_val + 69.0f + 0.5f);  // +0.5 for rounding
+    return scale_quantize_note(&scale_chromatic, frequency, NULL);
 }
 
 // Helper function to find target frequency based on reference comparison
 float find_closest_target_frequency(float recorded_freq, int reference_note_class, float reference_freq) {
     // If recorded > reference, shift DOWN to next lower occurrence of note class
     // If recorded < reference, shift UP to next higher occurrence of note class
-    
-    float target_freq = 0;
-    
-    if (recorded_freq > reference_freq) {
-        // Recorded is higher than reference, so shift DOWN to next lower occurrence
-        for (int octave = 8; octave >= 1; octave--) {
-            int midi_note = reference_note_class + (octave * 12);
-            if (midi_note >= 12 && midi_note <= 108) {  // Valid MIDI range
-                float freq = get_note_frequency(midi_note);
-                if (freq < recorded_freq) {
-                    target_freq = freq;
-                    break;  // Found first occurrence below recorded frequency
-                }
-            }
-        }
-    } else {
-        // Recorded is lower than reference, so shift UP to next higher occurrence
-        for (int octave = 1; octave <= 8; octave++) {
-            int midi_note = reference_note_class + (octave * 12);
-            if (midi_note >= 12 && midi_note <= 108) {  // Valid MIDI range
-                float freq = get_note_frequency(midi_note);
-                if (freq > recorded_freq) {
-                    target_freq = freq;
-                    break;  // Found first occurrence above recorded frequency
-                }
-            }
-        }
+    Scale note_class;
+    scale_init(&note_class, reference_note_class, 0x001, SCALE_A4);
+    int midi_note = scale_next_note(&note_class, recorded_freq, recorded_freq > reference_freq ? -1 : 1);
+
+    // Octaves 1 .. 8 of the class only
+    if (midi_note < 12 + reference_note_class || midi_note > 96 + reference_note_class) {
+        return 0;
     }
-    
-    return target_freq;
+    return get_note_frequency(midi_note);
 }
 
 /*** Utilities ***/
-static inline int16_t to_pcm16(uint32_t w)
-{
-    // Treat as signed in 32-bit, keep top OUT_BITS bits.
-    return (int16_t)((int32_t)w >> (MIC_BITS - OUT_BITS));
-}
-
-static inline uint32_t i2s_word_from_pcm16(int16_t s)
-{
-    return (uint32_t)((int32_t)s << 16);
-}
+// Capture words are converted a burst at a time by pcm_from_capture
+// (fixed_point.c), playback words by playback_fill
+#if MIC_BITS - OUT_BITS != PCM_CAPTURE_SHIFT
+#error "pcm_from_capture assumes MIC_BITS - OUT_BITS == PCM_CAPTURE_SHIFT"
+#endif
+#if YIN_PL && CAPTURE_PL_PACK
+#error "yin_diff taps the raw capture stream; it cannot follow CAPTURE_PL_PACK"
+#endif
 
 void print_float(float x) {
     int i = (int)x;
@@ -165,152 +328,200 @@ void print_float(float x) {
     xil_printf("%d.%03d", i, frac);
 }
 
-/*** 44-byte WAV header ***/
-static void wav_header(uint8_t *h, uint32_t nsamples, uint32_t fs,
-                       uint16_t bits, uint16_t ch)
+/*** Mount SD1 once; later calls cost nothing while it stays mounted ***/
+static int sd_mounted;
+
+static int sd_mount(void)
 {
-    uint32_t byteRate   = fs * ch * (bits/8);
-    uint16_t blockAlign = ch * (bits/8);
-    uint32_t dataSize   = nsamples * blockAlign;
-    uint32_t riffSize   = 36 + dataSize;
-
-    h[0]='R';h[1]='I';h[2]='F';h[3]='F';
-    h[4]= riffSize     &255; h[5]=(riffSize>>8)&255; h[6]=(riffSize>>16)&255; h[7]=(riffSize>>24)&255;
-    h[8]='W';h[9]='A';h[10]='V';h[11]='E';
-    h[12]='f';h[13]='m';h[14]='t';h[15]=' ';
-    h[16]=16; h[17]=0; h[18]=0; h[19]=0;          // fmt chunk size
-    h[20]=1;  h[21]=0;                            // PCM
-    h[22]=ch; h[23]=0;                            // channels
-    h[24]= fs        &255; h[25]=(fs>>8)&255; h[26]=(fs>>16)&255; h[27]=(fs>>24)&255;
-    h[28]= byteRate  &255; h[29]=(byteRate>>8)&255; h[30]=(byteRate>>16)&255; h[31]=(byteRate>>24)&255;
-    h[32]= blockAlign&255; h[33]=(blockAlign>>8)&255;
-    h[34]= bits      &255; h[35]=(bits>>8)&255;
-    h[36]='d';h[37]='a';h[38]='t';h[39]='a';
-    h[40]= dataSize  &255; h[41]=(dataSize>>8)&255; h[42]=(dataSize>>16)&255; h[43]=(dataSize>>24)&255;
+    if (!sd_mounted) {
+        sd_mounted = f_mount(&g_fs, DRIVE, 1) == FR_OK;
+    }
+    return sd_mounted ? 0 : -1;
 }
 
-/*** Open WAV on SD1 and write placeholder header ***/
-static int sd_open_wav(FIL *fp, const char *filename,
-                       uint32_t nsamples, uint32_t fs,
-                       uint16_t bits, uint16_t ch)
+/*** After a card error: the next sd_mount reads the volume afresh ***/
+static void sd_unmount(void)
 {
-    FRESULT fr;
-    UINT bw;
-    uint8_t hdr[44];
-    char path[64];
-
     f_mount(NULL, DRIVE, 1);
-    fr = f_mount(&g_fs, DRIVE, 1);
-    if (fr != FR_OK) return -1;
-
-    snprintf(path, sizeof(path), "%s/%s", DRIVE, filename);
-    fr = f_open(fp, path, FA_CREATE_ALWAYS | FA_WRITE);
-    if (fr != FR_OK) return -1;
+    sd_mounted = 0;
+}
 
-    wav_header(hdr, nsamples, fs, bits, ch);
-    fr = f_write(fp, hdr, sizeof(hdr), &bw);
-    if (fr != FR_OK || bw != sizeof(hdr)) { f_close(fp); return -1; }
+/*** File names of take n (1..999) ***/
+static void take_names(int n, char *rec, char *out, size_t len)
+{
+    snprintf(rec, len, "rec_%03d.wav", n);
+    snprintf(out, len, "out_%03d.wav", n);
+}
 
-    return 0;
+#if TAKE_SLOTS
+/*** Preallocate take n's slot files unless the card already has them ***/
+static void take_slot_prepare(int n)
+{
+    static WavWriter slot;
+    char names[2][16];
+    char path[64];
+    FILINFO info;
+
+    if (sd_mount() != 0) return;
+    take_names(n, names[0], names[1], sizeof(names[0]));
+    for (int i = 0; i < 2; i++) {
+        snprintf(path, sizeof(path), "%s/%s", DRIVE, names[i]);
+        if (f_stat(path, &info) == FR_OK) continue;
+        // An empty WAV the full size of a take; the take opens it in place
+        if (wav_writer_open_slot(&slot, path, TOTAL_SAMPLES, FS, i == 0 ? REC_BITS : OUT_BITS, CHANNELS) != FR_OK ||
+            wav_writer_close(&slot) != FR_OK) {
+            DLOG_WARN("Could not preallocate %s; the take allocates it\r\n", names[i]);
+        }
+    }
 }
+#endif
 
-/*** Patch the header with the true sample count ***/
-static void sd_fix_header(FIL *fp, uint32_t nsamples, uint32_t fs,
-                          uint16_t bits, uint16_t ch)
+/*** Reset the DMA after a channel error ***/
+// The channels share one reset, so the engine on the other channel (if it
+// was running) has to be restarted as well; capture_start / playback_start
+// set everything up again
+static void dma_recover(void)
 {
-    UINT bw; uint8_t hdr[44];
-    wav_header(hdr, nsamples, fs, bits, ch);
-    f_lseek(fp, 0);
-    f_write(fp, hdr, sizeof(hdr), &bw);
+    xil_printf("Resetting DMA...\r\n");
+    XAxiDma_Reset(&AxiDma);
+    while (!XAxiDma_ResetIsDone(&AxiDma));
 }
 
-/*** Reverses the order of all the bits of an unsigned 16-bit value ***/
-uint16_t swap_bits_u16(uint16_t word) {
-	uint16_t ret = 0;
-	for (int i = 0; i < sizeof(uint16_t) * 8; i++) {
-		if ((0b1 << i) & word) {
-			ret |= 1 << (sizeof(uint16_t) * 8 - 1 - i);
-		}
-	}
-	return ret;
+#if LIVE_RETUNE
+// Tenths of a millisecond, for xil_printf
+static int live_ms10(uint32_t samples)
+{
+    return (int)(live_tune_ms(samples) * 10.0f + 0.5f);
 }
 
-/*** Detect pitch from the saved WAV file on SD card ***/
-static int detect_pitch_from_sd(const char *filename, int startSample, int numSamples, float threshold, PitchResult* result)
+static void live_report(const LiveTuneStats *st, int full)
 {
-    FRESULT fr;
-    FIL fp;
-    UINT br;
-    char path[64];
-    
-    // Initialize result
-    result->pitch = -1;
-    result->confidence = 0;
-    result->sampleRate = 0;
-    result->numSamples = 0;
-    result->bufferSize = 0;
-    result->actualStartSample = startSample;
-    
-    // Open the file from SD card
-    snprintf(path, sizeof(path), "%s/%s", DRIVE, filename);
-    
-    fr = f_open(&fp, path, FA_READ);
-    if (fr != FR_OK) {
-        xil_printf("Failed to open file for reading: %d\r\n", fr);
-        return -1;
+    int lat = live_ms10(st->latency_last);
+    if (!full) {
+        // Short enough for the UART FIFO, so it does not stall the loop
+        xil_printf("lat %d.%d ms, miss %lu, drop %lu\r\n", lat / 10, lat % 10,
+                   (unsigned long)st->deadline_misses, (unsigned long)st->dropped_samples);
+        return;
     }
-    
-    // Read WAV header (44 bytes)
-    uint8_t hdr[44];
-    fr = f_read(&fp, hdr, 44, &br);
-    if (fr != FR_OK || br != 44) {
-        xil_printf("Failed to read WAV header\r\n");
-        f_close(&fp);
-        return -1;
+    int lo = live_ms10(st->latency_min), hi = live_ms10(st->latency_max);
+    int avg_us = st->bursts ? (int)(st->sum_proc_us / st->bursts) : 0;
+    xil_printf("Live: %lu bursts (%s), latency %d.%d .. %d.%d ms (%lu over budget)\r\n",
+               (unsigned long)st->bursts, shift_engine_name(st->engine), lo / 10, lo % 10, hi / 10, hi % 10,
+               (unsigned long)st->over_budget);
+    xil_printf("      processing avg %d us, max %lu us of %d us, %lu deadline misses\r\n",
+               avg_us, (unsigned long)st->max_proc_us, (int)(BURST_SAMPLES * 1000000LL / FS),
+               (unsigned long)st->deadline_misses);
+    xil_printf("      %lu underruns, ~%lu samples lost, %lu dropped, %lu retunes\r\n",
+               (unsigned long)st->underruns, (unsigned long)st->lost_samples,
+               (unsigned long)st->dropped_samples, (unsigned long)st->retunes);
+    if (st->pv_pitch_bursts) {
+        xil_printf("      %lu bursts pitched from the vocoder's analysis\r\n",
+                   (unsigned long)st->pv_pitch_bursts);
     }
-    
-    // Extract sample rate from header
-    result->sampleRate = hdr[24] | (hdr[25] << 8) | (hdr[26] << 16) | (hdr[27] << 24);
-    xil_printf("Sample rate: %d Hz\r\n", result->sampleRate);
-    
-    // Auto-determine optimal buffer size if numSamples is 0
-    if (numSamples == 0) {
-        numSamples = 2048;  // Default buffer size
-    }
-    
-    result->numSamples = numSamples;
-    result->bufferSize = numSamples;
-    
-    // Allocate audio buffer
-    int16_t* audioBuffer = (int16_t*)malloc(numSamples * sizeof(int16_t));
-    if (!audioBuffer) {
-        xil_printf("Memory allocation failed\r\n");
-        f_close(&fp);
-        return -1;
-    }
-    
-    // Seek to start position (skip header + startSample * 2 bytes)
-    f_lseek(&fp, 44 + (startSample * sizeof(int16_t)));
-    
-    // Read audio data into buffer
-    fr = f_read(&fp, audioBuffer, numSamples * sizeof(int16_t), &br);
-    if (fr != FR_OK) {
-        xil_printf("Failed to read audio data\r\n");
-        free(audioBuffer);
-        f_close(&fp);
-        return -1;
+}
+
+/*** Live retune mode: runs until the board is reset ***/
+static int live_retune_mode(void)
+{
+    LiveTuneConfig cfg;
+    live_tune_default_config(&cfg);
+
+    // Automatic selection is shown against the vocoder, the engine with the shorter delay
+    ShiftEngineConfig shift_cfg;
+    shift_engine_default_config(&shift_cfg);
+    shift_cfg.fft_size = cfg.fft_size;
+    shift_cfg.hop = cfg.hop;
+    shift_cfg.max_period = cfg.window / 2;
+    shift_cfg.external_pitch = 1;
+    ShiftEngineId engine = cfg.engine == SHIFT_ENGINE_PSOLA ? SHIFT_ENGINE_PSOLA : SHIFT_ENGINE_PV;
+    int delay = shift_engine_latency_of(engine, &shift_cfg);
+    int fixed = live_ms10(CAPTURE_SEG_SAMPLES + delay + cfg.preroll);
+    xil_printf("\r\n=== Live retune: %s, FFT %d, hop %d ===\r\n", shift_engine_name(cfg.engine),
+               cfg.fft_size, cfg.hop);
+    xil_printf("Fixed latency %d.%d ms (capture %d + %s %d + queue %d samples), budget ",
+               fixed / 10, fixed % 10, CAPTURE_SEG_SAMPLES, shift_engine_name(engine), delay, cfg.preroll);
+    print_float(cfg.budget_ms);
+    xil_printf(" ms\r\n");
+    if (live_tune_ms(CAPTURE_SEG_SAMPLES + delay + cfg.preroll) > cfg.budget_ms) {
+        xil_printf("Warning: the config cannot meet the budget\r\n");
     }
-    
-    f_close(&fp);
-    
-    xil_printf("Read %u samples, analyzing pitch...\r\n", br / sizeof(int16_t));
-    
-    // Debug: Check audio data
-    int samples_read = br / sizeof(int16_t);
-    if (samples_read != numSamples) {
-        xil_printf("WARNING: Expected %d samples, got %d\r\n", numSamples, samples_read);
+    xil_printf("Press SW1 to start / stop.\r\n");
+
+    int running = 0;
+    uint32_t next_report = 0;
+    const uint32_t report_bursts = LIVE_REPORT_SECONDS * FS / BURST_SAMPLES;
+
+    while (1) {
+        int pressed = status_pressed();
+
+        if (pressed && !running) {
+            if (live_tune_start(&AxiDma, &cfg) != 0) {
+                xil_printf("Live start failed.\r\n");
+                dma_recover();
+                continue;
+            }
+            status_set_led(STATUS_LED_ON);
+            running = 1;
+            next_report = report_bursts;
+        } else if (pressed && running) {
+            status_set_led(STATUS_LED_OFF);
+            running = 0;
+            if (live_tune_stop() != 0) dma_recover();
+            LiveTuneStats st;
+            live_tune_get_stats(&st);
+            live_report(&st, 1);
+        }
+        if (!running) continue;
+
+        int r = live_tune_step();
+        if (r < 0) {
+            xil_printf("Live DMA error; stopped\r\n");
+            status_set_led(STATUS_LED_OFF);
+            running = 0;
+            live_tune_stop();
+            dma_recover();
+            continue;
+        }
+        LiveTuneStats st;
+        live_tune_get_stats(&st);
+        if (r > 0 && st.bursts >= next_report) {
+            next_report += report_bursts;
+            live_report(&st, 0);
+        }
     }
-    
+    return 0;
+}
+#endif
+
+#if !TAKE_IN_DDR
+/*** Mount SD1 and create a preallocated WAV for up to nsamples samples ***/
+static int sd_open_wav(WavWriter *w, const char *filename,
+                       uint32_t nsamples, uint32_t fs,
+                       uint16_t bits, uint16_t ch)
+{
+    FRESULT fr;
+    char path[64];
+
+    if (sd_mount() != 0) return -1;
+
+    snprintf(path, sizeof(path), "%s/%s", DRIVE, filename);
+#if TAKE_SLOTS
+    fr = wav_writer_open_slot(w, path, nsamples, fs, bits, ch);
+#else
+    fr = wav_writer_open(w, path, nsamples, fs, bits, ch);
+#endif
+    if (fr != FR_OK) return -1;
+    if (!w->contiguous && !w->in_place) xil_printf("Note: %s is not contiguous on the card\r\n", filename);
+
+    return 0;
+}
+#endif
+
+/*** Detect pitch from the saved WAV file on SD card ***/
+// Yin over one window already in memory (the analysis half of detect_pitch_from_sd)
+static int detect_pitch_in_pcm(int16_t *audioBuffer, int samples_read, int numSamples,
+                               float threshold, PitchResult* result)
+{
     // Debug: Check audio levels
     int16_t min_val = 32767, max_val = -32768;
     int zero_count = 0;
@@ -320,57 +531,46 @@ static int detect_pitch_from_sd(const char *filename, int startSample, int numSa
         if (audioBuffer[i] == 0) zero_count++;
     }
     
-    xil_printf("Audio range: %d to %d (zeros: %d/%d)\r\n", 
+    DLOG_INFO("Audio range: %d to %d (zeros: %d/%d)\r\n", 
                min_val, max_val, zero_count, samples_read);
     
     if (max_val - min_val < 100) {
-        xil_printf("WARNING: Very low audio signal amplitude!\r\n");
+        DLOG_WARN("WARNING: Very low audio signal amplitude!\r\n");
     }
     if (zero_count > samples_read / 2) {
-        xil_printf("WARNING: More than 50%% silence detected!\r\n");
+        DLOG_WARN("WARNING: More than 50%% silence detected!\r\n");
     }
     
     // Initialize Yin for pitch detection
-    xil_printf("Initializing Yin algorithm...\r\n");
-    xil_printf("  Buffer size: %d samples\r\n", numSamples);
-//    xil_printf("  Threshold: %.3f\r\n", threshold);
-    xil_printf("  Threshold: ");
-    print_float(threshold);
-    xil_printf("\r\n  Sample rate: %d Hz\r\n", result->sampleRate);
+    DLOG_INFO("Initializing Yin algorithm...\r\n");
+    DLOG_INFO("  Buffer size: %d samples\r\n", numSamples);
+    DLOG_INFO("  Threshold: %.3f\r\n", threshold);
+    DLOG_INFO("  Sample rate: %d Hz\r\n", result->sampleRate);
     Yin yin;
     Yin_init(&yin, numSamples, threshold);
-    xil_printf("Yin initialized, detecting pitch...\r\n");
+    // Only search the range the note lookup accepts, decimated first then refined
+    Yin_setRange(&yin, 20.0f, 4200.0f);
+    Yin_setCoarseToFine(&yin, 1);
+    DLOG_INFO("Yin initialized, detecting pitch...\r\n");
     
     // Detect pitch
     float pitch = Yin_getPitch(&yin, audioBuffer);
     float confidence = Yin_getProbability(&yin);
     
-    xil_printf("Pitch detection complete:\r\n");
-//    xil_printf("  Raw pitch: %.2f Hz\r\n", pitch);
-//    xil_printf("  Confidence: %.3f (%.1f%%)\r\n", confidence, confidence * 100.0f);
-//    xil_printf("  Threshold: %.3f\r\n", threshold);
-    xil_printf("  Raw pitch: ");
-    print_float(pitch);
-	xil_printf(" Hz\r\n  Confidence: ");
-	print_float(confidence * 100.0f);
-	xil_printf("%%\r\n  Threshold: ");
-	print_float(threshold);
-	xil_printf("\r\n");
+    DLOG_INFO("Pitch detection complete:\r\n");
+    DLOG_INFO("  Raw pitch: %.2f Hz\r\n", pitch);
+    DLOG_INFO("  Confidence: %.3f (%.1f%%)\r\n", confidence, confidence * 100.0f);
+    DLOG_INFO("  Threshold: %.3f\r\n", threshold);
     
     // Debug: Check if pitch is valid
     if (pitch <= 0) {
-        xil_printf("DEBUG: No valid pitch detected\r\n");
+        DLOG_DEBUG("DEBUG: No valid pitch detected\r\n");
         if (confidence < threshold) {
-            xil_printf("DEBUG: Confidence ");
-            print_float(confidence);
-            xil_printf(" below threshold ");
-            print_float(threshold);
-            xil_printf("\r\nDEBUG: Try lowering threshold or using different audio section\r\n");
+            DLOG_DEBUG("DEBUG: Confidence %.3f below threshold %.3f\r\n", confidence, threshold);
+            DLOG_DEBUG("DEBUG: Try lowering threshold or using different audio section\r\n");
         }
     } else {
-        xil_printf("DEBUG: Valid pitch detected: ");
-        print_float(pitch);
-        xil_printf(" Hz\r\n");
+        DLOG_DEBUG("DEBUG: Valid pitch detected: %.3f Hz\r\n", pitch);
     }
     
     result->pitch = pitch;
@@ -378,229 +578,936 @@ static int detect_pitch_from_sd(const char *filename, int startSample, int numSa
     
     // If no pitch detected, try with more lenient threshold
     if (pitch <= 0 && threshold > 0.05f) {
-        xil_printf("\r\nDEBUG: Retrying with lower threshold...\r\n");
+        DLOG_DEBUG("\r\nDEBUG: Retrying with lower threshold...\r\n");
         float new_threshold = threshold * 0.5f;  // Half the threshold
         
-        // Re-initialize Yin with new threshold
-        free(yin.yinBuffer);
-        Yin_init(&yin, numSamples, new_threshold);
-        
-        pitch = Yin_getPitch(&yin, audioBuffer);
+        // Steps 1-2 are already in yinBuffer; only the threshold search is re-run
+        pitch = Yin_rethreshold(&yin, new_threshold);
         confidence = Yin_getProbability(&yin);
         
-        xil_printf("Retry results:\r\n");
-//        xil_printf("  Pitch: %.2f Hz\r\n", pitch);
-//        xil_printf("  Confidence: %.3f (%.1f%%)\r\n", confidence, confidence * 100.0f);
-//        xil_printf("  New threshold: %.3f\r\n", new_threshold);
-        xil_printf("  Pitch: ");
-		print_float(pitch);
-		xil_printf(" Hz\r\n  Confidence: ");
-		print_float(confidence * 100.0f);
-		xil_printf("%%\r\n  Threshold: ");
-		print_float(threshold);
-		xil_printf("\r\n");
+        DLOG_INFO("Retry results:\r\n");
+        DLOG_INFO("  Pitch: %.2f Hz\r\n", pitch);
+        DLOG_INFO("  Confidence: %.3f (%.1f%%)\r\n", confidence, confidence * 100.0f);
+        DLOG_INFO("  New threshold: %.3f\r\n", new_threshold);
         
         if (pitch > 0) {
             result->pitch = pitch;
             result->confidence = confidence;
-            xil_printf("DEBUG: Success with lower threshold!\r\n");
+            DLOG_DEBUG("DEBUG: Success with lower threshold!\r\n");
         }
     }
     
     // Cleanup
-    xil_printf("Cleaning up...\r\n");
-    free(yin.yinBuffer);
-    free(audioBuffer);
+    DLOG_INFO("Cleaning up...\r\n");
+    Yin_free(&yin);
     
     return 0;
 }
 
-/*** Load WAV file from SD card using FatFs ***/
-static AudioBuffer* load_wav_from_sd(const char *filename)
+
+#if TAKE_IN_DDR
+// Same window as detect_pitch_from_sd, straight from the take in DDR
+static int detect_pitch_from_take(int startSample, int numSamples, float threshold, PitchResult* result)
+{
+    result->pitch = -1;
+    result->confidence = 0;
+    result->sampleRate = FS;
+    result->numSamples = numSamples;
+    result->bufferSize = numSamples;
+    result->actualStartSample = startSample;
+
+    if (startSample < 0 || (uint32_t)(startSample + numSamples) > take_samples) {
+        DLOG_INFO("Take too short for the pitch window\r\n");
+        return -1;
+    }
+    return detect_pitch_in_pcm(take_rec + startSample, numSamples, numSamples, threshold, result);
+}
+#else
+static int detect_pitch_from_sd(const char *filename, int startSample, int numSamples, float threshold, PitchResult* result)
 {
     FRESULT fr;
-    FIL fp;
-    UINT br;
+    WavReader wav;
+    uint32_t got;
     char path[64];
-    uint8_t hdr[44];
     
-    xil_printf("Loading WAV file: %s\r\n", filename);
+    // Initialize result
+    result->pitch = -1;
+    result->confidence = 0;
+    result->sampleRate = 0;
+    result->numSamples = 0;
+    result->bufferSize = 0;
+    result->actualStartSample = startSample;
     
-    // Open file
+    // Open the file from SD card
     snprintf(path, sizeof(path), "%s/%s", DRIVE, filename);
-    fr = f_open(&fp, path, FA_READ);
+    
+    fr = wav_reader_open(&wav, path);
     if (fr != FR_OK) {
-        xil_printf("Failed to open WAV file: %d\r\n", fr);
-        return NULL;
+        DLOG_ERROR("Failed to open WAV for reading: %d\r\n", fr);
+        return -1;
     }
     
-    // Read WAV header
-    fr = f_read(&fp, hdr, 44, &br);
-    if (fr != FR_OK || br != 44) {
-        xil_printf("Failed to read WAV header\r\n");
-        f_close(&fp);
-        return NULL;
-    }
+    result->sampleRate = wav.fs;
+    DLOG_INFO("Sample rate: %d Hz\r\n", result->sampleRate);
     
-    // Verify WAV format
-    if (hdr[0] != 'R' || hdr[1] != 'I' || hdr[2] != 'F' || hdr[3] != 'F' ||
-        hdr[8] != 'W' || hdr[9] != 'A' || hdr[10] != 'V' || hdr[11] != 'E') {
-        xil_printf("Not a valid WAV file\r\n");
-        f_close(&fp);
-        return NULL;
+    // Auto-determine optimal buffer size if numSamples is 0
+    if (numSamples == 0) {
+        numSamples = 2048;  // Default buffer size
     }
     
-    // Extract audio parameters
-    uint32_t sample_rate = hdr[24] | (hdr[25] << 8) | (hdr[26] << 16) | (hdr[27] << 24);
-    uint16_t bits_per_sample = hdr[34] | (hdr[35] << 8);
-    uint32_t data_size = hdr[40] | (hdr[41] << 8) | (hdr[42] << 16) | (hdr[43] << 24);
+    result->numSamples = numSamples;
+    result->bufferSize = numSamples;
     
-    if (bits_per_sample != 16) {
-        xil_printf("Only 16-bit audio supported\r\n");
-        f_close(&fp);
-        return NULL;
+    // Allocate audio buffer
+    int16_t* audioBuffer = (int16_t*)arena_malloc(numSamples * sizeof(int16_t));
+    if (!audioBuffer) {
+        DLOG_ERROR("Memory allocation failed\r\n");
+        wav_reader_close(&wav);
+        return -1;
     }
     
-    uint32_t num_samples = data_size / 2;  // 16-bit samples
+    // Straight to the window (fast seek when the BSP has it)
+    fr = wav_reader_seek(&wav, (uint32_t)startSample);
+    if (fr == FR_OK) fr = wav_reader_read(&wav, audioBuffer, (uint32_t)numSamples, &got);
+    wav_reader_close(&wav);
+    if (fr != FR_OK) {
+        DLOG_ERROR("Failed to read audio data\r\n");
+        arena_free(audioBuffer);
+        return -1;
+    }
     
-    xil_printf("WAV info: %lu samples, %lu Hz, 16-bit\r\n", 
-               (unsigned long)num_samples, (unsigned long)sample_rate);
+    DLOG_INFO("Read %u samples, analyzing pitch...\r\n", (unsigned)got);
     
-    // Allocate AudioBuffer
-    AudioBuffer* audio = (AudioBuffer*)malloc(sizeof(AudioBuffer));
-    if (!audio) {
-        xil_printf("Failed to allocate AudioBuffer\r\n");
-        f_close(&fp);
-        return NULL;
+    // Debug: Check audio data
+    int samples_read = (int)got;
+    if (samples_read != numSamples) {
+        DLOG_WARN("WARNING: Expected %d samples, got %d\r\n", numSamples, samples_read);
     }
     
-    audio->data = (float*)malloc(num_samples * sizeof(float));
-    if (!audio->data) {
-        xil_printf("Failed to allocate audio data\r\n");
-        free(audio);
-        f_close(&fp);
+    int ret = detect_pitch_in_pcm(audioBuffer, samples_read, numSamples, threshold, result);
+    arena_free(audioBuffer);
+    return ret;
+}
+
+#endif
+
+/*** Pitch statistics over a grid of windows of a WAV file on SD card ***/
+// One sequential pass through wav_pitch_detection: each block read is
+// analysed and measured at once, and the read stops after the last window.
+static int analyse_wav_from_sd(const char *filename, int firstSample, int numSamples, int hop,
+                               int maxWindows, float threshold, YinSummary *summary)
+{
+    WavAnalysisConfig cfg;
+    WavStats stats;
+    char path[64];
+
+    snprintf(path, sizeof(path), "%s/%s", DRIVE, filename);
+    wavAnalysisDefaultConfig(&cfg);
+    cfg.windowSize = numSamples;
+    cfg.hop = hop;
+    cfg.firstSample = firstSample;
+    cfg.maxWindows = maxWindows;
+    cfg.threshold = threshold;
+    cfg.maxSamples = (uint32_t)firstSample + (uint32_t)hop * (maxWindows - 1) + (uint32_t)numSamples;
+    if (analyseWav(path, &cfg, &stats) != 0) {
+        DLOG_ERROR("Failed to analyse %s\r\n", path);
+        return -1;
+    }
+    *summary = stats.pitch;
+
+    DLOG_INFO("Read %u of %u samples: peak %d, RMS %.4f, DC %.4f, %u clipped\r\n",
+               (unsigned)stats.samples, (unsigned)stats.frames, (int)stats.peak,
+               stats.rms, stats.dcOffset, (unsigned)stats.clipped);
+    DLOG_INFO("Analysed %d windows, %d voiced (%d%%)\r\n", summary->windows, summary->voiced,
+               (int)(summary->voicedRatio * 100.0f));
+    DLOG_INFO("  Median pitch:    %.3f Hz\r\n", summary->medianPitch);
+    DLOG_INFO("  Histogram pitch: %.3f Hz\r\n", summary->histogramPitch);
+    return 0;
+}
+
+#if CAPTURE_PITCH
+#if YIN_PL && CAPTURE_PL_DECIMATE
+#error "YIN_PL tracks the full-rate stream; build it without CAPTURE_PL_DECIMATE"
+#endif
+#if YIN_PL
+static YinPL capture_tracker;
+#else
+static YinTracker capture_tracker;
+#endif
+static YinAnalysis capture_stats;      // Per-burst pitches of the current take
+static int capture_pitch_ready;        // Tracker and statistics set up for this take
+static uint32_t capture_pitch_stride;  // Bursts per recorded pitch (1 unless the take is long)
+static uint32_t capture_pitch_bursts;  // Bursts seen this take
+#if TAKE_CONTOUR
+static AutotuneContour take_contour;   // Every recorded burst's pitch, in order
+#endif
+
+static int capture_tracker_ok;
+#endif
+
+#if TAKE_VAD
+static Vad take_vad;                   // Voiced regions of the current take
+#endif
+
+#if CAPTURE_PITCH
+
+// Set up the tracker once at boot, on the heap: it outlives every take's arena
+static void capture_pitch_setup(void)
+{
+#if YIN_PL
+    capture_tracker_ok = YinPL_init(&capture_tracker, PITCH_WINDOW, BURST_SAMPLES, PITCH_THRESHOLD) == 0;
+    if (!capture_tracker_ok) xil_printf("yin_diff engine not found; no capture pitch\r\n");
+#elif CAPTURE_PL_DECIMATE
+    capture_tracker_ok = YinTracker_init(&capture_tracker, PITCH_WINDOW / CAPTURE_DECIMATION, PITCH_THRESHOLD) == 0;
+    if (capture_tracker_ok) Yin_setSampleRate(&capture_tracker.yin, CAPTURE_AN_FS);
+#else
+    capture_tracker_ok = YinTracker_init(&capture_tracker, PITCH_WINDOW, PITCH_THRESHOLD) == 0;
+#endif
+    if (capture_tracker_ok) Yin_setRange(&capture_tracker.yin, 20.0f, 4200.0f);
+}
+
+// Clear the tracker and allocate the statistics for a new take
+static void capture_pitch_begin(void)
+{
+    uint32_t bursts = TOTAL_SAMPLES / BURST_SAMPLES + 1;
+    capture_pitch_stride = (bursts + PITCH_MAX_WINDOWS - 1) / PITCH_MAX_WINDOWS;
+    capture_pitch_bursts = 0;
+    YinAnalysis_free(&capture_stats);
+    capture_pitch_ready = capture_tracker_ok &&
+        YinAnalysis_initStatistics(&capture_stats, (int)(bursts / capture_pitch_stride + 1)) == 0;
+#if TAKE_CONTOUR
+    // Point k is the window ending with burst k * stride; a failed allocation just means one ratio
+    autotune_contour_free(&take_contour);
+    if (capture_pitch_ready) {
+        autotune_contour_init(&take_contour, (int)(bursts / capture_pitch_stride + 1),
+                              (int)(capture_pitch_stride * BURST_SAMPLES), BURST_SAMPLES - PITCH_WINDOW / 2);
+    }
+#endif
+#if YIN_PL
+    if (capture_pitch_ready) YinPL_reset(&capture_tracker);
+#else
+    if (capture_pitch_ready) YinTracker_reset(&capture_tracker);
+#endif
+}
+
+// One burst: slide the window and record the newest window's pitch
+static void capture_pitch_burst(const int16_t *pcm, uint32_t n, uint32_t end_sample)
+{
+    if (!capture_pitch_ready) return;
+#if YIN_PL
+    // The fabric has already seen these samples on the stream; take its latest frame
+    float pitch;
+    (void)pcm;
+    (void)n;
+    if (!YinPL_poll(&capture_tracker, &pitch)) return;
+    if (capture_pitch_bursts++ % capture_pitch_stride) return;
+#if TAKE_CONTOUR
+    autotune_contour_add(&take_contour, pitch, YinPL_getProbability(&capture_tracker));
+#endif
+    if (end_sample >= PITCH_START_SAMPLE + PITCH_WINDOW) {
+        YinAnalysis_record(&capture_stats, pitch, YinPL_getProbability(&capture_tracker));
+    }
+#elif CAPTURE_PL_DECIMATE
+    // The analysis bursts arrive on their own DMA, in step with the capture bursts
+    // give or take a segment; each one ends where capture burst capture_pitch_bursts does
+    const int16_t *an;
+    (void)pcm;
+    (void)n;
+    (void)end_sample;
+    while (capture_next_analysis(&an) > 0) {
+        float pitch = YinTracker_push(&capture_tracker, an, CAPTURE_AN_BURST_SAMPLES);
+        capture_release_analysis();
+        uint32_t an_end = (capture_pitch_bursts + 1) * BURST_SAMPLES;
+        if (capture_pitch_bursts++ % capture_pitch_stride) continue;
+#if TAKE_CONTOUR
+        autotune_contour_add(&take_contour, pitch, YinTracker_getProbability(&capture_tracker));
+#endif
+        if (an_end >= PITCH_START_SAMPLE + PITCH_WINDOW) {
+            YinAnalysis_record(&capture_stats, pitch, YinTracker_getProbability(&capture_tracker));
+        }
+    }
+#else
+    float pitch = YinTracker_push(&capture_tracker, pcm, (int)n);
+    if (capture_pitch_bursts++ % capture_pitch_stride) return;
+#if TAKE_CONTOUR
+    autotune_contour_add(&take_contour, pitch, YinTracker_getProbability(&capture_tracker));
+#endif
+    if (end_sample >= PITCH_START_SAMPLE + PITCH_WINDOW) {
+        YinAnalysis_record(&capture_stats, pitch, YinTracker_getProbability(&capture_tracker));
+    }
+#endif
+}
+
+#if TAKE_CONTOUR
+// Ratio curve for the take (one entry per vocoder frame, flush included),
+// moving the contour to target; NULL if nothing in the take is voiced
+static float *take_ratio_curve(float target, float anchor, int *frames)
+{
+    if (!capture_pitch_ready || take_contour.count == 0 || target <= 0.0f) {
         return NULL;
     }
-    
-    audio->length = num_samples;
-    audio->sample_rate = sample_rate;
-    
-    // Read audio data in chunks and convert to float
-    #define LOAD_CHUNK_SIZE 1024
-    int16_t chunk_buffer[LOAD_CHUNK_SIZE];
-    uint32_t samples_read = 0;
-    
-    while (samples_read < num_samples) {
-        uint32_t samples_to_read = num_samples - samples_read;
-        if (samples_to_read > LOAD_CHUNK_SIZE) {
-            samples_to_read = LOAD_CHUNK_SIZE;
+    AutotuneConfig cfg;
+    autotune_default_config(&cfg);
+    cfg.target = target;
+    cfg.anchor = anchor;
+
+    int n = (int)(((int64_t)take_contour.count * take_contour.step) / PV_DEFAULT_HOP) +
+            PV_DEFAULT_FFT_SIZE / PV_DEFAULT_HOP + 2;
+    float *curve = (float *)arena_malloc(n * sizeof(float));
+    if (!curve) {
+        return NULL;
+    }
+    int voiced = autotune_curve(&take_contour, &cfg, PV_DEFAULT_HOP, PV_DEFAULT_FFT_SIZE, curve, n);
+    DLOG_INFO("Ratio curve: %d frames, %d voiced\r\n", n, voiced);
+    if (voiced == 0) {
+        arena_free(curve);
+        return NULL;
+    }
+    *frames = n;
+    return curve;
+}
+#endif
+#endif
+
+/*** Reference pitch cache ***/
+// The analysed reference is kept in DDR and in a sidecar file next to it, keyed
+// by the file's size, FAT timestamp and a hash of its header and first samples.
+// A matching key skips the analysis; any change to the file invalidates it.
+#define REF_CACHE_FILE   "target.pit"
+#define REF_CACHE_MAGIC  0x50465452u   // "RTFP"
+#define REF_HASH_BYTES   4096          // Header + first ~2000 samples
+
+typedef struct {
+    uint32_t size;             // File size in bytes
+    uint16_t fdate;            // FAT modification date
+    uint16_t ftime;            // FAT modification time
+    uint32_t hash;             // FNV-1a of the first REF_HASH_BYTES bytes
+} RefFileKey;
+
+typedef struct {
+    uint32_t magic;            // REF_CACHE_MAGIC
+    RefFileKey key;            // File the result belongs to
+    float pitch;               // Reference pitch in Hz
+    float confidence;          // Its confidence (0.0 to 1.0)
+    int32_t note_class;        // Note class 0-11 (C .. B)
+    uint32_t check;            // FNV-1a of everything above
+} RefPitchCache;
+
+static RefPitchCache g_ref_cache;      // DDR copy, valid while magic is set
+
+static uint32_t fnv1a(const void *data, uint32_t n, uint32_t h)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    for (uint32_t i = 0; i < n; i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+static uint32_t ref_cache_check(const RefPitchCache *c)
+{
+    return fnv1a(c, offsetof(RefPitchCache, check), 2166136261u);
+}
+
+// Size and timestamp come from the directory entry; only the hash needs a read
+static int ref_file_key(const char *filename, RefFileKey *key)
+{
+    FILINFO info;
+    FIL fp;
+    UINT br;
+    char path[64];
+    uint8_t head[512];
+
+    snprintf(path, sizeof(path), "%s/%s", DRIVE, filename);
+    if (f_stat(path, &info) != FR_OK) return -1;
+    if (f_open(&fp, path, FA_READ) != FR_OK) return -1;
+
+    key->size = (uint32_t)info.fsize;
+    key->fdate = info.fdate;
+    key->ftime = info.ftime;
+    key->hash = 2166136261u;
+    for (uint32_t done = 0; done < REF_HASH_BYTES; done += br) {
+        if (f_read(&fp, head, sizeof(head), &br) != FR_OK || br == 0) break;
+        key->hash = fnv1a(head, br, key->hash);
+    }
+    f_close(&fp);
+    return 0;
+}
+
+static int ref_key_equal(const RefFileKey *a, const RefFileKey *b)
+{
+    return a->size == b->size && a->fdate == b->fdate && a->ftime == b->ftime && a->hash == b->hash;
+}
+
+// DDR copy first, then the sidecar; returns 1 on a hit
+static int ref_cache_lookup(const char *filename, RefPitchCache *out)
+{
+    RefFileKey key;
+    if (ref_file_key(filename, &key) != 0) return 0;
+
+    if (g_ref_cache.magic == REF_CACHE_MAGIC && ref_key_equal(&g_ref_cache.key, &key)) {
+        *out = g_ref_cache;
+        return 1;
+    }
+
+    FIL fp;
+    UINT br;
+    char path[64];
+    RefPitchCache c;
+    snprintf(path, sizeof(path), "%s/%s", DRIVE, REF_CACHE_FILE);
+    if (f_open(&fp, path, FA_READ) != FR_OK) return 0;
+    FRESULT fr = f_read(&fp, &c, sizeof(c), &br);
+    f_close(&fp);
+
+    if (fr != FR_OK || br != sizeof(c) || c.magic != REF_CACHE_MAGIC ||
+        c.check != ref_cache_check(&c) || !ref_key_equal(&c.key, &key)) {
+        return 0;
+    }
+    g_ref_cache = c;
+    *out = c;
+    return 1;
+}
+
+static void ref_cache_store(const char *filename, float pitch, float confidence, int note_class)
+{
+    RefPitchCache c;
+    memset(&c, 0, sizeof(c));
+    if (ref_file_key(filename, &c.key) != 0) return;
+
+    c.magic = REF_CACHE_MAGIC;
+    c.pitch = pitch;
+    c.confidence = confidence;
+    c.note_class = note_class;
+    c.check = ref_cache_check(&c);
+    g_ref_cache = c;
+
+    // The sidecar is only a shortcut; a failed write just means re-analysis after reboot
+    FIL fp;
+    UINT bw;
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%s", DRIVE, REF_CACHE_FILE);
+    if (f_open(&fp, path, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+        DLOG_WARN("WARNING: could not write %s\r\n", REF_CACHE_FILE);
+        return;
+    }
+    f_write(&fp, &c, sizeof(c), &bw);
+    f_close(&fp);
+}
+
+/*** Pitch-shift a WAV file on SD card into a new WAV file ***/
+// The vocoder runs in streaming mode: the input is read, shifted and written
+// one chunk at a time, so heap use is fixed no matter how long the take is.
+//
+// The engine comes from shift_engine_select: PSOLA (psola.c) for a take
+// that is mostly voiced and not lowered far, the vocoder otherwise. Build
+// with -DSHIFT_ENGINE=SHIFT_ENGINE_PV (or _PSOLA) to force one.
+#ifndef SHIFT_ENGINE
+#define SHIFT_ENGINE            SHIFT_ENGINE_AUTO
+#endif
+
+#define SHIFT_CHUNK_SIZE 1024
+#if !TAKE_IN_DDR
+static int16_t shift_pcm_in[SHIFT_CHUNK_SIZE];
+#endif
+static int16_t shift_pcm_out[SHIFT_CHUNK_SIZE + SHIFT_ENGINE_FLUSH_ROOM];
+
+// Report how hard the output limiter worked on a take
+static void shift_log_limiter(const ShiftEngine *eng)
+{
+    LimiterStats ls;
+    shift_engine_limiter_stats(eng, &ls);
+    if (ls.min_gain < 1.0f) {
+        DLOG_INFO("Limiter: gain down to %d%%, %lu samples clamped\r\n",
+                  (int)(ls.min_gain * 100.0f), (unsigned long)ls.clamped);
+    }
+}
+
+#if TAKE_IN_DDR
+// A take being shifted in memory, one chunk per take_shift_step, so a
+// render can run a piece at a time between other work; out has the same
+// length as in
+typedef struct {
+    ShiftEngine eng;
+    const int16_t *in;
+    int16_t *out;
+    uint32_t num_samples;
+    uint32_t samples_read;
+    uint32_t samples_written;
+    int skip;                       // Latency outputs still to drop
+    const float *curve;             // Ratio per PV_DEFAULT_HOP of input the job sets itself, or NULL
+    int curve_frames;
+    const AutotuneContour *contour; // Pitch passed to an external_pitch engine, or NULL
+} TakeShift;
+
+static int take_shift_open(TakeShift *job, const int16_t *in, uint32_t num_samples, int16_t *out,
+                           float ratio, ShiftEngineId engine, const ShiftEngineConfig *cfg,
+                           const float *curve, int curve_frames)
+{
+    memset(job, 0, sizeof(*job));
+    if (shift_engine_open(&job->eng, engine, cfg, ratio) != 0) {
+        DLOG_ERROR("Failed to create pitch shifter\r\n");
+        return -1;
+    }
+    if (curve && shift_engine_set_ratio_curve(&job->eng, curve, curve_frames) != 0) {
+        // Follow it a chunk at a time instead
+        job->curve = curve;
+        job->curve_frames = curve_frames;
+    }
+    job->in = in;
+    job->out = out;
+    job->num_samples = num_samples;
+    // The first latency outputs precede the first input sample
+    job->skip = shift_engine_latency(&job->eng);
+    return 0;
+}
+
+// Shift the next chunk; 1 once the whole take is in out
+static int take_shift_step(TakeShift *job)
+{
+    const uint32_t num_samples = job->num_samples;
+    int16_t *out = job->out;
+    int produced;
+    int16_t *dst = shift_pcm_out;
+
+    if (job->samples_written >= num_samples) return 1;
+
+    if (job->samples_read < num_samples) {
+        uint32_t n = num_samples - job->samples_read;
+        if (n > SHIFT_CHUNK_SIZE) n = SHIFT_CHUNK_SIZE;
+        uint32_t mid = job->samples_read + n / 2;
+        if (job->curve) {
+            int k = (int)(mid / PV_DEFAULT_HOP);
+            shift_engine_set_ratio(&job->eng, job->curve[k < job->curve_frames ? k : job->curve_frames - 1]);
         }
-        
-        fr = f_read(&fp, chunk_buffer, samples_to_read * sizeof(int16_t), &br);
-        if (fr != FR_OK) {
-            xil_printf("Failed to read audio data\r\n");
-            free(audio->data);
-            free(audio);
-            f_close(&fp);
-            return NULL;
+        if (job->contour && job->contour->count > 0) {
+            const AutotuneContour *c = job->contour;
+            int k = mid > (uint32_t)c->first ? (int)((mid - c->first) / c->step) : 0;
+            if (k >= c->count) k = c->count - 1;
+            shift_engine_set_pitch(&job->eng, c->probability[k] >= AUTOTUNE_MIN_PROB ? c->pitch[k] : 0.0f);
         }
-        
-        // Convert int16 to float
-        for (uint32_t i = 0; i < br / sizeof(int16_t); i++) {
-            audio->data[samples_read + i] = (float)chunk_buffer[i] / 32768.0f;
+        // Past the latency, and with room for a whole call's output, the
+        // shifter writes straight into the take (no staging copy)
+        if (job->skip == 0 && num_samples - job->samples_written >= n + shift_engine_overrun(&job->eng)) {
+            dst = out + job->samples_written;
+        }
+        produced = shift_engine_process(&job->eng, job->in + job->samples_read, (int)n, dst);
+        job->samples_read += n;
+    } else {
+        produced = shift_engine_flush(&job->eng, shift_pcm_out);
+        if (produced == 0) {
+            // Nothing more will come; the rest of the take is silence
+            memset(out + job->samples_written, 0, (num_samples - job->samples_written) * sizeof(int16_t));
+            job->samples_written = num_samples;
+            return 1;
         }
-        
-        samples_read += br / sizeof(int16_t);
     }
-    
-    f_close(&fp);
-    xil_printf("Successfully loaded %lu samples\r\n", (unsigned long)samples_read);
-    
-    return audio;
+
+    // Drop the latency and anything past the input length
+    int first = 0;
+    if (job->skip > 0) {
+        first = job->skip < produced ? job->skip : produced;
+        job->skip -= first;
+    }
+
+    int count = produced - first;
+    if (count > (int)(num_samples - job->samples_written)) {
+        count = num_samples - job->samples_written;
+    }
+    if (count > 0) {
+        if (dst != out + job->samples_written) {
+            memcpy(out + job->samples_written, dst + first, count * sizeof(int16_t));
+        }
+        job->samples_written += count;
+    }
+    return job->samples_written >= num_samples;
+}
+
+static void take_shift_close(TakeShift *job)
+{
+    shift_log_limiter(&job->eng);
+    shift_engine_close(&job->eng);
+}
+
+// Shift a take held in memory in one go
+static int shift_take(const int16_t *in, uint32_t num_samples, int16_t *out, float ratio,
+                      ShiftEngineId engine, const float *curve, int curve_frames)
+{
+    ShiftEngineConfig cfg;
+    TakeShift job;
+    shift_engine_default_config(&cfg);
+    if (take_shift_open(&job, in, num_samples, out, ratio, engine, &cfg, curve, curve_frames) != 0) {
+        return -1;
+    }
+    if (job.curve) {
+        DLOG_WARN("WARNING: %s has no ratio curve, shifting by one ratio per chunk\r\n", shift_engine_name(engine));
+    }
+    while (!take_shift_step(&job)) {
+    }
+    take_shift_close(&job);
+    DLOG_INFO("Shifted %lu samples in DDR\r\n", (unsigned long)num_samples);
+    return 0;
+}
+
+#if TAKE_PREVIEW
+static TakeShift take_render;           // take_full's render while it runs
+static int take_render_busy;
+static char take_render_path[64];       // Where the finished render is saved
+
+// The preview into take_out: PSOLA following the ratio curve a chunk at a
+// time, passed the capture contour's pitch (or tracking its own without one)
+static int take_preview(float ratio, const float *curve, int curve_frames)
+{
+    ShiftEngineConfig cfg;
+    TakeShift job;
+    const AutotuneContour *contour = NULL;
+#if TAKE_CONTOUR
+    if (capture_pitch_ready && take_contour.count > 0) contour = &take_contour;
+#endif
+    shift_engine_default_config(&cfg);
+    cfg.external_pitch = contour != NULL;
+    if (take_shift_open(&job, take_rec, take_samples, take_out, ratio, SHIFT_ENGINE_PSOLA, &cfg,
+                        curve, curve_frames) != 0) {
+        return -1;
+    }
+    job.contour = contour;
+    while (!take_shift_step(&job)) {
+    }
+    take_shift_close(&job);
+    return 0;
 }
 
-/*** Save AudioBuffer to WAV file on SD card using FatFs ***/
-static int save_wav_to_sd(const char *filename, AudioBuffer* audio)
+// Start the full-quality render into take_full; out_path is saved once it is done
+static int take_render_start(float ratio, ShiftEngineId engine, const float *curve, int curve_frames,
+                             const char *out_path)
+{
+    ShiftEngineConfig cfg;
+    shift_engine_default_config(&cfg);
+    if (take_shift_open(&take_render, take_rec, take_samples, take_full, ratio, engine, &cfg,
+                        curve, curve_frames) != 0) {
+        return -1;
+    }
+    snprintf(take_render_path, sizeof(take_render_path), "%s", out_path);
+    take_render_busy = 1;
+    return 0;
+}
+
+// One chunk of the full render; the finished render replaces the preview
+static void take_render_step(void)
+{
+    if (!take_render_busy || !take_shift_step(&take_render)) return;
+    take_shift_close(&take_render);
+    take_render_busy = 0;
+#if TAKE_ZERO_COPY
+    if (take_samples & 1) take_full[take_samples] = 0;
+#endif
+    take_play = take_full;
+    DLOG_INFO("Full-quality render done\r\n");
+#if TAKE_SAVE_SD
+    sd_sink_add(take_render_path, take_full, take_samples, FS, OUT_BITS);
+#endif
+}
+#endif
+#else
+static int shift_wav_on_sd(const char *in_name, const char *out_name, float ratio,
+                           ShiftEngineId engine, const float *curve, int curve_frames)
 {
     FRESULT fr;
-    FIL fp;
-    UINT bw;
-    uint8_t hdr[44];
-    char path[64] = {0};
-    
-//    // Re-Mount drive just to be sure
-//    fr = f_mount(NULL, DRIVE, 1);
-//    fr = f_mount(&g_fs, DRIVE, 1);
+    WavReader fin;
+    uint32_t got;
+    char path[64];
+    int ret = -1;
 
-    xil_printf("Saving WAV file: %s\r\n", filename);
-    
-    // Create WAV header
-    wav_header(hdr, audio->length, audio->sample_rate, 16, 1);
-    
-    // Open file directly (filesystem already mounted)
-    // Use 8.3 filename format for FatFs compatibility
-    snprintf(path, sizeof(path), "%s/%s", DRIVE, filename);
-    fr = f_open(&fp, path, FA_WRITE | FA_CREATE_ALWAYS);
-    
+    DLOG_INFO("Shifting %s -> %s\r\n", in_name, out_name);
+
+    // Open input and check header
+    snprintf(path, sizeof(path), "%s/%s", DRIVE, in_name);
+    fr = wav_reader_open(&fin, path);
+    if (fr == FR_INVALID_OBJECT || (fr == FR_OK && fin.channels != 1)) {
+        DLOG_INFO("Only 16-bit mono PCM WAV supported\r\n");
+        if (fr == FR_OK) wav_reader_close(&fin);
+        return -1;
+    }
     if (fr != FR_OK) {
-        xil_printf("Failed to create output WAV file (error %d)\r\n", fr);
+        DLOG_ERROR("Failed to open WAV file: %d\r\n", fr);
         return -1;
     }
-    
-    // Write header
-    xil_printf("Writing WAV header...\r\n");
-    fr = f_write(&fp, hdr, sizeof(hdr), &bw);
-    if (fr != FR_OK || bw != sizeof(hdr)) {
-        xil_printf("Failed to write header: fr=%d bw=%u\r\n", fr, (unsigned)bw);
-        f_close(&fp);
+
+    uint32_t sample_rate = fin.fs;
+    uint32_t num_samples = fin.frames;
+    DLOG_INFO("WAV info: %lu samples, %lu Hz, 16-bit\r\n",
+               (unsigned long)num_samples, (unsigned long)sample_rate);
+
+    ShiftEngineConfig cfg;
+    ShiftEngine eng;
+    shift_engine_default_config(&cfg);
+    if (shift_engine_open(&eng, engine, &cfg, ratio) != 0) {
+        DLOG_ERROR("Failed to create pitch shifter\r\n");
+        wav_reader_close(&fin);
         return -1;
     }
-    
-    xil_printf("Header written, writing audio data...\r\n");
-    
-    // Write audio data in chunks (file is already open from sd_open_wav)
-    #define SAVE_CHUNK_SIZE 1024
-    int16_t chunk_buffer[SAVE_CHUNK_SIZE];
+    if (curve && shift_engine_set_ratio_curve(&eng, curve, curve_frames) != 0) {
+        DLOG_WARN("WARNING: %s has no ratio curve, shifting by one ratio\r\n", shift_engine_name(engine));
+    }
+
+    // Output has the same length and format as the input
+    snprintf(path, sizeof(path), "%s/%s", DRIVE, out_name);
+#if TAKE_SLOTS
+    fr = wav_writer_open_slot(&wav_out, path, num_samples, sample_rate, 16, 1);
+#else
+    fr = wav_writer_open(&wav_out, path, num_samples, sample_rate, 16, 1);
+#endif
+    if (fr != FR_OK) {
+        DLOG_ERROR("Failed to create output WAV file (error %d)\r\n", fr);
+        shift_engine_close(&eng);
+        wav_reader_close(&fin);
+        return -1;
+    }
+
+    // The first latency outputs precede the first input sample
+    int skip = shift_engine_latency(&eng);
+    uint32_t samples_read = 0;
     uint32_t samples_written = 0;
-    
-    while (samples_written < audio->length) {
-        uint32_t samples_to_write = audio->length - samples_written;
-        if (samples_to_write > SAVE_CHUNK_SIZE) {
-            samples_to_write = SAVE_CHUNK_SIZE;
+
+    while (samples_written < num_samples) {
+        int produced;
+
+        if (samples_read < num_samples) {
+            uint32_t samples_to_read = num_samples - samples_read;
+            if (samples_to_read > SHIFT_CHUNK_SIZE) {
+                samples_to_read = SHIFT_CHUNK_SIZE;
+            }
+
+            fr = wav_reader_read(&fin, shift_pcm_in, samples_to_read, &got);
+            if (fr != FR_OK) {
+                DLOG_ERROR("Failed to read audio data\r\n");
+                goto done;
+            }
+            int n = (int)got;
+            if (n == 0) {
+                num_samples = samples_read;
+                continue;
+            }
+
+            samples_read += n;
+
+            // PCM in, saturated PCM out; the shifter converts internally
+            produced = shift_engine_process(&eng, shift_pcm_in, n, shift_pcm_out);
+        } else {
+            produced = shift_engine_flush(&eng, shift_pcm_out);
         }
-        
-        // Convert float to int16
-        for (uint32_t i = 0; i < samples_to_write; i++) {
-            float sample = audio->data[samples_written + i];
-            // Clamp to [-1, 1] and convert to int16
-            if (sample > 1.0f) sample = 1.0f;
-            if (sample < -1.0f) sample = -1.0f;
-            chunk_buffer[i] = (int16_t)(sample * 32767.0f);
+
+        // Drop the latency and anything past the input length
+        int first = 0;
+        if (skip > 0) {
+            first = skip < produced ? skip : produced;
+            skip -= first;
         }
-        
-        fr = f_write(&fp, chunk_buffer, samples_to_write * sizeof(int16_t), &bw);
-        if (fr != FR_OK || bw != samples_to_write * sizeof(int16_t)) {
-            xil_printf("f_write failed: fr=%d (bw=%u vs %u)\r\n",
-                       fr, (unsigned)bw, (unsigned)(samples_to_write * sizeof(int16_t)));
-            f_close(&fp);
-            return -1;
+
+        int count = produced - first;
+        if (count > (int)(num_samples - samples_written)) {
+            count = num_samples - samples_written;
         }
-        
-        samples_written += samples_to_write;
-        
-        if (samples_written % 10240 == 0) {
-            xil_printf("  Written %lu / %lu samples\r\n", 
-                       (unsigned long)samples_written, (unsigned long)audio->length);
+
+        if (count > 0) {
+            fr = wav_writer_write(&wav_out, shift_pcm_out + first, count);
+            if (fr != FR_OK) {
+                DLOG_ERROR("WAV write failed: fr=%d\r\n", fr);
+                goto done;
+            }
+            samples_written += count;
+        }
+    }
+
+    ret = 0;
+
+done:
+    // Header carries what was actually written if the input was short
+    fr = wav_writer_close(&wav_out);
+    if (ret == 0 && fr != FR_OK) {
+        DLOG_ERROR("Failed to finish %s: fr=%d\r\n", out_name, fr);
+        ret = -1;
+    }
+    if (ret == 0) {
+        DLOG_INFO("Successfully saved %lu samples to %s/%s\r\n",
+                   (unsigned long)samples_written, DRIVE, out_name);
+    }
+    wav_reader_close(&fin);
+    shift_log_limiter(&eng);
+    shift_engine_close(&eng);
+    return ret;
+}
+#endif
+
+#if BATCH_RETUNE || REHEARSAL
+// Pitch of target.wav, from the cache when the file is unchanged; 0 if none
+static float ref_pitch_load(void)
+{
+    RefPitchCache ref;
+    YinSummary ref_summary;
+
+    if (ref_cache_lookup("target.wav", &ref)) {
+        return ref.pitch;
+    }
+    if (analyse_wav_from_sd("target.wav", 0, PITCH_WINDOW, FS / 8, 64, PITCH_THRESHOLD,
+                            &ref_summary) == 0 && ref_summary.voiced > 0) {
+        ref_cache_store("target.wav", ref_summary.histogramPitch, ref_summary.confidence,
+                        frequency_to_midi_note(ref_summary.histogramPitch) % 12);
+        return ref_summary.histogramPitch;
+    }
+    return 0.0f;
+}
+#endif
+
+#if BATCH_RETUNE
+/*** Batch mode: retune every take on the card to target.wav ***/
+static int batch_retune_mode(void)
+{
+    BatchTuneConfig cfg;
+    BatchTuneStats st;
+
+    xil_printf("\r\n=== Batch retune: %s/%s ===\r\n", DRIVE, BATCH_TUNE_PATTERN);
+    if (sd_mount() != 0) {
+        xil_printf("SD mount failed; no batch.\r\n");
+        return -1;
+    }
+    batch_tune_default_config(&cfg);
+    cfg.dir = DRIVE;
+    cfg.engine = SHIFT_ENGINE;
+    cfg.window = PITCH_WINDOW;
+    cfg.threshold = PITCH_THRESHOLD;
+
+    // The same reference a recorded take is moved to
+    cfg.ref_pitch = ref_pitch_load();
+    if (cfg.ref_pitch <= 0.0f) {
+        dlog_drain(0);
+        xil_printf("No pitch in target.wav; no batch.\r\n");
+        return -1;
+    }
+    cfg.ref_note_class = frequency_to_midi_note(cfg.ref_pitch) % 12;
+
+    status_set_led(STATUS_LED_MEDIUM);
+    int r = batch_tune_run(&cfg, &st);
+    status_set_led(STATUS_LED_OFF);
+    dlog_drain(0);
+    if (r != 0) {
+        xil_printf("Batch failed: cannot scan %s\r\n", DRIVE);
+        return -1;
+    }
+
+    xil_printf("Batch: %lu files written, %lu skipped, %lu failed in %lu ms\r\n",
+               (unsigned long)st.files, (unsigned long)st.skipped, (unsigned long)st.failed,
+               (unsigned long)(st.total_us / 1000));
+    xil_printf("       ");
+    print_float(batch_tune_files_per_minute(&st));
+    xil_printf(" files/min, ");
+    print_float(batch_tune_realtime_factor(&st));
+    xil_printf("x realtime\r\n");
+    xil_printf("       read %lu ms, shift %lu ms, write %lu ms\r\n",
+               (unsigned long)(st.read_us / 1000), (unsigned long)(st.shift_us / 1000),
+               (unsigned long)(st.write_us / 1000));
+    return 0;
+}
+#endif
+
+#if REHEARSAL
+#if TOTAL_SAMPLES > TAKE_PIPE_MAX_SAMPLES
+#error "REHEARSAL takes must fit a take slot (TAKE_PIPE_MAX_SAMPLES)"
+#endif
+static void rehearsal_report(const TakePipeStats *st, int full)
+{
+    xil_printf("Rehearsal: %lu takes recorded, %lu played, %lu saved, ",
+               (unsigned long)st->recorded, (unsigned long)st->played, (unsigned long)st->saved);
+    print_float(take_pipe_takes_per_minute(st));
+    xil_printf(" takes/min\r\n");
+    if (!full) return;
+    xil_printf("           waited %lu times for a slot (%lu ms of mic dropped), backlog peak %lu\r\n",
+               (unsigned long)st->stalls, (unsigned long)((uint64_t)st->stalled_samples * 1000 / FS),
+               (unsigned long)st->max_backlog);
+    xil_printf("           shift %lu ms of %lu ms, %lu unshifted, %lu not saved\r\n",
+               (unsigned long)(st->shift_us / 1000), (unsigned long)(st->elapsed_us / 1000),
+               (unsigned long)st->unshifted, (unsigned long)st->save_failed);
+    xil_printf("           %lu underruns, ~%lu samples lost\r\n",
+               (unsigned long)st->underruns, (unsigned long)st->lost_samples);
+}
+
+/*** Rehearsal mode: back-to-back takes; runs until the board is reset ***/
+static int rehearsal_mode(void)
+{
+    TakePipeConfig cfg;
+    TakePipeStats st;
+
+    take_pipe_default_config(&cfg);
+    cfg.take_samples = TOTAL_SAMPLES;
+    cfg.engine = SHIFT_ENGINE;
+    cfg.window = PITCH_WINDOW;
+    cfg.threshold = PITCH_THRESHOLD;
+    cfg.rec_bits = REC_BITS;
+    cfg.ref_pitch = ref_pitch_load();
+    if (cfg.ref_pitch <= 0.0f) {
+        dlog_drain(0);
+        xil_printf("No pitch in target.wav; no rehearsal.\r\n");
+        return -1;
+    }
+    cfg.ref_note_class = frequency_to_midi_note(cfg.ref_pitch) % 12;
+#if TAKE_SAVE_SD
+    cfg.dir = DRIVE;
+#endif
+
+    dlog_drain(0);
+    xil_printf("\r\n=== Rehearsal: %d s takes, back to back ===\r\n", SECONDS_TO_RECORD);
+    xil_printf("Press SW1 to start / stop.\r\n");
+
+    int running = 0;
+    uint32_t next_report = 0;
+    const uint32_t report_ticks = REHEARSAL_REPORT_SECONDS * 1000 / STATUS_TICK_MS;
+
+    while (1) {
+        int pressed = status_pressed();
+
+        if (pressed && !running) {
+            if (take_pipe_start(&AxiDma, &cfg) != 0) {
+                xil_printf("Rehearsal start failed.\r\n");
+                dma_recover();
+                continue;
+            }
+            status_set_led(STATUS_LED_ON);
+            running = 1;
+            next_report = status_ticks() + report_ticks;
+        } else if (pressed && running) {
+            // The takes still in the pool are shifted, played and saved first
+            status_set_led(STATUS_LED_MEDIUM);
+            running = 0;
+            if (take_pipe_stop() != 0) dma_recover();
+            status_set_led(STATUS_LED_OFF);
+            dlog_drain(0);
+            take_pipe_get_stats(&st);
+            rehearsal_report(&st, 1);
+            // The next run goes on from the next file number
+            cfg.first_take = (int)((cfg.first_take - 1 + st.recorded) % 999) + 1;
+        }
+        // One line per pass keeps the capture ring serviced
+        dlog_drain(1);
+        if (!running) continue;
+
+        if (take_pipe_step() < 0) {
+            xil_printf("Rehearsal DMA error; stopped\r\n");
+            status_set_led(STATUS_LED_OFF);
+            running = 0;
+            take_pipe_stop();
+            dma_recover();
+            continue;
+        }
+        // Slow blink while recording waits for the shifter or the card
+        status_set_led(take_pipe_stalled() ? STATUS_LED_SLOW : STATUS_LED_ON);
+        if ((int32_t)(status_ticks() - next_report) >= 0) {
+            next_report += report_ticks;
+            take_pipe_get_stats(&st);
+            rehearsal_report(&st, 0);
         }
     }
-    
-    // Close file
-    f_close(&fp);
-    xil_printf("Successfully saved %lu samples to %s/%s\r\n", 
-               (unsigned long)samples_written, DRIVE, filename);
-    
     return 0;
 }
+#endif
 
 int main(void)
 {
@@ -613,13 +1520,16 @@ int main(void)
     xil_printf("State 5: LED DOUBLE BLINK - Complete!\r\n\r\n");
 
     int state = 0;
-    int prev_sw = 0;  // For edge detection
     u32 samples_written = 0;
-    FIL f;
-    UINT bw;
     int status;
     
-    // -------- Init DMA (simple mode) --------
+    // -------- Map the DMA buffers non-cacheable before any transfer --------
+    if (dma_mem_init() != 0) {
+        xil_printf("DMA buffer section is not 2 MB aligned (lscript.ld).\r\n");
+        return XST_FAILURE;
+    }
+
+    // -------- Init DMA (simple mode), once for both channels --------
     XAxiDma_Config *Cfg = XAxiDma_LookupConfig(DMA_DEV_ID);
     if (!Cfg) {
         xil_printf("No DMA config found.\r\n");
@@ -634,135 +1544,320 @@ int main(void)
         xil_printf("Scatter-Gather DMA detected; expecting Simple mode.\r\n");
         return XST_FAILURE;
     }
+    if (capture_init(&AxiDma) != 0) {
+        xil_printf("Capture interrupt setup failed.\r\n");
+        return XST_FAILURE;
+    }
+
+    // LED patterns and SW1 run off the TTC tick from here on
+    if (status_init() != 0) {
+        xil_printf("Status timer / interrupt setup failed.\r\n");
+        return XST_FAILURE;
+    }
+
+    // Mounted for good: no take waits for the FAT to be read again
+    if (sd_mount() != 0) xil_printf("SD mount failed; retrying at the first take.\r\n");
+#if TAKE_SLOTS
+    sd_sink_use_slots(1);
+#endif
+
+#if SELF_BENCH
+    if (SELF_BENCH == 2 || (Xil_In32(STATUS_GPIO_BASEADDR + STATUS_SW_OFFSET) & 0x01)) {
+        return self_bench_run(&AxiDma) == 0 ? XST_SUCCESS : XST_FAILURE;
+    }
+#endif
+#if LIVE_RETUNE
+    if (Xil_In32(STATUS_GPIO_BASEADDR + STATUS_SW_OFFSET) & 0x01) {
+        return live_retune_mode();
+    }
+#endif
+#if BATCH_RETUNE
+    batch_retune_mode();
+#endif
+#if REHEARSAL
+    return rehearsal_mode();
+#endif
+#if CAPTURE_PITCH
+    capture_pitch_setup();
+#endif
 
     xil_printf("System initialized. Press SW1 to advance states...\r\n");
     
     static int pitch_done;
 	static float recorded_pitch;
-	static float reference_pitch;
 	static int vocoder_done;
 	static int done_printed;
+#if TAKE_IN_DDR
+	static int preview_pending;     // State 6 plays the preview, then returns to 5
+#endif
 	char rec_filename[16] = {0};
 	char shifted_filename[16] = {0};
 
     // Main state machine loop
 	int num_files = 1;
+#if TAKE_SLOTS
+	take_slot_prepare(num_files);
+#endif
     while(1) {
-        u32 sw = (Xil_In32(XPAR_AXI_GPIO_0_BASEADDR + AXI_GPIO_SW_OFFSET) & 0x01);
-        
-        // Detect button press (rising edge)
-        if (sw == 1 && prev_sw == 0) {
+        // Debounced in the status tick; no delay here
+        if (status_pressed()) {
             state++;
             xil_printf("\r\n>>> Button pressed! State: %d\r\n\r\n", state);
-            usleep(200000);  // Debounce delay
         }
-        prev_sw = sw;
         
 		pitch_done = 0;
 		recorded_pitch = 0;
-		reference_pitch = 0;
 
         // State 0: Ready (LED OFF)
         if (state == 0) {
-            Xil_Out32(XPAR_AXI_GPIO_0_BASEADDR + AXI_GPIO_LED_OFFSET, 0);
+            status_set_led(STATUS_LED_OFF);
+            dlog_drain(1);      // One line per pass keeps the button responsive
         }
         // State 1: Waiting to start recording (LED ON)
         else if (state == 1) {
-            Xil_Out32(XPAR_AXI_GPIO_0_BASEADDR + AXI_GPIO_LED_OFFSET, 1);
+            status_set_led(STATUS_LED_ON);
+            dlog_drain(1);
 
             // Generate names for wav files
-			if (num_files == 1000) num_files = 1;
-			snprintf(rec_filename, sizeof(rec_filename), "rec_%03d.wav", num_files);
-			snprintf(shifted_filename, sizeof(rec_filename), "out_%03d.wav", num_files);
+			take_names(num_files, rec_filename, shifted_filename, sizeof(rec_filename));
         }
         // State 2: Recording (LED OFF)
         else if (state == 2) {
-            Xil_Out32(XPAR_AXI_GPIO_0_BASEADDR + AXI_GPIO_LED_OFFSET, 0);
-            xil_printf("Opening %s/%s ...\r\n", DRIVE, rec_filename);
-            if (sd_open_wav(&f, rec_filename, TOTAL_SAMPLES, FS, OUT_BITS, CHANNELS) != 0) {
-                xil_printf("Failed to open WAV on %s\r\n", DRIVE);
+            status_set_led(STATUS_LED_OFF);
+            // Everything the take allocates from here on comes back at state 7
+            if (arena_begin() != 0) DLOG_INFO("No .arena section; the take uses the heap\r\n");
+            PROF_CLEAR();
+#if TAKE_IN_DDR
+            // The previous take's files must be out before its buffers are reused
+            if (sd_sink_flush() != 0) DLOG_INFO("Previous take was not fully saved\r\n");
+            if (sd_mount() != 0) DLOG_ERROR("SD mount failed; the take stays in DDR only\r\n");
+#else
+            DLOG_INFO("Opening %s/%s ...\r\n", DRIVE, rec_filename);
+            if (sd_open_wav(&wav_out, rec_filename, TOTAL_SAMPLES, FS, REC_BITS, CHANNELS) != 0) {
+                DLOG_ERROR("Failed to open WAV on %s\r\n", DRIVE);
+                dlog_drain(0);
                 return XST_FAILURE;
             }
+#endif
             
+            // Last UART output until the take is processed: the singer needs the cue now
+            dlog_drain(0);
             xil_printf("*** RECORDING %d seconds @ %d Hz ***\r\n", SECONDS_TO_RECORD, FS);
+#if LONG_TAKE
+            xil_printf("Press SW1 to end the take early\r\n");
+#endif
             samples_written = 0;
+#if CAPTURE_PITCH
+            capture_pitch_begin();
+#endif
+#if TAKE_VAD
+            vad_init(&take_vad, NULL);
+#endif
             
-            // Recording loop
+            // Recording loop: the capture ring keeps the next transfer armed while
+            // this burst is converted and written
+            if (capture_start() != 0) {
+                DLOG_ERROR("DMA transfer setup failed.\r\n");
+            }
+#if LIVE_MONITOR
+            // MM2S runs alongside; an error there only ends the monitoring
+            static const int16_t preroll[MONITOR_PREROLL];
+            uint32_t monitor_dropped = 0;
+            int monitor_on = 1;
+            uint32_t *mon_tx;
+            playback_start(&AxiDma);
+            if (playback_acquire(&mon_tx) > 0) {
+                playback_submit(playback_fill(mon_tx, preroll, MONITOR_PREROLL));
+            }
+#endif
             while (samples_written < TOTAL_SAMPLES) {
-                // 1) kick S2MM for one burst
-                Xil_DCacheFlushRange((UINTPTR)rx32, BURST_BYTES);
-                status = XAxiDma_SimpleTransfer(&AxiDma, (UINTPTR)rx32, BURST_BYTES, XAXIDMA_DEVICE_TO_DMA);
-                if (status != XST_SUCCESS) {
-                    xil_printf("DMA transfer setup failed.\r\n");
+#if LONG_TAKE
+                if (status_pressed()) {
+                    DLOG_INFO("SW1: take ended after %lu s\r\n", (unsigned long)(samples_written / FS));
                     break;
                 }
-
-                // 2) wait for completion
-                while (XAxiDma_Busy(&AxiDma, XAXIDMA_DEVICE_TO_DMA)) { /* spin */ }
-
-                // 3) see fresh data
-                Xil_DCacheInvalidateRange((UINTPTR)rx32, BURST_BYTES);
-
-                // 4) convert to 16-bit PCM (and swap endianess)
-                for (int i = 0; i < BURST_SAMPLES; ++i) {
-                    pcm16[i] = swap_bits_u16(to_pcm16(rx32[i]));
+#endif
+                // 1) next burst (re-arms the DMA when polling)
+                const uint32_t *rx;
+                PROF_START(PROF_DMA_WAIT);
+                int got = capture_next(&rx);
+                if (got < 0) {
+                    DLOG_ERROR("Capture DMA error.\r\n");
+                    dma_recover();
+                    break;
                 }
+                if (got == 0) continue;
+                PROF_STOP(PROF_DMA_WAIT);
 
-                // 5) write to SD (respect final partial chunk)
+                // 2) convert to 16-bit PCM (and mirror the bit order), then hand the buffer back
+                // (respect final partial chunk)
                 uint32_t chunk = BURST_SAMPLES;
                 if (samples_written + chunk > TOTAL_SAMPLES)
                     chunk = TOTAL_SAMPLES - samples_written;
-
-                FRESULT fr = f_write(&f, pcm16, chunk * sizeof(int16_t), &bw);
-                if (fr != FR_OK || bw != chunk * sizeof(int16_t)) {
-                    xil_printf("f_write short fr=%d (bw=%u vs %u)\r\n",
-                               fr, (unsigned)bw, (unsigned)(chunk*sizeof(int16_t)));
+#if TAKE_IN_DDR
+                int16_t *pcm = take_rec + samples_written;
+#else
+                int16_t *pcm = pcm16;
+#endif
+#if CAPTURE_PL_PACK
+                memcpy(pcm, rx, chunk * sizeof(int16_t));   // already PCM from the PL
+#else
+                pcm_from_capture(rx, pcm, (int)chunk);
+#endif
+                capture_release();
+#if TAKE_VAD
+                vad_push(&take_vad, pcm, (int)chunk);
+#endif
+
+#if LIVE_MONITOR
+                // 2a) straight back out to the speaker
+                if (monitor_on) {
+                    int got_tx = playback_acquire(&mon_tx);
+                    if (got_tx > 0) {
+                        playback_submit(playback_fill(mon_tx, pcm, (int)chunk));
+                    } else if (got_tx == 0) {
+                        monitor_dropped += chunk;
+                    } else {
+                        DLOG_ERROR("Monitor DMA error; monitoring stopped\r\n");
+                        monitor_on = 0;
+                    }
+                }
+#endif
+
+#if CAPTURE_PITCH
+                // 2b) pitch of the newest window, while the next burst is still arriving
+                capture_pitch_burst(pcm, chunk, samples_written + chunk);
+#endif
+
+#if !TAKE_IN_DDR
+                // 3) write to SD; staged, so the card only sees whole-cluster writes
+                FRESULT fr = wav_writer_write(&wav_out, pcm, chunk);
+                if (fr != FR_OK) {
+                    DLOG_ERROR("WAV write failed fr=%d\r\n", fr);
                     break;
                 }
+#endif
 
                 samples_written += chunk;
             }
+            capture_stop();
+
+#if LIVE_MONITOR
+            if (!monitor_on || playback_finish() != 0) {
+                dma_recover();      // capture is done, so the shared reset is safe now
+            } else {
+                PlaybackStats mon;
+                playback_get_stats(&mon);
+                DLOG_INFO("Monitor: %lu underruns, %lu samples dropped\r\n",
+                           (unsigned long)mon.underruns, (unsigned long)monitor_dropped);
+            }
+#endif
+
+            CaptureStats cap;
+            capture_get_stats(&cap);
+            DLOG_INFO("Capture: %lu transfers, %lu overruns, ~%lu samples lost, FIFO peak %lu\r\n",
+                       (unsigned long)cap.segments, (unsigned long)cap.overruns,
+                       (unsigned long)cap.lost_samples, (unsigned long)cap.max_backlog);
+#if TAKE_VAD
+            vad_finish(&take_vad);
+            DLOG_INFO("VAD: %d voiced regions, onset at sample %ld, %lu of %lu bursts voiced\r\n",
+                       take_vad.count, take_vad.onset == UINT32_MAX ? -1L : (long)take_vad.onset,
+                       (unsigned long)take_vad.voiced_frames, (unsigned long)take_vad.frames);
+#endif
             
-            // Patch header and close
-            sd_fix_header(&f, samples_written, FS, OUT_BITS, CHANNELS);
-            f_close(&f);
-            xil_printf("Saved %s/rec.wav (%lu samples).\r\n", DRIVE, (unsigned long)samples_written);
+#if TAKE_IN_DDR
+            take_samples = samples_written;
+            DLOG_INFO("Captured %lu samples to DDR.\r\n", (unsigned long)samples_written);
+#else
+            // Tail, then the header once with the real length
+            if (wav_writer_close(&wav_out) != FR_OK) {
+                DLOG_ERROR("Failed to finish %s\r\n", rec_filename);
+                sd_unmount();
+            }
+            DLOG_INFO("Saved %s/rec.wav (%lu samples).\r\n", DRIVE, (unsigned long)samples_written);
+#endif
             
-            // Auto-advance to next state
+            // Auto-advance to next state; a press during the take is not a command
+            status_clear();
             state++;
         }
         // State 3: Pitch detection (LED slow blink)
         else if (state == 3) {
-            Xil_Out32(XPAR_AXI_GPIO_0_BASEADDR + AXI_GPIO_LED_OFFSET, 1);
-            usleep(500000);  // 500ms on
-            Xil_Out32(XPAR_AXI_GPIO_0_BASEADDR + AXI_GPIO_LED_OFFSET, 0);
-            usleep(500000);  // 500ms off
-            
+            status_set_led(STATUS_LED_SLOW);
+
             if (!pitch_done) {
-                xil_printf("\r\n=== Starting Pitch Detection ===\r\n");
+                DLOG_INFO("\r\n=== Starting Pitch Detection ===\r\n");
                 
                 // Detect pitch from recorded audio
                 PitchResult rec_result;
-                int startSample = 22050;
-                int numSamples = 1024;
-                float threshold = 0.15;
-                
-                xil_printf("Analyzing recorded audio (rec.wav)...\r\n");
-                if (detect_pitch_from_sd(rec_filename, startSample, numSamples, threshold, &rec_result) == 0) {
-                    xil_printf("\n=== Recorded Audio Pitch ===\r\n");
-                    xil_printf("Sample Rate:      %d Hz\r\n", rec_result.sampleRate);
-                    xil_printf("Start Sample:     %d\r\n", rec_result.actualStartSample);
-                    xil_printf("Samples Analyzed: %d\r\n", rec_result.numSamples);
+                int startSample = PITCH_START_SAMPLE;
+                int numSamples = PITCH_WINDOW;
+                float threshold = PITCH_THRESHOLD;
+                int rec_ok = 0;
+                take_voicing = 0.0f;
+                take_target = 0.0f;
+
+#if CAPTURE_PITCH
+                // Tracked during capture; the SD path is only a fallback
+                YinSummary rec_summary;
+                if (capture_pitch_ready) {
+                    YinAnalysis_summarise(&capture_stats, &rec_summary);
+                    if (rec_summary.voiced > 0) {
+                        DLOG_INFO("Recorded pitch tracked during capture (%d of %d windows voiced)\r\n",
+                                   rec_summary.voiced, rec_summary.windows);
+                        rec_result.pitch = rec_summary.histogramPitch;
+                        rec_result.confidence = rec_summary.confidence;
+                        rec_result.sampleRate = FS;
+                        rec_result.numSamples = numSamples;
+                        rec_result.bufferSize = numSamples;
+                        rec_result.actualStartSample = startSample;
+                        take_voicing = rec_summary.voicedRatio;
+                        rec_ok = 1;
+                    }
+                }
+#endif
+#if TAKE_VAD
+                // Straight to the voiced audio; nothing voiced, nothing to read back
+                int voiced_window = 1;
+                if (!rec_ok) {
+                    uint32_t vad_start;
+                    if (vad_window(&take_vad, numSamples, 0, &vad_start) == 0) {
+                        startSample = (int)vad_start;
+                    } else {
+                        DLOG_INFO("No voiced audio in the take\r\n");
+                        voiced_window = 0;
+                    }
+                }
+                if (!rec_ok && voiced_window) {
+#else
+                if (!rec_ok) {
+#endif
+#if TAKE_IN_DDR
+                    DLOG_INFO("Analyzing recorded audio (DDR)...\r\n");
+                    rec_ok = detect_pitch_from_take(startSample, numSamples, threshold, &rec_result) == 0;
+#else
+                    DLOG_INFO("Analyzing recorded audio (rec.wav)...\r\n");
+                    rec_ok = detect_pitch_from_sd(rec_filename, startSample, numSamples, threshold, &rec_result) == 0;
+#endif
+                }
+                if (rec_ok && take_voicing == 0.0f && rec_result.pitch > 0) {
+                    take_voicing = rec_result.confidence;   // One window only: its confidence
+                }
+                if (rec_ok) {
+                    DLOG_INFO("\n=== Recorded Audio Pitch ===\r\n");
+                    DLOG_INFO("Sample Rate:      %d Hz\r\n", rec_result.sampleRate);
+                    DLOG_INFO("Start Sample:     %d\r\n", rec_result.actualStartSample);
+                    DLOG_INFO("Samples Analyzed: %d\r\n", rec_result.numSamples);
                     
                     if (rec_result.pitch > 0) {
                         recorded_pitch = rec_result.pitch;
-                        xil_printf("\nRecorded Pitch Detected!\r\n");
+                        DLOG_INFO("\nRecorded Pitch Detected!\r\n");
                         int freq_int = (int)rec_result.pitch;
                         int freq_dec = (int)((rec_result.pitch - freq_int) * 100);
-                        xil_printf("  Frequency:   %d.%02d Hz\r\n", freq_int, freq_dec);
+                        DLOG_INFO("  Frequency:   %d.%02d Hz\r\n", freq_int, freq_dec);
                         
                         int conf_int = (int)(rec_result.confidence * 100);
-                        xil_printf("  Confidence:  %d%%\r\n", conf_int);
+                        DLOG_INFO("  Confidence:  %d%%\r\n", conf_int);
                         
                         // Calculate musical note for recorded audio
                         if (rec_result.pitch > 20 && rec_result.pitch < 4200) {
@@ -771,41 +1866,45 @@ int main(void)
                             int rec_midi = frequency_to_midi_note(rec_result.pitch);
                             int noteIndex = rec_midi % 12;
                             int octave = (rec_midi / 12) - 1;
-                            xil_printf("  Musical Note: %s%d (MIDI %d)\r\n", notes[noteIndex], octave, rec_midi);
+                            DLOG_INFO("  Musical Note: %s%d (MIDI %d)\r\n", notes[noteIndex], octave, rec_midi);
                         }
                         
-                        xil_printf("\r\nAnalyzing reference audio (target.wav)...\r\n");
+                        DLOG_INFO("\r\nAnalyzing reference audio (target.wav)...\r\n");
                         PitchResult ref_result;
                         
-                        // Try different start positions for target.wav
+                        // One pass over target.wav: a window every 1/8 s for up to 8 s
                         int ref_detected = 0;
-                        int start_positions[] = {0, 11025, 22050, 88200};  // 0s, 0.25s, 0.5s, 1s at 44.1kHz
-                        int num_positions = sizeof(start_positions) / sizeof(start_positions[0]);
-                        
-                        for (int pos = 0; pos < num_positions && !ref_detected; pos++) {
-                            int test_start = start_positions[pos];
-                            xil_printf("Trying start position: %d samples ", test_start);
-                            print_float((float)test_start / 48000.0f);
-                            xil_printf("\r\n");
-                            
-                            if (detect_pitch_from_sd("target.wav", test_start, numSamples, threshold, &ref_result) == 0) {
-                                if (ref_result.pitch > 0) {
-                                    ref_detected = 1;
-                                    xil_printf("SUCCESS: Found pitch at position %d\r\n", test_start);
-                                    break;
-                                }
-                            }
+                        int ref_hop = FS / 8;
+                        int ref_max_windows = 64;
+                        YinSummary ref_summary;
+
+                        RefPitchCache ref_cache;
+                        ref_summary.windows = 0;
+
+                        if (ref_cache_lookup("target.wav", &ref_cache)) {
+                            // target.wav is unchanged since it was last analysed
+                            DLOG_INFO("Reference pitch from cache (%s)\r\n", REF_CACHE_FILE);
+                            ref_result.pitch = ref_cache.pitch;
+                            ref_result.confidence = ref_cache.confidence;
+                            ref_detected = 1;
+                        } else if (analyse_wav_from_sd("target.wav", 0, numSamples, ref_hop, ref_max_windows,
+                                                       threshold, &ref_summary) == 0 && ref_summary.voiced > 0) {
+                            // The strongest semitone is robust to octave errors and stray windows
+                            ref_result.pitch = ref_summary.histogramPitch;
+                            ref_result.confidence = ref_summary.confidence;
+                            ref_detected = 1;
+                            ref_cache_store("target.wav", ref_result.pitch, ref_result.confidence,
+                                            frequency_to_midi_note(ref_result.pitch) % 12);
                         }
-                        
+
                         if (ref_detected) {
-                                reference_pitch = ref_result.pitch;
-                                xil_printf("\n=== Reference Audio Pitch ===\r\n");
+                                DLOG_INFO("\n=== Reference Audio Pitch ===\r\n");
                                 int ref_freq_int = (int)ref_result.pitch;
                                 int ref_freq_dec = (int)((ref_result.pitch - ref_freq_int) * 100);
-                                xil_printf("  Frequency:   %d.%02d Hz\r\n", ref_freq_int, ref_freq_dec);
+                                DLOG_INFO("  Frequency:   %d.%02d Hz\r\n", ref_freq_int, ref_freq_dec);
                                 
                                 int ref_conf_int = (int)(ref_result.confidence * 100);
-                                xil_printf("  Confidence:  %d%%\r\n", ref_conf_int);
+                                DLOG_INFO("  Confidence:  %d%%\r\n", ref_conf_int);
                                 
                                 // Find closest musical note to reference pitch
                                 int ref_midi = frequency_to_midi_note(ref_result.pitch);
@@ -824,13 +1923,15 @@ int main(void)
                                     int target_noteIndex = target_midi % 12;
                                     int target_octave = (target_midi / 12) - 1;
 
-                                    xil_printf("  Musical Note: %s%d (MIDI %d)\\r\\n", notes[ref_noteIndex], ref_octave, ref_midi);
-                                    xil_printf("  Note Class: %s\\r\\n", notes[ref_note_class]);
+                                    DLOG_INFO("  Musical Note: %s%d (MIDI %d)\\r\\n", notes[ref_noteIndex], ref_octave, ref_midi);
+                                    DLOG_INFO("  Note Class: %s\\r\\n", notes[ref_note_class]);
 
                                     // Calculate pitch shift ratio to closest occurrence
                                     target_pitch_ratio = target_freq / recorded_pitch;
+                                    take_target = target_freq;
+                                    take_pitch = recorded_pitch;
 
-                                    xil_printf("\\n=== Pitch Shift Analysis ===\\r\\n");
+                                    DLOG_INFO("\\n=== Pitch Shift Analysis ===\\r\\n");
                                     int recorded_freq_int = (int)recorded_pitch;
                                     int recorded_freq_dec = (int)((recorded_pitch - recorded_freq_int) * 100);
                                     int ref_freq_int = (int)ref_result.pitch;
@@ -838,241 +1939,317 @@ int main(void)
                                     int target_freq_int = (int)target_freq;
                                     int target_freq_dec = (int)((target_freq - target_freq_int) * 100);
 
-                                    xil_printf("Recorded: %d.%02d Hz\\r\\n", recorded_freq_int, recorded_freq_dec);
-                                    xil_printf("Reference: %d.%02d Hz\\r\\n", ref_freq_int, ref_freq_dec);
-                                    xil_printf("Target: %d.%02d Hz (%s%d)\\r\\n",
+                                    DLOG_INFO("Recorded: %d.%02d Hz\\r\\n", recorded_freq_int, recorded_freq_dec);
+                                    DLOG_INFO("Reference: %d.%02d Hz\\r\\n", ref_freq_int, ref_freq_dec);
+                                    DLOG_INFO("Target: %d.%02d Hz (%s%d)\\r\\n",
                                               target_freq_int, target_freq_dec, notes[target_noteIndex], target_octave);
 
                                     int ratio_int = (int)(target_pitch_ratio * 100);
-                                    xil_printf("Pitch shift ratio: %d.%02d\\r\\n", ratio_int/100, ratio_int%100);
+                                    DLOG_INFO("Pitch shift ratio: %d.%02d\\r\\n", ratio_int/100, ratio_int%100);
 
                                     // Calculate distances to show which direction was chosen
                                     if (recorded_pitch > ref_result.pitch) {
                                         float distance = recorded_pitch - target_freq;
                                         int dist_int = (int)distance;
                                         int dist_dec = (int)((distance - dist_int) * 100);
-                                        xil_printf("Direction: SHIFT DOWN by %d.%02d Hz (recorded > reference)\\r\\n",
+                                        DLOG_INFO("Direction: SHIFT DOWN by %d.%02d Hz (recorded > reference)\\r\\n",
                                                   dist_int, dist_dec);
                                     } else {
                                         float distance = target_freq - recorded_pitch;
                                         int dist_int = (int)distance;
                                         int dist_dec = (int)((distance - dist_int) * 100);
-                                        xil_printf("Direction: SHIFT UP by %d.%02d Hz (recorded < reference)\\r\\n",
+                                        DLOG_INFO("Direction: SHIFT UP by %d.%02d Hz (recorded < reference)\\r\\n",
                                                   dist_int, dist_dec);
                                     }
                                 } else {
-                                    xil_printf("Error: Could not find valid target frequency\\r\\n");
+                                    DLOG_ERROR("Error: Could not find valid target frequency\\r\\n");
                                     target_pitch_ratio = 1.0f;
                                 }
                             } else {
-                                xil_printf("No pitch detected in reference file target.wav\r\n");
-                                xil_printf("DEBUG: Tried %d different start positions\r\n", num_positions);
-                                xil_printf("DEBUG: File may be silent, too noisy, or non-tonal\r\n");
+                                DLOG_INFO("No pitch detected in reference file target.wav\r\n");
+                                DLOG_DEBUG("DEBUG: Analysed %d windows, none voiced\r\n", ref_summary.windows);
+                                DLOG_DEBUG("DEBUG: File may be silent, too noisy, or non-tonal\r\n");
                                 target_pitch_ratio = 1.0f;  // No change if reference not detected
                             }
                         } else {
-                            xil_printf("Error: Failed to detect pitch from recorded audio\r\n");
+                            DLOG_ERROR("Error: Failed to detect pitch from recorded audio\r\n");
                             target_pitch_ratio = 1.0f;  // No change if file not found
                         }
                     } else {
-                        xil_printf("Error: Detected negative pitch\r\n");
+                        DLOG_ERROR("Error: Detected negative pitch\r\n");
                         target_pitch_ratio = 1.0f;
                     }
                 } else {
-                    xil_printf("Error: Failed to detect pitch from recorded audio\r\n");
+                    DLOG_ERROR("Error: Failed to detect pitch from recorded audio\r\n");
                     target_pitch_ratio = 1.0f;
                 }
                 pitch_done = 1;
+                status_clear();
                 state++;  // Auto-advance
             }
 
         else if (state == 4) {
-            // Blink LED faster during processing to show activity
-            static int blink_counter = 0;
-            blink_counter++;
-            if (blink_counter % 20 == 0) {  // Every 20th iteration
-                Xil_Out32(XPAR_AXI_GPIO_0_BASEADDR + AXI_GPIO_LED_OFFSET, 1);
-                usleep(25000);  // 25ms on
-                Xil_Out32(XPAR_AXI_GPIO_0_BASEADDR + AXI_GPIO_LED_OFFSET, 0);
-                usleep(25000);  // 25ms off
-            }
+            // Blinks from the timer tick while the shift runs
+            status_set_led(STATUS_LED_MEDIUM);
             
             // Run phase vocoder once
             vocoder_done = 0;
             if (!vocoder_done) {
-                xil_printf("\r\n=== Starting Phase Vocoder Pitch Shift ===\r\n");
+                DLOG_INFO("\r\n=== Starting Phase Vocoder Pitch Shift ===\r\n");
                 
                 // Use the calculated pitch ratio from state 3
                 float pitch_shift_ratio = target_pitch_ratio;
                 
                 int ratio_int = (int)(pitch_shift_ratio * 100);
-                xil_printf("Applying calculated pitch shift ratio: %d.%02d\r\n", ratio_int/100, ratio_int%100);
+                DLOG_INFO("Applying calculated pitch shift ratio: %d.%02d\r\n", ratio_int/100, ratio_int%100);
                 
-                AudioBuffer* input_audio = load_wav_from_sd(rec_filename);
-                
-                if (!input_audio) {
-                    xil_printf("Failed to load input audio file\r\n");
-                } else {
-                    xil_printf("Loaded audio: %d samples at %d Hz\r\n", 
-                               input_audio->length, input_audio->sample_rate);
-                    
-                    // Check if pitch shift ratio is reasonable
-                    int ratio_int = (int)(pitch_shift_ratio * 100);
-                    xil_printf("Pitch shift ratio: %d.%02d\r\n", ratio_int/100, ratio_int%100);
-
-                    if (pitch_shift_ratio > 3.0f || pitch_shift_ratio < 0.3f) {
-                        xil_printf("WARNING: Large pitch shift ratio detected!\r\n");
-                        xil_printf("This may cause memory issues or long processing time\r\n");
-                        if (pitch_shift_ratio > 2.0f) {
-                            pitch_shift_ratio = 2.0f;  // Limit to 2x max
-                            xil_printf("Limiting ratio to 2.00 for stability\r\n");
-                        } else if (pitch_shift_ratio < 0.5f) {
-                            pitch_shift_ratio = 0.5f;  // Limit to 0.5x min
-                            xil_printf("Limiting ratio to 0.50 for stability\r\n");
-                        }
-                    }
-
-                    // Estimate output size
-                    int estimated_output = (int)(input_audio->length * pitch_shift_ratio);
-                    xil_printf("Estimated output size: %d samples (~%d KB)\r\n",
-                               estimated_output, (estimated_output * sizeof(float)) / 1024);
-
-                    if (estimated_output > 200000) {
-                        xil_printf("WARNING: Output size very large, may cause memory issues!\r\n");
-                    }
-
-                    xil_printf("Starting phase vocoder processing...\r\n");
-
-                    // Add a simple progress indicator
-                    xil_printf("Processing frames...");
-                    AudioBuffer* output_audio = phase_vocoder_pitch_shift(input_audio, pitch_shift_ratio);
-                    
-                    xil_printf("\r\nPhase vocoder call completed.\r\n");
-
-                    if (!output_audio) {
-                        xil_printf("Phase vocoder processing failed (out of memory or processing error)\r\n");
-                        xil_printf("Possible causes:\r\n");
-                        xil_printf("  1. Insufficient heap memory\r\n");
-                        xil_printf("  2. Pitch shift ratio too extreme\r\n");
-                        xil_printf("  3. Input audio too long\r\n");
-                        xil_printf("Try reducing recording time or pitch shift ratio\r\n");
-                    } else {
-                        xil_printf("Phase vocoder complete: %d output samples\r\n", output_audio->length);
-                        
-                        // Validate output
-                        if (output_audio->length <= 0) {
-                            xil_printf("ERROR: Invalid output length!\r\n");
-                        } else if (output_audio->length > 300000) {
-                            xil_printf("WARNING: Very large output, truncating to 300000 samples\r\n");
-                            output_audio->length = 300000;  // Truncate if too large
-                        }
+                if (pitch_shift_ratio > 2.0f) {
+                    pitch_shift_ratio = 2.0f;  // Limit to 2x max
+                    DLOG_INFO("Limiting ratio to 2.00\r\n");
+                } else if (pitch_shift_ratio < 0.5f) {
+                    pitch_shift_ratio = 0.5f;  // Limit to 0.5x min
+                    DLOG_INFO("Limiting ratio to 0.50\r\n");
+                }
 
-                        xil_printf("Saving pitch-shifted audio...\r\n");
-                        if (save_wav_to_sd(shifted_filename, output_audio) == 0) {
-                            xil_printf("Successfully saved pitch-shifted audio as 0:/%s!\r\n", shifted_filename);
-                        } else {
-                            xil_printf("Failed to save pitch-shifted audio\r\n");
-                        }
-                        
-                        free_audio_buffer(output_audio);
-                    }
-                    
-                    free_audio_buffer(input_audio);
+                // Offline: no latency or CPU limit, the signal decides
+                ShiftRequest req = { pitch_shift_ratio, take_voicing, 0, 0 };
+                ShiftEngineConfig shift_cfg;
+                shift_engine_default_config(&shift_cfg);
+                ShiftEngineId engine = SHIFT_ENGINE == SHIFT_ENGINE_AUTO ?
+                                       shift_engine_select(&req, &shift_cfg) : SHIFT_ENGINE;
+                const float *curve = NULL;
+                int curve_frames = 0;
+#if TAKE_CONTOUR
+                // Only the vocoder follows a curve; the contour matters more than the cheaper engine
+                curve = take_ratio_curve(take_target, take_pitch, &curve_frames);
+                if (curve && SHIFT_ENGINE == SHIFT_ENGINE_AUTO) engine = SHIFT_ENGINE_PV;
+#endif
+                DLOG_INFO("Starting %s processing (%d%% voiced)...\r\n", shift_engine_name(engine),
+                          (int)(take_voicing * 100.0f));
+#if TAKE_IN_DDR
+                char save_path[64];
+                take_play = take_out;
+#if TAKE_PREVIEW
+                // The preview plays straight away; the chosen engine renders
+                // take_full behind it and saves out_xxx.wav when it is done
+                preview_pending = take_preview(pitch_shift_ratio, curve, curve_frames) == 0;
+                snprintf(save_path, sizeof(save_path), "%s/%s", DRIVE, shifted_filename);
+                if (preview_pending &&
+                    take_render_start(pitch_shift_ratio, engine, curve, curve_frames, save_path) != 0) {
+                    preview_pending = 0;
                 }
+#endif
+                if (!preview_pending &&
+                    shift_take(take_rec, take_samples, take_out, pitch_shift_ratio, engine, curve, curve_frames) != 0) {
+                    DLOG_ERROR("Pitch shift failed\r\n");
+                    memcpy(take_out, take_rec, take_samples * sizeof(int16_t));   // Play it unshifted
+                }
+#if TAKE_ZERO_COPY
+                // take_out goes to the DMA in whole words; pad an odd take with silence
+                if (take_samples & 1) take_out[take_samples] = 0;
+#endif
+#if TAKE_SAVE_SD
+                // Written from the idle loop and during playback
+                snprintf(save_path, sizeof(save_path), "%s/%s", DRIVE, rec_filename);
+                sd_sink_add(save_path, take_rec, take_samples, FS, REC_BITS);
+                if (!preview_pending) {
+                    snprintf(save_path, sizeof(save_path), "%s/%s", DRIVE, shifted_filename);
+                    sd_sink_add(save_path, take_out, take_samples, FS, OUT_BITS);
+                }
+#endif
+#else
+                if (shift_wav_on_sd(rec_filename, shifted_filename, pitch_shift_ratio, engine, curve, curve_frames) == 0) {
+                    DLOG_INFO("Successfully saved pitch-shifted audio as 0:/%s!\r\n", shifted_filename);
+                } else {
+                    DLOG_ERROR("Pitch shift failed\r\n");
+                }
+#endif
                 vocoder_done = 1;
+                status_clear();
                 state++;  // Auto-advance
+#if TAKE_PREVIEW
+                if (preview_pending) state = 6;
+#endif
             }
             done_printed = 0;
         }
         // State 5: Complete! (LED double blink then solid)
         else if (state == 5) {
+            status_set_led(STATUS_LED_DOUBLE);
 
             if (!done_printed) {
+                // Everything the take logged, then the summary
+                dlog_drain(0);
                 xil_printf("\r\n*** PROCESSING COMPLETE! ***\r\n");
+#if TAKE_IN_DDR
+                xil_printf("Take is ready in DDR; files are saved in the background:\r\n");
+#else
                 xil_printf("Files generated:\r\n");
+#endif
                 xil_printf("  - 0:/%s (original recording)\r\n", rec_filename);
                 xil_printf("  - 0:/%s (pitch shifted)\r\n", shifted_filename);
+                PROF_REPORT();
                 xil_printf("\r\nPress SW1 to play modified audio\r\n");
                 done_printed = 1;
             }
+#if TAKE_PREVIEW
+            // The render comes first (out_xxx.wav waits for it); one chunk or
+            // one block per pass keeps the button responsive
+            if (take_render_busy) {
+                take_render_step();
+            } else {
+                sd_sink_step();
+            }
+#elif TAKE_IN_DDR
+            // One block per pass keeps the button responsive
+            sd_sink_step();
+#endif
+            dlog_drain(1);
         }
         else if (state == 6) {
+#if TAKE_PREVIEW
+			int preview = preview_pending;
+			preview_pending = 0;
+			// Past the preview, SW1 plays the full render: finish it first
+			while (!preview && take_render_busy) take_render_step();
+			xil_printf(preview ? "\r\n======== Playing Preview ========\r\n" :
+					   "\r\n======== Playing Shifted Audio ========\r\n");
+#else
         	xil_printf("\r\n======== Playing Shifted Audio ========\r\n");
+#endif
 
-			// HARD RESET DMA BEFORE PLAYBACK
-			xil_printf("Resetting DMA...\r\n");
-			XAxiDma_Reset(&AxiDma);
-			while (!XAxiDma_ResetIsDone(&AxiDma));
-
-			// Re-init
-			Cfg = XAxiDma_LookupConfig(DMA_DEV_ID);
-			XAxiDma_CfgInitialize(&AxiDma, Cfg);
-
-			// Clear MM2S + S2MM status registers
-			XAxiDma_WriteReg(AxiDma.RegBase, XAXIDMA_TX_OFFSET + XAXIDMA_SR_OFFSET, 0xFFFFFFFF);
-			XAxiDma_WriteReg(AxiDma.RegBase, XAXIDMA_RX_OFFSET + XAXIDMA_SR_OFFSET, 0xFFFFFFFF);
+			// The DMA stays configured from start-up: capture_stop left S2MM idle
+			// and MM2S is only reset (dma_recover) after an error
 
+#if TAKE_IN_DDR
+			xil_printf("Playback starting...\r\n");
 
-			FIL fplay;
-			UINT br;
+			// Expand the next block from DDR while the queued ones are being sent
+			// (with TAKE_ZERO_COPY the take itself is queued, the same buffer
+			// the SD sink writes from); whenever the queue is full, the SD sink
+			// gets a turn, or the full render while it runs. A render that
+			// finishes now is played next time, not from the middle of this one
+			const int16_t *play = take_play;
+			playback_start(&AxiDma);
+			uint32_t played = 0;
+			while (played < take_samples) {
+				uint32_t samples = take_samples - played;
+				if (samples > PLAYBACK_SAMPLES) samples = PLAYBACK_SAMPLES;
+#if TAKE_ZERO_COPY
+				int got = playback_queue(play + played, (int)(samples + 1) / 2);
+#else
+				uint32_t *tx;
+				int got = playback_acquire(&tx);
+#endif
+				if (got < 0) {
+					xil_printf("TX DMA error\r\n");
+					break;
+				}
+				if (got == 0) {
+#if TAKE_PREVIEW
+					if (take_render_busy) {
+						take_render_step();
+						continue;
+					}
+#endif
+					sd_sink_step();
+					continue;
+				}
+
+#if !TAKE_ZERO_COPY
+				playback_submit(playback_fill(tx, play + played, (int)samples));
+#endif
+				played += samples;
+			}
+			if (playback_finish() != 0) dma_recover();
+#else
+			WavReader fplay;
+			uint32_t got_samples;
 			char path[64];
 			snprintf(path, sizeof(path), "%s/%s", DRIVE, shifted_filename);
 
-			if (f_open(&fplay, path, FA_READ) != FR_OK)
+			if (wav_reader_open(&fplay, path) != FR_OK)
 			{
 				xil_printf("Failed to reopen WAV!\r\n");
 				return XST_FAILURE;
 			}
 
-			f_lseek(&fplay, 44);
 			xil_printf("Playback starting...\r\n");
 
+			// Read and expand the next block while the queued ones are being sent
+			playback_start(&AxiDma);
 			while (1) {
-				if (f_read(&fplay, pcm16, BURST_SAMPLES * sizeof(int16_t), &br) != FR_OK ||
-						br == 0) break;
-
-					int samples = br / (int)sizeof(int16_t);
-
-					for (int i = 0; i < samples; i++)
-					{
-						uint32_t w = i2s_word_from_pcm16(pcm16[i]);
-						tx32[2*i]   = w;
-						tx32[2*i+1] = w;
-					}
-
-					int tx_words = samples * 2;
+				uint32_t *tx;
+				int got = playback_acquire(&tx);
+				if (got < 0) {
+					xil_printf("TX DMA error\r\n");
+					break;
+				}
+				if (got == 0) continue;
 
-					Xil_DCacheFlushRange((UINTPTR)tx32, tx_words * sizeof(uint32_t));
+				if (wav_reader_read(&fplay, play_pcm16, PLAYBACK_SAMPLES, &got_samples) != FR_OK ||
+						got_samples == 0) break;
 
-					int status = XAxiDma_SimpleTransfer(&AxiDma,
-														(UINTPTR)tx32,
-														tx_words * sizeof(uint32_t),
-														XAXIDMA_DMA_TO_DEVICE);
-			
-					while (XAxiDma_Busy(&AxiDma, XAXIDMA_DMA_TO_DEVICE));
-					
+				int samples = (int)got_samples;
 
-					if (status != XST_SUCCESS) {
-						xil_printf("TX DMA transfer setup failed (%d)\r\n", status);
-						break;
-					}
+				playback_submit(playback_fill(tx, play_pcm16, samples));
 			}
-
-			f_close(&fplay);
-			f_mount(NULL, DRIVE, 1);
+			if (playback_finish() != 0) dma_recover();
+#endif
+
+			PlaybackStats pb;
+			playback_get_stats(&pb);
+			xil_printf("Playback: %lu transfers, %lu underruns (~%lu samples of silence)\r\n",
+					   (unsigned long)pb.buffers, (unsigned long)pb.underruns,
+					   (unsigned long)pb.silent_samples);
+
+#if TAKE_PREVIEW
+			if (preview) {
+				// State 5 reports the take and waits for SW1 while the render finishes
+				status_clear();
+				state = 5;
+				done_printed = 0;
+				continue;
+			}
+#endif
+#if TAKE_IN_DDR
+			// Whatever the idle loop and playback did not get to
+			if (sd_sink_flush() != 0) {
+				xil_printf("Some files could not be saved\r\n");
+				sd_unmount();
+			}
+#else
+			wav_reader_close(&fplay);
+#endif
 
 			xil_printf("Playback done.\n");
+			status_clear();
 			state++;
         }
         // State 7+: Reset to state 0
         else if (state >= 7) {
-            // Unmount and remount filesystem for clean state
-            f_mount(NULL, DRIVE, 1);
+            dlog_drain(0);
+            if (arena_active()) {
+                xil_printf("Take memory: peak %lu KB of %lu KB arena\r\n",
+                           (unsigned long)(arena_peak() / 1024), (unsigned long)(arena_size() / 1024));
+            }
+            if (arena_hot_size()) {
+                xil_printf("Hot memory: peak %lu KB of %lu KB OCM, %lu blocks spilled to DDR\r\n",
+                           (unsigned long)(arena_hot_peak() / 1024), (unsigned long)(arena_hot_size() / 1024),
+                           (unsigned long)arena_hot_spills());
+            }
+            arena_reset();
             state = 0;
-            num_files++;
+            num_files = num_files == 999 ? 1 : num_files + 1;
+#if TAKE_SLOTS
+            // The next take's files, while nobody is waiting on the card
+            take_slot_prepare(num_files);
+#endif
             xil_printf("\r\n=== System Reset ===\r\n");
         }
     }  // End of while(1) state machine loop
     
     return 0;
 }
+
+#endif // !TUNER_RTOS
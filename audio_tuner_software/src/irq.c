@@ -0,0 +1,59 @@
+#include "irq.h"
+#include "tuner_rtos.h"
+#include "xil_exception.h"
+#include "xparameters.h"
+
+#if TUNER_RTOS
+#include "FreeRTOS.h"
+
+// The FreeRTOS port owns the GIC and the IRQ vector
+int irq_connect(u32 id, Xil_InterruptHandler handler, void* ref) {
+    if (xPortInstallInterruptHandler((uint8_t)id, handler, ref) != pdPASS) {
+        return -1;
+    }
+    vPortEnableInterrupt((uint8_t)id);
+    return 0;
+}
+
+void irq_disconnect(u32 id) {
+    vPortDisableInterrupt((uint8_t)id);
+}
+
+#else
+
+static XScuGic irq_gic;
+static int irq_ready;
+
+static int irq_init(void) {
+    XScuGic_Config* cfg = XScuGic_LookupConfig(XPAR_SCUGIC_SINGLE_DEVICE_ID);
+    if (!cfg || XScuGic_CfgInitialize(&irq_gic, cfg, cfg->CpuBaseAddress) != XST_SUCCESS) {
+        return -1;
+    }
+    Xil_ExceptionInit();
+    Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_INT,
+                                 (Xil_ExceptionHandler)XScuGic_InterruptHandler, &irq_gic);
+    Xil_ExceptionEnable();
+    irq_ready = 1;
+    return 0;
+}
+
+int irq_connect(u32 id, Xil_InterruptHandler handler, void* ref) {
+    if (!irq_ready && irq_init() != 0) {
+        return -1;
+    }
+    if (XScuGic_Connect(&irq_gic, id, handler, ref) != XST_SUCCESS) {
+        return -1;
+    }
+    XScuGic_Enable(&irq_gic, id);
+    return 0;
+}
+
+void irq_disconnect(u32 id) {
+    if (!irq_ready) {
+        return;
+    }
+    XScuGic_Disable(&irq_gic, id);
+    XScuGic_Disconnect(&irq_gic, id);
+}
+
+#endif // TUNER_RTOS
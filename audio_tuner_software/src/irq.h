@@ -0,0 +1,28 @@
+#ifndef IRQ_H
+#define IRQ_H
+
+#include "xil_types.h"
+#include "xscugic.h"
+
+// One GIC for the whole application. Every module that takes an interrupt
+// (the capture ring, the status timer and switch) connects through here,
+// so the distributor is initialised and the IRQ vector registered once.
+// In the FreeRTOS build (TUNER_RTOS) the port owns both and this hands the
+// handlers to it instead.
+
+/**
+ * Connect and enable an interrupt, initialising the GIC on first use
+ * @param id         GIC interrupt ID (XPAR_..._INTR)
+ * @param handler    Called from the IRQ exception with ref
+ * @param ref        Handler argument
+ * @return           0 on success, -1 if the GIC could not be set up
+ */
+int irq_connect(u32 id, Xil_InterruptHandler handler, void* ref);
+
+/**
+ * Mask and disconnect an interrupt
+ * @param id         GIC interrupt ID
+ */
+void irq_disconnect(u32 id);
+
+#endif // IRQ_H
@@ -0,0 +1,166 @@
+#include <math.h>
+#include <string.h>
+#include "limiter.h"
+#include "fixed_point.h"
+#include "arena.h"
+#include "dlog.h"
+
+#define LIMITER_MAX_LOOKAHEAD   4096
+#define LIMITER_ATTACK_SPANS    5.0f        // Attack time constants per lookahead: 0.7% of a step left at the peak
+
+struct Limiter {
+    LimiterConfig cfg;
+    float attack;           // Per-sample coefficients
+    float release;
+    float gain;
+    float min_gain;
+    uint32_t clamped;
+
+    int mask;               // Ring size - 1 (ring > lookahead)
+    float* ring;            // Delay line, indexed by t & mask
+    uint32_t* peaks;        // Running maximum: times of decreasing magnitudes, oldest first
+    uint32_t head, tail;    // peaks[head & mask] .. peaks[(tail - 1) & mask]
+    uint32_t t;             // Samples pushed since the last reset
+};
+
+// Push one sample and return the one lookahead samples older, limited
+static float limiter_step(Limiter* lim, float x) {
+    const uint32_t t = lim->t;
+    const float v = fabsf(x);
+    const int mask = lim->mask;
+    lim->ring[t & mask] = x;
+
+    // Everything not larger than the new sample can never be the maximum again
+    while (lim->tail != lim->head && fabsf(lim->ring[lim->peaks[(lim->tail - 1) & mask] & mask]) <= v) {
+        lim->tail--;
+    }
+    lim->peaks[lim->tail++ & mask] = t;
+    // Drop what has left the window (the output sample and the lookahead after it)
+    if (t - lim->peaks[lim->head & mask] > (uint32_t)lim->cfg.lookahead) {
+        lim->head++;
+    }
+    const float peak = fabsf(lim->ring[lim->peaks[lim->head & mask] & mask]);
+
+    float target = lim->cfg.max_gain;
+    if (peak * target > lim->cfg.ceiling) {
+        target = lim->cfg.ceiling / peak;
+    }
+    if (peak < lim->cfg.gate && target > 1.0f) {
+        target = lim->gain > 1.0f ? lim->gain : 1.0f;   // Noise: hold any make-up gain, do not add to it
+    }
+    lim->gain += (target - lim->gain) * (target < lim->gain ? lim->attack : lim->release);
+    if (lim->gain < lim->min_gain) {
+        lim->min_gain = lim->gain;
+    }
+
+    float y = lim->ring[(t - (uint32_t)lim->cfg.lookahead) & mask] * lim->gain;
+    if (fabsf(y) > lim->cfg.ceiling) {
+        y = y > 0.0f ? lim->cfg.ceiling : -lim->cfg.ceiling;
+        lim->clamped++;
+    }
+    lim->t = t + 1;
+    return y;
+}
+
+void limiter_default_config(LimiterConfig* cfg) {
+    cfg->lookahead = LIMITER_DEFAULT_LOOKAHEAD;
+    cfg->ceiling = LIMITER_DEFAULT_CEILING;
+    cfg->max_gain = 1.0f;
+    cfg->release = LIMITER_DEFAULT_RELEASE;
+    cfg->gate = LIMITER_DEFAULT_GATE;
+}
+
+Limiter* limiter_create(const LimiterConfig* cfg) {
+    if (cfg->lookahead < 1 || cfg->lookahead > LIMITER_MAX_LOOKAHEAD ||
+        cfg->ceiling <= 0.0f || cfg->ceiling > 1.0f || cfg->max_gain < 1.0f || cfg->release < 1) {
+        DLOG_ERROR("Error: bad limiter config\r\n");
+        return NULL;
+    }
+    Limiter* lim = (Limiter*)arena_calloc(1, sizeof(Limiter));
+    if (!lim) return NULL;
+
+    int ring = 1;
+    while (ring <= cfg->lookahead) ring <<= 1;
+    lim->mask = ring - 1;
+    lim->cfg = *cfg;
+    lim->attack = 1.0f - expf(-LIMITER_ATTACK_SPANS / cfg->lookahead);
+    lim->release = 1.0f - expf(-1.0f / cfg->release);
+
+    lim->ring = (float*)arena_malloc(ring * sizeof(float));
+    lim->peaks = (uint32_t*)arena_malloc(ring * sizeof(uint32_t));
+    if (!lim->ring || !lim->peaks) {
+        DLOG_ERROR("Error: Failed to allocate limiter buffers\r\n");
+        limiter_destroy(lim);
+        return NULL;
+    }
+    limiter_reset(lim);
+    return lim;
+}
+
+void limiter_destroy(Limiter* lim) {
+    if (!lim) return;
+    arena_free(lim->ring);
+    arena_free(lim->peaks);
+    arena_free(lim);
+}
+
+// Empty delay line and unity gain; the stats carry on
+static void limiter_clear(Limiter* lim) {
+    memset(lim->ring, 0, (lim->mask + 1) * sizeof(float));
+    lim->head = lim->tail = 0;
+    lim->t = 0;
+    lim->gain = 1.0f;
+}
+
+void limiter_reset(Limiter* lim) {
+    limiter_clear(lim);
+    lim->min_gain = 1.0f;
+    lim->clamped = 0;
+}
+
+int limiter_latency(const Limiter* lim) {
+    return lim->cfg.lookahead;
+}
+
+void limiter_process(Limiter* lim, const float* in, int n, float* out) {
+    for (int i = 0; i < n; i++) {
+        out[i] = limiter_step(lim, in[i]);
+    }
+}
+
+void limiter_process_q15(Limiter* lim, const int16_t* in, int n, int16_t* out) {
+    for (int i = 0; i < n; i++) {
+        float y = limiter_step(lim, in[i] * (1.0f / 32768.0f));
+        out[i] = q15_sat((int32_t)lrintf(y * 32768.0f));
+    }
+}
+
+int limiter_flush(Limiter* lim, float* out) {
+    if (lim->t == 0) {
+        return 0;
+    }
+    const int n = lim->cfg.lookahead;
+    for (int i = 0; i < n; i++) {
+        out[i] = limiter_step(lim, 0.0f);
+    }
+    limiter_clear(lim);
+    return n;
+}
+
+int limiter_flush_q15(Limiter* lim, int16_t* out) {
+    if (lim->t == 0) {
+        return 0;
+    }
+    const int n = lim->cfg.lookahead;
+    for (int i = 0; i < n; i++) {
+        out[i] = q15_sat((int32_t)lrintf(limiter_step(lim, 0.0f) * 32768.0f));
+    }
+    limiter_clear(lim);
+    return n;
+}
+
+void limiter_get_stats(const Limiter* lim, LimiterStats* stats) {
+    stats->gain = lim->gain;
+    stats->min_gain = lim->min_gain;
+    stats->clamped = lim->clamped;
+}
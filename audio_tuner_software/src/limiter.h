@@ -0,0 +1,116 @@
+#ifndef LIMITER_H
+#define LIMITER_H
+
+#include <stdint.h>
+
+// Streaming look-ahead limiter with optional make-up gain, the output level
+// stage for the pitch shifters.
+//
+// The signal is delayed by `lookahead` samples while the largest magnitude
+// in that window (a running maximum, O(1) per sample on average) sets the
+// gain that keeps it under `ceiling`. The gain follows that target the way
+// supporting_resources/DSP_Hardware/envelope_follower.vhd follows its
+// envelope: a fast attack, fast enough to be down before the peak leaves the
+// delay line, and a slow release. With max_gain > 1 quiet passages are
+// brought up towards the ceiling too (the streaming stand-in for peak
+// normalisation), except below `gate`, where, as in dynamics_core.vhd, the
+// input is taken to be noise and the gain is held. Whatever still exceeds
+// the ceiling is clamped to it, so the stage never clips.
+//
+// Delay is fixed at lookahead samples and memory at one ring of that size
+// (limiter_create, arena_malloc); processing can run in place, so a block
+// of n samples in is n samples out.
+
+#define LIMITER_DEFAULT_LOOKAHEAD   64          // 1.3 ms at 48 kHz
+#define LIMITER_DEFAULT_CEILING     0.98f       // Of full scale (-0.2 dBFS)
+#define LIMITER_DEFAULT_RELEASE     4800        // Samples for the gain to recover 63% (100 ms at 48 kHz)
+#define LIMITER_DEFAULT_GATE        (1.0f / 256) // dynamics_core's GATE_LEVEL (-48 dBFS)
+
+typedef struct {
+    int lookahead;              // Delay, and how far ahead peaks are seen (1 .. 4096 samples)
+    float ceiling;              // Output peak limit, fraction of full scale (0 .. 1]
+    float max_gain;             // Largest gain applied; 1 for a pure limiter
+    int release;                // Gain recovery time constant, samples
+    float gate;                 // Below this level the gain is held, fraction of full scale
+} LimiterConfig;
+
+typedef struct {
+    float gain;                 // Gain in use
+    float min_gain;             // Smallest gain since the last reset
+    uint32_t clamped;           // Samples that still had to be clamped to the ceiling
+} LimiterStats;
+
+typedef struct Limiter Limiter;
+
+/**
+ * Fill a config with the defaults (LIMITER_DEFAULT_*, max_gain 1)
+ * @param cfg         Config to fill
+ */
+void limiter_default_config(LimiterConfig* cfg);
+
+/**
+ * Create a limiter
+ * @param cfg         Config (copied)
+ * @return            New limiter (free with limiter_destroy), or NULL on a bad config or allocation failure
+ */
+Limiter* limiter_create(const LimiterConfig* cfg);
+
+/**
+ * Free a limiter
+ * @param lim         Limiter from limiter_create (NULL is ignored)
+ */
+void limiter_destroy(Limiter* lim);
+
+/**
+ * Clear the delay line, set the gain back to 1 and zero the stats
+ * @param lim         Limiter from limiter_create
+ */
+void limiter_reset(Limiter* lim);
+
+/**
+ * @param lim         Limiter from limiter_create
+ * @return            Delay in samples; output i + latency corresponds to input i
+ */
+int limiter_latency(const Limiter* lim);
+
+/**
+ * Limit a float block (full scale +-1); in and out may be the same buffer
+ * @param lim         Limiter from limiter_create
+ * @param in          n input samples
+ * @param n           Number of samples
+ * @param out         Receives n samples
+ */
+void limiter_process(Limiter* lim, const float* in, int n, float* out);
+
+/**
+ * Limit a Q15 block; in and out may be the same buffer
+ * @param lim         Limiter from limiter_create
+ * @param in          n input samples
+ * @param n           Number of samples
+ * @param out         Receives n samples
+ */
+void limiter_process_q15(Limiter* lim, const int16_t* in, int n, int16_t* out);
+
+/**
+ * Drain the delay line and start a new stream (the stats carry on until limiter_reset)
+ * @param lim         Limiter from limiter_create
+ * @param out         Room for limiter_latency() samples
+ * @return            Number of samples written to out (0 if nothing was pushed)
+ */
+int limiter_flush_q15(Limiter* lim, int16_t* out);
+
+/**
+ * Float version of limiter_flush_q15
+ * @param lim         Limiter from limiter_create
+ * @param out         Room for limiter_latency() samples
+ * @return            Number of samples written to out
+ */
+int limiter_flush(Limiter* lim, float* out);
+
+/**
+ * @param lim         Limiter from limiter_create
+ * @param stats       Receives the gain and counters since the last limiter_reset
+ */
+void limiter_get_stats(const Limiter* lim, LimiterStats* stats);
+
+#endif // LIMITER_H
@@ -0,0 +1,362 @@
+#include <math.h>
+#include <string.h>
+#include "live_tune.h"
+#include "capture.h"
+#include "playback.h"
+#include "shift_engine.h"
+#include "scale.h"
+#include "YinTracker.h"
+#include "yin_rpu.h"
+#include "fixed_point.h"
+#include "arena.h"
+#include "xtime_l.h"
+#include "xparameters.h"
+
+// Defaults: 21.3 ms capture segment + 8 ms vocoder + 5.3 ms preroll = 34.7 ms
+#define LIVE_TUNE_FFT_SIZE      512
+#define LIVE_TUNE_HOP           128
+#define LIVE_TUNE_WINDOW        1024    // Tracks down to about 94 Hz
+#define LIVE_TUNE_THRESHOLD     0.15f
+#define LIVE_TUNE_MIN_PROB      0.6f
+#define LIVE_TUNE_GLIDE         0.25f
+#define LIVE_TUNE_PREROLL       CAPTURE_BURST_SAMPLES
+#define LIVE_TUNE_BUDGET_MS     40.0f
+#ifndef LIVE_TUNE_ENGINE
+#define LIVE_TUNE_ENGINE        SHIFT_ENGINE_AUTO
+#endif
+#ifndef LIVE_TUNE_KEY
+#define LIVE_TUNE_KEY           0       // Pitch class of the tonic, 0 = C
+#endif
+#ifndef LIVE_TUNE_SCALE
+#define LIVE_TUNE_SCALE         SCALE_CHROMATIC
+#endif
+#ifndef LIVE_TUNE_PV_PITCH
+#define LIVE_TUNE_PV_PITCH      0       // 1: vocoder pitch estimate first, Yin when it is unsure
+#endif
+#define LIVE_TUNE_PV_MIN_CONF   0.8f
+#define LIVE_TUNE_CPU_SHARE     0.5f    // Of the core the shifter may use (auto selection)
+
+#define LT_N                    CAPTURE_BURST_SAMPLES
+#define LT_BURST_US             ((uint32_t)((uint64_t)LT_N * 1000000 / CAPTURE_FS))
+
+static const int16_t lt_silence[PLAYBACK_SAMPLES];
+
+static XAxiDma* lt_dma;
+static LiveTuneConfig lt_cfg;
+static YinTracker lt_tracker;
+static ShiftEngine lt_shift;
+// Touched every burst: on-chip with the shifter's tables
+static int16_t lt_in[LT_N] ARENA_HOT;
+static int16_t lt_out[LT_N + LIVE_TUNE_MAX_HOP + 1] ARENA_HOT;
+static int lt_pv_latency;
+static int lt_pb_started;               // Preroll queued, speaker draining
+static XTime lt_cap_t0;                 // capture_start
+static XTime lt_pb_t0;                  // First playback buffer queued
+static uint64_t lt_pv_total;            // Shifter output samples produced
+static uint64_t lt_out_total;           // Samples queued to the speaker (preroll included)
+static float lt_ratio;                  // Glided ratio
+static float lt_set_ratio;              // Ratio the shifter runs at
+static int lt_remote;                   // The R5 tracks (YIN_RPU)
+static LiveTuneStats lt_stats;
+static Scale lt_scale;                  // Notes the ratio moves to
+
+void live_tune_default_config(LiveTuneConfig* cfg) {
+    cfg->fft_size = LIVE_TUNE_FFT_SIZE;
+    cfg->hop = LIVE_TUNE_HOP;
+    cfg->window = LIVE_TUNE_WINDOW;
+    cfg->threshold = LIVE_TUNE_THRESHOLD;
+    cfg->min_probability = LIVE_TUNE_MIN_PROB;
+    cfg->glide = LIVE_TUNE_GLIDE;
+    cfg->preroll = LIVE_TUNE_PREROLL;
+    cfg->budget_ms = LIVE_TUNE_BUDGET_MS;
+    cfg->engine = LIVE_TUNE_ENGINE;
+    cfg->key = LIVE_TUNE_KEY;
+    cfg->scale = LIVE_TUNE_SCALE;
+    cfg->pv_pitch = LIVE_TUNE_PV_PITCH;
+    cfg->pv_min_confidence = LIVE_TUNE_PV_MIN_CONF;
+}
+
+float live_tune_ms(uint32_t samples) {
+    return samples * 1000.0f / CAPTURE_FS;
+}
+
+// Samples of the stream clock elapsed since t0
+static uint64_t lt_due(XTime t0, XTime now) {
+    return (uint64_t)(now - t0) * CAPTURE_FS / COUNTS_PER_SECOND;
+}
+
+float live_tune_note_ratio(float pitch) {
+    float ratio;
+    scale_quantize_note(&scale_chromatic, pitch, &ratio);
+    return ratio;
+}
+
+// Glide towards the nearest note of the scale
+static void lt_retune(float pitch, float probability) {
+    float target = 1.0f;
+    int voiced = pitch > 0.0f && probability >= lt_cfg.min_probability;
+    if (voiced) {
+        scale_quantize_note(&lt_scale, pitch, &target);
+    }
+    lt_ratio += (target - lt_ratio) * lt_cfg.glide;
+    // PSOLA places its pitch marks from the same estimate
+    shift_engine_set_pitch(&lt_shift, voiced ? pitch : -1.0f);
+
+    if (fabsf(lt_ratio - lt_set_ratio) > LIVE_TUNE_RETUNE_STEP * lt_set_ratio) {
+        shift_engine_set_ratio(&lt_shift, lt_ratio);
+        lt_set_ratio = shift_engine_get_ratio(&lt_shift);
+        lt_stats.retunes++;
+    }
+    lt_stats.pitch = pitch;
+    lt_stats.ratio = lt_set_ratio;
+}
+
+// Queue n samples; returns the samples the speaker will play (odd counts are padded), 0 if no buffer, -1 on error
+static int lt_queue(const int16_t* pcm, int n) {
+    uint32_t* words;
+    int got = playback_acquire(&words);
+    if (got <= 0) {
+        return got;
+    }
+    int nwords = playback_fill(words, pcm, n);
+    playback_submit(nwords);
+    return nwords * PLAYBACK_WORD_SLOTS / 2;
+}
+
+// Start the speaker on the first burst, so the preroll is not played out
+// while the first capture segment is still filling
+static int lt_start_playback(void) {
+    playback_start(lt_dma);
+    XTime_GetTime(&lt_pb_t0);
+    for (int left = lt_cfg.preroll; left > 0; ) {
+        int n = left < PLAYBACK_SAMPLES ? left : PLAYBACK_SAMPLES;
+        int sent = lt_queue(lt_silence, n);
+        if (sent <= 0) {
+            return -1;
+        }
+        lt_out_total += sent;
+        left -= n;
+    }
+    lt_pb_started = 1;
+    return 0;
+}
+
+int live_tune_start(XAxiDma* dma, const LiveTuneConfig* cfg) {
+    if (cfg->hop < 1 || cfg->hop > LIVE_TUNE_MAX_HOP || cfg->preroll < 0 ||
+        cfg->preroll > (PLAYBACK_BUFFERS - 1) * PLAYBACK_SAMPLES) {
+        return -1;
+    }
+    lt_dma = dma;
+    lt_cfg = *cfg;
+    if (lt_cfg.glide <= 0.0f || lt_cfg.glide > 1.0f) {
+        lt_cfg.glide = 1.0f;
+    }
+    if (scale_init(&lt_scale, cfg->key, cfg->scale, SCALE_A4) != 0) {
+        return -1;
+    }
+
+    if (YinTracker_init(&lt_tracker, cfg->window, cfg->threshold) != 0) {
+        return -1;
+    }
+
+    // PSOLA marks follow the tracker, so its longest period is the tracker's
+    ShiftEngineConfig shift_cfg;
+    shift_engine_default_config(&shift_cfg);
+    shift_cfg.fft_size = cfg->fft_size;
+    shift_cfg.hop = cfg->hop;
+    shift_cfg.max_period = cfg->window / 2;
+    shift_cfg.external_pitch = 1;
+    shift_cfg.estimate_pitch = cfg->pv_pitch;
+    ShiftEngineId engine = cfg->engine;
+    if (engine == SHIFT_ENGINE_AUTO) {
+        // Whatever the budget leaves after the capture segment and the preroll
+        int budget = (int)(cfg->budget_ms * CAPTURE_FS / 1000.0f) - CAPTURE_SEG_SAMPLES - cfg->preroll;
+        ShiftRequest req = {
+            1.0f, 1.0f, budget > 1 ? budget : 1,
+            (uint32_t)(LIVE_TUNE_CPU_SHARE * XPAR_CPU_CORTEXA53_0_CPU_CLK_FREQ_HZ / CAPTURE_FS)
+        };
+        engine = shift_engine_select(&req, &shift_cfg);
+    }
+    if (shift_engine_open(&lt_shift, engine, &shift_cfg, 1.0f) != 0) {
+        YinTracker_free(&lt_tracker);
+        return -1;
+    }
+
+    memset(&lt_stats, 0, sizeof(lt_stats));
+    lt_stats.engine = engine;
+    lt_pv_latency = shift_engine_latency(&lt_shift);
+    lt_stats.latency_fixed = CAPTURE_SEG_SAMPLES + lt_pv_latency + cfg->preroll;
+    lt_stats.latency_min = UINT32_MAX;
+    lt_stats.pitch = -1.0f;
+    lt_stats.ratio = 1.0f;
+    lt_ratio = 1.0f;
+    lt_set_ratio = 1.0f;
+    lt_pv_total = 0;
+    lt_out_total = 0;
+    lt_pb_started = 0;
+    lt_remote = 0;
+#if YIN_RPU
+    lt_remote = yin_rpu_open(cfg->window, cfg->threshold);
+#endif
+
+    if (capture_start() != 0) {
+        live_tune_stop();
+        return -1;
+    }
+    XTime_GetTime(&lt_cap_t0);
+    return 0;
+}
+
+int live_tune_step(void) {
+    const uint32_t* rx;
+    int got = capture_next(&rx);
+    if (got <= 0) {
+        // Keep the speaker queue moving between bursts
+        uint32_t* words;
+        if (got < 0 || (lt_pb_started && playback_acquire(&words) < 0)) {
+            return -1;
+        }
+        return 0;
+    }
+
+    XTime t0;
+    XTime_GetTime(&t0);
+#if CAPTURE_PL_PACK
+    memcpy(lt_in, rx, sizeof(lt_in));
+#else
+    pcm_from_capture(rx, lt_in, LT_N);
+#endif
+    capture_release();
+
+#if YIN_RPU
+    if (lt_remote) {
+        // The R5 runs a burst or so behind; retune on the newest frame it has
+        if (yin_rpu_post(lt_in, LT_N) != 0) {
+            lt_stats.remote_drops++;
+        }
+        YinRpuFrame f, last;
+        int have = 0;
+        while (yin_rpu_poll(&f)) {
+            last = f;
+            have = 1;
+            lt_stats.remote_frames++;
+        }
+        if (have) {
+            lt_retune(last.pitch, last.probability);
+        }
+    } else
+#endif
+    {
+        // The vocoder's newest frame ends at the previous burst
+        float pitch, confidence;
+        if (lt_cfg.pv_pitch && shift_engine_get_pitch(&lt_shift, &pitch, &confidence) == 0 &&
+            pitch > 0.0f && confidence >= lt_cfg.pv_min_confidence) {
+            YinTracker_skip(&lt_tracker, lt_in, LT_N);
+            lt_retune(pitch, confidence);
+            lt_stats.pv_pitch_bursts++;
+        } else {
+            pitch = YinTracker_push(&lt_tracker, lt_in, LT_N);
+            lt_retune(pitch, YinTracker_getProbability(&lt_tracker));
+        }
+    }
+    int n = shift_engine_process(&lt_shift, lt_in, LT_N, lt_out);
+    lt_pv_total += n;
+
+    if (!lt_pb_started && lt_start_playback() != 0) {
+        return -1;
+    }
+
+    // Samples still queued ahead of the speaker (its model counts underrun silence as played)
+    XTime now;
+    XTime_GetTime(&now);
+    PlaybackStats ps;
+    playback_get_stats(&ps);
+    int64_t ahead = (int64_t)(lt_out_total + ps.silent_samples) - (int64_t)lt_due(lt_pb_t0, now);
+    if (ahead < 0) {
+        ahead = 0;
+    }
+
+    // A segment's bursts arrive together, so the queue swings by a segment;
+    // past that, drop the oldest output of this burst
+    int drop = 0;
+    if (ahead - lt_cfg.preroll > CAPTURE_SEG_SAMPLES) {
+        drop = (int)(ahead - lt_cfg.preroll);
+        if (drop > n) drop = n;
+        lt_stats.dropped_samples += drop;
+    }
+
+    if (n > drop) {
+        int sent = lt_queue(lt_out + drop, n - drop);
+        if (sent < 0) {
+            return -1;
+        }
+        if (sent == 0) {
+            lt_stats.full_drops++;
+            lt_stats.dropped_samples += n - drop;
+        } else {
+            lt_out_total += sent;
+
+            // The last sample queued is shifter output lt_pv_total - 1, i.e.
+            // input sample lt_pv_total - 1 - latency; it plays once the
+            // queue ahead of it has drained
+            CaptureStats cs;
+            capture_get_stats(&cs);
+            int64_t in_index = (int64_t)lt_pv_total - 1 - lt_pv_latency + cs.lost_samples;
+            int64_t lat = (int64_t)lt_due(lt_cap_t0, now) - in_index + ahead + sent;
+            if (lat < 0) lat = 0;
+            lt_stats.latency_last = (uint32_t)lat;
+            if (lt_stats.latency_last < lt_stats.latency_min) lt_stats.latency_min = lt_stats.latency_last;
+            if (lt_stats.latency_last > lt_stats.latency_max) lt_stats.latency_max = lt_stats.latency_last;
+            if (live_tune_ms(lt_stats.latency_last) > lt_cfg.budget_ms) {
+                lt_stats.over_budget++;
+            }
+        }
+    }
+
+    XTime t1;
+    XTime_GetTime(&t1);
+    uint32_t us = (uint32_t)((uint64_t)(t1 - t0) * 1000000 / COUNTS_PER_SECOND);
+    lt_stats.bursts++;
+    lt_stats.sum_proc_us += us;
+    if (us > lt_stats.max_proc_us) lt_stats.max_proc_us = us;
+    if (us > LT_BURST_US) lt_stats.deadline_misses++;
+    return 1;
+}
+
+int live_tune_stop(void) {
+    int err = 0;
+    capture_stop();
+    if (lt_pb_started && playback_finish() != 0) {
+        err = -1;
+    }
+
+    CaptureStats cs;
+    capture_get_stats(&cs);
+    if (cs.dma_errors) {
+        err = -1;
+    }
+    lt_stats.lost_samples = cs.lost_samples;
+    if (lt_pb_started) {
+        PlaybackStats ps;
+        playback_get_stats(&ps);
+        lt_stats.underruns = ps.underruns;
+    }
+    lt_pb_started = 0;
+#if YIN_RPU
+    if (lt_remote) {
+        yin_rpu_close();
+        lt_remote = 0;
+    }
+#endif
+
+    shift_engine_close(&lt_shift);
+    YinTracker_free(&lt_tracker);
+    return err;
+}
+
+void live_tune_get_stats(LiveTuneStats* stats) {
+    *stats = lt_stats;
+    if (stats->latency_min == UINT32_MAX) {
+        stats->latency_min = 0;
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef LIVE_TUNE_H
+#define LIVE_TUNE_H
+
+#include <stdint.h>
+#include "xaxidma.h"
+
+// Continuous mic -> retune -> speaker path.
+// Every capture burst goes through a sliding Yin tracker and the streaming
+// phase vocoder and straight on to the playback queue; the ratio follows the
+// tracked pitch to the nearest note of the configured scale (scale.h).
+// Nothing is stored.
+//
+// End-to-end latency is the capture segment (the CPU sees a segment only
+// when it is complete), the shifter delay (fft_size - hop for the vocoder,
+// plus the output limiter's look-ahead) and the samples queued ahead of the
+// speaker. The first two are fixed by the build and the
+// config; the queue is held at `preroll` samples: when it grows past that by
+// more than a capture segment (after an underrun inserted silence, or when
+// the speaker clock runs slow) output is dropped to pull it back, so latency
+// does not creep.
+//
+// Latency is measured rather than assumed: both engines model their sample
+// clock from the timer (the capture FIFO fill, the speaker drain), so the
+// time between a sample reaching the mic and the same sample leaving the
+// speaker follows from the counters whenever a burst is queued. A burst
+// misses its deadline when converting, tracking and shifting it takes
+// longer than the burst lasts.
+//
+// The shifter is a shift_engine.h engine. With the PSOLA engine the pitch
+// marks come from the same tracker estimate: only a few multiply-adds per
+// sample, but a longer delay (1.5 tracker windows), so the automatic choice
+// takes it only when budget_ms leaves room for that delay.
+//
+// With YIN_RPU=1 and an R5 running the tracker firmware (yin_rpu.h), the
+// bursts are tracked there instead and the ratio follows the newest frame
+// the R5 has returned; the local tracker stays the fallback.
+//
+// With pv_pitch set and the vocoder engine, the vocoder estimates the pitch
+// of every frame from its own analysis (pv_pitch.h), and a burst the
+// vocoder's newest frame is sure of (pv_min_confidence) is retuned from that
+// instead: the tracker only keeps the burst's samples and does no Yin work.
+// A burst it is unsure of (silence, a low voice the frame does not resolve)
+// goes to the tracker, which estimates it from its window as usual.
+
+#define LIVE_TUNE_MAX_HOP       256     // Sizes the output staging buffer
+#define LIVE_TUNE_RETUNE_STEP   0.0006f // Smallest ratio change worth a resampler rebuild (about one cent)
+
+typedef struct {
+    int fft_size;               // Vocoder frame (power of two)
+    int hop;                    // Vocoder analysis hop (<= LIVE_TUNE_MAX_HOP)
+    int window;                 // Yin tracker window (even)
+    float threshold;            // Yin threshold
+    float min_probability;      // Below this the pitch is ignored and the ratio glides back to 1
+    float glide;                // Fraction of the way to the target ratio per burst (0 .. 1]
+    int preroll;                // Samples kept queued ahead of the speaker
+    float budget_ms;            // Latency the config is expected to meet
+    int engine;                 // ShiftEngineId; SHIFT_ENGINE_AUTO picks the cheapest that meets budget_ms
+    int key;                    // Pitch class of the scale's tonic, 0 = C
+    uint16_t scale;             // Allowed notes relative to the key (SCALE_* mask)
+    int pv_pitch;               // 1: take the pitch from the vocoder's analysis when it is sure of it
+    float pv_min_confidence;    // Below this the burst goes to the Yin tracker
+} LiveTuneConfig;
+
+typedef struct {
+    uint32_t bursts;            // Bursts processed
+    uint32_t deadline_misses;   // Bursts that took longer than a burst period to process
+    uint32_t max_proc_us;       // Longest burst processing time
+    uint32_t sum_proc_us;       // Total processing time (for the average)
+    uint32_t latency_fixed;     // Capture segment + shifter + preroll, in samples
+    uint32_t latency_min;       // Measured end-to-end latency range, in samples
+    uint32_t latency_max;
+    uint32_t latency_last;
+    uint32_t over_budget;       // Bursts measured above budget_ms
+    uint32_t dropped_samples;   // Output dropped to hold the queue at preroll
+    uint32_t full_drops;        // Bursts dropped because every playback buffer was queued
+    uint32_t retunes;           // Ratio changes passed to the shifter
+    int engine;                 // ShiftEngineId in use
+    float pitch;                // Latest tracked pitch (Hz, -1 if none)
+    float ratio;                // Ratio in use
+    uint32_t underruns;         // From the playback engine
+    uint32_t lost_samples;      // From the capture engine
+    uint32_t remote_frames;     // Pitch frames returned by the R5 (YIN_RPU)
+    uint32_t remote_drops;      // Bursts the R5 ring had no room for
+    uint32_t pv_pitch_bursts;   // Bursts retuned from the vocoder's estimate (pv_pitch)
+} LiveTuneStats;
+
+/**
+ * Fill a config with the defaults (LIVE_TUNE_* in live_tune.c)
+ * @param cfg        Config to fill
+ */
+void live_tune_default_config(LiveTuneConfig* cfg);
+
+/**
+ * Allocate the tracker and vocoder and start capture; playback starts with
+ * the preroll on the first burst. capture_init must have been called on the
+ * same DMA.
+ * @param dma        Initialised simple-mode DMA (both channels)
+ * @param cfg        Config (copied)
+ * @return           0 on success, -1 on a bad config (an empty scale included), allocation or DMA failure
+ */
+int live_tune_start(XAxiDma* dma, const LiveTuneConfig* cfg);
+
+/**
+ * Process the next burst if one has arrived
+ * @return           1 if a burst was processed, 0 if none was ready, -1 on a DMA error
+ */
+int live_tune_step(void);
+
+/**
+ * Stop capture, let the queued output play out and free the buffers
+ * @return           0 on success, -1 if a DMA channel reported an error
+ */
+int live_tune_stop(void);
+
+/**
+ * @param stats      Receives the counters since live_tune_start
+ */
+void live_tune_get_stats(LiveTuneStats* stats);
+
+/**
+ * Ratio that moves a pitch to the nearest equal-tempered note (A4 = 440 Hz)
+ * @param pitch      Tracked pitch in Hz (> 0)
+ * @return           Target pitch ratio
+ */
+float live_tune_note_ratio(float pitch);
+
+/**
+ * Convert a sample count at the stream rate to milliseconds
+ * @param samples    Samples at CAPTURE_FS
+ * @return           Milliseconds
+ */
+float live_tune_ms(uint32_t samples);
+
+#endif // LIVE_TUNE_H
@@ -2,272 +2,869 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include "phase_voc.h"
+#include "fft.h"
+#include "pv_kernels.h"
+#include "resampler.h"
+#include "fixed_point.h"
+#include "arena.h"
+#include "prof.h"
+#include "dlog.h"
+#include "limiter.h"
+#if PV_MULTICORE
+#include "pv_mc.h"
+#endif
+#if PV_PL_FFT
+#include "pv_pl_fft.h"
+#endif
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
 // Configuration
-#define FFT_SIZE 2048
-#define HOP_SIZE 512
+#define FFT_SIZE PV_DEFAULT_FFT_SIZE
+#define HOP_SIZE PV_DEFAULT_HOP
 #define OVERLAP_FACTOR (FFT_SIZE / HOP_SIZE)
 
-// Structure to hold audio data
-typedef struct {
-    float* data;
-    int length;
-    int sample_rate;
-} AudioBuffer;
-
-// Complex number structure
-typedef struct {
-    float real;
-    float imag;
-} Complex;
+// Input chunk size used by the whole-buffer wrapper
+#define PV_BLOCK_SIZE 4096
+#define PV_WAV_WRITE_FRAMES     256     // Frames write_wav_file interleaves at a time
+#define PV_NORMALISE_PEAK       0.9f    // Output level phase_vocoder_pitch_shift aims for
+#define PV_NORMALISE_MAX_GAIN   8.0f    // Most it brings a quiet take up (+18 dB)
 
 // Hanning window function
 static inline float hanning(int n, int N) {
     return 0.5f * (1.0f - cosf(2.0f * M_PI * n / (N - 1)));
 }
 
-// Simple FFT implementation (Cooley-Tukey)
-void fft(Complex* x, int N) {
-    if (N <= 1) return;
-    
-    // Divide
-    Complex* even = (Complex*)malloc(N/2 * sizeof(Complex));
-    Complex* odd = (Complex*)malloc(N/2 * sizeof(Complex));
-    
-    for (int i = 0; i < N/2; i++) {
-        even[i] = x[i*2];
-        odd[i] = x[i*2 + 1];
+// Streaming phase vocoder state.
+// Pitch shift = time-stretch by ratio (synthesis hop = hop * ratio), then
+// resample the stretched stream by 1/ratio so the duration is unchanged.
+// Everything is sized from fft_size, so memory does not grow with the take.
+struct PhaseVocoder {
+    int fft_size;
+    int num_bins;           // fft_size / 2 + 1
+    int hop;                // Analysis hop
+    int synth_hop;          // Synthesis hop (hop * ratio)
+    float ratio;
+    float ola_gain;         // Undoes the window-squared overlap gain at synth_hop
+    float window_energy;    // Sum of window^2 (ola_gain = synth_hop / window_energy)
+
+    const float* curve;     // Ratio per frame (pv_set_ratio_curve), NULL for a fixed ratio
+    int curve_frames;
+    int curve_pos;          // Next frame's entry
+    float hop_carry;        // Fraction of a synthesis sample carried to the next frame
+
+    RealFFTPlan plan;
+    void* plan_mem;         // The plan's tables (hot memory)
+    float* window;
+    float* frame;           // Windowed analysis frame / synthesised frame
+    SpectralFrame spec;     // DC..Nyquist bins as re/im/magnitude/phase planes
+    void* spec_mem;
+    float* last_phase;
+    float* sum_phase;
+
+    int phase_lock;         // Identity phase locking instead of per-bin phase advance
+    PvkLockState lock;      // Locked: previous analysis/synthesis planes, peak scratch
+    void* lock_mem;         // One block behind lock (NULL until locking is turned on)
+
+    int spectral;           // Shift by moving bins (synth_hop = hop, no resampler)
+    float* shift_mag;       // Spectral: shifted magnitudes
+    float* shift_freq;      // Per-bin frequency estimates (spectral shift, pitch estimate)
+
+    int voices;             // Harmony voices besides the lead (spectral only)
+    float voice_interval[PV_MAX_VOICES];
+    float voice_gain[PV_MAX_VOICES];
+    float* voice_phase[PV_MAX_VOICES];      // Each voice's synthesis phases (allocated on first use)
+
+    int pitch_on;           // Estimate each frame's pitch (pv_set_pitch_estimate)
+    PvPitchConfig pitch_cfg;
+    PvPitch pitch;          // Newest frame's estimate
+
+    float* in_ring;         // Last fft_size input samples (circular)
+    int in_pos;             // Next write index in in_ring
+    int in_count;           // Samples received since the last frame
+
+    float* ola_ring;        // Overlap-add accumulator (circular, fft_size)
+    int ola_pos;            // Start of the next frame in ola_ring
+
+    float* stretched;       // synth_hop finished samples from the OLA ring
+    Resampler resampler;    // Stretched stream -> output rate (step = ratio)
+
+    float* q15_in;          // One hop of converted Q15 input
+    float* q15_out;         // Output of one hop before conversion to Q15
+
+    int mc_workers;         // Worker cores analysing frames (0 = all on this core)
+    int mc_lane;            // Queue lane claimed (pv_mc_open)
+    int mc_head;            // Next queue slot to post
+    int mc_pending;         // Frames posted but not yet synthesised
+
+    int pl_active;          // Transforms run on the fabric FFT
+    int pl_next;            // Buffer pair for the next frame
+    int pl_pending;         // A forward transform is waiting to be synthesised
+};
+
+// Fill coefficients that depend on the ratio (synthesis hop and OLA gain)
+static void pv_set_hops(PhaseVocoder* pv, float pitch_ratio) {
+    // Clamp pitch ratio
+    if (pitch_ratio < 0.5f) pitch_ratio = 0.5f;
+    if (pitch_ratio > 2.0f) pitch_ratio = 2.0f;
+
+    pv->ratio = pitch_ratio;
+    // Spectral shifting keeps the analysis hop and needs no resampler
+    pv->synth_hop = pv->spectral ? pv->hop : (int)(pv->hop * pitch_ratio);
+    if (pv->synth_hop < 1) pv->synth_hop = 1;
+    pv->ola_gain = pv->synth_hop / pv->window_energy;
+
+    // History is cleared by pv_reset; a live retune keeps it
+    if (!pv->spectral) {
+        resampler_set_step(&pv->resampler, pitch_ratio);
     }
-    
-    // Conquer
-    fft(even, N/2);
-    fft(odd, N/2);
-    
-    // Combine
-    for (int k = 0; k < N/2; k++) {
-        float angle = -2.0f * M_PI * k / N;
-        Complex t;
-        t.real = cosf(angle) * odd[k].real - sinf(angle) * odd[k].imag;
-        t.imag = cosf(angle) * odd[k].imag + sinf(angle) * odd[k].real;
-        
-        x[k].real = even[k].real + t.real;
-        x[k].imag = even[k].imag + t.imag;
-        
-        x[k + N/2].real = even[k].real - t.real;
-        x[k + N/2].imag = even[k].imag - t.imag;
+}
+
+PhaseVocoder* pv_create(int fft_size, int hop, float pitch_ratio) {
+    if (hop < 1 || hop > fft_size / 4) {
+        DLOG_ERROR("Error: Hop %d invalid for FFT size %d\r\n", hop, fft_size);
+        return NULL;
     }
-    
-    free(even);
-    free(odd);
+
+    PhaseVocoder* pv = (PhaseVocoder*)arena_calloc(1, sizeof(PhaseVocoder));
+    if (!pv) return NULL;
+
+    // Per-frame tables and scratch go to on-chip memory; only the caller's
+    // take buffers are streamed from DDR
+    pv->plan_mem = arena_hot_malloc(rfft_plan_bytes(fft_size));
+    if (rfft_plan_init_in(&pv->plan, fft_size, pv->plan_mem) != 0) {
+        DLOG_ERROR("Error: Failed to build FFT tables for size %d\r\n", fft_size);
+        arena_free(pv->plan_mem);
+        arena_free(pv);
+        return NULL;
+    }
+
+    pv->fft_size = fft_size;
+    pv->num_bins = fft_size / 2 + 1;
+    pv->hop = hop;
+
+    pv->window = (float*)arena_hot_malloc(fft_size * sizeof(float));
+    pv->frame = (float*)arena_hot_malloc(fft_size * sizeof(float));
+    pv->spec_mem = arena_hot_malloc(spectral_frame_bytes(pv->num_bins));
+    pv->last_phase = (float*)arena_hot_malloc(pv->num_bins * sizeof(float));
+    pv->sum_phase = (float*)arena_hot_malloc(pv->num_bins * sizeof(float));
+    pv->in_ring = (float*)arena_hot_malloc(fft_size * sizeof(float));
+    pv->ola_ring = (float*)arena_hot_malloc(fft_size * sizeof(float));
+    // Largest synthesis hop is 2 * hop (ratio clamped to 2.0)
+    pv->stretched = (float*)arena_hot_malloc(2 * hop * sizeof(float));
+    // One hop of input yields at most one frame, i.e. hop + 2 resampled samples
+    pv->q15_in = (float*)arena_hot_malloc(hop * sizeof(float));
+    pv->q15_out = (float*)arena_hot_malloc((hop + 2) * sizeof(float));
+
+    if (!pv->window || !pv->frame || spectral_frame_init(&pv->spec, pv->num_bins, pv->spec_mem) != 0 ||
+        !pv->last_phase || !pv->sum_phase || !pv->in_ring || !pv->ola_ring || !pv->stretched ||
+        !pv->q15_in || !pv->q15_out) {
+        DLOG_ERROR("Error: Failed to allocate phase vocoder buffers\r\n");
+        pv_destroy(pv);
+        return NULL;
+    }
+
+    // Generate Hanning window
+    for (int i = 0; i < fft_size; i++) {
+        pv->window[i] = hanning(i, fft_size);
+        pv->window_energy += pv->window[i] * pv->window[i];
+    }
+
+    pv_set_hops(pv, pitch_ratio);
+#if PV_MULTICORE
+    pv->mc_workers = pv_mc_open(fft_size, &pv->mc_lane);
+    if (pv->mc_workers > 0) {
+        DLOG_INFO("Phase vocoder: frame analysis on %d worker cores\r\n", pv->mc_workers);
+    }
+#endif
+#if PV_PL_FFT
+    pv->pl_active = (pv_pl_fft_open(fft_size) == 0);
+    if (pv->pl_active) {
+        DLOG_INFO("Phase vocoder: FFTs on the fabric engine\r\n");
+    }
+#endif
+    if (PV_PHASE_LOCK) {
+        pv_set_phase_lock(pv, 1);       // Stays on the per-bin advance if it cannot
+    }
+    if (PV_SPECTRAL_SHIFT) {
+        pv_set_spectral_shift(pv, 1);   // Stays on stretch and resample if it cannot
+    }
+    pv_reset(pv);
+    return pv;
 }
 
-// Inverse FFT
-void ifft(Complex* x, int N) {
-    // Conjugate
-    for (int i = 0; i < N; i++) {
-        x[i].imag = -x[i].imag;
+void pv_destroy(PhaseVocoder* pv) {
+    if (!pv) return;
+#if PV_MULTICORE
+    if (pv->mc_workers > 0) {
+        pv_reset(pv);
+        pv_mc_close(pv->mc_lane);
     }
-    
-    // Forward FFT
-    fft(x, N);
-    
-    // Conjugate and scale
-    for (int i = 0; i < N; i++) {
-        x[i].real /= N;
-        x[i].imag = -x[i].imag / N;
+#endif
+#if PV_PL_FFT
+    if (pv->pl_active) {
+        pv_pl_fft_close();
     }
+#endif
+    arena_free(pv->plan_mem);
+    arena_free(pv->window);
+    arena_free(pv->frame);
+    arena_free(pv->spec_mem);
+    arena_free(pv->last_phase);
+    arena_free(pv->sum_phase);
+    arena_free(pv->lock_mem);
+    arena_free(pv->shift_mag);
+    arena_free(pv->shift_freq);
+    for (int v = 0; v < PV_MAX_VOICES; v++) {
+        arena_free(pv->voice_phase[v]);
+    }
+    arena_free(pv->in_ring);
+    arena_free(pv->ola_ring);
+    arena_free(pv->stretched);
+    arena_free(pv->q15_in);
+    arena_free(pv->q15_out);
+    arena_free(pv);
 }
 
-// Calculate magnitude
-static inline float magnitude(Complex c) {
-    return sqrtf(c.real * c.real + c.imag * c.imag);
+// Restart every synthesis phase accumulator, the harmony voices' included
+static void pv_clear_phases(PhaseVocoder* pv) {
+    memset(pv->last_phase, 0, pv->num_bins * sizeof(float));
+    memset(pv->sum_phase, 0, pv->num_bins * sizeof(float));
+    for (int v = 0; v < pv->voices; v++) {
+        memset(pv->voice_phase[v], 0, pv->num_bins * sizeof(float));
+    }
 }
 
-// Calculate phase
-static inline float phase(Complex c) {
-    return atan2f(c.imag, c.real);
+void pv_reset(PhaseVocoder* pv) {
+    pv_clear_phases(pv);
+    if (pv->lock_mem) {
+        memset(pv->lock_mem, 0, 4 * SPECTRAL_PLANE(pv->num_bins) * sizeof(float));
+    }
+    // The ring starts as fft_size - hop samples of silence, so the first
+    // frame is analysed as soon as one hop of real input has arrived
+    memset(pv->in_ring, 0, pv->fft_size * sizeof(float));
+    memset(pv->ola_ring, 0, pv->fft_size * sizeof(float));
+    pv->in_pos = 0;
+    pv->in_count = 0;
+    pv->ola_pos = 0;
+    pv->curve_pos = 0;
+    pv->hop_carry = 0.0f;
+    pv->pitch.pitch = -1.0f;
+    pv->pitch.confidence = 0.0f;
+    pv->pitch.peaks = 0;
+    resampler_reset(&pv->resampler);
+
+#if PV_MULTICORE
+    // Frames still in flight belong to the old stream; let their workers finish
+    while (pv->mc_pending > 0) {
+        const float *mag, *ph;
+        int slot = (pv->mc_head + PV_MC_SLOTS - pv->mc_pending) % PV_MC_SLOTS;
+        pv_mc_wait(pv->mc_lane, slot, &mag, &ph);
+        pv->mc_pending--;
+    }
+    pv->mc_head = 0;
+#endif
+#if PV_PL_FFT
+    if (pv->pl_active) {
+        pv_pl_fft_wait();
+    }
+    pv->pl_pending = 0;
+    pv->pl_next = 0;
+#endif
 }
 
-// Wrap phase to [-pi, pi]
-static inline float wrap_phase(float phase) {
-    while (phase > M_PI) phase -= 2.0f * M_PI;
-    while (phase < -M_PI) phase += 2.0f * M_PI;
-    return phase;
+void pv_set_ratio(PhaseVocoder* pv, float pitch_ratio) {
+    // Worker cores only analyse; the synthesis hop is read when a frame
+    // retires here, so frames already in flight pick up the new ratio too
+    pv_set_hops(pv, pitch_ratio);
 }
 
-// Phase vocoder pitch shifting
-AudioBuffer* phase_vocoder_pitch_shift(AudioBuffer* input, float pitch_ratio) {
-    printf("Starting Phase Vocoder pitch shift with ratio: %.3f\n", pitch_ratio);
-    
-    // Clamp pitch ratio
-    if (pitch_ratio < 0.5f) pitch_ratio = 0.5f;
-    if (pitch_ratio > 2.0f) pitch_ratio = 2.0f;
-    
-    // For pitch shifting: time-stretch by pitch_ratio, then resample by 1/pitch_ratio
-    // pitch_ratio > 1 means higher pitch:
-    //   - time-stretch by 1.2x (longer, same pitch)
-    //   - resample by 0.833x (compress back, raises pitch)
-    // Result: same duration, pitch increased by 1.2x
-    float time_stretch_ratio = pitch_ratio;
-    
-    // Create temporary buffer for time-stretched audio
-    int stretched_length = (int)(input->length * time_stretch_ratio * 1.2f);
-    float* temp_output = (float*)calloc(stretched_length, sizeof(float));
-    
-    // Allocate working buffers
-    float* window = (float*)malloc(FFT_SIZE * sizeof(float));
-    Complex* fft_in = (Complex*)malloc(FFT_SIZE * sizeof(Complex));
-    Complex* fft_out = (Complex*)malloc(FFT_SIZE * sizeof(Complex));
-    float* magnitude_buf = (float*)malloc(FFT_SIZE * sizeof(float));
-    float* phase_buf = (float*)malloc(FFT_SIZE * sizeof(float));
-    float* last_phase = (float*)calloc(FFT_SIZE, sizeof(float));
-    float* sum_phase = (float*)calloc(FFT_SIZE, sizeof(float));
-    
-    // Generate Hanning window
-    for (int i = 0; i < FFT_SIZE; i++) {
-        window[i] = hanning(i, FFT_SIZE);
+int pv_set_ratio_curve(PhaseVocoder* pv, const float* curve, int frames) {
+    if (!curve || frames < 1) {
+        pv->curve = NULL;
+        return curve ? -1 : 0;
     }
-    
-    // Calculate analysis and synthesis hop sizes for TIME STRETCHING
-    int analysis_hop = HOP_SIZE;
-    int synthesis_hop = (int)(HOP_SIZE * time_stretch_ratio);
-    if (synthesis_hop < 1) synthesis_hop = 1;
-    
-    printf("FFT size: %d, Analysis hop: %d, Synthesis hop: %d (time stretch: %.3f)\n", 
-           FFT_SIZE, analysis_hop, synthesis_hop, time_stretch_ratio);
-    
-    int num_frames = (input->length - FFT_SIZE) / analysis_hop;
-    int output_pos = 0;
-    
-    // Process each frame
-    for (int frame = 0; frame < num_frames; frame++) {
-        int input_pos = frame * analysis_hop;
-        
-        // Skip if we're too close to the end
-        if (input_pos + FFT_SIZE > input->length) break;
-        if (output_pos + FFT_SIZE > stretched_length) break;
-        
-        // 1. Extract and window the frame
-        for (int i = 0; i < FFT_SIZE; i++) {
-            fft_in[i].real = input->data[input_pos + i] * window[i];
-            fft_in[i].imag = 0.0f;
+
+    // One bank for the whole stream, built for its largest decimation
+    float top = 1.0f;
+    for (int i = 0; i < frames; i++) {
+        if (curve[i] > top) top = curve[i];
+    }
+    pv_set_hops(pv, top > 2.0f ? 2.0f : top);
+    pv->curve = curve;
+    pv->curve_frames = frames;
+    pv->curve_pos = 0;
+    pv->hop_carry = 0.0f;
+    return 0;
+}
+
+// Next frame's ratio from the curve, O(1): the resampler keeps its bank and
+// the synthesis hop carries its fraction on, so the stretch stays exact
+static void pv_curve_step(PhaseVocoder* pv) {
+    float r = pv->curve[pv->curve_pos < pv->curve_frames ? pv->curve_pos++ : pv->curve_frames - 1];
+    if (r < 0.5f) r = 0.5f;
+    if (r > 2.0f) r = 2.0f;
+    if (pv->spectral) {
+        pv->ratio = r;              // The bins move by r; hops and resampler are untouched
+        return;
+    }
+
+    float hs = pv->hop * r + pv->hop_carry;
+    pv->synth_hop = (int)hs;
+    if (pv->synth_hop < 1) pv->synth_hop = 1;
+    if (pv->synth_hop > 2 * pv->hop) pv->synth_hop = 2 * pv->hop;
+    pv->hop_carry = hs - pv->synth_hop;
+    pv->ratio = r;
+    pv->ola_gain = pv->synth_hop / pv->window_energy;
+    // The stretched hop here is synth_hop long and must come out as one analysis hop
+    resampler_set_rate(&pv->resampler, (float)pv->synth_hop / pv->hop);
+}
+
+int pv_set_phase_lock(PhaseVocoder* pv, int enable) {
+    enable = enable ? 1 : 0;
+#if PV_MULTICORE
+    if (enable && pv->mc_workers > 0) {
+        DLOG_WARN("Phase vocoder: no phase locking with worker cores\r\n");
+        return -1;
+    }
+#endif
+    if (enable && !pv->lock_mem) {
+        // Four planes at the frame's stride, then the peak list
+        const int stride = SPECTRAL_PLANE(pv->num_bins);
+        float* m = (float*)arena_hot_malloc(4 * stride * sizeof(float) + (pv->num_bins / 2 + 1) * sizeof(int));
+        if (!m) {
+            DLOG_ERROR("Error: Failed to allocate phase locking buffers\r\n");
+            return -1;
         }
-        
-        // 2. Forward FFT
-        fft(fft_in, FFT_SIZE);
-        
-        // 3. Extract magnitude and phase
-        for (int i = 0; i < FFT_SIZE; i++) {
-            magnitude_buf[i] = magnitude(fft_in[i]);
-            phase_buf[i] = phase(fft_in[i]);
+        pv->lock_mem = m;
+        pv->lock.prev_re = m;
+        pv->lock.prev_im = m + stride;
+        pv->lock.out_re = m + 2 * stride;
+        pv->lock.out_im = m + 3 * stride;
+        pv->lock.peaks = (int*)(m + 4 * stride);
+    }
+    if (enable != pv->phase_lock) {
+        // The other method's phase history is stale: restart the phases, keep the audio
+        memset(pv->last_phase, 0, pv->num_bins * sizeof(float));
+        memset(pv->sum_phase, 0, pv->num_bins * sizeof(float));
+        if (pv->lock_mem) {
+            memset(pv->lock_mem, 0, 4 * SPECTRAL_PLANE(pv->num_bins) * sizeof(float));
         }
-        
-        // 4. Phase vocoder processing
-        for (int i = 0; i < FFT_SIZE / 2; i++) {
-            // Calculate phase difference
-            float phase_diff = phase_buf[i] - last_phase[i];
-            last_phase[i] = phase_buf[i];
-            
-            // Wrap phase difference to [-pi, pi]
-            phase_diff = wrap_phase(phase_diff);
-            
-            // Calculate instantaneous frequency
-            float expected_phase_diff = 2.0f * M_PI * i * analysis_hop / FFT_SIZE;
-            float freq_deviation = (phase_diff - expected_phase_diff);
-            
-            // Unwrap frequency deviation
-            freq_deviation = wrap_phase(freq_deviation);
-            
-            // Calculate true frequency
-            float true_freq = 2.0f * M_PI * i / FFT_SIZE + freq_deviation / analysis_hop;
-            
-            // Accumulate phase for synthesis
-            sum_phase[i] += true_freq * synthesis_hop;
-            
-            // Reconstruct complex spectrum with new phase
-            fft_out[i].real = magnitude_buf[i] * cosf(sum_phase[i]);
-            fft_out[i].imag = magnitude_buf[i] * sinf(sum_phase[i]);
+        pv->phase_lock = enable;
+    }
+    return 0;
+}
+
+int pv_get_phase_lock(const PhaseVocoder* pv) {
+    return pv->phase_lock;
+}
+
+int pv_set_spectral_shift(PhaseVocoder* pv, int enable) {
+    enable = enable ? 1 : 0;
+    if (enable && !pv->shift_mag) {
+        // The frequencies may already be there for the pitch estimate
+        pv->shift_mag = (float*)arena_hot_malloc(pv->num_bins * sizeof(float));
+        if (!pv->shift_freq) {
+            pv->shift_freq = (float*)arena_hot_malloc(pv->num_bins * sizeof(float));
         }
-        
-        // Mirror for negative frequencies
-        for (int i = FFT_SIZE / 2; i < FFT_SIZE; i++) {
-            fft_out[i].real = fft_out[FFT_SIZE - i].real;
-            fft_out[i].imag = -fft_out[FFT_SIZE - i].imag;
+        if (!pv->shift_mag || !pv->shift_freq) {
+            DLOG_ERROR("Error: Failed to allocate spectral shift buffers\r\n");
+            arena_free(pv->shift_mag);
+            pv->shift_mag = NULL;
+            return -1;
         }
-        
-        // 5. Inverse FFT
-        ifft(fft_out, FFT_SIZE);
-        
-        // 6. Overlap-add to temp output with window
-        for (int i = 0; i < FFT_SIZE; i++) {
-            if (output_pos + i < stretched_length) {
-                temp_output[output_pos + i] += fft_out[i].real * window[i];
+    }
+    if (enable != pv->spectral) {
+        pv_clear_phases(pv);
+        if (!enable) {
+            pv->voices = 0;         // Harmony needs the spectral shift
+        }
+        pv->spectral = enable;
+        pv->hop_carry = 0.0f;
+        pv_set_hops(pv, pv->ratio);
+    }
+    return 0;
+}
+
+int pv_get_spectral_shift(const PhaseVocoder* pv) {
+    return pv->spectral;
+}
+
+int pv_set_harmony(PhaseVocoder* pv, const float* intervals, const float* gains, int n) {
+    if (n < 0 || n > PV_MAX_VOICES) {
+        return -1;
+    }
+    for (int v = 0; v < n; v++) {
+        if (!(intervals[v] > 0.0f)) {
+            return -1;
+        }
+    }
+    for (int v = 0; v < n; v++) {
+        if (!pv->voice_phase[v]) {
+            pv->voice_phase[v] = (float*)arena_hot_malloc(pv->num_bins * sizeof(float));
+            if (!pv->voice_phase[v]) {
+                DLOG_ERROR("Error: Failed to allocate harmony voice buffers\r\n");
+                return -1;
             }
         }
-        
-        // Advance output position
-        output_pos += synthesis_hop;
     }
-    
-    printf("Processed %d frames, stretched output length: %d samples\n", num_frames, output_pos);
-    
-    // Normalize time-stretched audio to account for overlap-add
-    float overlap_norm = 2.0f / OVERLAP_FACTOR;
-    for (int i = 0; i < output_pos && i < stretched_length; i++) {
-        temp_output[i] *= overlap_norm;
+    if (n > 0 && pv_set_spectral_shift(pv, 1) != 0) {
+        return -1;
     }
-    
-    // Now resample the time-stretched audio back to original length
-    // This completes the pitch shift: time stretch * resample = pitch change with same duration
-    AudioBuffer* output = (AudioBuffer*)malloc(sizeof(AudioBuffer));
-    output->length = input->length;
-    output->sample_rate = input->sample_rate;
-    output->data = (float*)malloc(output->length * sizeof(float));
-    
-    // Simple linear interpolation resampling
-    float ratio = (float)output_pos / output->length;
-    for (int i = 0; i < output->length; i++) {
-        float pos = i * ratio;
-        int idx = (int)pos;
-        float frac = pos - idx;
-        
-        if (idx + 1 < output_pos) {
-            output->data[i] = temp_output[idx] * (1.0f - frac) + temp_output[idx + 1] * frac;
-        } else if (idx < output_pos) {
-            output->data[i] = temp_output[idx];
+    for (int v = 0; v < n; v++) {
+        if (v >= pv->voices) {
+            // A new voice starts from silence rather than another voice's phases
+            memset(pv->voice_phase[v], 0, pv->num_bins * sizeof(float));
+        }
+        pv->voice_interval[v] = intervals[v];
+        pv->voice_gain[v] = gains[v];
+    }
+    pv->voices = n;
+    return 0;
+}
+
+int pv_get_harmony(const PhaseVocoder* pv) {
+    return pv->voices;
+}
+
+int pv_set_pitch_estimate(PhaseVocoder* pv, const PvPitchConfig* cfg) {
+    if (cfg && !pv->shift_freq) {
+        pv->shift_freq = (float*)arena_hot_malloc(pv->num_bins * sizeof(float));
+        if (!pv->shift_freq) {
+            DLOG_ERROR("Error: Failed to allocate pitch estimate buffer\r\n");
+            return -1;
+        }
+    }
+    if (cfg) {
+        pv->pitch_cfg = *cfg;
+    }
+    pv->pitch_on = cfg != NULL;
+    pv->pitch.pitch = -1.0f;
+    pv->pitch.confidence = 0.0f;
+    pv->pitch.peaks = 0;
+    return 0;
+}
+
+void pv_get_pitch(const PhaseVocoder* pv, PvPitch* pitch) {
+    *pitch = pv->pitch;
+}
+
+float pv_get_ratio(const PhaseVocoder* pv) {
+    return pv->ratio;
+}
+
+int pv_latency(const PhaseVocoder* pv) {
+    return pv->fft_size - pv->hop;
+}
+
+// Window the newest fft_size input samples (ring unrolled in two segments)
+static void pv_window_input(const PhaseVocoder* pv, float* frame) {
+    const int oldest = pv->in_pos;     // in_ring[in_pos] is the oldest sample
+    const int tail = pv->fft_size - oldest;
+
+    pvk_window(pv->in_ring + oldest, pv->window, frame, tail);
+    pvk_window(pv->in_ring, pv->window + tail, frame + tail, oldest);
+}
+
+// Magnitude/phase of the re/im planes of pv->spec into its mag/ph planes
+// (magnitude only when phase locked: the peaks' phases are taken from the bins directly)
+static void pv_polar(PhaseVocoder* pv) {
+    SpectralFrame* f = &pv->spec;
+    if (pv->phase_lock && !pv->spectral) {
+        pvk_magnitude(f->re, f->im, f->mag, pv->num_bins);
+    } else {
+        pvk_mag_phase(f->re, f->im, f->mag, f->ph, pv->num_bins);
+    }
+}
+
+// Forward FFT and magnitude/phase of a windowed frame into pv->spec
+static void pv_analyse(PhaseVocoder* pv, const float* frame) {
+    // Real input, DC..Nyquist bins only, straight into the split planes
+    PROF_START(PROF_PV_FFT);
+    rfft_forward_split(&pv->plan, frame, &pv->spec);
+    PROF_STOP(PROF_PV_FFT);
+    pv_polar(pv);
+}
+
+// Phase vocoder processing: true bin frequency from the phase change,
+// accumulated over the synthesis hop, then back to rectangular in pv->spec.re/im.
+// Phase locked, the analysis bins still in pv->spec are rotated in place;
+// shifting spectrally, each peak's region is moved instead (locked to its peak),
+// and each harmony voice is moved again from the same bin frequencies and
+// summed into the lead's spectrum, so all of them share one inverse FFT.
+static void pv_phase_stage(PhaseVocoder* pv, const float* mag, const float* ph) {
+    PROF_START(PROF_PV_PHASE);
+    if (pv->spectral) {
+        pvk_bin_freq(ph, pv->last_phase, pv->shift_freq, pv->num_bins, pv->fft_size, pv->hop);
+        if (pv->pitch_on) {
+            pv_pitch_estimate(&pv->pitch_cfg, mag, pv->shift_freq, pv->num_bins, pv->fft_size, &pv->pitch);
+        }
+        pvk_bin_scatter(mag, ph, pv->shift_freq, pv->sum_phase, pv->shift_mag,
+                        pv->num_bins, pv->fft_size, pv->hop, pv->ratio);
+        pvk_polar_to_rect(pv->shift_mag, pv->sum_phase, pv->spec.re, pv->spec.im, pv->num_bins);
+        for (int v = 0; v < pv->voices; v++) {
+            pvk_bin_scatter(mag, ph, pv->shift_freq, pv->voice_phase[v], pv->shift_mag,
+                            pv->num_bins, pv->fft_size, pv->hop, pv->ratio * pv->voice_interval[v]);
+            pvk_polar_accumulate(pv->shift_mag, pv->voice_phase[v], pv->voice_gain[v],
+                                 pv->spec.re, pv->spec.im, pv->num_bins);
+        }
+        PROF_STOP(PROF_PV_PHASE);
+        return;
+    }
+    if (pv->phase_lock) {
+        if (pv->pitch_on) {
+            // No per-bin phases here: the peaks are placed from the magnitudes
+            pv_pitch_estimate(&pv->pitch_cfg, mag, NULL, pv->num_bins, pv->fft_size, &pv->pitch);
+        }
+        pvk_phase_lock(&pv->spec, &pv->lock, pv->fft_size, pv->hop, pv->synth_hop);
+        PROF_STOP(PROF_PV_PHASE);
+        return;
+    }
+    if (pv->pitch_on) {
+        // Same advance in two passes, keeping the frequencies for the estimate
+        pvk_bin_freq(ph, pv->last_phase, pv->shift_freq, pv->num_bins, pv->fft_size, pv->hop);
+        pv_pitch_estimate(&pv->pitch_cfg, mag, pv->shift_freq, pv->num_bins, pv->fft_size, &pv->pitch);
+        pvk_phase_integrate(pv->shift_freq, pv->sum_phase, pv->num_bins, pv->synth_hop);
+    } else {
+        pvk_phase_advance(ph, pv->last_phase, pv->sum_phase, pv->num_bins,
+                          pv->fft_size, pv->hop, pv->synth_hop);
+    }
+    pvk_polar_to_rect(mag, pv->sum_phase, pv->spec.re, pv->spec.im, pv->num_bins);
+    PROF_STOP(PROF_PV_PHASE);
+}
+
+// Overlap-add the resynthesised frame in pv->frame, then resample the
+// synth_hop samples that are now final into out.
+// Returns the number of output samples written.
+static int pv_overlap_stage(PhaseVocoder* pv, float* out) {
+    const int N = pv->fft_size;
+
+    // 1. Overlap-add with window
+    PROF_START(PROF_PV_OLA);
+    const int head = N - pv->ola_pos;
+    pvk_overlap_add(pv->ola_ring + pv->ola_pos, pv->frame, pv->window, head);
+    pvk_overlap_add(pv->ola_ring, pv->frame + head, pv->window + head, pv->ola_pos);
+
+    // 2. The first synth_hop accumulated samples get no more contributions
+    const int hs = pv->synth_hop;
+    for (int i = 0; i < hs; i++) {
+        int idx = (pv->ola_pos + i) % N;
+        pv->stretched[i] = pv->ola_ring[idx] * pv->ola_gain;
+        pv->ola_ring[idx] = 0.0f;
+    }
+    pv->ola_pos = (pv->ola_pos + hs) % N;
+    PROF_STOP(PROF_PV_OLA);
+
+    // 3. Resample by 1/ratio (polyphase, continuous across frames); a
+    //    spectral shift is already at the output rate
+    if (pv->spectral) {
+        memcpy(out, pv->stretched, hs * sizeof(float));
+        return hs;
+    }
+    return resampler_process(&pv->resampler, pv->stretched, hs, out);
+}
+
+// Resynthesise one analysed frame on the CPU
+static int pv_synthesise(PhaseVocoder* pv, const float* mag, const float* ph, float* out) {
+    if (pv->curve) {
+        pv_curve_step(pv);
+    }
+    pv_phase_stage(pv, mag, ph);
+
+    // Inverse FFT (negative frequencies implied by conjugate symmetry)
+    PROF_START(PROF_PV_IFFT);
+    rfft_inverse_split(&pv->plan, &pv->spec, pv->frame);
+    PROF_STOP(PROF_PV_IFFT);
+    return pv_overlap_stage(pv, out);
+}
+
+#if PV_MULTICORE
+// Synthesise the oldest frame in flight once its worker has analysed it
+static int pv_retire_frame(PhaseVocoder* pv, float* out) {
+    const float *mag, *ph;
+    int slot = (pv->mc_head + PV_MC_SLOTS - pv->mc_pending) % PV_MC_SLOTS;
+    pv->mc_pending--;
+
+    if (pv_mc_wait(pv->mc_lane, slot, &mag, &ph) != 0) {
+        // Worker stopped answering: analyse the posted frame here
+        pv_analyse(pv, pv_mc_frame(pv->mc_lane, slot));
+        mag = pv->spec.mag;
+        ph = pv->spec.ph;
+    }
+    return pv_synthesise(pv, mag, ph, out);
+}
+#endif
+
+#if PV_PL_FFT
+// Synthesise the frame whose forward transform on buffer pair buf has
+// completed. Its inverse runs on the same pair once the fabric is free.
+static int pv_retire_frame_pl(PhaseVocoder* pv, int buf, float* out) {
+    const int M = pv->fft_size / 2;
+    const float scale = 1.0f / M;
+
+    // The fabric works on interleaved complex: split on the way in, interleave
+    // on the way out. buf's input was consumed by its forward transform, so reuse it
+    rfft_forward_post_split(&pv->plan, pv_pl_fft_output(buf), &pv->spec);
+    pv_polar(pv);
+    pv_phase_stage(pv, pv->spec.mag, pv->spec.ph);
+    rfft_inverse_pre_split(&pv->plan, &pv->spec, pv_pl_fft_input(buf));
+    pv_pl_fft_start(buf, 1);
+    pv_pl_fft_wait();
+
+    // Unpack even/odd samples and undo the unscaled inverse
+    const float* t = (const float*)pv_pl_fft_output(buf);
+    for (int i = 0; i < pv->fft_size; i++) {
+        pv->frame[i] = t[i] * scale;
+    }
+    return pv_overlap_stage(pv, out);
+}
+
+// One-frame pipeline: start frame k's forward transform, then do the CPU
+// spectral work of frame k-1 while the fabric transforms frame k
+static int pv_process_frame_pl(PhaseVocoder* pv, float* out) {
+    int buf = pv->pl_next;
+    int produced = 0;
+
+    // Starting frame k also completes frame k-1's forward transform
+    pv_window_input(pv, (float*)pv_pl_fft_input(buf));
+    pv_pl_fft_start(buf, 0);
+    pv->pl_next = buf ^ 1;
+
+    if (pv->pl_pending) {
+        produced = pv_retire_frame_pl(pv, buf ^ 1, out);
+    }
+    pv->pl_pending = 1;
+    return produced;
+}
+#endif
+
+// Analyse the newest fft_size input samples and synthesise a frame.
+// With worker cores or the fabric FFT the analysis is started and the frame
+// started PV_PIPELINE_DEPTH frames ago is synthesised instead.
+static int pv_process_frame(PhaseVocoder* pv, float* out) {
+#if PV_MULTICORE
+    if (pv->mc_workers > 0) {
+        pv_window_input(pv, pv_mc_frame(pv->mc_lane, pv->mc_head));
+        pv_mc_post(pv->mc_lane, pv->mc_head);
+        pv->mc_head = (pv->mc_head + 1) % PV_MC_SLOTS;
+        if (++pv->mc_pending < PV_MC_SLOTS) {
+            return 0;
+        }
+        return pv_retire_frame(pv, out);
+    }
+#endif
+#if PV_PL_FFT
+    if (pv->pl_active) {
+        return pv_process_frame_pl(pv, out);
+    }
+#endif
+
+    pv_window_input(pv, pv->frame);
+    pv_analyse(pv, pv->frame);
+    return pv_synthesise(pv, pv->spec.mag, pv->spec.ph, out);
+}
+
+int pv_process(PhaseVocoder* pv, const float* in, int n, float* out) {
+    const int N = pv->fft_size;
+    int produced = 0;
+
+    while (n > 0) {
+        // Copy up to the next frame boundary (and never across the ring end)
+        int chunk = pv->hop - pv->in_count;
+        if (chunk > n) chunk = n;
+        if (chunk > N - pv->in_pos) chunk = N - pv->in_pos;
+
+        if (in) {
+            memcpy(pv->in_ring + pv->in_pos, in, chunk * sizeof(float));
+            in += chunk;
         } else {
-            output->data[i] = 0.0f;
+            memset(pv->in_ring + pv->in_pos, 0, chunk * sizeof(float));
+        }
+        pv->in_pos = (pv->in_pos + chunk) % N;
+        pv->in_count += chunk;
+        n -= chunk;
+
+        if (pv->in_count >= pv->hop) {
+            pv->in_count = 0;
+            produced += pv_process_frame(pv, out + produced);
         }
     }
-    
-    // Final normalization
-    float max_val = 0.0f;
-    for (int i = 0; i < output->length; i++) {
-        float abs_val = fabsf(output->data[i]);
-        if (abs_val > max_val) max_val = abs_val;
+
+    return produced;
+}
+
+int pv_flush(PhaseVocoder* pv, float* out) {
+    // Push silence until the last real sample has left the analysis window
+    // and its overlap-add tail has been resampled out
+    int produced = pv_process(pv, NULL, pv->fft_size, out);
+#if PV_MULTICORE
+    while (pv->mc_pending > 0) {
+        produced += pv_retire_frame(pv, out + produced);
     }
-    
-    if (max_val > 0.001f) {
-        float norm_factor = 0.9f / max_val;
-        for (int i = 0; i < output->length; i++) {
-            output->data[i] *= norm_factor;
+#endif
+#if PV_PL_FFT
+    if (pv->pl_pending) {
+        pv_pl_fft_wait();
+        produced += pv_retire_frame_pl(pv, pv->pl_next ^ 1, out + produced);
+        pv->pl_pending = 0;
+    }
+#endif
+    pv_reset(pv);
+    return produced;
+}
+
+int pv_process_q15(PhaseVocoder* pv, const int16_t* in, int n, int16_t* out) {
+    int produced = 0;
+
+    // A hop at a time so the float staging stays inside the context
+    while (n > 0) {
+        int chunk = n < pv->hop ? n : pv->hop;
+        int got;
+        if (in) {
+            q15_to_float_array(in, pv->q15_in, chunk);
+            in += chunk;
+            got = pv_process(pv, pv->q15_in, chunk, pv->q15_out);
+        } else {
+            got = pv_process(pv, NULL, chunk, pv->q15_out);
         }
+        float_to_q15_array(pv->q15_out, out + produced, got);
+        produced += got;
+        n -= chunk;
     }
-    
-    // Cleanup
-    free(temp_output);
-    free(window);
-    free(fft_in);
-    free(fft_out);
-    free(magnitude_buf);
-    free(phase_buf);
-    free(last_phase);
-    free(sum_phase);
-    
+
+    return produced;
+}
+
+int pv_flush_q15(PhaseVocoder* pv, int16_t* out) {
+    int produced = pv_process_q15(pv, NULL, pv->fft_size, out);
+#if PV_MULTICORE
+    while (pv->mc_pending > 0) {
+        int got = pv_retire_frame(pv, pv->q15_out);
+        float_to_q15_array(pv->q15_out, out + produced, got);
+        produced += got;
+    }
+#endif
+#if PV_PL_FFT
+    if (pv->pl_pending) {
+        pv_pl_fft_wait();
+        int got = pv_retire_frame_pl(pv, pv->pl_next ^ 1, pv->q15_out);
+        float_to_q15_array(pv->q15_out, out + produced, got);
+        produced += got;
+        pv->pl_pending = 0;
+    }
+#endif
+    pv_reset(pv);
+    return produced;
+}
+
+// Per-channel state of phase_vocoder_pitch_shift
+typedef struct {
+    PhaseVocoder* pv;
+    Limiter* lim;
+    float* block_out;
+    int skip;               // Latency samples still to drop
+    int written;
+} PvChannel;
+
+static void pv_channels_free(PvChannel* ch, int channels) {
+    for (int c = 0; c < channels; c++) {
+        arena_free(ch[c].block_out);
+        limiter_destroy(ch[c].lim);
+        pv_destroy(ch[c].pv);
+    }
+}
+
+// Phase vocoder pitch shifting (whole buffer, built on the streaming API)
+AudioBuffer* phase_vocoder_pitch_shift(AudioBuffer* input, float pitch_ratio) {
+    printf("Starting Phase Vocoder pitch shift with ratio: %.3f\n", pitch_ratio);
+
+    const int channels = input->channels;
+    if (channels < 1 || channels > PV_MAX_CHANNELS) {
+        printf("Error: %d channels (1 .. %d supported)\n", channels, PV_MAX_CHANNELS);
+        return NULL;
+    }
+
+    // Level: a limiter with make-up gain and a slow release stands in for
+    // peak normalisation, so the output needs no second pass over the buffer
+    LimiterConfig lim_cfg;
+    limiter_default_config(&lim_cfg);
+    lim_cfg.ceiling = PV_NORMALISE_PEAK;
+    lim_cfg.max_gain = PV_NORMALISE_MAX_GAIN;
+    lim_cfg.release = input->sample_rate > 0 ? input->sample_rate : 48000;
+
+    // One vocoder per channel; with PV_MULTICORE each claims its own queue lane
+    PvChannel ch[PV_MAX_CHANNELS];
+    memset(ch, 0, sizeof(ch));
+    for (int c = 0; c < channels; c++) {
+        ch[c].pv = pv_create(FFT_SIZE, HOP_SIZE, pitch_ratio);
+        ch[c].lim = limiter_create(&lim_cfg);
+        ch[c].block_out = (float*)arena_malloc((PV_BLOCK_SIZE + PV_FLUSH_ROOM(FFT_SIZE, HOP_SIZE) +
+                                                lim_cfg.lookahead) * sizeof(float));
+        if (!ch[c].pv || !ch[c].lim || !ch[c].block_out) {
+            printf("Error: Failed to create phase vocoder\n");
+            pv_channels_free(ch, channels);
+            return NULL;
+        }
+        // Drop the first pv_latency() + limiter samples so the output lines up with the input
+        ch[c].skip = pv_latency(ch[c].pv) + limiter_latency(ch[c].lim);
+    }
+
+    printf("FFT size: %d, Analysis hop: %d, Synthesis hop: %d (time stretch: %.3f), %d channel(s)\n",
+           FFT_SIZE, ch[0].pv->hop, ch[0].pv->synth_hop, ch[0].pv->ratio, channels);
+
+    AudioBuffer* output = (AudioBuffer*)arena_malloc(sizeof(AudioBuffer));
+    if (!output) {
+        pv_channels_free(ch, channels);
+        return NULL;
+    }
+    output->length = input->length;
+    output->channels = channels;
+    output->sample_rate = input->sample_rate;
+    output->data = (float*)arena_calloc((size_t)output->length * channels, sizeof(float));
+    if (!output->data) {
+        arena_free(output);
+        pv_channels_free(ch, channels);
+        return NULL;
+    }
+
+    // Channels take turns block by block, so every lane has frames in flight
+    for (int pos = 0; ; pos += PV_BLOCK_SIZE) {
+        int last = pos >= input->length;
+
+        for (int c = 0; c < channels; c++) {
+            PvChannel* k = &ch[c];
+            float* dst = audio_channel(output, c);
+            int n;
+
+            if (!last) {
+                int len = input->length - pos;
+                if (len > PV_BLOCK_SIZE) len = PV_BLOCK_SIZE;
+                n = pv_process(k->pv, audio_channel(input, c) + pos, len, k->block_out);
+                limiter_process(k->lim, k->block_out, n, k->block_out);
+            } else {
+                n = pv_flush(k->pv, k->block_out);
+                limiter_process(k->lim, k->block_out, n, k->block_out);
+                n += limiter_flush(k->lim, k->block_out + n);
+            }
+
+            for (int i = 0; i < n && k->written < output->length; i++) {
+                if (k->skip > 0) {
+                    k->skip--;
+                } else {
+                    dst[k->written++] = k->block_out[i];
+                }
+            }
+        }
+        if (last) break;
+    }
+
+    printf("Pitch-shifted output length: %d samples\n", ch[0].written);
+
+    pv_channels_free(ch, channels);
+
     printf("Phase vocoder pitch shift complete\n");
     return output;
 }
@@ -352,51 +949,77 @@ AudioBuffer* read_wav_file(const char* filename) {
     printf("WAV Info: %d Hz, %d channels, %d bits, format %d\n", 
            sample_rate, num_channels, bits_per_sample, audio_format);
     
-    // Calculate number of samples
+    if (num_channels < 1 || num_channels > PV_MAX_CHANNELS) {
+        printf("Error: %d channels (1 .. %d supported)\n", num_channels, PV_MAX_CHANNELS);
+        fclose(f);
+        return NULL;
+    }
+    
+    // Calculate number of samples per channel
     int num_samples = chunk_size / (bits_per_sample / 8) / num_channels;
     
     // Create audio buffer
-    AudioBuffer* audio = (AudioBuffer*)malloc(sizeof(AudioBuffer));
+    AudioBuffer* audio = (AudioBuffer*)arena_malloc(sizeof(AudioBuffer));
+    if (!audio) {
+        fclose(f);
+        return NULL;
+    }
     audio->length = num_samples;
+    audio->channels = num_channels;
     audio->sample_rate = sample_rate;
-    audio->data = (float*)malloc(num_samples * sizeof(float));
+    audio->data = (float*)arena_malloc((size_t)num_samples * num_channels * sizeof(float));
+    if (!audio->data) {
+        printf("Error: Out of memory for %d samples\n", num_samples);
+        arena_free(audio);
+        fclose(f);
+        return NULL;
+    }
+    float* planes[PV_MAX_CHANNELS];
+    for (int c = 0; c < num_channels; c++) {
+        planes[c] = audio_channel(audio, c);
+    }
     
     // Read and convert audio data
     if (audio_format == 1 && bits_per_sample == 16) {
         // 16-bit PCM
-        short* temp = (short*)malloc(chunk_size);
-        fread(temp, 1, chunk_size, f);
-        
-        for (int i = 0; i < num_samples; i++) {
-            // If stereo, mix to mono
-            if (num_channels == 2) {
-                audio->data[i] = (temp[i*2] + temp[i*2+1]) / 65536.0f;
-            } else {
-                audio->data[i] = temp[i] / 32768.0f;
-            }
+        short* temp = (short*)arena_malloc(chunk_size);
+        if (!temp || fread(temp, 1, chunk_size, f) != (size_t)chunk_size) {
+            printf("Error: Could not read the sample data\n");
+            arena_free(temp);
+            arena_free(audio->data);
+            arena_free(audio);
+            fclose(f);
+            return NULL;
         }
-        free(temp);
+        
+        // Interleaved frames -> one plane per channel
+        q15_deinterleave_to_float(temp, planes, num_channels, num_samples);
+        arena_free(temp);
         
     } else if (audio_format == 3 && bits_per_sample == 32) {
         // 32-bit float
-        float* temp = (float*)malloc(chunk_size);
-        fread(temp, 1, chunk_size, f);
+        float* temp = (float*)arena_malloc(chunk_size);
+        if (!temp || fread(temp, 1, chunk_size, f) != (size_t)chunk_size) {
+            printf("Error: Could not read the sample data\n");
+            arena_free(temp);
+            arena_free(audio->data);
+            arena_free(audio);
+            fclose(f);
+            return NULL;
+        }
         
         for (int i = 0; i < num_samples; i++) {
-            // If stereo, mix to mono
-            if (num_channels == 2) {
-                audio->data[i] = (temp[i*2] + temp[i*2+1]) / 2.0f;
-            } else {
-                audio->data[i] = temp[i];
+            for (int c = 0; c < num_channels; c++) {
+                planes[c][i] = temp[i * num_channels + c];
             }
         }
-        free(temp);
+        arena_free(temp);
         
     } else {
         printf("Error: Unsupported audio format (format=%d, bits=%d)\n", 
                audio_format, bits_per_sample);
-        free(audio->data);
-        free(audio);
+        arena_free(audio->data);
+        arena_free(audio);
         fclose(f);
         return NULL;
     }
@@ -405,13 +1028,14 @@ AudioBuffer* read_wav_file(const char* filename) {
     return audio;
 }
 
-// Simple WAV file writing (32-bit float mono)
+// Simple WAV file writing (32-bit float, channels interleaved)
 int write_wav_file(const char* filename, AudioBuffer* audio) {
+    const int channels = audio->channels;
     FILE* f = fopen(filename, "wb");
     if (!f) return -1;
     
     // WAV header
-    int data_size = audio->length * sizeof(float);
+    int data_size = audio->length * channels * sizeof(float);
     int file_size = 36 + data_size;
     
     fwrite("RIFF", 1, 4, f);
@@ -422,9 +1046,9 @@ int write_wav_file(const char* filename, AudioBuffer* audio) {
     fwrite("fmt ", 1, 4, f);
     int fmt_size = 16;
     short audio_format = 3; // IEEE float
-    short num_channels = 1;
-    int byte_rate = audio->sample_rate * sizeof(float);
-    short block_align = sizeof(float);
+    short num_channels = channels;
+    int byte_rate = audio->sample_rate * channels * sizeof(float);
+    short block_align = channels * sizeof(float);
     short bits_per_sample = 32;
     
     fwrite(&fmt_size, 4, 1, f);
@@ -438,7 +1062,22 @@ int write_wav_file(const char* filename, AudioBuffer* audio) {
     // data chunk
     fwrite("data", 1, 4, f);
     fwrite(&data_size, 4, 1, f);
-    fwrite(audio->data, sizeof(float), audio->length, f);
+    if (channels == 1) {
+        fwrite(audio->data, sizeof(float), audio->length, f);
+    } else {
+        // Re-interleave the planes a block at a time
+        float frames[PV_WAV_WRITE_FRAMES * PV_MAX_CHANNELS];
+        for (int pos = 0; pos < audio->length; pos += PV_WAV_WRITE_FRAMES) {
+            int n = audio->length - pos;
+            if (n > PV_WAV_WRITE_FRAMES) n = PV_WAV_WRITE_FRAMES;
+            for (int i = 0; i < n; i++) {
+                for (int c = 0; c < channels; c++) {
+                    frames[i * channels + c] = audio_channel(audio, c)[pos + i];
+                }
+            }
+            fwrite(frames, sizeof(float), (size_t)n * channels, f);
+        }
+    }
     
     fclose(f);
     return 0;
@@ -487,12 +1126,12 @@ int write_wav_file(const char* filename, AudioBuffer* audio) {
 //            printf("Output written to %s\n", output_file);
 //        }
 //
-//        free(output->data);
-//        free(output);
+//        arena_free(output->data);
+//        arena_free(output);
 //    }
 //
-//    free(input->data);
-//    free(input);
+//    arena_free(input->data);
+//    arena_free(input);
 //
 //    return 0;
 //}
@@ -2,31 +2,279 @@
 #define PHASE_VOC_H
 
 #include <stdint.h>
+#include <stdlib.h>
+#include "pv_pitch.h"
+#include "arena.h"
 
-// Structure to hold audio data
+// Frame and hop used by phase_vocoder_pitch_shift
+#define PV_DEFAULT_FFT_SIZE 2048
+#define PV_DEFAULT_HOP      512
+
+// Build with -DPV_PHASE_LOCK=1 to create every vocoder with identity phase
+// locking (pv_set_phase_lock) instead of the per-bin phase advance.
+#ifndef PV_PHASE_LOCK
+#define PV_PHASE_LOCK 0
+#endif
+
+// Build with -DPV_SPECTRAL_SHIFT=1 to create every vocoder shifting in the
+// spectral domain (pv_set_spectral_shift) instead of stretch and resample.
+#ifndef PV_SPECTRAL_SHIFT
+#define PV_SPECTRAL_SHIFT 0
+#endif
+
+// Build with -DPV_MULTICORE=1 to hand frame analysis to worker apps on the
+// other A53 cores (see pv_mc.h). Frames are then retired PV_PIPELINE_DEPTH
+// frames late, which delays output but does not change pv_latency().
+#ifndef PV_MULTICORE
+#define PV_MULTICORE 0
+#endif
+
+// Build with -DPV_PL_FFT=1 to run the transforms on the fabric FFT engine
+// (see pv_pl_fft.h); the CPU then works one frame behind the fabric.
+#ifndef PV_PL_FFT
+#define PV_PL_FFT 0
+#endif
+
+#if PV_MULTICORE && PV_PL_FFT
+#error "PV_MULTICORE and PV_PL_FFT are alternative frame pipelines"
+#endif
+
+#if PV_MULTICORE
+#define PV_PIPELINE_DEPTH 6
+#elif PV_PL_FFT
+#define PV_PIPELINE_DEPTH 1
+#else
+#define PV_PIPELINE_DEPTH 0
+#endif
+
+#define PV_MAX_VOICES 4          // Harmony voices besides the lead (pv_set_harmony)
+
+// Output room pv_flush needs: the silence tail plus any frames still in flight
+#define PV_FLUSH_ROOM(fft_size, hop) \
+    ((fft_size) + (hop) + 1 + PV_PIPELINE_DEPTH * ((hop) + 2))
+
+#define PV_MAX_CHANNELS 2        // Channels an AudioBuffer may carry (second mic, stereo out)
+
+// Planar audio: channel c is the length samples at data + c * length
 typedef struct {
     float* data;
-    int length;
+    int length;              // Samples per channel
+    int channels;
     int sample_rate;
 } AudioBuffer;
 
+// First sample of one channel of a planar buffer
+static inline float* audio_channel(const AudioBuffer* audio, int c) {
+    return audio->data + (size_t)c * audio->length;
+}
+
+// Streaming phase vocoder context (opaque)
+typedef struct PhaseVocoder PhaseVocoder;
+
+/**
+ * Create a streaming phase vocoder. Memory is O(fft_size), independent of take length.
+ * @param fft_size    Frame length (power of two, >= 8)
+ * @param hop         Analysis hop in samples (1 .. fft_size/4)
+ * @param pitch_ratio Pitch shift ratio, clamped to 0.5 .. 2.0
+ * @return            New context (free with pv_destroy), or NULL on error
+ */
+PhaseVocoder* pv_create(int fft_size, int hop, float pitch_ratio);
+
+/**
+ * Free a streaming phase vocoder
+ * @param pv          Context from pv_create (NULL is ignored)
+ */
+void pv_destroy(PhaseVocoder* pv);
+
+/**
+ * Clear all history so the next sample starts a new stream
+ * @param pv          Context from pv_create
+ */
+void pv_reset(PhaseVocoder* pv);
+
+/**
+ * Change the pitch ratio of a running stream. Takes effect from the next
+ * frame; the phase accumulators and the resampler history carry over, so
+ * there is no reset click. Rebuilds the resampler bank, so call it when the
+ * ratio has actually moved rather than every hop.
+ * @param pv          Context from pv_create
+ * @param pitch_ratio New ratio, clamped to 0.5 .. 2.0
+ */
+void pv_set_ratio(PhaseVocoder* pv, float pitch_ratio);
+
+/**
+ * Follow a ratio curve instead of a fixed ratio: frame k (the k-th hop of
+ * input since the last reset, flush frames included) is synthesised at
+ * curve[k], and frames past the end keep the last entry. Per frame this is
+ * O(1) and allocates nothing; the resampler bank is built once here for the
+ * curve's largest ratio. The curve stays owned by the caller and is read
+ * while the stream runs; pv_reset restarts it, pv_set_ratio_curve(pv, NULL, 0)
+ * returns to the fixed ratio.
+ * @param pv          Context from pv_create
+ * @param curve       One ratio per frame (clamped to 0.5 .. 2.0 as it is used), or NULL
+ * @param frames      Entries in curve
+ * @return            0 on success, -1 if frames < 1 with a curve
+ */
+int pv_set_ratio_curve(PhaseVocoder* pv, const float* curve, int frames);
+
+/**
+ * Choose how phases are carried from frame to frame. Off (the default), every
+ * bin's phase advances by its own instantaneous frequency: an atan2, two
+ * wraps and a sin/cos per bin per frame. On, identity phase locking advances
+ * only the magnitude peaks and rotates the bins around each peak with it
+ * (see pvk_phase_lock): far fewer transcendentals, and less phasiness because
+ * the bins of one partial stay in phase. Switching restarts the phases (not
+ * the audio), as pv_reset would. Not available with PV_MULTICORE worker cores,
+ * which hand back magnitude and phase only.
+ * @param pv          Context from pv_create
+ * @param enable      Non-zero for phase locking
+ * @return            0 on success, -1 if unavailable or out of memory (the mode is unchanged)
+ */
+int pv_set_phase_lock(PhaseVocoder* pv, int enable);
+
+/**
+ * @param pv          Context from pv_create
+ * @return            Non-zero when phase locking is in use
+ */
+int pv_get_phase_lock(const PhaseVocoder* pv);
+
+/**
+ * Choose how the pitch is moved. Off (the default), the stream is
+ * time-stretched by the ratio (synthesis hop = hop * ratio) and resampled
+ * back, so the overlap-add and the resampler work harder as the ratio grows.
+ * On, every frame's spectral peaks are moved to peak * ratio with their
+ * regions (see pvk_bin_shift) and resynthesised at the analysis hop:
+ * no stretched stream, no resampler, the same cost at any ratio, and small
+ * ratio changes (a curve) need no new resampler bank. pv_set_phase_lock
+ * does not apply in this mode (the shift locks each region to its peak
+ * itself). Switching restarts the phases but not the audio.
+ * @param pv          Context from pv_create
+ * @param enable      Non-zero for the spectral shift
+ * @return            0 on success, -1 if out of memory (the mode is unchanged)
+ */
+int pv_set_spectral_shift(PhaseVocoder* pv, int enable);
+
+/**
+ * @param pv          Context from pv_create
+ * @return            Non-zero when shifting in the spectral domain
+ */
+int pv_get_spectral_shift(const PhaseVocoder* pv);
+
+/**
+ * Harmonize: besides the lead voice at the vocoder's ratio (or curve), move
+ * every frame to n more ratios, voice v at ratio * intervals[v] (2^(4/12)
+ * for a major third above the lead, 2^(7/12) for a fifth) scaled by
+ * gains[v]. The window, forward FFT, magnitude/phase and frequency estimate
+ * are done once per frame; each voice only has its own phase accumulators,
+ * a bin scatter and a polar-to-rectangular pass added into the lead's bins,
+ * and the mix goes through one inverse FFT and one overlap-add. Needs the
+ * spectral shift, which this turns on; turning it off drops the voices.
+ * New voices start their phases from zero; the output is not limited, so
+ * keep the gains down or put a limiter after it (shift_engine does).
+ * @param pv          Context from pv_create
+ * @param intervals   Ratio of each voice to the lead (any value > 0; bins past Nyquist are dropped)
+ * @param gains       Linear gain of each voice
+ * @param n           Number of voices, 0 .. PV_MAX_VOICES (0 for the lead only)
+ * @return            0 on success, -1 on a bad argument or out of memory (the voices are unchanged)
+ */
+int pv_set_harmony(PhaseVocoder* pv, const float* intervals, const float* gains, int n);
+
+/**
+ * @param pv          Context from pv_create
+ * @return            Harmony voices besides the lead
+ */
+int pv_get_harmony(const PhaseVocoder* pv);
+
+/**
+ * Estimate the pitch of every analysed frame from its own bins (pv_pitch.h),
+ * the analysis the shift does anyway: the per-bin frequencies come from the
+ * phase advance or the spectral shift (from the magnitudes alone when phase
+ * locked). The estimate reads the input before it is shifted.
+ * @param pv          Context from pv_create
+ * @param cfg         Estimator config (copied), or NULL to stop estimating
+ * @return            0 on success, -1 if out of memory (estimation stays off)
+ */
+int pv_set_pitch_estimate(PhaseVocoder* pv, const PvPitchConfig* cfg);
+
+/**
+ * @param pv          Context from pv_create
+ * @param pitch       Receives the newest analysed frame's estimate (pitch -1
+ *                    when estimation is off or no frame has been analysed)
+ */
+void pv_get_pitch(const PhaseVocoder* pv, PvPitch* pitch);
+
+/**
+ * Get the pitch ratio in use (after clamping)
+ * @param pv          Context from pv_create
+ * @return            Current ratio
+ */
+float pv_get_ratio(const PhaseVocoder* pv);
+
+/**
+ * Delay between input and output in samples. Output sample i + pv_latency()
+ * corresponds to input sample i.
+ * @param pv          Context from pv_create
+ * @return            Latency in samples (fft_size - hop)
+ */
+int pv_latency(const PhaseVocoder* pv);
+
+/**
+ * Push input samples and collect the pitch-shifted output produced so far.
+ * Output is produced one hop at a time, so it can be played while input arrives.
+ * @param pv          Context from pv_create
+ * @param in          n input samples (NULL feeds silence)
+ * @param n           Number of input samples
+ * @param out         Output buffer with room for n + hop + 1 samples
+ * @return            Number of samples written to out
+ */
+int pv_process(PhaseVocoder* pv, const float* in, int n, float* out);
+
+/**
+ * Drain the delay line with silence and reset the context for a new stream
+ * @param pv          Context from pv_create
+ * @param out         Output buffer with room for PV_FLUSH_ROOM(fft_size, hop) samples
+ * @return            Number of samples written to out
+ */
+int pv_flush(PhaseVocoder* pv, float* out);
+
+/**
+ * pv_process for Q15 (int16) PCM. Conversion happens one hop at a time inside
+ * the context, so callers can stream straight between PCM buffers.
+ * @param pv          Context from pv_create
+ * @param in          n Q15 input samples (NULL feeds silence)
+ * @param n           Number of input samples
+ * @param out         Output buffer with room for n + hop + 1 samples (saturated to Q15)
+ * @return            Number of samples written to out
+ */
+int pv_process_q15(PhaseVocoder* pv, const int16_t* in, int n, int16_t* out);
+
+/**
+ * pv_flush for Q15 (int16) PCM; resets the context afterwards
+ * @param pv          Context from pv_create
+ * @param out         Output buffer with room for PV_FLUSH_ROOM(fft_size, hop) samples
+ * @return            Number of samples written to out
+ */
+int pv_flush_q15(PhaseVocoder* pv, int16_t* out);
+
 /**
- * Apply phase vocoder pitch shifting to an audio buffer
- * @param input      Input audio buffer
+ * Apply phase vocoder pitch shifting to an audio buffer. Every channel gets its
+ * own vocoder and limiter, and the channels advance block by block together so
+ * that, with PV_MULTICORE, the worker cores analyse both channels' frames at once.
+ * @param input      Input audio buffer (1 .. PV_MAX_CHANNELS channels)
  * @param pitch_ratio Pitch shift ratio (1.0 = no change, 1.2 = 20% higher, 0.8 = 20% lower)
  * @return           New AudioBuffer with pitch-shifted audio (must be freed by caller)
  */
 AudioBuffer* phase_vocoder_pitch_shift(AudioBuffer* input, float pitch_ratio);
 
 /**
- * Read a WAV file into an AudioBuffer
- * @param filename   Path to WAV file
+ * Read a WAV file into an AudioBuffer, one plane per channel
+ * @param filename   Path to WAV file (1 .. PV_MAX_CHANNELS channels)
  * @return           AudioBuffer with loaded audio data (must be freed by caller)
  */
 AudioBuffer* read_wav_file(const char* filename);
 
 /**
- * Write an AudioBuffer to a WAV file
+ * Write an AudioBuffer to a WAV file (32-bit float, channels interleaved)
  * @param filename   Output WAV file path
  * @param audio      AudioBuffer to write
  * @return           0 on success, -1 on error
@@ -34,15 +282,13 @@ AudioBuffer* read_wav_file(const char* filename);
 int write_wav_file(const char* filename, AudioBuffer* audio);
 
 /**
- * Free an AudioBuffer and its data
+ * Free an AudioBuffer and its data (both come from the arena)
  * @param audio      AudioBuffer to free
  */
 static inline void free_audio_buffer(AudioBuffer* audio) {
     if (audio) {
-        if (audio->data) {
-            free(audio->data);
-        }
-        free(audio);
+        arena_free(audio->data);
+        arena_free(audio);
     }
 }
 
@@ -0,0 +1,52 @@
+#include <string.h>
+#include "pl_stats.h"
+#include "capture.h"
+#include "playback.h"
+#include "xil_io.h"
+#include "xil_printf.h"
+
+static uint32_t pl_stats_get(UINTPTR base, PlStatsSel sel) {
+    Xil_Out32(base + PL_STATS_SEL_OFFSET, sel);
+    return Xil_In32(base + PL_STATS_STATUS_OFFSET);
+}
+
+void pl_stats_clear(UINTPTR base) {
+    Xil_Out32(base + PL_STATS_SEL_OFFSET, PL_STATS_CLEAR);
+    Xil_Out32(base + PL_STATS_SEL_OFFSET, PL_STATS_SEL_STATUS);
+}
+
+int pl_stats_read(UINTPTR base, PlStreamStats* st) {
+    memset(st, 0, sizeof(*st));
+    if (pl_stats_get(base, PL_STATS_SEL_ID) != PL_STATS_ID) {
+        Xil_Out32(base + PL_STATS_SEL_OFFSET, PL_STATS_SEL_STATUS);
+        return -1;
+    }
+    st->words = pl_stats_get(base, PL_STATS_SEL_WORDS);
+    st->drops = pl_stats_get(base, PL_STATS_SEL_DROPS);
+    st->underruns = pl_stats_get(base, PL_STATS_SEL_UNDERRUNS);
+    st->high_water = pl_stats_get(base, PL_STATS_SEL_HIGH_WATER);
+    st->stalls = pl_stats_get(base, PL_STATS_SEL_STALLS);
+    Xil_Out32(base + PL_STATS_SEL_OFFSET, PL_STATS_SEL_STATUS);
+    return 0;
+}
+
+void pl_stats_clear_all(void) {
+    pl_stats_clear((UINTPTR)CAPTURE_PL_BASEADDR);
+    pl_stats_clear((UINTPTR)PLAYBACK_PL_BASEADDR);
+}
+
+static void pl_stats_line(const char* name, UINTPTR base, uint32_t fifo_words) {
+    PlStreamStats st;
+    if (pl_stats_read(base, &st) != 0) {
+        return;
+    }
+    xil_printf("  %-9s %10lu %8lu %9lu %5lu/%-5lu %10lu\r\n", name,
+               (unsigned long)st.words, (unsigned long)st.drops, (unsigned long)st.underruns,
+               (unsigned long)st.high_water, (unsigned long)fifo_words, (unsigned long)st.stalls);
+}
+
+void pl_stats_report(void) {
+    xil_printf("PL streams       words    drops underruns  high water     stalls\r\n");
+    pl_stats_line("capture", (UINTPTR)CAPTURE_PL_BASEADDR, CAPTURE_PL_FIFO_WORDS);
+    pl_stats_line("playback", (UINTPTR)PLAYBACK_PL_BASEADDR, PLAYBACK_PL_FIFO);
+}
@@ -0,0 +1,70 @@
+#ifndef PL_STATS_H
+#define PL_STATS_H
+
+#include <stdint.h>
+#include "xil_types.h"
+
+// Streaming counters in the fabric (stream_telemetry), one set on the
+// capture path (audio_pipeline) and one on the playback path
+// (amplifier_pipeline). They count what the DMA engines' own estimates can
+// only model: words the capture FIFO discarded while full, reads the speaker
+// found empty, how full each FIFO got and how long the AXIS side waited.
+//
+// Each pipeline's control bus register 7 picks the counter its status
+// register reads back (0 keeps the status constant); bit 31 holds every
+// counter at zero. The counters run freely from the clear and wrap at
+// 2^32. Reads are two bus accesses apiece and do not stop the stream, so
+// a set is a snapshot taken over a few hundred nanoseconds.
+//
+// A bitstream without the counters reads the status constant for every
+// selection; pl_stats_read tells the two apart by the counter block's ID.
+
+#define PL_STATS_STATUS_OFFSET  0x04    // cb_status_reg
+#define PL_STATS_SEL_OFFSET     0x1C    // cb_param3_reg
+#define PL_STATS_CLEAR          0x80000000u
+#define PL_STATS_ID             0x7E1E0001u
+
+typedef enum {
+    PL_STATS_SEL_STATUS = 0,
+    PL_STATS_SEL_WORDS,         // Words written into the FIFO
+    PL_STATS_SEL_DROPS,         // Words the FIFO lost
+    PL_STATS_SEL_UNDERRUNS,     // Reads that found the FIFO empty (playback only)
+    PL_STATS_SEL_HIGH_WATER,    // Highest fill level, in words
+    PL_STATS_SEL_STALLS,        // Cycles with tvalid high and tready low
+    PL_STATS_SEL_ID = 7
+} PlStatsSel;
+
+typedef struct {
+    uint32_t words;
+    uint32_t drops;
+    uint32_t underruns;
+    uint32_t high_water;
+    uint32_t stalls;
+} PlStreamStats;
+
+/**
+ * Zero one path's counters
+ * @param base       Pipeline AXI-Lite base address
+ */
+void pl_stats_clear(UINTPTR base);
+
+/**
+ * Read one path's counters, leaving the status register on the status constant
+ * @param base       Pipeline AXI-Lite base address
+ * @param st         Receives the counters
+ * @return           0 on success, -1 if the bitstream has no counters (st zeroed)
+ */
+int pl_stats_read(UINTPTR base, PlStreamStats* st);
+
+/**
+ * Zero the capture and playback counters
+ */
+void pl_stats_clear_all(void);
+
+/**
+ * Print one line per path: words, drops, underruns, FIFO high water and
+ * AXIS stall cycles (nothing for a path without counters)
+ */
+void pl_stats_report(void);
+
+#endif // PL_STATS_H
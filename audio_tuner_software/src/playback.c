@@ -0,0 +1,189 @@
+#include <string.h>
+#include "playback.h"
+#include "dma_mem.h"
+#include "fixed_point.h"
+#include "xil_io.h"
+#include "xparameters.h"
+#include "xtime_l.h"
+
+#define PLAYBACK_SR_IDLE      0x2u          // MM2S_DMASR.Idle
+#define PLAYBACK_CLOCK_SLACK  (128 / PLAYBACK_WORD_SLOTS)  // Words (64 samples) of sample-clock / timer disagreement tolerated
+
+enum { PB_FREE, PB_QUEUED, PB_ARMED };
+
+static uint32_t pb_buf[PLAYBACK_BUFFERS][PLAYBACK_WORDS] DMA_MEM;
+static const uint32_t* pb_src[PLAYBACK_BUFFERS];  // Words each queue slot sends (own buffer or a reference)
+static int pb_len[PLAYBACK_BUFFERS];        // Words queued in each slot
+static uint8_t pb_state[PLAYBACK_BUFFERS];
+
+static XAxiDma* pb_dma;
+static int pb_fill;                         // Next buffer handed to the producer
+static int pb_next;                         // Next buffer to arm
+static int pb_armed = -1;                   // Buffer in flight (-1 = none)
+static int pb_error;
+static int pb_started;                      // First buffer armed; the speaker is draining
+static XTime pb_t0;
+static uint64_t pb_sent;                    // Words handed to the DMA
+static uint64_t pb_silent;                  // Words the speaker played as silence
+static PlaybackStats pb_stats;
+
+// Arm pb_next, first checking whether the speaker ran dry while nothing was armed
+static void playback_arm(void) {
+    XTime now;
+    XTime_GetTime(&now);
+
+    if (!pb_started) {
+        pb_started = 1;
+        pb_t0 = now;
+    } else {
+        uint64_t due = (uint64_t)(now - pb_t0) * PLAYBACK_FS * 2 / PLAYBACK_WORD_SLOTS / COUNTS_PER_SECOND;
+        uint64_t have = pb_sent + pb_silent;
+        if (due > have + PLAYBACK_CLOCK_SLACK) {
+            pb_stats.underruns++;
+            pb_silent += due - have;
+            pb_stats.silent_samples = (uint32_t)(pb_silent * PLAYBACK_WORD_SLOTS / 2);
+        }
+    }
+
+    int b = pb_next;
+    if (XAxiDma_SimpleTransfer(pb_dma, (UINTPTR)pb_src[b], pb_len[b] * sizeof(uint32_t),
+                               XAXIDMA_DMA_TO_DEVICE) != XST_SUCCESS) {
+        pb_stats.dma_errors++;
+        pb_error = 1;
+        return;
+    }
+    pb_state[b] = PB_ARMED;
+    pb_armed = b;
+    pb_sent += pb_len[b];
+    pb_next = (b + 1) % PLAYBACK_BUFFERS;
+}
+
+// Retire a finished transfer and arm the next queued buffer
+static void playback_service(void) {
+    if (pb_error) {
+        return;
+    }
+    if (pb_armed >= 0) {
+        uint32_t sr = XAxiDma_ReadReg(pb_dma->RegBase, XAXIDMA_TX_OFFSET + XAXIDMA_SR_OFFSET);
+        if (sr & XAXIDMA_ERR_ALL_MASK) {
+            pb_stats.dma_errors++;
+            pb_error = 1;
+            return;
+        }
+        if (!(sr & PLAYBACK_SR_IDLE)) {
+            return;
+        }
+        pb_state[pb_armed] = PB_FREE;
+        pb_stats.buffers++;
+        pb_armed = -1;
+    }
+    if (pb_state[pb_next] == PB_QUEUED) {
+        playback_arm();
+    }
+}
+
+void playback_start(XAxiDma* dma) {
+    pb_dma = dma;
+    memset(pb_state, PB_FREE, sizeof(pb_state));
+    memset(&pb_stats, 0, sizeof(pb_stats));
+    pb_fill = 0;
+    pb_next = 0;
+    pb_armed = -1;
+    pb_error = 0;
+    pb_started = 0;
+    pb_sent = 0;
+    pb_silent = 0;
+    XAxiDma_IntrDisable(dma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DMA_TO_DEVICE);
+
+    uint32_t ctrl = 0;
+#if PLAYBACK_PL_MONO
+    ctrl |= PLAYBACK_CTRL_MONO;
+#endif
+#if PLAYBACK_PL_PACK
+    ctrl |= PLAYBACK_CTRL_PACK16;
+#endif
+#if PLAYBACK_PL_FIR
+    Xil_Out32((UINTPTR)PLAYBACK_PL_BASEADDR + PLAYBACK_FIR_OFFSET, PLAYBACK_FIR_TAPS);
+    ctrl |= PLAYBACK_CTRL_FIR;
+#endif
+#if PLAYBACK_PL_DYNAMICS
+    Xil_Out32((UINTPTR)PLAYBACK_PL_BASEADDR + PLAYBACK_LEVEL_OFFSET, PLAYBACK_DYN_LEVELS);
+    Xil_Out32((UINTPTR)PLAYBACK_PL_BASEADDR + PLAYBACK_DYN_OFFSET, PLAYBACK_DYN_SHAPE);
+    ctrl |= PLAYBACK_CTRL_DYNAMICS;
+#endif
+    Xil_Out32((UINTPTR)PLAYBACK_PL_BASEADDR + PLAYBACK_CTRL_OFFSET, ctrl);
+}
+
+int playback_acquire(uint32_t** words) {
+    playback_service();
+    if (pb_error) {
+        return -1;
+    }
+    if (pb_state[pb_fill] != PB_FREE) {
+        return 0;
+    }
+    *words = pb_buf[pb_fill];
+    return 1;
+}
+
+int playback_fill(uint32_t* words, const int16_t* pcm, int n) {
+#if PLAYBACK_PL_MONO && PLAYBACK_PL_PACK
+    // The stream word is the PCM itself; an odd tail is padded with silence
+    memcpy(words, pcm, n * sizeof(int16_t));
+    if (n & 1) {
+        words[n / 2] = (uint16_t)pcm[n - 1];
+    }
+    return (n + 1) / 2;
+#elif PLAYBACK_PL_MONO
+    for (int i = 0; i < n; i++) {
+        words[i] = (uint32_t)pcm[i] << 16;
+    }
+    return n;
+#elif PLAYBACK_PL_PACK
+    for (int i = 0; i < n; i++) {
+        words[i] = ((uint32_t)pcm[i] << 16) | (uint16_t)pcm[i];
+    }
+    return n;
+#else
+    pcm_to_playback(pcm, words, n);
+    return 2 * n;
+#endif
+}
+
+// Hand the slot at pb_fill to the DMA side
+static void playback_enqueue(const uint32_t* words, int nwords) {
+    int b = pb_fill;
+    pb_src[b] = words;
+    pb_len[b] = nwords;
+    dma_mem_to_device(words, nwords * sizeof(uint32_t));
+    pb_state[b] = PB_QUEUED;
+    pb_fill = (b + 1) % PLAYBACK_BUFFERS;
+    playback_service();
+}
+
+void playback_submit(int nwords) {
+    playback_enqueue(pb_buf[pb_fill], nwords);
+}
+
+int playback_queue(const void* words, int nwords) {
+    playback_service();
+    if (pb_error) {
+        return -1;
+    }
+    if (pb_state[pb_fill] != PB_FREE) {
+        return 0;
+    }
+    playback_enqueue((const uint32_t*)words, nwords);
+    return 1;
+}
+
+int playback_finish(void) {
+    while (!pb_error && (pb_armed >= 0 || pb_state[pb_next] == PB_QUEUED)) {
+        playback_service();
+    }
+    return pb_error ? -1 : 0;
+}
+
+void playback_get_stats(PlaybackStats* stats) {
+    *stats = pb_stats;
+}
@@ -0,0 +1,141 @@
+#ifndef PLAYBACK_H
+#define PLAYBACK_H
+
+#include <stdint.h>
+#include "xaxidma.h"
+
+// Queued MM2S playback. The producer fills one of PLAYBACK_BUFFERS buffers
+// (e.g. reads and expands the next block from SD) while earlier ones are
+// queued or in flight; every call re-arms the DMA with the next queued
+// buffer as soon as the current transfer completes (polled completion).
+//
+// The amplifier_pipeline FIFO holds PLAYBACK_PL_FIFO words and is drained
+// at the sample rate once playback starts. The engine models its level from
+// the timer and counts an underrun whenever the speaker must have run dry
+// before the next buffer was armed.
+//
+// The stream format is set through the amplifier_pipeline control register:
+// by default each word is one channel slot, so every sample is sent twice
+// (L and R). PLAYBACK_PL_MONO has one word feed both slots, PLAYBACK_PL_PACK
+// carries two 16-bit samples per word; together they cut the MM2S traffic
+// to a quarter. playback_fill writes whichever format is configured.
+//
+// In the MONO + PACK format a stream word is just two int16_t samples, so a
+// PCM buffer already in DDR can be sent as it is: playback_queue() puts a
+// reference to it in the queue instead of one of the engine's own buffers.
+//
+// PLAYBACK_PL_FIR and PLAYBACK_PL_DYNAMICS switch on the fabric FIR and the
+// gate/boost/compression stage (speaker_dsp in amplifier_pipeline) on the way
+// to the speaker; playback_start writes their parameters first. Both cost no
+// CPU time and add a few clocks of latency per word.
+
+#ifndef PLAYBACK_PL_MONO
+#define PLAYBACK_PL_MONO        0
+#endif
+
+#ifndef PLAYBACK_PL_PACK
+#define PLAYBACK_PL_PACK        0
+#endif
+
+#ifndef PLAYBACK_PL_FIR
+#define PLAYBACK_PL_FIR         0
+#endif
+
+#ifndef PLAYBACK_PL_DYNAMICS
+#define PLAYBACK_PL_DYNAMICS    0
+#endif
+
+#ifndef PLAYBACK_PL_BASEADDR
+#define PLAYBACK_PL_BASEADDR    XPAR_AMPLIFIER_PIPELINE_0_S00_AXI_BASEADDR
+#endif
+
+#define PLAYBACK_SAMPLES        1024    // Mono samples per buffer (21.3 ms at 48 kHz)
+#define PLAYBACK_WORD_SLOTS     (1 << (PLAYBACK_PL_MONO + PLAYBACK_PL_PACK))  // L/R slots per word
+#define PLAYBACK_WORDS          (PLAYBACK_SAMPLES * 2 / PLAYBACK_WORD_SLOTS)
+#define PLAYBACK_BUFFERS        4
+#define PLAYBACK_PL_FIFO        4096    // amplifier_pipeline FIFO (2**FIFO_DEPTH words)
+
+// amplifier_pipeline cb_control_reg
+#define PLAYBACK_CTRL_OFFSET    0x0
+#define PLAYBACK_CTRL_MONO      0x2u
+#define PLAYBACK_CTRL_PACK16    0x4u
+#define PLAYBACK_CTRL_FIR       0x8u
+#define PLAYBACK_CTRL_DYNAMICS  0x10u
+
+// speaker_dsp parameters (levels are bits 23:8 of the 24-bit envelope)
+#define PLAYBACK_FIR_OFFSET     0x10
+#define PLAYBACK_LEVEL_OFFSET   0x14    // 15:0 gate, 31:16 boost
+#define PLAYBACK_DYN_OFFSET     0x18    // 15:0 compression, shifts: 19:16 boost, 23:20 compression, 27:24 attack, 31:28 release
+
+#ifndef PLAYBACK_FIR_TAPS
+#define PLAYBACK_FIR_TAPS       0x01030301u     // [1,3,3,1]/8, Q3 taps, newest in 7:0
+#endif
+#ifndef PLAYBACK_DYN_LEVELS
+#define PLAYBACK_DYN_LEVELS     0x04000080u     // Boost below -30 dBFS, gate below -48 dBFS
+#endif
+#ifndef PLAYBACK_DYN_SHAPE
+#define PLAYBACK_DYN_SHAPE      0x63111000u     // Halve above -18 dBFS, double when boosting, attack 2^-3, release 2^-6
+#endif
+
+#define PLAYBACK_ZERO_COPY      (PLAYBACK_PL_MONO && PLAYBACK_PL_PACK)  // int16_t PCM is the stream format
+
+#ifndef PLAYBACK_FS
+#define PLAYBACK_FS             48000
+#endif
+
+typedef struct {
+    uint32_t buffers;           // Transfers completed
+    uint32_t underruns;         // Times the speaker FIFO ran dry
+    uint32_t silent_samples;    // Estimated samples of silence inserted by underruns
+    uint32_t dma_errors;        // Transfers that ended with an MM2S error
+} PlaybackStats;
+
+/**
+ * Clear the queue and statistics and set the speaker stream format
+ * @param dma        Initialised simple-mode DMA whose MM2S channel feeds the speaker
+ */
+void playback_start(XAxiDma* dma);
+
+/**
+ * Next free buffer of PLAYBACK_WORDS words, polling the DMA first
+ * @param words      Receives the buffer (fill it, then playback_submit)
+ * @return           1 with a buffer, 0 if all are queued or in flight, -1 after a DMA error
+ */
+int playback_acquire(uint32_t** words);
+
+/**
+ * Write mono PCM into a buffer in the configured stream format
+ * @param words      Buffer from playback_acquire()
+ * @param pcm        n samples
+ * @param n          Number of samples (1 .. PLAYBACK_SAMPLES)
+ * @return           Words written, for playback_submit
+ */
+int playback_fill(uint32_t* words, const int16_t* pcm, int n);
+
+/**
+ * Queue the buffer from playback_acquire(); it is sent as soon as the DMA is free
+ * @param nwords     Words filled (as returned by playback_fill)
+ */
+void playback_submit(int nwords);
+
+/**
+ * Queue caller-owned stream words by reference (no copy); they must stay
+ * unchanged until playback_finish() returns
+ * @param words      Stream words, 4-byte aligned (e.g. int16_t PCM with PLAYBACK_ZERO_COPY)
+ * @param nwords     Number of words (1 .. PLAYBACK_WORDS)
+ * @return           1 if queued, 0 if all queue slots are taken, -1 after a DMA error
+ */
+int playback_queue(const void* words, int nwords);
+
+/**
+ * Wait until every queued buffer has been sent
+ * @return           0 on success, -1 after a DMA error
+ */
+int playback_finish(void);
+
+/**
+ * @param stats      Receives the counters since the last playback_start
+ */
+void playback_get_stats(PlaybackStats* stats);
+
+#endif // PLAYBACK_H
@@ -0,0 +1,79 @@
+#include "prof.h"
+
+#if PROFILE
+
+#include <string.h>
+#include "xil_printf.h"
+#include "xparameters.h"
+#if PROFILE_PL
+#include "pl_stats.h"
+#endif
+
+#if PROFILE_PMU
+#define PROF_TICKS_PER_SECOND   XPAR_CPU_CORTEXA53_0_CPU_CLK_FREQ_HZ
+#define PROF_EVT_L1D_REFILL     0x03    // ARMv8 common events
+#define PROF_EVT_L2D_REFILL     0x17
+#else
+#define PROF_TICKS_PER_SECOND   COUNTS_PER_SECOND
+#endif
+
+ProfStat prof_table[PROF_PROBES];
+
+static const char* const prof_names[PROF_PROBES] = {
+    "dma wait", "convert", "f_write", "f_read",
+    "yin step 1", "yin step 2", "yin step 3",
+    "pv fft", "pv ifft", "pv phase", "pv ola",
+};
+
+void prof_clear(void) {
+    memset(prof_table, 0, sizeof(prof_table));
+#if PROFILE_PMU
+    // Counter 0 = L1D_CACHE_REFILL, counter 1 = L2D_CACHE_REFILL
+    __asm__ volatile("msr pmevtyper0_el0, %0" : : "r"((uint64_t)PROF_EVT_L1D_REFILL));
+    __asm__ volatile("msr pmevtyper1_el0, %0" : : "r"((uint64_t)PROF_EVT_L2D_REFILL));
+    // Enable and reset the cycle and event counters (PMCR_EL0.E, .P, .C), then
+    // count (PMCNTENSET_EL0.C, .P0, .P1)
+    uint64_t pmcr;
+    __asm__ volatile("mrs %0, pmcr_el0" : "=r"(pmcr));
+    __asm__ volatile("msr pmcr_el0, %0" : : "r"(pmcr | 0x7));
+    __asm__ volatile("msr pmcntenset_el0, %0" : : "r"(((uint64_t)1 << 31) | 0x3));
+    __asm__ volatile("isb");
+#endif
+#if PROFILE_PL
+    pl_stats_clear_all();
+#endif
+}
+
+// Ticks as whole and tenths of a microsecond (xil_printf has no %f)
+static void prof_print_us(uint64_t ticks) {
+    uint64_t tenths = ticks * 10000000ULL / PROF_TICKS_PER_SECOND;
+    xil_printf(" %6lu.%lu", (unsigned long)(tenths / 10), (unsigned long)(tenths % 10));
+}
+
+void prof_report(void) {
+#if PROFILE_PMU
+    xil_printf("Profile (us)       count      min     mean      max   L1D/call  L2D/call\r\n");
+#else
+    xil_printf("Profile (us)       count      min     mean      max\r\n");
+#endif
+    for (int p = 0; p < PROF_PROBES; p++) {
+        const ProfStat* s = &prof_table[p];
+        if (s->count == 0) {
+            continue;
+        }
+        xil_printf("  %-12s %9lu", prof_names[p], (unsigned long)s->count);
+        prof_print_us(s->min);
+        prof_print_us(s->total / s->count);
+        prof_print_us(s->max);
+#if PROFILE_PMU
+        xil_printf(" %10lu %9lu", (unsigned long)(s->l1_refills / s->count),
+                   (unsigned long)(s->l2_refills / s->count));
+#endif
+        xil_printf("\r\n");
+    }
+#if PROFILE_PL
+    pl_stats_report();
+#endif
+}
+
+#endif // PROFILE
@@ -0,0 +1,152 @@
+#ifndef PROF_H
+#define PROF_H
+
+#include <stdint.h>
+
+// Per-stage timing probes: min/mean/max/count of each stage of a take,
+// printed at state 5.
+//
+// PROF_START/PROF_STOP bracket a stage; the span goes into a fixed table, one
+// row per probe. A probe that is already running keeps its start, so a poll
+// loop may call PROF_START on every pass and PROF_STOP once the data is in.
+// Probes do not nest with themselves, and the table is not shared between
+// cores (records from the pv_mc workers or the R5 are not taken).
+//
+// Ticks come from the generic timer (XTime_GetTime, COUNTS_PER_SECOND), or
+// with PROFILE_PMU=1 from the A53 PMU cycle counter (PMCCNTR_EL0, CPU clock).
+// PROFILE_PMU=1 also counts L1D and L2D refills (PMU event counters 0 and 1)
+// over each span, reported per call, to see a working set fall out of cache.
+// With PROFILE_PL=1 (the default) the fabric's stream counters (pl_stats)
+// are cleared with the table and printed under it, so the capture FIFO's
+// drops and high water sit next to the DMA wait they explain.
+// With PROFILE=0 (the default) every probe compiles to nothing.
+
+#ifndef PROFILE
+#define PROFILE             0
+#endif
+
+#ifndef PROFILE_PMU
+#define PROFILE_PMU         0
+#endif
+
+#ifndef PROFILE_PL
+#define PROFILE_PL          1
+#endif
+
+typedef enum {
+    PROF_DMA_WAIT,              // Capture: waiting for the next burst
+    PROF_CONVERT,               // Capture words to 16-bit PCM
+    PROF_SD_WRITE,              // f_write of a staged WAV block
+    PROF_SD_READ,               // f_read of WAV samples
+    PROF_YIN_DIFF,              // Yin step 1 (difference function)
+    PROF_YIN_CMND,              // Yin step 2 (cumulative mean normalisation)
+    PROF_YIN_THRESH,            // Yin step 3 (absolute threshold)
+    PROF_PV_FFT,                // Vocoder forward FFT
+    PROF_PV_IFFT,               // Vocoder inverse FFT
+    PROF_PV_PHASE,              // Vocoder phase advance and polar to rect
+    PROF_PV_OLA,                // Vocoder overlap-add
+    PROF_PROBES
+} ProfProbe;
+
+#if PROFILE
+
+#include "xtime_l.h"
+
+typedef struct {
+    uint64_t start;             // Tick the running span began at
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    uint32_t count;
+    uint32_t running;
+#if PROFILE_PMU
+    uint32_t l1_start;          // Refill counts when the running span began
+    uint32_t l2_start;
+    uint64_t l1_refills;        // L1D_CACHE_REFILL over all spans
+    uint64_t l2_refills;        // L2D_CACHE_REFILL over all spans
+#endif
+} ProfStat;
+
+extern ProfStat prof_table[PROF_PROBES];
+
+static inline uint64_t prof_now(void) {
+#if PROFILE_PMU
+    uint64_t c;
+    __asm__ volatile("mrs %0, pmccntr_el0" : "=r"(c));
+    return c;
+#else
+    XTime t;
+    XTime_GetTime(&t);
+    return t;
+#endif
+}
+
+#if PROFILE_PMU
+// Event counters 0 and 1, set up by prof_clear
+static inline uint32_t prof_refills(int level) {
+    uint64_t c;
+    if (level == 1) {
+        __asm__ volatile("mrs %0, pmevcntr0_el0" : "=r"(c));
+    } else {
+        __asm__ volatile("mrs %0, pmevcntr1_el0" : "=r"(c));
+    }
+    return (uint32_t)c;
+}
+#endif
+
+static inline void prof_start(ProfProbe p) {
+    if (!prof_table[p].running) {
+        prof_table[p].running = 1;
+#if PROFILE_PMU
+        prof_table[p].l1_start = prof_refills(1);
+        prof_table[p].l2_start = prof_refills(2);
+#endif
+        prof_table[p].start = prof_now();
+    }
+}
+
+static inline void prof_stop(ProfProbe p) {
+    ProfStat* s = &prof_table[p];
+    if (!s->running) {
+        return;
+    }
+    uint64_t span = prof_now() - s->start;
+#if PROFILE_PMU
+    s->l1_refills += (uint32_t)(prof_refills(1) - s->l1_start);
+    s->l2_refills += (uint32_t)(prof_refills(2) - s->l2_start);
+#endif
+    s->running = 0;
+    s->total += span;
+    if (s->count == 0 || span < s->min) s->min = span;
+    if (span > s->max) s->max = span;
+    s->count++;
+}
+
+/**
+ * Empty the table (and start the PMU cycle and refill counters with PROFILE_PMU=1,
+ * and zero the PL stream counters with PROFILE_PL=1)
+ */
+void prof_clear(void);
+
+/**
+ * Print one line per probe that has fired: count and min/mean/max in microseconds
+ * (with PROFILE_PMU=1 also L1D and L2D refills per call; with PROFILE_PL=1
+ * the PL stream counters follow)
+ */
+void prof_report(void);
+
+#define PROF_START(p)       prof_start(p)
+#define PROF_STOP(p)        prof_stop(p)
+#define PROF_CLEAR()        prof_clear()
+#define PROF_REPORT()       prof_report()
+
+#else
+
+#define PROF_START(p)       ((void)0)
+#define PROF_STOP(p)        ((void)0)
+#define PROF_CLEAR()        ((void)0)
+#define PROF_REPORT()       ((void)0)
+
+#endif // PROFILE
+
+#endif // PROF_H
@@ -0,0 +1,293 @@
+#include <math.h>
+#include <string.h>
+#include "psola.h"
+#include "Yin.h"
+#include "fixed_point.h"
+#include "arena.h"
+#include "dlog.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define PSOLA_WINDOW_TABLE      1024        // Hann table, stretched over each grain
+#define PSOLA_MIN_WEIGHT        0.5f        // Window sum below this is not normalised away
+#define PSOLA_UNVOICED_PERIOD   256         // Grain spacing for unvoiced input (5.3 ms)
+#define PSOLA_MAX_PITCH         1000.0f     // Highest pitch followed (Hz)
+#define PSOLA_THRESHOLD         0.15f       // Yin threshold for the internal estimate
+
+struct Psola {
+    int max_period;
+    int unvoiced_period;
+    int latency;
+    int mask;               // Ring size - 1
+    float ratio;
+    float period;           // Pitch period of the newest input (samples), 0 if unvoiced
+
+    int16_t* in_ring;       // Recent input, indexed by absolute sample & mask
+    float* ola_ring;        // Overlap-add accumulator, indexed the same way as the output
+    float* weight_ring;     // Sum of the windows added at each output sample
+    float window[PSOLA_WINDOW_TABLE];
+
+    int64_t in_total;       // Samples pushed since the last reset (flush silence included)
+    int64_t out_done;       // Output samples taken from the rings
+    int64_t out_final;      // Output before this gets no more grains
+    int64_t delivered;      // Samples returned by process/flush (latency included)
+
+    int64_t mark;           // Analysis mark at or before the synthesis time
+    int64_t next_mark;      // The one after it (valid when have_next)
+    int have_next;
+    double synth_time;      // Next synthesis mark
+
+    int track;              // Internal Yin estimate
+    int flushing;           // Pushing the flush silence: no estimates
+    int since_track;        // Samples since the last estimate
+    Yin yin;
+    int16_t* frame;         // Newest 2 * max_period samples, contiguous for Yin
+};
+
+/*** Marks and grains ***/
+
+static float psola_grain_period(const Psola* ps) {
+    return ps->period > 0.0f ? ps->period : (float)ps->unvoiced_period;
+}
+
+// Analysis mark one period after the current one; voiced marks move to the
+// largest sample within a quarter period. Returns 0 until the input is there
+static int psola_find_mark(Psola* ps, float period) {
+    const int64_t expect = ps->mark + (int64_t)(period + 0.5f);
+    if (ps->period <= 0.0f) {
+        if (expect > ps->in_total) return 0;
+        ps->next_mark = expect;
+        ps->have_next = 1;
+        return 1;
+    }
+
+    const int reach = (int)(period * 0.25f);
+    if (expect + reach >= ps->in_total) return 0;
+    int64_t best = expect;
+    int16_t peak = ps->in_ring[expect & ps->mask];
+    for (int64_t k = expect - reach; k <= expect + reach; k++) {
+        int16_t v = ps->in_ring[k & ps->mask];
+        if (v > peak) {
+            peak = v;
+            best = k;
+        }
+    }
+    ps->next_mark = best;
+    ps->have_next = 1;
+    return 1;
+}
+
+// Hann grain of 2 * half samples around input sample src, added at output sample centre
+static void psola_add_grain(Psola* ps, int64_t src, int64_t centre, int half) {
+    const uint32_t step = ((uint32_t)PSOLA_WINDOW_TABLE << 16) / (uint32_t)(2 * half);
+    int first = -half;
+    if (centre - half < ps->out_done) {
+        first = (int)(ps->out_done - centre);   // Already returned (start of a stream)
+    }
+    for (int i = first; i < half; i++) {
+        float w = ps->window[((uint32_t)(i + half) * step) >> 16];
+        int64_t o = (centre + i) & ps->mask;
+        ps->ola_ring[o] += w * ps->in_ring[(src + i) & ps->mask];
+        ps->weight_ring[o] += w;
+    }
+}
+
+// Place every synthesis grain the input now covers
+static void psola_synthesise(Psola* ps) {
+    for (;;) {
+        const float period = psola_grain_period(ps);
+        const float ratio = ps->period > 0.0f ? ps->ratio : 1.0f;
+
+        if (!ps->have_next && !psola_find_mark(ps, period)) {
+            return;
+        }
+        if ((double)ps->next_mark <= ps->synth_time) {
+            ps->mark = ps->next_mark;
+            ps->have_next = 0;
+            continue;
+        }
+
+        // Nearest analysis mark; grains stay two periods long, so lowering leaves gaps between them
+        int64_t src = ps->synth_time - ps->mark <= ps->next_mark - ps->synth_time ? ps->mark : ps->next_mark;
+        int half = (int)(period + 0.5f);
+        if (half > ps->max_period) half = ps->max_period;
+        if (half < 2) half = 2;
+        if (src + half > ps->in_total) {
+            return;
+        }
+
+        psola_add_grain(ps, src, (int64_t)(ps->synth_time + 0.5), half);
+        ps->synth_time += period / ratio;
+        // No later grain reaches back further than max_period
+        ps->out_final = (int64_t)ps->synth_time - ps->max_period;
+    }
+}
+
+// Internal pitch of the newest 2 * max_period samples
+static void psola_track(Psola* ps) {
+    const int n = 2 * ps->max_period;
+    for (int i = 0; i < n; i++) {
+        ps->frame[i] = ps->in_ring[(ps->in_total - n + i) & ps->mask];
+    }
+    float pitch = Yin_getPitch(&ps->yin, ps->frame);
+    psola_set_pitch(ps, Yin_getProbability(&ps->yin) >= PSOLA_MIN_PROBABILITY ? pitch : -1.0f);
+}
+
+// Return finished samples, the first `latency` of a stream being silence, up to `limit` in total
+static int psola_emit(Psola* ps, int16_t* out, int64_t limit) {
+    int n = 0;
+    while (ps->delivered < limit) {
+        if (ps->delivered < ps->latency) {
+            out[n++] = 0;
+            ps->delivered++;
+            continue;
+        }
+        if (ps->out_done >= ps->out_final) {
+            break;
+        }
+        int64_t o = ps->out_done & ps->mask;
+        float w = ps->weight_ring[o];
+        float y = ps->ola_ring[o] / (w > PSOLA_MIN_WEIGHT ? w : PSOLA_MIN_WEIGHT);
+        ps->ola_ring[o] = 0.0f;
+        ps->weight_ring[o] = 0.0f;
+        out[n++] = q15_sat((int32_t)lrintf(y));
+        ps->out_done++;
+        ps->delivered++;
+    }
+    return n;
+}
+
+// Push up to PSOLA_TRACK_HOP samples
+static void psola_push(Psola* ps, const int16_t* in, int n) {
+    for (int i = 0; i < n; i++) {
+        ps->in_ring[(ps->in_total + i) & ps->mask] = in ? in[i] : 0;
+    }
+    ps->in_total += n;
+    if (ps->track && !ps->flushing && (ps->since_track += n) >= PSOLA_TRACK_HOP) {
+        ps->since_track = 0;
+        psola_track(ps);
+    }
+    psola_synthesise(ps);
+}
+
+/*** Public ***/
+
+Psola* psola_create(int max_period, float pitch_ratio, int track) {
+    if (max_period < 64 || max_period > 2048) {
+        DLOG_ERROR("Error: PSOLA period %d out of range\r\n", max_period);
+        return NULL;
+    }
+    Psola* ps = (Psola*)arena_calloc(1, sizeof(Psola));
+    if (!ps) return NULL;
+
+    // The rings span the latency plus a grain on either side
+    int ring = 1;
+    while (ring < 8 * max_period) ring <<= 1;
+    ps->mask = ring - 1;
+    ps->max_period = max_period;
+    ps->unvoiced_period = max_period < PSOLA_UNVOICED_PERIOD ? max_period : PSOLA_UNVOICED_PERIOD;
+    ps->latency = PSOLA_FLUSH_ROOM(max_period);
+    ps->track = track;
+
+    ps->in_ring = (int16_t*)arena_malloc(ring * sizeof(int16_t));
+    ps->ola_ring = (float*)arena_malloc(ring * sizeof(float));
+    ps->weight_ring = (float*)arena_malloc(ring * sizeof(float));
+    if (track) {
+        ps->frame = (int16_t*)arena_malloc(2 * max_period * sizeof(int16_t));
+        Yin_init(&ps->yin, 2 * max_period, PSOLA_THRESHOLD);
+    }
+    if (!ps->in_ring || !ps->ola_ring || !ps->weight_ring ||
+        (track && (!ps->frame || !ps->yin.yinBuffer))) {
+        DLOG_ERROR("Error: Failed to allocate PSOLA buffers\r\n");
+        psola_destroy(ps);
+        return NULL;
+    }
+    if (track) {
+        Yin_setRange(&ps->yin, (float)YIN_SAMPLING_RATE / max_period, PSOLA_MAX_PITCH);
+    }
+
+    for (int i = 0; i < PSOLA_WINDOW_TABLE; i++) {
+        ps->window[i] = 0.5f * (1.0f - cosf(2.0f * (float)M_PI * i / PSOLA_WINDOW_TABLE));
+    }
+    psola_set_ratio(ps, pitch_ratio);
+    psola_reset(ps);
+    return ps;
+}
+
+void psola_destroy(Psola* ps) {
+    if (!ps) return;
+    if (ps->track && ps->yin.workspace) {
+        Yin_free(&ps->yin);
+    }
+    arena_free(ps->frame);
+    arena_free(ps->in_ring);
+    arena_free(ps->ola_ring);
+    arena_free(ps->weight_ring);
+    arena_free(ps);
+}
+
+void psola_reset(Psola* ps) {
+    const int ring = ps->mask + 1;
+    memset(ps->in_ring, 0, ring * sizeof(int16_t));
+    memset(ps->ola_ring, 0, ring * sizeof(float));
+    memset(ps->weight_ring, 0, ring * sizeof(float));
+    ps->period = 0.0f;
+    ps->in_total = 0;
+    ps->out_done = 0;
+    ps->out_final = 0;
+    ps->delivered = 0;
+    ps->mark = 0;
+    ps->have_next = 0;
+    ps->synth_time = 0.0;
+    ps->since_track = 0;
+}
+
+void psola_set_ratio(Psola* ps, float pitch_ratio) {
+    if (pitch_ratio < 0.5f) pitch_ratio = 0.5f;
+    if (pitch_ratio > 2.0f) pitch_ratio = 2.0f;
+    ps->ratio = pitch_ratio;
+}
+
+float psola_get_ratio(const Psola* ps) {
+    return ps->ratio;
+}
+
+void psola_set_pitch(Psola* ps, float pitch) {
+    float period = pitch > 0.0f ? (float)YIN_SAMPLING_RATE / pitch : 0.0f;
+    ps->period = period >= 2.0f && period <= ps->max_period ? period : 0.0f;
+}
+
+int psola_latency(const Psola* ps) {
+    return ps->latency;
+}
+
+int psola_process_q15(Psola* ps, const int16_t* in, int n, int16_t* out) {
+    int written = 0;
+    for (int done = 0; done < n; ) {
+        int m = n - done < PSOLA_TRACK_HOP ? n - done : PSOLA_TRACK_HOP;
+        psola_push(ps, in ? in + done : NULL, m);
+        done += m;
+        written += psola_emit(ps, out + written, ps->in_total);
+    }
+    return written;
+}
+
+int psola_flush_q15(Psola* ps, int16_t* out) {
+    if (ps->in_total == 0) {
+        return 0;
+    }
+    // Everything pushed, plus the latency, comes out; silence pushes the last grains through
+    const int64_t end = ps->in_total + ps->latency;
+    int written = psola_emit(ps, out, end);
+    ps->period = 0.0f;
+    ps->flushing = 1;           // No estimates on the silence
+    for (int guard = 0; ps->delivered < end && guard < 4 * ps->latency / PSOLA_TRACK_HOP + 4; guard++) {
+        psola_push(ps, NULL, PSOLA_TRACK_HOP);
+        written += psola_emit(ps, out + written, end);
+    }
+    ps->flushing = 0;
+    psola_reset(ps);
+    return written;
+}
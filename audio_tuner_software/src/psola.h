@@ -0,0 +1,100 @@
+#ifndef PSOLA_H
+#define PSOLA_H
+
+#include <stdint.h>
+
+// Streaming time-domain PSOLA pitch shifter: the low-cost alternative to the
+// phase vocoder for monophonic voice.
+//
+// Analysis marks are placed one pitch period apart (each snapped to the peak
+// within a quarter period of where it is expected) and synthesis marks
+// period / ratio apart on the same time line, so the duration is kept. Each
+// synthesis mark takes a Hann grain of two periods from the nearest analysis
+// mark. Unvoiced input is copied through in fixed grains at ratio 1. A
+// sample costs a few multiply-adds; there is no FFT.
+//
+// The period comes from Yin. Either the context runs its own Yin over the
+// newest 2 * max_period samples every PSOLA_TRACK_HOP samples, or (track = 0)
+// the caller passes in the pitch from a tracker it already runs, as the live
+// path does.
+//
+// Everything is allocated in psola_create (arena_malloc) and sized from
+// max_period; nothing is allocated while processing.
+
+#define PSOLA_DEFAULT_MAX_PERIOD    512     // 94 Hz at 48 kHz (the Yin tracker's lag range)
+#define PSOLA_TRACK_HOP             256     // Samples between internal pitch estimates
+#define PSOLA_MIN_PROBABILITY       0.5f    // Internal estimates below this count as unvoiced
+
+// Output room psola_flush_q15 needs (the latency, 3 * max_period)
+#define PSOLA_FLUSH_ROOM(max_period) (3 * (max_period))
+
+typedef struct Psola Psola;
+
+/**
+ * Create a PSOLA context
+ * @param max_period  Longest period followed, in samples (64 .. 2048)
+ * @param pitch_ratio Pitch shift ratio, clamped to 0.5 .. 2.0
+ * @param track       1 to estimate the pitch internally, 0 if the caller sets it
+ * @return            New context (free with psola_destroy), or NULL on error
+ */
+Psola* psola_create(int max_period, float pitch_ratio, int track);
+
+/**
+ * Free a context
+ * @param ps          Context from psola_create (NULL is ignored)
+ */
+void psola_destroy(Psola* ps);
+
+/**
+ * Clear all history so the next sample starts a new stream
+ * @param ps          Context from psola_create
+ */
+void psola_reset(Psola* ps);
+
+/**
+ * Change the pitch ratio; takes effect from the next grain, O(1)
+ * @param ps          Context from psola_create
+ * @param pitch_ratio New ratio, clamped to 0.5 .. 2.0
+ */
+void psola_set_ratio(Psola* ps, float pitch_ratio);
+
+/**
+ * @param ps          Context from psola_create
+ * @return            Ratio in use (after clamping)
+ */
+float psola_get_ratio(const Psola* ps);
+
+/**
+ * Set the pitch of the newest input (track = 0 contexts)
+ * @param ps          Context from psola_create
+ * @param pitch       Pitch in Hz; <= 0, or a period longer than max_period, means unvoiced
+ */
+void psola_set_pitch(Psola* ps, float pitch);
+
+/**
+ * Delay between input and output in samples. Output sample i + psola_latency()
+ * corresponds to input sample i.
+ * @param ps          Context from psola_create
+ * @return            Latency in samples (3 * max_period)
+ */
+int psola_latency(const Psola* ps);
+
+/**
+ * Push Q15 input and collect the shifted output produced so far
+ * @param ps          Context from psola_create
+ * @param in          n input samples (NULL feeds silence)
+ * @param n           Number of input samples
+ * @param out         Output buffer with room for n samples
+ * @return            Number of samples written to out (n once the stream is running)
+ */
+int psola_process_q15(Psola* ps, const int16_t* in, int n, int16_t* out);
+
+/**
+ * Drain the delay line with silence and reset the context for a new stream
+ * @param ps          Context from psola_create
+ * @param out         Output buffer with room for PSOLA_FLUSH_ROOM(max_period) samples
+ * @return            Number of samples written to out (0 if nothing was pushed since the last reset)
+ */
+int psola_flush_q15(Psola* ps, int16_t* out);
+
+#endif // PSOLA_H
@@ -0,0 +1,502 @@
+#include <math.h>
+#include <string.h>
+#include "pv_kernels.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define PVK_PI        3.14159265f
+#define PVK_HALF_PI   1.57079633f
+#define PVK_TWO_PI    6.28318531f
+#define PVK_INV_2PI   0.159154943f
+#define PVK_2_OVER_PI 0.636619772f
+
+// Minimax atan(a) on [0, 1], odd polynomial a * P(a^2)
+#define ATAN_C1  0.99997726f
+#define ATAN_C3 -0.33262347f
+#define ATAN_C5  0.19354346f
+#define ATAN_C7 -0.11643287f
+#define ATAN_C9  0.05265332f
+#define ATAN_C11 -0.01172120f
+
+// Taylor sin/cos on [-pi/4, pi/4]
+#define SIN_C3 -1.66666667e-1f
+#define SIN_C5  8.33333333e-3f
+#define SIN_C7 -1.98412698e-4f
+#define COS_C2 -5.0e-1f
+#define COS_C4  4.16666667e-2f
+#define COS_C6 -1.38888889e-3f
+#define COS_C8  2.48015873e-5f
+
+static int pvk_fast_math = PV_FAST_MATH;
+
+void pvk_set_fast_math(int enable) {
+    pvk_fast_math = enable ? 1 : 0;
+}
+
+int pvk_get_fast_math(void) {
+    return pvk_fast_math;
+}
+
+// Scalar versions (host fallback and loop tails)
+
+float pvk_atan2f(float y, float x) {
+    float ax = fabsf(x);
+    float ay = fabsf(y);
+    float mx = ax > ay ? ax : ay;
+    float mn = ax > ay ? ay : ax;
+    if (mx == 0.0f) return 0.0f;
+
+    float a = mn / mx;
+    float s = a * a;
+    float r = a * (ATAN_C1 + s * (ATAN_C3 + s * (ATAN_C5 + s * (ATAN_C7 + s * (ATAN_C9 + s * ATAN_C11)))));
+
+    if (ay > ax) r = PVK_HALF_PI - r;
+    if (x < 0.0f) r = PVK_PI - r;
+    return y < 0.0f ? -r : r;
+}
+
+void pvk_sincosf(float x, float* s, float* c) {
+    // Reduce to r in [-pi/4, pi/4] and quadrant q
+    float qf = rintf(x * PVK_2_OVER_PI);
+    int q = (int)qf;
+    float r = x - qf * PVK_HALF_PI;
+    float r2 = r * r;
+
+    float sr = r + r * r2 * (SIN_C3 + r2 * (SIN_C5 + r2 * SIN_C7));
+    float cr = 1.0f + r2 * (COS_C2 + r2 * (COS_C4 + r2 * (COS_C6 + r2 * COS_C8)));
+
+    float so = (q & 1) ? cr : sr;
+    float co = (q & 1) ? sr : cr;
+    *s = (q & 2) ? -so : so;
+    *c = ((q + 1) & 2) ? -co : co;
+}
+
+static inline float pvk_wrap(float x) {
+    return x - PVK_TWO_PI * rintf(x * PVK_INV_2PI);
+}
+
+#if defined(__ARM_NEON)
+
+static inline float32x4_t pvk_wrap_v(float32x4_t x) {
+    float32x4_t k = vrndnq_f32(vmulq_n_f32(x, PVK_INV_2PI));
+    return vmlsq_n_f32(x, k, PVK_TWO_PI);
+}
+
+static inline float32x4_t pvk_atan2_v(float32x4_t y, float32x4_t x) {
+    float32x4_t ax = vabsq_f32(x);
+    float32x4_t ay = vabsq_f32(y);
+    float32x4_t mx = vmaxq_f32(ax, ay);
+    float32x4_t mn = vminq_f32(ax, ay);
+
+    // (0, 0) gives 0/0; force the ratio to 0 so the result is 0
+    uint32x4_t zero = vceqq_f32(mx, vdupq_n_f32(0.0f));
+    float32x4_t a = vdivq_f32(mn, vbslq_f32(zero, vdupq_n_f32(1.0f), mx));
+    float32x4_t s = vmulq_f32(a, a);
+
+    float32x4_t p = vdupq_n_f32(ATAN_C11);
+    p = vfmaq_f32(vdupq_n_f32(ATAN_C9), p, s);
+    p = vfmaq_f32(vdupq_n_f32(ATAN_C7), p, s);
+    p = vfmaq_f32(vdupq_n_f32(ATAN_C5), p, s);
+    p = vfmaq_f32(vdupq_n_f32(ATAN_C3), p, s);
+    p = vfmaq_f32(vdupq_n_f32(ATAN_C1), p, s);
+    float32x4_t r = vmulq_f32(a, p);
+
+    r = vbslq_f32(vcgtq_f32(ay, ax), vsubq_f32(vdupq_n_f32(PVK_HALF_PI), r), r);
+    r = vbslq_f32(vcltq_f32(x, vdupq_n_f32(0.0f)), vsubq_f32(vdupq_n_f32(PVK_PI), r), r);
+    return vbslq_f32(vcltq_f32(y, vdupq_n_f32(0.0f)), vnegq_f32(r), r);
+}
+
+static inline void pvk_sincos_v(float32x4_t x, float32x4_t* s, float32x4_t* c) {
+    float32x4_t qf = vrndnq_f32(vmulq_n_f32(x, PVK_2_OVER_PI));
+    int32x4_t q = vcvtq_s32_f32(qf);
+    float32x4_t r = vmlsq_n_f32(x, qf, PVK_HALF_PI);
+    float32x4_t r2 = vmulq_f32(r, r);
+
+    float32x4_t ps = vdupq_n_f32(SIN_C7);
+    ps = vfmaq_f32(vdupq_n_f32(SIN_C5), ps, r2);
+    ps = vfmaq_f32(vdupq_n_f32(SIN_C3), ps, r2);
+    float32x4_t sr = vfmaq_f32(r, vmulq_f32(r, r2), ps);
+
+    float32x4_t pc = vdupq_n_f32(COS_C8);
+    pc = vfmaq_f32(vdupq_n_f32(COS_C6), pc, r2);
+    pc = vfmaq_f32(vdupq_n_f32(COS_C4), pc, r2);
+    pc = vfmaq_f32(vdupq_n_f32(COS_C2), pc, r2);
+    float32x4_t cr = vfmaq_f32(vdupq_n_f32(1.0f), pc, r2);
+
+    // Odd quadrants swap sin and cos; sign bits come from bit 1 of q and q+1
+    uint32x4_t swap = vtstq_s32(q, vdupq_n_s32(1));
+    float32x4_t so = vbslq_f32(swap, cr, sr);
+    float32x4_t co = vbslq_f32(swap, sr, cr);
+
+    uint32x4_t sneg = vshlq_n_u32(vandq_u32(vreinterpretq_u32_s32(q), vdupq_n_u32(2)), 30);
+    uint32x4_t cneg = vshlq_n_u32(vandq_u32(vreinterpretq_u32_s32(vaddq_s32(q, vdupq_n_s32(1))),
+                                            vdupq_n_u32(2)), 30);
+    *s = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(so), sneg));
+    *c = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(co), cneg));
+}
+
+#endif // __ARM_NEON
+
+void pvk_window(const float* in, const float* win, float* out, int n) {
+    int i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(out + i, vmulq_f32(vld1q_f32(in + i), vld1q_f32(win + i)));
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = in[i] * win[i];
+    }
+}
+
+void pvk_mag_phase(const float* re, const float* im, float* mag, float* ph, int n) {
+    if (!pvk_fast_math) {
+        for (int i = 0; i < n; i++) {
+            mag[i] = sqrtf(re[i] * re[i] + im[i] * im[i]);
+            ph[i] = atan2f(im[i], re[i]);
+        }
+        return;
+    }
+
+    int i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t r = vld1q_f32(re + i), m = vld1q_f32(im + i);
+        vst1q_f32(mag + i, vsqrtq_f32(vfmaq_f32(vmulq_f32(r, r), m, m)));
+        vst1q_f32(ph + i, pvk_atan2_v(m, r));
+    }
+#endif
+    for (; i < n; i++) {
+        mag[i] = sqrtf(re[i] * re[i] + im[i] * im[i]);
+        ph[i] = pvk_atan2f(im[i], re[i]);
+    }
+}
+
+void pvk_magnitude(const float* re, const float* im, float* mag, int n) {
+    int i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t r = vld1q_f32(re + i), m = vld1q_f32(im + i);
+        vst1q_f32(mag + i, vsqrtq_f32(vfmaq_f32(vmulq_f32(r, r), m, m)));
+    }
+#endif
+    for (; i < n; i++) {
+        mag[i] = sqrtf(re[i] * re[i] + im[i] * im[i]);
+    }
+}
+
+void pvk_phase_advance(const float* ph, float* last_phase, float* sum_phase, int n,
+                       int fft_size, int analysis_hop, int synthesis_hop) {
+    // true_freq = bin_freq + wrap(dphi - expected) / ha, accumulated over hs:
+    //   sum += hs * bin_freq + wrap(dphi - expected) * hs / ha
+    const float bin_step = 2.0f * (float)M_PI / fft_size;
+    const float expected_step = bin_step * analysis_hop;
+    const float stretch = (float)synthesis_hop / analysis_hop;
+    const float advance_step = bin_step * synthesis_hop;
+
+    int i = 0;
+#if defined(__ARM_NEON)
+    const float lane[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    float32x4_t bin = vld1q_f32(lane);
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t p = vld1q_f32(ph + i);
+        float32x4_t dev = vsubq_f32(p, vld1q_f32(last_phase + i));
+        vst1q_f32(last_phase + i, p);
+
+        dev = pvk_wrap_v(vmlsq_n_f32(dev, bin, expected_step));
+        float32x4_t sum = vld1q_f32(sum_phase + i);
+        sum = vmlaq_n_f32(sum, bin, advance_step);
+        sum = vmlaq_n_f32(sum, dev, stretch);
+        vst1q_f32(sum_phase + i, pvk_wrap_v(sum));
+
+        bin = vaddq_f32(bin, vdupq_n_f32(4.0f));
+    }
+#endif
+    for (; i < n; i++) {
+        float dev = ph[i] - last_phase[i];
+        last_phase[i] = ph[i];
+
+        dev = pvk_wrap(dev - expected_step * i);
+        float sum = sum_phase[i] + advance_step * i + dev * stretch;
+        sum_phase[i] = pvk_wrap(sum);
+    }
+}
+
+void pvk_bin_freq(const float* ph, float* last_phase, float* freq, int n, int fft_size, int hop) {
+    // freq[k] = bin_freq + wrap(dphi - expected) / hop, in radians per sample
+    const float bin_step = 2.0f * (float)M_PI / fft_size;
+    const float expected_step = bin_step * hop;
+    const float dev_scale = 1.0f / hop;
+
+    int i = 0;
+#if defined(__ARM_NEON)
+    const float lane[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    float32x4_t bin = vld1q_f32(lane);
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t p = vld1q_f32(ph + i);
+        float32x4_t dev = vsubq_f32(p, vld1q_f32(last_phase + i));
+        vst1q_f32(last_phase + i, p);
+        dev = pvk_wrap_v(vmlsq_n_f32(dev, bin, expected_step));
+        float32x4_t f = vmulq_n_f32(bin, bin_step);
+        vst1q_f32(freq + i, vmlaq_n_f32(f, dev, dev_scale));
+        bin = vaddq_f32(bin, vdupq_n_f32(4.0f));
+    }
+#endif
+    for (; i < n; i++) {
+        float dev = pvk_wrap(ph[i] - last_phase[i] - expected_step * i);
+        last_phase[i] = ph[i];
+        freq[i] = bin_step * i + dev * dev_scale;
+    }
+}
+
+void pvk_phase_integrate(const float* freq, float* sum_phase, int n, int synthesis_hop) {
+    const float hs = (float)synthesis_hop;
+    int i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t sum = vmlaq_n_f32(vld1q_f32(sum_phase + i), vld1q_f32(freq + i), hs);
+        vst1q_f32(sum_phase + i, pvk_wrap_v(sum));
+    }
+#endif
+    for (; i < n; i++) {
+        sum_phase[i] = pvk_wrap(sum_phase[i] + freq[i] * hs);
+    }
+}
+
+// Next magnitude peak at or after k (larger than two bins either side, as
+// pvk_phase_lock finds them), n if there is none
+static int pvk_next_peak(const float* mag, int k, int n) {
+    for (; k < n; k++) {
+        float m = mag[k];
+        if ((k < 1 || m > mag[k - 1]) && (k < 2 || m > mag[k - 2]) &&
+            (k + 1 >= n || m >= mag[k + 1]) && (k + 2 >= n || m >= mag[k + 2]) && m > 0.0f) {
+            return k;
+        }
+    }
+    return n;
+}
+
+void pvk_bin_scatter(const float* mag, const float* ph, const float* freq, float* sum_phase, float* out_mag,
+                     int n, int fft_size, int hop, float ratio) {
+    const float bin_step = 2.0f * (float)M_PI / fft_size;
+    const float advance = ratio * hop;      // A moved peak's phase step per unit of its frequency
+
+    // Each peak's region moves by one whole-bin offset, so the lobe keeps its
+    // shape. Regions go out in order, each clipped to the targets between the
+    // midpoints to its neighbours' targets, so no target is written twice and
+    // a peak's last synthesis phase is still there when its region is placed.
+    memset(out_mag, 0, n * sizeof(float));
+    int j_next = 0;                         // Targets below this are done
+    int lo = 0;
+    int p = pvk_next_peak(mag, 0, n);
+    while (p < n) {
+        const int q = (int)(p * ratio + 0.5f);
+        if (q >= n) break;
+
+        // The next peak landing elsewhere ends the region at the lowest bin between them
+        int p_next = pvk_next_peak(mag, p + 1, n);
+        while (p_next < n && (int)(p_next * ratio + 0.5f) == q) {
+            p_next = pvk_next_peak(mag, p_next + 1, n);
+        }
+        int hi = n;
+        int j_last = n - 1;
+        if (p_next < n) {
+            hi = p + 1;
+            for (int k = p + 2; k <= p_next; k++) {
+                if (mag[k] < mag[hi]) hi = k;
+            }
+            const int q_next = (int)(p_next * ratio + 0.5f);
+            if (q_next < n) j_last = (q + q_next) / 2;
+        }
+
+        // The peak advances at its scaled frequency; the rest of the region keeps its phase offset to it
+        const float syn = pvk_wrap(sum_phase[q] + freq[p] * advance);
+        const int shift = q - p;
+        int k = lo;
+        if (k + shift < j_next) k = j_next - shift;
+        for (; k < hi && k + shift <= j_last; k++) {
+            const int j = k + shift;
+            // Targets no region reaches advance at their centre frequency
+            for (; j_next < j; j_next++) {
+                sum_phase[j_next] = pvk_wrap(sum_phase[j_next] + bin_step * j_next * hop);
+            }
+            out_mag[j] = mag[k];
+            sum_phase[j] = k == p ? syn : pvk_wrap(syn + ph[k] - ph[p]);
+            j_next = j + 1;
+        }
+        lo = hi;
+        p = p_next;
+    }
+    for (; j_next < n; j_next++) {
+        sum_phase[j_next] = pvk_wrap(sum_phase[j_next] + bin_step * j_next * hop);
+    }
+}
+
+void pvk_bin_shift(const float* mag, const float* ph, float* last_phase, float* sum_phase, float* freq,
+                   float* out_mag, int n, int fft_size, int hop, float ratio) {
+    pvk_bin_freq(ph, last_phase, freq, n, fft_size, hop);
+    pvk_bin_scatter(mag, ph, freq, sum_phase, out_mag, n, fft_size, hop, ratio);
+}
+
+// bins [lo, hi) *= (c + i s)
+static void pvk_rotate(float* re, float* im, int lo, int hi, float c, float s) {
+    int i = lo;
+#if defined(__ARM_NEON)
+    for (; i + 4 <= hi; i += 4) {
+        float32x4_t r = vld1q_f32(re + i), m = vld1q_f32(im + i);
+        vst1q_f32(re + i, vmlsq_n_f32(vmulq_n_f32(r, c), m, s));
+        vst1q_f32(im + i, vmlaq_n_f32(vmulq_n_f32(m, c), r, s));
+    }
+#endif
+    for (; i < hi; i++) {
+        float r = re[i], m = im[i];
+        re[i] = r * c - m * s;
+        im[i] = m * c + r * s;
+    }
+}
+
+int pvk_phase_lock(SpectralFrame* spec, PvkLockState* st, int fft_size, int analysis_hop, int synthesis_hop) {
+    float* re = spec->re;
+    float* im = spec->im;
+    const float* mag = spec->mag;
+    const int n = spec->bins;
+    int* peaks = st->peaks;
+    const float bin_step = 2.0f * (float)M_PI / fft_size;
+    const float expected_step = bin_step * analysis_hop;
+    const float stretch = (float)synthesis_hop / analysis_hop;
+    const float advance_step = bin_step * synthesis_hop;
+
+    int count = 0;
+    for (int k = 0; k < n; k++) {
+        float m = mag[k];
+        if ((k < 1 || m > mag[k - 1]) && (k < 2 || m > mag[k - 2]) &&
+            (k + 1 >= n || m >= mag[k + 1]) && (k + 2 >= n || m >= mag[k + 2]) && m > 0.0f) {
+            peaks[count++] = k;
+        }
+    }
+
+    int lo = 0;
+    for (int j = 0; j < count; j++) {
+        const int p = peaks[j];
+        const float xr = re[p], xi = im[p];
+        const float pr = st->prev_re[p], pi = st->prev_im[p];
+        const float yr = st->out_re[p], yi = st->out_im[p];
+
+        // Phase change since the last frame, and where the peak's synthesis phase was
+        float dre = xr * pr + xi * pi;
+        float dim = xi * pr - xr * pi;
+        float dphi = pvk_fast_math ? pvk_atan2f(dim, dre) : atan2f(dim, dre);
+        float last = pvk_fast_math ? pvk_atan2f(yi, yr) : atan2f(yi, yr);
+        float syn = pvk_wrap(last + advance_step * p + pvk_wrap(dphi - expected_step * p) * stretch);
+
+        // Rotor e^(i syn) * conj(x) / |x| takes the peak from its analysis to its synthesis phase
+        float s, c;
+        if (pvk_fast_math) {
+            pvk_sincosf(syn, &s, &c);
+        } else {
+            s = sinf(syn);
+            c = cosf(syn);
+        }
+        const float inv = 1.0f / mag[p];
+        const float ur = xr * inv, ui = -xi * inv;
+        const float rc = c * ur - s * ui;
+        const float rs = s * ur + c * ui;
+
+        // Region of influence: up to the lowest bin before the next peak
+        int hi = n;
+        if (j + 1 < count) {
+            hi = p + 1;
+            for (int k = p + 2; k <= peaks[j + 1]; k++) {
+                if (mag[k] < mag[hi]) hi = k;
+            }
+        }
+        // The unrotated bins are the next frame's reference
+        memcpy(st->prev_re + lo, re + lo, (hi - lo) * sizeof(float));
+        memcpy(st->prev_im + lo, im + lo, (hi - lo) * sizeof(float));
+        pvk_rotate(re, im, lo, hi, rc, rs);
+        lo = hi;
+    }
+
+    // No peaks (silence): the frame goes out as it came in
+    if (count == 0) {
+        memcpy(st->prev_re, re, n * sizeof(float));
+        memcpy(st->prev_im, im, n * sizeof(float));
+    }
+    memcpy(st->out_re, re, n * sizeof(float));
+    memcpy(st->out_im, im, n * sizeof(float));
+    return count;
+}
+
+void pvk_polar_to_rect(const float* mag, const float* ph, float* re, float* im, int n) {
+    if (!pvk_fast_math) {
+        for (int i = 0; i < n; i++) {
+            re[i] = mag[i] * cosf(ph[i]);
+            im[i] = mag[i] * sinf(ph[i]);
+        }
+        return;
+    }
+
+    int i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t m = vld1q_f32(mag + i);
+        float32x4_t s, c;
+        pvk_sincos_v(vld1q_f32(ph + i), &s, &c);
+        vst1q_f32(re + i, vmulq_f32(m, c));
+        vst1q_f32(im + i, vmulq_f32(m, s));
+    }
+#endif
+    for (; i < n; i++) {
+        float s, c;
+        pvk_sincosf(ph[i], &s, &c);
+        re[i] = mag[i] * c;
+        im[i] = mag[i] * s;
+    }
+}
+
+void pvk_polar_accumulate(const float* mag, const float* ph, float gain, float* re, float* im, int n) {
+    if (!pvk_fast_math) {
+        for (int i = 0; i < n; i++) {
+            re[i] += gain * mag[i] * cosf(ph[i]);
+            im[i] += gain * mag[i] * sinf(ph[i]);
+        }
+        return;
+    }
+
+    int i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t m = vmulq_n_f32(vld1q_f32(mag + i), gain);
+        float32x4_t s, c;
+        pvk_sincos_v(vld1q_f32(ph + i), &s, &c);
+        vst1q_f32(re + i, vfmaq_f32(vld1q_f32(re + i), m, c));
+        vst1q_f32(im + i, vfmaq_f32(vld1q_f32(im + i), m, s));
+    }
+#endif
+    for (; i < n; i++) {
+        float s, c;
+        pvk_sincosf(ph[i], &s, &c);
+        re[i] += gain * mag[i] * c;
+        im[i] += gain * mag[i] * s;
+    }
+}
+
+void pvk_overlap_add(float* dst, const float* frame, const float* win, int n) {
+    int i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t d = vld1q_f32(dst + i);
+        d = vfmaq_f32(d, vld1q_f32(frame + i), vld1q_f32(win + i));
+        vst1q_f32(dst + i, d);
+    }
+#endif
+    for (; i < n; i++) {
+        dst[i] += frame[i] * win[i];
+    }
+}
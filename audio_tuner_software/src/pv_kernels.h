@@ -0,0 +1,217 @@
+#ifndef PV_KERNELS_H
+#define PV_KERNELS_H
+
+#include "fft.h"
+
+// Per-bin and per-sample loops of the phase vocoder frame. Spectra are split
+// re/im planes (SpectralFrame in fft.h), so every loop uses plain loads.
+// On the A53 (__ARM_NEON) each kernel processes 4 floats per iteration;
+// elsewhere (host builds) a scalar loop with the same approximations is used,
+// so both builds produce the same output to within float rounding.
+//
+// Approximation error over the full input range:
+//   pvk_atan2f    < 2e-6 rad
+//   pvk_sincosf   < 2e-6 absolute for |x| < 20
+//
+// The approximations are used when fast-math is on (the default). With it
+// off, magnitude/phase and polar-to-rectangular fall back to libm atan2f,
+// sinf and cosf so the quality/speed trade-off can be measured on real takes.
+// Build with -DPV_FAST_MATH=0 to start in precise mode.
+
+#ifndef PV_FAST_MATH
+#define PV_FAST_MATH 1
+#endif
+
+/**
+ * Select polynomial (fast) or libm (precise) trig in the spectral kernels
+ * @param enable     Non-zero for fast-math, 0 for the precise path
+ */
+void pvk_set_fast_math(int enable);
+
+/**
+ * @return           Non-zero when fast-math is selected
+ */
+int pvk_get_fast_math(void);
+
+/**
+ * Polynomial atan2 approximation (scalar form of the vector kernel)
+ * @param y          Imaginary part
+ * @param x          Real part
+ * @return           Angle in [-pi, pi]; 0 for (0, 0)
+ */
+float pvk_atan2f(float y, float x);
+
+/**
+ * Polynomial sine/cosine approximation (scalar form of the vector kernel)
+ * @param x          Angle in radians (any range, best accuracy within a few turns of 0)
+ * @param s          Receives sin(x)
+ * @param c          Receives cos(x)
+ */
+void pvk_sincosf(float x, float* s, float* c);
+
+/**
+ * out[i] = in[i] * win[i]
+ * @param in         Input samples
+ * @param win        Window coefficients
+ * @param out        Output samples (may alias in)
+ * @param n          Number of samples
+ */
+void pvk_window(const float* in, const float* win, float* out, int n);
+
+/**
+ * Complex bins to magnitude and phase
+ * @param re         Real parts
+ * @param im         Imaginary parts
+ * @param mag        Receives |bin i|
+ * @param ph         Receives arg(bin i) in [-pi, pi]
+ * @param n          Number of bins
+ */
+void pvk_mag_phase(const float* re, const float* im, float* mag, float* ph, int n);
+
+/**
+ * Magnitude only (the phase-locked path takes phases at the peaks itself)
+ * @param re         Real parts
+ * @param im         Imaginary parts
+ * @param mag        Receives |bin i|
+ * @param n          Number of bins
+ */
+void pvk_magnitude(const float* re, const float* im, float* mag, int n);
+
+/**
+ * Phase vocoder phase advance: estimate each bin's true frequency from the
+ * phase change since the previous frame and accumulate it over the synthesis hop
+ * @param ph            Current analysis phase per bin
+ * @param last_phase    Previous analysis phase per bin (updated to ph)
+ * @param sum_phase     Synthesis phase accumulator per bin (updated, kept in [-pi, pi])
+ * @param n             Number of bins
+ * @param fft_size      Transform length the bins came from
+ * @param analysis_hop  Input hop in samples
+ * @param synthesis_hop Output hop in samples
+ */
+void pvk_phase_advance(const float* ph, float* last_phase, float* sum_phase, int n,
+                       int fft_size, int analysis_hop, int synthesis_hop);
+
+/**
+ * Pitch shift in the spectral domain (no time-stretch), Laroche-Dolson
+ * style: estimate each bin's true frequency from its phase change over the
+ * hop, then move every magnitude peak's region of influence (as
+ * pvk_phase_lock finds them) as a whole, by the offset that takes the peak
+ * to the bin nearest peak * ratio. The peak's synthesis phase advances at
+ * its frequency scaled by ratio; the other bins of the region keep their
+ * analysis phase offset to the peak, so each partial keeps its lobe and its
+ * level. Where shifted regions overlap (ratio < 1) they meet halfway
+ * between their peaks; targets past Nyquist are dropped, targets between
+ * regions are silent. The cost does not depend on the ratio.
+ * @param mag           Analysis magnitude per bin
+ * @param ph            Analysis phase per bin
+ * @param last_phase    Previous analysis phase per bin (updated to ph)
+ * @param sum_phase     Synthesis phase per target bin (updated, kept in [-pi, pi])
+ * @param freq          Scratch for n floats
+ * @param out_mag       Receives the shifted magnitude per bin
+ * @param n             Number of bins
+ * @param fft_size      Transform length the bins came from
+ * @param hop           Analysis and synthesis hop in samples
+ * @param ratio         Pitch ratio
+ */
+void pvk_bin_shift(const float* mag, const float* ph, float* last_phase, float* sum_phase, float* freq,
+                   float* out_mag, int n, int fft_size, int hop, float ratio);
+
+/**
+ * First half of pvk_bin_shift: each bin's true frequency from its phase
+ * change over the hop. It does not depend on the ratio, so several voices
+ * shifted from one frame share it.
+ * @param ph            Analysis phase per bin
+ * @param last_phase    Previous analysis phase per bin (updated to ph)
+ * @param freq          Receives the frequency per bin, radians per sample
+ * @param n             Number of bins
+ * @param fft_size      Transform length the bins came from
+ * @param hop           Analysis hop in samples
+ */
+void pvk_bin_freq(const float* ph, float* last_phase, float* freq, int n, int fft_size, int hop);
+
+/**
+ * pvk_phase_advance from frequencies already estimated: advance each bin's
+ * synthesis phase by its frequency over the synthesis hop
+ * @param freq          Frequency per bin from pvk_bin_freq (radians per sample)
+ * @param sum_phase     Synthesis phase accumulator per bin (updated, kept in [-pi, pi])
+ * @param n             Number of bins
+ * @param synthesis_hop Output hop in samples
+ */
+void pvk_phase_integrate(const float* freq, float* sum_phase, int n, int synthesis_hop);
+
+/**
+ * Second half of pvk_bin_shift: move each peak's region to peak * ratio and
+ * set the targets' synthesis phases
+ * @param mag           Analysis magnitude per bin
+ * @param ph            Analysis phase per bin
+ * @param freq          Frequency per bin from pvk_bin_freq
+ * @param sum_phase     Synthesis phase per target bin (updated, kept in [-pi, pi])
+ * @param out_mag       Receives the shifted magnitude per bin
+ * @param n             Number of bins
+ * @param fft_size      Transform length the bins came from
+ * @param hop           Analysis and synthesis hop in samples
+ * @param ratio         Pitch ratio
+ */
+void pvk_bin_scatter(const float* mag, const float* ph, const float* freq, float* sum_phase, float* out_mag,
+                     int n, int fft_size, int hop, float ratio);
+
+// Identity phase locking state: the previous frame's analysis and synthesis
+// bins as split planes, and scratch for the peak list
+typedef struct {
+    float* prev_re;             // Previous analysis bins
+    float* prev_im;
+    float* out_re;              // Previous synthesis bins
+    float* out_im;
+    int* peaks;                 // n / 2 + 1 bin indices
+} PvkLockState;
+
+/**
+ * Identity phase locking (Laroche-Dolson): find the magnitude peaks (larger
+ * than two bins either side), advance only the peaks' phases from their
+ * instantaneous frequency, and rotate every bin of a peak's region of
+ * influence (up to the lowest bin between it and the next peak) by the same
+ * angle as the peak, so the phase relations around each partial are kept.
+ * Two atan2 and one sin/cos per peak; the other bins cost a complex multiply.
+ * Frame 0 (zeroed state) starts like pvk_phase_advance does from zeroed
+ * phase arrays.
+ * @param spec          Analysis bins in re/im (synthesis bins out) and their magnitudes in mag
+ * @param st            Previous frame's bins (updated) and peak scratch, spec->bins long
+ * @param fft_size      Transform length the bins came from
+ * @param analysis_hop  Input hop in samples
+ * @param synthesis_hop Output hop in samples
+ * @return              Peaks found
+ */
+int pvk_phase_lock(SpectralFrame* spec, PvkLockState* st, int fft_size, int analysis_hop, int synthesis_hop);
+
+/**
+ * Rebuild complex bins from magnitude and phase
+ * @param mag        Magnitude per bin
+ * @param ph         Phase per bin
+ * @param re         Receives mag[i] * cos(ph[i])
+ * @param im         Receives mag[i] * sin(ph[i])
+ * @param n          Number of bins
+ */
+void pvk_polar_to_rect(const float* mag, const float* ph, float* re, float* im, int n);
+
+/**
+ * Add scaled bins from magnitude and phase to a spectrum (mixing voices
+ * before one inverse transform)
+ * @param mag        Magnitude per bin
+ * @param ph         Phase per bin
+ * @param gain       Scale applied to mag
+ * @param re         re[i] += gain * mag[i] * cos(ph[i])
+ * @param im         im[i] += gain * mag[i] * sin(ph[i])
+ * @param n          Number of bins
+ */
+void pvk_polar_accumulate(const float* mag, const float* ph, float gain, float* re, float* im, int n);
+
+/**
+ * Windowed overlap-add: dst[i] += frame[i] * win[i]
+ * @param dst        Accumulation buffer
+ * @param frame      Synthesised frame
+ * @param win        Synthesis window
+ * @param n          Number of samples
+ */
+void pvk_overlap_add(float* dst, const float* frame, const float* win, int n);
+
+#endif // PV_KERNELS_H
@@ -0,0 +1,196 @@
+#include "pv_mc.h"
+
+#if PV_MULTICORE
+
+#include <stddef.h>
+#include <stdlib.h>
+#include "xil_cache.h"
+#include "fft.h"
+#include "pv_kernels.h"
+
+#define PV_MC_SHARED ((PvMcShared*)PV_MC_SHARED_ADDR)
+#define PV_MC_ALL_SLOTS (PV_MC_LANES * PV_MC_SLOTS)
+
+// Spins before a worker is considered absent (probe) or stuck (wait)
+#define PV_MC_PROBE_SPINS   200000
+#define PV_MC_WAIT_SPINS    50000000
+
+static inline void pv_mc_flush(const volatile void* p, size_t len) {
+    Xil_DCacheFlushRange((INTPTR)p, len);
+}
+
+static inline void pv_mc_invalidate(const volatile void* p, size_t len) {
+    Xil_DCacheInvalidateRange((INTPTR)p, len);
+}
+
+/*** Core 0 side ***/
+
+static int mc_open[PV_MC_LANES];
+static int mc_workers = 0;              // Probed by the first lane opened
+static int mc_fft_size[PV_MC_LANES];
+static uint32_t mc_next_ticket = 0;
+static uint32_t mc_ticket[PV_MC_ALL_SLOTS];
+
+// Tickets must never match a done flag left in DDR by a previous run
+static void pv_mc_seed_tickets(PvMcShared* q) {
+    uint32_t top = 0;
+    pv_mc_invalidate(&q->ping, sizeof(q->ping));
+    if (q->ping.ticket > top) top = q->ping.ticket;
+    for (int s = 0; s < PV_MC_ALL_SLOTS; s++) {
+        pv_mc_invalidate(&q->slot[s].post, 2 * sizeof(PvMcFlag));
+        if (q->slot[s].post.ticket > top) top = q->slot[s].post.ticket;
+        if (q->slot[s].done.ticket > top) top = q->slot[s].done.ticket;
+    }
+    mc_next_ticket = top + 1;
+}
+
+static uint32_t pv_mc_new_ticket(void) {
+    uint32_t t = mc_next_ticket++;
+    if (mc_next_ticket == 0) mc_next_ticket = 1;
+    return t;
+}
+
+// Number of consecutive workers (from core 1 up) that echo a fresh nonce
+static int pv_mc_probe(PvMcShared* q) {
+    uint32_t nonce = pv_mc_new_ticket();
+    q->ping.ticket = nonce;
+    pv_mc_flush(&q->ping, sizeof(q->ping));
+
+    int online = 0;
+    for (int w = 0; w < PV_MC_MAX_WORKERS; w++) {
+        int spins = PV_MC_PROBE_SPINS;
+        do {
+            pv_mc_invalidate(&q->alive[w], sizeof(q->alive[w]));
+        } while (q->alive[w].ticket != nonce && --spins > 0);
+        if (spins == 0) break;
+        online++;
+    }
+    return online;
+}
+
+int pv_mc_open(int fft_size, int* lane) {
+    PvMcShared* q = PV_MC_SHARED;
+
+    int l = 0, busy = 0;
+    while (l < PV_MC_LANES && mc_open[l]) l++;
+    for (int i = 0; i < PV_MC_LANES; i++) busy += mc_open[i];
+    if (l == PV_MC_LANES || fft_size > PV_MC_MAX_FFT) {
+        return 0;
+    }
+    if (mc_next_ticket == 0) {
+        pv_mc_seed_tickets(q);
+    }
+
+    // Another lane has already found the workers
+    if (!busy) {
+        mc_workers = pv_mc_probe(q);
+    }
+    if (mc_workers == 0) {
+        return 0;
+    }
+
+    mc_open[l] = 1;
+    mc_fft_size[l] = fft_size;
+    *lane = l;
+    return mc_workers;
+}
+
+void pv_mc_close(int lane) {
+    mc_open[lane] = 0;
+}
+
+float* pv_mc_frame(int lane, int slot) {
+    return PV_MC_SHARED->slot[lane * PV_MC_SLOTS + slot].frame;
+}
+
+void pv_mc_post(int lane, int slot) {
+    const int i = lane * PV_MC_SLOTS + slot;
+    PvMcSlot* s = &PV_MC_SHARED->slot[i];
+
+    // Data first, then the flag that publishes it
+    pv_mc_flush(s->frame, mc_fft_size[lane] * sizeof(float));
+
+    mc_ticket[i] = pv_mc_new_ticket();
+    s->post.fft_size = mc_fft_size[lane];
+    s->post.fast_math = pvk_get_fast_math();
+    s->post.workers = mc_workers;
+    s->post.ticket = mc_ticket[i];
+    pv_mc_flush(&s->post, sizeof(s->post));
+}
+
+int pv_mc_wait(int lane, int slot, const float** mag, const float** ph) {
+    const int i = lane * PV_MC_SLOTS + slot;
+    PvMcSlot* s = &PV_MC_SHARED->slot[i];
+    const int bins = mc_fft_size[lane] / 2 + 1;
+
+    int spins = PV_MC_WAIT_SPINS;
+    do {
+        pv_mc_invalidate(&s->done, sizeof(s->done));
+    } while (s->done.ticket != mc_ticket[i] && --spins > 0);
+    if (spins == 0) {
+        return -1;
+    }
+
+    pv_mc_invalidate(s->magnitude, bins * sizeof(float));
+    pv_mc_invalidate(s->phase, bins * sizeof(float));
+    *mag = s->magnitude;
+    *ph = s->phase;
+    return 0;
+}
+
+/*** Worker side ***/
+
+void pv_mc_worker_main(int worker) {
+    PvMcShared* q = PV_MC_SHARED;
+    RealFFTPlan plan;
+    SpectralFrame spec;
+    void* spec_mem = NULL;
+    int plan_size = 0;
+
+    for (;;) {
+        // Echo the presence probe
+        pv_mc_invalidate(&q->ping, sizeof(q->ping));
+        if (q->alive[worker].ticket != q->ping.ticket) {
+            q->alive[worker].ticket = q->ping.ticket;
+            pv_mc_flush(&q->alive[worker], sizeof(q->alive[worker]));
+        }
+
+        for (int i = 0; i < PV_MC_ALL_SLOTS; i++) {
+            PvMcSlot* s = &q->slot[i];
+
+            pv_mc_invalidate(&s->post, sizeof(s->post));
+            uint32_t ticket = s->post.ticket;
+            if (ticket == 0 || ticket == s->done.ticket) continue;
+            if (s->post.workers < 1 || i % s->post.workers != worker) continue;
+
+            int fft_size = s->post.fft_size;
+            if (fft_size != plan_size) {
+                if (plan_size) rfft_plan_free(&plan);
+                free(spec_mem);
+                plan_size = 0;
+                spec_mem = NULL;
+                if (fft_size > PV_MC_MAX_FFT || rfft_plan_init(&plan, fft_size) != 0) {
+                    continue;   // Core 0 times out and analyses the frame itself
+                }
+                spec_mem = malloc(spectral_frame_bytes(fft_size / 2 + 1));
+                if (spectral_frame_init(&spec, fft_size / 2 + 1, spec_mem) != 0) {
+                    rfft_plan_free(&plan);
+                    continue;
+                }
+                plan_size = fft_size;
+            }
+
+            pv_mc_invalidate(s->frame, fft_size * sizeof(float));
+            pvk_set_fast_math(s->post.fast_math);
+            rfft_forward_split(&plan, s->frame, &spec);
+            pvk_mag_phase(spec.re, spec.im, s->magnitude, s->phase, fft_size / 2 + 1);
+
+            pv_mc_flush(s->magnitude, (fft_size / 2 + 1) * sizeof(float));
+            pv_mc_flush(s->phase, (fft_size / 2 + 1) * sizeof(float));
+            s->done.ticket = ticket;
+            pv_mc_flush(&s->done, sizeof(s->done));
+        }
+    }
+}
+
+#endif // PV_MULTICORE
@@ -0,0 +1,107 @@
+#ifndef PV_MC_H
+#define PV_MC_H
+
+#include <stdint.h>
+#include "phase_voc.h"
+
+// Frame-parallel vocoder analysis on the spare A53 cores (AMP).
+//
+// Core 0 runs the application. For every frame it posts the windowed input
+// to a slot of a queue in shared DDR. Worker applications on cores 1..3 call
+// pv_mc_worker_main(), which runs the forward FFT and magnitude/phase
+// extraction for the slots it owns and hands the results back. Core 0 keeps
+// the sequential part (phase integration, synthesis, overlap-add and
+// resampling) and retires the slots in frame order, PV_PIPELINE_DEPTH frames
+// behind the newest one.
+//
+// The queue has PV_MC_LANES lanes of PV_MC_SLOTS slots, one lane per
+// context (one per channel of a multichannel take), so the workers analyse
+// the frames of every open context side by side; a context that finds every
+// lane taken runs locally.
+//
+// Every handoff uses an explicit cache flush/invalidate and each cache line has
+// a single writer, so the queue works whether or not the region is mapped
+// inner-shareable on all cores. The worker apps must be linked clear of core
+// 0's image and of PV_MC_SHARED_ADDR .. PV_MC_SHARED_ADDR + sizeof(PvMcShared).
+//
+// Only built with -DPV_MULTICORE=1; without live workers core 0 does all the work.
+
+#ifndef PV_MC_SHARED_ADDR
+#define PV_MC_SHARED_ADDR   0x7FE00000UL    // Top of psu_ddr_0, unused by core 0's lscript
+#endif
+
+#define PV_MC_MAX_WORKERS   3               // Cores 1..3
+#define PV_MC_MAX_FFT       4096
+#define PV_MC_SLOTS         PV_PIPELINE_DEPTH   // Per lane
+#define PV_MC_LANES         2               // Contexts using the workers at once
+
+#define PV_MC_LINE __attribute__((aligned(64)))
+
+// One cache line per flag so each has a single writer
+typedef struct {
+    volatile uint32_t ticket;
+    int32_t fft_size;           // Post lines only: transform length of the frame
+    int32_t fast_math;          // Post lines only: pvk_set_fast_math() setting to use
+    int32_t workers;            // Post lines only: slot s belongs to worker s % workers
+} PV_MC_LINE PvMcFlag;
+
+typedef struct {
+    PvMcFlag post;                                      // Written by core 0
+    PvMcFlag done;                                      // Written by the owning worker
+    float frame[PV_MC_MAX_FFT] PV_MC_LINE;              // Windowed input (core 0)
+    float magnitude[PV_MC_MAX_FFT / 2 + 1] PV_MC_LINE;  // Results (worker)
+    float phase[PV_MC_MAX_FFT / 2 + 1] PV_MC_LINE;
+} PvMcSlot;
+
+typedef struct {
+    PvMcFlag ping;                          // Presence probe nonce (core 0)
+    PvMcFlag alive[PV_MC_MAX_WORKERS];      // Probe echo (one per worker)
+    PvMcSlot slot[PV_MC_LANES * PV_MC_SLOTS];  // Lane l owns slots l * PV_MC_SLOTS ..
+} PvMcShared;
+
+/**
+ * Core 0: claim a lane of the queue for one vocoder context and count the live workers
+ * @param fft_size   Transform length the context will post
+ * @param lane       Receives the lane claimed
+ * @return           Number of workers (0 = every lane busy, too large or no workers; run locally)
+ */
+int pv_mc_open(int fft_size, int* lane);
+
+/**
+ * Core 0: release a lane (all its posted slots must have been waited for)
+ * @param lane       Lane from pv_mc_open
+ */
+void pv_mc_close(int lane);
+
+/**
+ * Core 0: buffer the next frame of a slot is windowed into
+ * @param lane       Lane from pv_mc_open
+ * @param slot       Slot index in the lane (0 .. PV_MC_SLOTS-1)
+ * @return           fft_size floats in shared memory
+ */
+float* pv_mc_frame(int lane, int slot);
+
+/**
+ * Core 0: hand the frame in a slot to its worker
+ * @param lane       Lane from pv_mc_open
+ * @param slot       Slot whose frame has been filled
+ */
+void pv_mc_post(int lane, int slot);
+
+/**
+ * Core 0: wait for a posted slot's magnitude and phase
+ * @param lane       Lane from pv_mc_open
+ * @param slot       Posted slot
+ * @param mag        Receives the magnitude per bin
+ * @param ph         Receives the phase per bin
+ * @return           0 on success, -1 if the worker did not answer (compute locally)
+ */
+int pv_mc_wait(int lane, int slot, const float** mag, const float** ph);
+
+/**
+ * Worker cores: serve the queue forever
+ * @param worker     Worker index (core number - 1)
+ */
+void pv_mc_worker_main(int worker);
+
+#endif // PV_MC_H
@@ -0,0 +1,127 @@
+#include <math.h>
+#include "pv_pitch.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+void pv_pitch_default_config(PvPitchConfig* cfg) {
+    cfg->sample_rate = 48000.0f;
+    cfg->min_pitch = 60.0f;
+    cfg->max_pitch = 1000.0f;
+    cfg->floor = 0.01f;
+    cfg->min_level = 0.001f;
+}
+
+typedef struct {
+    float hz[PV_PITCH_PEAKS];
+    float mag[PV_PITCH_PEAKS];
+    int count;
+} PvPeaks;
+
+// Score a candidate fundamental against the peaks. Fills the share of the
+// counted magnitude it explains and its refined frequency.
+static float pv_pitch_score(const PvPeaks* p, float f0, float* confidence, float* refined) {
+    const float inv = 1.0f / f0;
+    float score = 0.0f, explained = 0.0f, counted = 0.0f;
+    float sum_w = 0.0f, sum_wf = 0.0f;
+    for (int q = 0; q < p->count; q++) {
+        float r = p->hz[q] * inv;
+        int h = (int)(r + 0.5f);
+        if (h > PV_PITCH_HARMONICS) {
+            continue;           // Above the top harmonic: neither for nor against
+        }
+        counted += p->mag[q];
+        if (h >= 1 && fabsf(r - h) <= PV_PITCH_TOLERANCE * h) {
+            float w = p->mag[q] / h;
+            score += w;
+            explained += p->mag[q];
+            sum_w += w;
+            sum_wf += w * p->hz[q] / h;
+        } else {
+            score -= PV_PITCH_PENALTY * p->mag[q];
+        }
+    }
+    *confidence = counted > 0.0f ? explained / counted : 0.0f;
+    *refined = sum_w > 0.0f ? sum_wf / sum_w : f0;
+    return score;
+}
+
+int pv_pitch_estimate(const PvPitchConfig* cfg, const float* mag, const float* freq, int n,
+                      int fft_size, PvPitch* out) {
+    out->pitch = -1.0f;
+    out->confidence = 0.0f;
+    out->peaks = 0;
+
+    const float bin_hz = cfg->sample_rate / fft_size;
+    const float hz_per_rad = cfg->sample_rate / (2.0f * (float)M_PI);
+    float min_pitch = PV_PITCH_MIN_BINS * bin_hz;
+    if (cfg->min_pitch > min_pitch) min_pitch = cfg->min_pitch;
+    if (min_pitch > cfg->max_pitch) {
+        return 0;
+    }
+    int lo = (int)(min_pitch / bin_hz);
+    int hi = (int)(cfg->max_pitch * PV_PITCH_HARMONICS / bin_hz) + 2;
+    if (lo < 1) lo = 1;
+    if (hi > n - 1) hi = n - 1;
+
+    float strongest = 0.0f;
+    for (int k = lo; k < hi; k++) {
+        if (mag[k] > strongest) strongest = mag[k];
+    }
+    // A full-scale sine peaks at fft_size / 4 through the Hann window
+    if (strongest < cfg->min_level * fft_size * 0.25f) {
+        return 0;
+    }
+
+    // Local maxima over the floor, strongest first
+    const float floor = strongest * cfg->floor;
+    PvPeaks p;
+    int bins[PV_PITCH_PEAKS];
+    p.count = 0;
+    for (int k = lo; k < hi; k++) {
+        float a = mag[k];
+        if (a <= floor || a <= mag[k - 1] || a < mag[k + 1]) {
+            continue;
+        }
+        out->peaks++;
+        if (p.count == PV_PITCH_PEAKS && a <= p.mag[PV_PITCH_PEAKS - 1]) {
+            continue;
+        }
+        int j = p.count < PV_PITCH_PEAKS ? p.count++ : PV_PITCH_PEAKS - 1;
+        for (; j > 0 && p.mag[j - 1] < a; j--) {
+            p.mag[j] = p.mag[j - 1];
+            bins[j] = bins[j - 1];
+        }
+        p.mag[j] = a;
+        bins[j] = k;
+    }
+    for (int q = 0; q < p.count; q++) {
+        int k = bins[q];
+        if (freq) {
+            p.hz[q] = freq[k] * hz_per_rad;
+        } else {
+            float l = mag[k - 1], c = mag[k], r = mag[k + 1];
+            float den = l - 2.0f * c + r;
+            p.hz[q] = (k + (den < 0.0f ? 0.5f * (l - r) / den : 0.0f)) * bin_hz;
+        }
+    }
+
+    float best = 0.0f;
+    for (int q = 0; q < p.count; q++) {
+        for (int h = 1; h <= PV_PITCH_HARMONICS; h++) {
+            float f0 = p.hz[q] / h;
+            if (f0 < min_pitch || f0 > cfg->max_pitch) {
+                continue;
+            }
+            float confidence, refined;
+            float score = pv_pitch_score(&p, f0, &confidence, &refined);
+            if (score > best) {
+                best = score;
+                out->pitch = refined;
+                out->confidence = confidence;
+            }
+        }
+    }
+    return out->pitch > 0.0f;
+}
@@ -0,0 +1,67 @@
+#ifndef PV_PITCH_H
+#define PV_PITCH_H
+
+// Pitch from the vocoder's own analysis frames.
+//
+// Every frame the vocoder already has each bin's magnitude and, from the
+// phase change over the hop, its true frequency. The fundamental is picked
+// from those by harmonic-sum scoring: the strongest spectral peaks are taken
+// as partials, every peak divided by 1 .. PV_PITCH_HARMONICS is a candidate,
+// and a candidate scores the magnitude of each peak that sits on one of its
+// harmonics, weighted by 1/h so a subharmonic does not win by explaining
+// everything, less half the magnitude of each peak below its top harmonic
+// that does not. The winner is refined from the true frequencies of the
+// peaks it explains; its confidence is the share of those peaks' magnitude
+// it explains.
+//
+// Without per-bin frequencies (phase locking keeps no per-bin phases) the
+// peaks are placed by parabolic interpolation of the magnitudes instead.
+//
+// There is no transform and no difference function: one scan of the bins
+// and a few hundred multiply-adds per frame. The estimate is only as good
+// as the frame resolves the partials: through the Hann window partials
+// closer than PV_PITCH_MIN_BINS bins merge, so no fundamental below that is
+// tried (70 Hz for 2048 samples at 48 kHz, 281 Hz for 512) and a low voice in
+// a short frame gets no estimate; callers fall back to Yin there (live_tune.c).
+
+#define PV_PITCH_PEAKS          8       // Strongest peaks scored
+#define PV_PITCH_HARMONICS      6       // Highest harmonic a peak can be
+#define PV_PITCH_TOLERANCE      0.03f   // Distance from a harmonic that still counts, relative
+#define PV_PITCH_PENALTY        0.5f    // Weight of a peak a candidate does not explain
+#define PV_PITCH_MIN_BINS       3.0f    // Lowest fundamental, in bins
+
+typedef struct {
+    float sample_rate;          // Hz
+    float min_pitch;            // Search range in Hz
+    float max_pitch;
+    float floor;                // Peaks below this fraction of the strongest are ignored
+    float min_level;            // Strongest peak needed, amplitude as a fraction of full scale
+} PvPitchConfig;
+
+typedef struct {
+    float pitch;                // Hz, -1 if none
+    float confidence;           // 0 .. 1
+    int peaks;                  // Peaks the frame had
+} PvPitch;
+
+/**
+ * Fill a config with the defaults: 48 kHz, 60 Hz to 1 kHz, peaks down to
+ * -40 dB of the strongest, nothing below -60 dBFS
+ * @param cfg         Config to fill
+ */
+void pv_pitch_default_config(PvPitchConfig* cfg);
+
+/**
+ * Estimate the fundamental of one analysis frame
+ * @param cfg         Config
+ * @param mag         Magnitude per bin (Hann-windowed frame of full-scale floats)
+ * @param freq        True frequency per bin in radians per sample (pvk_bin_freq), or NULL
+ * @param n           Number of bins (fft_size / 2 + 1)
+ * @param fft_size    Transform length the bins came from
+ * @param out         Receives the estimate
+ * @return            1 if a pitch was found, 0 if not (out->pitch is -1)
+ */
+int pv_pitch_estimate(const PvPitchConfig* cfg, const float* mag, const float* freq, int n,
+                      int fft_size, PvPitch* out);
+
+#endif // PV_PITCH_H
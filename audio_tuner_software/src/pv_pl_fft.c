@@ -0,0 +1,99 @@
+#include "pv_pl_fft.h"
+
+#if PV_PL_FFT
+
+#include <stdio.h>
+#include "xaxidma.h"
+#include "xil_cache.h"
+#include "xparameters.h"
+
+#define PV_PL_FFT_FORWARD   0x1u
+
+// Header beat followed by the data beats, as one MM2S transfer
+typedef struct {
+    uint32_t config;            // Low byte goes to the IP's config channel
+    uint32_t reserved;
+    Complex data[PV_PL_FFT_POINTS];
+} PvPlFftFrame;
+
+static PvPlFftFrame pl_tx[2] __attribute__((aligned(64)));
+static Complex pl_rx[2][PV_PL_FFT_POINTS] __attribute__((aligned(64)));
+
+static XAxiDma FftDma;
+static int pl_ready = 0;        // DMA initialised
+static int pl_open = 0;         // Claimed by a context
+static int pl_busy = -1;        // Buffer pair of the transform in flight (-1 = idle)
+
+static int pv_pl_fft_init(void) {
+    XAxiDma_Config* cfg = XAxiDma_LookupConfig(PV_FFT_DMA_DEV_ID);
+    if (!cfg) {
+        printf("FFT DMA: no config found\n");
+        return -1;
+    }
+    if (XAxiDma_CfgInitialize(&FftDma, cfg) != XST_SUCCESS) {
+        printf("FFT DMA: init failed\n");
+        return -1;
+    }
+    if (XAxiDma_HasSg(&FftDma)) {
+        printf("FFT DMA: scatter-gather build; expecting simple mode\n");
+        return -1;
+    }
+
+    // Polled, like the audio DMA
+    XAxiDma_IntrDisable(&FftDma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DEVICE_TO_DMA);
+    XAxiDma_IntrDisable(&FftDma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DMA_TO_DEVICE);
+    pl_ready = 1;
+    return 0;
+}
+
+int pv_pl_fft_open(int fft_size) {
+    if (pl_open || fft_size != 2 * PV_PL_FFT_POINTS) {
+        return -1;
+    }
+    if (!pl_ready && pv_pl_fft_init() != 0) {
+        return -1;
+    }
+    pl_open = 1;
+    return 0;
+}
+
+void pv_pl_fft_close(void) {
+    pv_pl_fft_wait();
+    pl_open = 0;
+}
+
+Complex* pv_pl_fft_input(int buf) {
+    return pl_tx[buf].data;
+}
+
+Complex* pv_pl_fft_output(int buf) {
+    return pl_rx[buf];
+}
+
+void pv_pl_fft_start(int buf, int inverse) {
+    pv_pl_fft_wait();
+
+    pl_tx[buf].config = inverse ? 0 : PV_PL_FFT_FORWARD;
+    pl_tx[buf].reserved = 0;
+
+    // Input to DDR; drop stale output lines so the CPU cannot write them back over the DMA
+    Xil_DCacheFlushRange((UINTPTR)&pl_tx[buf], sizeof(pl_tx[buf]));
+    Xil_DCacheInvalidateRange((UINTPTR)pl_rx[buf], sizeof(pl_rx[buf]));
+
+    // Receiver first so the IP never stalls on a full output FIFO
+    XAxiDma_SimpleTransfer(&FftDma, (UINTPTR)pl_rx[buf], sizeof(pl_rx[buf]), XAXIDMA_DEVICE_TO_DMA);
+    XAxiDma_SimpleTransfer(&FftDma, (UINTPTR)&pl_tx[buf], sizeof(pl_tx[buf]), XAXIDMA_DMA_TO_DEVICE);
+    pl_busy = buf;
+}
+
+void pv_pl_fft_wait(void) {
+    if (pl_busy < 0) {
+        return;
+    }
+    while (XAxiDma_Busy(&FftDma, XAXIDMA_DMA_TO_DEVICE)) { /* spin */ }
+    while (XAxiDma_Busy(&FftDma, XAXIDMA_DEVICE_TO_DMA)) { /* spin */ }
+    Xil_DCacheInvalidateRange((UINTPTR)pl_rx[pl_busy], sizeof(pl_rx[pl_busy]));
+    pl_busy = -1;
+}
+
+#endif // PV_PL_FFT
@@ -0,0 +1,63 @@
+#ifndef PV_PL_FFT_H
+#define PV_PL_FFT_H
+
+#include "fft.h"
+#include "phase_voc.h"
+
+// Driver for the fabric FFT (fft_pipeline + Xilinx FFT IP behind a second
+// AXI DMA in simple mode). The vocoder keeps its real-FFT split on the CPU
+// (rfft_forward_post / rfft_inverse_pre) and sends only the
+// PV_PL_FFT_POINTS-point complex transform to the fabric.
+//
+// Stream format, 64-bit beats (Complex layout: real in bits 31:0, imag in 63:32):
+//   MM2S: 1 header beat (bit 0: 1 = forward, 0 = inverse), then POINTS data beats
+//   S2MM: POINTS data beats in natural order, single-precision float
+// The IP does not scale; the inverse comes back multiplied by POINTS.
+//
+// Two buffer pairs let the CPU fill or read one pair while the fabric works
+// on the other. Only built with -DPV_PL_FFT=1.
+
+#ifndef PV_FFT_DMA_DEV_ID
+#define PV_FFT_DMA_DEV_ID   XPAR_AXIDMA_1_DEVICE_ID
+#endif
+
+#define PV_PL_FFT_POINTS    (PV_DEFAULT_FFT_SIZE / 2)   // Transform length built into the IP
+
+/**
+ * Claim the engine for a vocoder context
+ * @param fft_size   Real frame length; must be 2 * PV_PL_FFT_POINTS
+ * @return           0 when the engine can be used, -1 to stay on the CPU FFT
+ */
+int pv_pl_fft_open(int fft_size);
+
+/**
+ * Release the engine (waits for the transform in flight)
+ */
+void pv_pl_fft_close(void);
+
+/**
+ * @param buf        Buffer pair (0 or 1)
+ * @return           PV_PL_FFT_POINTS complex inputs for the next transform on buf
+ */
+Complex* pv_pl_fft_input(int buf);
+
+/**
+ * @param buf        Buffer pair (0 or 1)
+ * @return           Result of the last transform on buf, valid after pv_pl_fft_wait
+ */
+Complex* pv_pl_fft_output(int buf);
+
+/**
+ * Start a transform of pv_pl_fft_input(buf) into pv_pl_fft_output(buf).
+ * Waits first for the transform in flight, if any.
+ * @param buf        Buffer pair (0 or 1)
+ * @param inverse    Non-zero for the inverse transform
+ */
+void pv_pl_fft_start(int buf, int inverse);
+
+/**
+ * Wait for the transform in flight and make its output visible to the CPU
+ */
+void pv_pl_fft_wait(void);
+
+#endif // PV_PL_FFT_H
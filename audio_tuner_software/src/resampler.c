@@ -0,0 +1,153 @@
+#include <math.h>
+#include <string.h>
+#include "resampler.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Kaiser window shape (about 60 dB stopband at 16 taps)
+#define RS_KAISER_BETA 6.0
+// Passband edge as a fraction of the lower of the two Nyquist rates
+#define RS_CUTOFF      0.9
+
+// Zero-order modified Bessel function (power series)
+static double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    double q = x * x / 4.0;
+    for (int k = 1; k < 30; k++) {
+        term *= q / ((double)k * k);
+        sum += term;
+        if (term < 1e-12 * sum) break;
+    }
+    return sum;
+}
+
+int resampler_set_step(Resampler* rs, float step) {
+    if (!(step >= 0.25f && step <= 4.0f)) {
+        return -1;
+    }
+    rs->step = step;
+
+    // Cutoff in cycles per input sample; decimation narrows it to the output Nyquist
+    double fc = 0.5 * RS_CUTOFF / (step > 1.0f ? step : 1.0f);
+    double half = RS_TAPS / 2.0;
+    double i0_beta = bessel_i0(RS_KAISER_BETA);
+
+    // Tap k of row p sits at distance (k - (RS_TAPS/2 - 1) - p/RS_PHASES) from the output instant
+    for (int p = 0; p <= RS_PHASES; p++) {
+        float* row = rs->bank + p * RS_TAPS;
+        double frac = (double)p / RS_PHASES;
+        double sum = 0.0;
+
+        for (int k = 0; k < RS_TAPS; k++) {
+            double x = k - (RS_TAPS / 2 - 1) - frac;
+            double sinc = (fabs(x) < 1e-9) ? 2.0 * fc : sin(2.0 * M_PI * fc * x) / (M_PI * x);
+            double r = x / half;
+            double w = (fabs(r) < 1.0) ? bessel_i0(RS_KAISER_BETA * sqrt(1.0 - r * r)) / i0_beta : 0.0;
+            row[k] = (float)(sinc * w);
+            sum += row[k];
+        }
+
+        // Unity DC gain for every phase
+        for (int k = 0; k < RS_TAPS; k++) {
+            row[k] = (float)(row[k] / sum);
+        }
+    }
+    return 0;
+}
+
+int resampler_set_rate(Resampler* rs, float step) {
+    if (!(step >= 0.25f && step <= 4.0f)) {
+        return -1;
+    }
+    rs->step = step;
+    return 0;
+}
+
+int resampler_init(Resampler* rs, float step) {
+    if (resampler_set_step(rs, step) != 0) {
+        return -1;
+    }
+    resampler_reset(rs);
+    return 0;
+}
+
+void resampler_reset(Resampler* rs) {
+    // RS_TAPS/2 - 1 samples of silence put input 0 at the centre of the first window
+    rs->count = RS_TAPS / 2 - 1;
+    memset(rs->buf, 0, rs->count * sizeof(float));
+    rs->pos = 0.0;
+}
+
+// Dot product of one window with the filter for fraction frac
+static inline float rs_dot(const Resampler* rs, const float* x, float frac) {
+    float fp = frac * RS_PHASES;
+    int p = (int)fp;
+    float t = fp - p;
+    const float* h0 = rs->bank + p * RS_TAPS;
+    const float* h1 = h0 + RS_TAPS;
+
+#if defined(__ARM_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (int k = 0; k < RS_TAPS; k += 4) {
+        float32x4_t a = vld1q_f32(h0 + k);
+        float32x4_t h = vfmaq_n_f32(a, vsubq_f32(vld1q_f32(h1 + k), a), t);
+        acc = vfmaq_f32(acc, h, vld1q_f32(x + k));
+    }
+    return vaddvq_f32(acc);
+#else
+    float acc = 0.0f;
+    for (int k = 0; k < RS_TAPS; k++) {
+        float h = h0[k] + (h1[k] - h0[k]) * t;
+        acc += h * x[k];
+    }
+    return acc;
+#endif
+}
+
+int resampler_process(Resampler* rs, const float* in, int n, float* out) {
+    int produced = 0;
+
+    while (n > 0) {
+        int chunk = (int)(sizeof(rs->buf) / sizeof(rs->buf[0])) - rs->count;
+        if (chunk > n) chunk = n;
+
+        if (in) {
+            memcpy(rs->buf + rs->count, in, chunk * sizeof(float));
+            in += chunk;
+        } else {
+            memset(rs->buf + rs->count, 0, chunk * sizeof(float));
+        }
+        rs->count += chunk;
+        n -= chunk;
+
+        // Emit every output whose whole window is buffered
+        double pos = rs->pos;
+        int start = (int)pos;
+        while (start + RS_TAPS <= rs->count) {
+            out[produced++] = rs_dot(rs, rs->buf + start, (float)(pos - start));
+            pos += rs->step;
+            start = (int)pos;
+        }
+
+        // Keep the samples the next window still needs
+        int drop = start < rs->count ? start : rs->count;
+        memmove(rs->buf, rs->buf + drop, (rs->count - drop) * sizeof(float));
+        rs->count -= drop;
+        rs->pos = pos - drop;
+    }
+
+    return produced;
+}
+
+int resampler_flush(Resampler* rs, float* out) {
+    int produced = resampler_process(rs, NULL, RS_TAPS, out);
+    resampler_reset(rs);
+    return produced;
+}
@@ -0,0 +1,75 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+// Polyphase windowed-sinc resampler.
+// Each output sample is a RS_TAPS-tap dot product with a filter interpolated
+// between two of RS_PHASES precomputed phases, so the cost per output is fixed.
+// The bank is built once per step; its cutoff tracks the step so decimation
+// (step > 1) is band-limited instead of aliasing.
+
+#define RS_PHASES 32
+#define RS_TAPS   16
+#define RS_CHUNK  256   // Input samples buffered per internal pass
+
+typedef struct {
+    float step;                                 // Input samples per output sample
+    double pos;                                 // Read position within buf (double so it does not drift)
+    int count;                                  // Valid samples in buf
+    float bank[(RS_PHASES + 1) * RS_TAPS];      // Row p = filter for fraction p / RS_PHASES
+    float buf[RS_TAPS - 1 + RS_CHUNK];          // Filter history + pending input
+} Resampler;
+
+/**
+ * Build the coefficient bank for a step and clear the history
+ * @param rs         Resampler to initialise
+ * @param step       Input samples consumed per output sample (0.25 .. 4.0)
+ * @return           0 on success, -1 on bad step
+ */
+int resampler_init(Resampler* rs, float step);
+
+/**
+ * Rebuild the coefficient bank for a new step, keeping the history and the
+ * read position, so a running stream changes rate without a discontinuity
+ * @param rs         Initialised resampler
+ * @param step       Input samples consumed per output sample (0.25 .. 4.0)
+ * @return           0 on success, -1 on bad step
+ */
+int resampler_set_step(Resampler* rs, float step);
+
+/**
+ * Change the step without rebuilding the bank, O(1): history, read position
+ * and filters are kept. Above the step the bank was built for, the cutoff no
+ * longer follows the output Nyquist, so build it (resampler_set_step) for the
+ * largest step the stream will use.
+ * @param rs         Initialised resampler
+ * @param step       Input samples consumed per output sample (0.25 .. 4.0)
+ * @return           0 on success, -1 on bad step
+ */
+int resampler_set_rate(Resampler* rs, float step);
+
+/**
+ * Clear the history; output sample 0 is aligned with the next input sample 0
+ * @param rs         Initialised resampler
+ */
+void resampler_reset(Resampler* rs);
+
+/**
+ * Resample a block. Call once with a whole buffer or repeatedly with a stream.
+ * Output m corresponds to input position m * step counted from the last reset.
+ * @param rs         Initialised resampler
+ * @param in         n input samples (NULL feeds silence)
+ * @param n          Number of input samples
+ * @param out        Output buffer with room for n / step + 2 samples
+ * @return           Number of output samples written
+ */
+int resampler_process(Resampler* rs, const float* in, int n, float* out);
+
+/**
+ * Feed enough silence to emit every output that depends on real input
+ * @param rs         Initialised resampler
+ * @param out        Output buffer with room for RS_TAPS / step + 2 samples
+ * @return           Number of output samples written
+ */
+int resampler_flush(Resampler* rs, float* out);
+
+#endif // RESAMPLER_H
@@ -0,0 +1,140 @@
+#include <stddef.h>
+#include "scale.h"
+
+// 2^(i / 12), i semitones above the A of the octave
+static const float scale_semitone[12] = {
+    1.000000000f, 1.059463094f, 1.122462048f, 1.189207115f, 1.259921050f, 1.334839854f,
+    1.414213562f, 1.498307077f, 1.587401052f, 1.681792831f, 1.781797436f, 1.887748625f
+};
+
+const Scale scale_chromatic = {
+    SCALE_A4, 8.781373978f,         // scale_log2(440), so A440 maps to exactly 69
+    0, SCALE_CHROMATIC,
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }
+};
+
+typedef union {
+    float f;
+    uint32_t u;
+} ScaleBits;
+
+static int scale_mod12(int n) {
+    int r = n % 12;
+    return r < 0 ? r + 12 : r;
+}
+
+static int scale_floor(float x) {
+    int i = (int)x;
+    return (float)i > x ? i - 1 : i;
+}
+
+float scale_pow2(int k) {
+    if (k < -126) k = -126;
+    if (k > 127) k = 127;
+    ScaleBits b;
+    b.u = (uint32_t)(k + 127) << 23;
+    return b.f;
+}
+
+float scale_log2(float x) {
+    ScaleBits b;
+    b.f = x;
+    int e = (int)((b.u >> 23) & 0xFF) - 127;
+    b.u = (b.u & 0x007FFFFF) | 0x3F800000;      // Mantissa in [1, 2)
+    float m = b.f;
+    if (m > 1.414213562f) {                     // Centre it on 1: [0.707, 1.414)
+        m *= 0.5f;
+        e++;
+    }
+    // Least-squares fit of log2(1 + x) over the range, 0.02 cents at worst
+    const float t = m - 1.0f;
+    const float lo = t * (1.442521594f - 0.720400989f * t);
+    const float hi = 0.488226395f + t * (-0.392464830f + 0.242392708f * t);
+    return (float)e + lo + t * t * t * hi;
+}
+
+// 2^x for |x| <= 0.5 (a ratio of at most six semitones), Taylor to the fifth power: 0.004 cents
+static float scale_exp2_small(float x) {
+    return 1.0f + x * (0.693147181f + x * (0.240226507f + x * (0.055504109f +
+           x * (0.009618129f + x * 0.001333356f))));
+}
+
+int scale_init(Scale* s, int key, uint16_t mask, float a4) {
+    s->a4 = a4 > 0.0f ? a4 : SCALE_A4;
+    s->log2_a4 = scale_log2(s->a4);
+    s->key = scale_mod12(key);
+    s->mask = mask & SCALE_CHROMATIC;
+    int ok = s->mask != 0;
+    if (!ok) {
+        s->mask = SCALE_CHROMATIC;
+    }
+
+    for (int pc = 0; pc < 12; pc++) {
+        int rel = scale_mod12(pc - s->key);
+        int d = 0, u = 0;
+        while (!(s->mask & (1u << scale_mod12(rel - d)))) d++;
+        while (!(s->mask & (1u << scale_mod12(rel + u)))) u++;
+        s->down[pc] = (int8_t)d;
+        s->up[pc] = (int8_t)u;
+    }
+    return ok ? 0 : -1;
+}
+
+float scale_midi(const Scale* s, float pitch) {
+    return 69.0f + 12.0f * (scale_log2(pitch) - s->log2_a4);
+}
+
+float scale_note_frequency(const Scale* s, int note) {
+    const int r = note - 69;
+    const int semi = scale_mod12(r);
+    return s->a4 * scale_semitone[semi] * scale_pow2((r - semi) / 12);
+}
+
+int scale_quantize_note(const Scale* s, float pitch, float* ratio) {
+    const float m = scale_midi(s, pitch);
+    // Rounded from 10 octaves up so the truncation never sees a negative value
+    const unsigned shifted = (unsigned)(m + (120.0f + 0.5f));
+    const int n = (int)shifted - 120;
+    const int pc = (int)(shifted % 12);
+    const int lo = n - s->down[pc];
+    const int hi = n + s->up[pc];
+    const int note = m - (float)lo <= (float)hi - m ? lo : hi;
+    if (ratio) {
+        // The note is at most six semitones away, so no division and no second table lookup
+        *ratio = scale_exp2_small(((float)note - m) * (1.0f / 12.0f));
+    }
+    return note;
+}
+
+float scale_quantize(const Scale* s, float pitch, float* ratio) {
+    const float target = scale_note_frequency(s, scale_quantize_note(s, pitch, NULL));
+    if (ratio) {
+        *ratio = target / pitch;
+    }
+    return target;
+}
+
+// Within a thousandth of a semitone counts as on the note, not beside it
+#define SCALE_ON_NOTE   0.001f
+
+int scale_next_note(const Scale* s, float pitch, int dir) {
+    const float m = scale_midi(s, pitch);
+    if (dir < 0) {
+        int n = -scale_floor(-(m - SCALE_ON_NOTE)) - 1;     // Largest whole note below m
+        return n - s->down[scale_mod12(n)];
+    }
+    int n = scale_floor(m + SCALE_ON_NOTE) + 1;             // Smallest whole note above m
+    return n + s->up[scale_mod12(n)];
+}
+
+float scale_reference_target(float pitch, float ref_pitch, int ref_note_class) {
+    Scale note_class;
+    const int c = scale_mod12(ref_note_class);
+    scale_init(&note_class, c, 0x001, SCALE_A4);
+    int note = scale_next_note(&note_class, pitch, pitch > ref_pitch ? -1 : 1);
+    if (note < 12 + c || note > 96 + c) {
+        return 0.0f;
+    }
+    return scale_note_frequency(&note_class, note);
+}
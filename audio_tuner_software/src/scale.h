@@ -0,0 +1,113 @@
+#ifndef SCALE_H
+#define SCALE_H
+
+#include <stdint.h>
+
+// Note and scale arithmetic without libm.
+//
+// Pitch to note is a log2 made of the float's exponent bits and a
+// fifth-order polynomial on the mantissa (0.02 cents off); note to pitch is
+// a 12-entry semitone table times a power of two built straight into the
+// exponent bits. A Scale holds the allowed pitch classes as a bit mask
+// relative to its key, with the distance from every pitch class to the
+// nearest allowed one below and above, so quantising a pitch to any scale
+// is a log2, a table lookup and a multiply, whatever the scale.
+
+// Pitch classes from the key (bit i: i semitones above the key is allowed)
+#define SCALE_CHROMATIC         0x0FFF
+#define SCALE_MAJOR             0x0AB5  // 0 2 4 5 7 9 11
+#define SCALE_MINOR             0x05AD  // 0 2 3 5 7 8 10 (natural)
+#define SCALE_MAJOR_PENTATONIC  0x0295  // 0 2 4 7 9
+#define SCALE_MINOR_PENTATONIC  0x04A9  // 0 3 5 7 10
+
+#define SCALE_A4                440.0f
+
+typedef struct {
+    float a4;                   // Hz of MIDI note 69
+    float log2_a4;
+    int key;                    // Pitch class of the tonic, 0 = C
+    uint16_t mask;              // Allowed pitch classes, relative to the key
+    int8_t down[12];            // Per absolute pitch class: semitones down to the nearest allowed note (0 if allowed)
+    int8_t up[12];              // The same, up
+} Scale;
+
+// Equal temperament at A440, every note allowed (needs no scale_init)
+extern const Scale scale_chromatic;
+
+/**
+ * Fast log2 (exponent bits plus a mantissa polynomial, 0.02 cents of error at worst)
+ * @param x          Value (> 0)
+ * @return           log2(x)
+ */
+float scale_log2(float x);
+
+/**
+ * 2^k for a whole k, built straight into the exponent bits
+ * @param k          Power (clamped to -126 .. 127)
+ * @return           2^k
+ */
+float scale_pow2(int k);
+
+/**
+ * Build a scale
+ * @param s          Scale to fill
+ * @param key        Pitch class of the tonic (0 = C, 9 = A; taken mod 12)
+ * @param mask       Allowed pitch classes relative to the key (SCALE_*, or any 12-bit mask)
+ * @param a4         Tuning; <= 0 for SCALE_A4
+ * @return           0 on success, -1 if the mask allows no note (s becomes chromatic)
+ */
+int scale_init(Scale* s, int key, uint16_t mask, float a4);
+
+/**
+ * @param s          Scale (only its tuning is used)
+ * @param pitch      Pitch in Hz (> 0)
+ * @return           MIDI note number, not rounded
+ */
+float scale_midi(const Scale* s, float pitch);
+
+/**
+ * @param s          Scale (only its tuning is used)
+ * @param note       MIDI note number
+ * @return           Its frequency in Hz
+ */
+float scale_note_frequency(const Scale* s, int note);
+
+/**
+ * Nearest allowed note to a pitch
+ * @param s          Scale
+ * @param pitch      Pitch in Hz (> 0)
+ * @param ratio      If not NULL, receives target / pitch
+ * @return           MIDI note number of the target
+ */
+int scale_quantize_note(const Scale* s, float pitch, float* ratio);
+
+/**
+ * Nearest allowed frequency to a pitch
+ * @param s          Scale
+ * @param pitch      Pitch in Hz (> 0)
+ * @param ratio      If not NULL, receives target / pitch
+ * @return           Target in Hz
+ */
+float scale_quantize(const Scale* s, float pitch, float* ratio);
+
+/**
+ * Allowed note strictly below (dir < 0) or above (dir > 0) a pitch
+ * @param s          Scale
+ * @param pitch      Pitch in Hz (> 0)
+ * @param dir        Direction
+ * @return           MIDI note number
+ */
+int scale_next_note(const Scale* s, float pitch, int dir);
+
+/**
+ * Target for a take against a reference (target.wav): the nearest note of
+ * the reference's pitch class below a take that is sharp of the reference,
+ * above one that is flat
+ * @param pitch          Take pitch in Hz (> 0)
+ * @param ref_pitch      Reference pitch in Hz
+ * @param ref_note_class Its pitch class, 0 = C
+ * @return               Target in Hz (A440), 0 if it falls outside octaves 0 .. 7
+ */
+float scale_reference_target(float pitch, float ref_pitch, int ref_note_class);
+
+#endif // SCALE_H
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <string.h>
+#include "sd_sink.h"
+#include "wav_writer.h"
+#include "dlog.h"
+
+typedef struct {
+    char path[64];
+    const int16_t* pcm;
+    uint32_t samples;
+    uint32_t fs;
+    uint16_t bits;
+} SdSinkJob;
+
+static SdSinkJob sink_jobs[SD_SINK_FILES];
+static int sink_head;           // Job being written
+static int sink_count;          // Jobs queued, including the one being written
+static int sink_open;           // sink_writer holds sink_jobs[sink_head]
+static uint32_t sink_done;      // Samples of the current job handed to the writer
+static int sink_failed;
+static int sink_slots;          // Open files with wav_writer_open_slot
+static WavWriter sink_writer;
+
+int sd_sink_add(const char* path, const int16_t* pcm, uint32_t n, uint32_t fs, uint16_t bits) {
+    if (sink_count == SD_SINK_FILES || strlen(path) >= sizeof(sink_jobs[0].path)) {
+        return -1;
+    }
+    SdSinkJob* job = &sink_jobs[(sink_head + sink_count) % SD_SINK_FILES];
+    strcpy(job->path, path);
+    job->pcm = pcm;
+    job->samples = n;
+    job->fs = fs;
+    job->bits = bits;
+    sink_count++;
+    return 0;
+}
+
+void sd_sink_use_slots(int enable) {
+    sink_slots = enable;
+}
+
+// Drop the current job and move to the next one
+static void sd_sink_next(void) {
+    sink_open = 0;
+    sink_head = (sink_head + 1) % SD_SINK_FILES;
+    sink_count--;
+}
+
+int sd_sink_step(void) {
+    if (sink_count == 0) {
+        return 0;
+    }
+    SdSinkJob* job = &sink_jobs[sink_head];
+
+    if (!sink_open) {
+        FRESULT fr = sink_slots ? wav_writer_open_slot(&sink_writer, job->path, job->samples, job->fs, job->bits, 1)
+                                : wav_writer_open(&sink_writer, job->path, job->samples, job->fs, job->bits, 1);
+        if (fr != FR_OK) {
+            DLOG_ERROR("SD sink: cannot create %s\n", job->path);
+            sink_failed++;
+            sd_sink_next();
+            return sink_count > 0;
+        }
+        sink_open = 1;
+        sink_done = 0;
+        return 1;
+    }
+
+    if (sink_done < job->samples) {
+        // Exactly what completes the writer's current block, so each step is one card write
+        uint32_t n = wav_writer_block_room(&sink_writer);
+        if (n > job->samples - sink_done) n = job->samples - sink_done;
+        if (wav_writer_write(&sink_writer, job->pcm + sink_done, n) != FR_OK) {
+            sink_done = job->samples;   // Close below keeps what was written
+        } else {
+            sink_done += n;
+        }
+        return 1;
+    }
+
+    if (wav_writer_close(&sink_writer) != FR_OK) {
+        DLOG_ERROR("SD sink: failed to finish %s\n", job->path);
+        sink_failed++;
+    }
+    sd_sink_next();
+    return sink_count > 0;
+}
+
+int sd_sink_queued(void) {
+    return sink_count;
+}
+
+int sd_sink_flush(void) {
+    while (sd_sink_step()) {
+    }
+    int failed = sink_failed;
+    sink_failed = 0;
+    return failed;
+}
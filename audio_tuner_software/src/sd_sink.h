@@ -0,0 +1,51 @@
+#ifndef SD_SINK_H
+#define SD_SINK_H
+
+#include <stdint.h>
+
+// Background SD persistence for takes held in DDR.
+// Files are queued with a pointer to their samples and written as WAVs one
+// wav_writer block per sd_sink_step() call, so the main loop can persist a
+// take in the gaps between other work (waiting for a button, a full
+// playback queue) instead of blocking on the card. The samples must stay
+// untouched until the sink is idle again.
+
+#define SD_SINK_FILES   2           // Files that can be queued at once
+
+/**
+ * Queue a WAV file for writing
+ * @param path       Full path (e.g. "0:/out_001.wav"); copied
+ * @param pcm        n mono 16-bit samples, kept by reference until written
+ * @param n          Number of samples
+ * @param fs         Sample rate in Hz
+ * @param bits       16 for PCM, or WAV_BITS_ADPCM to store the file as IMA ADPCM
+ * @return           0 on success, -1 if the queue is full or the path is too long
+ */
+int sd_sink_add(const char* path, const int16_t* pcm, uint32_t n, uint32_t fs, uint16_t bits);
+
+/**
+ * Write files as take slots (wav_writer_open_slot): a file already on the card
+ * with room for the take is overwritten in place and keeps its size. Off by
+ * default; applies to files opened from then on.
+ * @param enable     1 for slots, 0 to recreate and trim every file
+ */
+void sd_sink_use_slots(int enable);
+
+/**
+ * Do one bounded piece of work: open the next file, write one block, or close it
+ * @return           1 while work remains, 0 when idle
+ */
+int sd_sink_step(void);
+
+/**
+ * @return           Files queued, including the one being written (0 when idle)
+ */
+int sd_sink_queued(void);
+
+/**
+ * Finish every queued file
+ * @return           Number of files that failed since the last flush (0 = all saved)
+ */
+int sd_sink_flush(void);
+
+#endif // SD_SINK_H
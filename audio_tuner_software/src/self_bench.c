@@ -0,0 +1,522 @@
+#include <math.h>
+#include <string.h>
+#include "self_bench.h"
+#include "Yin.h"
+#include "YinTracker.h"
+#include "fft.h"
+#include "phase_voc.h"
+#include "psola.h"
+#include "resampler.h"
+#include "fixed_point.h"
+#include "adpcm.h"
+#include "arena.h"
+#include "capture.h"
+#include "playback.h"
+#include "dma_mem.h"
+#include "ff.h"
+#include "xil_io.h"
+#include "xil_printf.h"
+#include "xparameters.h"
+#include "xtime_l.h"
+
+#define SB_FS               48000
+#define SB_SAMPLES          (3 * SB_FS)     // The host benchmark's sweep
+#define SB_CPU_HZ           XPAR_CPU_CORTEXA53_0_CPU_CLK_FREQ_HZ
+#define SB_YIN_WINDOW       2048            // As kernel_bench.c
+#define SB_YIN_HOP          512
+#define SB_TRACK_WINDOW     1024
+#define SB_TRACK_BURST      CAPTURE_BURST_SAMPLES
+#define SB_PV_CHUNK         1024
+#define SB_PV_RATIO         1.5f
+#define SB_PV_MAX_FFT       4096
+#define SB_ADPCM_BLOCKS     (SB_SAMPLES / ADPCM_BLOCK_SAMPLES)
+#define SB_DMA_TIMEOUT_US   100000
+
+typedef struct {
+    int frames;                 // Units of work in a pass
+    double check;               // Mean pitch, output RMS or round-trip error
+} SbPass;
+
+typedef struct {
+    const char* name;
+    SbPass (*run)(void);
+    int bytes_per_sample;       // Input bytes per sample, for mb_per_s
+} SbKernel;
+
+static int16_t* sb_pcm;         // The sweep, 16-bit
+static float* sb_float;         // ... as float
+static uint32_t* sb_words;      // ... as capture words
+
+static DMA_MEM uint32_t sb_dma_buf[SELF_BENCH_DMA_WORDS];
+
+static double sb_elapsed(XTime t0, XTime t1) {
+    return (double)(t1 - t0) / COUNTS_PER_SECOND;
+}
+
+static void sb_wait_us(uint32_t us) {
+    XTime t0, t;
+    XTime_GetTime(&t0);
+    do {
+        XTime_GetTime(&t);
+    } while (t - t0 < (XTime)us * (COUNTS_PER_SECOND / 1000000));
+}
+
+/*** Output ***/
+
+// xil_printf has no %f: whole part and a fixed number of decimals
+static void sb_field(const char* key, double v, uint32_t scale) {
+    if (!(v > 0.0)) {
+        v = 0.0;
+    }
+    uint64_t x = (uint64_t)(v * scale + 0.5);
+    xil_printf(",\"%s\":%lu", key, (unsigned long)(x / scale));
+    if (scale == 10) {
+        xil_printf(".%lu", (unsigned long)(x % 10));
+    } else if (scale == 100) {
+        xil_printf(".%02lu", (unsigned long)(x % 100));
+    } else if (scale == 1000) {
+        xil_printf(".%03lu", (unsigned long)(x % 1000));
+    }
+}
+
+static void sb_row(const char* kernel, const char* input, double samples, int frames,
+                   double bytes, double seconds, double check) {
+    double sps = seconds > 0.0 ? samples / seconds : 0.0;
+    xil_printf("{\"kernel\":\"%s\",\"input\":\"%s\"", kernel, input);
+    sb_field("samples_per_s", sps, 10);
+    sb_field("ns_per_frame", frames ? seconds * 1e9 / frames : 0.0, 10);
+    sb_field("cycles_per_sample", samples > 0.0 ? seconds * SB_CPU_HZ / samples : 0.0, 100);
+    sb_field("mb_per_s", seconds > 0.0 ? bytes / seconds / 1e6 : 0.0, 100);
+    sb_field("realtime", sps / SB_FS, 100);
+    sb_field("check", check, 1000);
+    xil_printf("}\r\n");
+}
+
+/*** Inputs ***/
+
+static int sb_make_inputs(void) {
+    sb_pcm = arena_malloc(SB_SAMPLES * sizeof(int16_t));
+    sb_float = arena_malloc(SB_SAMPLES * sizeof(float));
+    sb_words = arena_malloc(SB_SAMPLES * sizeof(uint32_t));
+    if (!sb_pcm || !sb_float || !sb_words) {
+        return -1;
+    }
+    const double f0 = 80.0, f1 = 1000.0, seconds = (double)SB_SAMPLES / SB_FS;
+    const double k = log(f1 / f0) / seconds;
+    for (int i = 0; i < SB_SAMPLES; i++) {
+        double t = (double)i / SB_FS;
+        double phase = 2.0 * M_PI * f0 * (exp(k * t) - 1.0) / k;
+        sb_pcm[i] = (int16_t)(0.5 * 32767.0 * sin(phase));
+    }
+    q15_to_float_array(sb_pcm, sb_float, SB_SAMPLES);
+    // Capture words that convert back to the sweep: mirrored, above the shift
+    for (int i = 0; i < SB_SAMPLES; i++) {
+        sb_words[i] = (uint32_t)pcm_bitrev16((uint16_t)sb_pcm[i]) << PCM_CAPTURE_SHIFT;
+    }
+    return 0;
+}
+
+static double sb_rms(double energy, long n) {
+    return n ? sqrt(energy / n) / 32768.0 : 0.0;
+}
+
+/*** Kernels ***/
+
+static SbPass sb_yin(int mode) {
+    static int16_t window[SB_YIN_WINDOW];
+    SbPass p = { 0, 0.0 };
+    Yin yin;
+    void* workspace = NULL;
+    int voiced = 0;
+
+    if (mode == 0) {
+        size_t bytes = Yin_workspaceSize(SB_YIN_WINDOW, 0);
+        workspace = arena_malloc(bytes);
+        if (!workspace) {
+            return p;
+        }
+        Yin_initWorkspace(&yin, SB_YIN_WINDOW, 0.15f, workspace, bytes);
+    } else {
+        Yin_init(&yin, SB_YIN_WINDOW, 0.15f);
+        Yin_setCoarseToFine(&yin, mode == 2);
+    }
+    Yin_setRange(&yin, 20.0f, 4200.0f);
+    for (int start = 0; start + SB_YIN_WINDOW <= SB_SAMPLES; start += SB_YIN_HOP) {
+        memcpy(window, sb_pcm + start, sizeof(window));
+        float pitch = Yin_getPitch(&yin, window);
+        if (pitch > 0) {
+            p.check += pitch;
+            voiced++;
+        }
+        p.frames++;
+    }
+    p.check = voiced ? p.check / voiced : 0.0;
+    if (workspace) {
+        arena_free(workspace);
+    } else {
+        Yin_free(&yin);
+    }
+    return p;
+}
+
+static SbPass sb_yin_direct(void) { return sb_yin(0); }
+static SbPass sb_yin_fft(void)    { return sb_yin(1); }
+static SbPass sb_yin_coarse(void) { return sb_yin(2); }
+
+static SbPass sb_tracker(void) {
+    SbPass p = { 0, 0.0 };
+    YinTracker t;
+    int voiced = 0;
+
+    if (YinTracker_init(&t, SB_TRACK_WINDOW, 0.15f) != 0) {
+        return p;
+    }
+    Yin_setRange(&t.yin, 20.0f, 4200.0f);
+    for (int i = 0; i + SB_TRACK_BURST <= SB_SAMPLES; i += SB_TRACK_BURST) {
+        float pitch = YinTracker_push(&t, sb_pcm + i, SB_TRACK_BURST);
+        if (i >= SB_TRACK_WINDOW && pitch > 0) {
+            p.check += pitch;
+            voiced++;
+        }
+        p.frames++;
+    }
+    p.check = voiced ? p.check / voiced : 0.0;
+    YinTracker_free(&t);
+    return p;
+}
+
+// Forward and inverse real FFT over the sweep a frame at a time; the check
+// is the largest round-trip error
+static SbPass sb_fft(int size) {
+    SbPass p = { 0, 0.0 };
+    RealFFTPlan plan;
+    if (rfft_plan_init(&plan, size) != 0) {
+        return p;
+    }
+    Complex* spec = arena_malloc((size / 2 + 1) * sizeof(Complex));
+    float* out = arena_malloc(size * sizeof(float));
+    if (spec && out) {
+        for (int i = 0; i + size <= SB_SAMPLES; i += size) {
+            rfft_forward(&plan, sb_float + i, spec);
+            rfft_inverse(&plan, spec, out);
+            for (int k = 0; k < size; k++) {
+                double err = fabs(out[k] - sb_float[i + k]);
+                if (err > p.check) p.check = err;
+            }
+            p.frames++;
+        }
+    }
+    arena_free(spec);
+    arena_free(out);
+    rfft_plan_free(&plan);
+    return p;
+}
+
+static SbPass sb_fft_256(void)  { return sb_fft(256); }
+static SbPass sb_fft_1024(void) { return sb_fft(1024); }
+static SbPass sb_fft_2048(void) { return sb_fft(2048); }
+static SbPass sb_fft_4096(void) { return sb_fft(4096); }
+
+static SbPass sb_pv(int fft_size, int hop) {
+    static int16_t out[2 * SB_PV_CHUNK + PV_FLUSH_ROOM(SB_PV_MAX_FFT, SB_PV_MAX_FFT / 4)];
+    SbPass p = { 0, 0.0 };
+    double energy = 0.0;
+    long produced = 0;
+
+    PhaseVocoder* pv = pv_create(fft_size, hop, SB_PV_RATIO);
+    if (!pv) {
+        return p;
+    }
+    for (int i = 0; i < SB_SAMPLES; i += SB_PV_CHUNK) {
+        int n = SB_SAMPLES - i < SB_PV_CHUNK ? SB_SAMPLES - i : SB_PV_CHUNK;
+        int got = pv_process_q15(pv, sb_pcm + i, n, out);
+        for (int k = 0; k < got; k++) energy += (double)out[k] * out[k];
+        produced += got;
+    }
+    int got = pv_flush_q15(pv, out);
+    for (int k = 0; k < got; k++) energy += (double)out[k] * out[k];
+    produced += got;
+
+    p.frames = SB_SAMPLES / hop;
+    p.check = sb_rms(energy, produced);
+    pv_destroy(pv);
+    return p;
+}
+
+static SbPass sb_pv_q15(void)  { return sb_pv(PV_DEFAULT_FFT_SIZE, PV_DEFAULT_HOP); }
+static SbPass sb_pv_512(void)  { return sb_pv(512, 128); }
+static SbPass sb_pv_4096(void) { return sb_pv(4096, 1024); }
+
+static SbPass sb_psola(void) {
+    static int16_t out[SB_PV_CHUNK + PSOLA_FLUSH_ROOM(PSOLA_DEFAULT_MAX_PERIOD)];
+    SbPass p = { 0, 0.0 };
+    double energy = 0.0;
+    long produced = 0;
+
+    Psola* ps = psola_create(PSOLA_DEFAULT_MAX_PERIOD, SB_PV_RATIO, 1);
+    if (!ps) {
+        return p;
+    }
+    for (int i = 0; i < SB_SAMPLES; i += SB_PV_CHUNK) {
+        int n = SB_SAMPLES - i < SB_PV_CHUNK ? SB_SAMPLES - i : SB_PV_CHUNK;
+        int got = psola_process_q15(ps, sb_pcm + i, n, out);
+        for (int k = 0; k < got; k++) energy += (double)out[k] * out[k];
+        produced += got;
+    }
+    int got = psola_flush_q15(ps, out);
+    for (int k = 0; k < got; k++) energy += (double)out[k] * out[k];
+    produced += got;
+
+    p.frames = SB_SAMPLES / PSOLA_TRACK_HOP;
+    p.check = sb_rms(energy, produced);
+    psola_destroy(ps);
+    return p;
+}
+
+static SbPass sb_resampler(void) {
+    static Resampler rs;
+    static float out[RS_CHUNK + 2];            // n / step + 2 with step above 1
+    SbPass p = { 0, 0.0 };
+    double energy = 0.0;
+    long produced = 0;
+
+    if (resampler_init(&rs, SB_PV_RATIO) != 0) {
+        return p;
+    }
+    for (int i = 0; i < SB_SAMPLES; i += RS_CHUNK) {
+        int n = SB_SAMPLES - i < RS_CHUNK ? SB_SAMPLES - i : RS_CHUNK;
+        int got = resampler_process(&rs, sb_float + i, n, out);
+        for (int k = 0; k < got; k++) energy += (double)out[k] * out[k];
+        produced += got;
+        p.frames++;
+    }
+    p.check = produced ? sqrt(energy / produced) : 0.0;
+    return p;
+}
+
+static SbPass sb_pcm_from_capture(void) {
+    static int16_t out[CAPTURE_BURST_SAMPLES];
+    SbPass p = { 0, 0.0 };
+    long sum = 0;
+    for (int i = 0; i + CAPTURE_BURST_SAMPLES <= SB_SAMPLES; i += CAPTURE_BURST_SAMPLES) {
+        pcm_from_capture(sb_words + i, out, CAPTURE_BURST_SAMPLES);
+        sum += out[0] != sb_pcm[i];     // Must give the sweep back
+        p.frames++;
+    }
+    p.check = (double)sum;
+    return p;
+}
+
+static SbPass sb_pcm_to_playback(void) {
+    static uint32_t out[2 * PLAYBACK_SAMPLES];
+    SbPass p = { 0, 0.0 };
+    for (int i = 0; i + PLAYBACK_SAMPLES <= SB_SAMPLES; i += PLAYBACK_SAMPLES) {
+        pcm_to_playback(sb_pcm + i, out, PLAYBACK_SAMPLES);
+        p.frames++;
+    }
+    return p;
+}
+
+static SbPass sb_adpcm(void) {
+    static uint8_t block[ADPCM_BLOCK_BYTES];
+    SbPass p = { 0, 0.0 };
+    AdpcmState s;
+    adpcm_init(&s);
+    for (int b = 0; b < SB_ADPCM_BLOCKS; b++) {
+        const int16_t* x = sb_pcm + b * ADPCM_BLOCK_SAMPLES;
+        adpcm_block_begin(&s, x[0], block);
+        adpcm_encode(&s, x + 1, block, 1, ADPCM_BLOCK_SAMPLES - 1);
+        p.frames++;
+    }
+    return p;
+}
+
+static const SbKernel sb_kernels[] = {
+    { "yin_direct",  sb_yin_direct, 2 },
+    { "yin_fft",     sb_yin_fft, 2 },
+    { "yin_coarse",  sb_yin_coarse, 2 },
+    { "yin_tracker", sb_tracker, 2 },
+    { "fft_256",     sb_fft_256, 2 },
+    { "fft_1024",    sb_fft_1024, 2 },
+    { "fft_2048",    sb_fft_2048, 2 },
+    { "fft_4096",    sb_fft_4096, 2 },
+    { "pv_q15",      sb_pv_q15, 2 },
+    { "pv_512",      sb_pv_512, 2 },
+    { "pv_4096",     sb_pv_4096, 2 },
+    { "psola_q15",   sb_psola, 2 },
+    { "resampler",   sb_resampler, 4 },
+    { "pcm_from_capture", sb_pcm_from_capture, 4 },
+    { "pcm_to_playback", sb_pcm_to_playback, 2 },
+    { "adpcm_encode", sb_adpcm, 2 },
+};
+
+static void sb_kernel(const SbKernel* k) {
+    double best = 0.0;
+    SbPass p = { 0, 0.0 };
+    for (int r = 0; r < SELF_BENCH_REPEATS; r++) {
+        XTime t0, t1;
+        XTime_GetTime(&t0);
+        p = k->run();
+        XTime_GetTime(&t1);
+        double t = sb_elapsed(t0, t1);
+        if (r == 0 || t < best) best = t;
+    }
+    if (p.frames == 0) {
+        xil_printf("# %s did not run\r\n", k->name);
+        return;
+    }
+    sb_row(k->name, "sweep", SB_SAMPLES, p.frames, (double)SB_SAMPLES * k->bytes_per_sample, best, p.check);
+}
+
+/*** SD card ***/
+
+static int sb_sd(void) {
+    uint8_t* buf = arena_malloc(SELF_BENCH_SD_BLOCK);
+    if (!buf) {
+        return -1;
+    }
+    memcpy(buf, sb_pcm, SELF_BENCH_SD_BLOCK);
+    const uint32_t blocks = SELF_BENCH_SD_KB * 1024u / SELF_BENCH_SD_BLOCK;
+    const double bytes = (double)blocks * SELF_BENCH_SD_BLOCK;
+    FIL fil;
+    UINT n;
+    XTime t0, t1;
+
+    XTime_GetTime(&t0);
+    if (f_open(&fil, SELF_BENCH_SD_FILE, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+        xil_printf("# sd: cannot create %s\r\n", SELF_BENCH_SD_FILE);
+        return -1;
+    }
+    for (uint32_t b = 0; b < blocks; b++) {
+        if (f_write(&fil, buf, SELF_BENCH_SD_BLOCK, &n) != FR_OK || n != SELF_BENCH_SD_BLOCK) {
+            f_close(&fil);
+            f_unlink(SELF_BENCH_SD_FILE);
+            xil_printf("# sd: write failed (card full?)\r\n");
+            return -1;
+        }
+    }
+    int ok = f_close(&fil) == FR_OK;
+    XTime_GetTime(&t1);
+    if (ok) {
+        sb_row("sd_write", "card", bytes / 2, blocks, bytes, sb_elapsed(t0, t1), 0.0);
+    }
+
+    XTime_GetTime(&t0);
+    ok = f_open(&fil, SELF_BENCH_SD_FILE, FA_READ) == FR_OK;
+    for (uint32_t b = 0; ok && b < blocks; b++) {
+        ok = f_read(&fil, buf, SELF_BENCH_SD_BLOCK, &n) == FR_OK && n == SELF_BENCH_SD_BLOCK;
+    }
+    f_close(&fil);
+    XTime_GetTime(&t1);
+    if (ok) {
+        sb_row("sd_read", "card", bytes / 2, blocks, bytes, sb_elapsed(t0, t1), 0.0);
+    } else {
+        xil_printf("# sd: read back failed\r\n");
+    }
+    f_unlink(SELF_BENCH_SD_FILE);
+    return ok ? 0 : -1;
+}
+
+/*** DMA ***/
+
+static int sb_dma_transfer(XAxiDma* dma, int dir, double* seconds) {
+    const uint32_t bytes = sizeof(sb_dma_buf);
+    XTime t0, t;
+    if (dir == XAXIDMA_DMA_TO_DEVICE) {
+        dma_mem_to_device(sb_dma_buf, bytes);
+    } else {
+        dma_mem_from_device(sb_dma_buf, bytes);
+    }
+    XTime_GetTime(&t0);
+    if (XAxiDma_SimpleTransfer(dma, (UINTPTR)sb_dma_buf, bytes, dir) != XST_SUCCESS) {
+        return -1;
+    }
+    do {
+        XTime_GetTime(&t);
+        if (t - t0 > (XTime)SB_DMA_TIMEOUT_US * (COUNTS_PER_SECOND / 1000000)) {
+            return -1;
+        }
+    } while (XAxiDma_Busy(dma, dir));
+    *seconds = sb_elapsed(t0, t);
+    return 0;
+}
+
+// MM2S into the empty speaker FIFO and S2MM out of a mic FIFO filled
+// beforehand: both run at bus speed, so the time is the submit, the
+// transfer and the completion
+static int sb_dma(XAxiDma* dma) {
+    const double bytes = sizeof(sb_dma_buf);
+    const uint32_t fill_us = SELF_BENCH_DMA_WORDS * 1000000u / SB_FS + 10000;
+    double best, t;
+    int err = 0;
+
+    XAxiDma_IntrDisable(dma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DMA_TO_DEVICE);
+    XAxiDma_IntrDisable(dma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DEVICE_TO_DMA);
+
+    // Silence; the speaker drains a transfer in under fill_us
+    memset(sb_dma_buf, 0, sizeof(sb_dma_buf));
+    best = 0.0;
+    for (int r = 0; r < SELF_BENCH_REPEATS; r++) {
+        sb_wait_us(fill_us);
+        if (sb_dma_transfer(dma, XAXIDMA_DMA_TO_DEVICE, &t) != 0) {
+            err = -1;
+            break;
+        }
+        if (r == 0 || t < best) best = t;
+    }
+    if (!err) {
+        sb_row("dma_mm2s", "pl", bytes / 4, 1, bytes, best, 0.0);
+    } else {
+        xil_printf("# dma_mm2s failed\r\n");
+    }
+
+    // Raw mic words, one packet per transfer
+    uint32_t log2 = 0;
+    while ((1u << log2) < SELF_BENCH_DMA_WORDS) {
+        log2++;
+    }
+    uint32_t ctrl = log2 << CAPTURE_CTRL_TLAST_SHIFT;
+    best = 0.0;
+    for (int r = 0; r < SELF_BENCH_REPEATS; r++) {
+        Xil_Out32((UINTPTR)CAPTURE_PL_BASEADDR + CAPTURE_CTRL_OFFSET, ctrl | CAPTURE_CTRL_FLUSH);
+        Xil_Out32((UINTPTR)CAPTURE_PL_BASEADDR + CAPTURE_CTRL_OFFSET, ctrl);
+        sb_wait_us(fill_us);
+        if (sb_dma_transfer(dma, XAXIDMA_DEVICE_TO_DMA, &t) != 0) {
+            err = -1;
+            break;
+        }
+        if (r == 0 || t < best) best = t;
+    }
+    if (best > 0.0) {
+        sb_row("dma_s2mm", "pl", bytes / 4, 1, bytes, best, 0.0);
+    } else {
+        xil_printf("# dma_s2mm failed\r\n");
+    }
+    if (err) {
+        // A transfer that never finished leaves the channel busy
+        XAxiDma_Reset(dma);
+        while (!XAxiDma_ResetIsDone(dma));
+    }
+    return err;
+}
+
+int self_bench_run(XAxiDma* dma) {
+    int err = 0;
+    xil_printf("# self benchmark: cpu_hz %lu, timer_hz %lu, built %s %s\r\n",
+               (unsigned long)SB_CPU_HZ, (unsigned long)COUNTS_PER_SECOND, __DATE__, __TIME__);
+    // Everything below comes back at once at the end
+    arena_begin();
+    if (sb_make_inputs() != 0) {
+        xil_printf("# no memory for the inputs\r\n");
+        arena_reset();
+        return -1;
+    }
+    for (size_t k = 0; k < sizeof(sb_kernels) / sizeof(sb_kernels[0]); k++) {
+        sb_kernel(&sb_kernels[k]);
+    }
+    if (sb_sd() != 0) err = -1;
+    if (sb_dma(dma) != 0) err = -1;
+    arena_reset();
+    xil_printf("# self benchmark done\r\n");
+    return err;
+}
@@ -0,0 +1,49 @@
+#ifndef SELF_BENCH_H
+#define SELF_BENCH_H
+
+#include <stdint.h>
+#include "xaxidma.h"
+
+// On-target benchmark of the DSP kernels, the SD card and the DMA, for
+// comparing builds and boards without the mic.
+//
+// Every kernel runs on a synthetic 3 s logarithmic sweep (80 Hz to 1 kHz,
+// half scale) generated into DDR, the same input as the host benchmark's
+// "sweep" rows (Testing/benchmark/kernel_bench.c), so the same kernel names
+// line up. Each is timed as the best of SELF_BENCH_REPEATS passes with the
+// generic timer. The card is written and read back sequentially through a
+// scratch file, and each DMA channel moves a block between DDR and the
+// pipeline FIFOs at bus speed (the speaker FIFO empty, the mic FIFO filled
+// first), timed from the submit to the completion.
+//
+// Results come out on the UART as JSON lines, one per kernel:
+//   {"kernel":"pv_q15","input":"sweep","samples_per_s":...,"ns_per_frame":...,
+//    "cycles_per_sample":...,"mb_per_s":...,"realtime":...,"check":...}
+// The first four fields are the host benchmark's, so a UART log passed to
+// kernel_bench -b prints the host's speed against the board's. A frame is
+// the kernel's unit of work (a Yin window, a tracker burst, a vocoder hop,
+// an FFT, a capture burst, an SD block, a DMA transfer); mb_per_s counts
+// the 16-bit samples in (words for the conversions, bytes for the card and
+// the DMA); realtime is samples per second over 48 kHz. Cycles are timer
+// time at the A53 clock. Lines that are not results start with '#'.
+
+#ifndef SELF_BENCH_REPEATS
+#define SELF_BENCH_REPEATS      3
+#endif
+#ifndef SELF_BENCH_SD_KB
+#define SELF_BENCH_SD_KB        8192    // Scratch file written and read back
+#endif
+#define SELF_BENCH_SD_BLOCK     32768   // Bytes per f_write / f_read
+#define SELF_BENCH_SD_FILE      "0:/bench.bin"
+#define SELF_BENCH_DMA_WORDS    2048    // Per transfer; half a pipeline FIFO
+
+/**
+ * Run every benchmark and print the results. Needs the DMA idle (capture
+ * and playback stopped) and, for the SD rows, the card mounted; the scratch
+ * file is deleted afterwards.
+ * @param dma        Initialised simple-mode DMA (both channels)
+ * @return           0 on success, -1 if a benchmark could not run (its row is missing)
+ */
+int self_bench_run(XAxiDma* dma);
+
+#endif // SELF_BENCH_H
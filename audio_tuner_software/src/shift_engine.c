@@ -0,0 +1,262 @@
+#include "shift_engine.h"
+#include "dlog.h"
+
+typedef struct {
+    const char* name;
+    int voice_only;             // Needs one voiced, periodic source
+    float min_ratio;            // Lowest ratio it is chosen for
+    void* (*create)(const ShiftEngineConfig* cfg, float ratio);
+    void (*destroy)(void* ctx);
+    int (*latency)(const ShiftEngineConfig* cfg);
+    int (*overrun)(const ShiftEngineConfig* cfg);
+    uint32_t (*cost)(const ShiftEngineConfig* cfg, uint32_t base);
+    int (*process)(void* ctx, const int16_t* in, int n, int16_t* out);
+    int (*flush)(void* ctx, int16_t* out);
+    void (*set_ratio)(void* ctx, float ratio);
+    float (*get_ratio)(const void* ctx);
+    void (*set_pitch)(void* ctx, float pitch);
+    int (*set_ratio_curve)(void* ctx, const float* curve, int frames);
+    int (*get_pitch)(const void* ctx, float* pitch, float* confidence);
+} ShiftEngineOps;
+
+static uint32_t shift_base_cost[SHIFT_ENGINE_COUNT] = { SHIFT_COST_PV, SHIFT_COST_PSOLA };
+
+/*** Phase vocoder ***/
+
+static void* pv_op_create(const ShiftEngineConfig* cfg, float ratio) {
+    PhaseVocoder* pv = pv_create(cfg->fft_size, cfg->hop, ratio);
+    if (pv && pv_set_phase_lock(pv, cfg->phase_lock) != 0) {
+        DLOG_WARN("Phase vocoder: phase locking unavailable, per-bin phases\r\n");
+    }
+    if (pv && pv_set_spectral_shift(pv, cfg->spectral_shift) != 0) {
+        DLOG_WARN("Phase vocoder: spectral shift unavailable, stretching\r\n");
+    }
+    if (pv && cfg->estimate_pitch) {
+        PvPitchConfig pitch_cfg;
+        pv_pitch_default_config(&pitch_cfg);
+        if (pv_set_pitch_estimate(pv, &pitch_cfg) != 0) {
+            DLOG_WARN("Phase vocoder: pitch estimate unavailable\r\n");
+        }
+    }
+    return pv;
+}
+static void pv_op_destroy(void* ctx) { pv_destroy(ctx); }
+static int pv_op_latency(const ShiftEngineConfig* cfg) { return cfg->fft_size - cfg->hop; }
+static int pv_op_overrun(const ShiftEngineConfig* cfg) { return cfg->hop + 1; }
+static uint32_t pv_op_cost(const ShiftEngineConfig* cfg, uint32_t base) {
+    // A measured base cost scales the other modes with it
+    if (cfg->spectral_shift) return base * SHIFT_COST_PV_SPECTRAL / SHIFT_COST_PV;
+    return cfg->phase_lock ? base * SHIFT_COST_PV_LOCKED / SHIFT_COST_PV : base;
+}
+static int pv_op_process(void* ctx, const int16_t* in, int n, int16_t* out) {
+    return pv_process_q15(ctx, in, n, out);
+}
+static int pv_op_flush(void* ctx, int16_t* out) { return pv_flush_q15(ctx, out); }
+static void pv_op_set_ratio(void* ctx, float ratio) { pv_set_ratio(ctx, ratio); }
+static float pv_op_get_ratio(const void* ctx) { return pv_get_ratio(ctx); }
+static int pv_op_set_ratio_curve(void* ctx, const float* curve, int frames) {
+    return pv_set_ratio_curve(ctx, curve, frames);
+}
+static int pv_op_get_pitch(const void* ctx, float* pitch, float* confidence) {
+    PvPitch p;
+    pv_get_pitch(ctx, &p);
+    *pitch = p.pitch;
+    *confidence = p.confidence;
+    return 0;
+}
+
+/*** PSOLA ***/
+
+static void* psola_op_create(const ShiftEngineConfig* cfg, float ratio) {
+    return psola_create(cfg->max_period, ratio, !cfg->external_pitch);
+}
+static void psola_op_destroy(void* ctx) { psola_destroy(ctx); }
+static int psola_op_latency(const ShiftEngineConfig* cfg) { return PSOLA_FLUSH_ROOM(cfg->max_period); }
+static int psola_op_overrun(const ShiftEngineConfig* cfg) { (void)cfg; return 0; }
+static uint32_t psola_op_cost(const ShiftEngineConfig* cfg, uint32_t base) {
+    return base + (cfg->external_pitch ? 0 : SHIFT_COST_PSOLA_TRACK);
+}
+static int psola_op_process(void* ctx, const int16_t* in, int n, int16_t* out) {
+    return psola_process_q15(ctx, in, n, out);
+}
+static int psola_op_flush(void* ctx, int16_t* out) { return psola_flush_q15(ctx, out); }
+static void psola_op_set_ratio(void* ctx, float ratio) { psola_set_ratio(ctx, ratio); }
+static float psola_op_get_ratio(const void* ctx) { return psola_get_ratio(ctx); }
+static void psola_op_set_pitch(void* ctx, float pitch) { psola_set_pitch(ctx, pitch); }
+
+static const ShiftEngineOps shift_ops[SHIFT_ENGINE_COUNT] = {
+    [SHIFT_ENGINE_PV] = {
+        "pv", 0, 0.0f, pv_op_create, pv_op_destroy, pv_op_latency, pv_op_overrun, pv_op_cost,
+        pv_op_process, pv_op_flush, pv_op_set_ratio, pv_op_get_ratio, NULL, pv_op_set_ratio_curve,
+        pv_op_get_pitch
+    },
+    [SHIFT_ENGINE_PSOLA] = {
+        "psola", 1, SHIFT_SELECT_PSOLA_MIN_RATIO, psola_op_create, psola_op_destroy, psola_op_latency,
+        psola_op_overrun, psola_op_cost, psola_op_process, psola_op_flush, psola_op_set_ratio,
+        psola_op_get_ratio, psola_op_set_pitch, NULL, NULL
+    },
+};
+
+static int shift_valid(ShiftEngineId id) {
+    return id >= 0 && id < SHIFT_ENGINE_COUNT;
+}
+
+/*** Selection ***/
+
+void shift_engine_default_config(ShiftEngineConfig* cfg) {
+    cfg->fft_size = PV_DEFAULT_FFT_SIZE;
+    cfg->hop = PV_DEFAULT_HOP;
+    cfg->phase_lock = PV_PHASE_LOCK;
+    cfg->spectral_shift = PV_SPECTRAL_SHIFT;
+    cfg->max_period = PSOLA_DEFAULT_MAX_PERIOD;
+    cfg->external_pitch = 0;
+    cfg->estimate_pitch = 0;
+    cfg->limit = 1;
+    limiter_default_config(&cfg->limiter);
+}
+
+const char* shift_engine_name(ShiftEngineId id) {
+    return shift_valid(id) ? shift_ops[id].name : "auto";
+}
+
+int shift_engine_latency_of(ShiftEngineId id, const ShiftEngineConfig* cfg) {
+    if (!shift_valid(id)) {
+        return 0;
+    }
+    return shift_ops[id].latency(cfg) + (cfg->limit ? cfg->limiter.lookahead : 0);
+}
+
+uint32_t shift_engine_cost(ShiftEngineId id, const ShiftEngineConfig* cfg) {
+    if (!shift_valid(id)) {
+        return 0;
+    }
+    return shift_ops[id].cost(cfg, shift_base_cost[id]) + (cfg->limit ? SHIFT_COST_LIMITER : 0);
+}
+
+void shift_engine_set_cost(ShiftEngineId id, uint32_t cycles) {
+    if (shift_valid(id)) {
+        shift_base_cost[id] = cycles;
+    }
+}
+
+ShiftEngineId shift_engine_select(const ShiftRequest* req, const ShiftEngineConfig* cfg) {
+    ShiftEngineId best = SHIFT_ENGINE_AUTO;         // Cheapest that fits and suits the signal
+    ShiftEngineId fits = SHIFT_ENGINE_AUTO;         // Cheapest that fits
+    ShiftEngineId cheapest = SHIFT_ENGINE_PV;
+
+    for (int i = 0; i < SHIFT_ENGINE_COUNT; i++) {
+        const ShiftEngineOps* op = &shift_ops[i];
+        uint32_t cost = shift_engine_cost(i, cfg);
+        if (cost < shift_engine_cost(cheapest, cfg)) {
+            cheapest = i;
+        }
+        if ((req->max_latency > 0 && shift_engine_latency_of(i, cfg) > req->max_latency) ||
+            (req->max_cycles > 0 && cost > req->max_cycles)) {
+            continue;
+        }
+        if (fits < 0 || cost < shift_engine_cost(fits, cfg)) {
+            fits = i;
+        }
+        if ((op->voice_only && req->voicing < SHIFT_SELECT_MIN_VOICING) || req->ratio < op->min_ratio) {
+            continue;
+        }
+        if (best < 0 || cost < shift_engine_cost(best, cfg)) {
+            best = i;
+        }
+    }
+
+    if (best < 0) {
+        best = fits >= 0 ? fits : cheapest;
+    }
+    if (fits < 0) {
+        DLOG_WARN("WARNING: no pitch shifter fits the budget, using %s\r\n", shift_ops[best].name);
+    }
+    return best;
+}
+
+/*** Streams ***/
+
+int shift_engine_open(ShiftEngine* e, ShiftEngineId id, const ShiftEngineConfig* cfg, float ratio) {
+    e->id = id;
+    e->cfg = *cfg;
+    e->limiter = NULL;
+    e->ctx = shift_valid(id) ? shift_ops[id].create(cfg, ratio) : NULL;
+    if (e->ctx && cfg->limit && !(e->limiter = limiter_create(&cfg->limiter))) {
+        shift_engine_close(e);
+    }
+    return e->ctx ? 0 : -1;
+}
+
+void shift_engine_close(ShiftEngine* e) {
+    if (e->ctx) {
+        shift_ops[e->id].destroy(e->ctx);
+        e->ctx = NULL;
+    }
+    limiter_destroy(e->limiter);
+    e->limiter = NULL;
+}
+
+int shift_engine_latency(const ShiftEngine* e) {
+    return shift_engine_latency_of(e->id, &e->cfg);
+}
+
+int shift_engine_overrun(const ShiftEngine* e) {
+    return shift_ops[e->id].overrun(&e->cfg);
+}
+
+int shift_engine_process(ShiftEngine* e, const int16_t* in, int n, int16_t* out) {
+    int produced = shift_ops[e->id].process(e->ctx, in, n, out);
+    if (e->limiter) {
+        limiter_process_q15(e->limiter, out, produced, out);
+    }
+    return produced;
+}
+
+int shift_engine_flush(ShiftEngine* e, int16_t* out) {
+    int produced = shift_ops[e->id].flush(e->ctx, out);
+    if (e->limiter) {
+        // The engine's tail, then the limiter's own delay line
+        limiter_process_q15(e->limiter, out, produced, out);
+        produced += limiter_flush_q15(e->limiter, out + produced);
+    }
+    return produced;
+}
+
+void shift_engine_limiter_stats(const ShiftEngine* e, LimiterStats* stats) {
+    if (e->limiter) {
+        limiter_get_stats(e->limiter, stats);
+    } else {
+        stats->gain = stats->min_gain = 1.0f;
+        stats->clamped = 0;
+    }
+}
+
+void shift_engine_set_ratio(ShiftEngine* e, float ratio) {
+    shift_ops[e->id].set_ratio(e->ctx, ratio);
+}
+
+float shift_engine_get_ratio(const ShiftEngine* e) {
+    return shift_ops[e->id].get_ratio(e->ctx);
+}
+
+void shift_engine_set_pitch(ShiftEngine* e, float pitch) {
+    if (shift_ops[e->id].set_pitch) {
+        shift_ops[e->id].set_pitch(e->ctx, pitch);
+    }
+}
+
+int shift_engine_get_pitch(const ShiftEngine* e, float* pitch, float* confidence) {
+    *pitch = -1.0f;
+    *confidence = 0.0f;
+    if (!e->cfg.estimate_pitch || !shift_ops[e->id].get_pitch) {
+        return -1;
+    }
+    return shift_ops[e->id].get_pitch(e->ctx, pitch, confidence);
+}
+
+int shift_engine_set_ratio_curve(ShiftEngine* e, const float* curve, int frames) {
+    if (!shift_ops[e->id].set_ratio_curve) {
+        return -1;
+    }
+    return shift_ops[e->id].set_ratio_curve(e->ctx, curve, frames);
+}
@@ -0,0 +1,227 @@
+#ifndef SHIFT_ENGINE_H
+#define SHIFT_ENGINE_H
+
+#include <stdint.h>
+#include "phase_voc.h"
+#include "psola.h"
+#include "limiter.h"
+
+// One interface over the pitch shifters (phase_voc.c, psola.c), so callers
+// do not hard-wire an engine, and a selector that picks one per stream.
+//
+// Every engine reports its latency and a cost in CPU cycles per sample
+// before it is created. shift_engine_select drops the engines that do not
+// fit the caller's latency and CPU budget, then takes the cheapest one that
+// suits the signal: PSOLA only for voiced, single-voice input that is not
+// lowered much (lowering leaves gaps between its grains), the vocoder for
+// anything. If nothing fits the budget the cheapest engine is returned.
+//
+// Every engine's output can go through a look-ahead limiter (limiter.h) so
+// loud passages do not clip; its delay is part of the engine's latency.
+//
+// The cost seeds are kernel_bench results (2 GHz host, default sizes);
+// rebuild with -DSHIFT_COST_*=... or call shift_engine_set_cost with
+// numbers measured on the board.
+
+#ifndef SHIFT_COST_PV
+#define SHIFT_COST_PV               240     // Vocoder, cycles per sample (about the same at any size)
+#endif
+#ifndef SHIFT_COST_PV_LOCKED
+#define SHIFT_COST_PV_LOCKED        208     // Vocoder with identity phase locking
+#endif
+#ifndef SHIFT_COST_PV_SPECTRAL
+#define SHIFT_COST_PV_SPECTRAL      211     // Vocoder shifting bins (any ratio), per-bin phases
+#endif
+#ifndef SHIFT_COST_PSOLA
+#define SHIFT_COST_PSOLA            19      // PSOLA with the pitch supplied
+#endif
+#ifndef SHIFT_COST_PSOLA_TRACK
+#define SHIFT_COST_PSOLA_TRACK      130     // PSOLA's own Yin estimate on top
+#endif
+
+#ifndef SHIFT_COST_LIMITER
+#define SHIFT_COST_LIMITER          20      // Limiter stage on the output
+#endif
+
+#define SHIFT_SELECT_MIN_VOICING    0.8f    // Voiced fraction PSOLA needs
+#define SHIFT_SELECT_PSOLA_MIN_RATIO 0.7f   // Lowest ratio PSOLA is used for
+
+// Output room shift_engine_flush needs with the default config, any engine
+#define SHIFT_ENGINE_FLUSH_ROOM \
+    ((PV_FLUSH_ROOM(PV_DEFAULT_FFT_SIZE, PV_DEFAULT_HOP) > PSOLA_FLUSH_ROOM(PSOLA_DEFAULT_MAX_PERIOD) ? \
+      PV_FLUSH_ROOM(PV_DEFAULT_FFT_SIZE, PV_DEFAULT_HOP) : PSOLA_FLUSH_ROOM(PSOLA_DEFAULT_MAX_PERIOD)) + \
+     LIMITER_DEFAULT_LOOKAHEAD)
+
+typedef enum {
+    SHIFT_ENGINE_AUTO = -1,     // Let shift_engine_select choose
+    SHIFT_ENGINE_PV = 0,        // Phase vocoder
+    SHIFT_ENGINE_PSOLA,         // Time-domain PSOLA
+    SHIFT_ENGINE_COUNT
+} ShiftEngineId;
+
+typedef struct {
+    int fft_size;               // Vocoder frame (power of two)
+    int hop;                    // Vocoder analysis hop
+    int phase_lock;             // Vocoder identity phase locking (pv_set_phase_lock)
+    int spectral_shift;         // Vocoder shifts bins instead of stretching (pv_set_spectral_shift)
+    int max_period;             // PSOLA longest pitch period (samples)
+    int external_pitch;         // 1: the caller passes the pitch in (shift_engine_set_pitch)
+    int estimate_pitch;         // 1: the vocoder estimates each frame's pitch (shift_engine_get_pitch)
+    int limit;                  // 1: limit the output (limiter)
+    LimiterConfig limiter;
+} ShiftEngineConfig;
+
+typedef struct {
+    float ratio;                // Pitch ratio the stream starts at
+    float voicing;              // Voiced fraction of the signal, 0 .. 1 (YinSummary.voicedRatio)
+    int max_latency;            // Samples, 0 for no limit
+    uint32_t max_cycles;        // CPU cycles per sample, 0 for no limit
+} ShiftRequest;
+
+typedef struct {
+    ShiftEngineId id;
+    ShiftEngineConfig cfg;
+    void* ctx;
+    Limiter* limiter;           // NULL unless cfg.limit
+} ShiftEngine;
+
+/**
+ * Fill a config with the defaults (PV_DEFAULT_*, PV_PHASE_LOCK, PV_SPECTRAL_SHIFT,
+ * PSOLA_DEFAULT_MAX_PERIOD, internal pitch, no pitch estimate, limiter on with
+ * limiter_default_config)
+ * @param cfg         Config to fill
+ */
+void shift_engine_default_config(ShiftEngineConfig* cfg);
+
+/**
+ * @param id          Engine
+ * @return            Short name for logs ("pv", "psola")
+ */
+const char* shift_engine_name(ShiftEngineId id);
+
+/**
+ * Latency an engine would have with a config, without creating it
+ * @param id          Engine
+ * @param cfg         Config
+ * @return            Latency in samples
+ */
+int shift_engine_latency_of(ShiftEngineId id, const ShiftEngineConfig* cfg);
+
+/**
+ * Cost model: CPU cycles per sample an engine needs with a config
+ * @param id          Engine
+ * @param cfg         Config
+ * @return            Cycles per sample
+ */
+uint32_t shift_engine_cost(ShiftEngineId id, const ShiftEngineConfig* cfg);
+
+/**
+ * Replace an engine's base cost with a measured one (the PSOLA tracking
+ * cost stays SHIFT_COST_PSOLA_TRACK)
+ * @param id          Engine
+ * @param cycles      Cycles per sample
+ */
+void shift_engine_set_cost(ShiftEngineId id, uint32_t cycles);
+
+/**
+ * Pick the engine for a stream
+ * @param req         Signal and budget
+ * @param cfg         Config the engine will be created with
+ * @return            Engine to open
+ */
+ShiftEngineId shift_engine_select(const ShiftRequest* req, const ShiftEngineConfig* cfg);
+
+/**
+ * Create an engine
+ * @param e           Handle to fill
+ * @param id          Engine (not SHIFT_ENGINE_AUTO)
+ * @param cfg         Config
+ * @param ratio       Pitch ratio, clamped to 0.5 .. 2.0
+ * @return            0 on success, -1 on a bad id or allocation failure
+ */
+int shift_engine_open(ShiftEngine* e, ShiftEngineId id, const ShiftEngineConfig* cfg, float ratio);
+
+/**
+ * Free an engine (a handle that failed to open, or was closed, is ignored)
+ * @param e           Handle from shift_engine_open
+ */
+void shift_engine_close(ShiftEngine* e);
+
+/**
+ * @param e           Handle from shift_engine_open
+ * @return            Latency in samples; output i + latency corresponds to input i
+ */
+int shift_engine_latency(const ShiftEngine* e);
+
+/**
+ * Output one call can produce beyond its input (room for a direct write is n + this)
+ * @param e           Handle from shift_engine_open
+ * @return            Samples
+ */
+int shift_engine_overrun(const ShiftEngine* e);
+
+/**
+ * Push Q15 input and collect the output produced so far
+ * @param e           Handle from shift_engine_open
+ * @param in          n input samples (NULL feeds silence)
+ * @param n           Number of input samples
+ * @param out         Room for n + shift_engine_overrun() samples
+ * @return            Number of samples written to out
+ */
+int shift_engine_process(ShiftEngine* e, const int16_t* in, int n, int16_t* out);
+
+/**
+ * Drain the engine and reset it for a new stream
+ * @param e           Handle from shift_engine_open
+ * @param out         Room for SHIFT_ENGINE_FLUSH_ROOM samples (default config)
+ * @return            Number of samples written to out
+ */
+int shift_engine_flush(ShiftEngine* e, int16_t* out);
+
+/**
+ * @param e           Handle from shift_engine_open
+ * @param stats       Receives the limiter's gain and counters (all unity/zero without one)
+ */
+void shift_engine_limiter_stats(const ShiftEngine* e, LimiterStats* stats);
+
+/**
+ * Change the ratio of a running stream
+ * @param e           Handle from shift_engine_open
+ * @param ratio       New ratio, clamped to 0.5 .. 2.0
+ */
+void shift_engine_set_ratio(ShiftEngine* e, float ratio);
+
+/**
+ * @param e           Handle from shift_engine_open
+ * @return            Ratio in use (after clamping)
+ */
+float shift_engine_get_ratio(const ShiftEngine* e);
+
+/**
+ * Pass in the pitch of the newest input (external_pitch configs; the vocoder ignores it)
+ * @param e           Handle from shift_engine_open
+ * @param pitch       Pitch in Hz, <= 0 if unvoiced
+ */
+void shift_engine_set_pitch(ShiftEngine* e, float pitch);
+
+/**
+ * Pitch the engine found in its own analysis of the newest input
+ * (the vocoder with cfg.estimate_pitch; see pv_set_pitch_estimate)
+ * @param e           Handle from shift_engine_open
+ * @param pitch       Receives the pitch in Hz, -1 if none
+ * @param confidence  Receives its confidence, 0 .. 1
+ * @return            0 on success, -1 if the engine does not estimate the pitch
+ */
+int shift_engine_get_pitch(const ShiftEngine* e, float* pitch, float* confidence);
+
+/**
+ * Follow a ratio curve, one entry per cfg.hop of input (the vocoder only;
+ * see pv_set_ratio_curve)
+ * @param e           Handle from shift_engine_open
+ * @param curve       One ratio per frame, or NULL for the fixed ratio
+ * @param frames      Entries in curve
+ * @return            0 on success, -1 if the engine has no ratio curves
+ */
+int shift_engine_set_ratio_curve(ShiftEngine* e, const float* curve, int frames);
+
+#endif // SHIFT_ENGINE_H
@@ -0,0 +1,171 @@
+#include "status.h"
+#include "irq.h"
+#include "tuner_rtos.h"
+#include "xil_io.h"
+#if TUNER_RTOS
+#include "FreeRTOS.h"
+#include "timers.h"
+#else
+#include "xttcps.h"
+#endif
+
+#define STATUS_TICK_HZ          (1000 / STATUS_TICK_MS)
+#define STATUS_STEP_TICKS       (50 / STATUS_TICK_MS)   // Patterns advance in 50 ms steps
+#define STATUS_PATTERN_STEPS    20                      // ... and repeat every second
+
+// AXI GPIO interrupt registers
+#define STATUS_GPIO_GIER        0x11C
+#define STATUS_GPIO_IPISR       0x120
+#define STATUS_GPIO_IPIER       0x128
+#define STATUS_GPIO_GIE         0x80000000u
+#define STATUS_GPIO_CH1         0x1u
+
+// Bit s = LED during 50 ms step s of the one-second pattern
+static const uint32_t st_pattern[] = {
+    [STATUS_LED_OFF]    = 0x00000,
+    [STATUS_LED_ON]     = 0xFFFFF,
+    [STATUS_LED_SLOW]   = 0x003FF,
+    [STATUS_LED_MEDIUM] = 0x33333,
+    [STATUS_LED_DOUBLE] = 0x00033,
+};
+
+#if !TUNER_RTOS
+static XTtcPs st_ttc;
+#endif
+static volatile uint32_t st_ticks;
+static volatile StatusLed st_led;
+static volatile int st_pressed;             // Latched press
+static int st_led_on = -1;                  // Level last written (-1 = unknown)
+static int st_stable;                       // Debounced switch level
+static int st_count;                        // Ticks the raw level has differed from st_stable
+
+static inline uint32_t st_switch(void) {
+    return Xil_In32(STATUS_GPIO_BASEADDR + STATUS_SW_OFFSET) & 0x01;
+}
+
+static void status_step(void) {
+    uint32_t t = ++st_ticks;
+
+    int step = (t / STATUS_STEP_TICKS) % STATUS_PATTERN_STEPS;
+    int on = (st_pattern[st_led] >> step) & 1;
+    if (on != st_led_on) {
+        Xil_Out32(STATUS_GPIO_BASEADDR + STATUS_LED_OFFSET, on);
+        st_led_on = on;
+    }
+
+#if STATUS_GPIO_IRQ
+    // The edge ISR set st_stable; hold it until the contacts have settled
+    if (st_count > 0) {
+        st_count--;
+    } else {
+        st_stable = (int)st_switch();
+    }
+#else
+    if ((int)st_switch() == st_stable) {
+        st_count = 0;
+    } else if (++st_count >= STATUS_DEBOUNCE_TICKS) {
+        st_stable ^= 1;
+        st_count = 0;
+        if (st_stable) {
+            st_pressed = 1;
+        }
+    }
+#endif
+}
+
+#if TUNER_RTOS
+static void status_timer(TimerHandle_t timer) {
+    (void)timer;
+    status_step();
+}
+#else
+static void status_tick(void* ref) {
+    (void)ref;
+    XTtcPs_ClearInterruptStatus(&st_ttc, XTtcPs_GetInterruptStatus(&st_ttc));
+    status_step();
+}
+#endif
+
+#if STATUS_GPIO_IRQ
+static void status_gpio_isr(void* ref) {
+    (void)ref;
+    Xil_Out32(STATUS_GPIO_BASEADDR + STATUS_GPIO_IPISR, STATUS_GPIO_CH1);   // Toggle-on-write clear
+    if (st_count == 0 && !st_stable && st_switch()) {
+        st_pressed = 1;
+        st_stable = 1;
+        st_count = STATUS_DEBOUNCE_TICKS;
+    }
+}
+#endif
+
+int status_init(void) {
+    st_stable = (int)st_switch();   // A switch held at start-up is not a press
+    st_count = 0;
+    st_pressed = 0;
+    st_led = STATUS_LED_OFF;
+
+#if TUNER_RTOS
+    // The port's tick already uses TTC 0; a timer-service callback is plenty for an LED
+    TimerHandle_t timer = xTimerCreate("status", pdMS_TO_TICKS(STATUS_TICK_MS), pdTRUE, NULL, status_timer);
+    if (!timer || xTimerStart(timer, 0) != pdPASS) {
+        return -1;
+    }
+#else
+    XTtcPs_Config* cfg = XTtcPs_LookupConfig(STATUS_TTC_DEVICE_ID);
+    if (!cfg) {
+        return -1;
+    }
+    s32 rc = XTtcPs_CfgInitialize(&st_ttc, cfg, cfg->BaseAddress);
+    if (rc == XST_DEVICE_IS_STARTED) {
+        // Left running by a previous run of the app
+        XTtcPs_Stop(&st_ttc);
+        rc = XTtcPs_CfgInitialize(&st_ttc, cfg, cfg->BaseAddress);
+    }
+    if (rc != XST_SUCCESS) {
+        return -1;
+    }
+
+    XInterval interval;
+    u8 prescaler;
+    XTtcPs_SetOptions(&st_ttc, XTTCPS_OPTION_INTERVAL_MODE | XTTCPS_OPTION_WAVE_DISABLE);
+    XTtcPs_CalcIntervalFromFreq(&st_ttc, STATUS_TICK_HZ, &interval, &prescaler);
+    XTtcPs_SetInterval(&st_ttc, interval);
+    XTtcPs_SetPrescaler(&st_ttc, prescaler);
+
+    if (irq_connect(STATUS_TTC_IRQ_ID, status_tick, NULL) != 0) {
+        return -1;
+    }
+#endif
+#if STATUS_GPIO_IRQ
+    if (irq_connect(STATUS_GPIO_IRQ_ID, status_gpio_isr, NULL) != 0) {
+        return -1;
+    }
+    Xil_Out32(STATUS_GPIO_BASEADDR + STATUS_GPIO_IPIER, STATUS_GPIO_CH1);
+    Xil_Out32(STATUS_GPIO_BASEADDR + STATUS_GPIO_GIER, STATUS_GPIO_GIE);
+#endif
+#if !TUNER_RTOS
+    XTtcPs_EnableInterrupts(&st_ttc, XTTCPS_IXR_INTERVAL_MASK);
+    XTtcPs_Start(&st_ttc);
+#endif
+    return 0;
+}
+
+void status_set_led(StatusLed pattern) {
+    st_led = pattern;
+}
+
+int status_pressed(void) {
+    if (!st_pressed) {
+        return 0;
+    }
+    st_pressed = 0;
+    return 1;
+}
+
+void status_clear(void) {
+    st_pressed = 0;
+}
+
+uint32_t status_ticks(void) {
+    return st_ticks;
+}
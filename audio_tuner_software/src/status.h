@@ -0,0 +1,80 @@
+#ifndef STATUS_H
+#define STATUS_H
+
+#include <stdint.h>
+#include "xparameters.h"
+
+// LED patterns and the SW1 button, driven from interrupts so the main loop
+// never sleeps for them.
+//
+// A TTC channel (a FreeRTOS timer in the TUNER_RTOS build) ticks every
+// STATUS_TICK_MS. The tick steps the LED through the selected pattern, so a
+// blink keeps its rhythm however long the pipeline stage under it runs, and
+// samples the switch: a press counts once SW1 has read 1 for
+// STATUS_DEBOUNCE_TICKS ticks in a row after reading 0.
+// With STATUS_GPIO_IRQ=1 (needs the AXI GPIO ip2intc_irpt routed to the PS
+// in the block design) the edge is taken from the GPIO interrupt instead and
+// the tick only holds off the bounce that follows.
+//
+// A press is latched until status_pressed() consumes it. Stages that run
+// to completion without looking at the button call status_clear() when
+// they finish, so a press made during them does not skip the next state.
+
+#ifndef STATUS_GPIO_IRQ
+#define STATUS_GPIO_IRQ         0
+#endif
+
+#define STATUS_GPIO_BASEADDR    XPAR_AXI_GPIO_0_BASEADDR
+#define STATUS_LED_OFFSET       0x00    // LED channel offset
+#define STATUS_SW_OFFSET        0x04    // Switch channel offset
+
+#ifndef STATUS_TTC_DEVICE_ID
+#define STATUS_TTC_DEVICE_ID    XPAR_XTTCPS_0_DEVICE_ID
+#endif
+#ifndef STATUS_TTC_IRQ_ID
+#define STATUS_TTC_IRQ_ID       XPAR_XTTCPS_0_INTR
+#endif
+#ifndef STATUS_GPIO_IRQ_ID
+#define STATUS_GPIO_IRQ_ID      XPAR_FABRIC_AXI_GPIO_0_IP2INTC_IRPT_INTR
+#endif
+
+#define STATUS_TICK_MS          10
+#define STATUS_DEBOUNCE_TICKS   3       // 30 ms stable before a press counts
+
+typedef enum {
+    STATUS_LED_OFF,
+    STATUS_LED_ON,
+    STATUS_LED_SLOW,            // 500 ms on / 500 ms off
+    STATUS_LED_MEDIUM,          // 100 ms on / 100 ms off
+    STATUS_LED_DOUBLE,          // Two 100 ms flashes per second
+} StatusLed;
+
+/**
+ * Start the tick timer (and the switch interrupt with STATUS_GPIO_IRQ)
+ * @return           0 on success, -1 if the timer or an interrupt could not be set up
+ */
+int status_init(void);
+
+/**
+ * Select the LED pattern; takes effect on the next tick
+ * @param pattern    Pattern to show
+ */
+void status_set_led(StatusLed pattern);
+
+/**
+ * Consume a latched button press
+ * @return           1 if SW1 was pressed since the last call (or status_clear), else 0
+ */
+int status_pressed(void);
+
+/**
+ * Drop a press latched while the caller was not listening
+ */
+void status_clear(void);
+
+/**
+ * @return           Ticks since status_init (STATUS_TICK_MS each)
+ */
+uint32_t status_ticks(void);
+
+#endif // STATUS_H
@@ -0,0 +1,528 @@
+#include <stdio.h>
+#include <string.h>
+#include "take_pipe.h"
+#include "capture.h"
+#include "playback.h"
+#include "shift_engine.h"
+#include "scale.h"
+#include "YinAnalysis.h"
+#include "sd_sink.h"
+#include "fixed_point.h"
+#include "dlog.h"
+#include "xtime_l.h"
+
+#define TP_PATH             80
+#define TP_MEM              __attribute__((section(".take_buf"), aligned(64)))
+
+#if SD_SINK_FILES < 2
+#error "a take's rec and out files are queued together"
+#endif
+
+typedef enum {
+    TP_FREE,                    // Slot holds nothing
+    TP_RECORDING,               // Capture is filling it
+    TP_RECORDED,                // Waiting for the shifter
+    TP_SHIFTING,                // The shifter is filling its output
+    TP_DONE,                    // Waiting for (or being) played and saved
+} TakePipeState;
+
+typedef struct {
+    TakePipeState state;
+    uint32_t seq;               // Take number since start, for the stage order
+    int number;                 // NNN of its files
+    uint32_t samples;
+    float pitch;                // Histogram pitch of the grid, 0 if none
+    float voicing;
+    int to_play;                // Still to be sent to the speaker
+    int to_save;                // Still to be queued to the SD sink
+    int saving;                 // Its files are in the SD sink queue
+} TakePipeSlot;
+
+// Slot k's take and its shifted copy; both stay put until the slot is free
+static int16_t tp_in[TAKE_PIPE_SLOTS][TAKE_PIPE_MAX_SAMPLES] TP_MEM;
+static int16_t tp_out[TAKE_PIPE_SLOTS][TAKE_PIPE_MAX_SAMPLES] TP_MEM;
+static int16_t tp_stage[TAKE_PIPE_CHUNK + SHIFT_ENGINE_FLUSH_ROOM];
+static TakePipeSlot tp_slot[TAKE_PIPE_SLOTS];
+
+static XAxiDma* tp_dma;
+static TakePipeConfig tp_cfg;
+static TakePipeStats tp_stats;
+static XTime tp_t0;
+static uint32_t tp_seq;         // Takes started
+static int tp_number;           // NNN of the next take
+
+// Record stage
+static int tp_rec = -1;         // Slot being recorded, -1 while stalled or stopped
+static int tp_capturing;
+static int tp_stalled;
+static YinAnalysis tp_yin;
+static int tp_yin_ok;
+
+// Shift stage
+static int tp_shift = -1;       // Slot being shifted
+static ShiftEngine tp_eng;
+static int tp_skip;             // Latency samples still to drop
+static uint32_t tp_in_pos;
+static uint32_t tp_out_pos;
+
+// Play stage
+static int tp_play = -1;        // Slot being played
+static uint32_t tp_play_pos;
+static int tp_pb_started;
+static uint32_t tp_pb_underruns;    // Engine count when the take's first buffer went out
+
+void take_pipe_default_config(TakePipeConfig* cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->take_samples = TAKE_PIPE_MAX_SAMPLES;
+    cfg->engine = SHIFT_ENGINE_AUTO;
+    cfg->window = 1024;
+    cfg->hop = 48000 / 8;
+    cfg->max_windows = 256;
+    cfg->threshold = 0.15f;
+    cfg->play = 1;
+    cfg->first_take = 1;
+    cfg->rec_bits = 16;
+}
+
+// Oldest slot in a state, -1 if none
+static int tp_oldest(TakePipeState state) {
+    int best = -1;
+    for (int k = 0; k < TAKE_PIPE_SLOTS; k++) {
+        if (tp_slot[k].state == state && (best < 0 || tp_slot[k].seq < tp_slot[best].seq)) {
+            best = k;
+        }
+    }
+    return best;
+}
+
+// Oldest finished take still to be played (play) or saved (!play), -1 if none
+static int tp_oldest_done(int play) {
+    int best = -1;
+    for (int k = 0; k < TAKE_PIPE_SLOTS; k++) {
+        const TakePipeSlot* t = &tp_slot[k];
+        if (t->state == TP_DONE && (play ? t->to_play : t->to_save) &&
+            (best < 0 || t->seq < tp_slot[best].seq)) {
+            best = k;
+        }
+    }
+    return best;
+}
+
+static void tp_release_if_done(int k) {
+    TakePipeSlot* t = &tp_slot[k];
+    if (t->state == TP_DONE && !t->to_play && !t->to_save && !t->saving) {
+        t->state = TP_FREE;
+    }
+}
+
+/*** Record stage: every burst that has arrived ***/
+
+// Start the next take in a free slot; 0 if there is none (recording stalls)
+static int tp_record_begin(void) {
+    int k = tp_oldest(TP_FREE);
+    if (k < 0) {
+        return 0;
+    }
+    TakePipeSlot* t = &tp_slot[k];
+    memset(t, 0, sizeof(*t));
+    t->state = TP_RECORDING;
+    t->seq = tp_seq++;
+    t->number = tp_number;
+    tp_number = tp_number == 999 ? 1 : tp_number + 1;
+    tp_yin_ok = YinAnalysis_init(&tp_yin, tp_cfg.window, tp_cfg.hop, 0, tp_cfg.max_windows,
+                                 tp_cfg.threshold) == 0;
+    if (!tp_yin_ok) {
+        DLOG_WARN("Pipe: no memory for take %d's pitch grid; it is kept unshifted\r\n", t->number);
+    }
+    tp_rec = k;
+    return 1;
+}
+
+// The take is complete: summarise its grid and queue it for the shifter
+static void tp_record_end(void) {
+    TakePipeSlot* t = &tp_slot[tp_rec];
+    if (tp_yin_ok) {
+        YinSummary sum;
+        YinAnalysis_summarise(&tp_yin, &sum);
+        if (sum.voiced > 0) {
+            t->pitch = sum.histogramPitch;
+            t->voicing = sum.voicedRatio;
+        }
+        YinAnalysis_free(&tp_yin);
+        tp_yin_ok = 0;
+    }
+    t->state = TP_RECORDED;
+    tp_rec = -1;
+    tp_stats.recorded++;
+
+    uint32_t backlog = 0;
+    for (int k = 0; k < TAKE_PIPE_SLOTS; k++) {
+        backlog += tp_slot[k].state == TP_RECORDED;
+    }
+    if (backlog > tp_stats.max_backlog) tp_stats.max_backlog = backlog;
+}
+
+static int tp_record_step(void) {
+    const uint32_t* rx;
+    int got;
+    int work = 0;
+
+    while (tp_capturing && (got = capture_next(&rx)) != 0) {
+        if (got < 0) {
+            return -1;
+        }
+        work = 1;
+        if (tp_rec < 0 && !tp_record_begin()) {
+            // Backpressure: every slot is still in use downstream
+            if (!tp_stalled) {
+                tp_stalled = 1;
+                tp_stats.stalls++;
+            }
+            tp_stats.stalled_samples += CAPTURE_BURST_SAMPLES;
+            capture_release();
+            continue;
+        }
+        tp_stalled = 0;
+
+        TakePipeSlot* t = &tp_slot[tp_rec];
+        uint32_t n = tp_cfg.take_samples - t->samples;
+        if (n > CAPTURE_BURST_SAMPLES) n = CAPTURE_BURST_SAMPLES;
+        int16_t* pcm = tp_in[tp_rec] + t->samples;
+#if CAPTURE_PL_PACK
+        memcpy(pcm, rx, n * sizeof(int16_t));
+#else
+        pcm_from_capture(rx, pcm, (int)n);
+#endif
+        capture_release();
+        if (tp_yin_ok) {
+            YinAnalysis_push(&tp_yin, pcm, (int)n);
+        }
+        t->samples += n;
+        if (t->samples == tp_cfg.take_samples) {
+            tp_record_end();
+        }
+    }
+    return work;
+}
+
+/*** Shift stage: one chunk per step ***/
+
+static void tp_shift_end(TakePipeSlot* t) {
+    t->state = TP_DONE;
+    t->to_play = tp_cfg.play;
+    t->to_save = tp_cfg.dir != NULL;
+    tp_shift = -1;
+    tp_stats.shifted++;
+    tp_release_if_done((int)(t - tp_slot));
+}
+
+// Pass a take on as it was recorded
+static void tp_shift_skip(TakePipeSlot* t, const char* why) {
+    DLOG_INFO("Pipe: take %d: %s, kept unshifted\r\n", t->number, why);
+    memcpy(tp_out[t - tp_slot], tp_in[t - tp_slot], t->samples * sizeof(int16_t));
+    tp_stats.unshifted++;
+    tp_shift_end(t);
+}
+
+static int tp_shift_start(void) {
+    int k = tp_oldest(TP_RECORDED);
+    if (k < 0) {
+        return 0;
+    }
+    TakePipeSlot* t = &tp_slot[k];
+    tp_shift = k;
+    t->state = TP_SHIFTING;
+
+    float target = t->pitch > 0.0f ?
+                   scale_reference_target(t->pitch, tp_cfg.ref_pitch, tp_cfg.ref_note_class) : 0.0f;
+    if (target <= 0.0f) {
+        tp_shift_skip(t, t->pitch > 0.0f ? "no target note" : "no pitch found");
+        return 1;
+    }
+    float ratio = target / t->pitch;
+    if (ratio > 2.0f) ratio = 2.0f;
+    if (ratio < 0.5f) ratio = 0.5f;
+
+    ShiftRequest req = { ratio, t->voicing, 0, 0 };
+    ShiftEngineConfig scfg;
+    shift_engine_default_config(&scfg);
+    ShiftEngineId id = tp_cfg.engine == SHIFT_ENGINE_AUTO ? shift_engine_select(&req, &scfg)
+                                                          : (ShiftEngineId)tp_cfg.engine;
+    if (shift_engine_open(&tp_eng, id, &scfg, ratio) != 0) {
+        tp_shift_skip(t, "no memory for the shifter");
+        return 1;
+    }
+    DLOG_INFO("Pipe: take %d: %.2f Hz -> %.2f Hz (%s, %d%% voiced)\r\n", t->number, t->pitch, target,
+              shift_engine_name(id), (int)(t->voicing * 100.0f));
+    tp_skip = shift_engine_latency(&tp_eng);
+    tp_in_pos = 0;
+    tp_out_pos = 0;
+    return 1;
+}
+
+static int tp_shift_step(void) {
+    if (tp_shift < 0) {
+        return tp_shift_start();
+    }
+
+    TakePipeSlot* t = &tp_slot[tp_shift];
+    const int16_t* in = tp_in[tp_shift];
+    int16_t* out = tp_out[tp_shift];
+    int16_t* dst = tp_stage;
+    int produced;
+
+    if (tp_in_pos < t->samples) {
+        uint32_t n = t->samples - tp_in_pos;
+        if (n > TAKE_PIPE_CHUNK) n = TAKE_PIPE_CHUNK;
+        // Past the latency the shifter writes straight into the output take
+        if (tp_skip == 0 && t->samples - tp_out_pos >= n + shift_engine_overrun(&tp_eng)) {
+            dst = out + tp_out_pos;
+        }
+        produced = shift_engine_process(&tp_eng, in + tp_in_pos, (int)n, dst);
+        tp_in_pos += n;
+    } else {
+        produced = shift_engine_flush(&tp_eng, tp_stage);
+        if (produced == 0) {
+            memset(out + tp_out_pos, 0, (t->samples - tp_out_pos) * sizeof(int16_t));
+            tp_out_pos = t->samples;
+        }
+    }
+
+    // Drop the latency and anything past the input length
+    int first = 0;
+    if (tp_skip > 0) {
+        first = tp_skip < produced ? tp_skip : produced;
+        tp_skip -= first;
+    }
+    int count = produced - first;
+    if (count > (int)(t->samples - tp_out_pos)) {
+        count = (int)(t->samples - tp_out_pos);
+    }
+    if (count > 0) {
+        if (dst != out + tp_out_pos) {
+            memcpy(out + tp_out_pos, dst + first, count * sizeof(int16_t));
+        }
+        tp_out_pos += count;
+    }
+    if (tp_out_pos == t->samples) {
+        shift_engine_close(&tp_eng);
+        tp_shift_end(t);
+    }
+    return 1;
+}
+
+/*** Play stage: every free playback buffer ***/
+
+static int tp_play_step(void) {
+    uint32_t* words;
+    int work = 0;
+
+    if (tp_play < 0) {
+        int k = tp_oldest_done(1);
+        if (k < 0) {
+            // Keep the queue moving while the last take drains
+            return tp_pb_started && playback_acquire(&words) < 0 ? -1 : 0;
+        }
+        if (!tp_pb_started) {
+            playback_start(tp_dma);
+            tp_pb_started = 1;
+        }
+        tp_play = k;
+        tp_play_pos = 0;
+    }
+
+    TakePipeSlot* t = &tp_slot[tp_play];
+    while (tp_play_pos < t->samples) {
+        int got = playback_acquire(&words);
+        if (got < 0) {
+            return -1;
+        }
+        if (got == 0) {
+            break;
+        }
+        uint32_t n = t->samples - tp_play_pos;
+        if (n > PLAYBACK_SAMPLES) n = PLAYBACK_SAMPLES;
+        playback_submit(playback_fill(words, tp_out[tp_play] + tp_play_pos, (int)n));
+        // The speaker ran dry between takes; only what happens inside a take counts
+        if (tp_play_pos == 0) {
+            PlaybackStats ps;
+            playback_get_stats(&ps);
+            tp_pb_underruns = ps.underruns;
+        }
+        tp_play_pos += n;
+        work = 1;
+    }
+    if (tp_play_pos == t->samples) {
+        PlaybackStats ps;
+        playback_get_stats(&ps);
+        tp_stats.underruns += ps.underruns - tp_pb_underruns;
+        tp_stats.played++;
+        t->to_play = 0;
+        tp_release_if_done(tp_play);
+        tp_play = -1;
+    }
+    return work;
+}
+
+/*** Save stage: one SD sink block per step ***/
+
+static int tp_save_step(void) {
+    int work = sd_sink_step();
+    if (work) {
+        return 1;
+    }
+
+    // The sink is idle: the take it was writing is on the card
+    for (int k = 0; k < TAKE_PIPE_SLOTS; k++) {
+        if (tp_slot[k].saving) {
+            int failed = sd_sink_flush();
+            if (failed) {
+                DLOG_ERROR("Pipe: take %d: %d file(s) not saved\r\n", tp_slot[k].number, failed);
+                tp_stats.save_failed++;
+            } else {
+                tp_stats.saved++;
+            }
+            tp_slot[k].saving = 0;
+            tp_release_if_done(k);
+        }
+    }
+
+    int k = tp_oldest_done(0);
+    if (k < 0) {
+        return 0;
+    }
+    TakePipeSlot* t = &tp_slot[k];
+    char path[TP_PATH];
+    int err;
+    snprintf(path, sizeof(path), "%s/rec_%03d.wav", tp_cfg.dir, t->number);
+    err = sd_sink_add(path, tp_in[k], t->samples, CAPTURE_FS, tp_cfg.rec_bits);
+    snprintf(path, sizeof(path), "%s/out_%03d.wav", tp_cfg.dir, t->number);
+    err |= sd_sink_add(path, tp_out[k], t->samples, CAPTURE_FS, 16);
+    if (err) {
+        DLOG_ERROR("Pipe: take %d: cannot queue its files\r\n", t->number);
+        tp_stats.save_failed++;
+    } else {
+        t->saving = 1;
+    }
+    t->to_save = 0;
+    tp_release_if_done(k);
+    return 1;
+}
+
+/*** Pipeline ***/
+
+int take_pipe_start(XAxiDma* dma, const TakePipeConfig* cfg) {
+    if (cfg->take_samples < CAPTURE_BURST_SAMPLES || cfg->take_samples > TAKE_PIPE_MAX_SAMPLES ||
+        cfg->ref_pitch <= 0.0f || cfg->window < 2 || cfg->hop < 1 || cfg->max_windows < 1) {
+        return -1;
+    }
+    if (sd_sink_flush() != 0) {
+        DLOG_WARN("Pipe: files queued before the run were not all saved\r\n");
+    }
+
+    tp_dma = dma;
+    tp_cfg = *cfg;
+    memset(&tp_stats, 0, sizeof(tp_stats));
+    memset(tp_slot, 0, sizeof(tp_slot));
+    tp_seq = 0;
+    tp_number = cfg->first_take >= 1 && cfg->first_take <= 999 ? cfg->first_take : 1;
+    tp_rec = tp_shift = tp_play = -1;
+    tp_stalled = 0;
+    tp_pb_started = 0;
+    tp_record_begin();
+
+    if (capture_start() != 0) {
+        YinAnalysis_free(&tp_yin);
+        tp_yin_ok = 0;
+        return -1;
+    }
+    tp_capturing = 1;
+    XTime_GetTime(&tp_t0);
+    return 0;
+}
+
+int take_pipe_step(void) {
+    int r = tp_record_step();
+    if (r < 0) {
+        return -1;
+    }
+    int work = r;
+
+    r = tp_play_step();
+    if (r < 0) {
+        return -1;
+    }
+    work |= r;
+
+    XTime t0, t1;
+    XTime_GetTime(&t0);
+    work |= tp_shift_step();
+    XTime_GetTime(&t1);
+    tp_stats.shift_us += (uint64_t)(t1 - t0) * 1000000 / COUNTS_PER_SECOND;
+
+    if (tp_cfg.dir) {
+        work |= tp_save_step();
+    }
+    tp_stats.elapsed_us = (uint64_t)(t1 - tp_t0) * 1000000 / COUNTS_PER_SECOND;
+    return work;
+}
+
+int take_pipe_stalled(void) {
+    return tp_stalled;
+}
+
+int take_pipe_stop(void) {
+    int err = 0;
+    capture_stop();
+    tp_capturing = 0;
+    tp_stalled = 0;
+
+    // A take cut short goes on if it can be analysed; otherwise it is dropped
+    if (tp_rec >= 0) {
+        if (tp_slot[tp_rec].samples >= (uint32_t)tp_cfg.window) {
+            tp_record_end();
+        } else {
+            YinAnalysis_free(&tp_yin);
+            tp_yin_ok = 0;
+            tp_slot[tp_rec].state = TP_FREE;
+            tp_rec = -1;
+        }
+    }
+
+    // Everything left in the pool
+    for (;;) {
+        int busy = 0;
+        for (int k = 0; k < TAKE_PIPE_SLOTS; k++) {
+            busy |= tp_slot[k].state != TP_FREE;
+        }
+        if (!busy) break;
+        if (take_pipe_step() < 0) {
+            err = -1;
+            break;
+        }
+    }
+    if (tp_shift >= 0) {
+        shift_engine_close(&tp_eng);
+        tp_shift = -1;
+    }
+    if (tp_pb_started && playback_finish() != 0) {
+        err = -1;
+    }
+    tp_pb_started = 0;
+
+    CaptureStats cs;
+    capture_get_stats(&cs);
+    if (cs.dma_errors) {
+        err = -1;
+    }
+    tp_stats.lost_samples = cs.lost_samples;
+    return err;
+}
+
+void take_pipe_get_stats(TakePipeStats* stats) {
+    *stats = tp_stats;
+}
+
+float take_pipe_takes_per_minute(const TakePipeStats* stats) {
+    return stats->elapsed_us ? stats->recorded * 60e6f / (float)stats->elapsed_us : 0.0f;
+}
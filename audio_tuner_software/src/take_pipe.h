@@ -0,0 +1,122 @@
+#ifndef TAKE_PIPE_H
+#define TAKE_PIPE_H
+
+#include <stdint.h>
+#include "xaxidma.h"
+
+// Back-to-back takes for rehearsal. The mic never stops: while one take is
+// being recorded, the one before it is shifted and the one before that is
+// played and saved.
+//
+//   record (+ Yin grid per burst) -> shift -> play
+//                                          \-> save (SD sink)
+//
+// Takes live in a pool of TAKE_PIPE_SLOTS slots, each holding a take and
+// its shifted copy. A slot is recorded into, waits for the shifter, is
+// shifted a chunk at a time, then waits for the speaker and the card, and
+// goes back to the pool once it has been played and written. Every stage
+// works through the slots in take order.
+//
+// take_pipe_step() services the capture ring first on every call: the bursts
+// that have arrived are converted into the slot being recorded. Then every
+// other stage gets one bounded step: the free playback buffers are filled,
+// one chunk goes through the shifter, one block goes to the card. The stages
+// take turns on one core; the capture ring and the PL FIFO hold about a
+// quarter of a second, far more than a step takes. With PV_MULTICORE the
+// vocoder's frames still run on the worker cores.
+//
+// Backpressure: when a take ends and no slot is free (the shifter or the
+// card has fallen behind), the next take does not start. The mic's bursts
+// are dropped and counted until a slot comes back, and the next take starts
+// on the burst after that. The stats say how often and for how long
+// recording waited, and how many takes a minute the pipeline sustained.
+//
+// A take's target is the one a recorded take gets against target.wav
+// (scale_reference_target); a take with no pitch is played and saved
+// unshifted.
+
+#define TAKE_PIPE_SLOTS         3       // Recording, shifting, playing / saving
+#ifndef TAKE_PIPE_MAX_SAMPLES
+#define TAKE_PIPE_MAX_SAMPLES   (10 * 48000)    // Longest take (10 s at 48 kHz; 5.5 MB of slots)
+#endif
+#define TAKE_PIPE_CHUNK         1024    // Samples per shifter call
+
+typedef struct {
+    uint32_t take_samples;      // Samples per take (<= TAKE_PIPE_MAX_SAMPLES)
+    float ref_pitch;            // Reference pitch in Hz (target.wav)
+    int ref_note_class;         // Its pitch class, 0 = C
+    int engine;                 // ShiftEngineId; SHIFT_ENGINE_AUTO picks one per take
+    int window;                 // Yin window (samples)
+    int hop;                    // Samples between windows
+    int max_windows;            // Windows per take
+    float threshold;            // Yin threshold
+    int play;                   // 1: play every take once it is shifted
+    const char* dir;            // Save rec_NNN.wav / out_NNN.wav here; NULL keeps takes in DDR only
+    int first_take;             // NNN of the first take (1 .. 999, wraps)
+    uint16_t rec_bits;          // 16, or WAV_BITS_ADPCM for the rec files
+} TakePipeConfig;
+
+typedef struct {
+    uint32_t recorded;          // Takes captured
+    uint32_t shifted;           // Takes through the shift stage (unshifted ones included)
+    uint32_t unshifted;         // No pitch, no target or no shifter: passed on as recorded
+    uint32_t played;            // Takes sent to the speaker
+    uint32_t saved;             // Takes whose two files were written
+    uint32_t save_failed;       // Takes with a file that could not be written
+    uint32_t stalls;            // Takes that had to wait for a free slot
+    uint32_t stalled_samples;   // Mic samples dropped while waiting
+    uint32_t max_backlog;       // Most takes waiting for the shifter at once
+    uint32_t lost_samples;      // From the capture engine
+    uint32_t underruns;         // From the playback engine, inside takes only
+    uint64_t elapsed_us;        // From take_pipe_start to the last step
+    uint64_t shift_us;          // Time in the shift stage
+} TakePipeStats;
+
+/**
+ * Fill a config with the defaults: 16-bit takes of TAKE_PIPE_MAX_SAMPLES,
+ * played and kept in DDR only, the shifter picked per take, 1024-sample
+ * windows every 1/8 s (48 kHz), up to 256 windows, threshold 0.15.
+ * ref_pitch and ref_note_class are left to the caller.
+ * @param cfg        Config to fill
+ */
+void take_pipe_default_config(TakePipeConfig* cfg);
+
+/**
+ * Start capture and the first take. capture_init must have been called on
+ * the same DMA; with cfg->dir set, the card must be mounted.
+ * @param dma        Initialised simple-mode DMA (both channels)
+ * @param cfg        Config (copied; ref_pitch > 0)
+ * @return           0 on success, -1 on a bad config, allocation or DMA failure
+ */
+int take_pipe_start(XAxiDma* dma, const TakePipeConfig* cfg);
+
+/**
+ * Take in the bursts that have arrived, then give every other stage one step
+ * @return           1 if any stage did work, 0 if all were idle, -1 on a DMA error
+ */
+int take_pipe_step(void);
+
+/**
+ * @return           1 while recording waits for a free slot (backpressure), else 0
+ */
+int take_pipe_stalled(void);
+
+/**
+ * Stop capture (a take cut short is kept if it holds a Yin window), then
+ * shift, play and save every take still in the pool
+ * @return           0 on success, -1 if a DMA channel reported an error
+ */
+int take_pipe_stop(void);
+
+/**
+ * @param stats      Receives the counters since take_pipe_start
+ */
+void take_pipe_get_stats(TakePipeStats* stats);
+
+/**
+ * @param stats      Counters from take_pipe_get_stats
+ * @return           Takes recorded per minute of wall time
+ */
+float take_pipe_takes_per_minute(const TakePipeStats* stats);
+
+#endif // TAKE_PIPE_H
@@ -0,0 +1,403 @@
+#include "tuner_rtos.h"
+
+#if TUNER_RTOS
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "xaxidma.h"
+#include "xil_printf.h"
+#include "xparameters.h"
+#include "ff.h"
+#include "capture.h"
+#include "playback.h"
+#include "dma_mem.h"
+#include "status.h"
+#include "live_tune.h"
+#include "phase_voc.h"
+#include "YinTracker.h"
+#include "wav_writer.h"
+#include "fixed_point.h"
+
+#define RT_N                CAPTURE_BURST_SAMPLES
+#define RT_OUT_MAX          (RT_N + LIVE_TUNE_MAX_HOP + 1)
+#define RT_BURST_MS         (RT_N * 1000 / CAPTURE_FS)
+#define RT_MAX_TASKS        12      // Ours plus idle and the timer service
+
+typedef struct {
+    int16_t in[RT_N];               // Capture burst
+    int16_t out[RT_OUT_MAX];        // Vocoder output for it
+    int n_out;
+    float ratio;                    // Set by analysis, applied by synthesis
+} RtBlock;
+
+typedef struct {
+    QueueHandle_t q;
+    const char* name;
+    UBaseType_t size;
+    UBaseType_t high;               // Most blocks ever waiting
+    uint32_t refused;               // Sends that found it full
+} RtQueue;
+
+enum { RQ_FREE, RQ_ANALYSIS, RQ_SYNTH, RQ_PLAY, RQ_STORE, RQ_COUNT };
+
+static RtQueue rt_q[RQ_COUNT] = {
+    [RQ_FREE]     = { NULL, "free",      TUNER_RTOS_BLOCKS },
+    [RQ_ANALYSIS] = { NULL, "analysis",  TUNER_RTOS_BLOCKS },
+    [RQ_SYNTH]    = { NULL, "synthesis", TUNER_RTOS_BLOCKS },
+    [RQ_PLAY]     = { NULL, "playback",  TUNER_RTOS_BLOCKS },
+    [RQ_STORE]    = { NULL, "storage",   TUNER_RTOS_STORE_QUEUE },
+};
+
+static RtBlock rt_block[TUNER_RTOS_BLOCKS];
+static QueueHandle_t rt_logq;
+static TaskHandle_t rt_tasks[6];
+
+static XAxiDma rt_dma;
+static FATFS rt_fs;
+static LiveTuneConfig rt_cfg;
+static YinTracker rt_tracker;
+static PhaseVocoder* rt_pv;
+
+static volatile int rt_recording;           // Toggled by SW1, followed by the storage task
+static volatile float rt_pitch = -1.0f;     // Latest tracked pitch (for the report)
+static volatile uint32_t rt_cap_drops;      // Bursts with no free block
+static volatile uint32_t rt_play_drops;     // Blocks with no playback buffer in time
+static volatile uint32_t rt_store_skipped;  // Blocks not recorded because storage was behind
+static volatile uint32_t rt_stored;         // Samples written while recording
+static volatile uint32_t rt_log_dropped;
+
+void rt_log(const char* fmt, ...) {
+    char line[TUNER_RTOS_LOG_LINE];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (!rt_logq || xQueueSend(rt_logq, line, 0) != pdPASS) {
+        rt_log_dropped++;
+    }
+}
+
+// Never blocks: every queue but storage holds all the blocks there are
+static int rt_send(int qi, uint8_t b) {
+    RtQueue* q = &rt_q[qi];
+    if (xQueueSend(q->q, &b, 0) != pdPASS) {
+        q->refused++;
+        return -1;
+    }
+    taskENTER_CRITICAL();
+    UBaseType_t waiting = uxQueueMessagesWaiting(q->q);
+    if (waiting > q->high) q->high = waiting;
+    taskEXIT_CRITICAL();
+    return 0;
+}
+
+static uint8_t rt_receive(int qi) {
+    uint8_t b;
+    while (xQueueReceive(rt_q[qi].q, &b, portMAX_DELAY) != pdPASS) { }
+    return b;
+}
+
+// Parks a task whose DMA channel stopped; the others keep running
+static void rt_park(const char* what) {
+    rt_log("%s DMA error; task stopped (reset the board)\r\n", what);
+    for (;;) {
+        vTaskDelay(portMAX_DELAY);
+    }
+}
+
+/*** Capture: drain the ring, one block per burst ***/
+static void rt_capture_task(void* arg) {
+    (void)arg;
+    if (capture_start() != 0) {
+        rt_park("Capture");
+    }
+    for (;;) {
+        const uint32_t* rx;
+        int got = capture_next(&rx);
+        if (got < 0) {
+            capture_stop();
+            rt_park("Capture");
+        }
+        if (got == 0) {
+            vTaskDelay(1);      // The ring and PL FIFO cover far more than a tick
+            continue;
+        }
+
+        uint8_t b;
+        if (xQueueReceive(rt_q[RQ_FREE].q, &b, 0) != pdPASS) {
+            rt_cap_drops++;
+            capture_release();
+            continue;
+        }
+#if CAPTURE_PL_PACK
+        memcpy(rt_block[b].in, rx, sizeof(rt_block[b].in));
+#else
+        pcm_from_capture(rx, rt_block[b].in, RT_N);
+#endif
+        capture_release();
+        rt_send(RQ_ANALYSIS, b);
+    }
+}
+
+/*** Analysis: track the pitch and pick the ratio (as live_tune.c) ***/
+static void rt_analysis_task(void* arg) {
+    (void)arg;
+    float ratio = 1.0f;
+    for (;;) {
+        uint8_t b = rt_receive(RQ_ANALYSIS);
+        float pitch = YinTracker_push(&rt_tracker, rt_block[b].in, RT_N);
+        float target = 1.0f;
+        if (pitch > 0.0f && YinTracker_getProbability(&rt_tracker) >= rt_cfg.min_probability) {
+            target = live_tune_note_ratio(pitch);
+        }
+        ratio += (target - ratio) * rt_cfg.glide;
+        rt_block[b].ratio = ratio;
+        rt_pitch = pitch;
+        rt_send(RQ_SYNTH, b);
+    }
+}
+
+/*** Synthesis: streaming vocoder ***/
+static void rt_synthesis_task(void* arg) {
+    (void)arg;
+    float set_ratio = 1.0f;
+    for (;;) {
+        uint8_t b = rt_receive(RQ_SYNTH);
+        RtBlock* blk = &rt_block[b];
+        if (fabsf(blk->ratio - set_ratio) > LIVE_TUNE_RETUNE_STEP * set_ratio) {
+            pv_set_ratio(rt_pv, blk->ratio);
+            set_ratio = pv_get_ratio(rt_pv);
+        }
+        blk->n_out = pv_process_q15(rt_pv, blk->in, RT_N, blk->out);
+        rt_send(RQ_PLAY, b);
+    }
+}
+
+/*** Playback: queue to MM2S, then hand the block to storage or back to the pool ***/
+static void rt_playback_task(void* arg) {
+    (void)arg;
+    static const int16_t preroll[LIVE_TUNE_MAX_HOP];
+    uint32_t* words;
+    int started = 0;
+
+    playback_start(&rt_dma);
+    for (;;) {
+        uint8_t b;
+        if (xQueueReceive(rt_q[RQ_PLAY].q, &b, 1) != pdPASS) {
+            // Retire the transfer in flight and arm the next one
+            if (started && playback_acquire(&words) < 0) {
+                rt_park("Playback");
+            }
+            continue;
+        }
+        if (!started) {
+            // Jitter cushion for the task hand-offs
+            if (playback_acquire(&words) > 0) {
+                playback_submit(playback_fill(words, preroll, LIVE_TUNE_MAX_HOP));
+            }
+            started = 1;
+        }
+
+        RtBlock* blk = &rt_block[b];
+        TickType_t t0 = xTaskGetTickCount();
+        int got;
+        while ((got = playback_acquire(&words)) == 0 &&
+               xTaskGetTickCount() - t0 < pdMS_TO_TICKS(RT_BURST_MS)) {
+            vTaskDelay(1);
+        }
+        if (got < 0) {
+            rt_park("Playback");
+        }
+        if (got > 0) {
+            playback_submit(playback_fill(words, blk->out, blk->n_out));
+        } else {
+            rt_play_drops++;
+        }
+
+        if (!rt_recording || rt_send(RQ_STORE, b) != 0) {
+            if (rt_recording) rt_store_skipped++;
+            rt_send(RQ_FREE, b);
+        }
+    }
+}
+
+/*** Storage: the shifted stream to live_NNN.wav while recording is on ***/
+static void rt_storage_task(void* arg) {
+    (void)arg;
+    static WavWriter wav;
+    int open = 0;
+    unsigned files = 0;
+
+    for (;;) {
+        uint8_t b;
+        int have = xQueueReceive(rt_q[RQ_STORE].q, &b, pdMS_TO_TICKS(20)) == pdPASS;
+
+        if (rt_recording && !open) {
+            char path[32];
+            snprintf(path, sizeof(path), "0:/live_%03u.wav", ++files % 1000);
+            if (f_mount(&rt_fs, "0:", 1) != FR_OK ||
+                wav_writer_open(&wav, path, TUNER_RTOS_RECORD_SECONDS * CAPTURE_FS,
+                                CAPTURE_FS, 16, 1) != FR_OK) {
+                rt_log("Cannot open %s; recording off\r\n", path);
+                rt_recording = 0;
+            } else {
+                rt_log("Recording %s\r\n", path);
+                open = 1;
+            }
+        }
+
+        if (have) {
+            if (open && wav_writer_write(&wav, rt_block[b].out, rt_block[b].n_out) == FR_OK) {
+                rt_stored += rt_block[b].n_out;
+            } else if (open) {
+                rt_log("WAV write failed (card full or take too long); recording off\r\n");
+                rt_recording = 0;
+            }
+            rt_send(RQ_FREE, b);
+        }
+
+        // Close once what was queued before SW1 is on the card
+        if (!rt_recording && open && uxQueueMessagesWaiting(rt_q[RQ_STORE].q) == 0) {
+            if (wav_writer_close(&wav) != FR_OK) {
+                rt_log("WAV close failed\r\n");
+            }
+            rt_log("Recording closed, %lu samples\r\n", (unsigned long)rt_stored);
+            rt_stored = 0;
+            open = 0;
+        }
+    }
+}
+
+/*** Log: the only task that prints; also takes SW1 and prints the report ***/
+static void rt_report(void) {
+    xil_printf("\r\n--- tasks (CPU %%, free stack words) ---\r\n");
+#if configGENERATE_RUN_TIME_STATS && configUSE_TRACE_FACILITY
+    static TaskStatus_t st[RT_MAX_TASKS];
+    uint32_t total;
+    UBaseType_t n = uxTaskGetSystemState(st, RT_MAX_TASKS, &total);
+    total /= 100;
+    for (UBaseType_t i = 0; i < n; i++) {
+        xil_printf("  %-10s %3lu%%  %5u\r\n", st[i].pcTaskName,
+                   (unsigned long)(total ? st[i].ulRunTimeCounter / total : 0),
+                   (unsigned)st[i].usStackHighWaterMark);
+    }
+#else
+    // CPU share needs configGENERATE_RUN_TIME_STATS in the BSP
+    for (int i = 0; i < (int)(sizeof(rt_tasks) / sizeof(rt_tasks[0])); i++) {
+        xil_printf("  task %d  -   %5u\r\n", i, (unsigned)uxTaskGetStackHighWaterMark(rt_tasks[i]));
+    }
+#endif
+    xil_printf("--- queues (high-water / size, refused) ---\r\n");
+    for (int i = 0; i < RQ_COUNT; i++) {
+        xil_printf("  %-10s %3u / %3u  %lu\r\n", rt_q[i].name, (unsigned)rt_q[i].high,
+                   (unsigned)rt_q[i].size, (unsigned long)rt_q[i].refused);
+    }
+
+    CaptureStats cs;
+    PlaybackStats ps;
+    capture_get_stats(&cs);
+    playback_get_stats(&ps);
+    float pitch = rt_pitch;
+    xil_printf("pitch %d Hz; capture %lu lost, %lu no-block; playback %lu underruns, %lu late\r\n",
+               (int)(pitch > 0.0f ? pitch + 0.5f : -1.0f), (unsigned long)cs.lost_samples,
+               (unsigned long)rt_cap_drops, (unsigned long)ps.underruns, (unsigned long)rt_play_drops);
+    xil_printf("storage %lu blocks behind; log %lu lines dropped\r\n",
+               (unsigned long)rt_store_skipped, (unsigned long)rt_log_dropped);
+}
+
+static void rt_log_task(void* arg) {
+    (void)arg;
+    char line[TUNER_RTOS_LOG_LINE];
+    TickType_t last = xTaskGetTickCount();
+
+    for (;;) {
+        if (xQueueReceive(rt_logq, line, pdMS_TO_TICKS(20)) == pdPASS) {
+            xil_printf("%s", line);
+        }
+        if (status_pressed()) {
+            rt_recording = !rt_recording;
+            status_set_led(rt_recording ? STATUS_LED_ON : STATUS_LED_SLOW);
+        }
+        if (xTaskGetTickCount() - last >= pdMS_TO_TICKS(TUNER_RTOS_REPORT_MS)) {
+            last = xTaskGetTickCount();
+            rt_report();
+        }
+    }
+}
+
+int main(void)
+{
+    xil_printf("\r\n=== Audio Tuner - FreeRTOS live pipeline ===\r\n");
+    xil_printf("SW1 toggles recording of the retuned stream to the card.\r\n");
+
+    if (dma_mem_init() != 0) {
+        xil_printf("DMA buffer section is not 2 MB aligned (lscript.ld).\r\n");
+        return XST_FAILURE;
+    }
+    XAxiDma_Config* cfg = XAxiDma_LookupConfig(XPAR_AXIDMA_0_DEVICE_ID);
+    if (!cfg || XAxiDma_CfgInitialize(&rt_dma, cfg) != XST_SUCCESS || XAxiDma_HasSg(&rt_dma)) {
+        xil_printf("DMA init failed (simple mode expected).\r\n");
+        return XST_FAILURE;
+    }
+    if (capture_init(&rt_dma) != 0) {
+        xil_printf("Capture init failed.\r\n");
+        return XST_FAILURE;
+    }
+
+    // Everything that mallocs is created before the scheduler starts
+    live_tune_default_config(&rt_cfg);
+    if (YinTracker_init(&rt_tracker, rt_cfg.window, rt_cfg.threshold) != 0 ||
+        !(rt_pv = pv_create(rt_cfg.fft_size, rt_cfg.hop, 1.0f))) {
+        xil_printf("Tracker / vocoder allocation failed.\r\n");
+        return XST_FAILURE;
+    }
+
+    for (int i = 0; i < RQ_COUNT; i++) {
+        rt_q[i].q = xQueueCreate(rt_q[i].size, sizeof(uint8_t));
+        if (!rt_q[i].q) {
+            xil_printf("Queue allocation failed.\r\n");
+            return XST_FAILURE;
+        }
+    }
+    rt_logq = xQueueCreate(TUNER_RTOS_LOG_QUEUE, TUNER_RTOS_LOG_LINE);
+    for (int b = 0; b < TUNER_RTOS_BLOCKS; b++) {
+        rt_send(RQ_FREE, (uint8_t)b);
+    }
+    rt_q[RQ_FREE].high = 0;
+
+    if (!rt_logq || status_init() != 0) {
+        xil_printf("Log queue / status timer setup failed.\r\n");
+        return XST_FAILURE;
+    }
+    status_set_led(STATUS_LED_SLOW);
+
+    static const struct {
+        TaskFunction_t fn;
+        const char* name;
+        UBaseType_t prio;
+    } tasks[] = {
+        { rt_playback_task,  "playback",  TUNER_RTOS_PRIO_PLAYBACK },
+        { rt_capture_task,   "capture",   TUNER_RTOS_PRIO_CAPTURE },
+        { rt_analysis_task,  "analysis",  TUNER_RTOS_PRIO_ANALYSIS },
+        { rt_synthesis_task, "synthesis", TUNER_RTOS_PRIO_SYNTHESIS },
+        { rt_storage_task,   "storage",   TUNER_RTOS_PRIO_STORAGE },
+        { rt_log_task,       "log",       TUNER_RTOS_PRIO_LOG },
+    };
+    for (int i = 0; i < (int)(sizeof(tasks) / sizeof(tasks[0])); i++) {
+        if (xTaskCreate(tasks[i].fn, tasks[i].name, TUNER_RTOS_STACK_WORDS, NULL,
+                        tasks[i].prio, &rt_tasks[i]) != pdPASS) {
+            xil_printf("Cannot create task %s\r\n", tasks[i].name);
+            return XST_FAILURE;
+        }
+    }
+
+    vTaskStartScheduler();
+    return 0;   // Only reached if the scheduler could not start
+}
+
+#endif // TUNER_RTOS
@@ -0,0 +1,53 @@
+#ifndef TUNER_RTOS_H
+#define TUNER_RTOS_H
+
+// FreeRTOS build of the tuner. Build the same sources against the FreeRTOS
+// BSP Vitis ships with -DTUNER_RTOS=1: helloworld.c then drops out and
+// tuner_rtos.c provides main(), irq.c connects through the port's GIC, and
+// the status tick runs from a FreeRTOS timer (the port's tick owns TTC 0).
+//
+// The live path runs as a chain of tasks joined by bounded queues of block
+// indices; a block carries one capture burst from the mic to the speaker
+// and, while SW1 has recording on, on to the card:
+//
+//   capture -> analysis (Yin tracker) -> synthesis (vocoder) -> playback
+//                                                                 |-> storage
+//
+// Every hand-off is non-blocking on the real-time side: capture drops a
+// burst when no block is free, playback only forwards to storage when its
+// queue has room, so a slow card or a busy UART costs stored or logged data,
+// never the stream. Text from any task goes through rt_log() to the log
+// task, which is the only one that prints.
+//
+// The log task reports per-task CPU share (needs configGENERATE_RUN_TIME_STATS
+// in the BSP's FreeRTOSConfig), stack high-water marks and the high-water
+// mark of every queue every TUNER_RTOS_REPORT_MS.
+
+#ifndef TUNER_RTOS
+#define TUNER_RTOS              0
+#endif
+
+#define TUNER_RTOS_BLOCKS       16      // Burst descriptors in flight (85 ms at 48 kHz)
+#define TUNER_RTOS_STORE_QUEUE  8       // Blocks the card may fall behind by
+#define TUNER_RTOS_LOG_QUEUE    16      // Pending log lines
+#define TUNER_RTOS_LOG_LINE     96
+#define TUNER_RTOS_RECORD_SECONDS 60    // Longest recording (the file is preallocated)
+#define TUNER_RTOS_REPORT_MS    5000
+
+// Priorities: the two DMA ends above the DSP, the card and the UART last
+#define TUNER_RTOS_PRIO_PLAYBACK  (tskIDLE_PRIORITY + 6)
+#define TUNER_RTOS_PRIO_CAPTURE   (tskIDLE_PRIORITY + 5)
+#define TUNER_RTOS_PRIO_ANALYSIS  (tskIDLE_PRIORITY + 4)
+#define TUNER_RTOS_PRIO_SYNTHESIS (tskIDLE_PRIORITY + 3)
+#define TUNER_RTOS_PRIO_STORAGE   (tskIDLE_PRIORITY + 2)
+#define TUNER_RTOS_PRIO_LOG       (tskIDLE_PRIORITY + 1)
+
+#define TUNER_RTOS_STACK_WORDS  1024
+
+/**
+ * Queue a line for the log task (never blocks; dropped and counted when the queue is full)
+ * @param fmt        printf format
+ */
+void rt_log(const char* fmt, ...);
+
+#endif // TUNER_RTOS_H
@@ -0,0 +1,137 @@
+#include <string.h>
+#include "vad.h"
+
+#define VAD_FLOOR_RISE_SHIFT    10      // Floor creeps up by 1/1024 per frame
+
+void vad_default_config(VadConfig* cfg) {
+    cfg->min_level = 10737;             // (32768 * 10^(-50/20))^2
+    cfg->ratio = 4;
+    cfg->max_zcr = 0.25f;
+    cfg->hangover = 4;
+    cfg->min_frames = 4;
+}
+
+void vad_init(Vad* vad, const VadConfig* cfg) {
+    memset(vad, 0, sizeof(*vad));
+    if (cfg) {
+        vad->cfg = *cfg;
+    } else {
+        vad_default_config(&vad->cfg);
+    }
+    vad->floor = vad->cfg.min_level;    // A take that starts loud is voiced from the first frame
+    vad->onset = UINT32_MAX;
+}
+
+// Keep a finished region: in start order, and once the index is full only
+// if it is longer than the shortest one held
+static void vad_keep(Vad* vad, const VadRegion* r) {
+    if (vad->onset == UINT32_MAX) {
+        vad->onset = r->start;
+    }
+    if (vad->count < VAD_MAX_REGIONS) {
+        vad->regions[vad->count++] = *r;
+        return;
+    }
+    int shortest = 0;
+    for (int i = 1; i < vad->count; i++) {
+        if (vad->regions[i].end - vad->regions[i].start <
+            vad->regions[shortest].end - vad->regions[shortest].start) {
+            shortest = i;
+        }
+    }
+    vad->dropped++;
+    if (r->end - r->start <= vad->regions[shortest].end - vad->regions[shortest].start) {
+        return;
+    }
+    memmove(&vad->regions[shortest], &vad->regions[shortest + 1],
+            (vad->count - 1 - shortest) * sizeof(VadRegion));
+    vad->regions[vad->count - 1] = *r;
+}
+
+static void vad_close(Vad* vad) {
+    if (vad->open && vad->run >= vad->cfg.min_frames) {
+        vad_keep(vad, &vad->cur);
+    }
+    vad->open = 0;
+}
+
+int vad_push(Vad* vad, const int16_t* pcm, int n) {
+    uint64_t energy = 0;
+    int crossings = 0;
+    int16_t prev = vad->last;
+    for (int i = 0; i < n; i++) {
+        int32_t x = pcm[i];
+        energy += (uint64_t)(x * x);
+        crossings += (x ^ prev) < 0;
+        prev = (int16_t)x;
+    }
+    vad->last = prev;
+    const uint32_t ms = (uint32_t)(energy / (uint32_t)n);
+    const uint32_t start = vad->pos;
+    vad->pos += (uint32_t)n;
+    vad->frames++;
+
+    uint64_t gate = (uint64_t)vad->floor * (uint32_t)vad->cfg.ratio;
+    if (gate < vad->cfg.min_level) {
+        gate = vad->cfg.min_level;
+    }
+    const int voiced = ms > gate && crossings < vad->cfg.max_zcr * n;
+
+    // Floor: straight down to a quieter frame, slowly up otherwise
+    if (ms < vad->floor) {
+        vad->floor = ms;
+    } else if (!voiced) {
+        vad->floor += ((ms - vad->floor) >> VAD_FLOOR_RISE_SHIFT) + 1;
+    } else {
+        vad->floor += (vad->floor >> VAD_FLOOR_RISE_SHIFT) + 1;
+    }
+
+    if (voiced) {
+        vad->voiced_frames++;
+        if (!vad->open) {
+            vad->open = 1;
+            vad->run = 0;
+            vad->cur.start = start;
+            vad->cur.peak = 0;
+        }
+        vad->quiet = 0;
+        vad->run++;
+        vad->cur.end = vad->pos;
+        if (ms > vad->cur.peak) {
+            vad->cur.peak = ms;
+        }
+    } else if (vad->open && ++vad->quiet > vad->cfg.hangover) {
+        vad_close(vad);
+    }
+    return voiced;
+}
+
+void vad_finish(Vad* vad) {
+    vad_close(vad);
+}
+
+int vad_window(const Vad* vad, int window, uint32_t not_before, uint32_t* start) {
+    int best = -1;
+    for (int i = 0; i < vad->count; i++) {
+        const VadRegion* r = &vad->regions[i];
+        if (r->end <= not_before) {
+            continue;
+        }
+        if (best < 0 || r->end - r->start > vad->regions[best].end - vad->regions[best].start) {
+            best = i;
+        }
+    }
+    if (best < 0 || (uint32_t)window > vad->pos) {
+        return -1;
+    }
+
+    const VadRegion* r = &vad->regions[best];
+    uint32_t lo = r->start > not_before ? r->start : not_before;
+    uint32_t mid = lo + (r->end - lo) / 2;
+    uint32_t s = mid > (uint32_t)window / 2 ? mid - (uint32_t)window / 2 : 0;
+    if (s + (uint32_t)window > vad->pos) {
+        s = vad->pos - (uint32_t)window;
+    }
+    *start = s;
+    return 0;
+}
@@ -0,0 +1,93 @@
+#ifndef VAD_H
+#define VAD_H
+
+#include <stdint.h>
+
+// Onset and voice-activity detection on the capture path.
+//
+// Every burst pushed is one frame: its mean square and zero-crossing rate
+// are compared against a noise floor that follows the quietest frames
+// (down at once, up by 1/1024 per frame, so a held note does not become
+// the floor). A frame is voiced when it is ratio times louder than the
+// floor, above min_level, and crosses zero rarely enough to be pitched
+// rather than hiss or fricative noise. Voiced frames, bridged by a short
+// hangover, make regions; regions shorter than min_frames (a button click)
+// are dropped. The result is a small index of sample ranges that the pitch
+// analysis can go to directly instead of a fixed offset.
+//
+// About three operations per sample, no allocation: the Vad lives wherever
+// the caller puts it (a static for a take).
+
+#define VAD_MAX_REGIONS     32
+
+typedef struct {
+    uint32_t min_level;         // Mean square below which nothing is voiced (Q15 squared)
+    int ratio;                  // Voiced if the mean square is this many times the floor
+    float max_zcr;              // Voiced only below this many zero crossings per sample
+    int hangover;               // Unvoiced frames bridged inside a region
+    int min_frames;             // Shortest region kept, frames
+} VadConfig;
+
+typedef struct {
+    uint32_t start;             // First sample of the region
+    uint32_t end;               // One past its last sample
+    uint32_t peak;              // Largest frame mean square in it
+} VadRegion;
+
+typedef struct {
+    VadConfig cfg;
+    uint32_t floor;             // Noise floor, mean square
+    uint32_t pos;               // Samples pushed
+    uint32_t frames;            // Frames pushed
+    uint32_t voiced_frames;     // ... of which voiced
+    int16_t last;               // Last sample of the previous frame (for the crossing count)
+    int open;                   // A region is in progress
+    int quiet;                  // Unvoiced frames since its last voiced one
+    int run;                    // Frames in it so far
+    VadRegion cur;
+    uint32_t onset;             // Start of the first region kept (UINT32_MAX if none)
+    int count;                  // Regions in regions[]
+    uint32_t dropped;           // Regions not kept because the index was full of longer ones
+    VadRegion regions[VAD_MAX_REGIONS];     // In order of start
+} Vad;
+
+/**
+ * Fill a config with the defaults: -50 dBFS, 4x (6 dB) over the floor, 0.25 crossings per sample, 4-frame hangover, 4-frame regions
+ * @param cfg         Config to fill
+ */
+void vad_default_config(VadConfig* cfg);
+
+/**
+ * Start a new stream
+ * @param vad         Detector to initialise
+ * @param cfg         Config (copied); NULL for the defaults
+ */
+void vad_init(Vad* vad, const VadConfig* cfg);
+
+/**
+ * Classify one frame and extend the index
+ * @param vad         Detector from vad_init
+ * @param pcm         Frame samples (e.g. one capture burst)
+ * @param n           Number of samples (> 0)
+ * @return            1 if the frame is voiced, else 0
+ */
+int vad_push(Vad* vad, const int16_t* pcm, int n);
+
+/**
+ * Close a region still open at the end of the stream
+ * @param vad         Detector from vad_init
+ */
+void vad_finish(Vad* vad);
+
+/**
+ * Analysis window inside the longest voiced region, centred on it (shifted
+ * to fit if the region is shorter than the window or near the stream edges)
+ * @param vad         Finished detector
+ * @param window      Window length in samples
+ * @param not_before  Ignore regions that end before this sample
+ * @param start       Receives the window's first sample
+ * @return            0 with a window, -1 if nothing suitable was voiced
+ */
+int vad_window(const Vad* vad, int window, uint32_t not_before, uint32_t* start);
+
+#endif // VAD_H
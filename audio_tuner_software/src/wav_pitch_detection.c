@@ -1,411 +1,514 @@
 /*
  * wav_pitch_detection.c - Complete WAV file pitch detection
  *
- * This provides a simple interface to detect pitch from a WAV file
+ * One sequential pass per file: the header is parsed once, the samples are
+ * read a block at a time, and every statistic and Yin window is taken from
+ * the block while it is in memory (see wav_pitch_detection.h)
  */
 
+#include "wav_pitch_detection.h"
 #include "Yin.h"
-#include <stdio.h>
+#include "arena.h"
+#include "dlog.h"
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 #include <math.h>
+#if WAV_ANALYSIS_FATFS
+#include "wav_reader.h"
+#else
+#include <stdio.h>
+#endif
 
-// WAV file header structures
-typedef struct {
-    char riff[4];              // "RIFF"
-    uint32_t fileSize;         // File size - 8
-    char wave[4];              // "WAVE"
-    char fmt[4];               // "fmt "
-    uint32_t fmtSize;          // Size of fmt chunk
-    uint16_t audioFormat;      // Audio format (1 = PCM)
-    uint16_t numChannels;      // Number of channels
-    uint32_t sampleRate;       // Sample rate
-    uint32_t byteRate;         // Byte rate
-    uint16_t blockAlign;       // Block align
-    uint16_t bitsPerSample;    // Bits per sample
-} WavHeader;
+#define WAV_FORMAT_PCM          1
+#define WAV_FORMAT_EXTENSIBLE   0xFFFE
 
-typedef struct {
-    char chunkId[4];           // "data"
-    uint32_t chunkSize;        // Size of data
-} DataChunk;
+#define WAV_DEFAULT_WINDOW      2048
+#define WAV_RETRY_START         44100   // Second window when the auto-detected one is unvoiced
 
-// Result structure for pitch detection
+// An open file: format, and frames still to come
 typedef struct {
-    float pitch;               // Detected pitch in Hz (-1 if not detected)
-    float confidence;          // Confidence level (0.0 to 1.0)
-    int sampleRate;            // Sample rate of the audio
-    int numSamples;            // Number of samples analyzed
-    int bufferSize;            // Buffer size used for analysis
-    int actualStartSample;     // Actual start sample used (after auto-detection)
-} PitchResult;
-
-/**
- * Find the first non-zero sample in a WAV file
- *
- * @param filename      Path to the WAV file
- * @param threshold     Minimum absolute value to consider as non-zero (default: 10)
- * @param maxSearch     Maximum number of samples to search (0 = search all)
- * @return              Index of first non-zero sample, or -1 on error
- */
-int findAudioStart(const char* filename, int threshold, int maxSearch) {
-    FILE* wavFile = fopen(filename, "rb");
-    if (!wavFile) {
-        return -1;
-    }
+#if WAV_ANALYSIS_FATFS
+    WavReader reader;
+#else
+    FILE* fp;
+#endif
+    int sampleRate;
+    int channels;
+    int bits;
+    uint32_t frames;
+    uint32_t pos;               // Next frame wav_source_read returns
+} WavSource;
+
+// A single window taken from the stream as it goes past
+typedef struct {
+    int32_t start;              // First sample; -1 = at the onset
+    int n;                      // Samples wanted
+    int16_t* buf;
+    int fill;
+} WavWindow;
 
-    // Read WAV header
-    WavHeader header;
-    fread(&header, sizeof(WavHeader), 1, wavFile);
+// Raw frames as read and their channel 0, shared by every pass (block-sized, off the stack)
+static int16_t wav_raw[WAV_ANALYSIS_BLOCK * WAV_ANALYSIS_MAX_CHANNELS];
+static int16_t wav_block[WAV_ANALYSIS_BLOCK];
 
-    // Find data chunk
-    DataChunk dataChunk;
-    while (fread(&dataChunk, sizeof(DataChunk), 1, wavFile) == 1) {
-        if (strncmp(dataChunk.chunkId, "data", 4) == 0) {
-            break;
-        }
-        fseek(wavFile, dataChunk.chunkSize, SEEK_CUR);
-    }
+/*** Backends ***/
 
-    int bytesPerSample = header.bitsPerSample / 8;
-    int totalSamples = dataChunk.chunkSize / (header.numChannels * bytesPerSample);
+#if WAV_ANALYSIS_FATFS
 
-    if (maxSearch == 0 || maxSearch > totalSamples) {
-        maxSearch = totalSamples;
+static int wav_source_open(WavSource* src, const char* filename) {
+    memset(src, 0, sizeof(*src));
+    FRESULT fr = wav_reader_open(&src->reader, filename);
+    if (fr != FR_OK) {
+        DLOG_ERROR("Error: Could not open %s (%d)\r\n", filename, fr);
+        return -1;
     }
+    if (src->reader.channels > WAV_ANALYSIS_MAX_CHANNELS) {
+        DLOG_ERROR("Error: %d channels not supported\r\n", src->reader.channels);
+        wav_reader_close(&src->reader);
+        return -1;
+    }
+    src->sampleRate = (int)src->reader.fs;
+    src->channels = src->reader.channels;
+    src->bits = src->reader.bits;
+    src->frames = src->reader.frames;
+    return 0;
+}
 
-    // Search for first non-zero sample
-    for (int i = 0; i < maxSearch; i++) {
-        int16_t sample = 0;
-
-        if (header.bitsPerSample == 16) {
-            fread(&sample, sizeof(int16_t), 1, wavFile);
-            if (header.numChannels > 1) {
-                fseek(wavFile, (header.numChannels - 1) * sizeof(int16_t), SEEK_CUR);
-            }
-        } else if (header.bitsPerSample == 8) {
-            uint8_t sample8;
-            fread(&sample8, sizeof(uint8_t), 1, wavFile);
-            sample = (int16_t)(sample8 - 128) * 256;
-            if (header.numChannels > 1) {
-                fseek(wavFile, header.numChannels - 1, SEEK_CUR);
-            }
-        }
+static void wav_source_close(WavSource* src) {
+    wav_reader_close(&src->reader);
+}
 
-        // Check if sample exceeds threshold
-        if (abs(sample) > threshold) {
-            fclose(wavFile);
-            return i;
-        }
+// Up to n frames of channel 0; 0 at the end of the data or on an error
+static uint32_t wav_source_read(WavSource* src, uint32_t n) {
+    uint32_t got = 0;
+    int16_t* dst = src->channels == 1 ? wav_block : wav_raw;
+    if (wav_reader_read(&src->reader, dst, n, &got) != FR_OK) {
+        DLOG_ERROR("Error: Failed to read audio data\r\n");
+        return 0;
     }
+    for (uint32_t i = 0; dst != wav_block && i < got; i++) {
+        wav_block[i] = wav_raw[i * src->channels];
+    }
+    src->pos += got;
+    return got;
+}
 
-    fclose(wavFile);
-    return -1; // No non-zero sample found
+#else
+
+static uint32_t wav_le32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
 }
 
-/**
- * Detect pitch from a WAV file
- *
- * @param filename      Path to the WAV file
- * @param startSample   Which sample to start analysis from (-1 = auto-detect, 0 = beginning)
- * @param numSamples    How many samples to analyze (0 = auto-determine optimal size)
- * @param threshold     Detection threshold (0.05 = strict, 0.15 = balanced, 0.30 = lenient)
- * @param result        Pointer to PitchResult structure to store results
- * @return              0 on success, -1 on error
- */
-int detectPitchFromWav(const char* filename, int startSample, int numSamples,
-                       float threshold, PitchResult* result) {
+static uint16_t wav_le16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
 
-    // Initialize result
-    result->pitch = -1;
-    result->confidence = 0;
-    result->sampleRate = 0;
-    result->numSamples = 0;
-    result->bufferSize = 0;
-    result->actualStartSample = 0;
+// Walk the chunks after "RIFF....WAVE" to the data, leaving the file at its first sample
+static int wav_source_parse(WavSource* src, long size) {
+    uint8_t h[40];
+    int have_fmt = 0;
+    int frame_bytes = 0;
 
-    // Track if we used auto-detect
-    int usedAutoDetect = 0;
-    int originalStartSample = startSample;
-
-    // Auto-detect start position if startSample is -1
-    if (startSample == -1) {
-        usedAutoDetect = 1;
-        printf("Auto-detecting audio start position...\n");
-        startSample = findAudioStart(filename, 5, 100000); // Search first 100k samples
-        if (startSample == -1) {
-            fprintf(stderr, "Warning: Could not find audio start, using sample 0\n");
-            startSample = 0;
-        } else {
-            printf("Audio detected starting at sample %d\n", startSample);
+    if (fread(h, 1, 12, src->fp) != 12 || memcmp(h, "RIFF", 4) != 0 || memcmp(h + 8, "WAVE", 4) != 0) {
+        DLOG_ERROR("Error: Not a valid WAV file\r\n");
+        return -1;
+    }
+    long off = 12;
+    while (off + 8 <= size && fread(h, 1, 8, src->fp) == 8) {
+        uint32_t len = wav_le32(h + 4);
+        long body = off + 8;
+
+        if (memcmp(h, "data", 4) == 0) {
+            if (!have_fmt) break;
+            // A take cut short (or still being written) can claim more than the file holds
+            uint32_t bytes = len <= (uint32_t)(size - body) ? len : (uint32_t)(size - body);
+            src->frames = bytes / frame_bytes;
+            return 0;
+        }
+        if (memcmp(h, "fmt ", 4) == 0) {
+            uint32_t want = len < sizeof(h) ? len : sizeof(h);
+            if (len < 16 || fread(h, 1, want, src->fp) != want) break;
+            uint16_t tag = wav_le16(h);
+            if (tag == WAV_FORMAT_EXTENSIBLE && len >= 26) {
+                tag = wav_le16(h + 24);             // Sub-format GUID starts with the tag
+            }
+            src->channels = wav_le16(h + 2);
+            src->sampleRate = (int)wav_le32(h + 4);
+            frame_bytes = wav_le16(h + 12);
+            src->bits = wav_le16(h + 14);
+            if (tag != WAV_FORMAT_PCM) {
+                DLOG_ERROR("Error: Only PCM format is supported\r\n");
+                return -1;
+            }
+            if ((src->bits != 8 && src->bits != 16) || src->channels < 1 ||
+                src->channels > WAV_ANALYSIS_MAX_CHANNELS || frame_bytes != src->channels * src->bits / 8) {
+                DLOG_ERROR("Error: Unsupported format: %d channels, %d bits\r\n", src->channels, src->bits);
+                return -1;
+            }
+            have_fmt = 1;
         }
+        off = body + len + (len & 1);               // Chunks are padded to even sizes
+        if (fseek(src->fp, off, SEEK_SET) != 0) break;
     }
-    result->actualStartSample = startSample;
+    DLOG_ERROR("Error: No fmt and data chunks\r\n");
+    return -1;
+}
 
-    // Open WAV file
-    FILE* wavFile = fopen(filename, "rb");
-    if (!wavFile) {
-        fprintf(stderr, "Error: Could not open file %s\n", filename);
+static int wav_source_open(WavSource* src, const char* filename) {
+    memset(src, 0, sizeof(*src));
+    src->fp = fopen(filename, "rb");
+    if (!src->fp) {
+        DLOG_ERROR("Error: Could not open file %s\r\n", filename);
         return -1;
     }
-
-    // Read WAV header
-    WavHeader header;
-    if (fread(&header, sizeof(WavHeader), 1, wavFile) != 1) {
-        fprintf(stderr, "Error: Failed to read WAV header\n");
-        fclose(wavFile);
+    // One block per read rather than stdio's default buffer
+    setvbuf(src->fp, NULL, _IOFBF, sizeof(wav_raw));
+    long size = -1;
+    if (fseek(src->fp, 0, SEEK_END) == 0) {
+        size = ftell(src->fp);
+        rewind(src->fp);
+    }
+    if (size < 0 || wav_source_parse(src, size) != 0) {
+        fclose(src->fp);
         return -1;
     }
+    return 0;
+}
 
-    // Verify it's a valid WAV file
-    if (strncmp(header.riff, "RIFF", 4) != 0 || strncmp(header.wave, "WAVE", 4) != 0) {
-        fprintf(stderr, "Error: Not a valid WAV file\n");
-        fclose(wavFile);
-        return -1;
+static void wav_source_close(WavSource* src) {
+    fclose(src->fp);
+}
+
+static uint32_t wav_source_read(WavSource* src, uint32_t n) {
+    if (n > src->frames - src->pos) n = src->frames - src->pos;
+    const int frame_bytes = src->channels * src->bits / 8;
+    uint32_t got = (uint32_t)fread(wav_raw, frame_bytes, n, src->fp);
+    if (src->bits == 16) {
+        const int16_t* s = wav_raw;
+        for (uint32_t i = 0; i < got; i++, s += src->channels) {
+            const uint8_t* b = (const uint8_t*)s;
+            wav_block[i] = (int16_t)wav_le16(b);
+        }
+    } else {
+        const uint8_t* s = (const uint8_t*)wav_raw;
+        for (uint32_t i = 0; i < got; i++, s += src->channels) {
+            wav_block[i] = (int16_t)((*s - 128) * 256);
+        }
     }
+    src->pos += got;
+    return got;
+}
 
-    if (header.audioFormat != 1) {
-        fprintf(stderr, "Error: Only PCM format is supported\n");
-        fclose(wavFile);
-        return -1;
+#endif
+
+/*** The pass ***/
+
+// Copy what the block holds of a window; an auto-started one takes the
+// opening samples until the onset is known (the fallback if there is none)
+static void wav_window_take(WavWindow* w, const int16_t* x, uint32_t pos, uint32_t got, int32_t onset) {
+    if (w->start < 0 && onset >= 0) {
+        w->start = onset;
+        w->fill = 0;
     }
+    uint32_t first = w->start < 0 ? 0u : (uint32_t)w->start;
+    uint32_t from = first + (uint32_t)w->fill;
+    if (w->fill >= w->n || from < pos || from >= pos + got) return;
+    uint32_t take = pos + got - from;
+    if (take > (uint32_t)(w->n - w->fill)) take = (uint32_t)(w->n - w->fill);
+    memcpy(w->buf + w->fill, x + (from - pos), take * sizeof(int16_t));
+    w->fill += (int)take;
+}
 
-    result->sampleRate = header.sampleRate;
+// Full, and (if it follows the onset) the onset search is over
+static int wav_window_done(const WavWindow* w, int searched) {
+    return w->fill >= w->n && (w->start >= 0 || searched);
+}
 
-    // Find data chunk
-    DataChunk dataChunk;
-    while (fread(&dataChunk, sizeof(DataChunk), 1, wavFile) == 1) {
-        if (strncmp(dataChunk.chunkId, "data", 4) == 0) {
-            break;
+// Read the file once: levels into stats (when given), the grid (when cfg has
+// one) and every window in win[]. Without stats the read stops as soon as
+// the grid and the windows are complete.
+static int wav_pass(WavSource* src, const WavAnalysisConfig* cfg, WavStats* stats,
+                    WavWindow* win, int nwin) {
+    YinAnalysis grid;
+    int grid_ready = 0, grid_done = cfg->windowSize <= 0;
+    int32_t onset = -1;
+    uint32_t search = cfg->onsetSearch ? cfg->onsetSearch : src->frames;
+    int64_t sum = 0;
+    uint64_t energy = 0;
+    int32_t peak = 0;
+    uint32_t clipped = 0;
+    int ret = 0;
+
+    const uint32_t limit = cfg->maxSamples && cfg->maxSamples < src->frames ? cfg->maxSamples : src->frames;
+    while (src->pos < limit) {
+        const uint32_t pos = src->pos;
+        const uint32_t got = wav_source_read(src, limit - pos < WAV_ANALYSIS_BLOCK ? limit - pos : WAV_ANALYSIS_BLOCK);
+        if (got == 0) break;
+        const int16_t* x = wav_block;
+
+        // Levels, and the onset while it is still being searched for
+        uint32_t onset_in = got;
+        if (onset < 0 && pos < search) {
+            uint32_t end = search - pos < got ? search - pos : got;
+            for (uint32_t i = 0; i < end; i++) {
+                if (abs(x[i]) > cfg->onsetLevel) {
+                    onset = (int32_t)(pos + i);
+                    onset_in = i;
+                    break;
+                }
+            }
+        }
+        if (stats) {
+            for (uint32_t i = 0; i < got; i++) {
+                int32_t v = x[i];
+                int32_t a = v < 0 ? -v : v;
+                sum += v;
+                energy += (uint64_t)(v * v);
+                if (a > peak) peak = a;
+                clipped += a >= cfg->clipLevel;
+            }
         }
-        // Skip this chunk
-        fseek(wavFile, dataChunk.chunkSize, SEEK_CUR);
-    }
 
-    int bytesPerSample = header.bitsPerSample / 8;
-    int totalSamples = dataChunk.chunkSize / (header.numChannels * bytesPerSample);
+        // The grid starts at firstSample, or where the onset has just been found
+        if (!grid_done && !grid_ready) {
+            uint32_t skip = 0;
+            int start = 0;
+            if (cfg->firstSample >= 0) {
+                start = 1;
+            } else if (onset_in < got) {
+                start = 1;
+                skip = onset_in;
+            } else if (pos + got >= search) {
+                grid_done = 1;                      // Nothing was ever loud enough
+            }
+            if (start) {
+                if (YinAnalysis_init(&grid, cfg->windowSize, cfg->hop, cfg->firstSample >= 0 ? cfg->firstSample : 0,
+                                     cfg->maxWindows, cfg->threshold) != 0) {
+                    DLOG_ERROR("Error: Memory allocation failed\r\n");
+                    ret = -1;
+                    break;
+                }
+                Yin_setSampleRate(&grid.yin, src->sampleRate);
+                if (cfg->minPitch > 0.0f && cfg->maxPitch > cfg->minPitch) {
+                    Yin_setRange(&grid.yin, cfg->minPitch, cfg->maxPitch);
+                }
+                Yin_setCoarseToFine(&grid.yin, cfg->coarseToFine);
+                grid_ready = 1;
+                grid_done = YinAnalysis_push(&grid, x + skip, (int)(got - skip));
+            }
+        } else if (grid_ready && !grid_done) {
+            grid_done = YinAnalysis_push(&grid, x, (int)got);
+        }
 
-    // Auto-determine optimal buffer size if numSamples is 0
-    if (numSamples == 0) {
-        // Default: 2048 samples or what's available
-        numSamples = 2048;
-        if (startSample + numSamples > totalSamples) {
-            numSamples = totalSamples - startSample;
+        const int searched = onset >= 0 || pos + got >= search;
+        int windows_done = 1;
+        for (int k = 0; k < nwin; k++) {
+            wav_window_take(&win[k], x, pos, got, onset);
+            windows_done &= wav_window_done(&win[k], searched);
         }
+        if (!stats && grid_done && windows_done) break;
     }
 
-    // Validate parameters
-    if (startSample < 0 || startSample >= totalSamples) {
-        fprintf(stderr, "Error: startSample out of range\n");
-        fclose(wavFile);
-        return -1;
+    if (stats) {
+        const uint32_t n = src->pos;
+        stats->sampleRate = src->sampleRate;
+        stats->channels = src->channels;
+        stats->bits = src->bits;
+        stats->frames = src->frames;
+        stats->samples = n;
+        stats->onset = onset;
+        stats->peak = peak;
+        stats->clipped = clipped;
+        stats->rms = n ? sqrtf((float)((double)energy / n)) * (1.0f / 32768.0f) : 0.0f;
+        stats->dcOffset = n ? (float)((double)sum / n) * (1.0f / 32768.0f) : 0.0f;
+        memset(&stats->pitch, 0, sizeof(stats->pitch));
+        stats->pitch.medianPitch = -1;
+        stats->pitch.histogramPitch = -1;
     }
+    if (grid_ready) {
+        if (stats) YinAnalysis_summarise(&grid, &stats->pitch);
+        YinAnalysis_free(&grid);
+    }
+    return ret;
+}
 
-    if (startSample + numSamples > totalSamples) {
-        numSamples = totalSamples - startSample;
-        fprintf(stderr, "Warning: Adjusting numSamples to %d (end of file)\n", numSamples);
+// Yin over one captured window
+static float wav_window_pitch(const WavWindow* w, int sampleRate, float threshold, float* confidence) {
+    Yin yin;
+    *confidence = 0;
+    if (w->fill < 2) return -1;
+    Yin_init(&yin, w->fill, threshold);
+    if (!yin.yinBuffer) {
+        DLOG_ERROR("Error: Memory allocation failed\r\n");
+        return -1;
     }
+    Yin_setSampleRate(&yin, sampleRate);
+    float pitch = Yin_getPitch(&yin, w->buf);
+    *confidence = Yin_getProbability(&yin);
+    Yin_free(&yin);
+    return pitch;
+}
 
-    result->numSamples = numSamples;
-    result->bufferSize = numSamples;
+/*** Public ***/
+
+void wavAnalysisDefaultConfig(WavAnalysisConfig* cfg) {
+    cfg->onsetLevel = 5;
+    cfg->onsetSearch = 100000;
+    cfg->clipLevel = 32767;
+    cfg->maxSamples = 0;
+    cfg->windowSize = WAV_DEFAULT_WINDOW;
+    cfg->hop = 48000 / 8;
+    cfg->firstSample = -1;
+    cfg->maxWindows = 64;
+    cfg->threshold = 0.15f;
+    cfg->minPitch = 20.0f;
+    cfg->maxPitch = 4200.0f;
+    cfg->coarseToFine = 1;
+}
 
-    // Allocate audio buffer
-    int16_t* audioBuffer = (int16_t*)malloc(numSamples * sizeof(int16_t));
-    if (!audioBuffer) {
-        fprintf(stderr, "Error: Memory allocation failed\n");
-        fclose(wavFile);
+int analyseWav(const char* filename, const WavAnalysisConfig* cfg, WavStats* stats) {
+    WavAnalysisConfig def;
+    WavSource src;
+    if (!cfg) {
+        wavAnalysisDefaultConfig(&def);
+        cfg = &def;
+    }
+    if (wav_source_open(&src, filename) != 0) {
         return -1;
     }
+    int ret = wav_pass(&src, cfg, stats, NULL, 0);
+    wav_source_close(&src);
+    return ret;
+}
 
-    // Seek to start position
-    int bytesPerFrame = header.numChannels * bytesPerSample;
-    fseek(wavFile, startSample * bytesPerFrame, SEEK_CUR);
-
-    // Read audio data into buffer
-    for (int i = 0; i < numSamples; i++) {
-        int16_t sample = 0;
+int findAudioStart(const char* filename, int threshold, int maxSearch) {
+    WavAnalysisConfig cfg;
+    WavSource src;
+    wavAnalysisDefaultConfig(&cfg);
+    cfg.onsetLevel = threshold;
+    cfg.onsetSearch = maxSearch > 0 ? (uint32_t)maxSearch : 0;
+    cfg.windowSize = 0;
+
+    if (wav_source_open(&src, filename) != 0) {
+        return -1;
+    }
+    // A one-sample window at the onset ends the read there
+    int16_t first;
+    WavWindow w = { -1, 1, &first, 0 };
+    wav_pass(&src, &cfg, NULL, &w, 1);
+    wav_source_close(&src);
+    return w.start;
+}
 
-        if (header.bitsPerSample == 16) {
-            // Read 16-bit sample
-            if (fread(&sample, sizeof(int16_t), 1, wavFile) != 1) {
-                fprintf(stderr, "Error: Failed to read audio data\n");
-                free(audioBuffer);
-                fclose(wavFile);
-                return -1;
-            }
+// Pitch of the window at startSample, or at the onset with a second window
+// read in the same pass in case the first is unvoiced
+static int wav_detect(WavSource* src, int startSample, int numSamples, float threshold, PitchResult* result) {
+    WavAnalysisConfig cfg;
+    wavAnalysisDefaultConfig(&cfg);
+    cfg.windowSize = 0;
 
-            // Skip remaining channels if stereo
-            if (header.numChannels > 1) {
-                fseek(wavFile, (header.numChannels - 1) * sizeof(int16_t), SEEK_CUR);
-            }
-        } else if (header.bitsPerSample == 8) {
-            uint8_t sample8;
-            if (fread(&sample8, sizeof(uint8_t), 1, wavFile) != 1) {
-                fprintf(stderr, "Error: Failed to read audio data\n");
-                free(audioBuffer);
-                fclose(wavFile);
-                return -1;
-            }
-            sample = (int16_t)(sample8 - 128) * 256;
+    result->sampleRate = src->sampleRate;
+    if (numSamples <= 0) {
+        numSamples = WAV_DEFAULT_WINDOW;
+    }
+    const int autoStart = startSample == -1;
+    if (!autoStart && (startSample < 0 || (uint32_t)startSample >= src->frames)) {
+        DLOG_ERROR("Error: startSample out of range\r\n");
+        return -1;
+    }
+    if (!autoStart && (uint32_t)(startSample + numSamples) > src->frames) {
+        numSamples = (int)(src->frames - (uint32_t)startSample);
+        DLOG_WARN("Warning: Adjusting numSamples to %d (end of file)\r\n", numSamples);
+    }
 
-            // Skip remaining channels if stereo
-            if (header.numChannels > 1) {
-                fseek(wavFile, header.numChannels - 1, SEEK_CUR);
-            }
-        } else {
-            fprintf(stderr, "Error: Unsupported bits per sample: %d\n", header.bitsPerSample);
-            free(audioBuffer);
-            fclose(wavFile);
+    WavWindow win[2] = {
+        { autoStart ? -1 : startSample, numSamples, NULL, 0 },
+        { WAV_RETRY_START, 0, NULL, 0 },
+    };
+    int nwin = 1;
+    if (autoStart && src->frames > WAV_RETRY_START) {
+        win[1].n = src->frames - WAV_RETRY_START < (uint32_t)numSamples ? (int)(src->frames - WAV_RETRY_START) : numSamples;
+        nwin = 2;
+    }
+    for (int k = 0; k < nwin; k++) {
+        win[k].buf = (int16_t*)arena_malloc(win[k].n * sizeof(int16_t));
+        if (!win[k].buf) {
+            DLOG_ERROR("Error: Memory allocation failed\r\n");
+            arena_free(win[0].buf);
             return -1;
         }
-
-        audioBuffer[i] = sample;
     }
 
-    fclose(wavFile);
-
-    // Initialize Yin for pitch detection
-    Yin yin;
-    Yin_init(&yin, numSamples, threshold);
-
-    // Detect pitch
-    float pitch = Yin_getPitch(&yin, audioBuffer);
-
-    result->pitch = pitch;
-    result->confidence = Yin_getProbability(&yin);
+    int ret = wav_pass(src, &cfg, NULL, win, nwin);
+    if (ret == 0) {
+        if (autoStart) {
+            if (win[0].start < 0) {
+                DLOG_WARN("Warning: Could not find audio start, using sample 0\r\n");
+            } else {
+                DLOG_INFO("Audio detected starting at sample %d\r\n", (int)win[0].start);
+            }
+        }
+        const WavWindow* w = &win[0];
+        result->pitch = wav_window_pitch(w, src->sampleRate, threshold, &result->confidence);
+        if (autoStart && result->pitch <= 0) {
+            DLOG_INFO("No pitch detected at the auto-detected start, trying sample %d\r\n", WAV_RETRY_START);
+            w = &win[1];
+            if (nwin < 2) {
+                DLOG_ERROR("Error: startSample out of range\r\n");
+                ret = -1;
+            } else {
+                result->pitch = wav_window_pitch(w, src->sampleRate, threshold, &result->confidence);
+            }
+        }
+        result->actualStartSample = w->start < 0 ? 0 : w->start;
+        result->numSamples = w->fill;
+        result->bufferSize = w->fill;
+    }
+    arena_free(win[0].buf);
+    arena_free(win[1].buf);
+    return ret;
+}
 
-    // Cleanup
-    free(yin.yinBuffer);
-    free(audioBuffer);
+int detectPitchFromWav(const char* filename, int startSample, int numSamples,
+                       float threshold, PitchResult* result) {
+    WavSource src;
+    result->pitch = -1;
+    result->confidence = 0;
+    result->sampleRate = 0;
+    result->numSamples = 0;
+    result->bufferSize = 0;
+    result->actualStartSample = 0;
 
-    // If auto-detect was used and no pitch was detected, retry with sample 20000
-    if (usedAutoDetect && pitch <= 0 && originalStartSample == -1) {
-        printf("\nNo pitch detected with auto-detected start position.\n");
-        printf("Retrying with start sample 44100...\n\n");
-        return detectPitchFromWav(filename, 44100, numSamples, threshold, result);
+    if (wav_source_open(&src, filename) != 0) {
+        return -1;
     }
-
-    return 0;
+    int ret = wav_detect(&src, startSample, numSamples, threshold, result);
+    wav_source_close(&src);
+    return ret;
 }
 
-/**
- * Simple wrapper function - detect pitch from WAV with default settings
- * Auto-detects where audio starts
- *
- * @param filename    Path to the WAV file
- * @param result      Pointer to PitchResult structure
- * @return            0 on success, -1 on error
- */
 int detectPitchSimple(const char* filename, PitchResult* result) {
     // Use defaults: auto-detect start, auto buffer size, balanced threshold
-    return detectPitchFromWav(filename, -1, 2048, 0.15, result);
+    return detectPitchFromWav(filename, -1, WAV_DEFAULT_WINDOW, 0.15f, result);
 }
 
-/**
- * Detect pitch from a specific time range in the WAV file
- *
- * @param filename      Path to the WAV file
- * @param startTimeMs   Start time in milliseconds
- * @param durationMs    Duration in milliseconds to analyze
- * @param threshold     Detection threshold
- * @param result        Pointer to PitchResult structure
- * @return              0 on success, -1 on error
- */
 int detectPitchFromTime(const char* filename, int startTimeMs, int durationMs,
                         float threshold, PitchResult* result) {
+    WavSource src;
+    result->pitch = -1;
+    result->confidence = 0;
+    result->numSamples = 0;
+    result->bufferSize = 0;
+    result->actualStartSample = 0;
 
-    // First, we need to read sample rate from the file
-    FILE* wavFile = fopen(filename, "rb");
-    if (!wavFile) {
-        fprintf(stderr, "Error: Could not open file %s\n", filename);
+    // The header is read once; the times become samples before the pass
+    if (wav_source_open(&src, filename) != 0) {
         return -1;
     }
-
-    WavHeader header;
-    fread(&header, sizeof(WavHeader), 1, wavFile);
-    fclose(wavFile);
-
-    // Convert time to samples
-    int sampleRate = header.sampleRate;
-    int startSample = (startTimeMs * sampleRate) / 1000;
-    int numSamples = (durationMs * sampleRate) / 1000;
-
-    return detectPitchFromWav(filename, startSample, numSamples, threshold, result);
+    int startSample = (int)(((int64_t)startTimeMs * src.sampleRate) / 1000);
+    int numSamples = (int)(((int64_t)durationMs * src.sampleRate) / 1000);
+    int ret = numSamples > 0 ? wav_detect(&src, startSample, numSamples, threshold, result) : -1;
+    wav_source_close(&src);
+    return ret;
 }
-
-
-// Example usage and testing
-//int main(int argc, char* argv[]) {
-//
-//    if (argc < 2) {
-//        printf("WAV Pitch Detection - Complete Solution\n");
-//        printf("========================================\n\n");
-//        printf("Usage: %s <wav_file> [start_sample] [num_samples] [threshold]\n\n", argv[0]);
-//        printf("Examples:\n");
-//        printf("  %s audio.wav                    # Auto-detect start, use defaults\n", argv[0]);
-//        printf("  %s audio.wav -1 2048 0.15       # Auto-detect start with custom params\n", argv[0]);
-//        printf("  %s audio.wav 1000 2048 0.15     # Manual start position\n\n", argv[0]);
-//        printf("Parameters:\n");
-//        printf("  start_sample  - Sample to start from (-1=auto-detect, 0=beginning)\n");
-//        printf("  num_samples   - Buffer size (default: 2048, 0=auto)\n");
-//        printf("  threshold     - Detection threshold (default: 0.15)\n");
-//        return 1;
-//    }
-//
-//    const char* filename = argv[1];
-//    int startSample = (argc > 2) ? atoi(argv[2]) : -1;  // Default to auto-detect
-//    int numSamples = (argc > 3) ? atoi(argv[3]) : 2048;
-//    float threshold = (argc > 4) ? atof(argv[4]) : 0.15;
-//
-//    printf("Analyzing WAV file: %s\n", filename);
-//    if (startSample == -1) {
-//        printf("Parameters: start=AUTO-DETECT, samples=%d, threshold=%.2f\n\n",
-//               numSamples, threshold);
-//    } else {
-//        printf("Parameters: start=%d, samples=%d, threshold=%.2f\n\n",
-//               startSample, numSamples, threshold);
-//    }
-//
-//    // Perform pitch detection
-//    PitchResult result;
-//    if (detectPitchFromWav(filename, startSample, numSamples, threshold, &result) == 0) {
-//
-//        printf("=== Results ===\n");
-//        printf("Sample Rate:     %d Hz\n", result.sampleRate);
-//        printf("Start Sample:    %d\n", result.actualStartSample);
-//        printf("Samples Analyzed: %d\n", result.numSamples);
-//        printf("Buffer Size:     %d\n", result.bufferSize);
-//
-//        if (result.pitch > 0) {
-//            printf("\nPitch Detected!\n");
-//            printf("  Frequency:    %.2f Hz\n", result.pitch);
-//            printf("  Confidence:   %.1f%%\n", result.confidence * 100);
-//
-//            // Calculate musical note
-//            if (result.pitch > 20 && result.pitch < 4200) {
-//                const char* notes[] = {"C", "C#", "D", "D#", "E", "F",
-//                                       "F#", "G", "G#", "A", "A#", "B"};
-//
-//                // log2(x) = log(x) / log(2)
-//                float log2_val = logf(result.pitch / 440.0f) / logf(2.0f);
-//                int midiNote = (int)(12 * log2_val + 69);
-//                int noteIndex = midiNote % 12;
-//                int octave = (midiNote / 12) - 1;
-//                printf("  Musical Note: %s%d\n", notes[noteIndex], octave);
-//            }
-//        } else {
-//            printf("\nNo pitch detected\n");
-//            printf("  Try adjusting:\n");
-//            printf("  - start_sample (find section with audio)\n");
-//            printf("  - num_samples (larger buffer for low frequencies)\n");
-//            printf("  - threshold (higher value = more lenient)\n");
-//        }
-//
-//    } else {
-//        printf("Error: Failed to analyze WAV file\n");
-//        return 1;
-//    }
-//
-//    return 0;
-//}
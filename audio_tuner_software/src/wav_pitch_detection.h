@@ -0,0 +1,131 @@
+#ifndef WAV_PITCH_DETECTION_H
+#define WAV_PITCH_DETECTION_H
+
+#include <stdint.h>
+#include "YinAnalysis.h"
+
+// Streaming analysis of a WAV file.
+//
+// The file is read once, front to back, in blocks of WAV_ANALYSIS_BLOCK
+// frames. Every block is reduced to channel 0 and goes through the level
+// statistics (onset, RMS, peak, clip count, DC offset), the Yin grid and any
+// single windows asked for before the next one is read; nothing is re-read
+// and nothing is seeked to sample by sample. The same code runs on the board,
+// reading through FatFs, and on the host (Testing/benchmark), reading through
+// stdio.
+
+#ifndef WAV_ANALYSIS_FATFS
+#if defined(__linux__)
+#define WAV_ANALYSIS_FATFS      0       // Host build: stdio
+#else
+#define WAV_ANALYSIS_FATFS      1       // Board build: FatFs through wav_reader (16-bit PCM only)
+#endif
+#endif
+
+#ifndef WAV_ANALYSIS_BLOCK
+#define WAV_ANALYSIS_BLOCK      4096    // Frames per read
+#endif
+
+#define WAV_ANALYSIS_MAX_CHANNELS   2   // Frames are read whole; wider files are refused
+
+// Result structure for pitch detection
+typedef struct {
+    float pitch;               // Detected pitch in Hz (-1 if not detected)
+    float confidence;          // Confidence level (0.0 to 1.0)
+    int sampleRate;            // Sample rate of the audio
+    int numSamples;            // Number of samples analyzed
+    int bufferSize;            // Buffer size used for analysis
+    int actualStartSample;     // Actual start sample used (after auto-detection)
+} PitchResult;
+
+typedef struct {
+    int onsetLevel;            // |sample| above which the audio has started
+    uint32_t onsetSearch;      // Samples searched for the onset (0 = whole file)
+    int clipLevel;             // |sample| at or above which a sample counts as clipped
+    uint32_t maxSamples;       // Stop reading after this many frames (0 = whole file)
+
+    // Yin grid: windowSize 0 for levels only
+    int windowSize;
+    int hop;
+    int firstSample;           // -1 = at the onset
+    int maxWindows;
+    float threshold;
+    float minPitch;            // Search range in Hz (0 = Yin's default)
+    float maxPitch;
+    int coarseToFine;          // See Yin_setCoarseToFine
+} WavAnalysisConfig;
+
+typedef struct {
+    int sampleRate;
+    int channels;
+    int bits;
+    uint32_t frames;           // Frames in the data chunk
+    uint32_t samples;          // Frames read, which the levels cover (maxSamples, or a read error, stop short)
+    int32_t onset;             // First sample over onsetLevel, -1 if none
+    int32_t peak;              // Largest |sample| (32768 for a full negative swing)
+    uint32_t clipped;          // Samples at or over clipLevel
+    float rms;                 // Full scale = 1
+    float dcOffset;            // Mean sample, full scale = 1
+    YinSummary pitch;          // The grid's summary (windows = 0 without a grid)
+} WavStats;
+
+/**
+ * Fill a config with the defaults: the whole file, onset at |x| > 5 in the
+ * first 100k samples, clipping at 32767, a 2048-sample Yin grid every 1/8 s
+ * at 48 kHz from the onset, up to 64 windows, threshold 0.15, 20 Hz to
+ * 4.2 kHz, coarse to fine
+ * @param cfg          Config to fill
+ */
+void wavAnalysisDefaultConfig(WavAnalysisConfig* cfg);
+
+/**
+ * Analyse a WAV file in one pass
+ * @param filename     Path ("0:/target.wav" on the board)
+ * @param cfg          Config; NULL for the defaults
+ * @param stats        Receives the levels and the grid summary
+ * @return             0 on success, -1 if the file cannot be opened or is not PCM WAV
+ */
+int analyseWav(const char* filename, const WavAnalysisConfig* cfg, WavStats* stats);
+
+/**
+ * Find the first non-zero sample in a WAV file
+ * @param filename     Path to the WAV file
+ * @param threshold    Minimum absolute value to consider as non-zero (default: 10)
+ * @param maxSearch    Maximum number of samples to search (0 = search all)
+ * @return             Index of first non-zero sample, or -1 on error or if there is none
+ */
+int findAudioStart(const char* filename, int threshold, int maxSearch);
+
+/**
+ * Detect pitch from a WAV file
+ * @param filename     Path to the WAV file
+ * @param startSample  Which sample to start analysis from (-1 = auto-detect, 0 = beginning)
+ * @param numSamples   How many samples to analyze (0 = 2048)
+ * @param threshold    Detection threshold (0.05 = strict, 0.15 = balanced, 0.30 = lenient)
+ * @param result       Pointer to PitchResult structure to store results
+ * @return             0 on success, -1 on error
+ */
+int detectPitchFromWav(const char* filename, int startSample, int numSamples,
+                       float threshold, PitchResult* result);
+
+/**
+ * Detect pitch with the defaults: auto-detected start, 2048 samples, threshold 0.15
+ * @param filename     Path to the WAV file
+ * @param result       Pointer to PitchResult structure
+ * @return             0 on success, -1 on error
+ */
+int detectPitchSimple(const char* filename, PitchResult* result);
+
+/**
+ * Detect pitch from a time range of a WAV file
+ * @param filename     Path to the WAV file
+ * @param startTimeMs  Start time in milliseconds
+ * @param durationMs   Duration in milliseconds to analyze
+ * @param threshold    Detection threshold
+ * @param result       Pointer to PitchResult structure
+ * @return             0 on success, -1 on error
+ */
+int detectPitchFromTime(const char* filename, int startTimeMs, int durationMs,
+                        float threshold, PitchResult* result);
+
+#endif // WAV_PITCH_DETECTION_H
@@ -0,0 +1,197 @@
+#include <string.h>
+#include "wav_reader.h"
+#include "prof.h"
+
+#define WAV_FORMAT_PCM          1
+#define WAV_FORMAT_IMA_ADPCM    0x11
+#define WAV_FORMAT_EXTENSIBLE   0xFFFE
+
+static uint32_t wr_le32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t wr_le16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// Read exactly n bytes at off
+static FRESULT wr_read_at(FIL* fp, uint32_t off, void* buf, UINT n) {
+    UINT br;
+    FRESULT fr = f_lseek(fp, off);
+    if (fr == FR_OK) fr = f_read(fp, buf, n, &br);
+    if (fr == FR_OK && br != n) fr = FR_INVALID_OBJECT;
+    return fr;
+}
+
+// Walk the chunks after "RIFF....WAVE" for fmt and data
+static FRESULT wr_parse(WavReader* r) {
+    uint8_t h[40];
+    uint32_t size = (uint32_t)f_size(&r->fp);
+    int have_fmt = 0, have_data = 0;
+    uint32_t data_bytes = 0;
+    uint32_t fact_frames = 0;
+
+    FRESULT fr = wr_read_at(&r->fp, 0, h, 12);
+    if (fr != FR_OK) return fr;
+    if (memcmp(h, "RIFF", 4) != 0 || memcmp(h + 8, "WAVE", 4) != 0) return FR_INVALID_OBJECT;
+
+    uint32_t off = 12;
+    while (off + 8 <= size && !(have_fmt && have_data)) {
+        fr = wr_read_at(&r->fp, off, h, 8);
+        if (fr != FR_OK) return fr;
+        uint32_t len = wr_le32(h + 4);
+        uint32_t body = off + 8;
+
+        if (memcmp(h, "fmt ", 4) == 0) {
+            if (len < 16) return FR_INVALID_OBJECT;
+            fr = wr_read_at(&r->fp, body, h, len < sizeof(h) ? len : sizeof(h));
+            if (fr != FR_OK) return fr;
+            uint16_t tag = wr_le16(h);
+            if (tag == WAV_FORMAT_EXTENSIBLE && len >= 26) {
+                tag = wr_le16(h + 24);              // Sub-format GUID starts with the tag
+            }
+            r->channels = wr_le16(h + 2);
+            r->fs = wr_le32(h + 4);
+            r->frame_bytes = wr_le16(h + 12);
+            r->bits = wr_le16(h + 14);
+            if (tag == WAV_FORMAT_IMA_ADPCM) {
+                // Mono only, and a block must fit blk
+                r->block_bytes = r->frame_bytes;
+                r->block_frames = (uint16_t)((r->block_bytes - 4) * 2 + 1);
+                if (r->channels != 1 || r->bits != 4 || r->block_bytes <= 4 ||
+                    r->block_bytes > ADPCM_BLOCK_BYTES ||
+                    (len >= 20 && wr_le16(h + 18) != r->block_frames)) {
+                    return FR_INVALID_OBJECT;
+                }
+            } else if (tag != WAV_FORMAT_PCM || r->bits != 16 || r->channels == 0 ||
+                r->frame_bytes != r->channels * 2) {
+                return FR_INVALID_OBJECT;
+            }
+            have_fmt = 1;
+        } else if (memcmp(h, "fact", 4) == 0 && len >= 4) {
+            fr = wr_read_at(&r->fp, body, h, 4);
+            if (fr != FR_OK) return fr;
+            fact_frames = wr_le32(h);
+        } else if (memcmp(h, "data", 4) == 0) {
+            r->data_offset = body;
+            // A take cut short (or still being written) can claim more than the file holds
+            data_bytes = len <= size - body ? len : size - body;
+            have_data = 1;
+        }
+        off = body + len + (len & 1);               // Chunks are padded to even sizes
+        if (off < body) break;                      // Length field overflowed
+    }
+
+    if (!have_fmt || !have_data) return FR_INVALID_OBJECT;
+    if (r->block_bytes) {
+        // Whole blocks, then whatever a short last block holds; fact trims the padding
+        uint32_t rest = data_bytes % r->block_bytes;
+        r->frames = data_bytes / r->block_bytes * r->block_frames;
+        if (rest >= 4) r->frames += 1 + (rest - 4) * 2;
+        if (fact_frames > 0 && fact_frames < r->frames) r->frames = fact_frames;
+    } else {
+        r->frames = data_bytes / r->frame_bytes;
+    }
+    return FR_OK;
+}
+
+FRESULT wav_reader_open(WavReader* r, const char* path) {
+    memset(r, 0, sizeof(*r));
+    FRESULT fr = f_open(&r->fp, path, FA_READ);
+    if (fr != FR_OK) return fr;
+
+    fr = wr_parse(r);
+    if (fr != FR_OK) {
+        f_close(&r->fp);
+        return fr;
+    }
+
+#if defined(FF_USE_FASTSEEK) && FF_USE_FASTSEEK
+    r->clmt[0] = WAV_READER_CLMT;
+    r->fp.cltbl = r->clmt;
+    r->fast_seek = f_lseek(&r->fp, CREATE_LINKMAP) == FR_OK;
+    if (!r->fast_seek) {
+        r->fp.cltbl = NULL;                         // Too fragmented; walk the chain instead
+    }
+#endif
+    return wav_reader_seek(r, 0);
+}
+
+FRESULT wav_reader_seek(WavReader* r, uint32_t frame) {
+    if (frame > r->frames) frame = r->frames;
+    r->pos = frame;
+    if (r->block_bytes) {
+        r->block_ready = 0;                         // The next read loads the block
+        return FR_OK;
+    }
+    return f_lseek(&r->fp, r->data_offset + frame * r->frame_bytes);
+}
+
+// Load the ADPCM block holding pos and bring the decoder up to pos - 1
+static FRESULT wr_load_block(WavReader* r, int16_t* first) {
+    UINT br = 0;
+    uint32_t b = r->pos / r->block_frames;
+    FRESULT fr = f_lseek(&r->fp, r->data_offset + b * r->block_bytes);
+    PROF_START(PROF_SD_READ);
+    if (fr == FR_OK) fr = f_read(&r->fp, r->blk, r->block_bytes, &br);
+    PROF_STOP(PROF_SD_READ);
+    if (fr != FR_OK) return fr;
+    if (br < 4) return FR_INVALID_OBJECT;
+    memset(r->blk + br, 0, r->block_bytes - br);   // Short last block
+
+    *first = adpcm_block_header(&r->adpcm, r->blk);
+    int16_t skip[64];
+    for (uint32_t k = 1; k < r->pos % r->block_frames; ) {
+        uint32_t n = r->pos % r->block_frames - k;
+        if (n > 64) n = 64;
+        adpcm_decode(&r->adpcm, r->blk, k, skip, n);
+        k += n;
+    }
+    r->block_ready = 1;
+    return FR_OK;
+}
+
+static FRESULT wr_read_adpcm(WavReader* r, int16_t* pcm, uint32_t n, uint32_t* got) {
+    *got = 0;
+    while (n > 0) {
+        uint32_t in = r->pos % r->block_frames;
+        if (in == 0 || !r->block_ready) {
+            int16_t first;
+            FRESULT fr = wr_load_block(r, &first);
+            if (fr != FR_OK) return fr;
+            if (in == 0) {
+                *pcm++ = first;
+                r->pos++;
+                (*got)++;
+                n--;
+                continue;
+            }
+        }
+        uint32_t take = r->block_frames - in;
+        if (take > n) take = n;
+        adpcm_decode(&r->adpcm, r->blk, in, pcm, take);
+        pcm += take;
+        r->pos += take;
+        *got += take;
+        n -= take;
+    }
+    return FR_OK;
+}
+
+FRESULT wav_reader_read(WavReader* r, int16_t* pcm, uint32_t n, uint32_t* got) {
+    UINT br = 0;
+    if (n > r->frames - r->pos) n = r->frames - r->pos;
+    if (r->block_bytes) {
+        return wr_read_adpcm(r, pcm, n, got);
+    }
+    PROF_START(PROF_SD_READ);
+    FRESULT fr = f_read(&r->fp, pcm, n * r->frame_bytes, &br);
+    PROF_STOP(PROF_SD_READ);
+    *got = br / r->frame_bytes;
+    r->pos += *got;
+    return fr;
+}
+
+void wav_reader_close(WavReader* r) {
+    f_close(&r->fp);
+}
@@ -0,0 +1,76 @@
+#ifndef WAV_READER_H
+#define WAV_READER_H
+
+#include <stdint.h>
+#include "ff.h"
+#include "adpcm.h"
+
+// 16-bit PCM WAV reader for the SD card.
+// The file is opened once and its RIFF chunks are walked properly (LIST,
+// fact, cue, etc. are skipped, WAVE_FORMAT_EXTENSIBLE is accepted), so the
+// data chunk is found wherever it is. When the BSP enables FF_USE_FASTSEEK
+// the reader builds a cluster link map table on open, which makes a seek to
+// any sample O(1) instead of a walk down the FAT chain; a file too
+// fragmented for the table falls back to ordinary seeks. Reads go straight
+// into the caller's buffer.
+//
+// Mono IMA ADPCM files (WAVE_FORMAT_IMA_ADPCM, blocks of up to
+// ADPCM_BLOCK_BYTES, as wav_writer writes them with WAV_BITS_ADPCM) read
+// the same way: each block is loaded once and decoded straight into the
+// caller's buffer, and a seek starts decoding at the block holding the frame.
+
+#ifndef WAV_READER_CLMT
+#define WAV_READER_CLMT         64      // DWORDs of link map: (64 - 1) / 2 = 31 fragments
+#endif
+
+typedef struct {
+    FIL fp;
+    uint32_t fs;
+    uint16_t channels;
+    uint16_t bits;              // As stored (4 for ADPCM; reads are always 16-bit)
+    uint16_t frame_bytes;       // Bytes per sample frame in the file (PCM; all channels)
+    uint32_t data_offset;       // File offset of the first sample
+    uint32_t frames;            // Sample frames in the data chunk
+    uint32_t pos;               // Next frame wav_reader_read returns
+    int fast_seek;              // The link map table is active
+    DWORD clmt[WAV_READER_CLMT];
+    uint16_t block_bytes;       // ADPCM: bytes per block (0 = PCM)
+    uint16_t block_frames;      // ADPCM: frames per block
+    int block_ready;            // ADPCM: blk holds the block of pos and adpcm is at pos - 1
+    AdpcmState adpcm;
+    uint8_t blk[ADPCM_BLOCK_BYTES];
+} WavReader;
+
+/**
+ * Open a WAV file and locate its format and data chunks
+ * @param r            Reader to initialise
+ * @param path         Full path (e.g. "0:/rec_001.wav")
+ * @return             FR_OK, FR_INVALID_OBJECT if it is not 16-bit PCM or mono IMA ADPCM WAV,
+ *                     or the FatFs error
+ */
+FRESULT wav_reader_open(WavReader* r, const char* path);
+
+/**
+ * Move to a sample frame; the next read starts there
+ * @param r            Open reader
+ * @param frame        Frame index (clamped to the end of the data)
+ * @return             FR_OK, or the FatFs error
+ */
+FRESULT wav_reader_seek(WavReader* r, uint32_t frame);
+
+/**
+ * Read consecutive frames into the caller's buffer
+ * @param r            Open reader
+ * @param pcm          Room for n 16-bit frames (interleaved if channels > 1)
+ * @param n            Frames wanted
+ * @param got          Receives the frames read (fewer at the end of the data)
+ * @return             FR_OK, or the FatFs error
+ */
+FRESULT wav_reader_read(WavReader* r, int16_t* pcm, uint32_t n, uint32_t* got);
+
+/**
+ * @param r            Open reader
+ */
+void wav_reader_close(WavReader* r);
+
+#endif // WAV_READER_H
@@ -0,0 +1,287 @@
+#include <string.h>
+#include "wav_writer.h"
+#include "prof.h"
+
+#ifndef FF_MAX_SS
+#define FF_MAX_SS 512
+#endif
+
+// Block being built, and block 0 (header + first samples) held until close
+static uint8_t ww_stage[WAV_WRITER_BUF_BYTES] __attribute__((aligned(64)));
+static uint8_t ww_head[WAV_WRITER_BUF_BYTES] __attribute__((aligned(64)));
+static uint8_t ww_adpcm[ADPCM_BLOCK_BYTES];
+static int ww_open;
+
+#define WAV_FORMAT_IMA_ADPCM    0x11
+
+static void ww_le16(uint8_t* p, uint32_t v) {
+    p[0] = v & 255; p[1] = (v >> 8) & 255;
+}
+
+static void ww_le32(uint8_t* p, uint32_t v) {
+    p[0] = v & 255; p[1] = (v >> 8) & 255; p[2] = (v >> 16) & 255; p[3] = (v >> 24) & 255;
+}
+
+static uint32_t ww_header_bytes(const WavWriter* w) {
+    return w->bits == WAV_BITS_ADPCM ? WAV_ADPCM_HEADER_BYTES : WAV_HEADER_BYTES;
+}
+
+// Bytes of sample data for n samples (ADPCM: whole blocks, the last one padded)
+static uint32_t ww_data_bytes(const WavWriter* w, uint32_t n) {
+    if (w->bits == WAV_BITS_ADPCM) {
+        return (n + ADPCM_BLOCK_SAMPLES - 1) / ADPCM_BLOCK_SAMPLES * ADPCM_BLOCK_BYTES;
+    }
+    return n * (w->bits / 8);
+}
+
+// 60-byte IMA ADPCM header: fmt carries the samples per block, fact the length
+static void ww_header_adpcm(uint8_t* h, uint32_t nsamples, uint32_t fs, uint32_t data_bytes) {
+    memcpy(h, "RIFF", 4);
+    ww_le32(h + 4, WAV_ADPCM_HEADER_BYTES - 8 + data_bytes);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    ww_le32(h + 16, 20);                            // fmt chunk size
+    ww_le16(h + 20, WAV_FORMAT_IMA_ADPCM);
+    ww_le16(h + 22, 1);                             // mono
+    ww_le32(h + 24, fs);
+    ww_le32(h + 28, (uint32_t)((uint64_t)fs * ADPCM_BLOCK_BYTES / ADPCM_BLOCK_SAMPLES));
+    ww_le16(h + 32, ADPCM_BLOCK_BYTES);             // block align
+    ww_le16(h + 34, WAV_BITS_ADPCM);
+    ww_le16(h + 36, 2);                             // extra fmt bytes
+    ww_le16(h + 38, ADPCM_BLOCK_SAMPLES);
+    memcpy(h + 40, "fact", 4);
+    ww_le32(h + 44, 4);
+    ww_le32(h + 48, nsamples);
+    memcpy(h + 52, "data", 4);
+    ww_le32(h + 56, data_bytes);
+}
+
+void wav_writer_header(uint8_t* h, uint32_t nsamples, uint32_t fs, uint16_t bits, uint16_t ch) {
+    uint32_t byteRate   = fs * ch * (bits / 8);
+    uint16_t blockAlign = ch * (bits / 8);
+    uint32_t dataSize   = nsamples * blockAlign;
+    uint32_t riffSize   = 36 + dataSize;
+
+    h[0]='R';h[1]='I';h[2]='F';h[3]='F';
+    h[4]= riffSize     &255; h[5]=(riffSize>>8)&255; h[6]=(riffSize>>16)&255; h[7]=(riffSize>>24)&255;
+    h[8]='W';h[9]='A';h[10]='V';h[11]='E';
+    h[12]='f';h[13]='m';h[14]='t';h[15]=' ';
+    h[16]=16; h[17]=0; h[18]=0; h[19]=0;          // fmt chunk size
+    h[20]=1;  h[21]=0;                            // PCM
+    h[22]=ch; h[23]=0;                            // channels
+    h[24]= fs        &255; h[25]=(fs>>8)&255; h[26]=(fs>>16)&255; h[27]=(fs>>24)&255;
+    h[28]= byteRate  &255; h[29]=(byteRate>>8)&255; h[30]=(byteRate>>16)&255; h[31]=(byteRate>>24)&255;
+    h[32]= blockAlign&255; h[33]=(blockAlign>>8)&255;
+    h[34]= bits      &255; h[35]=(bits>>8)&255;
+    h[36]='d';h[37]='a';h[38]='t';h[39]='a';
+    h[40]= dataSize  &255; h[41]=(dataSize>>8)&255; h[42]=(dataSize>>16)&255; h[43]=(dataSize>>24)&255;
+}
+
+static uint32_t ww_cluster_bytes(const FIL* fp) {
+#if FF_MAX_SS != 512 && defined(FF_MIN_SS) && FF_MAX_SS != FF_MIN_SS
+    return (uint32_t)fp->obj.fs->csize * fp->obj.fs->ssize;
+#else
+    return (uint32_t)fp->obj.fs->csize * FF_MAX_SS;
+#endif
+}
+
+// Write the staged block at its offset (block 0 stays in RAM until close)
+static FRESULT ww_emit(WavWriter* w) {
+    UINT bw;
+    FRESULT fr;
+
+    if (w->offset == 0) {
+        memcpy(ww_head, ww_stage, w->block);
+    } else {
+        PROF_START(PROF_SD_WRITE);
+        fr = f_write(&w->fp, ww_stage, w->block, &bw);
+        PROF_STOP(PROF_SD_WRITE);
+        if (fr == FR_OK && bw != w->block) fr = FR_DISK_ERR;  // Volume full
+        if (fr != FR_OK) {
+            w->error = 1;
+            return fr;
+        }
+    }
+    w->offset += w->block;
+    w->fill = 0;
+    return FR_OK;
+}
+
+static FRESULT ww_open_file(WavWriter* w, const char* path, uint32_t max_samples,
+                           uint32_t fs, uint16_t bits, uint16_t channels, int slot) {
+    FRESULT fr;
+
+    if (ww_open) return FR_LOCKED;
+    if (bits == WAV_BITS_ADPCM && channels != 1) return FR_INVALID_PARAMETER;
+    memset(w, 0, sizeof(*w));
+    w->fs = fs;
+    w->bits = bits;
+    w->channels = channels;
+    w->slot = slot;
+    adpcm_init(&w->adpcm);
+
+    fr = f_open(&w->fp, path, (slot ? FA_OPEN_ALWAYS : FA_CREATE_ALWAYS) | FA_WRITE);
+    if (fr != FR_OK) return fr;
+
+    // Largest whole number of clusters that fits the buffer (a part cluster if one does not)
+    uint32_t cluster = ww_cluster_bytes(&w->fp);
+    w->block = WAV_WRITER_BUF_BYTES;
+    if (cluster > 0 && cluster <= WAV_WRITER_BUF_BYTES) {
+        w->block = (WAV_WRITER_BUF_BYTES / cluster) * cluster;
+    }
+
+    // Reserve the whole take, rounded up to a block, before any data goes out
+    uint32_t bytes = ww_header_bytes(w) + ww_data_bytes(w, max_samples);
+    bytes = (bytes + w->block - 1) / w->block * w->block;
+    if (slot && f_size(&w->fp) >= bytes) {
+        w->in_place = 1;                    // Overwrite the slot's clusters; nothing to allocate
+    } else {
+        if (slot && f_size(&w->fp) > 0) {
+            // Slot too small for this take: give it back and allocate afresh
+            fr = f_lseek(&w->fp, 0);
+            if (fr == FR_OK) fr = f_truncate(&w->fp);
+        }
+#if defined(FF_USE_EXPAND) && FF_USE_EXPAND
+        if (fr == FR_OK) w->contiguous = f_expand(&w->fp, bytes, 1) == FR_OK;
+#endif
+        if (fr == FR_OK && !w->contiguous) {
+            // No contiguous run (or no f_expand): an extending seek allocates the clusters wherever they are free
+            fr = f_lseek(&w->fp, bytes);
+            if (fr == FR_OK && f_tell(&w->fp) != bytes) fr = FR_DENIED;
+        }
+    }
+    if (fr == FR_OK) fr = f_lseek(&w->fp, w->block);
+    if (fr != FR_OK) {
+        f_close(&w->fp);
+        return fr;
+    }
+
+    // Block 0 starts with the header, filled in on close
+    w->fill = ww_header_bytes(w);
+    memset(ww_stage, 0, w->fill);
+    ww_open = 1;
+    return FR_OK;
+}
+
+FRESULT wav_writer_open(WavWriter* w, const char* path, uint32_t max_samples,
+                        uint32_t fs, uint16_t bits, uint16_t channels) {
+    return ww_open_file(w, path, max_samples, fs, bits, channels, 0);
+}
+
+FRESULT wav_writer_open_slot(WavWriter* w, const char* path, uint32_t max_samples,
+                             uint32_t fs, uint16_t bits, uint16_t channels) {
+    return ww_open_file(w, path, max_samples, fs, bits, channels, 1);
+}
+
+// Stage bytes, emitting every block that fills
+static FRESULT ww_put(WavWriter* w, const uint8_t* src, uint32_t bytes) {
+    while (bytes > 0) {
+        uint32_t take = w->block - w->fill;
+        if (take > bytes) take = bytes;
+        memcpy(ww_stage + w->fill, src, take);
+        w->fill += take;
+        src += take;
+        bytes -= take;
+
+        if (w->fill == w->block) {
+            FRESULT fr = ww_emit(w);
+            if (fr != FR_OK) return fr;
+        }
+    }
+    return FR_OK;
+}
+
+// Encode into the open ADPCM block, staging each block as it completes
+static FRESULT ww_put_adpcm(WavWriter* w, const int16_t* pcm, uint32_t n) {
+    while (n > 0) {
+        if (w->adpcm_fill == 0) {
+            adpcm_block_begin(&w->adpcm, *pcm++, ww_adpcm);
+            w->adpcm_fill = 1;
+            n--;
+        }
+        uint32_t take = ADPCM_BLOCK_SAMPLES - w->adpcm_fill;
+        if (take > n) take = n;
+        adpcm_encode(&w->adpcm, pcm, ww_adpcm, w->adpcm_fill, take);
+        w->adpcm_fill += take;
+        pcm += take;
+        n -= take;
+
+        if (w->adpcm_fill == ADPCM_BLOCK_SAMPLES) {
+            w->adpcm_fill = 0;
+            FRESULT fr = ww_put(w, ww_adpcm, ADPCM_BLOCK_BYTES);
+            if (fr != FR_OK) return fr;
+        }
+    }
+    return FR_OK;
+}
+
+FRESULT wav_writer_write(WavWriter* w, const int16_t* pcm, uint32_t n) {
+    FRESULT fr;
+
+    if (w->error) return FR_DISK_ERR;
+    if (w->bits == WAV_BITS_ADPCM) {
+        fr = ww_put_adpcm(w, pcm, n);
+    } else {
+        fr = ww_put(w, (const uint8_t*)pcm, n * sizeof(int16_t));
+    }
+    if (fr != FR_OK) return fr;
+    w->samples += n;
+    return FR_OK;
+}
+
+uint32_t wav_writer_block_room(const WavWriter* w) {
+    uint32_t room = w->block - w->fill;
+    if (w->bits == WAV_BITS_ADPCM) {
+        // The ADPCM block that crosses the end completes it
+        return (room + ADPCM_BLOCK_BYTES - 1) / ADPCM_BLOCK_BYTES * ADPCM_BLOCK_SAMPLES - w->adpcm_fill;
+    }
+    return room / sizeof(int16_t);
+}
+
+FRESULT wav_writer_close(WavWriter* w) {
+    FRESULT fr = w->error ? FR_DISK_ERR : FR_OK;
+    FRESULT r;
+    UINT bw;
+    uint32_t data_bytes = ww_data_bytes(w, w->samples);
+    uint32_t total = ww_header_bytes(w) + data_bytes;
+
+    // Last ADPCM block, its unused nibbles zero
+    if (w->adpcm_fill > 0 && !w->error) {
+        uint32_t used = 4 + w->adpcm_fill / 2;
+        memset(ww_adpcm + used, 0, ADPCM_BLOCK_BYTES - used);
+        w->adpcm_fill = 0;
+        r = ww_put(w, ww_adpcm, ADPCM_BLOCK_BYTES);
+        if (r != FR_OK && fr == FR_OK) fr = r;
+    }
+
+    // Tail: the only write shorter than a block
+    if (w->offset == 0) {
+        memcpy(ww_head, ww_stage, w->fill);
+    } else if (w->fill > 0 && !w->error) {
+        r = f_write(&w->fp, ww_stage, w->fill, &bw);
+        if (r != FR_OK || bw != w->fill) fr = r != FR_OK ? r : FR_DISK_ERR;
+    }
+
+    // Block 0 once, with the final length
+    uint32_t head = total < w->block ? total : w->block;
+    if (w->bits == WAV_BITS_ADPCM) {
+        ww_header_adpcm(ww_head, w->samples, w->fs, data_bytes);
+    } else {
+        wav_writer_header(ww_head, w->samples / w->channels, w->fs, w->bits, w->channels);
+    }
+    r = f_lseek(&w->fp, 0);
+    if (r == FR_OK) r = f_write(&w->fp, ww_head, head, &bw);
+    if (r == FR_OK && bw != head) r = FR_DISK_ERR;
+    if (r != FR_OK && fr == FR_OK) fr = r;
+
+    // Give back the preallocated space past the data (a slot keeps it for the next take)
+    if (!w->slot) {
+        r = f_lseek(&w->fp, total);
+        if (r == FR_OK) r = f_truncate(&w->fp);
+        if (r != FR_OK && fr == FR_OK) fr = r;
+    }
+
+    r = f_close(&w->fp);
+    if (r != FR_OK && fr == FR_OK) fr = r;
+    ww_open = 0;
+    return fr;
+}
@@ -0,0 +1,118 @@
+#ifndef WAV_WRITER_H
+#define WAV_WRITER_H
+
+#include <stdint.h>
+#include "ff.h"
+#include "adpcm.h"
+
+// Buffered 16-bit PCM WAV writer for the SD card.
+// Samples are staged in a cache-line-aligned buffer whose size is a whole
+// number of clusters and written only in full blocks at block-aligned
+// offsets, so FatFs sends them straight to the card as multi-sector writes.
+// The file is preallocated (contiguously with f_expand when the BSP enables
+// it and the card has a free run that long, else by an extending seek), the
+// first block is held back so the header is written once with the final
+// length, and the file is truncated to its real size on close.
+// One writer can be open at a time.
+//
+// wav_writer_open_slot treats the file as a take slot: one that already has
+// room for the take is overwritten in place, so opening it allocates nothing,
+// and it keeps its full size on close for the next take (the header gives
+// the real length). A slot is preallocated like any new file the first time.
+//
+// Opened with bits = WAV_BITS_ADPCM, a mono file is written as IMA ADPCM
+// (adpcm.h) at a quarter of the bytes: samples are encoded into the current
+// ADPCM block as they are written, and whole blocks go through the same
+// staging.
+
+#ifndef WAV_WRITER_BUF_BYTES
+#define WAV_WRITER_BUF_BYTES    (32 * 1024)     // Staging size; rounded down to whole clusters
+#endif
+
+#define WAV_HEADER_BYTES        44
+#define WAV_ADPCM_HEADER_BYTES  60      // fmt with samples per block, and a fact chunk
+#define WAV_BITS_ADPCM          4       // bits argument of wav_writer_open for IMA ADPCM
+
+typedef struct {
+    FIL fp;
+    uint32_t block;             // Bytes per write: whole clusters, <= WAV_WRITER_BUF_BYTES
+    uint32_t fill;              // Bytes staged in the current block
+    uint32_t offset;            // File offset of the current block
+    uint32_t samples;           // Samples accepted
+    uint32_t fs;
+    uint16_t bits;
+    uint16_t channels;
+    int contiguous;             // File was preallocated as one contiguous run
+    int slot;                   // Opened with wav_writer_open_slot: not trimmed on close
+    int in_place;               // Slot already had room: its clusters are overwritten
+    AdpcmState adpcm;           // ADPCM only: encoder state
+    uint32_t adpcm_fill;        // ADPCM only: samples in the block being encoded
+    int error;                  // A write failed; close still tries to leave a valid file
+} WavWriter;
+
+/**
+ * Fill a 44-byte PCM WAV header
+ * @param h            WAV_HEADER_BYTES bytes
+ * @param nsamples     Sample frames in the data chunk
+ * @param fs           Sample rate in Hz
+ * @param bits         Bits per sample
+ * @param ch           Channels
+ */
+void wav_writer_header(uint8_t* h, uint32_t nsamples, uint32_t fs, uint16_t bits, uint16_t ch);
+
+/**
+ * Create a WAV file on a mounted volume and preallocate it
+ * @param w            Writer to initialise
+ * @param path         Full path (e.g. "0:/rec_001.wav")
+ * @param max_samples  Largest number of samples that will be written (sizes the preallocation)
+ * @param fs           Sample rate in Hz
+ * @param bits         Bits per sample (16), or WAV_BITS_ADPCM
+ * @param channels     Channels (1 for WAV_BITS_ADPCM)
+ * @return             FR_OK, or the FatFs error (FR_LOCKED if another writer is open,
+ *                     FR_INVALID_PARAMETER for ADPCM with more than one channel)
+ */
+FRESULT wav_writer_open(WavWriter* w, const char* path, uint32_t max_samples,
+                        uint32_t fs, uint16_t bits, uint16_t channels);
+
+/**
+ * wav_writer_open for a take slot: an existing file with room for max_samples
+ * is overwritten in place; otherwise the file is (re)allocated as by
+ * wav_writer_open. The file is not trimmed on close.
+ * @param w            Writer to initialise
+ * @param path         Full path (e.g. "0:/rec_001.wav")
+ * @param max_samples  Largest number of samples that will be written
+ * @param fs           Sample rate in Hz
+ * @param bits         Bits per sample (16), or WAV_BITS_ADPCM
+ * @param channels     Channels (1 for WAV_BITS_ADPCM)
+ * @return             As wav_writer_open
+ */
+FRESULT wav_writer_open_slot(WavWriter* w, const char* path, uint32_t max_samples,
+                             uint32_t fs, uint16_t bits, uint16_t channels);
+
+/**
+ * Append samples (encoding them if the file is ADPCM); whole blocks go to the
+ * card as soon as they are complete
+ * @param w            Open writer
+ * @param pcm          n samples (interleaved if channels > 1)
+ * @param n            Number of samples
+ * @return             FR_OK, or the first FatFs error
+ */
+FRESULT wav_writer_write(WavWriter* w, const int16_t* pcm, uint32_t n);
+
+/**
+ * Samples that complete the block being staged, so that writing them costs
+ * exactly one card write
+ * @param w            Open writer
+ * @return             Samples (at least 1)
+ */
+uint32_t wav_writer_block_room(const WavWriter* w);
+
+/**
+ * Write the tail and the header with the final length, trim the file (unless it
+ * is a slot) and close it
+ * @param w            Open writer
+ * @return             FR_OK, or the first FatFs error seen since open
+ */
+FRESULT wav_writer_close(WavWriter* w);
+
+#endif // WAV_WRITER_H
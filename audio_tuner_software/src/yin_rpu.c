@@ -0,0 +1,256 @@
+#include "yin_rpu.h"
+
+#if YIN_RPU
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include "xil_cache.h"
+#include "xparameters.h"
+#include "YinTracker.h"
+#if YIN_RPU_IPI
+#include "xipipsu.h"
+#endif
+
+#define YIN_RPU_SHARED ((YinRpuShared*)YIN_RPU_SHARED_ADDR)
+
+// Spins before the R5 is considered absent
+#define YIN_RPU_OPEN_SPINS      2000000
+
+// Onset: burst energy this far over the running average, above the floor
+#define YIN_RPU_ONSET_RATIO     4.0f        // 6 dB
+#define YIN_RPU_ONSET_FLOOR     1e-5f       // -50 dBFS
+#define YIN_RPU_ONSET_HOLD      8           // Bursts before the next onset (43 ms)
+#define YIN_RPU_ENERGY_SMOOTH   0.1f
+
+static inline void yin_rpu_flush(const volatile void* p, size_t len) {
+    Xil_DCacheFlushRange((INTPTR)p, len);
+}
+
+static inline void yin_rpu_invalidate(const volatile void* p, size_t len) {
+    Xil_DCacheInvalidateRange((INTPTR)p, len);
+}
+
+#if YIN_RPU_IPI
+static XIpiPsu rpu_ipi;
+static int rpu_ipi_ready;
+
+static void yin_rpu_ipi_init(void) {
+    XIpiPsu_Config* cfg = XIpiPsu_LookupConfig(XPAR_XIPIPSU_0_DEVICE_ID);
+    rpu_ipi_ready = cfg && XIpiPsu_CfgInitialize(&rpu_ipi, cfg, cfg->BaseAddress) == XST_SUCCESS;
+}
+#endif
+
+/*** A53 side ***/
+
+static int rpu_open = 0;
+static uint32_t rpu_ticket = 0;
+static uint32_t rpu_block_head;
+static uint32_t rpu_frame_tail;
+
+int yin_rpu_open(int window, float threshold) {
+    YinRpuShared* q = YIN_RPU_SHARED;
+
+    // Tickets must never match a ready echo left in DDR by a previous run
+    yin_rpu_invalidate(&q->config, 2 * sizeof(YinRpuLine));
+    uint32_t top = q->config.value > q->ready.value ? q->config.value : q->ready.value;
+    if (rpu_ticket < top) rpu_ticket = top;
+    if (++rpu_ticket == 0) rpu_ticket = 1;
+
+    rpu_block_head = 0;
+    rpu_frame_tail = 0;
+    q->block_head.value = 0;
+    q->frame_tail.value = 0;
+    yin_rpu_flush(&q->block_head, sizeof(YinRpuLine));
+    yin_rpu_flush(&q->frame_tail, sizeof(YinRpuLine));
+
+    // Indices first, then the ticket that starts the session
+    q->config.window = window;
+    q->config.threshold = threshold;
+    q->config.value = rpu_ticket;
+    yin_rpu_flush(&q->config, sizeof(YinRpuLine));
+
+#if YIN_RPU_IPI
+    yin_rpu_ipi_init();
+    if (rpu_ipi_ready) {
+        XIpiPsu_TriggerIpi(&rpu_ipi, XPAR_XIPIPS_TARGET_PSU_CORTEXR5_0_CH0_MASK);
+    }
+#endif
+
+    int spins = YIN_RPU_OPEN_SPINS;
+    do {
+        yin_rpu_invalidate(&q->ready, sizeof(YinRpuLine));
+    } while (q->ready.value != rpu_ticket && --spins > 0);
+
+    rpu_open = spins > 0 && q->ready.status == 0;
+    return rpu_open;
+}
+
+void yin_rpu_close(void) {
+    YinRpuShared* q = YIN_RPU_SHARED;
+    if (!rpu_open) {
+        return;
+    }
+    // A fresh ticket with no window tells the R5 to free its tracker and idle
+    if (++rpu_ticket == 0) rpu_ticket = 1;
+    q->config.window = 0;
+    q->config.value = rpu_ticket;
+    yin_rpu_flush(&q->config, sizeof(YinRpuLine));
+#if YIN_RPU_IPI
+    if (rpu_ipi_ready) {
+        XIpiPsu_TriggerIpi(&rpu_ipi, XPAR_XIPIPS_TARGET_PSU_CORTEXR5_0_CH0_MASK);
+    }
+#endif
+    rpu_open = 0;
+}
+
+int yin_rpu_post(const int16_t* pcm, int n) {
+    YinRpuShared* q = YIN_RPU_SHARED;
+    if (!rpu_open || n < 1 || n > YIN_RPU_BLOCK_SAMPLES) {
+        return -1;
+    }
+    yin_rpu_invalidate(&q->block_tail, sizeof(YinRpuLine));
+    if (rpu_block_head - q->block_tail.value >= YIN_RPU_BLOCKS) {
+        return -1;
+    }
+
+    // Data first, then the index that publishes it
+    YinRpuBlock* b = &q->block[rpu_block_head & (YIN_RPU_BLOCKS - 1)];
+    memcpy(b->pcm, pcm, n * sizeof(int16_t));
+    b->seq = rpu_block_head;
+    b->n = n;
+    yin_rpu_flush(b, sizeof(*b));
+
+    q->block_head.value = ++rpu_block_head;
+    yin_rpu_flush(&q->block_head, sizeof(YinRpuLine));
+#if YIN_RPU_IPI
+    if (rpu_ipi_ready) {
+        XIpiPsu_TriggerIpi(&rpu_ipi, XPAR_XIPIPS_TARGET_PSU_CORTEXR5_0_CH0_MASK);
+    }
+#endif
+    return 0;
+}
+
+int yin_rpu_poll(YinRpuFrame* frame) {
+    YinRpuShared* q = YIN_RPU_SHARED;
+    if (!rpu_open) {
+        return 0;
+    }
+    yin_rpu_invalidate(&q->frame_head, sizeof(YinRpuLine));
+    if (q->frame_head.value == rpu_frame_tail) {
+        return 0;
+    }
+
+    YinRpuFrame* f = &q->frame[rpu_frame_tail & (YIN_RPU_FRAMES - 1)];
+    yin_rpu_invalidate(f, sizeof(*f));
+    *frame = *f;
+
+    q->frame_tail.value = ++rpu_frame_tail;
+    yin_rpu_flush(&q->frame_tail, sizeof(YinRpuLine));
+    return 1;
+}
+
+/*** R5 side ***/
+
+typedef struct {
+    float energy;               // Running average of the burst energy
+    int hold;                   // Bursts left before another onset may fire
+} YinRpuOnset;
+
+// Mean square of a burst (full scale = 1) and whether it starts a note
+static float yin_rpu_energy(YinRpuOnset* o, const int16_t* pcm, int n, uint32_t* onset) {
+    int64_t acc = 0;
+    for (int i = 0; i < n; i++) {
+        acc += (int32_t)pcm[i] * pcm[i];
+    }
+    float e = (float)acc / ((float)n * 32768.0f * 32768.0f);
+
+    *onset = 0;
+    if (o->hold > 0) {
+        o->hold--;
+    } else if (e > YIN_RPU_ONSET_FLOOR && e > YIN_RPU_ONSET_RATIO * o->energy) {
+        *onset = 1;
+        o->hold = YIN_RPU_ONSET_HOLD;
+    }
+    o->energy += (e - o->energy) * YIN_RPU_ENERGY_SMOOTH;
+    return e;
+}
+
+// Block until the A53 may have posted something (a doorbell, or just poll DDR)
+static void yin_rpu_wait(void) {
+#if YIN_RPU_IPI
+    if (rpu_ipi_ready) {
+        while (!(XIpiPsu_GetInterruptStatus(&rpu_ipi) & XPAR_XIPIPS_TARGET_PSU_CORTEXA53_0_CH0_MASK)) { }
+        XIpiPsu_ClearInterruptStatus(&rpu_ipi, XPAR_XIPIPS_TARGET_PSU_CORTEXA53_0_CH0_MASK);
+    }
+#endif
+}
+
+void yin_rpu_worker_main(void) {
+    YinRpuShared* q = YIN_RPU_SHARED;
+    YinTracker tracker;
+    YinRpuOnset onset = { 0.0f, 0 };
+    int tracking = 0;
+    uint32_t session = 0;
+    uint32_t tail = 0;
+    uint32_t frame_head = 0;
+
+#if YIN_RPU_IPI
+    yin_rpu_ipi_init();
+#endif
+    for (;;) {
+        yin_rpu_invalidate(&q->config, sizeof(YinRpuLine));
+        if (q->config.value != session) {
+            session = q->config.value;
+            if (tracking) {
+                YinTracker_free(&tracker);
+                tracking = 0;
+            }
+            tail = 0;
+            frame_head = 0;
+            onset.energy = 0.0f;
+            onset.hold = 0;
+            q->block_tail.value = 0;
+            q->frame_head.value = 0;
+            yin_rpu_flush(&q->block_tail, sizeof(YinRpuLine));
+            yin_rpu_flush(&q->frame_head, sizeof(YinRpuLine));
+
+            if (q->config.window > 0) {
+                tracking = YinTracker_init(&tracker, q->config.window, q->config.threshold) == 0;
+                q->ready.status = tracking ? 0 : -1;
+                q->ready.value = session;
+                yin_rpu_flush(&q->ready, sizeof(YinRpuLine));
+            }
+        }
+
+        // A head behind the tail is the next session's reset, seen before its ticket
+        yin_rpu_invalidate(&q->block_head, sizeof(YinRpuLine));
+        yin_rpu_invalidate(&q->frame_tail, sizeof(YinRpuLine));
+        uint32_t pending = q->block_head.value - tail;
+        if (!tracking || pending == 0 || pending > YIN_RPU_BLOCKS) {
+            yin_rpu_wait();
+            continue;
+        }
+        if (frame_head - q->frame_tail.value >= YIN_RPU_FRAMES) {
+            continue;   // The A53 is behind; its block ring fills and it drops bursts
+        }
+
+        YinRpuBlock* b = &q->block[tail & (YIN_RPU_BLOCKS - 1)];
+        yin_rpu_invalidate(b, sizeof(*b));
+        int n = b->n > YIN_RPU_BLOCK_SAMPLES ? YIN_RPU_BLOCK_SAMPLES : (int)b->n;
+
+        YinRpuFrame* f = &q->frame[frame_head & (YIN_RPU_FRAMES - 1)];
+        f->seq = b->seq;
+        f->pitch = YinTracker_push(&tracker, b->pcm, n);
+        f->probability = YinTracker_getProbability(&tracker);
+        f->level = sqrtf(yin_rpu_energy(&onset, b->pcm, n, &f->onset));
+
+        q->block_tail.value = ++tail;
+        yin_rpu_flush(&q->block_tail, sizeof(YinRpuLine));
+        yin_rpu_flush(f, sizeof(*f));
+        q->frame_head.value = ++frame_head;
+        yin_rpu_flush(&q->frame_head, sizeof(YinRpuLine));
+    }
+}
+
+#endif // YIN_RPU
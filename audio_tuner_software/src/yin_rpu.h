@@ -0,0 +1,112 @@
+#ifndef YIN_RPU_H
+#define YIN_RPU_H
+
+#include <stdint.h>
+
+// Pitch analysis on a Cortex-R5 (AMP).
+//
+// The A53 posts every capture burst into a ring in shared DDR; a firmware
+// app on an R5 calls yin_rpu_worker_main(), which runs the streaming Yin
+// tracker and an energy onset detector over the bursts in order and posts a
+// pitch frame back for each one. The A53 keeps the vocoder and only collects
+// frames, so tracking and shifting run side by side and the tracker's timing
+// no longer depends on what the A53 is doing. Link the R5 app's code and
+// stack into TCM for deterministic timing.
+//
+// Both rings are single-writer per index with each index on its own cache
+// line; the R5's caches are not coherent with the A53's, so every hand-off
+// uses an explicit flush/invalidate (as pv_mc.c does). With YIN_RPU_IPI=1
+// each post also rings the R5's IPI doorbell, so the firmware polls a
+// register instead of re-reading DDR while it waits. The R5 app must be
+// linked clear of YIN_RPU_SHARED_ADDR .. + sizeof(YinRpuShared), and its
+// heap must hold a tracker (about 34 KB for a 1024-sample window, 16 KB
+// with YIN_TRACKER_SLIDING=1).
+//
+// Only built with -DYIN_RPU=1 (both apps; the R5 app also needs Yin.c,
+// YinTracker.c, fft.c and arena.c); without a live R5 the A53 tracks locally.
+
+#ifndef YIN_RPU
+#define YIN_RPU             0
+#endif
+
+#ifndef YIN_RPU_IPI
+#define YIN_RPU_IPI         0
+#endif
+
+#ifndef YIN_RPU_SHARED_ADDR
+#define YIN_RPU_SHARED_ADDR 0x7FD00000UL    // 1 MB below PV_MC_SHARED_ADDR
+#endif
+
+#define YIN_RPU_BLOCKS          16          // Bursts in flight (power of two)
+#define YIN_RPU_FRAMES          16          // Results in flight (power of two)
+#define YIN_RPU_BLOCK_SAMPLES   256         // Largest burst (CAPTURE_BURST_SAMPLES)
+
+#define YIN_RPU_LINE __attribute__((aligned(64)))
+
+// One cache line per index, fixed-width fields only: the R5 is 32-bit
+typedef struct {
+    volatile uint32_t value;
+    int32_t window;             // Config line only: tracker window
+    float threshold;            // Config line only: Yin threshold
+    int32_t status;             // Ready line only: 0 if the tracker was set up, -1 if not
+} YIN_RPU_LINE YinRpuLine;
+
+typedef struct {
+    int16_t pcm[YIN_RPU_BLOCK_SAMPLES];
+    uint32_t seq;               // Bursts posted before this one in the session
+    uint32_t n;
+} YIN_RPU_LINE YinRpuBlock;
+
+typedef struct {
+    uint32_t seq;               // Burst the frame ends at
+    float pitch;                // Hz, -1 if none
+    float probability;
+    float level;                // RMS of the burst (full scale = 1)
+    uint32_t onset;             // 1 if the burst starts a note
+} YinRpuFrame;
+
+typedef struct {
+    YinRpuLine config;          // A53: session ticket and tracker settings
+    YinRpuLine ready;           // R5: echoes the ticket once set up
+    YinRpuLine block_head;      // A53: bursts posted
+    YinRpuLine block_tail;      // R5: bursts consumed
+    YinRpuLine frame_head;      // R5: frames posted
+    YinRpuLine frame_tail;      // A53: frames consumed
+    YinRpuBlock block[YIN_RPU_BLOCKS];
+    YinRpuFrame frame[YIN_RPU_FRAMES] YIN_RPU_LINE;
+} YinRpuShared;
+
+/**
+ * A53: start a session and wait for the R5 to set up its tracker
+ * @param window     Tracker window (as YinTracker_init)
+ * @param threshold  Yin threshold
+ * @return           1 if the R5 is tracking, 0 if it did not answer or failed (track locally)
+ */
+int yin_rpu_open(int window, float threshold);
+
+/**
+ * A53: end the session (the R5 idles until the next open)
+ */
+void yin_rpu_close(void);
+
+/**
+ * A53: hand a burst to the R5
+ * @param pcm        Samples (copied)
+ * @param n          Number of samples (<= YIN_RPU_BLOCK_SAMPLES)
+ * @return           0 on success, -1 if the ring is full or n is too large (burst not analysed)
+ */
+int yin_rpu_post(const int16_t* pcm, int n);
+
+/**
+ * A53: collect the oldest frame the R5 has posted
+ * @param frame      Receives the frame
+ * @return           1 if a frame was returned, 0 if none is ready
+ */
+int yin_rpu_poll(YinRpuFrame* frame);
+
+/**
+ * R5: serve the rings forever
+ */
+void yin_rpu_worker_main(void);
+
+#endif // YIN_RPU_H
@@ -23,6 +23,9 @@ library ieee;
 use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
+-- Four-region dynamics on the envelope: gate, boost, unity, compression.
+-- The levels and shifts are set at run time; the generics are the values
+-- the pipeline resets to.
 entity dynamics_core is
     generic (
         SAMPLE_WIDTH : integer := 24;
@@ -40,6 +43,12 @@ entity dynamics_core is
         clk      : in  std_logic;
         rst      : in  std_logic;  -- active high
 
+        gate_level  : in  unsigned(SAMPLE_WIDTH-1 downto 0);
+        boost_level : in  unsigned(SAMPLE_WIDTH-1 downto 0);
+        comp_level  : in  unsigned(SAMPLE_WIDTH-1 downto 0);
+        boost_shift : in  unsigned(3 downto 0);
+        comp_shift  : in  unsigned(3 downto 0);
+
         x_in     : in  std_logic_vector(SAMPLE_WIDTH-1 downto 0); -- filtered audio
         env_in   : in  std_logic_vector(SAMPLE_WIDTH-1 downto 0); -- envelope
         x_valid  : in  std_logic;
@@ -52,12 +61,16 @@ end entity dynamics_core;
 architecture rtl of dynamics_core is
     signal y_s       : signed(SAMPLE_WIDTH-1 downto 0);
     signal valid_reg : std_logic;
+
+    constant Y_MAX : signed(SAMPLE_WIDTH+15 downto 0) := to_signed(2**(SAMPLE_WIDTH-1) - 1, SAMPLE_WIDTH+16);
+    constant Y_MIN : signed(SAMPLE_WIDTH+15 downto 0) := to_signed(-2**(SAMPLE_WIDTH-1), SAMPLE_WIDTH+16);
 begin
 
     process(clk)
         variable x_s      : signed(SAMPLE_WIDTH-1 downto 0);
         variable env_mag  : unsigned(SAMPLE_WIDTH-1 downto 0);
         variable y_tmp    : signed(SAMPLE_WIDTH-1 downto 0);
+        variable boosted  : signed(SAMPLE_WIDTH+15 downto 0);
     begin
         if rising_edge(clk) then
             if rst = '1' then
@@ -72,21 +85,28 @@ begin
                     env_mag := unsigned(env_in);  -- envelope is non-negative
 
                     -- region selection based on envelope magnitude
-                    if env_mag < to_unsigned(GATE_LEVEL, SAMPLE_WIDTH) then
+                    if env_mag < gate_level then
                         -- 1) Noise gate: very quiet → mute
                         y_tmp := (others => '0');
 
-                    elsif env_mag < to_unsigned(BOOST_LEVEL, SAMPLE_WIDTH) then
-                        -- 2) Expansion / boost for quiet-but-not-noise
-                        y_tmp := shift_left(x_s, BOOST_SHIFT);
-
-                    elsif env_mag < to_unsigned(COMP_LEVEL, SAMPLE_WIDTH) then
+                    elsif env_mag < boost_level then
+                        -- 2) Expansion / boost for quiet-but-not-noise (saturating)
+                        boosted := shift_left(resize(x_s, SAMPLE_WIDTH+16), to_integer(boost_shift));
+                        if boosted > Y_MAX then
+                            y_tmp := resize(Y_MAX, SAMPLE_WIDTH);
+                        elsif boosted < Y_MIN then
+                            y_tmp := resize(Y_MIN, SAMPLE_WIDTH);
+                        else
+                            y_tmp := resize(boosted, SAMPLE_WIDTH);
+                        end if;
+
+                    elsif env_mag < comp_level then
                         -- 3) Unity region: normal speech/music
                         y_tmp := x_s;
 
                     else
                         -- 4) Compression / limiting region for loud peaks
-                        y_tmp := shift_right(x_s, COMP_SHIFT);
+                        y_tmp := shift_right(x_s, to_integer(comp_shift));
                     end if;
 
                     y_s <= y_tmp;
@@ -21,6 +21,9 @@ library ieee;
 use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
+-- Peak envelope: moves 1/2^attack_shift of the way up to a louder sample and
+-- 1/2^release_shift of the way down to a quieter one. The shifts are set at
+-- run time (the SHIFT_* generics are the values the pipeline resets to).
 entity envelope_follower is
     generic (
         SAMPLE_WIDTH : integer := 24;   -- same width as FIR output
@@ -31,6 +34,9 @@ entity envelope_follower is
         clk     : in  std_logic;
         rst     : in  std_logic;       -- active high
 
+        attack_shift  : in unsigned(3 downto 0);
+        release_shift : in unsigned(3 downto 0);
+
         x_in    : in  std_logic_vector(SAMPLE_WIDTH-1 downto 0);
         x_valid : in  std_logic;
 
@@ -40,11 +46,11 @@ entity envelope_follower is
 end entity envelope_follower;
 
 architecture rtl of envelope_follower is
-    signal x_abs : signed(SAMPLE_WIDTH-1 downto 0);
     signal env   : signed(SAMPLE_WIDTH-1 downto 0);
 begin
 
     process(clk)
+        variable x_abs : signed(SAMPLE_WIDTH-1 downto 0);
         variable diff : signed(SAMPLE_WIDTH-1 downto 0);
         variable adj  : signed(SAMPLE_WIDTH-1 downto 0);
     begin
@@ -54,11 +60,15 @@ begin
             else
                 if x_valid = '1' then
 
-                    -- absolute value
+                    -- absolute value of this sample (the most negative one saturates)
                     if x_in(SAMPLE_WIDTH-1) = '1' then
-                        x_abs <= -signed(x_in);
+                        if signed(x_in) = to_signed(-2**(SAMPLE_WIDTH-1), SAMPLE_WIDTH) then
+                            x_abs := to_signed(2**(SAMPLE_WIDTH-1) - 1, SAMPLE_WIDTH);
+                        else
+                            x_abs := -signed(x_in);
+                        end if;
                     else
-                        x_abs <= signed(x_in);
+                        x_abs := signed(x_in);
                     end if;
 
                     -- compute difference
@@ -66,12 +76,12 @@ begin
 
                     -- choose attack or release
                     if diff > 0 then
-                        -- fast attack → shift by SHIFT_ATTACK
-                        adj := shift_right(diff, SHIFT_ATTACK);
+                        -- fast attack → shift by attack_shift
+                        adj := shift_right(diff, to_integer(attack_shift));
                         env <= env + adj;
                     else
-                        -- slow release → shift by SHIFT_RELEASE
-                        adj := shift_right(diff, SHIFT_RELEASE);
+                        -- slow release → shift by release_shift
+                        adj := shift_right(diff, to_integer(release_shift));
                         env <= env + adj;
                     end if;
                 end if;
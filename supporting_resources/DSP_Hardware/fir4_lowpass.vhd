@@ -21,6 +21,10 @@ library ieee;
 use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
+-- 4-tap FIR. The taps are signed 8-bit Q3 values (8 = unity) set at run time
+-- through coeffs: bits 7:0 weight the newest sample, 31:24 the oldest.
+-- x"01030301" is the [1,3,3,1]/8 binomial low-pass; x"00000008" passes the
+-- input through unchanged. The sum saturates to SAMPLE_WIDTH bits.
 entity fir4_lowpass is
     generic (
         SAMPLE_WIDTH : integer := 24  -- width of input/output samples
@@ -29,6 +33,8 @@ entity fir4_lowpass is
         clk     : in  std_logic;
         rst     : in  std_logic;  -- active high synchronous reset
 
+        coeffs  : in  std_logic_vector(31 downto 0);  -- c3 & c2 & c1 & c0, signed Q3
+
         x_in    : in  std_logic_vector(SAMPLE_WIDTH-1 downto 0);
         x_valid : in  std_logic;
 
@@ -42,8 +48,8 @@ architecture rtl of fir4_lowpass is
     -- internal sample registers (tap delay line)
     signal x0, x1, x2, x3 : signed(SAMPLE_WIDTH-1 downto 0);
 
-    -- accumulator width: input width + few guard bits
-    constant ACC_WIDTH : integer := SAMPLE_WIDTH + 4;
+    -- accumulator width: input width + coefficient width + 2 guard bits for 4 taps
+    constant ACC_WIDTH : integer := SAMPLE_WIDTH + 10;
     signal acc         : signed(ACC_WIDTH-1 downto 0);
     signal acc_scaled  : signed(ACC_WIDTH-1 downto 0);
 
@@ -52,9 +58,13 @@ architecture rtl of fir4_lowpass is
     -- delay line for valid flag so it lines up with y_s
     signal v_shift     : std_logic_vector(3 downto 0);
 
+    constant Y_MAX : signed(ACC_WIDTH-1 downto 0) := to_signed(2**(SAMPLE_WIDTH-1) - 1, ACC_WIDTH);
+    constant Y_MIN : signed(ACC_WIDTH-1 downto 0) := to_signed(-2**(SAMPLE_WIDTH-1), ACC_WIDTH);
+
 begin
 
     process(clk)
+        variable c0, c1, c2, c3 : signed(7 downto 0);
     begin
         if rising_edge(clk) then
             if rst = '1' then
@@ -78,18 +88,28 @@ begin
                     x0 <= signed(x_in);
                 end if;
 
-                -- multiply-accumulate using coefficients [1,3,3,1]
+                -- multiply-accumulate with the programmed taps
+                c0 := signed(coeffs(7 downto 0));
+                c1 := signed(coeffs(15 downto 8));
+                c2 := signed(coeffs(23 downto 16));
+                c3 := signed(coeffs(31 downto 24));
                 acc <=
-                    resize(x0, ACC_WIDTH) +
-                    resize(x1 * 3, ACC_WIDTH) +
-                    resize(x2 * 3, ACC_WIDTH) +
-                    resize(x3, ACC_WIDTH);
+                    resize(x0 * c0, ACC_WIDTH) +
+                    resize(x1 * c1, ACC_WIDTH) +
+                    resize(x2 * c2, ACC_WIDTH) +
+                    resize(x3 * c3, ACC_WIDTH);
 
-                -- divide by 8 → arithmetic right shift by 3
+                -- Q3 taps: divide by 8 → arithmetic right shift by 3
                 acc_scaled <= shift_right(acc, 3);
 
-                -- resize back to SAMPLE_WIDTH for output
-                y_s <= resize(acc_scaled, SAMPLE_WIDTH);
+                -- saturate back to SAMPLE_WIDTH for output
+                if acc_scaled > Y_MAX then
+                    y_s <= resize(Y_MAX, SAMPLE_WIDTH);
+                elsif acc_scaled < Y_MIN then
+                    y_s <= resize(Y_MIN, SAMPLE_WIDTH);
+                else
+                    y_s <= resize(acc_scaled, SAMPLE_WIDTH);
+                end if;
             end if;
         end if;
     end process;
@@ -98,4 +118,3 @@ begin
     y_valid <= v_shift(3);  -- output valid delayed to match filter pipeline
 
 end architecture rtl;
-